@@ -0,0 +1,79 @@
+// Time from initialize() to the first decoded frame, and until initialize() returns, without and
+// with the player pool (see WinVideoPlayerController.setPlayerPoolSize). Runs on Windows, on a local file:
+//
+//   flutter test integration_test/open_latency_test.dart -d windows --dart-define=VIDEO=E:\test.mp4
+
+import 'dart:io';
+
+import 'package:flutter_test/flutter_test.dart';
+import 'package:integration_test/integration_test.dart';
+import 'package:video_player_win/video_player_win.dart';
+
+const String videoPath = String.fromEnvironment("VIDEO");
+const int opensPerRun = 10;
+// the pool is refilled in background after each checkout
+const Duration poolRefillDelay = Duration(milliseconds: 300);
+
+class OpenSample {
+  final WinOpenStats stats;
+  final Duration initialize;
+  const OpenSample(this.stats, this.initialize);
+}
+
+Future<OpenSample?> openToFirstFrame() async {
+  var controller = WinVideoPlayerController.file(File(videoPath));
+  try {
+    var watch = Stopwatch()..start();
+    await controller.initialize();
+    var initialize = watch.elapsed;
+    if (!controller.value.isInitialized) return null;
+    await controller.play();
+    for (int i = 0; i < 500; i++) {
+      var stats = await controller.getOpenStats();
+      if (stats?.firstFrame != null) return OpenSample(stats!, initialize);
+      await Future.delayed(const Duration(milliseconds: 10));
+    }
+    return null;
+  } finally {
+    await controller.dispose();
+    await Future.delayed(poolRefillDelay);
+  }
+}
+
+Future<List<OpenSample>> measure(int poolSize) async {
+  await WinVideoPlayerController.setPlayerPoolSize(poolSize);
+  await Future.delayed(poolRefillDelay);
+  await openToFirstFrame(); // the file in the page cache, the codecs loaded
+  var samples = <OpenSample>[];
+  for (int i = 0; i < opensPerRun; i++) {
+    var sample = await openToFirstFrame();
+    expect(sample, isNotNull);
+    expect(sample!.stats.isPooled, poolSize > 0);
+    samples.add(sample);
+  }
+  return samples;
+}
+
+String summary(List<int> us) {
+  double ms(int us) => us / 1000.0;
+  us.sort();
+  return "median ${ms(us[us.length ~/ 2]).toStringAsFixed(1)} ms, "
+      "min ${ms(us.first).toStringAsFixed(1)} ms, max ${ms(us.last).toStringAsFixed(1)} ms";
+}
+
+String report(String name, List<OpenSample> samples) {
+  return "$name first frame: ${summary([for (var s in samples) s.stats.firstFrame!.inMicroseconds])}\n"
+      "$name initialize:  ${summary([for (var s in samples) s.initialize.inMicroseconds])}";
+}
+
+void main() {
+  IntegrationTestWidgetsFlutterBinding.ensureInitialized();
+
+  testWidgets("open to first frame, with and without the pool", (tester) async {
+    final unpooled = await measure(0);
+    final pooled = await measure(2);
+    await WinVideoPlayerController.setPlayerPoolSize(0);
+    // ignore: avoid_print
+    print("${report("no pool:  ", unpooled)}\n${report("pool of 2:", pooled)}");
+  }, skip: videoPath.isEmpty);
+}
@@ -1,14 +1,463 @@
 export 'video_player_win_plugin.dart';
 import 'dart:async';
 import 'dart:developer';
+import 'dart:ffi' as ffi;
 import 'dart:io';
+import 'dart:typed_data';
+import 'dart:ui' as ui;
 
 import 'package:flutter/material.dart';
 import 'package:flutter/services.dart';
 import 'package:video_player_platform_interface/video_player_platform_interface.dart';
 import 'video_player_win_platform_interface.dart';
 
-enum WinDataSourceType { asset, network, file, contentUri }
+enum WinDataSourceType { asset, network, file, contentUri, memory }
+
+/// How [WinVideoPlayerController.seekTo] picks the position.
+/// Keyframe modes are fast, but only supported for local MP4 / MOV files
+/// (other sources always seek accurately).
+enum WinSeekMode {
+  /// decode from the previous keyframe, and show the exact frame of the target position
+  accurate,
+  /// snap to the keyframe at or before the target position
+  previousKeyframe,
+  /// snap to the keyframe closest to the target position
+  nearestKeyframe,
+}
+
+/// Container metadata of a media file, see [WinVideoPlayerController.probe]
+@immutable
+class WinMediaInfo {
+  final Duration duration;
+  final Size size;
+  /// frames per second, 0 if unknown
+  final double frameRate;
+  /// FOURCC of the video codec (ex. 'H264', 'HEVC', 'AV01', 'VP90'), empty if unknown
+  final String videoCodec;
+  /// Media Foundation audio subtype id (ex. 0x1610 = AAC), 0 if unknown
+  final int audioCodec;
+  final int videoStreams;
+  final int audioStreams;
+
+  const WinMediaInfo({
+    required this.duration,
+    required this.size,
+    required this.frameRate,
+    required this.videoCodec,
+    required this.audioCodec,
+    required this.videoStreams,
+    required this.audioStreams,
+  });
+
+  factory WinMediaInfo.fromMap(Map<dynamic, dynamic> map) {
+    int fpsDen = map["frameRateDenominator"] ?? 0;
+    int codec = map["videoCodec"] ?? 0;
+    return WinMediaInfo(
+      duration: Duration(milliseconds: map["duration"] ?? 0),
+      size: Size((map["videoWidth"] ?? 0).toDouble(), (map["videoHeight"] ?? 0).toDouble()),
+      frameRate: fpsDen == 0 ? 0 : (map["frameRateNumerator"] ?? 0) / fpsDen,
+      videoCodec: codec == 0 ? "" : String.fromCharCodes([codec & 0xFF, (codec >> 8) & 0xFF, (codec >> 16) & 0xFF, (codec >> 24) & 0xFF]),
+      audioCodec: map["audioCodec"] ?? 0,
+      videoStreams: map["videoStreams"] ?? 0,
+      audioStreams: map["audioStreams"] ?? 0,
+    );
+  }
+
+  @override
+  String toString() {
+    return "WinMediaInfo(duration: $duration, size: $size, frameRate: $frameRate, videoCodec: $videoCodec, "
+        "audioCodec: 0x${audioCodec.toRadixString(16)}, videoStreams: $videoStreams, audioStreams: $audioStreams)";
+  }
+}
+
+/// One entry of a gapless playlist, see [WinVideoPlayerController.playlist].
+/// [start] / [end] trim the file (edit list), [end] = null plays until the end of the file.
+@immutable
+class WinPlaylistItem {
+  final String path;
+  final Duration start;
+  final Duration? end;
+
+  const WinPlaylistItem(this.path, {this.start = Duration.zero, this.end});
+}
+
+/// Transition metrics of a playlist, see [WinVideoPlayerController.getPlaylistStats]
+@immutable
+class WinPlaylistStats {
+  final int index;
+  /// items started right at the end of the previous one
+  final int transitions;
+  /// items which were not ready at the boundary (the preroll was too short)
+  final int lateTransitions;
+  /// longest frame interval around the last transition, beyond the usual one (0 = seamless)
+  final double lastGapMs;
+  final double maxGapMs;
+  /// time to open the last prepared item
+  final double lastPrepareMs;
+
+  const WinPlaylistStats({
+    required this.index,
+    required this.transitions,
+    required this.lateTransitions,
+    required this.lastGapMs,
+    required this.maxGapMs,
+    required this.lastPrepareMs,
+  });
+
+  factory WinPlaylistStats.fromMap(Map<dynamic, dynamic> map) {
+    return WinPlaylistStats(
+      index: map["index"] ?? 0,
+      transitions: map["transitions"] ?? 0,
+      lateTransitions: map["lateTransitions"] ?? 0,
+      lastGapMs: map["lastGapMs"] ?? 0.0,
+      maxGapMs: map["maxGapMs"] ?? 0.0,
+      lastPrepareMs: map["lastPrepareMs"] ?? 0.0,
+    );
+  }
+
+  @override
+  String toString() {
+    return "WinPlaylistStats(index: $index, transitions: $transitions, lateTransitions: $lateTransitions, "
+        "lastGapMs: $lastGapMs, maxGapMs: $maxGapMs, lastPrepareMs: $lastPrepareMs)";
+  }
+}
+
+/// Read-ahead of a local file, see [WinVideoPlayerController.getReadAheadStats]
+@immutable
+class WinReadAheadStats {
+  final int reads;
+  final int bytesRead;
+  /// reads not following the previous one
+  final int seeks;
+  /// reads which waited for the drive
+  final int stalls;
+  final double stallMs;
+  final double maxStallMs;
+  /// read from the drive by the read-ahead (0 when memory-mapped)
+  final int ioBytes;
+  final bool isMapped;
+
+  const WinReadAheadStats({
+    required this.reads,
+    required this.bytesRead,
+    required this.seeks,
+    required this.stalls,
+    required this.stallMs,
+    required this.maxStallMs,
+    required this.ioBytes,
+    required this.isMapped,
+  });
+
+  factory WinReadAheadStats.fromMap(Map<dynamic, dynamic> map) {
+    return WinReadAheadStats(
+      reads: map["reads"] ?? 0,
+      bytesRead: map["bytesRead"] ?? 0,
+      seeks: map["seeks"] ?? 0,
+      stalls: map["stalls"] ?? 0,
+      stallMs: map["stallMs"] ?? 0.0,
+      maxStallMs: map["maxStallMs"] ?? 0.0,
+      ioBytes: map["ioBytes"] ?? 0,
+      isMapped: map["isMapped"] ?? false,
+    );
+  }
+
+  @override
+  String toString() {
+    return "WinReadAheadStats(reads: $reads, bytesRead: $bytesRead, seeks: $seeks, stalls: $stalls, "
+        "stallMs: $stallMs, maxStallMs: $maxStallMs, ioBytes: $ioBytes, isMapped: $isMapped)";
+  }
+}
+
+/// Decoded-GOP cache of frame stepping, see [WinVideoPlayerController.getFrameStepStats]
+@immutable
+class WinFrameStepStats {
+  /// steps shown at once from the cache
+  final int hits;
+  /// steps which waited for their GOP to be decoded
+  final int misses;
+  final int evictedGops;
+  final int gopCount;
+  final int usedBytes;
+
+  const WinFrameStepStats({
+    required this.hits,
+    required this.misses,
+    required this.evictedGops,
+    required this.gopCount,
+    required this.usedBytes,
+  });
+
+  factory WinFrameStepStats.fromMap(Map<dynamic, dynamic> map) {
+    return WinFrameStepStats(
+      hits: map["hits"] ?? 0,
+      misses: map["misses"] ?? 0,
+      evictedGops: map["evictedGops"] ?? 0,
+      gopCount: map["gopCount"] ?? 0,
+      usedBytes: map["usedBytes"] ?? 0,
+    );
+  }
+
+  @override
+  String toString() {
+    return "WinFrameStepStats(hits: $hits, misses: $misses, evictedGops: $evictedGops, gopCount: $gopCount, "
+        "usedBytes: $usedBytes)";
+  }
+}
+
+/// Adaptive streaming state of an HLS source, see [WinVideoPlayerController.getHlsStats]
+@immutable
+class WinHlsStats {
+  final int variantCount;
+  /// variant being fetched, by bandwidth (0 = lowest)
+  final int variant;
+  /// its declared bandwidth in bits per second, 0 for a media playlist opened directly
+  final int bandwidth;
+  final int width;
+  final int height;
+  /// measured throughput, in bits per second
+  final int estimateBps;
+  final int switches;
+  final int segmentsFetched;
+  final int fetchFailures;
+  /// segments downloaded and not read yet
+  final int pooledBytes;
+  final Duration buffered;
+  final bool isLive;
+
+  const WinHlsStats({
+    required this.variantCount,
+    required this.variant,
+    required this.bandwidth,
+    required this.width,
+    required this.height,
+    required this.estimateBps,
+    required this.switches,
+    required this.segmentsFetched,
+    required this.fetchFailures,
+    required this.pooledBytes,
+    required this.buffered,
+    required this.isLive,
+  });
+
+  factory WinHlsStats.fromMap(Map<dynamic, dynamic> map) {
+    return WinHlsStats(
+      variantCount: map["variantCount"] ?? 0,
+      variant: map["variant"] ?? -1,
+      bandwidth: map["bandwidth"] ?? 0,
+      width: map["width"] ?? 0,
+      height: map["height"] ?? 0,
+      estimateBps: map["estimateBps"] ?? 0,
+      switches: map["switches"] ?? 0,
+      segmentsFetched: map["segmentsFetched"] ?? 0,
+      fetchFailures: map["fetchFailures"] ?? 0,
+      pooledBytes: map["pooledBytes"] ?? 0,
+      buffered: Duration(milliseconds: map["bufferedMs"] ?? 0),
+      isLive: map["isLive"] ?? false,
+    );
+  }
+
+  @override
+  String toString() {
+    return "WinHlsStats(variant: $variant/$variantCount, bandwidth: $bandwidth, size: ${width}x$height, "
+        "estimateBps: $estimateBps, switches: $switches, segmentsFetched: $segmentsFetched, "
+        "fetchFailures: $fetchFailures, pooledBytes: $pooledBytes, buffered: $buffered, isLive: $isLive)";
+  }
+}
+
+/// Open latency of a player, see [WinVideoPlayerController.getOpenStats]
+@immutable
+class WinOpenStats {
+  /// from [WinVideoPlayerController.initialize] to the first frame on the texture, null if no frame yet
+  final Duration? firstFrame;
+  /// the player came from the pool, see [WinVideoPlayerController.setPlayerPoolSize]
+  final bool isPooled;
+
+  const WinOpenStats({this.firstFrame, required this.isPooled});
+
+  factory WinOpenStats.fromMap(Map<dynamic, dynamic> map) {
+    int ms = map["firstFrameMs"] ?? -1;
+    return WinOpenStats(firstFrame: ms < 0 ? null : Duration(milliseconds: ms), isPooled: map["isPooled"] ?? false);
+  }
+
+  @override
+  String toString() => "WinOpenStats(firstFrame: $firstFrame, isPooled: $isPooled)";
+}
+
+/// Share of the frame budget a player gets when all players together need more CPU than
+/// the budget, see [WinVideoPlayerController.setPriority]. Lower priorities are degraded first.
+enum WinFramePriority { background, visible, focused }
+
+/// How the frame budget was allocated to a player, see [WinVideoPlayerController.getFrameBudgetStats]
+@immutable
+class WinFrameBudgetStats {
+  final WinFramePriority priority;
+  final double targetFps;
+  /// frames decoded per second
+  final double offeredFps;
+  /// frames shown per second, granted by the budget
+  final double allowedFps;
+  /// output size divisor: 1 full size, 2 half, 4 quarter
+  final int scale;
+  /// conversion time of a frame at [scale]
+  final Duration cost;
+  final int acceptedFrames;
+  final int droppedFrames;
+  final int scaledFrames;
+  /// conversion time per second: budget of all the players, needed by all of them, and granted
+  final Duration budget;
+  final Duration demand;
+  final Duration granted;
+
+  const WinFrameBudgetStats({required this.priority, required this.targetFps, required this.offeredFps, required this.allowedFps,
+      required this.scale, required this.cost, required this.acceptedFrames, required this.droppedFrames, required this.scaledFrames,
+      required this.budget, required this.demand, required this.granted});
+
+  factory WinFrameBudgetStats.fromMap(Map<dynamic, dynamic> map) {
+    int priority = map["priority"] ?? 1;
+    return WinFrameBudgetStats(
+      priority: WinFramePriority.values[priority.clamp(0, WinFramePriority.values.length - 1)],
+      targetFps: map["targetFps"] ?? 0.0,
+      offeredFps: map["offeredFps"] ?? 0.0,
+      allowedFps: map["allowedFps"] ?? 0.0,
+      scale: map["scale"] ?? 1,
+      cost: Duration(microseconds: map["costUs"] ?? 0),
+      acceptedFrames: map["acceptedFrames"] ?? 0,
+      droppedFrames: map["droppedFrames"] ?? 0,
+      scaledFrames: map["scaledFrames"] ?? 0,
+      budget: Duration(microseconds: map["budgetUs"] ?? 0),
+      demand: Duration(microseconds: map["demandUs"] ?? 0),
+      granted: Duration(microseconds: map["grantedUs"] ?? 0),
+    );
+  }
+
+  @override
+  String toString() {
+    return "WinFrameBudgetStats(priority: $priority, targetFps: $targetFps, offeredFps: $offeredFps, allowedFps: $allowedFps, "
+        "scale: $scale, cost: $cost, acceptedFrames: $acceptedFrames, droppedFrames: $droppedFrames, scaledFrames: $scaledFrames, "
+        "budget: $budget, demand: $demand, granted: $granted)";
+  }
+}
+
+/// Frames presented on time, late and dropped by the DX11 renderer's scheduler, see [WinVideoPlayerController.getSchedulerStats]
+@immutable
+class WinSchedulerStats {
+  final int presented;
+  /// presented after their window (more than 1/4 frame late)
+  final int late;
+  /// later than the drop threshold, see [WinVideoPlayerController.setDropThreshold]
+  final int dropped;
+  /// of the late and dropped frames
+  final Duration maxLateness;
+  final Duration totalLateness;
+  /// last lag reported to the decoder, for it to skip frames
+  final Duration lag;
+  final int lagReports;
+
+  const WinSchedulerStats({required this.presented, required this.late, required this.dropped,
+      required this.maxLateness, required this.totalLateness, required this.lag, required this.lagReports});
+
+  factory WinSchedulerStats.fromMap(Map<dynamic, dynamic> map) {
+    return WinSchedulerStats(
+      presented: map["presented"] ?? 0,
+      late: map["late"] ?? 0,
+      dropped: map["dropped"] ?? 0,
+      maxLateness: Duration(microseconds: map["maxLatenessUs"] ?? 0),
+      totalLateness: Duration(microseconds: map["totalLatenessUs"] ?? 0),
+      lag: Duration(microseconds: map["lagUs"] ?? 0),
+      lagReports: map["lagReports"] ?? 0,
+    );
+  }
+
+  @override
+  String toString() {
+    return "WinSchedulerStats(presented: $presented, late: $late, dropped: $dropped, maxLateness: $maxLateness, "
+        "totalLateness: $totalLateness, lag: $lag, lagReports: $lagReports)";
+  }
+}
+
+/// Adaptive depth of the DX11 renderer's sample queue, see [WinVideoPlayerController.getSampleQueueStats]
+@immutable
+class WinSampleQueueStats {
+  /// samples kept in flight (queued + requested from the decoder), between [minDepth] and [maxDepth]
+  final int depth;
+  final int minDepth;
+  final int maxDepth;
+  /// smoothed deviation of the arrival interval from the frame interval
+  final Duration jitter;
+  final int arrivals;
+  /// the queue was full: the decoder is ahead
+  final int fullArrivals;
+  /// the queue was empty: the renderer was waiting for the decoder
+  final int emptyArrivals;
+  final double averageOccupancy;
+  final int grows;
+  final int shrinks;
+
+  const WinSampleQueueStats({required this.depth, required this.minDepth, required this.maxDepth, required this.jitter,
+      required this.arrivals, required this.fullArrivals, required this.emptyArrivals, required this.averageOccupancy,
+      required this.grows, required this.shrinks});
+
+  factory WinSampleQueueStats.fromMap(Map<dynamic, dynamic> map) {
+    return WinSampleQueueStats(
+      depth: map["depth"] ?? 0,
+      minDepth: map["minDepth"] ?? 0,
+      maxDepth: map["maxDepth"] ?? 0,
+      jitter: Duration(microseconds: map["jitterUs"] ?? 0),
+      arrivals: map["arrivals"] ?? 0,
+      fullArrivals: map["fullArrivals"] ?? 0,
+      emptyArrivals: map["emptyArrivals"] ?? 0,
+      averageOccupancy: map["averageOccupancy"] ?? 0.0,
+      grows: map["grows"] ?? 0,
+      shrinks: map["shrinks"] ?? 0,
+    );
+  }
+
+  @override
+  String toString() {
+    return "WinSampleQueueStats(depth: $depth, minDepth: $minDepth, maxDepth: $maxDepth, jitter: $jitter, arrivals: $arrivals, "
+        "fullArrivals: $fullArrivals, emptyArrivals: $emptyArrivals, averageOccupancy: $averageOccupancy, grows: $grows, shrinks: $shrinks)";
+  }
+}
+
+/// Preview thumbnails packed in one RGBA image, see [WinVideoPlayerController.getThumbnails]
+class WinThumbnailSheet {
+  final int thumbWidth;
+  final int thumbHeight;
+  final int columns;
+  final int rows;
+  /// real position of each tile (the keyframe near the requested position), null if the tile is empty
+  final List<Duration?> positions;
+  /// RGBA pixels of the whole sheet, [width] x [height]
+  final Uint8List pixels;
+
+  int get width => thumbWidth * columns;
+  int get height => thumbHeight * rows;
+
+  WinThumbnailSheet._(this.thumbWidth, this.thumbHeight, this.columns, this.rows, this.positions, this.pixels);
+
+  factory WinThumbnailSheet.fromMap(Map<dynamic, dynamic> map) {
+    return WinThumbnailSheet._(
+      map["thumbWidth"],
+      map["thumbHeight"],
+      map["columns"],
+      map["rows"],
+      (map["times"] as List).map((ms) => ms < 0 ? null : Duration(milliseconds: ms)).toList(),
+      map["pixels"],
+    );
+  }
+
+  /// source rect of tile [index] in the sheet image
+  Rect tileRect(int index) {
+    return Rect.fromLTWH(((index % columns) * thumbWidth).toDouble(), ((index ~/ columns) * thumbHeight).toDouble(),
+        thumbWidth.toDouble(), thumbHeight.toDouble());
+  }
+
+  Future<ui.Image> toImage() {
+    final completer = Completer<ui.Image>();
+    ui.decodeImageFromPixels(pixels, width, height, ui.PixelFormat.rgba8888, completer.complete);
+    return completer.future;
+  }
+}
 
 @immutable
 class WinVideoPlayerValue {
@@ -22,6 +471,10 @@ class WinVideoPlayerValue {
   final Duration position;
   final Size size;
   final double volume;
+  /// item on screen, for a playlist
+  final int playlistIndex;
+  /// parts of a network source already downloaded (read-ahead and disk cache), see [WinVideoPlayerController.setHttpCache]
+  final List<DurationRange> buffered;
 
   final String? errorDescription;
   bool get hasError => errorDescription != null;
@@ -37,7 +490,7 @@ class WinVideoPlayerValue {
     this.position = Duration.zero,
     //Caption caption = Caption.none,
     //Duration captionOffset = Duration.zero,
-    //List<DurationRange> buffered = const <DurationRange>[],
+    this.buffered = const <DurationRange>[],
     this.isInitialized = false,
     this.isPlaying = false,
     this.isLooping = false,
@@ -45,6 +498,7 @@ class WinVideoPlayerValue {
     this.isCompleted = false,
     this.volume = 1.0,
     this.playbackSpeed = 1.0,
+    this.playlistIndex = 0,
     //int rotationCorrection = 0,
     this.errorDescription,
   });
@@ -61,6 +515,8 @@ class WinVideoPlayerValue {
     Duration? position,
     Size? size,
     double? volume,
+    int? playlistIndex,
+    List<DurationRange>? buffered,
     String? errorDescription,
   }) {
     return WinVideoPlayerValue(
@@ -75,17 +531,75 @@ class WinVideoPlayerValue {
       position: position ?? this.position,
       size: size ?? this.size,
       volume: volume ?? this.volume,
+      playlistIndex: playlistIndex ?? this.playlistIndex,
+      buffered: buffered ?? this.buffered,
       errorDescription: errorDescription ?? this.errorDescription,
     );
   }
 }
 
+/// One texture showing several players in a grid (video walls): each player draws into its tile
+/// (see [WinVideoPlayerController.setMosaicTile]), and the canvas is published once per [fps] tick,
+/// only if a tile changed. Show it with `Texture(textureId: mosaic.textureId)`.
+class WinVideoMosaic {
+  final int textureId;
+  final int width;
+  final int height;
+  final int columns;
+  final int rows;
+
+  WinVideoMosaic._(this.textureId, this.width, this.height, this.columns, this.rows);
+
+  /// A canvas of [width] x [height] pixels split in [columns] x [rows] tiles (64 at most).
+  /// Returns null if the grid is invalid.
+  static Future<WinVideoMosaic?> create(int width, int height, {required int columns, required int rows, int fps = 30}) async {
+    int textureId = await VideoPlayerWinPlatform.instance.createMosaic(width, height, columns, rows, fps);
+    if (textureId < 0) return null;
+    return WinVideoMosaic._(textureId, width, height, columns, rows);
+  }
+
+  /// Players still drawing into the canvas go back to their own texture.
+  Future<void> dispose() {
+    return VideoPlayerWinPlatform.instance.disposeMosaic(textureId);
+  }
+}
+
+// What the finalizer of a controller releases if it is not disposed
+class _NativeResources {
+  final int textureId; // -1 before the video is opened
+  final String? memoryUrl; // of a [WinVideoPlayerController.bytes] source
+  const _NativeResources(this.textureId, this.memoryUrl);
+}
+
 class WinVideoPlayerController extends ValueNotifier<WinVideoPlayerValue> {
   late final bool _isBridgeMode; // true if used by 'video_player' package
   int textureId_ = -1;
   final String dataSource;
   late final WinDataSourceType dataSourceType;
+  /// items of a gapless playlist, null for a single file
+  final List<WinPlaylistItem>? playlist;
+  /// how long before the end of an item the next one is opened
+  final Duration playlistPreroll;
+  /// reuse the decoding of another controller opened on the same source with [shareDecode],
+  /// the same [outputSize], and used by the same package ([isBridgeMode])
+  final bool shareDecode;
+  /// true if used by 'video_player' package
+  bool get isBridgeMode => _isBridgeMode;
+  /// size of the texture, null for the video size (one side 0 keeps the aspect ratio, never upscaled)
+  final Size? outputSize;
+  /// frames paced, dropped and presented by the DX11 video renderer (on the media clock) instead of the
+  /// sample grabber, then copied to the texture; [outputSize], [shareDecode], mosaics, frame stepping and
+  /// the loop frame cache are not available with it
+  final bool dx11Renderer;
+  /// of a [WinVideoPlayerController.bytes] source: copied to native memory by [initialize], then played as [_memoryUrl]
+  Uint8List? _bytes;
+  final String _formatHint;
+  String? _memoryUrl;
   bool _isLooping = false;
+  int _frameCacheMB = 128;
+  bool _compressFrameCache = true;
+  double _thinningSpeed = 4;
+  bool _isThinned = false;
 
   // used by flutter official "video_player" package
   final _eventStreamController = StreamController<VideoEvent>();
@@ -97,28 +611,119 @@ class WinVideoPlayerController extends ValueNotifier<WinVideoPlayerValue> {
     return Duration(milliseconds: pos);
   }
 
-  WinVideoPlayerController._(this.dataSource, this.dataSourceType, {bool isBridgeMode = false}) : super(WinVideoPlayerValue()) {
+  WinVideoPlayerController._(this.dataSource, this.dataSourceType,
+      {bool isBridgeMode = false, this.playlist, this.playlistPreroll = const Duration(seconds: 3),
+      this.shareDecode = false, this.outputSize, this.dx11Renderer = false, Uint8List? bytes, String formatHint = "mp4"})
+      : _bytes = bytes,
+        _formatHint = formatHint,
+        super(WinVideoPlayerValue()) {
     if (dataSourceType == WinDataSourceType.contentUri) {
       throw UnsupportedError("VideoPlayerController.contentUri() not supported in Windows");
     }
-    if (dataSourceType == WinDataSourceType.asset) {
-      throw UnsupportedError("VideoPlayerController.asset() not implement yet.");
-    }
 
     _isBridgeMode = isBridgeMode;
     //VideoPlayerWinPlatform.instance.registerPlayer(_textureId, this);
   }
-  static final Finalizer<int> _finalizer = Finalizer((textureId) {
+  static final Finalizer<_NativeResources> _finalizer = Finalizer((resources) {
     log("[video_player_win] gc free a player that didn't dispose() yet !!!!!");
-    VideoPlayerWinPlatform.instance.unregisterPlayer(textureId);
-    VideoPlayerWinPlatform.instance.dispose(textureId);
+    if (resources.textureId != -1) {
+      VideoPlayerWinPlatform.instance.unregisterPlayer(resources.textureId);
+      VideoPlayerWinPlatform.instance.dispose(resources.textureId);
+    }
+    if (resources.memoryUrl != null) VideoPlayerWinPlatform.instance.releaseMemorySource(resources.memoryUrl!);
   });
 
-  WinVideoPlayerController.file(File file, {bool isBridgeMode = false}) : this._(file.path, WinDataSourceType.file, isBridgeMode: isBridgeMode);
-  WinVideoPlayerController.network(String dataSource, {bool isBridgeMode = false}) : this._(dataSource, WinDataSourceType.network, isBridgeMode: isBridgeMode);
-  WinVideoPlayerController.asset(String dataSource, {String? package}) : this._(dataSource, WinDataSourceType.asset);
+  /// Reads duration / video size of local files in background, and keeps them in a persisted index,
+  /// so later [initialize] of these files completes without waiting for the decoder pipeline.
+  /// Returns the number of newly indexed files.
+  static Future<int> prewarmMetadata(List<String> paths) {
+    return VideoPlayerWinPlatform.instance.prewarmMetadata(paths);
+  }
+
+  /// Keeps [size] players constructed, so [initialize] starts loading at once. The pool is filled in background,
+  /// and refilled after each [initialize]; disposed players go back to it. 0 (the default) disables the pool.
+  /// See `example/integration_test/open_latency_test.dart` for the open latency with and without it.
+  static Future<void> setPlayerPoolSize(int size) {
+    return VideoPlayerWinPlatform.instance.setPlayerPoolSize(size);
+  }
+
+  /// CPU time per second all the players may spend converting frames, null for the default (half of the cores).
+  /// Over budget, players of lower [WinFramePriority] get smaller frames, then fewer frames.
+  static Future<void> setFrameBudget(Duration? perSecond) {
+    return VideoPlayerWinPlatform.instance.setFrameBudget(perSecond?.inMicroseconds ?? 0);
+  }
+
+  /// Network sources (http / https) are read by range requests: [readAheadBytes] past the playback position
+  /// are downloaded ahead, and everything downloaded is kept in a disk cache of [cacheBytes] (0: no cache),
+  /// so a replay or a seek back is served locally. Applies to the sources opened afterwards.
+  /// With [enabled] false, or a server without range support, the Media Foundation network source is used.
+  static Future<void> setHttpCache({bool enabled = true, int readAheadBytes = 8 << 20, int cacheBytes = 512 << 20}) {
+    return VideoPlayerWinPlatform.instance.setHttpCache(enabled, readAheadBytes, cacheBytes);
+  }
+
+  /// Local files (also on network shares) are read by an I/O thread [readAheadBytes] ahead of playback, in large
+  /// sequential reads, so a slow drive doesn't stall playback. With [memoryMap] (SSDs) the file is mapped in memory
+  /// instead. Applies to the files opened afterwards; with [enabled] false, Media Foundation reads the file itself.
+  static Future<void> setFileReadAhead({bool enabled = true, int readAheadBytes = 16 << 20, bool memoryMap = false}) {
+    return VideoPlayerWinPlatform.instance.setFileReadAhead(enabled, readAheadBytes, memoryMap);
+  }
+
+  /// HLS playlists (.m3u8 urls) are played by a built-in client: up to [parallelFetches] segments are downloaded
+  /// at once, at most [maxPoolBytes] and [maxAhead] ahead of playback, each from the variant the measured
+  /// throughput allows ([initialBps] picks the first one). Applies to the playlists opened afterwards.
+  /// Seeking is not supported within these sources.
+  static Future<void> setHlsOptions({int parallelFetches = 3, int maxPoolBytes = 32 << 20,
+      Duration maxAhead = const Duration(seconds: 30), int initialBps = 1000000}) {
+    return VideoPlayerWinPlatform.instance.setHlsOptions(parallelFetches, maxPoolBytes, maxAhead.inMilliseconds, initialBps);
+  }
+
+  /// Read duration, video size, frame rate and codecs of a local file without opening a player.
+  /// MP4 / MOV / MKV / WebM headers are parsed directly, other formats go through Media Foundation.
+  /// Returns null if the file can't be read.
+  static Future<WinMediaInfo?> probe(String path) {
+    return VideoPlayerWinPlatform.instance.probe(path);
+  }
+
+  /// Extract preview thumbnails of a local file, at [positions] or every [interval], into one sprite sheet.
+  /// Each tile is the keyframe at or before its position, so no player is opened and nothing is decoded
+  /// besides one frame per tile. Sheets are cached on disk, the same request again returns at once.
+  /// [thumbHeight] = 0 keeps the video aspect ratio. Returns null if the file can't be decoded.
+  static Future<WinThumbnailSheet?> getThumbnails(String path,
+      {List<Duration>? positions, Duration interval = const Duration(seconds: 10),
+      int thumbWidth = 160, int thumbHeight = 0, int columns = 10}) async {
+    if (positions == null) {
+      var info = await probe(path);
+      if (info == null || interval <= Duration.zero) return null;
+      positions = [for (var t = Duration.zero; t < info.duration; t += interval) t];
+    }
+    if (positions.isEmpty) return null;
+    return VideoPlayerWinPlatform.instance.getThumbnails(path, positions, thumbWidth, thumbHeight, columns);
+  }
+
+  /// With [shareDecode], controllers of the same source (ex. a large view and its thumbnail) share one decoder:
+  /// each has its own texture of [outputSize], but play / pause / seek / volume apply to all of them.
+  /// With [dx11Renderer], frames are presented by the DX11 video renderer, see [WinVideoPlayerController.dx11Renderer].
+  WinVideoPlayerController.file(File file, {bool isBridgeMode = false, bool shareDecode = false, Size? outputSize, bool dx11Renderer = false})
+      : this._(file.path, WinDataSourceType.file,
+            isBridgeMode: isBridgeMode, shareDecode: shareDecode, outputSize: outputSize, dx11Renderer: dx11Renderer);
+  WinVideoPlayerController.network(String dataSource, {bool isBridgeMode = false, bool shareDecode = false, Size? outputSize, bool dx11Renderer = false})
+      : this._(dataSource, WinDataSourceType.network,
+            isBridgeMode: isBridgeMode, shareDecode: shareDecode, outputSize: outputSize, dx11Renderer: dx11Renderer);
+  /// Played straight from the asset file mapped in memory, without a copy to a temporary file.
+  WinVideoPlayerController.asset(String dataSource, {String? package, bool isBridgeMode = false})
+      : this._(package == null ? "asset://$dataSource" : "asset://packages/$package/$dataSource", WinDataSourceType.asset, isBridgeMode: isBridgeMode);
+  /// Plays [bytes] from memory, seekable like a file. They are copied once into native memory by [initialize]
+  /// (not through the platform channel), and freed by [dispose]. [formatHint] is the extension of the format.
+  WinVideoPlayerController.bytes(Uint8List bytes, {String formatHint = "mp4"})
+      : this._("", WinDataSourceType.memory, bytes: bytes, formatHint: formatHint);
   WinVideoPlayerController.contentUri(Uri contentUri) : this._("", WinDataSourceType.contentUri);
 
+  /// Plays local files one after the other on the same texture, without any gap: each next item is opened
+  /// [preroll] before the end of the current one, and starts at the exact end of it.
+  /// Position and duration are those of the whole playlist, [WinVideoPlayerValue.playlistIndex] is the item on screen.
+  WinVideoPlayerController.playlist(List<WinPlaylistItem> items, {Duration preroll = const Duration(seconds: 3), bool isBridgeMode = false})
+      : this._(items.first.path, WinDataSourceType.file, isBridgeMode: isBridgeMode, playlist: List.unmodifiable(items), playlistPreroll: preroll);
+
   Timer? _positionTimer;
   void _cancelTrackingPosition() => _positionTimer?.cancel();
   void _startTrackingPosition() async {
@@ -138,6 +743,19 @@ class WinVideoPlayerController extends ValueNotifier<WinVideoPlayerValue> {
     });
   }
 
+  void onPlaylistItem_(int index) {
+    value = value.copyWith(playlistIndex: index);
+  }
+
+  void onBufferedRanges_(List<int> ranges) {
+    var buffered = <DurationRange>[
+      for (int i = 0; i + 1 < ranges.length; i += 2)
+        DurationRange(Duration(milliseconds: ranges[i]), Duration(milliseconds: ranges[i + 1])),
+    ];
+    value = value.copyWith(buffered: buffered);
+    _eventStreamController.add(VideoEvent(eventType: VideoEventType.bufferingUpdate, buffered: buffered));
+  }
+
   void onPlaybackEvent_(int state) {
     switch (state) {
       // MediaEventType in win32 api
@@ -190,16 +808,33 @@ class WinVideoPlayerController extends ValueNotifier<WinVideoPlayerValue> {
   }
 
   Future<void> initialize() async {
-    WinVideoPlayerValue? pv = await VideoPlayerWinPlatform.instance.openVideo(this, textureId_, dataSource);
+    if (_bytes != null) {
+      _memoryUrl = await _copyToNativeMemory(_bytes!, _formatHint);
+      _bytes = null;
+      if (_memoryUrl != null) _finalizer.attach(this, _NativeResources(-1, _memoryUrl), detach: this);
+    }
+    WinVideoPlayerValue? pv = dataSourceType == WinDataSourceType.memory && _memoryUrl == null
+        ? null
+        : await VideoPlayerWinPlatform.instance.openVideo(this, textureId_, _memoryUrl ?? dataSource);
     if (pv == null) {
       log("[video_player_win] controller intialize (open video) failed");
+      if (_memoryUrl != null) {
+        _finalizer.detach(this);
+        await VideoPlayerWinPlatform.instance.releaseMemorySource(_memoryUrl!);
+        _memoryUrl = null;
+      }
       value = value.copyWith(isInitialized: false, errorDescription: "open file failed");
       _eventStreamController.add(VideoEvent(eventType: VideoEventType.initialized, duration: null, size: null));
       return;
     }
     textureId_ = pv.textureId;
-    value = pv;
-    _finalizer.attach(this, textureId_, detach: this);
+    value = pv.copyWith(isLooping: _isLooping);
+    _finalizer.detach(this);
+    _finalizer.attach(this, _NativeResources(textureId_, _memoryUrl), detach: this);
+    if (pv.isPlaying) _startTrackingPosition(); // attached to a shared decoder already playing
+    if (_isLooping) {
+      VideoPlayerWinPlatform.instance.setLooping(textureId_, true, _frameCacheMB * 1024 * 1024, _compressFrameCache);
+    }
 
     _eventStreamController.add(VideoEvent(
       eventType: VideoEventType.initialized,
@@ -219,10 +854,11 @@ class WinVideoPlayerController extends ValueNotifier<WinVideoPlayerValue> {
     await VideoPlayerWinPlatform.instance.pause(textureId_);
   }
 
-  Future<void> seekTo(Duration time) async {
+  Future<void> seekTo(Duration time, {WinSeekMode mode = WinSeekMode.accurate}) async {
     if (!value.isInitialized) throw ArgumentError("video file not opened yet");
 
-    await VideoPlayerWinPlatform.instance.seekTo(textureId_, time.inMilliseconds);
+    int? actualMs = await VideoPlayerWinPlatform.instance.seekTo(textureId_, time.inMilliseconds, mode);
+    if (actualMs != null && actualMs >= 0) time = Duration(milliseconds: actualMs);
     value = value.copyWith(position: time, isCompleted: false);
   }
 
@@ -236,27 +872,176 @@ class WinVideoPlayerController extends ValueNotifier<WinVideoPlayerValue> {
     return pos;
   }
 
+  /// From the thinning speed on (see [setThinning]), only the keyframes are decoded and shown,
+  /// spaced out to match the speed; also below it when the source can't deliver every frame that fast.
   Future<void> setPlaybackSpeed(double speed) async {
     if (!value.isInitialized) throw ArgumentError("video file not opened yet");
-    await VideoPlayerWinPlatform.instance.setPlaybackSpeed(textureId_, speed);
+    _isThinned = await VideoPlayerWinPlatform.instance.setPlaybackSpeed(textureId_, speed, thinningSpeed: _thinningSpeed);
     value = value.copyWith(playbackSpeed: speed);
   }
 
+  /// Keyframe-only trick play from [minSpeed] (4x by default) on, for the next [setPlaybackSpeed].
+  /// [allowed] = false always decodes every frame.
+  void setThinning({bool allowed = true, double minSpeed = 4}) {
+    _thinningSpeed = allowed ? minSpeed : 0;
+  }
+
+  /// Whether the current playback speed shows keyframes only.
+  bool get isThinned => _isThinned;
+
   Future<void> setVolume(double volume) async {
     if (!value.isInitialized) throw ArgumentError("video file not opened yet");
     await VideoPlayerWinPlatform.instance.setVolume(textureId_, volume);
     value = value.copyWith(volume: volume);
   }
 
-  Future<void> setLooping(bool looping) async {
+  /// Loops natively: the clip restarts without waiting for Dart. When the clip has no audio (or is muted),
+  /// the frames of the first pass are kept (compressed) in up to [frameCacheMB] of memory, and the next
+  /// passes are shown from there without decoding. A longer clip is looped by seeking.
+  /// [frameCacheMB] = 0 disables the frame cache.
+  Future<void> setLooping(bool looping, {int frameCacheMB = 128, bool compressFrameCache = true}) async {
     _isLooping = looping;
+    _frameCacheMB = frameCacheMB;
+    _compressFrameCache = compressFrameCache;
     value = value.copyWith(isLooping: looping);
+    if (value.isInitialized) {
+      await VideoPlayerWinPlatform.instance.setLooping(textureId_, looping, frameCacheMB * 1024 * 1024, compressFrameCache);
+    }
+  }
+
+  /// Time from [initialize] to the first frame, and whether the player came from the pool.
+  Future<WinOpenStats?> getOpenStats() async {
+    if (!value.isInitialized) return null;
+    return VideoPlayerWinPlatform.instance.getOpenStats(textureId_);
+  }
+
+  /// Draws the frames into [tile] of [mosaic] instead of the texture of this controller,
+  /// null [mosaic] goes back to the texture. Returns false if the tile doesn't exist.
+  Future<bool> setMosaicTile(WinVideoMosaic? mosaic, int tile) async {
+    if (!value.isInitialized) return false;
+    return VideoPlayerWinPlatform.instance.setMosaicTile(textureId_, mosaic?.textureId ?? -1, tile);
+  }
+
+  /// Priority of this player in the frame budget shared by all players, and the frame rate it is shown at
+  /// (0: 60 focused, 30 visible, 10 background).
+  Future<void> setPriority(WinFramePriority priority, {double fps = 0}) async {
+    if (!value.isInitialized) return;
+    await VideoPlayerWinPlatform.instance.setPriority(textureId_, priority.index, fps);
+  }
+
+  /// How the frame budget was allocated to this player
+  Future<WinFrameBudgetStats?> getFrameBudgetStats() async {
+    if (!value.isInitialized) return null;
+    return VideoPlayerWinPlatform.instance.getFrameBudgetStats(textureId_);
+  }
+
+  /// Lateness, in frames, from which the DX11 renderer drops a frame instead of presenting it (0: never dropped).
+  /// Returns false if the controller is not opened with `dx11Renderer`.
+  Future<bool> setDropThreshold(double frames) async {
+    if (!value.isInitialized) return false;
+    return VideoPlayerWinPlatform.instance.setDropThreshold(textureId_, frames);
+  }
+
+  /// Presented, late and dropped frames of the DX11 renderer, null if the controller is not opened with `dx11Renderer`
+  Future<WinSchedulerStats?> getSchedulerStats() async {
+    if (!value.isInitialized) return null;
+    return VideoPlayerWinPlatform.instance.getSchedulerStats(textureId_);
+  }
+
+  /// Bounds of the adaptive depth of the DX11 renderer's sample queue: a low [maxDepth] for live low-latency
+  /// streams, a high one for jittery networks or 4K decoding. Returns false if the controller is not opened
+  /// with `dx11Renderer`, or if the bounds are not valid.
+  Future<bool> setSampleQueueBounds(int minDepth, int maxDepth) async {
+    if (!value.isInitialized) return false;
+    return VideoPlayerWinPlatform.instance.setSampleQueueBounds(textureId_, minDepth, maxDepth);
+  }
+
+  /// Depth and occupancy of the DX11 renderer's sample queue, null if the controller is not opened with `dx11Renderer`
+  Future<WinSampleQueueStats?> getSampleQueueStats() async {
+    if (!value.isInitialized) return null;
+    return VideoPlayerWinPlatform.instance.getSampleQueueStats(textureId_);
+  }
+
+  /// Transition metrics of a playlist: gap at the boundaries, and items which were not ready in time.
+  Future<WinPlaylistStats?> getPlaylistStats() async {
+    if (!value.isInitialized || playlist == null) return null;
+    return VideoPlayerWinPlatform.instance.getPlaylistStats(textureId_);
+  }
+
+  /// Reads and stalls of a local file source, null for other sources.
+  Future<WinReadAheadStats?> getReadAheadStats() async {
+    if (!value.isInitialized) return null;
+    return VideoPlayerWinPlatform.instance.getReadAheadStats(textureId_);
+  }
+
+  /// Records the arrival time, time stamps and size of every decoded sample (and the clock changes)
+  /// into the binary trace file [path], for pacing experiments with `windows/tools/trace_replay`.
+  /// False if the file can't be created.
+  Future<bool> startSampleTrace(String path) async {
+    if (!value.isInitialized) return false;
+    return VideoPlayerWinPlatform.instance.startSampleTrace(textureId_, path);
+  }
+
+  /// Ends the trace started by [startSampleTrace] (also ended by [dispose]); the count of records.
+  Future<int> stopSampleTrace() async {
+    if (!value.isInitialized) return 0;
+    return VideoPlayerWinPlatform.instance.stopSampleTrace(textureId_);
+  }
+
+  /// Up to [megabytes] of decoded frames kept around the play head for [stepFrame] and [playReverse],
+  /// recorded from now on while playing (256 MB by default, from the first step). 0 disables stepping.
+  Future<void> setFrameStepCache(int megabytes) async {
+    if (!value.isInitialized) return;
+    await VideoPlayerWinPlatform.instance.setFrameStepCache(textureId_, megabytes * 1024 * 1024);
+  }
+
+  /// Pauses and shows the next (or previous) frame. A cached frame is shown at once; otherwise its GOP
+  /// is decoded first (local files only). Returns the position shown, null at the start / end.
+  /// [play] resumes from there.
+  Future<Duration?> stepFrame({bool forward = true}) async {
+    if (!value.isInitialized) throw ArgumentError("video file not opened yet");
+    int? ms = await VideoPlayerWinPlatform.instance.stepFrame(textureId_, forward);
+    if (ms == null || ms < 0) return null;
+    var position = Duration(milliseconds: ms);
+    value = value.copyWith(position: position, isCompleted: false);
+    return position;
+  }
+
+  /// Plays backwards (without sound) from the frame shown, at [speed] times the frame rate, until
+  /// [pause], [play] or the start. The GOPs before the play head are decoded in background.
+  Future<void> playReverse({double speed = 1.0}) async {
+    if (!value.isInitialized) throw ArgumentError("video file not opened yet");
+    await VideoPlayerWinPlatform.instance.playReverse(textureId_, speed);
+  }
+
+  /// Hits and misses of [stepFrame] / [playReverse], null before the first step.
+  Future<WinFrameStepStats?> getFrameStepStats() async {
+    if (!value.isInitialized) return null;
+    return VideoPlayerWinPlatform.instance.getFrameStepStats(textureId_);
+  }
+
+  /// Variant, throughput estimate and download state of an HLS source, null for other sources.
+  Future<WinHlsStats?> getHlsStats() async {
+    if (!value.isInitialized) return null;
+    return VideoPlayerWinPlatform.instance.getHlsStats(textureId_);
+  }
+
+  // The native buffer is filled in place through FFI, the bytes never go through the platform channel
+  static Future<String?> _copyToNativeMemory(Uint8List bytes, String extension) async {
+    var region = await VideoPlayerWinPlatform.instance.allocMemorySource(bytes.length, extension);
+    if (region == null) return null;
+    ffi.Pointer<ffi.Uint8>.fromAddress(region["address"]).asTypedList(bytes.length).setAll(0, bytes);
+    return region["url"];
   }
 
   @override
   Future<void> dispose() async {
     VideoPlayerWinPlatform.instance.unregisterPlayer(textureId_);
     await VideoPlayerWinPlatform.instance.dispose(textureId_);
+    if (_memoryUrl != null) {
+      await VideoPlayerWinPlatform.instance.releaseMemorySource(_memoryUrl!);
+      _memoryUrl = null;
+    }
 
     _finalizer.detach(this);
     _cancelTrackingPosition();
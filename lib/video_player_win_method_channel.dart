@@ -35,6 +35,12 @@ class MethodChannelVideoPlayerWin extends VideoPlayerWinPlatform {
       if (call.method == "OnPlaybackEvent") {
         int state = call.arguments["state"]!;
         player.target?.onPlaybackEvent_(state);
+      } else if (call.method == "OnPlaylistItem") {
+        int index = call.arguments["index"]!;
+        player.target?.onPlaylistItem_(index);
+      } else if (call.method == "OnBufferedRanges") {
+        List<int> ranges = List<int>.from(call.arguments["ranges"]!);
+        player.target?.onBufferedRanges_(ranges);
       } else {
         assert(false, "unknown call from native: ${call.method}");
       }
@@ -53,7 +59,20 @@ class MethodChannelVideoPlayerWin extends VideoPlayerWinPlatform {
 
   @override
   Future<WinVideoPlayerValue?> openVideo(WinVideoPlayerController player, int textureId, String path) async {
-    var arguments = await methodChannel.invokeMethod<Map>('openVideo', {"textureId": -1, "path": path});
+    var arguments = await methodChannel.invokeMethod<Map>('openVideo', {
+      "textureId": -1,
+      "path": path,
+      if (player.playlist != null) "playlist": [
+        for (var item in player.playlist!)
+          {"path": item.path, "startMs": item.start.inMilliseconds, "endMs": item.end?.inMilliseconds ?? 0}
+      ],
+      if (player.playlist != null) "prerollMs": player.playlistPreroll.inMilliseconds,
+      if (player.shareDecode) "shareDecode": true,
+      if (player.shareDecode) "isBridgeMode": player.isBridgeMode,
+      if (player.outputSize != null) "outputWidth": player.outputSize!.width.round(),
+      if (player.outputSize != null) "outputHeight": player.outputSize!.height.round(),
+      if (player.dx11Renderer) "renderer": "dx11",
+    });
     if (arguments == null) return null;
     if (arguments["result"] == false) return null;
 
@@ -66,7 +85,7 @@ class MethodChannelVideoPlayerWin extends VideoPlayerWinPlatform {
       position: Duration.zero,
       duration: Duration(milliseconds: arguments["duration"]),
       size: Size(width.toDouble(), height.toDouble()),
-      isPlaying: false,
+      isPlaying: arguments["isPlaying"] ?? false,
       isInitialized: true,
       volume: volume,
     );
@@ -86,9 +105,9 @@ class MethodChannelVideoPlayerWin extends VideoPlayerWinPlatform {
   }
 
   @override
-  Future<void> seekTo(int textureId, int ms) async {
+  Future<int?> seekTo(int textureId, int ms, [WinSeekMode mode = WinSeekMode.accurate]) async {
     // TODO: will auto play after seek, it seems there is no way to seek without playing in windows media foundation API...
-    await methodChannel.invokeMethod<bool>('seekTo', {"textureId": textureId, "ms": ms});
+    return await methodChannel.invokeMethod<int>('seekTo', {"textureId": textureId, "ms": ms, "mode": mode.index});
   }
 
   @override
@@ -105,8 +124,10 @@ class MethodChannelVideoPlayerWin extends VideoPlayerWinPlatform {
   }
 
   @override
-  Future<void> setPlaybackSpeed(int textureId, double speed) async {
-    await methodChannel.invokeMethod<bool>('setPlaybackSpeed', {"textureId": textureId, "speed": speed});
+  Future<bool> setPlaybackSpeed(int textureId, double speed, {double thinningSpeed = 0}) async {
+    var isThinned = await methodChannel.invokeMethod<bool>(
+        'setPlaybackSpeed', {"textureId": textureId, "speed": speed, "thinningSpeed": thinningSpeed});
+    return isThinned ?? false;
   }
 
   @override
@@ -114,6 +135,200 @@ class MethodChannelVideoPlayerWin extends VideoPlayerWinPlatform {
     await methodChannel.invokeMethod<bool>('setVolume', {"textureId": textureId, "volume": volume});
   }
 
+  @override
+  Future<void> setLooping(int textureId, bool looping, int frameCacheBytes, bool compressFrameCache) async {
+    await methodChannel.invokeMethod<bool>('setLooping', {
+      "textureId": textureId,
+      "looping": looping,
+      "frameCacheBytes": frameCacheBytes,
+      "compressFrameCache": compressFrameCache,
+    });
+  }
+
+  @override
+  Future<int> prewarmMetadata(List<String> paths) async {
+    var count = await methodChannel.invokeMethod<int>('prewarmMetadata', {"paths": paths});
+    return count ?? 0;
+  }
+
+  @override
+  Future<WinMediaInfo?> probe(String path) async {
+    var map = await methodChannel.invokeMethod<Map<dynamic, dynamic>>('probe', {"path": path});
+    if (map == null || map["result"] != true) return null;
+    return WinMediaInfo.fromMap(map);
+  }
+
+  @override
+  Future<WinThumbnailSheet?> getThumbnails(String path, List<Duration> positions, int thumbWidth, int thumbHeight, int columns) async {
+    var map = await methodChannel.invokeMethod<Map<dynamic, dynamic>>('getThumbnails', {
+      "path": path,
+      "times": positions.map((p) => p.inMilliseconds).toList(),
+      "thumbWidth": thumbWidth,
+      "thumbHeight": thumbHeight,
+      "columns": columns,
+    });
+    if (map == null || map["result"] != true) return null;
+    return WinThumbnailSheet.fromMap(map);
+  }
+
+  @override
+  Future<void> setPlayerPoolSize(int size) async {
+    await methodChannel.invokeMethod<bool>('setPlayerPoolSize', {"size": size});
+  }
+
+  @override
+  Future<WinOpenStats?> getOpenStats(int textureId) async {
+    var map = await methodChannel.invokeMethod<Map<dynamic, dynamic>>('getOpenStats', {"textureId": textureId});
+    if (map == null) return null;
+    return WinOpenStats.fromMap(map);
+  }
+
+  @override
+  Future<int> createMosaic(int width, int height, int columns, int rows, int fps) async {
+    var mosaicId = await methodChannel.invokeMethod<int>('createMosaic', {
+      "width": width,
+      "height": height,
+      "columns": columns,
+      "rows": rows,
+      "fps": fps,
+    });
+    return mosaicId ?? -1;
+  }
+
+  @override
+  Future<void> disposeMosaic(int mosaicId) async {
+    await methodChannel.invokeMethod<bool>('disposeMosaic', {"mosaicId": mosaicId});
+  }
+
+  @override
+  Future<bool> setMosaicTile(int textureId, int mosaicId, int tile) async {
+    var result = await methodChannel.invokeMethod<bool>('setMosaicTile', {"textureId": textureId, "mosaicId": mosaicId, "tile": tile});
+    return result ?? false;
+  }
+
+  @override
+  Future<void> setFrameBudget(int budgetUs) async {
+    await methodChannel.invokeMethod<bool>('setFrameBudget', {"budgetUs": budgetUs});
+  }
+
+  @override
+  Future<void> setHttpCache(bool enabled, int readAheadBytes, int cacheBytes) async {
+    await methodChannel.invokeMethod<bool>('setHttpCache', {"enabled": enabled, "readAheadBytes": readAheadBytes, "cacheBytes": cacheBytes});
+  }
+
+  @override
+  Future<Map<dynamic, dynamic>?> allocMemorySource(int size, String extension) async {
+    return await methodChannel.invokeMethod<Map<dynamic, dynamic>>('allocMemorySource', {"size": size, "extension": extension});
+  }
+
+  @override
+  Future<void> releaseMemorySource(String url) async {
+    await methodChannel.invokeMethod<bool>('releaseMemorySource', {"url": url});
+  }
+
+  @override
+  Future<void> setFileReadAhead(bool enabled, int readAheadBytes, bool memoryMap) async {
+    await methodChannel.invokeMethod<bool>('setFileReadAhead', {"enabled": enabled, "readAheadBytes": readAheadBytes, "memoryMap": memoryMap});
+  }
+
+  @override
+  Future<void> setHlsOptions(int parallelFetches, int maxPoolBytes, int maxAheadMs, int initialBps) async {
+    await methodChannel.invokeMethod<bool>('setHlsOptions', {"parallelFetches": parallelFetches, "maxPoolBytes": maxPoolBytes, "maxAheadMs": maxAheadMs, "initialBps": initialBps});
+  }
+
+  @override
+  Future<void> setPriority(int textureId, int priority, double fps) async {
+    await methodChannel.invokeMethod<bool>('setPriority', {"textureId": textureId, "priority": priority, "fps": fps});
+  }
+
+  @override
+  Future<WinFrameBudgetStats?> getFrameBudgetStats(int textureId) async {
+    var map = await methodChannel.invokeMethod<Map<dynamic, dynamic>>('getFrameBudgetStats', {"textureId": textureId});
+    if (map == null) return null;
+    return WinFrameBudgetStats.fromMap(map);
+  }
+
+  @override
+  Future<bool> setDropThreshold(int textureId, double frames) async {
+    var isSet = await methodChannel.invokeMethod<bool>('setDropThreshold', {"textureId": textureId, "frames": frames});
+    return isSet ?? false;
+  }
+
+  @override
+  Future<WinSchedulerStats?> getSchedulerStats(int textureId) async {
+    var map = await methodChannel.invokeMethod<Map<dynamic, dynamic>>('getSchedulerStats', {"textureId": textureId});
+    if (map == null) return null;
+    return WinSchedulerStats.fromMap(map);
+  }
+
+  @override
+  Future<bool> setSampleQueueBounds(int textureId, int minDepth, int maxDepth) async {
+    var isSet = await methodChannel.invokeMethod<bool>('setSampleQueueBounds', {"textureId": textureId, "minDepth": minDepth, "maxDepth": maxDepth});
+    return isSet ?? false;
+  }
+
+  @override
+  Future<WinSampleQueueStats?> getSampleQueueStats(int textureId) async {
+    var map = await methodChannel.invokeMethod<Map<dynamic, dynamic>>('getSampleQueueStats', {"textureId": textureId});
+    if (map == null) return null;
+    return WinSampleQueueStats.fromMap(map);
+  }
+
+  @override
+  Future<WinPlaylistStats?> getPlaylistStats(int textureId) async {
+    var map = await methodChannel.invokeMethod<Map<dynamic, dynamic>>('getPlaylistStats', {"textureId": textureId});
+    if (map == null) return null;
+    return WinPlaylistStats.fromMap(map);
+  }
+
+  @override
+  Future<WinReadAheadStats?> getReadAheadStats(int textureId) async {
+    var map = await methodChannel.invokeMethod<Map<dynamic, dynamic>>('getReadAheadStats', {"textureId": textureId});
+    if (map == null) return null;
+    return WinReadAheadStats.fromMap(map);
+  }
+
+  @override
+  Future<bool> startSampleTrace(int textureId, String path) async {
+    var ok = await methodChannel.invokeMethod<bool>('startSampleTrace', {"textureId": textureId, "path": path});
+    return ok ?? false;
+  }
+
+  @override
+  Future<int> stopSampleTrace(int textureId) async {
+    var count = await methodChannel.invokeMethod<int>('stopSampleTrace', {"textureId": textureId});
+    return count ?? 0;
+  }
+
+  @override
+  Future<WinHlsStats?> getHlsStats(int textureId) async {
+    var map = await methodChannel.invokeMethod<Map<dynamic, dynamic>>('getHlsStats', {"textureId": textureId});
+    if (map == null) return null;
+    return WinHlsStats.fromMap(map);
+  }
+
+  @override
+  Future<void> setFrameStepCache(int textureId, int maxBytes) async {
+    await methodChannel.invokeMethod<bool>('setFrameStepCache', {"textureId": textureId, "maxBytes": maxBytes});
+  }
+
+  @override
+  Future<int?> stepFrame(int textureId, bool forward) async {
+    return await methodChannel.invokeMethod<int>('stepFrame', {"textureId": textureId, "forward": forward});
+  }
+
+  @override
+  Future<bool> playReverse(int textureId, double speed) async {
+    return await methodChannel.invokeMethod<bool>('playReverse', {"textureId": textureId, "speed": speed}) ?? false;
+  }
+
+  @override
+  Future<WinFrameStepStats?> getFrameStepStats(int textureId) async {
+    var map = await methodChannel.invokeMethod<Map<dynamic, dynamic>>('getFrameStepStats', {"textureId": textureId});
+    if (map == null) return null;
+    return WinFrameStepStats.fromMap(map);
+  }
+
   @override
   Future<void> dispose(int textureId) async {
     await methodChannel.invokeMethod<bool>('shutdown', {"textureId": textureId});
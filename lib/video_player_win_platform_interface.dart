@@ -48,7 +48,8 @@ abstract class VideoPlayerWinPlatform extends PlatformInterface {
     throw UnimplementedError('pause() has not been implemented.');
   }
 
-  Future<void> seekTo(int textureId, int ms) {
+  /// returns the position really seeked to, which may snap to a keyframe
+  Future<int?> seekTo(int textureId, int ms, [WinSeekMode mode = WinSeekMode.accurate]) {
     throw UnimplementedError('seekTo() has not been implemented.');
   }
 
@@ -60,7 +61,8 @@ abstract class VideoPlayerWinPlatform extends PlatformInterface {
     throw UnimplementedError('getDuration() has not been implemented.');
   }
 
-  Future<void> setPlaybackSpeed(int textureId, double speed) {
+  // thinningSpeed: keyframes only from that speed on, 0 never; returns true when thinned
+  Future<bool> setPlaybackSpeed(int textureId, double speed, {double thinningSpeed = 0}) {
     throw UnimplementedError('setPlaybackSpeed() has not been implemented.');
   }
 
@@ -69,6 +71,127 @@ abstract class VideoPlayerWinPlatform extends PlatformInterface {
     throw UnimplementedError('setVolume() has not been implemented.');
   }
 
+  Future<void> setLooping(int textureId, bool looping, int frameCacheBytes, bool compressFrameCache) {
+    throw UnimplementedError('setLooping() has not been implemented.');
+  }
+
+  Future<int> prewarmMetadata(List<String> paths) {
+    throw UnimplementedError('prewarmMetadata() has not been implemented.');
+  }
+
+  Future<WinMediaInfo?> probe(String path) {
+    throw UnimplementedError('probe() has not been implemented.');
+  }
+
+  Future<WinThumbnailSheet?> getThumbnails(String path, List<Duration> positions, int thumbWidth, int thumbHeight, int columns) {
+    throw UnimplementedError('getThumbnails() has not been implemented.');
+  }
+
+  Future<void> setPlayerPoolSize(int size) {
+    throw UnimplementedError('setPlayerPoolSize() has not been implemented.');
+  }
+
+  Future<WinOpenStats?> getOpenStats(int textureId) {
+    throw UnimplementedError('getOpenStats() has not been implemented.');
+  }
+
+  Future<int> createMosaic(int width, int height, int columns, int rows, int fps) {
+    throw UnimplementedError('createMosaic() has not been implemented.');
+  }
+
+  Future<void> disposeMosaic(int mosaicId) {
+    throw UnimplementedError('disposeMosaic() has not been implemented.');
+  }
+
+  Future<bool> setMosaicTile(int textureId, int mosaicId, int tile) {
+    throw UnimplementedError('setMosaicTile() has not been implemented.');
+  }
+
+  Future<void> setFrameBudget(int budgetUs) {
+    throw UnimplementedError('setFrameBudget() has not been implemented.');
+  }
+
+  Future<void> setHttpCache(bool enabled, int readAheadBytes, int cacheBytes) {
+    throw UnimplementedError('setHttpCache() has not been implemented.');
+  }
+
+  /// {url, address}: a native buffer of [size] bytes, played by opening its url
+  Future<Map<dynamic, dynamic>?> allocMemorySource(int size, String extension) {
+    throw UnimplementedError('allocMemorySource() has not been implemented.');
+  }
+
+  Future<void> releaseMemorySource(String url) {
+    throw UnimplementedError('releaseMemorySource() has not been implemented.');
+  }
+
+  Future<void> setFileReadAhead(bool enabled, int readAheadBytes, bool memoryMap) {
+    throw UnimplementedError('setFileReadAhead() has not been implemented.');
+  }
+
+  Future<void> setHlsOptions(int parallelFetches, int maxPoolBytes, int maxAheadMs, int initialBps) {
+    throw UnimplementedError('setHlsOptions() has not been implemented.');
+  }
+
+  Future<void> setPriority(int textureId, int priority, double fps) {
+    throw UnimplementedError('setPriority() has not been implemented.');
+  }
+
+  Future<WinFrameBudgetStats?> getFrameBudgetStats(int textureId) {
+    throw UnimplementedError('getFrameBudgetStats() has not been implemented.');
+  }
+
+  Future<bool> setDropThreshold(int textureId, double frames) {
+    throw UnimplementedError('setDropThreshold() has not been implemented.');
+  }
+
+  Future<WinSchedulerStats?> getSchedulerStats(int textureId) {
+    throw UnimplementedError('getSchedulerStats() has not been implemented.');
+  }
+
+  Future<bool> setSampleQueueBounds(int textureId, int minDepth, int maxDepth) {
+    throw UnimplementedError('setSampleQueueBounds() has not been implemented.');
+  }
+
+  Future<WinSampleQueueStats?> getSampleQueueStats(int textureId) {
+    throw UnimplementedError('getSampleQueueStats() has not been implemented.');
+  }
+
+  Future<WinPlaylistStats?> getPlaylistStats(int textureId) {
+    throw UnimplementedError('getPlaylistStats() has not been implemented.');
+  }
+
+  Future<WinReadAheadStats?> getReadAheadStats(int textureId) {
+    throw UnimplementedError('getReadAheadStats() has not been implemented.');
+  }
+
+  Future<bool> startSampleTrace(int textureId, String path) {
+    throw UnimplementedError('startSampleTrace() has not been implemented.');
+  }
+
+  Future<int> stopSampleTrace(int textureId) {
+    throw UnimplementedError('stopSampleTrace() has not been implemented.');
+  }
+
+  Future<WinHlsStats?> getHlsStats(int textureId) {
+    throw UnimplementedError('getHlsStats() has not been implemented.');
+  }
+
+  Future<void> setFrameStepCache(int textureId, int maxBytes) {
+    throw UnimplementedError('setFrameStepCache() has not been implemented.');
+  }
+
+  Future<int?> stepFrame(int textureId, bool forward) {
+    throw UnimplementedError('stepFrame() has not been implemented.');
+  }
+
+  Future<bool> playReverse(int textureId, double speed) {
+    throw UnimplementedError('playReverse() has not been implemented.');
+  }
+
+  Future<WinFrameStepStats?> getFrameStepStats(int textureId) {
+    throw UnimplementedError('getFrameStepStats() has not been implemented.');
+  }
+
   Future<void> dispose(int textureId) {
     throw UnimplementedError('destroy() has not been implemented.');
   }
@@ -57,8 +57,15 @@ class WindowsVideoPlayer extends VideoPlayerPlatform {
         mControllerMap[controller.textureId_] = controller;
         return controller.textureId_;
       }
+    } else if (dataSource.sourceType == DataSourceType.asset) {
+      var controller = WinVideoPlayerController.asset(dataSource.asset!, package: dataSource.package, isBridgeMode: true);
+      await controller.initialize();
+      if (controller.textureId_ > 0) {
+        mControllerMap[controller.textureId_] = controller;
+        return controller.textureId_;
+      }
     } else {
-      throw UnimplementedError('create() has not been implemented for dataSource type [assets] and [contentUri] in Windows OS');
+      throw UnimplementedError('create() has not been implemented for dataSource type [contentUri] in Windows OS');
     }
   }
 
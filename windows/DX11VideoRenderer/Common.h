@@ -361,6 +361,43 @@ namespace DX11VideoRenderer
         CRITICAL_SECTION m_cs;
     };
 
+    //
+    // CCritSec of one media sink, shared by its stream sink and its scheduler:
+    // each of them holds a reference, so it outlives the last one released.
+    //
+    class CSharedCritSec : public CCritSec
+    {
+    public:
+
+        CSharedCritSec(void) :
+            m_nRefCount(1)
+        {
+        }
+
+        ULONG AddRef(void)
+        {
+            return InterlockedIncrement(&m_nRefCount);
+        }
+
+        ULONG Release(void)
+        {
+            ULONG uCount = InterlockedDecrement(&m_nRefCount);
+            if (uCount == 0)
+            {
+                delete this;
+            }
+            return uCount;
+        }
+
+    private:
+
+        ~CSharedCritSec(void)
+        {
+        }
+
+        long m_nRefCount;
+    };
+
     class CAutoLock
     {
     public:
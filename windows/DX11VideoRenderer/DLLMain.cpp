@@ -24,6 +24,63 @@ STDAPI CreateDX11VideoRendererActivate(HWND hwnd, IMFActivate** ppActivate, D3D1
 }
 // Jacky }
 
+// The sink of one of our activates (ActivateObject returns the cached one)
+static HRESULT ActivateMediaSink(IMFActivate* pActivate, DX11VideoRenderer::CMediaSink** ppSink)
+{
+    IMFMediaSink* pSink = NULL;
+    HRESULT hr = pActivate->ActivateObject(IID_PPV_ARGS(&pSink));
+    *ppSink = SUCCEEDED(hr) ? static_cast<DX11VideoRenderer::CMediaSink*>(pSink) : NULL;
+    return hr;
+}
+
+STDAPI DX11VideoRendererSetDropThreshold(IMFActivate* pActivate, float frames)
+{
+    DX11VideoRenderer::CMediaSink* pSink = NULL;
+    HRESULT hr = ActivateMediaSink(pActivate, &pSink);
+    if (SUCCEEDED(hr))
+    {
+        hr = pSink->SetDropThreshold(frames);
+    }
+    SafeRelease(pSink);
+    return hr;
+}
+
+STDAPI DX11VideoRendererGetSchedulerStats(IMFActivate* pActivate, DX11VideoRenderer::SchedulerStats* pStats)
+{
+    DX11VideoRenderer::CMediaSink* pSink = NULL;
+    HRESULT hr = ActivateMediaSink(pActivate, &pSink);
+    if (SUCCEEDED(hr))
+    {
+        hr = pSink->GetSchedulerStats(pStats);
+    }
+    SafeRelease(pSink);
+    return hr;
+}
+
+STDAPI DX11VideoRendererSetSampleQueueBounds(IMFActivate* pActivate, DWORD dwMinDepth, DWORD dwMaxDepth)
+{
+    DX11VideoRenderer::CMediaSink* pSink = NULL;
+    HRESULT hr = ActivateMediaSink(pActivate, &pSink);
+    if (SUCCEEDED(hr))
+    {
+        hr = pSink->SetSampleQueueBounds(dwMinDepth, dwMaxDepth);
+    }
+    SafeRelease(pSink);
+    return hr;
+}
+
+STDAPI DX11VideoRendererGetSampleQueueStats(IMFActivate* pActivate, DX11VideoRenderer::SampleQueueStats* pStats)
+{
+    DX11VideoRenderer::CMediaSink* pSink = NULL;
+    HRESULT hr = ActivateMediaSink(pActivate, &pSink);
+    if (SUCCEEDED(hr))
+    {
+        hr = pSink->GetSampleQueueStats(pStats);
+    }
+    SafeRelease(pSink);
+    return hr;
+}
+
 /* //Jacky
 // helper functions
 
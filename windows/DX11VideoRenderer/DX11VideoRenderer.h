@@ -4,6 +4,8 @@
 #include <dxgi1_2.h> //Jacky
 #include <functional> //Jacky
 typedef std::function<void(ID3D11Texture2D*)> D3D11Texture2DCallback; //Jacky
+#include "SchedulerCore.h"
+#include "SampleQueueDepth.h"
 
 // {83A1FDBC-AB3A-4376-A529-80E18C206534}
 DEFINE_GUID(CLSID_DX11VideoRenderer, 0x83a1fdbc, 0xab3a, 0x4376, 0xa5, 0x29, 0x80, 0xe1, 0x8c, 0x20, 0x65, 0x34);
@@ -14,3 +16,10 @@ DEFINE_GUID(CLSID_DX11VideoRendererActivate, 0x743fa5c, 0xda9e, 0x4760, 0x81, 0x
 // creation methods exposed by the lib
 STDAPI CreateDX11VideoRenderer(REFIID riid, void** ppvObject);
 STDAPI CreateDX11VideoRendererActivate(HWND hwnd, IMFActivate** ppActivate, D3D11Texture2DCallback textureCallback = nullptr);
+
+// Tuning and statistics of the sink of an activate created by CreateDX11VideoRendererActivate
+// (activated on the first call if the session has not done it yet)
+STDAPI DX11VideoRendererSetDropThreshold(IMFActivate* pActivate, float frames);
+STDAPI DX11VideoRendererGetSchedulerStats(IMFActivate* pActivate, DX11VideoRenderer::SchedulerStats* pStats);
+STDAPI DX11VideoRendererSetSampleQueueBounds(IMFActivate* pActivate, DWORD dwMinDepth, DWORD dwMaxDepth);
+STDAPI DX11VideoRendererGetSampleQueueStats(IMFActivate* pActivate, DX11VideoRenderer::SampleQueueStats* pStats);
@@ -0,0 +1,94 @@
+#include "FrameIntervalEstimator.h"
+
+#include <algorithm>
+
+//-----------------------------------------------------------------------------
+// Constructor
+//-----------------------------------------------------------------------------
+
+DX11VideoRenderer::CFrameIntervalEstimator::CFrameIntervalEstimator(void)
+{
+    Reset();
+}
+
+void DX11VideoRenderer::CFrameIntervalEstimator::Reset(void)
+{
+    m_count = 0;
+    m_next = 0;
+    m_hnsLastTime = -1;
+    m_hnsEstimate = 0;
+}
+
+//-----------------------------------------------------------------------------
+// OnSampleTime
+//
+// hnsSampleTime: Presentation time of the next sample, in 100ns units.
+// phnsPerFrame:  Receives the new estimate, when it returns true.
+//-----------------------------------------------------------------------------
+
+bool DX11VideoRenderer::CFrameIntervalEstimator::OnSampleTime(int64_t hnsSampleTime, int64_t* phnsPerFrame)
+{
+    int64_t hnsLastTime = m_hnsLastTime;
+    m_hnsLastTime = hnsSampleTime;
+    if (hnsLastTime < 0)
+    {
+        return false;
+    }
+
+    // Not an interval between two frames: repeated or reordered times, a seek
+    // without flush, or a gap longer than any frame.
+    int64_t hnsInterval = hnsSampleTime - hnsLastTime;
+    if (hnsInterval < MIN_INTERVAL || hnsInterval > MAX_INTERVAL)
+    {
+        return false;
+    }
+
+    m_intervals[m_next] = hnsInterval;
+    m_next = (m_next + 1) % WINDOW;
+    if (m_count < WINDOW)
+    {
+        m_count++;
+    }
+    if (m_count < MIN_INTERVALS)
+    {
+        return false;
+    }
+
+    int64_t hnsEstimate = Compute();
+    int64_t hnsChange = hnsEstimate > m_hnsEstimate ? hnsEstimate - m_hnsEstimate : m_hnsEstimate - hnsEstimate;
+    if (m_hnsEstimate != 0 && hnsChange * 100 <= m_hnsEstimate)
+    {
+        return false;
+    }
+
+    m_hnsEstimate = hnsEstimate;
+    *phnsPerFrame = hnsEstimate;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Compute
+//
+// Mean of the intervals within [median * 0.6, median * 1.6]: wide enough for
+// the 2:3 ratio of telecine, narrow enough to leave out a missing frame.
+//-----------------------------------------------------------------------------
+
+int64_t DX11VideoRenderer::CFrameIntervalEstimator::Compute(void) const
+{
+    int64_t sorted[WINDOW];
+    std::copy(m_intervals, m_intervals + m_count, sorted);
+    std::nth_element(sorted, sorted + m_count / 2, sorted + m_count);
+    int64_t hnsMedian = sorted[m_count / 2];
+
+    int64_t hnsTotal = 0;
+    int inliers = 0;
+    for (int i = 0; i < m_count; i++)
+    {
+        if (m_intervals[i] * 5 >= hnsMedian * 3 && m_intervals[i] * 5 <= hnsMedian * 8)
+        {
+            hnsTotal += m_intervals[i];
+            inliers++;
+        }
+    }
+    return hnsTotal / inliers; // the median itself is an inlier
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// Platform-neutral frame interval, estimated from the sample times when the media type has
+// no frame rate (MF_MT_FRAME_RATE). Fed with the presentation times, so it can be replayed
+// against timestamp patterns (no Windows header).
+
+#include <cstdint>
+
+namespace DX11VideoRenderer
+{
+    //-----------------------------------------------------------------------------
+    // CFrameIntervalEstimator
+    //
+    // The estimate is the mean of the last WINDOW intervals between sample
+    // times, those outside 0.6 to 1.6 times their median left out: a median alone
+    // locks onto one of the two intervals of telecined timestamps (3:2 pulldown
+    // alternates 3 and 2 field durations), the mean of the inliers gives their
+    // average. Gaps (dropped or missing samples, a discontinuity) and
+    // timestamps going backwards are outliers, or not intervals at all.
+    //-----------------------------------------------------------------------------
+
+    class CFrameIntervalEstimator
+    {
+    public:
+
+        static const int WINDOW = 24;
+        static const int MIN_INTERVALS = 4;                 // before a first estimate
+        static const int64_t MIN_INTERVAL = 10000;          // 1 ms (1000 fps)
+        static const int64_t MAX_INTERVAL = 10000000;       // 1 s
+
+        CFrameIntervalEstimator(void);
+
+        // Returns true when the estimate changed by more than 1% (or is the
+        // first one), *phnsPerFrame receiving it.
+        bool OnSampleTime(int64_t hnsSampleTime, int64_t* phnsPerFrame);
+
+        // After a flush (seek): the next time does not follow the last one
+        void Restart(void) { m_hnsLastTime = -1; }
+        void Reset(void);
+
+        int64_t Estimate(void) const { return m_hnsEstimate; } // 0 until estimated
+
+    private:
+
+        int64_t Compute(void) const;
+
+        int64_t     m_intervals[WINDOW];    // ring buffer
+        int         m_count;
+        int         m_next;
+        int64_t     m_hnsLastTime;          // -1 before the first sample
+        int64_t     m_hnsEstimate;
+    };
+}
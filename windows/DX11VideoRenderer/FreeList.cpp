@@ -0,0 +1,93 @@
+#include "FreeList.h"
+
+//-----------------------------------------------------------------------------
+// Constructor
+//-----------------------------------------------------------------------------
+
+#ifdef _WIN32
+
+DX11VideoRenderer::CFreeList::CFreeList(long maxFree) :
+    m_maxFree(maxFree),
+    m_cFree(0)
+{
+    InitializeSListHead(&m_head);
+}
+
+#else
+
+DX11VideoRenderer::CFreeList::CFreeList(long maxFree) :
+    m_maxFree(maxFree),
+    m_pHead(NULL),
+    m_cFree(0)
+{
+}
+
+#endif
+
+//-----------------------------------------------------------------------------
+// Pop
+//-----------------------------------------------------------------------------
+
+DX11VideoRenderer::FreeListEntry* DX11VideoRenderer::CFreeList::Pop(void)
+{
+#ifdef _WIN32
+    PSLIST_ENTRY pEntry = InterlockedPopEntrySList(&m_head);
+    if (pEntry != NULL)
+    {
+        InterlockedDecrement(&m_cFree);
+    }
+    return pEntry;
+#else
+    std::lock_guard<std::mutex> lock(m_lock);
+    FreeListEntry* pEntry = m_pHead;
+    if (pEntry != NULL)
+    {
+        m_pHead = pEntry->Next;
+        m_cFree--;
+    }
+    return pEntry;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Push
+//
+// The count is taken before the object is in the list, so concurrent pushes
+// overshoot it rather than keep more than 'maxFree' objects unseen.
+//-----------------------------------------------------------------------------
+
+bool DX11VideoRenderer::CFreeList::Push(FreeListEntry* pEntry)
+{
+#ifdef _WIN32
+    if (InterlockedIncrement(&m_cFree) > m_maxFree)
+    {
+        InterlockedDecrement(&m_cFree);
+        return false;
+    }
+    InterlockedPushEntrySList(&m_head, pEntry);
+    return true;
+#else
+    if (++m_cFree > m_maxFree)
+    {
+        m_cFree--;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_lock);
+    pEntry->Next = m_pHead;
+    m_pHead = pEntry;
+    return true;
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// FreeCount
+//-----------------------------------------------------------------------------
+
+long DX11VideoRenderer::CFreeList::FreeCount(void) const
+{
+#ifdef _WIN32
+    return m_cFree;
+#else
+    return m_cFree.load();
+#endif
+}
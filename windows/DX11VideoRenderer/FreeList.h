@@ -0,0 +1,67 @@
+#pragma once
+
+// Platform-neutral free list of the objects CStreamSink recycles (one CAsyncOperation per
+// sample): an interlocked SLIST on Windows, a mutex-guarded list elsewhere, where only the
+// tests build it. The recycled objects can be counted against a simulated load.
+
+#include <cstdint>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <atomic>
+#include <mutex>
+#endif
+
+namespace DX11VideoRenderer
+{
+    // The link of a recycled object, a member of it (CONTAINING_RECORD finds the object)
+#ifdef _WIN32
+    typedef SLIST_ENTRY FreeListEntry;
+#else
+    struct FreeListEntry
+    {
+        FreeListEntry* Next;
+    };
+#endif
+
+    //-----------------------------------------------------------------------------
+    // CFreeList
+    //
+    // Keeps at most 'maxFree' released objects (the count may briefly overshoot
+    // under contention, by one per releasing thread); a caller whose Push() fails
+    // deletes its object. The kept ones are never freed: the list is meant to be
+    // a static of the recycled class, for the process lifetime.
+    //-----------------------------------------------------------------------------
+
+    class CFreeList
+    {
+    public:
+
+        explicit CFreeList(long maxFree);
+
+        // A released object, NULL if none (allocate one)
+        FreeListEntry* Pop(void);
+        // False if enough are kept already (delete the object)
+        bool Push(FreeListEntry* pEntry);
+
+        long FreeCount(void) const;
+        long MaxFree(void) const { return m_maxFree; }
+
+    private:
+
+        CFreeList(const CFreeList&) = delete;
+        CFreeList& operator=(const CFreeList&) = delete;
+
+        const long m_maxFree;
+
+#ifdef _WIN32
+        SLIST_HEADER m_head;
+        volatile LONG m_cFree;
+#else
+        std::mutex m_lock;
+        FreeListEntry* m_pHead;
+        std::atomic<long> m_cFree;
+#endif
+    };
+}
@@ -9,8 +9,6 @@
 //
 /////////////////////////////////////////////////////////////////////////////////////////////
 
-DX11VideoRenderer::CCritSec DX11VideoRenderer::CMediaSink::s_csStreamSinkAndScheduler;
-
 //-------------------------------------------------------------------
 // Name: CreateInstance
 // Description: Creates an instance of the DX11 Video Renderer sink object.
@@ -360,6 +358,7 @@ HRESULT DX11VideoRenderer::CMediaSink::Shutdown(void)
     SafeRelease(m_pStream);
     SafeRelease(m_pPresenter);
     SafeRelease(m_pScheduler);
+    SafeRelease(m_pcsStreamSinkAndScheduler);
 
     return hr;
 }
@@ -424,6 +423,12 @@ HRESULT DX11VideoRenderer::CMediaSink::OnClockSetRate(
         m_pScheduler->SetClockRate(flRate);
     }
 
+    if (m_pStream != NULL)
+    {
+        // Only a thinned stream can be that fast (IsRateSupported).
+        m_pStream->OnClockSetRate(flRate);
+    }
+
     return S_OK;
 }
 
@@ -464,6 +469,12 @@ HRESULT DX11VideoRenderer::CMediaSink::OnClockStart(
     {
         if (m_pScheduler != NULL)
         {
+            // A new playback (not a resume) counts its frames from 0.
+            if (!m_pStream->IsActive())
+            {
+                m_pScheduler->ResetStats();
+            }
+
             // Start the scheduler thread.
             hr = m_pScheduler->StartScheduler(m_pClock);
         }
@@ -641,28 +652,24 @@ STDMETHODIMP DX11VideoRenderer::CMediaSink::IsRateSupported(BOOL fThin, float fl
         }
 
         //
-        // Only support rates up to the refresh rate of the monitor.
-        // This check makes sense only if we're going to be receiving
-        // all frames
+        // Only support rates up to the thinning rate when receiving all
+        // frames; keyframes only (thinned) go much faster.
         //
-        if ( !fThin )
-        {
-            float rate;
+        float rate;
 
-            hr = m_pStream->GetMaxRate(fThin, &rate);
-            if (FAILED(hr))
-            {
-                break;
-            }
+        hr = m_pStream->GetMaxRate(fThin, &rate);
+        if (FAILED(hr))
+        {
+            break;
+        }
 
-            if ( (flRate > 0 && flRate > (float)rate) ||
-                (flRate < 0 && flRate < -(float)rate) )
-            {
-                hr = MF_E_UNSUPPORTED_RATE;
-                flNearestSupportedRate = ( flRate >= 0.0f ) ? rate : -rate;
+        if ( (flRate > 0 && flRate > (float)rate) ||
+            (flRate < 0 && flRate < -(float)rate) )
+        {
+            hr = MF_E_UNSUPPORTED_RATE;
+            flNearestSupportedRate = ( flRate >= 0.0f ) ? rate : -rate;
 
-                break;
-            }
+            break;
         }
     }
     while (FALSE);
@@ -691,6 +698,118 @@ STDMETHODIMP DX11VideoRenderer::CMediaSink::NotifyPreroll(MFTIME hnsUpcomingStar
     return hr;
 }
 
+//-------------------------------------------------------------------
+// Name: SetThinningRate
+// Description: Fastest rate at which every frame is rendered. Above it,
+//              IsRateSupported only accepts thinned rates, for which the
+//              source delivers keyframes only.
+//-------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CMediaSink::SetThinningRate(float flRate)
+{
+    CAutoLock lock(&m_csMediaSink);
+
+    HRESULT hr = CheckShutdown();
+
+    if (SUCCEEDED(hr))
+    {
+        hr = m_pStream->SetThinningRate(flRate);
+    }
+
+    return hr;
+}
+
+HRESULT DX11VideoRenderer::CMediaSink::SetSampleTrace(std::shared_ptr<SampleTraceWriter> pTrace)
+{
+    CAutoLock lock(&m_csMediaSink);
+
+    HRESULT hr = CheckShutdown();
+
+    if (SUCCEEDED(hr))
+    {
+        m_pStream->SetSampleTrace(pTrace);
+    }
+
+    return hr;
+}
+
+//-------------------------------------------------------------------
+// Name: SetDropThreshold
+// Description: Lateness (in frames) from which the scheduler drops a
+//              sample instead of presenting it, see CSchedulerCore.
+//-------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CMediaSink::SetDropThreshold(float frames)
+{
+    CAutoLock lock(&m_csMediaSink);
+
+    HRESULT hr = CheckShutdown();
+
+    if (SUCCEEDED(hr))
+    {
+        m_pScheduler->SetDropThreshold(frames);
+    }
+
+    return hr;
+}
+
+//-------------------------------------------------------------------
+// Name: GetSchedulerStats
+// Description: Presented / late / dropped counts of the scheduler.
+//-------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CMediaSink::GetSchedulerStats(SchedulerStats* pStats)
+{
+    CAutoLock lock(&m_csMediaSink);
+
+    HRESULT hr = CheckShutdown();
+
+    if (SUCCEEDED(hr))
+    {
+        m_pScheduler->GetStats(pStats);
+    }
+
+    return hr;
+}
+
+//-------------------------------------------------------------------
+// Name: SetSampleQueueBounds
+// Description: Bounds of the depth of the stream's sample queue.
+//-------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CMediaSink::SetSampleQueueBounds(DWORD dwMinDepth, DWORD dwMaxDepth)
+{
+    CAutoLock lock(&m_csMediaSink);
+
+    HRESULT hr = CheckShutdown();
+
+    if (SUCCEEDED(hr))
+    {
+        hr = m_pStream->SetSampleQueueBounds(dwMinDepth, dwMaxDepth);
+    }
+
+    return hr;
+}
+
+//-------------------------------------------------------------------
+// Name: GetSampleQueueStats
+// Description: Depth and occupancy of the stream's sample queue.
+//-------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CMediaSink::GetSampleQueueStats(SampleQueueStats* pStats)
+{
+    CAutoLock lock(&m_csMediaSink);
+
+    HRESULT hr = CheckShutdown();
+
+    if (SUCCEEDED(hr))
+    {
+        hr = m_pStream->GetSampleQueueStats(pStats);
+    }
+
+    return hr;
+}
+
 /// Private methods
 
 //-------------------------------------------------------------------
@@ -706,6 +825,7 @@ DX11VideoRenderer::CMediaSink::CMediaSink(void) :
     m_pStream(NULL),
     m_pClock(NULL),
     m_pScheduler(NULL),
+    m_pcsStreamSinkAndScheduler(NULL),
     m_pPresenter(NULL)
 {
 }
@@ -745,14 +865,22 @@ HRESULT DX11VideoRenderer::CMediaSink::Initialize(void)
 
     do
     {
-        m_pScheduler = new CScheduler(s_csStreamSinkAndScheduler);
+        // One lock domain per sink: renderers don't serialize each other.
+        m_pcsStreamSinkAndScheduler = new (std::nothrow) CSharedCritSec(); // Created with ref count = 1.
+        if (m_pcsStreamSinkAndScheduler == NULL)
+        {
+            hr = E_OUTOFMEMORY;
+            break;
+        }
+
+        m_pScheduler = new CScheduler(m_pcsStreamSinkAndScheduler);
         if (m_pScheduler == NULL)
         {
             hr = E_OUTOFMEMORY;
             break;
         }
 
-        m_pStream = new CStreamSink(STREAM_ID, s_csStreamSinkAndScheduler, m_pScheduler);
+        m_pStream = new CStreamSink(STREAM_ID, m_pcsStreamSinkAndScheduler, m_pScheduler);
         if (m_pStream == NULL)
         {
             hr = E_OUTOFMEMORY;
@@ -54,12 +54,22 @@ namespace DX11VideoRenderer
         // IMFMediaSinkPreroll
         STDMETHODIMP NotifyPreroll(MFTIME hnsUpcomingStartTime);
 
+        // Fastest rate with every frame: above it, only keyframes (thinned trick play)
+        HRESULT SetThinningRate(float flRate);
+        // Timing of the samples received, for tools/trace_replay; NULL stops it
+        HRESULT SetSampleTrace(std::shared_ptr<SampleTraceWriter> pTrace);
+        // Samples later than this many frames are dropped by the scheduler (0: never dropped)
+        HRESULT SetDropThreshold(float frames);
+        // Presented, late and dropped samples since the playback started
+        HRESULT GetSchedulerStats(SchedulerStats* pStats);
+        // Bounds of the adaptive depth of the sample queue, see CStreamSink::SetSampleQueueBounds
+        HRESULT SetSampleQueueBounds(DWORD dwMinDepth, DWORD dwMaxDepth);
+        HRESULT GetSampleQueueStats(SampleQueueStats* pStats);
+
         D3D11Texture2DCallback m_textureCallback = nullptr; //Jacky
 
     private:
 
-        static CCritSec s_csStreamSinkAndScheduler; // critical section for thread safety, used for CStreamSink and CScheduler
-
         CMediaSink(void);
         virtual ~CMediaSink(void);
 
@@ -73,6 +83,7 @@ namespace DX11VideoRenderer
         CStreamSink*            m_pStream;      // Byte stream
         IMFPresentationClock*   m_pClock;       // Presentation clock.
         CScheduler*             m_pScheduler;    // Manages scheduling of samples.
+        CSharedCritSec*         m_pcsStreamSinkAndScheduler; // critical section for thread safety, used for CStreamSink and CScheduler (of this sink only)
         CPresenter*             m_pPresenter;
     };
 }
@@ -237,7 +237,11 @@ DX11VideoRenderer::CPresenter::CPresenter(void) :
     m_rcSrcApp(), // default ctor
     m_rcDstApp(), // default ctor
     m_pXVP(NULL),
-    m_pXVPControl(NULL)
+    m_pXVPControl(NULL),
+    m_bSoftwarePresenter(FALSE),
+    m_softwareConverter(), // default ctor
+    m_lSoftwareStride(0),
+    m_softwareFrame() // default ctor
 {
     ZeroMemory(&m_rcSrcApp, sizeof(m_rcSrcApp));
     ZeroMemory(&m_rcDstApp, sizeof(m_rcDstApp));
@@ -382,6 +386,12 @@ HRESULT DX11VideoRenderer::CPresenter::SetVideoWindow(__RPC__in HWND hwndVideo)
             break;
         }
 
+        // The XVP needs the DXGI device manager
+        if (m_bSoftwarePresenter)
+        {
+            m_useXVP = 0;
+        }
+
         if (m_useXVP)
         {
             hr = CreateXVP();
@@ -509,6 +519,15 @@ HRESULT DX11VideoRenderer::CPresenter::IsMediaTypeSupported(IMFMediaType* pMedia
             break;
         }
 
+        if (m_bSoftwarePresenter)
+        {
+            if (SOFTWARE_FORMAT_UNKNOWN == GetSoftwareFormat(pMediaType))
+            {
+                hr = MF_E_INVALIDMEDIATYPE;
+            }
+            break;
+        }
+
         if (!m_pDX11VideoDevice)
         {
             hr = m_pD3D11Device->QueryInterface(__uuidof(ID3D11VideoDevice), (void**)&m_pDX11VideoDevice);
@@ -635,6 +654,34 @@ HRESULT DX11VideoRenderer::CPresenter::PresentFrame(void)
     return hr;
 }
 
+//-------------------------------------------------------------------
+// Name: CopySampleTimes
+// Description: Gives a processed frame the time, duration and flags
+//              of its input sample.
+//-------------------------------------------------------------------
+
+static void CopySampleTimes(IMFSample* pSample, IMFSample* pOutputSample)
+{
+    LONGLONG hnsDuration = 0;
+    LONGLONG hnsTime = 0;
+    DWORD dwSampleFlags = 0;
+
+    if (SUCCEEDED(pSample->GetSampleDuration(&hnsDuration)))
+    {
+        pOutputSample->SetSampleDuration(hnsDuration);
+    }
+
+    if (SUCCEEDED(pSample->GetSampleTime(&hnsTime)))
+    {
+        pOutputSample->SetSampleTime(hnsTime);
+    }
+
+    if (SUCCEEDED(pSample->GetSampleFlags(&dwSampleFlags)))
+    {
+        pOutputSample->SetSampleFlags(dwSampleFlags);
+    }
+}
+
 //-------------------------------------------------------------------
 // Name: ProcessFrame
 // Description: Present one media sample.
@@ -744,9 +791,21 @@ HRESULT DX11VideoRenderer::CPresenter::ProcessFrame(IMFMediaType* pCurrentType,
             }
         }
 
-        hr = pBuffer->QueryInterface(__uuidof(IMFDXGIBuffer), (LPVOID*)&pDXGIBuffer);
-        if (FAILED(hr))
+        // Without a video device, or for a sample in system memory (from a decoder
+        // that did not use our allocator), the frame is converted on the CPU.
+        if (!m_bSoftwarePresenter)
+        {
+            hr = pBuffer->QueryInterface(__uuidof(IMFDXGIBuffer), (LPVOID*)&pDXGIBuffer);
+        }
+
+        if (m_bSoftwarePresenter || FAILED(hr))
         {
+            hr = ProcessFrameUsingSoftware( pBuffer, rcDest, ppOutputSample );
+
+            if (SUCCEEDED(hr) && ppOutputSample != NULL && *ppOutputSample != NULL)
+            {
+                CopySampleTimes(pSample, *ppOutputSample);
+            }
             break;
         }
 
@@ -807,26 +866,9 @@ HRESULT DX11VideoRenderer::CPresenter::ProcessFrame(IMFMediaType* pCurrentType,
         {
             hr = ProcessFrameUsingD3D11( pTexture2D, pEVTexture2D, dwViewIndex, dwEVViewIndex, rcDest, *punInterlaceMode, ppOutputSample );
 
-            LONGLONG hnsDuration = 0;
-            LONGLONG hnsTime = 0;
-            DWORD dwSampleFlags = 0;
-
             if (ppOutputSample != NULL && *ppOutputSample != NULL)
             {
-                if (SUCCEEDED(pSample->GetSampleDuration(&hnsDuration)))
-                {
-                    (*ppOutputSample)->SetSampleDuration(hnsDuration);
-                }
-
-                if (SUCCEEDED(pSample->GetSampleTime(&hnsTime)))
-                {
-                    (*ppOutputSample)->SetSampleTime(hnsTime);
-                }
-
-                if (SUCCEEDED(pSample->GetSampleFlags(&dwSampleFlags)))
-                {
-                    (*ppOutputSample)->SetSampleFlags(dwSampleFlags);
-                }
+                CopySampleTimes(pSample, *ppOutputSample);
             }
         }
     }
@@ -911,6 +953,18 @@ HRESULT DX11VideoRenderer::CPresenter::SetCurrentMediaType(IMFMediaType* pMediaT
             m_uiRealDisplayHeight = szVideo.cy;
         }
 
+        if (SUCCEEDED(hr))
+        {
+            // Also for the samples in system memory with a video device; only
+            // required without one
+            HRESULT hrSoftware = SetSoftwareFormat(pMediaType);
+            if (FAILED(hrSoftware) && m_bSoftwarePresenter)
+            {
+                hr = hrSoftware;
+                break;
+            }
+        }
+
         if (SUCCEEDED(hr) && m_useXVP)
         {
             // set the input type on the XVP
@@ -957,6 +1011,9 @@ HRESULT DX11VideoRenderer::CPresenter::Shutdown(void)
     SafeRelease(m_pVideoProcessorEnum);
     SafeRelease(m_pSwapChain1);
 
+    m_softwareFrame.clear();
+    m_softwareFrame.shrink_to_fit();
+
     return hr;
 }
 
@@ -1221,25 +1278,47 @@ HRESULT DX11VideoRenderer::CPresenter::CreateDXGIManagerAndDevice(D3D_DRIVER_TYP
             }
         }
 
+        // No video device at any feature level (virtual machine, remote session,
+        // basic display driver): a device without one, the frames converted on
+        // the CPU and copied to the swap chain.
+        m_bSoftwarePresenter = FALSE;
+        if (FAILED(hr) && D3D_DRIVER_TYPE_HARDWARE == DriverType)
+        {
+            const D3D_DRIVER_TYPE softwareDriverTypes[] = { D3D_DRIVER_TYPE_HARDWARE, D3D_DRIVER_TYPE_WARP };
+            for (DWORD dwType = 0; dwType < ARRAYSIZE(softwareDriverTypes) && FAILED(hr); dwType++)
+            {
+                hr = D3D11CreateDevice(NULL, softwareDriverTypes[dwType], NULL, m_useDebugLayer & ~D3D11_CREATE_DEVICE_VIDEO_SUPPORT, featureLevels, ARRAYSIZE(featureLevels), D3D11_SDK_VERSION, &m_pD3D11Device, &featureLevel, NULL);
+            }
+            m_bSoftwarePresenter = SUCCEEDED(hr);
+        }
+
         if (FAILED(hr))
         {
             break;
         }
 
-        if (NULL == m_pDXGIManager)
+        if (m_bSoftwarePresenter)
         {
-            hr = MFCreateDXGIDeviceManager(&resetToken, &m_pDXGIManager);
+            // Not offered to the decoders: they output system memory
+            SafeRelease(m_pDXGIManager);
+        }
+        else
+        {
+            if (NULL == m_pDXGIManager)
+            {
+                hr = MFCreateDXGIDeviceManager(&resetToken, &m_pDXGIManager);
+                if (FAILED(hr))
+                {
+                    break;
+                }
+                m_DeviceResetToken = resetToken;
+            }
+
+            hr = m_pDXGIManager->ResetDevice(m_pD3D11Device, m_DeviceResetToken);
             if (FAILED(hr))
             {
                 break;
             }
-            m_DeviceResetToken = resetToken;
-        }
-
-        hr = m_pDXGIManager->ResetDevice(m_pD3D11Device, m_DeviceResetToken);
-        if (FAILED(hr))
-        {
-            break;
         }
 
         SafeRelease(m_pD3DImmediateContext);
@@ -1403,6 +1482,49 @@ HRESULT DX11VideoRenderer::CPresenter::FindBOBProcessorIndex(DWORD* pIndex)
     return E_FAIL;
 }
 
+//-------------------------------------------------------------------
+// Name: GetSoftwareFormat
+// Description: The layout of a subtype for CSoftwareConverter,
+//              SOFTWARE_FORMAT_UNKNOWN if it is not converted.
+//-------------------------------------------------------------------
+
+DX11VideoRenderer::SoftwareFormat DX11VideoRenderer::CPresenter::GetSoftwareFormat(IMFMediaType* pType)
+{
+    GUID subType = GUID_NULL;
+
+    if (FAILED(pType->GetGUID(MF_MT_SUBTYPE, &subType)))
+    {
+        return SOFTWARE_FORMAT_UNKNOWN;
+    }
+
+    if (subType == MFVideoFormat_NV12)
+    {
+        return SOFTWARE_FORMAT_NV12;
+    }
+    else if (subType == MFVideoFormat_I420 || subType == MFVideoFormat_IYUV)
+    {
+        return SOFTWARE_FORMAT_I420;
+    }
+    else if (subType == MFVideoFormat_YV12)
+    {
+        return SOFTWARE_FORMAT_YV12;
+    }
+    else if (subType == MFVideoFormat_YUY2)
+    {
+        return SOFTWARE_FORMAT_YUY2;
+    }
+    else if (subType == MFVideoFormat_UYVY)
+    {
+        return SOFTWARE_FORMAT_UYVY;
+    }
+    else if (subType == MFVideoFormat_RGB32)
+    {
+        return SOFTWARE_FORMAT_RGB32;
+    }
+
+    return SOFTWARE_FORMAT_UNKNOWN;
+}
+
 //-------------------------------------------------------------------
 // Name: GetVideoDisplayArea
 // Description: get the display area from the media type.
@@ -1926,6 +2048,169 @@ HRESULT DX11VideoRenderer::CPresenter::ProcessFrameUsingD3D11( ID3D11Texture2D*
     return hr;
 }
 
+//-------------------------------------------------------------------
+// Name: ProcessFrameUsingSoftware
+// Description: Converts a frame in system memory into the back buffer,
+//              scaled and letterboxed as the video processor does.
+//-------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CPresenter::ProcessFrameUsingSoftware( IMFMediaBuffer* pBuffer, RECT rcDest, IMFSample** ppVideoOutFrame )
+{
+    HRESULT hr = S_OK;
+    IMF2DBuffer* p2DBuffer = NULL;
+    ID3D11Texture2D* pDXGIBackBuffer = NULL;
+    IMFSample* pRTSample = NULL;
+    IMFMediaBuffer* pRTBuffer = NULL;
+    BYTE* pbScanline0 = NULL;
+    LONG lPitch = 0;
+    BOOL fLocked = FALSE;
+
+    do
+    {
+        if (!m_softwareConverter.IsFormatSet())
+        {
+            hr = MF_E_INVALIDMEDIATYPE;
+            break;
+        }
+
+        // remember the original rectangles
+        RECT TRectOld = m_rcDstApp;
+        RECT SRectOld = m_rcSrcApp;
+        UpdateRectangles(&TRectOld, &SRectOld);
+
+        //Update destination rect with current client rect
+        m_rcDstApp = rcDest;
+
+        m_rcSrcApp.left = 0;
+        m_rcSrcApp.top = 0;
+        m_rcSrcApp.right = m_uiRealDisplayWidth;
+        m_rcSrcApp.bottom = m_uiRealDisplayHeight;
+
+        RECT TRect = m_rcDstApp;
+        RECT SRect = m_rcSrcApp;
+        UpdateRectangles(&TRect, &SRect);
+
+        const BOOL fDestRectChanged = !EqualRect(&TRect, &TRectOld);
+
+        if (!m_pSwapChain1 || fDestRectChanged)
+        {
+            hr = UpdateDXGISwapChain();
+            if (FAILED(hr))
+            {
+                break;
+            }
+        }
+
+        m_bCanProcessNextSample = FALSE;
+
+        // Get Backbuffer
+        hr = m_pSwapChain1->GetBuffer(0, __uuidof(ID3D11Texture2D), (void**)&pDXGIBackBuffer);
+        if (FAILED(hr))
+        {
+            break;
+        }
+
+        D3D11_TEXTURE2D_DESC backBufferDesc;
+        pDXGIBackBuffer->GetDesc(&backBufferDesc);
+
+        // IMF2DBuffer gives the pitch of the decoder; a plain buffer has the
+        // default stride of the media type
+        if (SUCCEEDED(pBuffer->QueryInterface(__uuidof(IMF2DBuffer), (LPVOID*)&p2DBuffer)))
+        {
+            hr = p2DBuffer->Lock2D(&pbScanline0, &lPitch);
+        }
+        else
+        {
+            BYTE* pbData = NULL;
+            DWORD cbLength = 0;
+
+            hr = pBuffer->Lock(&pbData, NULL, &cbLength);
+            if (SUCCEEDED(hr))
+            {
+                lPitch = m_lSoftwareStride;
+                pbScanline0 = (lPitch < 0) ? pbData + (size_t)(-lPitch) * (m_imageHeightInPixels - 1) : pbData;
+
+                if (cbLength < m_softwareConverter.FrameBytes(lPitch))
+                {
+                    pBuffer->Unlock();
+                    hr = MF_E_BUFFERTOOSMALL;
+                }
+            }
+        }
+
+        if (FAILED(hr))
+        {
+            break;
+        }
+
+        fLocked = TRUE;
+
+        UINT uiFramePitch = backBufferDesc.Width * 4;
+        m_softwareFrame.resize((size_t)uiFramePitch * backBufferDesc.Height);
+
+        SoftwareRect rcSrc = { SRect.left, SRect.top, SRect.right, SRect.bottom };
+        SoftwareRect rcDst = { TRect.left, TRect.top, TRect.right, TRect.bottom };
+        m_softwareConverter.Convert(pbScanline0, lPitch, rcSrc, m_softwareFrame.data(), (int32_t)uiFramePitch, backBufferDesc.Width, backBufferDesc.Height, rcDst);
+
+        if (p2DBuffer != NULL)
+        {
+            p2DBuffer->Unlock2D();
+        }
+        else
+        {
+            pBuffer->Unlock();
+        }
+        fLocked = FALSE;
+
+        m_pD3DImmediateContext->UpdateSubresource(pDXGIBackBuffer, 0, NULL, m_softwareFrame.data(), uiFramePitch, 0);
+
+        // create the output media sample
+        hr = MFCreateSample(&pRTSample);
+        if (FAILED(hr))
+        {
+            break;
+        }
+
+        hr = MFCreateDXGISurfaceBuffer(__uuidof(ID3D11Texture2D), pDXGIBackBuffer, 0, FALSE, &pRTBuffer);
+        if (FAILED(hr))
+        {
+            break;
+        }
+
+        hr = pRTSample->AddBuffer(pRTBuffer);
+        if (FAILED(hr))
+        {
+            break;
+        }
+
+        if (ppVideoOutFrame != NULL)
+        {
+            *ppVideoOutFrame = pRTSample;
+            (*ppVideoOutFrame)->AddRef();
+        }
+    }
+    while (FALSE);
+
+    if (fLocked)
+    {
+        if (p2DBuffer != NULL)
+        {
+            p2DBuffer->Unlock2D();
+        }
+        else
+        {
+            pBuffer->Unlock();
+        }
+    }
+
+    SafeRelease(pRTBuffer);
+    SafeRelease(pRTSample);
+    SafeRelease(pDXGIBackBuffer);
+    SafeRelease(p2DBuffer);
+
+    return hr;
+}
+
 HRESULT DX11VideoRenderer::CPresenter::ProcessFrameUsingXVP( IMFMediaType* pCurrentType, IMFSample* pVideoFrame, ID3D11Texture2D* pTexture2D, RECT rcDest, IMFSample** ppVideoOutFrame, BOOL* pbInputFrameUsed )
 {
     HRESULT hr = S_OK;
@@ -2237,6 +2522,60 @@ HRESULT DX11VideoRenderer::CPresenter::SetMonitor(UINT adapterID)
     return hr;
 }
 
+//-------------------------------------------------------------------
+// Name: SetSoftwareFormat
+// Description: Prepares the conversion of the frames in system memory.
+//-------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CPresenter::SetSoftwareFormat(IMFMediaType* pMediaType)
+{
+    HRESULT hr = S_OK;
+    GUID subType = GUID_NULL;
+    UINT32 uiWidth = 0, uiHeight = 0;
+    LONG lStride = 0;
+
+    do
+    {
+        hr = pMediaType->GetGUID(MF_MT_SUBTYPE, &subType);
+        if (FAILED(hr))
+        {
+            break;
+        }
+
+        hr = MFGetAttributeSize(pMediaType, MF_MT_FRAME_SIZE, &uiWidth, &uiHeight);
+        if (FAILED(hr))
+        {
+            break;
+        }
+
+        // Without the attributes: BT.709 from HD on, limited range
+        UINT32 uiMatrix = MFGetAttributeUINT32(pMediaType, MF_MT_YUV_MATRIX, uiHeight >= 720 ? MFVideoTransferMatrix_BT709 : MFVideoTransferMatrix_BT601);
+        UINT32 uiRange = MFGetAttributeUINT32(pMediaType, MF_MT_VIDEO_NOMINAL_RANGE, MFNominalRange_16_235);
+
+        if (!m_softwareConverter.SetFormat(GetSoftwareFormat(pMediaType), uiWidth, uiHeight,
+            MFVideoTransferMatrix_BT709 == uiMatrix ? SOFTWARE_MATRIX_BT709 : SOFTWARE_MATRIX_BT601, MFNominalRange_0_255 == uiRange))
+        {
+            hr = MF_E_INVALIDMEDIATYPE;
+            break;
+        }
+
+        hr = pMediaType->GetUINT32(MF_MT_DEFAULT_STRIDE, (UINT32*)&lStride);
+        if (FAILED(hr))
+        {
+            hr = MFGetStrideForBitmapInfoHeader(subType.Data1, uiWidth, &lStride);
+            if (FAILED(hr))
+            {
+                break;
+            }
+        }
+
+        m_lSoftwareStride = lStride;
+    }
+    while (FALSE);
+
+    return hr;
+}
+
 //+-------------------------------------------------------------------------
 //
 //  Member:     SetVideoContextParameters
@@ -2,6 +2,7 @@
 
 #include "Common.h"
 #include "display.h"
+#include "SoftwareConvert.h"
 
 namespace DX11VideoRenderer
 {
@@ -68,6 +69,7 @@ namespace DX11VideoRenderer
         HRESULT CreateXVP(void);
         HRESULT FindBOBProcessorIndex(DWORD* pIndex);
         HRESULT GetVideoDisplayArea(IMFMediaType* pType, MFVideoArea* pArea);
+        static SoftwareFormat GetSoftwareFormat(IMFMediaType* pType);
         void    LetterBoxDstRect(
                     LPRECT lprcLBDst,   // output letterboxed rectangle
                     const RECT& rcSrc,  // input source rectangle
@@ -82,6 +84,7 @@ namespace DX11VideoRenderer
                     int* pPictureAspectY
                     );
         HRESULT ProcessFrameUsingD3D11( ID3D11Texture2D* pLeftTexture2D, ID3D11Texture2D* pRightTexture2D, UINT dwLeftViewIndex, UINT dwRightViewIndex, RECT rcDest, UINT32 unInterlaceMode, IMFSample** ppVideoOutFrame );
+        HRESULT ProcessFrameUsingSoftware( IMFMediaBuffer* pBuffer, RECT rcDest, IMFSample** ppVideoOutFrame );
         HRESULT ProcessFrameUsingXVP( IMFMediaType* pCurrentType, IMFSample* pVideoFrame, ID3D11Texture2D* pTexture2D, RECT rcDest, IMFSample** ppVideoOutFrame, BOOL* pbInputFrameUsed );
         void    ReduceToLowestTerms(
                     int NumeratorIn,
@@ -90,6 +93,7 @@ namespace DX11VideoRenderer
                     int* pDenominatorOut
                     );
         HRESULT SetMonitor(UINT adapterID);
+        HRESULT SetSoftwareFormat(IMFMediaType* pMediaType);
         void    SetVideoContextParameters(ID3D11VideoContext* pVideoContext, const RECT* pSRect, const RECT* pTRect, UINT32 unInterlaceMode);
         HRESULT SetVideoMonitor(HWND hwndVideo);
         HRESULT SetXVPOutputMediaType(IMFMediaType* pType, DXGI_FORMAT vpOutputFormat);
@@ -139,6 +143,10 @@ namespace DX11VideoRenderer
         RECT                            m_rcDstApp;
         IMFTransform*                   m_pXVP;
         IMFVideoProcessorControl*       m_pXVPControl;
+        BOOL                            m_bSoftwarePresenter;       // No D3D11 video device: the frames are converted on the CPU.
+        CSoftwareConverter              m_softwareConverter;
+        LONG                            m_lSoftwareStride;          // Of the buffers without IMF2DBuffer (negative if bottom-up).
+        std::vector<BYTE>               m_softwareFrame;            // The converted frame, copied to the back buffer.
     };
 
     /////////////////////////////////////////////////////////////////////////////////////////////
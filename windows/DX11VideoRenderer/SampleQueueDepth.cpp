@@ -0,0 +1,157 @@
+#include "SampleQueueDepth.h"
+
+//-----------------------------------------------------------------------------
+// Constructor
+//-----------------------------------------------------------------------------
+
+DX11VideoRenderer::CSampleQueueDepth::CSampleQueueDepth(void) :
+    m_depth(DEFAULT_DEPTH),
+    m_minDepth(DEFAULT_MIN_DEPTH),
+    m_maxDepth(DEFAULT_MAX_DEPTH),
+    m_hnsLastArrival(-1),
+    m_hnsJitter(0),
+    m_sinceGrow(GROW_HOLDOFF_ARRIVALS),
+    m_fullStreak(0),
+    m_arrivals(0),
+    m_fullArrivals(0),
+    m_emptyArrivals(0),
+    m_totalQueued(0),
+    m_grows(0),
+    m_shrinks(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// SetBounds
+//
+// minDepth: At least 1 sample in flight (the one being presented is not
+//           counted).
+// maxDepth: At most MAX_DEPTH.
+//-----------------------------------------------------------------------------
+
+bool DX11VideoRenderer::CSampleQueueDepth::SetBounds(uint32_t minDepth, uint32_t maxDepth)
+{
+    if (minDepth < 1 || maxDepth < minDepth || maxDepth > MAX_DEPTH)
+    {
+        return false;
+    }
+
+    m_minDepth = minDepth;
+    m_maxDepth = maxDepth;
+    if (m_depth < m_minDepth)
+    {
+        m_depth = m_minDepth;
+    }
+    if (m_depth > m_maxDepth)
+    {
+        m_depth = m_maxDepth;
+    }
+    m_fullStreak = 0;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// OnSampleArrived
+//
+// hnsArrival:  System time of the arrival, in 100ns units.
+// queued:      Samples waiting in the queue, before this one.
+// hnsPerFrame: Frame interval, in 100ns units (0: the jitter is not estimated).
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CSampleQueueDepth::OnSampleArrived(int64_t hnsArrival, uint32_t queued, int64_t hnsPerFrame)
+{
+    m_arrivals++;
+    m_totalQueued += queued;
+    if (queued == 0)
+    {
+        m_emptyArrivals++;
+    }
+
+    if (m_hnsLastArrival >= 0 && hnsPerFrame > 0)
+    {
+        int64_t hnsDeviation = (hnsArrival - m_hnsLastArrival) - hnsPerFrame;
+        if (hnsDeviation < 0)
+        {
+            hnsDeviation = -hnsDeviation;
+        }
+        m_hnsJitter += (hnsDeviation - m_hnsJitter) / 16;
+    }
+    m_hnsLastArrival = hnsArrival;
+    if (m_sinceGrow < GROW_HOLDOFF_ARRIVALS)
+    {
+        m_sinceGrow++;
+    }
+
+    // With this one, the queue holds all the samples allowed in flight (no
+    // request outstanding): the decoder keeps up with the depth.
+    if (queued + 1 >= m_depth)
+    {
+        m_fullArrivals++;
+        m_fullStreak++;
+    }
+    else
+    {
+        m_fullStreak = 0;
+    }
+
+    if (hnsPerFrame <= 0)
+    {
+        return;
+    }
+
+    if (m_hnsJitter > hnsPerFrame)
+    {
+        if (m_depth < m_maxDepth && m_sinceGrow >= GROW_HOLDOFF_ARRIVALS)
+        {
+            m_depth++;
+            m_grows++;
+            m_sinceGrow = 0;
+        }
+        m_fullStreak = 0;
+    }
+    else if (m_fullStreak >= SHRINK_AFTER_FULL_ARRIVALS && m_hnsJitter <= hnsPerFrame / 2)
+    {
+        if (m_depth > m_minDepth)
+        {
+            m_depth--;
+            m_shrinks++;
+        }
+        m_fullStreak = 0;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// GetStats
+//-----------------------------------------------------------------------------
+
+DX11VideoRenderer::SampleQueueStats DX11VideoRenderer::CSampleQueueDepth::GetStats(void) const
+{
+    SampleQueueStats stats;
+    stats.depth = m_depth;
+    stats.minDepth = m_minDepth;
+    stats.maxDepth = m_maxDepth;
+    stats.hnsJitter = m_hnsJitter;
+    stats.arrivals = m_arrivals;
+    stats.fullArrivals = m_fullArrivals;
+    stats.emptyArrivals = m_emptyArrivals;
+    stats.averageOccupancy = m_arrivals > 0 ? static_cast<double>(m_totalQueued) / m_arrivals : 0;
+    stats.grows = m_grows;
+    stats.shrinks = m_shrinks;
+    return stats;
+}
+
+//-----------------------------------------------------------------------------
+// ResetStats
+//
+// Clears the counters, for a new playback. The depth reached is kept.
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CSampleQueueDepth::ResetStats(void)
+{
+    m_arrivals = 0;
+    m_fullArrivals = 0;
+    m_emptyArrivals = 0;
+    m_totalQueued = 0;
+    m_grows = 0;
+    m_shrinks = 0;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+// Platform-neutral depth of the CStreamSink sample queue: how many samples are kept in flight
+// (queued + requested from the decoder). Fed with the arrival times of the samples and the
+// queue occupancy, so it can be replayed against simulated arrivals (no Windows header).
+
+#include <cstdint>
+
+namespace DX11VideoRenderer
+{
+    struct SampleQueueStats
+    {
+        uint32_t depth = 0;             // current target
+        uint32_t minDepth = 0;
+        uint32_t maxDepth = 0;
+        int64_t hnsJitter = 0;          // smoothed deviation of the arrival interval from the frame interval
+        int64_t arrivals = 0;
+        int64_t fullArrivals = 0;       // the queue held 'depth' samples with the arriving one
+        int64_t emptyArrivals = 0;      // the queue was empty: the renderer was waiting for the decoder
+        double averageOccupancy = 0;    // samples queued, seen at each arrival
+        int64_t grows = 0;
+        int64_t shrinks = 0;
+    };
+
+    //-----------------------------------------------------------------------------
+    // CSampleQueueDepth
+    //
+    // The jitter is estimated as in RFC 3550 (a 1/16 moving average of how far
+    // each arrival interval is from the frame interval). The depth grows by one
+    // while it exceeds a frame interval (decode or network hiccups would starve
+    // the queue), at most once per GROW_HOLDOFF_ARRIVALS for the effect to show.
+    // It shrinks by one after SHRINK_AFTER_FULL_ARRIVALS arrivals in a row to a
+    // full queue with a low jitter, the extra samples only adding latency.
+    //-----------------------------------------------------------------------------
+
+    class CSampleQueueDepth
+    {
+    public:
+
+        static const uint32_t DEFAULT_DEPTH = 3;
+        static const uint32_t DEFAULT_MIN_DEPTH = 2;
+        static const uint32_t DEFAULT_MAX_DEPTH = 8;
+        static const uint32_t MAX_DEPTH = 32;
+        static const int GROW_HOLDOFF_ARRIVALS = 8;
+        static const int SHRINK_AFTER_FULL_ARRIVALS = 120;
+
+        CSampleQueueDepth(void);
+
+        // The depth is clamped to the new bounds; false if they are not valid
+        bool SetBounds(uint32_t minDepth, uint32_t maxDepth);
+        uint32_t Depth(void) const { return m_depth; }
+        uint32_t MaxDepth(void) const { return m_maxDepth; }
+
+        // A sample arrived at 'hnsArrival' (system time), with 'queued' samples
+        // already waiting. 'hnsPerFrame' is the frame interval, 0 if unknown.
+        void OnSampleArrived(int64_t hnsArrival, uint32_t queued, int64_t hnsPerFrame);
+
+        // After a flush or a pause: the next interval is not an arrival interval
+        void Restart(void) { m_hnsLastArrival = -1; m_fullStreak = 0; }
+
+        SampleQueueStats GetStats(void) const;
+        void ResetStats(void);
+
+    private:
+
+        uint32_t    m_depth;
+        uint32_t    m_minDepth;
+        uint32_t    m_maxDepth;
+        int64_t     m_hnsLastArrival;   // -1 before the first arrival
+        int64_t     m_hnsJitter;
+        int         m_sinceGrow;
+        int         m_fullStreak;
+        int64_t     m_arrivals;
+        int64_t     m_fullArrivals;
+        int64_t     m_emptyArrivals;
+        int64_t     m_totalQueued;
+        int64_t     m_grows;
+        int64_t     m_shrinks;
+    };
+}
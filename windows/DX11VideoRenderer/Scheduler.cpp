@@ -4,19 +4,21 @@
 // Constructor
 //-----------------------------------------------------------------------------
 
-DX11VideoRenderer::CScheduler::CScheduler(CCritSec& critSec) :
+DX11VideoRenderer::CScheduler::CScheduler(CSharedCritSec* pCritSec) :
     m_nRefCount(1),
-    m_critSec(critSec),
+    m_pCritSec(pCritSec),
+    m_critSec(*pCritSec),
     m_pCB(NULL),
     m_ScheduledSamples(), // default ctor
     m_pClock(NULL),
-    m_fRate(1.0f),
-    m_hWaitTimer(NULL),
+    m_pTimerWheel(NULL),
     m_LastSampleTime(0),
     m_PerFrameInterval(0),
-    m_PerFrame_1_4th(0),
-    m_keyTimer(0)
+    m_keyTimer(0),
+    m_lFlushGeneration(0),
+    m_core(static_cast<SchedulerClock&>(*this), static_cast<SchedulerWaiter&>(*this))
 {
+    m_pCritSec->AddRef();
 }
 
 
@@ -26,17 +28,18 @@ DX11VideoRenderer::CScheduler::CScheduler(CCritSec& critSec) :
 
 DX11VideoRenderer::CScheduler::~CScheduler(void)
 {
-    if (m_hWaitTimer != NULL)
-    {
-        CloseHandle(m_hWaitTimer);
-        m_hWaitTimer = NULL;
-    }
-
     // Discard samples.
     m_ScheduledSamples.Clear();
     Flush(); //Jacky, cancel timer
 
+    if (m_pTimerWheel != NULL)
+    {
+        m_pTimerWheel->Release();
+        m_pTimerWheel = NULL;
+    }
+
     SafeRelease(m_pClock);
+    SafeRelease(m_pCritSec);
 }
 
 // IUnknown methods
@@ -89,9 +92,60 @@ void DX11VideoRenderer::CScheduler::SetFrameRate(const MFRatio& fps)
     MFFrameRateToAverageTimePerFrame(fps.Numerator, fps.Denominator, &AvgTimePerFrame);
 
     m_PerFrameInterval = (MFTIME)AvgTimePerFrame;
+    m_core.SetFrameInterval(m_PerFrameInterval);
+}
+
+//-----------------------------------------------------------------------------
+// SetFrameInterval
+// Specifies the duration of a frame (100ns units), as estimated from the
+// sample times while playing: the next decisions use it.
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CScheduler::SetFrameInterval(MFTIME hnsPerFrame)
+{
+    CAutoLock lock(&m_critSec);
+
+    m_PerFrameInterval = hnsPerFrame;
+    m_core.SetFrameInterval(m_PerFrameInterval);
+}
+
+//-----------------------------------------------------------------------------
+// SetThinned
+// Keyframe-only delivery: late keyframes are presented, not dropped.
+//-----------------------------------------------------------------------------
 
-    // Calculate 1/4th of this value, because we use it frequently.
-    m_PerFrame_1_4th = m_PerFrameInterval / 4;
+void DX11VideoRenderer::CScheduler::SetThinned(BOOL bThinned)
+{
+    CAutoLock lock(&m_critSec);
+    m_core.SetThinned(bThinned != FALSE);
+}
+
+//-----------------------------------------------------------------------------
+// SetDropThreshold
+// Samples later than this many frames are dropped (0: never dropped).
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CScheduler::SetDropThreshold(float frames)
+{
+    CAutoLock lock(&m_critSec);
+    m_core.SetDropThreshold(frames);
+}
+
+//-----------------------------------------------------------------------------
+// GetStats
+// Presented, late and dropped samples since the playback started.
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CScheduler::GetStats(SchedulerStats* pStats)
+{
+    CAutoLock lock(&m_critSec);
+    *pStats = m_core.Stats();
+}
+
+void DX11VideoRenderer::CScheduler::ResetStats(void)
+{
+    CAutoLock lock(&m_critSec);
+    m_core.ResetStats();
 }
 
 
@@ -107,6 +161,8 @@ HRESULT DX11VideoRenderer::CScheduler::StartScheduler(IMFClock* pClock)
 {
     HRESULT hr = S_OK;
 
+    CAutoLock lock(&m_critSec);
+
     SafeRelease(m_pClock);
     m_pClock = pClock;
     if (m_pClock != NULL)
@@ -114,14 +170,10 @@ HRESULT DX11VideoRenderer::CScheduler::StartScheduler(IMFClock* pClock)
         m_pClock->AddRef();
     }
 
-    // Set a high the timer resolution (ie, short timer period).
-    timeBeginPeriod(1);
-
-    // create the waitable timer
-    m_hWaitTimer = CreateWaitableTimer(NULL, FALSE, NULL);
-    if (m_hWaitTimer == NULL)
+    // The clock restarts after a pause: the wheel is kept.
+    if (m_pTimerWheel == NULL)
     {
-        hr = HRESULT_FROM_WIN32(GetLastError());
+        hr = CTimerWheel::Acquire(&m_pTimerWheel);
     }
 
     return hr;
@@ -138,24 +190,18 @@ HRESULT DX11VideoRenderer::CScheduler::StopScheduler(void)
 {
     CAutoLock lock(&m_critSec);
 
-    if (m_keyTimer != 0) // Jacky {}
-    {
-        (void)MFCancelWorkItem(m_keyTimer);
-        m_keyTimer = 0;
-    }
-
+    CancelWait(); // Jacky {}
 
-    if (m_hWaitTimer != NULL)
+    // The thread of the wheel stops with its last scheduler.
+    if (m_pTimerWheel != NULL)
     {
-        CloseHandle(m_hWaitTimer);
-        m_hWaitTimer = NULL;
+        m_pTimerWheel->Release();
+        m_pTimerWheel = NULL;
     }
 
-    // Discard samples.
+    // Discard samples, and the one being processed.
     m_ScheduledSamples.Clear();
-
-    // Restore the timer resolution.
-    timeEndPeriod(1);
+    m_lFlushGeneration++;
 
     SafeRelease(m_pClock);
 
@@ -176,15 +222,15 @@ HRESULT DX11VideoRenderer::CScheduler::Flush(void)
 {
     CAutoLock lock(&m_critSec);
 
-    // Flushing: Clear the sample queue and set the event.
+    // Flushing: Clear the sample queue. A sample dequeued before is discarded
+    // by its work item (see ProcessSample).
     m_ScheduledSamples.Clear();
+    m_lFlushGeneration++;
 
     // Cancel timer callback
-    if (m_keyTimer != 0)
-    {
-        (void)MFCancelWorkItem(m_keyTimer);
-        m_keyTimer = 0;
-    }
+    CancelWait();
+
+    m_core.ResetLag();
 
     return S_OK;
 }
@@ -234,44 +280,50 @@ HRESULT DX11VideoRenderer::CScheduler::ScheduleSample(IMFSample* pSample, BOOL b
 //
 // Processes all the samples in the queue.
 //
-// plNextSleep: Receives the length of time the scheduler thread should sleep
-//              before it calls ProcessSamplesInQueue again.
+// phnsNextSleep: Receives the length of time (100ns units) the scheduler
+//                should sleep before it calls ProcessSamplesInQueue again.
 //-----------------------------------------------------------------------------
 
-HRESULT DX11VideoRenderer::CScheduler::ProcessSamplesInQueue(LONG* plNextSleep)
+HRESULT DX11VideoRenderer::CScheduler::ProcessSamplesInQueue(LONGLONG* phnsNextSleep)
 {
     HRESULT hr = S_OK;
-    LONG lWait = 0;
+    LONGLONG hnsWait = 0;
     IMFSample* pSample = NULL;
 
     // Process samples until the queue is empty or until the wait time > 0.
 
     // Note: Dequeue returns S_FALSE when the queue is empty.
 
-    while (m_ScheduledSamples.Dequeue(&pSample) == S_OK)
+    for (;;)
     {
+        LONG lFlushGeneration = 0;
+        {
+            CAutoLock lock(&m_critSec);
+
+            if (m_ScheduledSamples.Dequeue(&pSample) != S_OK)
+            {
+                break;
+            }
+            lFlushGeneration = m_lFlushGeneration;
+        }
+
         // Process the next sample in the queue. If the sample is not ready
-        // for presentation. the value returned in lWait is > 0, which
+        // for presentation. the value returned in hnsWait is > 0, which
         // means the scheduler should sleep for that amount of time.
 
-        hr = ProcessSample(pSample, &lWait);
+        hr = ProcessSample(pSample, lFlushGeneration, &hnsWait);
         SafeRelease(pSample);
 
-        if (FAILED(hr) || lWait > 0)
+        if (FAILED(hr) || hnsWait > 0)
         {
             break;
         }
     }
 
     // If the wait time is zero, it means we stopped because the queue is
-    // empty (or an error occurred). Set the wait time to infinite; this will
-    // make the scheduler thread sleep until it gets another thread message.
-    if (lWait == 0)
-    {
-        lWait = INFINITE;
-    }
-
-    *plNextSleep = lWait;
+    // empty (or an error occurred). The scheduler then sleeps until the next
+    // sample is queued.
+    *phnsNextSleep = hnsWait;
     return hr;
 }
 
@@ -281,80 +333,80 @@ HRESULT DX11VideoRenderer::CScheduler::ProcessSamplesInQueue(LONG* plNextSleep)
 //
 // Processes a sample.
 //
-// plNextSleep: Receives the length of time the scheduler thread should sleep.
+// lFlushGeneration: m_lFlushGeneration when the sample was dequeued; the
+//                   sample is discarded if a flush or a stop happened since.
+// phnsNextSleep: Receives the length of time the scheduler should sleep.
 //-----------------------------------------------------------------------------
 
 
-HRESULT DX11VideoRenderer::CScheduler::ProcessSample(IMFSample* pSample, LONG* plNextSleep)
+HRESULT DX11VideoRenderer::CScheduler::ProcessSample(IMFSample* pSample, LONG lFlushGeneration, LONGLONG* phnsNextSleep)
 {
     HRESULT hr = S_OK;
 
     LONGLONG hnsPresentationTime = 0;
-    LONGLONG hnsTimeNow = 0;
-    MFTIME   hnsSystemTime = 0;
-    LONGLONG hnsDelta = 0;
-
-    BOOL bPresentNow = TRUE;
-    LONG lNextSleep = 0;
+    int64_t hnsNextSleep = 0;
+    ScheduleAction action = SCHEDULE_PRESENT;
+    int64_t hnsLag = 0;
+    bool bLagChanged = false;
 
-    if (m_pClock)
     {
-        // Get the sample's time stamp. It is valid for a sample to
-        // have no time stamp.
-        hr = pSample->GetSampleTime(&hnsPresentationTime);
+        CAutoLock lock(&m_critSec);
 
-        // Get the clock time. (But if the sample does not have a time stamp,
-        // we don't need the clock time.)
-        if (SUCCEEDED(hr))
+        if (lFlushGeneration != m_lFlushGeneration)
         {
-            hr = m_pClock->GetCorrelatedTime(0, &hnsTimeNow, &hnsSystemTime);
+            *phnsNextSleep = 0;
+            return S_OK;
         }
 
-        if (SUCCEEDED(hr))
+        // It is valid for a sample to have no time stamp: it is presented now.
+        if (m_pClock && SUCCEEDED(pSample->GetSampleTime(&hnsPresentationTime)))
         {
-            // Calculate the time until the sample's presentation time.
-            // A negative value means the sample is late.
-            hnsDelta = hnsPresentationTime - hnsTimeNow;
-            if (m_fRate < 0)
-            {
-                // For reverse playback, the clock runs backward. Therefore, the
-                // delta is reversed.
-                hnsDelta = - hnsDelta;
-            }
-
-            if (hnsDelta < - m_PerFrame_1_4th)
-            {
-                // This sample is late.
-                bPresentNow = TRUE;
-            }
-            else if (hnsDelta > (3 * m_PerFrame_1_4th))
-            {
-                // This sample is still too early. Go to sleep.
-                lNextSleep = static_cast<LONG>(TicksToMilliseconds(hnsDelta - (3 * m_PerFrame_1_4th)));
+            action = m_core.Schedule(hnsPresentationTime, &hnsNextSleep);
+        }
 
-                // Adjust the sleep time for the clock rate. (The presentation clock runs
-                // at m_fRate, but sleeping uses the system clock.)
-                lNextSleep = static_cast<LONG>(lNextSleep / fabsf(m_fRate));
+        if (action == SCHEDULE_WAIT)
+        {
+            // The sample is not ready yet. Return it to the queue.
+            hr = m_ScheduledSamples.PutBack(pSample);
+        }
+        else
+        {
+            bLagChanged = m_core.TakeLagChange(&hnsLag);
+        }
+    }
 
-                // Don't present yet.
-                bPresentNow = FALSE;
+    // The callbacks are made without the lock: presenting does not block the
+    // scheduling (nor, through the stream sink, the sample dispatch). A flush
+    // meanwhile discards the sample (the stream sink checks again).
+    if (action != SCHEDULE_WAIT)
+    {
+        CAutoLock lock(&m_critSec);
 
-                if (lNextSleep <= 0) bPresentNow = TRUE; //Jacky, prevent infinity-loop
-            }
+        if (lFlushGeneration != m_lFlushGeneration)
+        {
+            *phnsNextSleep = 0;
+            return S_OK;
         }
     }
 
-    if (bPresentNow)
+    if (action == SCHEDULE_PRESENT)
     {
         hr = m_pCB->PresentFrame();
+        hnsNextSleep = 0;
     }
-    else
+    else if (action == SCHEDULE_DROP)
     {
-        // The sample is not ready yet. Return it to the queue.
-        hr = m_ScheduledSamples.PutBack(pSample);
+        hr = m_pCB->DropFrame();
+        hnsNextSleep = 0;
     }
 
-    *plNextSleep = lNextSleep;
+    if (SUCCEEDED(hr) && bLagChanged)
+    {
+        // Failing to report the lag does not fail the sample.
+        m_pCB->NotifySampleLag(hnsLag);
+    }
+
+    *phnsNextSleep = hnsNextSleep;
 
     return hr;
 }
@@ -369,37 +421,21 @@ HRESULT DX11VideoRenderer::CScheduler::StartProcessSample()
 {
     HRESULT hr = S_OK;
 
-    LONG    lWait = INFINITE;
-    IMFAsyncResult *pAsyncResult = NULL;
+    LONGLONG hnsWait = 0;
 
-    hr = ProcessSamplesInQueue(&lWait);
+    hr = ProcessSamplesInQueue(&hnsWait);
 
-    if(SUCCEEDED(hr))
+    if (SUCCEEDED(hr) && hnsWait > 0)
     {
-        if(INFINITE != lWait && 0 < lWait)
-        {
-            // not time to process the frame yet, wait until the right time
-            LARGE_INTEGER llDueTime;
-            llDueTime.QuadPart = -1 * MillisecondsToTicks(lWait);
-            if (SetWaitableTimer(m_hWaitTimer, &llDueTime, 0, NULL, NULL, FALSE) == 0)
-            {
-                hr = HRESULT_FROM_WIN32(GetLastError());
-            }
+        CAutoLock lock(&m_critSec);
 
-            if(SUCCEEDED(hr))
-            {
-                // queue a waititem to wait for timer completion
-                hr = MFCreateAsyncResult(nullptr, &m_xOnTimer, nullptr, &pAsyncResult);
-                if(SUCCEEDED(hr))
-                {
-                    hr = MFPutWaitingWorkItem(m_hWaitTimer, 0, pAsyncResult, &m_keyTimer);
-                }
-            }
+        // not time to process the frame yet, wait until the right time
+        if (!m_core.Wait(hnsWait))
+        {
+            hr = E_FAIL;
         }
     }
 
-    SafeRelease(pAsyncResult);
-
     return hr;
 }
 
@@ -415,13 +451,94 @@ HRESULT DX11VideoRenderer::CScheduler::OnTimer(__RPC__in_opt IMFAsyncResult *pRe
 {
     HRESULT hr = S_OK;
 
-    CAutoLock lock(&m_critSec);
+    {
+        CAutoLock lock(&m_critSec);
 
-    m_keyTimer = 0;
+        // The timer that fired is not armed anymore; a newer one, armed
+        // since by another work item, is kept to be cancelled.
+        if (m_keyTimer != 0 && (m_pTimerWheel == NULL || !m_pTimerWheel->IsArmed(m_keyTimer)))
+        {
+            m_keyTimer = 0;
+        }
 
-    // if we have a pending frame, process it
+        // One work item is posted per sample: a single one processes the
+        // queue at a time, the others have it processed once more.
+        if (!m_core.BeginProcessing())
+        {
+            return S_OK;
+        }
+    }
+
+    // if we have a pending frame, process it (the lock is only taken around
+    // the decisions, not while presenting)
     // it's possible that we don't have a frame at this point if the pending frame was cancelled
-    hr = StartProcessSample();
+    for (;;)
+    {
+        hr = StartProcessSample();
+
+        CAutoLock lock(&m_critSec);
+        if (!m_core.EndProcessing())
+        {
+            break;
+        }
+    }
 
     return hr;
-}
\ No newline at end of file
+}
+
+//-----------------------------------------------------------------------------
+// GetClockTime
+//
+// SchedulerClock: the time of the presentation clock.
+//-----------------------------------------------------------------------------
+
+bool DX11VideoRenderer::CScheduler::GetClockTime(int64_t* phnsTime)
+{
+    LONGLONG hnsTimeNow = 0;
+    MFTIME hnsSystemTime = 0;
+
+    if (m_pClock == NULL || FAILED(m_pClock->GetCorrelatedTime(0, &hnsTimeNow, &hnsSystemTime)))
+    {
+        return false;
+    }
+    *phnsTime = hnsTimeNow;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// WaitFor
+//
+// SchedulerWaiter: OnTimer is called after hnsDelay (100ns units), up to
+// hnsSlack later, from the timer wheel. Called with the critical section held.
+//-----------------------------------------------------------------------------
+
+bool DX11VideoRenderer::CScheduler::WaitFor(int64_t hnsDelay, int64_t hnsSlack)
+{
+    if (m_pTimerWheel == NULL)
+    {
+        return false;
+    }
+
+    // One timer at a time: a new wait replaces the pending one.
+    CancelWait();
+
+    return SUCCEEDED(m_pTimerWheel->Arm(hnsDelay, hnsSlack, &m_xOnTimer, &m_keyTimer));
+}
+
+//-----------------------------------------------------------------------------
+// CancelWait
+//
+// SchedulerWaiter: cancels the pending OnTimer call, if any.
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CScheduler::CancelWait(void)
+{
+    if (m_keyTimer != 0)
+    {
+        if (m_pTimerWheel != NULL)
+        {
+            m_pTimerWheel->Cancel(m_keyTimer);
+        }
+        m_keyTimer = 0;
+    }
+}
@@ -1,18 +1,23 @@
 #pragma once
 
 #include "Common.h"
+#include "SchedulerCore.h"
+#include "TimerWheel.h"
 
 namespace DX11VideoRenderer
 {
     //-----------------------------------------------------------------------------
     // SchedulerCallback
     //
-    // Defines the callback method to present samples.
+    // Defines the callback methods to present samples, to skip the samples
+    // dropped for lateness, and to report the lag upstream (quality feedback).
     //-----------------------------------------------------------------------------
 
     struct SchedulerCallback
     {
         virtual HRESULT PresentFrame(void) = 0;
+        virtual HRESULT DropFrame(void) = 0;
+        virtual HRESULT NotifySampleLag(LONGLONG hnsLag) = 0;
     };
 
     //-----------------------------------------------------------------------------
@@ -31,15 +36,21 @@ namespace DX11VideoRenderer
     //
     // The caller has the option of presenting samples immediately (for example,
     // for repaints).
+    //
+    // The decisions are made by CSchedulerCore. This class gives it the
+    // presentation clock, and its timers on the CTimerWheel of the process (one
+    // thread and one high-resolution timer for all the schedulers).
     //-----------------------------------------------------------------------------
 
     class CScheduler:
         public IUnknown,
-        private CBase
+        private CBase,
+        private SchedulerClock,
+        private SchedulerWaiter
     {
     public:
 
-        CScheduler(CCritSec& critSec);
+        CScheduler(CSharedCritSec* pCritSec);
         virtual ~CScheduler(void);
 
         // IUnknown
@@ -53,7 +64,12 @@ namespace DX11VideoRenderer
         }
 
         void SetFrameRate(const MFRatio& fps);
-        void SetClockRate(float fRate) { m_fRate = fRate; }
+        void SetFrameInterval(MFTIME hnsPerFrame);
+        void SetClockRate(float fRate) { m_core.SetRate(fRate); }
+        void SetThinned(BOOL bThinned);
+        void SetDropThreshold(float frames);
+        void GetStats(SchedulerStats* pStats);
+        void ResetStats(void);
 
         const LONGLONG& LastSampleTime(void) const { return m_LastSampleTime; }
         const LONGLONG& FrameDuration(void) const { return m_PerFrameInterval; }
@@ -62,8 +78,8 @@ namespace DX11VideoRenderer
         HRESULT StopScheduler(void);
 
         HRESULT ScheduleSample(IMFSample* pSample, BOOL bPresentNow);
-        HRESULT ProcessSamplesInQueue(LONG* plNextSleep);
-        HRESULT ProcessSample(IMFSample* pSample, LONG* plNextSleep);
+        HRESULT ProcessSamplesInQueue(LONGLONG* phnsNextSleep);
+        HRESULT ProcessSample(IMFSample* pSample, LONG lFlushGeneration, LONGLONG* phnsNextSleep);
         HRESULT Flush(void);
 
         DWORD GetCount(void){ return m_ScheduledSamples.GetCount(); }
@@ -74,16 +90,24 @@ namespace DX11VideoRenderer
         HRESULT OnTimer(__RPC__in_opt IMFAsyncResult* pResult);
         METHODASYNCCALLBACKEX(OnTimer, CScheduler, 0, MFASYNC_CALLBACK_QUEUE_MULTITHREADED);
 
+        // SchedulerClock
+        bool GetClockTime(int64_t* phnsTime);
+
+        // SchedulerWaiter
+        bool WaitFor(int64_t hnsDelay, int64_t hnsSlack);
+        void CancelWait(void);
+
         long                        m_nRefCount;
-        CCritSec&                   m_critSec;          // critical section for thread safety
+        CSharedCritSec*             m_pCritSec;         // Lock domain of the sink, referenced.
+        CCritSec&                   m_critSec;          // critical section for thread safety, not held while presenting
         SchedulerCallback*          m_pCB;              // Weak reference; do not delete.
         ThreadSafeQueue<IMFSample>  m_ScheduledSamples; // Samples waiting to be presented.
         IMFClock*                   m_pClock;           // Presentation clock. Can be NULL.
-        float                       m_fRate;            // Playback rate.
-        HANDLE                      m_hWaitTimer;       // Wait Timer after which frame is presented.
+        CTimerWheel*                m_pTimerWheel;      // Acquired while started.
         MFTIME                      m_LastSampleTime;   // Most recent sample time.
         MFTIME                      m_PerFrameInterval; // Duration of each frame.
-        LONGLONG                    m_PerFrame_1_4th;   // 1/4th of the frame duration.
         MFWORKITEM_KEY              m_keyTimer;
+        LONG                        m_lFlushGeneration; // Bumped by Flush and StopScheduler: older samples are discarded.
+        CSchedulerCore              m_core;             // Presentation decisions.
     };
 }
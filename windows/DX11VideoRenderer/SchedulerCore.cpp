@@ -0,0 +1,238 @@
+#include "SchedulerCore.h"
+
+#include <cmath>
+
+//-----------------------------------------------------------------------------
+// Constructor
+//-----------------------------------------------------------------------------
+
+DX11VideoRenderer::CSchedulerCore::CSchedulerCore(SchedulerClock& clock, SchedulerWaiter& waiter) :
+    m_clock(clock),
+    m_waiter(waiter),
+    m_fRate(1.0f),
+    m_hnsPerFrame(0),
+    m_hnsPerFrame_1_4th(0),
+    m_isThinned(false),
+    m_dropThresholdFrames(DEFAULT_DROP_THRESHOLD_FRAMES),
+    m_consecutiveDrops(0),
+    m_hnsLag(0),
+    m_isLagReported(false),
+    m_isProcessing(false),
+    m_isProcessAgain(false)
+{
+}
+
+//-----------------------------------------------------------------------------
+// SetFrameInterval
+// Specifies the duration of a frame, in 100ns units.
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CSchedulerCore::SetFrameInterval(int64_t hnsPerFrame)
+{
+    m_hnsPerFrame = hnsPerFrame;
+
+    // Calculate 1/4th of this value, because we use it frequently.
+    m_hnsPerFrame_1_4th = m_hnsPerFrame / 4;
+}
+
+//-----------------------------------------------------------------------------
+// SetThinned
+// Only keyframes are delivered (trick play above the thinning rate).
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CSchedulerCore::SetThinned(bool isThinned)
+{
+    m_isThinned = isThinned;
+    m_consecutiveDrops = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Schedule
+//
+// hnsSampleTime: Presentation time of the sample.
+// phnsWait:      Receives the system time to wait, for SCHEDULE_WAIT.
+//-----------------------------------------------------------------------------
+
+DX11VideoRenderer::ScheduleAction DX11VideoRenderer::CSchedulerCore::Schedule(int64_t hnsSampleTime, int64_t* phnsWait)
+{
+    int64_t hnsTimeNow = 0;
+    *phnsWait = 0;
+
+    // Without a clock (or while scrubbing at rate 0), samples are presented as they come.
+    if (!m_clock.GetClockTime(&hnsTimeNow) || m_fRate == 0)
+    {
+        m_stats.presented++;
+        return SCHEDULE_PRESENT;
+    }
+
+    // Calculate the time until the sample's presentation time.
+    // A negative value means the sample is late.
+    int64_t hnsDelta = hnsSampleTime - hnsTimeNow;
+    if (m_fRate < 0)
+    {
+        // For reverse playback, the clock runs backward. Therefore, the
+        // delta is reversed.
+        hnsDelta = -hnsDelta;
+    }
+
+    if (hnsDelta < -m_hnsPerFrame_1_4th)
+    {
+        // This sample is late.
+        return OnLate(-hnsDelta);
+    }
+    if (hnsDelta <= 3 * m_hnsPerFrame_1_4th)
+    {
+        // On time.
+        m_consecutiveDrops = 0;
+        m_hnsLag = 0;
+        m_stats.presented++;
+        return SCHEDULE_PRESENT;
+    }
+
+    // Too early: wait until the window opens. The presentation clock runs at
+    // m_fRate, the timer on the system clock.
+    *phnsWait = static_cast<int64_t>((hnsDelta - 3 * m_hnsPerFrame_1_4th) / fabsf(m_fRate));
+    if (*phnsWait > 0)
+    {
+        return SCHEDULE_WAIT;
+    }
+    m_consecutiveDrops = 0;
+    m_hnsLag = 0;
+    m_stats.presented++;
+    return SCHEDULE_PRESENT;
+}
+
+//-----------------------------------------------------------------------------
+// Wait
+//
+// Arms the waiter for the start of the window. Waking up to 1/4 frame later
+// still presents the sample early enough (half a frame before its time).
+//-----------------------------------------------------------------------------
+
+bool DX11VideoRenderer::CSchedulerCore::Wait(int64_t hnsWait)
+{
+    int64_t hnsSlack = m_fRate != 0 ? static_cast<int64_t>(m_hnsPerFrame_1_4th / fabsf(m_fRate)) : 0;
+    return m_waiter.WaitFor(hnsWait, hnsSlack);
+}
+
+//-----------------------------------------------------------------------------
+// BeginProcessing
+//
+// A queue processed by two work items at once could present a sample while
+// the other one puts an earlier sample back (out of order). The refused
+// caller leaves it to the one processing.
+//-----------------------------------------------------------------------------
+
+bool DX11VideoRenderer::CSchedulerCore::BeginProcessing(void)
+{
+    if (m_isProcessing)
+    {
+        m_isProcessAgain = true;
+        return false;
+    }
+    m_isProcessing = true;
+    m_isProcessAgain = false;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// EndProcessing
+//
+// True if the queue must be processed again: samples were queued (or a timer
+// fired) while it was processed.
+//-----------------------------------------------------------------------------
+
+bool DX11VideoRenderer::CSchedulerCore::EndProcessing(void)
+{
+    if (m_isProcessAgain)
+    {
+        m_isProcessAgain = false;
+        return true;
+    }
+    m_isProcessing = false;
+    return false;
+}
+
+//-----------------------------------------------------------------------------
+// OnLate
+//
+// hnsLate: How late the sample is, in presentation time.
+//-----------------------------------------------------------------------------
+
+DX11VideoRenderer::ScheduleAction DX11VideoRenderer::CSchedulerCore::OnLate(int64_t hnsLate)
+{
+    m_hnsLag = m_isThinned ? 0 : hnsLate;
+    m_stats.hnsTotalLateness += hnsLate;
+    if (hnsLate > m_stats.hnsMaxLateness)
+    {
+        m_stats.hnsMaxLateness = hnsLate;
+    }
+
+    int64_t hnsThreshold = static_cast<int64_t>(m_dropThresholdFrames * m_hnsPerFrame);
+    if (!m_isThinned && m_dropThresholdFrames > 0 && hnsLate > hnsThreshold && m_consecutiveDrops < MAX_CONSECUTIVE_DROPS)
+    {
+        m_consecutiveDrops++;
+        m_stats.dropped++;
+        return SCHEDULE_DROP;
+    }
+
+    m_consecutiveDrops = 0;
+    m_stats.late++;
+    m_stats.presented++;
+    return SCHEDULE_PRESENT;
+}
+
+//-----------------------------------------------------------------------------
+// TakeLagChange
+//
+// phnsLag: Receives the lag to report upstream, when it returns true.
+//-----------------------------------------------------------------------------
+
+bool DX11VideoRenderer::CSchedulerCore::TakeLagChange(int64_t* phnsLag)
+{
+    int64_t hnsChange = m_hnsLag - m_stats.hnsLag;
+    if (hnsChange < 0)
+    {
+        hnsChange = -hnsChange;
+    }
+
+    // Back on time is always reported, other changes from half a frame.
+    bool bReport = m_isLagReported ? (hnsChange > 0 && (m_hnsLag == 0 || hnsChange >= m_hnsPerFrame / 2)) : m_hnsLag > 0;
+    if (!bReport)
+    {
+        return false;
+    }
+
+    m_isLagReported = true;
+    m_stats.hnsLag = m_hnsLag;
+    m_stats.lagReports++;
+    *phnsLag = m_hnsLag;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// ResetLag
+//
+// Nothing is reported upstream until the next late sample (the pipeline
+// resets its quality state on a flush as well).
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CSchedulerCore::ResetLag(void)
+{
+    m_consecutiveDrops = 0;
+    m_hnsLag = 0;
+    m_isLagReported = false;
+    m_stats.hnsLag = 0;
+}
+
+//-----------------------------------------------------------------------------
+// ResetStats
+//
+// Clears the counters, for a new playback.
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CSchedulerCore::ResetStats(void)
+{
+    ResetLag();
+    m_stats = SchedulerStats();
+}
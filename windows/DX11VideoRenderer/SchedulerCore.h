@@ -0,0 +1,128 @@
+#pragma once
+
+// Platform-neutral part of CScheduler: when a sample is presented, from the presentation
+// clock, the frame rate and the playback rate. The clock and the timer are injected, so the
+// decisions can be replayed against a simulated clock (no Windows or Media Foundation header).
+
+#include <cstdint>
+
+namespace DX11VideoRenderer
+{
+    //-----------------------------------------------------------------------------
+    // SchedulerClock
+    //
+    // Presentation clock read by the scheduler, in 100ns units.
+    //-----------------------------------------------------------------------------
+
+    struct SchedulerClock
+    {
+        virtual bool GetClockTime(int64_t* phnsTime) = 0; // false if the clock can't be read
+    };
+
+    //-----------------------------------------------------------------------------
+    // SchedulerWaiter
+    //
+    // One-shot timer calling the scheduler back after a delay of system time, in
+    // 100ns units (not rounded to milliseconds), or up to a slack later, to share
+    // a wakeup with the timers of other schedulers.
+    //-----------------------------------------------------------------------------
+
+    struct SchedulerWaiter
+    {
+        virtual bool WaitFor(int64_t hnsDelay, int64_t hnsSlack) = 0;
+        virtual void CancelWait(void) = 0;
+    };
+
+    enum ScheduleAction
+    {
+        SCHEDULE_PRESENT, // on time or late: present now
+        SCHEDULE_WAIT,    // early: wait, then decide again
+        SCHEDULE_DROP,    // later than the drop threshold: not presented
+    };
+
+    struct SchedulerStats
+    {
+        int64_t presented = 0;
+        int64_t late = 0;             // presented after their window (more than 1/4 frame late)
+        int64_t dropped = 0;
+        int64_t hnsMaxLateness = 0;   // of the late and dropped samples, presentation time
+        int64_t hnsTotalLateness = 0;
+        int64_t hnsLag = 0;           // last reported upstream (MF_QUALITY_NOTIFY_SAMPLE_LAG)
+        int64_t lagReports = 0;
+    };
+
+    //-----------------------------------------------------------------------------
+    // CSchedulerCore
+    //
+    // A sample is presented from 3/4 of a frame before its time (the swap chain
+    // shows it on a following vsync) to 1/4 of a frame after it. Earlier than
+    // that, the waiter is armed for the start of that window, scaled by the
+    // playback rate (the clock runs at the rate, the timer at system time).
+    //
+    // QoS: a sample later than the drop threshold is dropped, so the renderer
+    // catches up instead of presenting a burst of stale frames; at most
+    // MAX_CONSECUTIVE_DROPS in a row, for the picture not to freeze. The lag is
+    // reported upstream when it changes by half a frame, for the decoder to skip
+    // non-reference frames until it is back on time.
+    //
+    // Thinned (keyframe-only trick play): the keyframes are spaced out by their
+    // times over the rate, like any sample, but a late one is never dropped
+    // (it stands for its whole GOP) nor reported (the decoder has nothing left
+    // to skip).
+    //-----------------------------------------------------------------------------
+
+    class CSchedulerCore
+    {
+    public:
+
+        static const int MAX_CONSECUTIVE_DROPS = 4;
+        static constexpr float DEFAULT_DROP_THRESHOLD_FRAMES = 2.0f;
+
+        CSchedulerCore(SchedulerClock& clock, SchedulerWaiter& waiter);
+
+        void SetFrameInterval(int64_t hnsPerFrame);
+        // Lateness (in frames) from which samples are dropped, 0 never drops
+        void SetDropThreshold(float frames) { m_dropThresholdFrames = frames; }
+        void SetRate(float fRate) { m_fRate = fRate; }
+        void SetThinned(bool isThinned);
+        int64_t FrameInterval(void) const { return m_hnsPerFrame; }
+
+        // Decision for a sample due at 'hnsSampleTime'. For SCHEDULE_WAIT, *phnsWait
+        // receives the system time to wait before deciding again.
+        ScheduleAction Schedule(int64_t hnsSampleTime, int64_t* phnsWait);
+
+        bool Wait(int64_t hnsWait);
+        void CancelWait(void) { m_waiter.CancelWait(); }
+
+        // The queue is processed by one caller at a time, for the samples to be
+        // presented in order: false if another caller is processing it, which
+        // then processes it once more (EndProcessing returns true).
+        bool BeginProcessing(void);
+        bool EndProcessing(void);
+
+        // True when the lag should be reported upstream again (0: back on time)
+        bool TakeLagChange(int64_t* phnsLag);
+        const SchedulerStats& Stats(void) const { return m_stats; }
+        // After a flush (seek): the next samples are not late from the previous ones
+        void ResetLag(void);
+        void ResetStats(void);
+
+    private:
+
+        ScheduleAction OnLate(int64_t hnsLate);
+
+        SchedulerClock&     m_clock;
+        SchedulerWaiter&    m_waiter;
+        float               m_fRate;
+        int64_t             m_hnsPerFrame;
+        int64_t             m_hnsPerFrame_1_4th;
+        bool                m_isThinned;
+        float               m_dropThresholdFrames;
+        int                 m_consecutiveDrops;
+        int64_t             m_hnsLag;           // of the last sample decided
+        bool                m_isLagReported;    // m_stats.hnsLag was reported at least once
+        bool                m_isProcessing;
+        bool                m_isProcessAgain;   // BeginProcessing was refused meanwhile
+        SchedulerStats      m_stats;
+    };
+}
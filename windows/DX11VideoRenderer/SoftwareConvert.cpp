@@ -0,0 +1,486 @@
+#include "SoftwareConvert.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFTWARE_CONVERT_SSE2
+#endif
+
+namespace
+{
+    const int COEFFICIENT_BITS = 13;
+    const int FRACTION_BITS = 7;    // Bilinear weights; (b - a) * weight fits 16 bits.
+
+    const uint32_t OPAQUE_BLACK = 0xFF000000;   // B, G, R, A in memory
+
+    // Y, V to R, U to G, V to G, U to B, scaled by 2^13: limited range, then full range
+    const int16_t s_coefficients[2][2][5] =
+    {
+        {   // BT.601
+            { 9539, 13075, 3209, 6660, 16525 },
+            { 8192, 11485, 2819, 5850, 14516 },
+        },
+        {   // BT.709
+            { 9539, 14686, 1747, 4366, 17305 },
+            { 8192, 12901, 1535, 3835, 15201 },
+        },
+    };
+
+    inline uint8_t Clamp255(int32_t value)
+    {
+        return (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+    }
+
+    void FillBlack(uint8_t* pOut, int32_t count)
+    {
+        for (int32_t x = 0; x < count; x++)
+        {
+            memcpy(pOut + x * 4, &OPAQUE_BLACK, 4);
+        }
+    }
+
+    //-----------------------------------------------------------------------------
+    // YUVToBGRARow
+    //
+    // Pixels [first, first + count) of a row with one U and V per two pixels,
+    // from pixel 0 of pY (pixel 0 of pU and pV is its pair 0).
+    //-----------------------------------------------------------------------------
+
+    void YUVToBGRARow(const uint8_t* pY, const uint8_t* pU, const uint8_t* pV, int32_t first, int32_t count,
+                      const int16_t* c, int16_t yOffset, uint8_t* pOut)
+    {
+        const int32_t end = first + count;
+        const int32_t round = 1 << (COEFFICIENT_BITS - 1);
+        int32_t x = first;
+
+        // One pixel at a time up to an even one, for the vector loop to start on a U/V pair
+        int32_t simdStart = (first + 1) & ~1;
+
+#ifdef SOFTWARE_CONVERT_SSE2
+        for (; x < simdStart && x < end; x++)
+        {
+            int32_t y = pY[x] - yOffset, u = pU[x / 2] - 128, v = pV[x / 2] - 128;
+            uint8_t* p = pOut + (x - first) * 4;
+            p[0] = Clamp255((y * c[0] + u * c[4] + round) >> COEFFICIENT_BITS);
+            p[1] = Clamp255((y * c[0] - u * c[2] - v * c[3] + round) >> COEFFICIENT_BITS);
+            p[2] = Clamp255((y * c[0] + v * c[1] + round) >> COEFFICIENT_BITS);
+            p[3] = 0xFF;
+        }
+
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i yBias = _mm_set1_epi16(yOffset);
+        const __m128i uvBias = _mm_set1_epi16(128);
+        const __m128i rYV = _mm_setr_epi16(c[0], c[1], c[0], c[1], c[0], c[1], c[0], c[1]);
+        const __m128i gYU = _mm_setr_epi16(c[0], (int16_t)-c[2], c[0], (int16_t)-c[2], c[0], (int16_t)-c[2], c[0], (int16_t)-c[2]);
+        const __m128i gYV = _mm_setr_epi16(0, (int16_t)-c[3], 0, (int16_t)-c[3], 0, (int16_t)-c[3], 0, (int16_t)-c[3]);
+        const __m128i bYU = _mm_setr_epi16(c[0], c[4], c[0], c[4], c[0], c[4], c[0], c[4]);
+        const __m128i rounding = _mm_set1_epi32(round);
+        const __m128i alpha = _mm_set1_epi8((char)0xFF);
+
+        for (; x + 8 <= end; x += 8)
+        {
+            int32_t u4, v4;
+            memcpy(&u4, pU + x / 2, 4);
+            memcpy(&v4, pV + x / 2, 4);
+
+            __m128i y = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(pY + x)), zero), yBias);
+            __m128i u = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(u4), zero), uvBias);
+            __m128i v = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v4), zero), uvBias);
+            u = _mm_unpacklo_epi16(u, u);
+            v = _mm_unpacklo_epi16(v, v);
+
+            __m128i yuLo = _mm_unpacklo_epi16(y, u);
+            __m128i yuHi = _mm_unpackhi_epi16(y, u);
+            __m128i yvLo = _mm_unpacklo_epi16(y, v);
+            __m128i yvHi = _mm_unpackhi_epi16(y, v);
+
+            __m128i r = _mm_packs_epi32(
+                _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yvLo, rYV), rounding), COEFFICIENT_BITS),
+                _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yvHi, rYV), rounding), COEFFICIENT_BITS));
+            __m128i g = _mm_packs_epi32(
+                _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(yuLo, gYU), _mm_madd_epi16(yvLo, gYV)), rounding), COEFFICIENT_BITS),
+                _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(_mm_madd_epi16(yuHi, gYU), _mm_madd_epi16(yvHi, gYV)), rounding), COEFFICIENT_BITS));
+            __m128i b = _mm_packs_epi32(
+                _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuLo, bYU), rounding), COEFFICIENT_BITS),
+                _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuHi, bYU), rounding), COEFFICIENT_BITS));
+
+            __m128i bg = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), _mm_packus_epi16(g, g));
+            __m128i ra = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), alpha);
+
+            uint8_t* p = pOut + (x - first) * 4;
+            _mm_storeu_si128((__m128i*)p, _mm_unpacklo_epi16(bg, ra));
+            _mm_storeu_si128((__m128i*)(p + 16), _mm_unpackhi_epi16(bg, ra));
+        }
+#else
+        (void)simdStart;
+#endif
+
+        for (; x < end; x++)
+        {
+            int32_t y = pY[x] - yOffset, u = pU[x / 2] - 128, v = pV[x / 2] - 128;
+            uint8_t* p = pOut + (x - first) * 4;
+            p[0] = Clamp255((y * c[0] + u * c[4] + round) >> COEFFICIENT_BITS);
+            p[1] = Clamp255((y * c[0] - u * c[2] - v * c[3] + round) >> COEFFICIENT_BITS);
+            p[2] = Clamp255((y * c[0] + v * c[1] + round) >> COEFFICIENT_BITS);
+            p[3] = 0xFF;
+        }
+    }
+
+    void BGRXToBGRARow(const uint8_t* pIn, int32_t count, uint8_t* pOut)
+    {
+        int32_t x = 0;
+
+#ifdef SOFTWARE_CONVERT_SSE2
+        const __m128i alpha = _mm_set1_epi32((int)OPAQUE_BLACK);
+        for (; x + 4 <= count; x += 4)
+        {
+            __m128i p = _mm_loadu_si128((const __m128i*)(pIn + x * 4));
+            _mm_storeu_si128((__m128i*)(pOut + x * 4), _mm_or_si128(p, alpha));
+        }
+#endif
+
+        for (; x < count; x++)
+        {
+            pOut[x * 4 + 0] = pIn[x * 4 + 0];
+            pOut[x * 4 + 1] = pIn[x * 4 + 1];
+            pOut[x * 4 + 2] = pIn[x * 4 + 2];
+            pOut[x * 4 + 3] = 0xFF;
+        }
+    }
+
+    // a + (b - a) * weight, weight in (0, 2^7)
+    void BlendRows(const uint8_t* pA, const uint8_t* pB, int32_t weight, int32_t bytes, uint8_t* pOut)
+    {
+        const int32_t round = 1 << (FRACTION_BITS - 1);
+        int32_t i = 0;
+
+#ifdef SOFTWARE_CONVERT_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i w = _mm_set1_epi16((int16_t)weight);
+        const __m128i rounding = _mm_set1_epi16((int16_t)round);
+        for (; i + 16 <= bytes; i += 16)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)(pA + i));
+            __m128i b = _mm_loadu_si128((const __m128i*)(pB + i));
+            __m128i aLo = _mm_unpacklo_epi8(a, zero);
+            __m128i aHi = _mm_unpackhi_epi8(a, zero);
+            __m128i dLo = _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(b, zero), aLo), w), rounding), FRACTION_BITS);
+            __m128i dHi = _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(b, zero), aHi), w), rounding), FRACTION_BITS);
+            _mm_storeu_si128((__m128i*)(pOut + i), _mm_packus_epi16(_mm_add_epi16(aLo, dLo), _mm_add_epi16(aHi, dHi)));
+        }
+#endif
+
+        for (; i < bytes; i++)
+        {
+            pOut[i] = (uint8_t)(pA[i] + (((pB[i] - pA[i]) * weight + round) >> FRACTION_BITS));
+        }
+    }
+
+    // Pixel i of pOut: pIn pixels index[i] and index[i] + 1, blended by fraction[i]
+    void ScaleRow(const uint8_t* pIn, const int32_t* pIndex, const uint8_t* pFraction, int32_t count, uint8_t* pOut)
+    {
+        const int32_t round = 1 << (FRACTION_BITS - 1);
+        int32_t i = 0;
+
+#ifdef SOFTWARE_CONVERT_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i rounding = _mm_set1_epi16((int16_t)round);
+        for (; i + 2 <= count; i += 2)
+        {
+            // Both pixels of each pair in one load: A B of pixel i, then of pixel i + 1
+            __m128i pair0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(pIn + pIndex[i] * 4)), zero);
+            __m128i pair1 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(pIn + pIndex[i + 1] * 4)), zero);
+            __m128i a = _mm_unpacklo_epi64(pair0, pair1);
+            __m128i b = _mm_unpackhi_epi64(pair0, pair1);
+            __m128i w = _mm_setr_epi16(pFraction[i], pFraction[i], pFraction[i], pFraction[i],
+                                       pFraction[i + 1], pFraction[i + 1], pFraction[i + 1], pFraction[i + 1]);
+            __m128i d = _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(b, a), w), rounding), FRACTION_BITS);
+            _mm_storel_epi64((__m128i*)(pOut + i * 4), _mm_packus_epi16(_mm_add_epi16(a, d), zero));
+        }
+#endif
+
+        for (; i < count; i++)
+        {
+            const uint8_t* pA = pIn + pIndex[i] * 4;
+            int32_t weight = pFraction[i];
+            for (int c = 0; c < 4; c++)
+            {
+                pOut[i * 4 + c] = (uint8_t)(pA[c] + (((pA[c + 4] - pA[c]) * weight + round) >> FRACTION_BITS));
+            }
+        }
+    }
+
+    // Position of output pixel i in source pixels, 7-bit fraction: centers aligned, clamped to the edges
+    int32_t SourcePosition(int32_t i, int32_t srcCount, int32_t dstCount)
+    {
+        int64_t position = ((2 * (int64_t)i + 1) * srcCount << FRACTION_BITS) / (2 * (int64_t)dstCount) - (1 << (FRACTION_BITS - 1));
+        int64_t last = (int64_t)(srcCount - 1) << FRACTION_BITS;
+        return (int32_t)(position < 0 ? 0 : (position > last ? last : position));
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Constructor
+//-----------------------------------------------------------------------------
+
+DX11VideoRenderer::CSoftwareConverter::CSoftwareConverter(void) :
+    m_format(SOFTWARE_FORMAT_UNKNOWN),
+    m_width(0),
+    m_height(0),
+    m_coefficients(), // zeroed
+    m_yOffset(0),
+    m_lastScaled(0),
+    m_xTableKey(0)
+{
+    m_scaledY[0] = -1;
+    m_scaledY[1] = -1;
+}
+
+//-----------------------------------------------------------------------------
+// SetFormat
+//
+// matrix, isFullRange: Of the YUV formats (MF_MT_YUV_MATRIX and
+//                      MF_MT_VIDEO_NOMINAL_RANGE).
+//-----------------------------------------------------------------------------
+
+bool DX11VideoRenderer::CSoftwareConverter::SetFormat(SoftwareFormat format, uint32_t width, uint32_t height, SoftwareMatrix matrix, bool isFullRange)
+{
+    m_format = SOFTWARE_FORMAT_UNKNOWN;
+
+    bool isSubsampledX = format != SOFTWARE_FORMAT_RGB32;
+    bool isSubsampledY = format == SOFTWARE_FORMAT_NV12 || format == SOFTWARE_FORMAT_I420 || format == SOFTWARE_FORMAT_YV12;
+    if (format == SOFTWARE_FORMAT_UNKNOWN || width == 0 || height == 0 || width > 16384 || height > 16384 ||
+        (isSubsampledX && (width & 1)) || (isSubsampledY && (height & 1)))
+    {
+        return false;
+    }
+
+    memcpy(m_coefficients, s_coefficients[matrix == SOFTWARE_MATRIX_BT709 ? 1 : 0][isFullRange ? 1 : 0], sizeof(m_coefficients));
+    m_yOffset = isFullRange ? 0 : 16;
+    m_width = width;
+    m_height = height;
+    m_format = format;
+
+    m_yRow.resize(width);
+    m_uRow.resize(width / 2);
+    m_vRow.resize(width / 2);
+    m_converted.resize((size_t)(width + 1) * 4, 0);
+    return true;
+}
+
+size_t DX11VideoRenderer::CSoftwareConverter::FrameBytes(int32_t stride) const
+{
+    size_t pitch = (size_t)(stride < 0 ? -(int64_t)stride : stride);
+
+    switch (m_format)
+    {
+    case SOFTWARE_FORMAT_NV12:
+        return pitch * m_height + pitch * (m_height / 2);
+    case SOFTWARE_FORMAT_I420:
+    case SOFTWARE_FORMAT_YV12:
+        return pitch * m_height + 2 * (pitch / 2) * (m_height / 2);
+    default:
+        return pitch * m_height;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Convert
+//
+// The output keeps its size; what rcDst does not cover is filled.
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CSoftwareConverter::Convert(const uint8_t* pSrc, int32_t srcStride, const SoftwareRect& rcSrc,
+    uint8_t* pDst, int32_t dstStride, uint32_t dstWidth, uint32_t dstHeight, const SoftwareRect& rcDst)
+{
+    SoftwareRect src = rcSrc;
+    SoftwareRect dst = rcDst;
+
+    src.left = src.left < 0 ? 0 : src.left;
+    src.top = src.top < 0 ? 0 : src.top;
+    src.right = src.right > (int32_t)m_width ? (int32_t)m_width : src.right;
+    src.bottom = src.bottom > (int32_t)m_height ? (int32_t)m_height : src.bottom;
+    dst.left = dst.left < 0 ? 0 : dst.left;
+    dst.top = dst.top < 0 ? 0 : dst.top;
+    dst.right = dst.right > (int32_t)dstWidth ? (int32_t)dstWidth : dst.right;
+    dst.bottom = dst.bottom > (int32_t)dstHeight ? (int32_t)dstHeight : dst.bottom;
+
+    if (!IsFormatSet() || src.right <= src.left || src.bottom <= src.top || dst.right <= dst.left || dst.bottom <= dst.top)
+    {
+        dst.left = dst.top = dst.right = dst.bottom = 0;
+    }
+
+    // The letterbox bars
+    for (int32_t y = 0; y < (int32_t)dstHeight; y++)
+    {
+        uint8_t* pRow = pDst + (int64_t)y * dstStride;
+        if (y < dst.top || y >= dst.bottom)
+        {
+            FillBlack(pRow, (int32_t)dstWidth);
+        }
+        else
+        {
+            FillBlack(pRow, dst.left);
+            FillBlack(pRow + dst.right * 4, (int32_t)dstWidth - dst.right);
+        }
+    }
+
+    if (dst.right <= dst.left)
+    {
+        return;
+    }
+
+    int32_t srcWidth = src.right - src.left;
+    int32_t srcHeight = src.bottom - src.top;
+    int32_t dstCount = dst.right - dst.left;
+    int32_t dstRows = dst.bottom - dst.top;
+
+    if (srcWidth == dstCount && srcHeight == dstRows)
+    {
+        for (int32_t j = 0; j < dstRows; j++)
+        {
+            ConvertRow(pSrc, srcStride, src.top + j, src.left, srcWidth, pDst + (int64_t)(dst.top + j) * dstStride + dst.left * 4);
+        }
+        return;
+    }
+
+    uint64_t xTableKey = ((uint64_t)srcWidth << 32) | (uint32_t)dstCount;
+    if (xTableKey != m_xTableKey)
+    {
+        m_xIndex.resize(dstCount);
+        m_xFraction.resize(dstCount);
+        for (int32_t i = 0; i < dstCount; i++)
+        {
+            int32_t position = SourcePosition(i, srcWidth, dstCount);
+            m_xIndex[i] = position >> FRACTION_BITS;
+            m_xFraction[i] = (uint8_t)(position & ((1 << FRACTION_BITS) - 1));
+        }
+        m_xTableKey = xTableKey;
+    }
+
+    // The rows of the last frame are stale
+    m_scaledY[0] = -1;
+    m_scaledY[1] = -1;
+
+    for (int32_t j = 0; j < dstRows; j++)
+    {
+        int32_t position = SourcePosition(j, srcHeight, dstRows);
+        int32_t y0 = position >> FRACTION_BITS;
+        int32_t weight = position & ((1 << FRACTION_BITS) - 1);
+        uint8_t* pOut = pDst + (int64_t)(dst.top + j) * dstStride + dst.left * 4;
+
+        int slot0 = ScaledRow(pSrc, srcStride, src, src.top + y0, dstCount, -1);
+        if (weight == 0)
+        {
+            memcpy(pOut, m_scaled[slot0].data(), (size_t)dstCount * 4);
+            continue;
+        }
+
+        int slot1 = ScaledRow(pSrc, srcStride, src, src.top + y0 + 1, dstCount, slot0);
+        BlendRows(m_scaled[slot0].data(), m_scaled[slot1].data(), weight, dstCount * 4, pOut);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// ConvertRow
+//
+// Pixels [left, left + count) of row y, to BGRA.
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CSoftwareConverter::ConvertRow(const uint8_t* pSrc, int32_t srcStride, int32_t y, int32_t left, int32_t count, uint8_t* pOut)
+{
+    const uint8_t* pRow = pSrc + (int64_t)y * srcStride;
+    int32_t even = left & ~1;
+    int32_t pairs = (left + count - even + 1) / 2;
+    int64_t planeBytes = (int64_t)srcStride * m_height;
+
+    switch (m_format)
+    {
+    case SOFTWARE_FORMAT_RGB32:
+        BGRXToBGRARow(pRow + left * 4, count, pOut);
+        break;
+
+    case SOFTWARE_FORMAT_NV12:
+        {
+            const uint8_t* pUV = pSrc + planeBytes + (int64_t)(y / 2) * srcStride + even;
+            for (int32_t i = 0; i < pairs; i++)
+            {
+                m_uRow[i] = pUV[2 * i];
+                m_vRow[i] = pUV[2 * i + 1];
+            }
+            YUVToBGRARow(pRow + even, m_uRow.data(), m_vRow.data(), left - even, count, m_coefficients, m_yOffset, pOut);
+        }
+        break;
+
+    case SOFTWARE_FORMAT_I420:
+    case SOFTWARE_FORMAT_YV12:
+        {
+            int32_t chromaStride = srcStride / 2;
+            const uint8_t* pFirst = pSrc + planeBytes + (int64_t)(y / 2) * chromaStride + even / 2;
+            const uint8_t* pSecond = pFirst + (int64_t)chromaStride * (m_height / 2);
+            const uint8_t* pU = m_format == SOFTWARE_FORMAT_I420 ? pFirst : pSecond;
+            const uint8_t* pV = m_format == SOFTWARE_FORMAT_I420 ? pSecond : pFirst;
+            YUVToBGRARow(pRow + even, pU, pV, left - even, count, m_coefficients, m_yOffset, pOut);
+        }
+        break;
+
+    case SOFTWARE_FORMAT_YUY2:
+    case SOFTWARE_FORMAT_UYVY:
+        {
+            const uint8_t* pPacked = pRow + even * 2;
+            int y0 = m_format == SOFTWARE_FORMAT_YUY2 ? 0 : 1;
+            int u = m_format == SOFTWARE_FORMAT_YUY2 ? 1 : 0;
+            for (int32_t i = 0; i < pairs; i++)
+            {
+                m_yRow[2 * i] = pPacked[4 * i + y0];
+                m_uRow[i] = pPacked[4 * i + u];
+                m_yRow[2 * i + 1] = pPacked[4 * i + y0 + 2];
+                m_vRow[i] = pPacked[4 * i + u + 2];
+            }
+            YUVToBGRARow(m_yRow.data(), m_uRow.data(), m_vRow.data(), left - even, count, m_coefficients, m_yOffset, pOut);
+        }
+        break;
+
+    default:
+        FillBlack(pOut, count);
+        break;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// ScaledRow
+//
+// Source row y scaled to dstCount pixels, in the slot returned; keep: the slot
+// not to replace (-1 if none).
+//-----------------------------------------------------------------------------
+
+int DX11VideoRenderer::CSoftwareConverter::ScaledRow(const uint8_t* pSrc, int32_t srcStride, const SoftwareRect& rcSrc, int32_t y, int32_t dstCount, int keep)
+{
+    for (int slot = 0; slot < 2; slot++)
+    {
+        if (m_scaledY[slot] == y)
+        {
+            return slot;
+        }
+    }
+
+    int slot = keep >= 0 ? 1 - keep : 1 - m_lastScaled;
+    std::vector<uint8_t>& scaled = m_scaled[slot];
+    scaled.resize((size_t)dstCount * 4);
+
+    int32_t srcWidth = rcSrc.right - rcSrc.left;
+    if (srcWidth == dstCount)
+    {
+        ConvertRow(pSrc, srcStride, y, rcSrc.left, srcWidth, scaled.data());
+    }
+    else
+    {
+        ConvertRow(pSrc, srcStride, y, rcSrc.left, srcWidth, m_converted.data());
+        ScaleRow(m_converted.data(), m_xIndex.data(), m_xFraction.data(), dstCount, scaled.data());
+    }
+
+    m_scaledY[slot] = y;
+    m_lastScaled = slot;
+    return slot;
+}
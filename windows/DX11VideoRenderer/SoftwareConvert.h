@@ -0,0 +1,90 @@
+#pragma once
+
+// Platform-neutral conversion of the CPresenter software path: a decoded frame in system
+// memory is converted to BGRA (the format of the swap chain), scaled and letterboxed on the
+// CPU, for the machines without a D3D11 video device (no Windows header).
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX11VideoRenderer
+{
+    enum SoftwareFormat
+    {
+        SOFTWARE_FORMAT_UNKNOWN = 0,
+        SOFTWARE_FORMAT_NV12,       // Y plane, then interleaved U/V at half height
+        SOFTWARE_FORMAT_I420,       // Y, U, V planes (chroma pitch: half the luma pitch)
+        SOFTWARE_FORMAT_YV12,       // Y, V, U planes
+        SOFTWARE_FORMAT_YUY2,       // Y0 U Y1 V
+        SOFTWARE_FORMAT_UYVY,       // U Y0 V Y1
+        SOFTWARE_FORMAT_RGB32,      // B G R X (the alpha is made opaque)
+    };
+
+    enum SoftwareMatrix
+    {
+        SOFTWARE_MATRIX_BT601 = 0,
+        SOFTWARE_MATRIX_BT709,
+    };
+
+    struct SoftwareRect
+    {
+        int32_t left;
+        int32_t top;
+        int32_t right;
+        int32_t bottom;
+    };
+
+    //-----------------------------------------------------------------------------
+    // CSoftwareConverter
+    //
+    // The source rectangle is scaled (bilinear) into the letterboxed destination
+    // rectangle of the output, the rest of the output is filled with opaque black.
+    // The rows are converted once at the source width and kept while the next
+    // output rows use them, so a frame costs one conversion of each source row it
+    // covers. The color conversion and the vertical blend use SSE2 when the target
+    // has it (every x64 one), the same integer math in C otherwise.
+    //-----------------------------------------------------------------------------
+
+    class CSoftwareConverter
+    {
+    public:
+
+        CSoftwareConverter(void);
+
+        // The frame size is the one of the buffers (with their padding); false if
+        // the format is not converted, or the size does not fit it
+        bool SetFormat(SoftwareFormat format, uint32_t width, uint32_t height, SoftwareMatrix matrix, bool isFullRange);
+        bool IsFormatSet(void) const { return m_format != SOFTWARE_FORMAT_UNKNOWN; }
+
+        // Bytes of a frame whose first row is 'stride' bytes long (planes included)
+        size_t FrameBytes(int32_t stride) const;
+
+        // pSrc: first row of the frame (the last one in memory if bottom-up, with a
+        //       negative stride).
+        // rcSrc: in pixels of the frame; rcDst: in pixels of the output, both clipped.
+        void Convert(const uint8_t* pSrc, int32_t srcStride, const SoftwareRect& rcSrc,
+                     uint8_t* pDst, int32_t dstStride, uint32_t dstWidth, uint32_t dstHeight, const SoftwareRect& rcDst);
+
+    private:
+
+        void ConvertRow(const uint8_t* pSrc, int32_t srcStride, int32_t y, int32_t left, int32_t count, uint8_t* pOut);
+        int  ScaledRow(const uint8_t* pSrc, int32_t srcStride, const SoftwareRect& rcSrc, int32_t y, int32_t dstCount, int keep);
+
+        SoftwareFormat          m_format;
+        uint32_t                m_width;
+        uint32_t                m_height;
+        int16_t                 m_coefficients[5];  // Y, V to R, U to G, V to G, U to B (13-bit fractions)
+        int16_t                 m_yOffset;
+        std::vector<uint8_t>    m_yRow;             // The planes of one source row,
+        std::vector<uint8_t>    m_uRow;             // from an even pixel.
+        std::vector<uint8_t>    m_vRow;
+        std::vector<uint8_t>    m_converted;        // One source row, BGRA, and a pixel read with a weight of 0.
+        std::vector<uint8_t>    m_scaled[2];        // Source rows scaled to the output width, BGRA.
+        int32_t                 m_scaledY[2];       // Their source rows, -1 if none.
+        int                     m_lastScaled;       // The slot filled last.
+        std::vector<int32_t>    m_xIndex;           // Source pixel left of each output pixel.
+        std::vector<uint8_t>    m_xFraction;        // Weight of the pixel on its right (7 bits).
+        uint64_t                m_xTableKey;        // Source and output spans of the tables.
+    };
+}
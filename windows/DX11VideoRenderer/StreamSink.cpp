@@ -27,6 +27,10 @@ const DWORD DX11VideoRenderer::CStreamSink::s_dwNumVideoFormats = sizeof(DX11Vid
 
 const MFRatio DX11VideoRenderer::CStreamSink::s_DefaultFrameRate = { 30, 1 };
 
+// Every frame is rendered up to 3x; keyframes only up to 64x (the source's own limit may be lower).
+const float DX11VideoRenderer::CStreamSink::s_DefaultThinningRate = 3.0f;
+const float DX11VideoRenderer::CStreamSink::s_MaxThinnedRate = 64.0f;
+
 const DX11VideoRenderer::CStreamSink::FormatEntry DX11VideoRenderer::CStreamSink::s_DXGIFormatMapping[] =
 {
     { MFVideoFormat_RGB32,      DXGI_FORMAT_B8G8R8X8_UNORM },
@@ -47,11 +51,11 @@ const DX11VideoRenderer::CStreamSink::FormatEntry DX11VideoRenderer::CStreamSink
 
 // Control how we batch work from the decoder.
 // On receiving a sample we request another one if the number on the queue is
-// less than the hi water threshold.
+// less than the hi water threshold: the depth of m_QueueDepth, adapted to the
+// arrival jitter within the stream's bounds (3 to begin with).
 // When displaying samples (removing them from the sample queue) we request
 // another one if the number of falls below the lo water threshold
 //
-#define SAMPLE_QUEUE_HIWATER_THRESHOLD 3
 // maximum # of past reference frames required for deinterlacing
 #define MAX_PAST_FRAMES         3
 
@@ -108,10 +112,11 @@ BOOL DX11VideoRenderer::CStreamSink::ValidStateMatrix[DX11VideoRenderer::CStream
 #pragma warning( push )
 #pragma warning( disable : 4355 )  // 'this' used in base member initializer list
 
-DX11VideoRenderer::CStreamSink::CStreamSink(DWORD dwStreamId, CCritSec& critSec, CScheduler* pScheduler) :
+DX11VideoRenderer::CStreamSink::CStreamSink(DWORD dwStreamId, CSharedCritSec* pCritSec, CScheduler* pScheduler) :
     STREAM_ID(dwStreamId),
     m_nRefCount(1),
-    m_critSec(critSec),
+    m_pCritSec(pCritSec),
+    m_critSec(*pCritSec),
     m_state(State_TypeNotSet),
     m_IsShutdown(FALSE),
     m_WorkQueueId(0),
@@ -129,10 +134,17 @@ DX11VideoRenderer::CStreamSink::CStreamSink(DWORD dwStreamId, CCritSec& critSec,
     m_fPrerolling(FALSE),
     m_fWaitingForOnClockStart(FALSE),
     m_SamplesToProcess(), // default ctor
+    m_QueueDepth(), // default ctor
+    m_fEstimateFrameRate(FALSE),
+    m_FrameInterval(), // default ctor
+    m_flThinningRate(s_DefaultThinningRate),
+    m_fThinned(FALSE),
+    m_pTrace(), // default ctor
     m_unInterlaceMode(MFVideoInterlace_Progressive),
     m_imageBytesPP(), // default ctor
     m_dxgiFormat(DXGI_FORMAT_UNKNOWN)
 {
+    m_pCritSec->AddRef();
     m_imageBytesPP.Numerator = 1;
     m_imageBytesPP.Denominator = 1;
 }
@@ -145,6 +157,7 @@ DX11VideoRenderer::CStreamSink::CStreamSink(DWORD dwStreamId, CCritSec& critSec,
 
 DX11VideoRenderer::CStreamSink::~CStreamSink(void)
 {
+    SafeRelease(m_pCritSec);
 }
 
 // IUnknown methods
@@ -233,6 +246,11 @@ HRESULT DX11VideoRenderer::CStreamSink::Flush(void)
         hr = m_pPresenter->Flush();
     }
 
+    TraceEvent(TRACE_FLUSH);
+
+    m_QueueDepth.Restart();
+    m_FrameInterval.Restart();
+
     m_ConsumeData = ProcessFrames;
 
     return hr;
@@ -405,6 +423,23 @@ HRESULT DX11VideoRenderer::CStreamSink::ProcessSample(__RPC__in_opt IMFSample* p
 
         m_cOutstandingSampleRequests--;
 
+        if (m_pTrace)
+        {
+            TraceSample(pSample);
+        }
+
+        m_QueueDepth.OnSampleArrived(MFGetSystemTime(), m_SamplesToProcess.GetCount(), m_pScheduler->FrameDuration());
+
+        LONGLONG hnsSampleTime = 0;
+        int64_t hnsPerFrame = 0;
+        // Keyframe times are no frame intervals.
+        if (m_fEstimateFrameRate && !m_fThinned && SUCCEEDED(pSample->GetSampleTime(&hnsSampleTime)) &&
+            m_FrameInterval.OnSampleTime(hnsSampleTime, &hnsPerFrame))
+        {
+            // The presentation windows follow the estimate.
+            m_pScheduler->SetFrameInterval(hnsPerFrame);
+        }
+
         if (!m_fPrerolling && !m_fWaitingForOnClockStart)
         {
             // Validate the operation.
@@ -863,26 +898,35 @@ HRESULT DX11VideoRenderer::CStreamSink::SetCurrentMediaType(IMFMediaType* pMedia
             }
 
             m_pScheduler->SetFrameRate(fps);
+            m_fEstimateFrameRate = FALSE;
         }
         else
         {
             // NOTE: The mixer's proposed type might not have a frame rate, in which case
-            // we'll use an arbitary default. (Although it's unlikely the video source
-            // does not have a frame rate.)
-            m_pScheduler->SetFrameRate(s_DefaultFrameRate);
+            // it is estimated from the sample times, from an arbitary default until the
+            // first estimate (or the estimate so far, on a format change while playing).
+            if (m_FrameInterval.Estimate() != 0)
+            {
+                m_pScheduler->SetFrameInterval(m_FrameInterval.Estimate());
+            }
+            else
+            {
+                m_pScheduler->SetFrameRate(s_DefaultFrameRate);
+            }
+            m_fEstimateFrameRate = TRUE;
         }
 
         // Update the required sample count based on the media type (progressive vs. interlaced)
         if (m_unInterlaceMode == MFVideoInterlace_Progressive)
         {
             // XVP will hold on to 1 sample but that's the same sample we will internally hold on to
-            hr = SetUINT32(MF_SA_REQUIRED_SAMPLE_COUNT, SAMPLE_QUEUE_HIWATER_THRESHOLD);
+            hr = SetUINT32(MF_SA_REQUIRED_SAMPLE_COUNT, m_QueueDepth.MaxDepth());
         }
         else
         {
             // Assume we will need a maximum of 3 backward reference frames for deinterlacing
             // However, one of the frames is "shared" with SVR
-            hr = SetUINT32(MF_SA_REQUIRED_SAMPLE_COUNT, SAMPLE_QUEUE_HIWATER_THRESHOLD + MAX_PAST_FRAMES - 1);
+            hr = SetUINT32(MF_SA_REQUIRED_SAMPLE_COUNT, m_QueueDepth.MaxDepth() + MAX_PAST_FRAMES - 1);
         }
 
         if (SUCCEEDED(hr))
@@ -936,12 +980,36 @@ HRESULT DX11VideoRenderer::CStreamSink::GetService(__RPC__in REFGUID guidService
 
 HRESULT DX11VideoRenderer::CStreamSink::PresentFrame(void)
 {
-    HRESULT hr = S_OK;
+    return CompleteFrame(TRUE);
+}
 
-    if (DropFrames == m_ConsumeData)
-    {
-        return hr;
-    }
+//+-------------------------------------------------------------------------
+//
+//  Member:     DropFrame
+//
+//  Synopsis:   Skip the current outstanding frame, too late to be presented
+//
+//--------------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CStreamSink::DropFrame(void)
+{
+    return CompleteFrame(FALSE);
+}
+
+//+-------------------------------------------------------------------------
+//
+//  Member:     NotifySampleLag
+//
+//  Synopsis:   Quality feedback: the pipeline's quality manager lowers the
+//              decoder's drop mode (skipping non-reference frames) while
+//              samples arrive late, and restores it once hnsLag is back to 0
+//
+//--------------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CStreamSink::NotifySampleLag(LONGLONG hnsLag)
+{
+    HRESULT hr = S_OK;
+    IMFMediaEvent* pEvent = NULL;
 
     CAutoLock lock(&m_critSec);
 
@@ -953,14 +1021,73 @@ HRESULT DX11VideoRenderer::CStreamSink::PresentFrame(void)
             break;
         }
 
-        hr = m_pPresenter->PresentFrame();
+        hr = MFCreateMediaEvent(MEQualityNotify, GUID_NULL, S_OK, NULL, &pEvent);
+        if (FAILED(hr))
+        {
+            break;
+        }
+
+        hr = pEvent->SetUINT64(MF_QUALITY_NOTIFY_SAMPLE_LAG, static_cast<UINT64>(hnsLag));
         if (FAILED(hr))
         {
             break;
         }
+
+        hr = m_pEventQueue->QueueEvent(pEvent);
     }
     while (FALSE);
 
+    SafeRelease(pEvent);
+
+    return hr;
+}
+
+//+-------------------------------------------------------------------------
+//
+//  Member:     CompleteFrame
+//
+//  Synopsis:   Present (or skip) the current outstanding frame, then
+//              dispatch the next sample
+//
+//--------------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CStreamSink::CompleteFrame(BOOL bPresent)
+{
+    HRESULT hr = S_OK;
+    CPresenter* pPresenter = NULL;
+
+    {
+        CAutoLock lock(&m_critSec);
+
+        if (DropFrames == m_ConsumeData)
+        {
+            return hr;
+        }
+
+        hr = CheckShutdown();
+        if (SUCCEEDED(hr) && bPresent)
+        {
+            pPresenter = m_pPresenter;
+            pPresenter->AddRef();
+        }
+    }
+
+    // Presenting may wait for the display: the presenter has its own lock, the
+    // stream's is free meanwhile (from the scheduler timer; a present-now from
+    // the dispatch thread, paused or scrubbing, still holds it).
+    if (pPresenter != NULL)
+    {
+        hr = pPresenter->PresentFrame();
+        SafeRelease(pPresenter);
+    }
+
+    CAutoLock lock(&m_critSec);
+
+    if (SUCCEEDED(hr))
+    {
+        hr = CheckShutdown();
+    }
+
     if (SUCCEEDED(hr))
     {
         // Unless we are paused/stopped, start an async operation to dispatch the next sample.
@@ -970,7 +1097,7 @@ HRESULT DX11VideoRenderer::CStreamSink::PresentFrame(void)
             hr = QueueAsyncOperation(OpProcessSample);
         }
     }
-    else
+    else if (hr != MF_E_SHUTDOWN)
     {
         // We are in the middle of an asynchronous operation, so if something failed, send an error.
         hr = QueueEvent(MEError, GUID_NULL, hr, NULL);
@@ -986,10 +1113,45 @@ HRESULT DX11VideoRenderer::CStreamSink::GetMaxRate(BOOL fThin, float* pflRate)
         return E_FAIL;
     }
 
-    *pflRate = 3.0f;
+    *pflRate = fThin ? s_MaxThinnedRate : m_flThinningRate;
     return S_OK;
 }
 
+//-------------------------------------------------------------------
+// Name: SetThinningRate
+// Description: Fastest rate with every frame, at least 1x.
+//-------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CStreamSink::SetThinningRate(float flRate)
+{
+    if (flRate < 1.0f || flRate > s_MaxThinnedRate)
+    {
+        return E_INVALIDARG;
+    }
+
+    CAutoLock lock(&m_critSec);
+
+    m_flThinningRate = flRate;
+    return S_OK;
+}
+
+//-------------------------------------------------------------------
+// Name: OnClockSetRate
+// Description: Above the thinning rate, the samples are keyframes: the
+//              scheduler spaces them out by their times over the rate,
+//              without dropping the late ones.
+//-------------------------------------------------------------------
+
+void DX11VideoRenderer::CStreamSink::OnClockSetRate(float flRate)
+{
+    CAutoLock lock(&m_critSec);
+
+    TraceEvent(TRACE_CLOCK_RATE, (LONGLONG)(flRate * 1000000.0 + (flRate < 0 ? -0.5 : 0.5)));
+
+    m_fThinned = fabsf(flRate) > m_flThinningRate;
+    m_pScheduler->SetThinned(m_fThinned);
+}
+
 //-------------------------------------------------------------------
 // Name: Initialize
 // Description: Initializes the stream sink.
@@ -1047,6 +1209,7 @@ HRESULT DX11VideoRenderer::CStreamSink::Pause(void)
 
     if (SUCCEEDED(hr))
     {
+        TraceEvent(TRACE_CLOCK_PAUSE);
         m_state = State_Paused;
         hr = QueueAsyncOperation(OpPause);
     }
@@ -1089,6 +1252,7 @@ HRESULT DX11VideoRenderer::CStreamSink::Restart(void)
 
     if (SUCCEEDED(hr))
     {
+        TraceEvent(TRACE_CLOCK_RESTART);
         m_state = State_Started;
         hr = QueueAsyncOperation(OpRestart);
     }
@@ -1121,6 +1285,7 @@ HRESULT DX11VideoRenderer::CStreamSink::Shutdown(void)
     SafeRelease(m_pByteStream);
     SafeRelease(m_pPresenter);
     SafeRelease(m_pCurrentType);
+    m_pTrace.reset();
 
     return MF_E_SHUTDOWN;
 }
@@ -1152,6 +1317,16 @@ HRESULT DX11VideoRenderer::CStreamSink::Start(MFTIME start)
             m_StartTime = start;        // Cache the start time.
         }
 
+        // A new playback (not a resume or a seek) counts its samples from 0.
+        if (m_state != State_Started && m_state != State_Paused)
+        {
+            m_QueueDepth.ResetStats();
+            m_FrameInterval.Reset();
+        }
+        m_QueueDepth.Restart();
+
+        TraceEvent(TRACE_CLOCK_START, start == PRESENTATION_CURRENT_POSITION ? -1 : start);
+
         m_state = State_Started;
         hr = QueueAsyncOperation(OpStart);
     }
@@ -1175,6 +1350,7 @@ HRESULT DX11VideoRenderer::CStreamSink::Stop(void)
 
     if (SUCCEEDED(hr))
     {
+        TraceEvent(TRACE_CLOCK_STOP);
         m_state = State_Stopped;
         hr = QueueAsyncOperation(OpStop);
     }
@@ -1182,8 +1358,57 @@ HRESULT DX11VideoRenderer::CStreamSink::Stop(void)
     return hr;
 }
 
+//-------------------------------------------------------------------
+// Name: SetSampleTrace
+// Description: Records the arrival of the samples (and the clock
+//              changes) into pTrace, NULL to stop.
+//-------------------------------------------------------------------
+
+void DX11VideoRenderer::CStreamSink::SetSampleTrace(std::shared_ptr<SampleTraceWriter> pTrace)
+{
+    CAutoLock lock(&m_critSec);
+
+    m_pTrace = pTrace;
+}
+
 // private methods
 
+//-------------------------------------------------------------------
+// Name: TraceSample / TraceEvent
+// Description: Append to the trace, if any. Called with the critical
+//              section held.
+//-------------------------------------------------------------------
+
+void DX11VideoRenderer::CStreamSink::TraceSample(IMFSample* pSample)
+{
+    LONGLONG hnsTime = 0;
+    LONGLONG hnsDuration = 0;
+    DWORD cbLength = 0;
+    uint16_t flags = 0;
+
+    (void)pSample->GetSampleTime(&hnsTime);
+    (void)pSample->GetSampleDuration(&hnsDuration);
+    (void)pSample->GetTotalLength(&cbLength);
+    if (MFGetAttributeUINT32(pSample, MFSampleExtension_CleanPoint, FALSE))
+    {
+        flags |= TRACE_FLAG_KEYFRAME;
+    }
+    if (MFGetAttributeUINT32(pSample, MFSampleExtension_Discontinuity, FALSE))
+    {
+        flags |= TRACE_FLAG_DISCONTINUITY;
+    }
+
+    m_pTrace->Sample(TRACE_SOURCE_RENDERER, hnsTime, hnsDuration, cbLength, flags);
+}
+
+void DX11VideoRenderer::CStreamSink::TraceEvent(SampleTraceEvent event, LONGLONG value)
+{
+    if (m_pTrace)
+    {
+        m_pTrace->Event(TRACE_SOURCE_RENDERER, event, value);
+    }
+}
+
 //-------------------------------------------------------------------
 // Name: DispatchProcessSample
 // Description: Complete a ProcessSample or PlaceMarker request.
@@ -1252,7 +1477,60 @@ BOOL DX11VideoRenderer::CStreamSink::NeedMoreSamples(void)
 {
     const DWORD cSamplesInFlight = m_SamplesToProcess.GetCount() + m_cOutstandingSampleRequests;
 
-    return cSamplesInFlight < SAMPLE_QUEUE_HIWATER_THRESHOLD;
+    return cSamplesInFlight < m_QueueDepth.Depth();
+}
+
+//+-------------------------------------------------------------------------
+//
+//  Member:     SetSampleQueueBounds
+//
+//  Synopsis:   Bounds of the adaptive queue depth: a low maximum for live
+//              low-latency streams, a high one for jittery network or 4K
+//              decode. Set before the media type, for the mixer to
+//              allocate enough samples (MF_SA_REQUIRED_SAMPLE_COUNT).
+//
+//--------------------------------------------------------------------------
+HRESULT DX11VideoRenderer::CStreamSink::SetSampleQueueBounds(DWORD dwMinDepth, DWORD dwMaxDepth)
+{
+    CAutoLock lock(&m_critSec);
+
+    HRESULT hr = CheckShutdown();
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (!m_QueueDepth.SetBounds(dwMinDepth, dwMaxDepth))
+    {
+        return E_INVALIDARG;
+    }
+
+    return S_OK;
+}
+
+//+-------------------------------------------------------------------------
+//
+//  Member:     GetSampleQueueStats
+//
+//  Synopsis:   Queue depth and occupancy since the playback started
+//
+//--------------------------------------------------------------------------
+HRESULT DX11VideoRenderer::CStreamSink::GetSampleQueueStats(SampleQueueStats* pStats)
+{
+    if (pStats == NULL)
+    {
+        return E_POINTER;
+    }
+
+    CAutoLock lock(&m_critSec);
+
+    HRESULT hr = CheckShutdown();
+    if (SUCCEEDED(hr))
+    {
+        *pStats = m_QueueDepth.GetStats();
+    }
+
+    return hr;
 }
 
 //-------------------------------------------------------------------
@@ -1262,73 +1540,76 @@ BOOL DX11VideoRenderer::CStreamSink::NeedMoreSamples(void)
 
 HRESULT DX11VideoRenderer::CStreamSink::OnDispatchWorkItem(IMFAsyncResult* pAsyncResult)
 {
-    // Called by work queue thread. Need to hold the critical section.
-    CAutoLock lock(&m_critSec);
+    IUnknown* pState = NULL;
 
-    HRESULT hr = CheckShutdown();
+    HRESULT hr = pAsyncResult->GetState(&pState);
     if (FAILED(hr))
     {
         return hr;
     }
 
-    IUnknown* pState = NULL;
-
-    hr = pAsyncResult->GetState(&pState);
-
-    if (SUCCEEDED(hr))
     {
-        // The state object is a CAsncOperation object.
-        CAsyncOperation* pOp = (CAsyncOperation*)pState;
+        // Called by work queue thread. Need to hold the critical section, for
+        // the operation only (the operation object is recycled outside it).
+        CAutoLock lock(&m_critSec);
 
-        StreamOperation op = pOp->m_op;
+        hr = CheckShutdown();
 
-        switch (op)
+        if (SUCCEEDED(hr))
         {
-        case OpStart:
-        case OpRestart:
-            // Send MEStreamSinkStarted.
-            hr = QueueEvent(MEStreamSinkStarted, GUID_NULL, hr, NULL);
+            // The state object is a CAsncOperation object.
+            CAsyncOperation* pOp = (CAsyncOperation*)pState;
 
-            // Kick things off by requesting two samples...
-            if (SUCCEEDED(hr))
-            {
-                m_cOutstandingSampleRequests++;
-                hr = QueueEvent(MEStreamSinkRequestSample, GUID_NULL, hr, NULL);
-            }
+            StreamOperation op = pOp->m_op;
 
-            // There might be samples queue from earlier (ie, while paused).
-            if (SUCCEEDED(hr))
+            switch (op)
             {
-                hr = ProcessSamplesFromQueue(m_ConsumeData);
-            }
+            case OpStart:
+            case OpRestart:
+                // Send MEStreamSinkStarted.
+                hr = QueueEvent(MEStreamSinkStarted, GUID_NULL, hr, NULL);
 
-            break;
+                // Kick things off by requesting two samples...
+                if (SUCCEEDED(hr))
+                {
+                    m_cOutstandingSampleRequests++;
+                    hr = QueueEvent(MEStreamSinkRequestSample, GUID_NULL, hr, NULL);
+                }
+
+                // There might be samples queue from earlier (ie, while paused).
+                if (SUCCEEDED(hr))
+                {
+                    hr = ProcessSamplesFromQueue(m_ConsumeData);
+                }
 
-        case OpStop:
+                break;
 
-            m_pPresenter->SetFullscreen(FALSE);
+            case OpStop:
 
-            // Drop samples from queue.
-            Flush();
+                m_pPresenter->SetFullscreen(FALSE);
 
-            m_cOutstandingSampleRequests = 0;
+                // Drop samples from queue.
+                Flush();
 
-            // Send the event even if the previous call failed.
-            hr = QueueEvent(MEStreamSinkStopped, GUID_NULL, hr, NULL);
+                m_cOutstandingSampleRequests = 0;
 
-            break;
+                // Send the event even if the previous call failed.
+                hr = QueueEvent(MEStreamSinkStopped, GUID_NULL, hr, NULL);
 
-        case OpPause:
-            hr = QueueEvent(MEStreamSinkPaused, GUID_NULL, hr, NULL);
-            break;
+                break;
 
-        case OpProcessSample:
-        case OpPlaceMarker:
-            if (!(m_fWaitingForOnClockStart))
-            {
-                hr = DispatchProcessSample(pOp);
+            case OpPause:
+                hr = QueueEvent(MEStreamSinkPaused, GUID_NULL, hr, NULL);
+                break;
+
+            case OpProcessSample:
+            case OpPlaceMarker:
+                if (!(m_fWaitingForOnClockStart))
+                {
+                    hr = DispatchProcessSample(pOp);
+                }
+                break;
             }
-            break;
         }
     }
 
@@ -1449,7 +1730,7 @@ HRESULT DX11VideoRenderer::CStreamSink::ProcessSamplesFromQueue(ConsumeState bCo
 HRESULT DX11VideoRenderer::CStreamSink::QueueAsyncOperation(StreamOperation op)
 {
     HRESULT hr = S_OK;
-    CAsyncOperation* pOp = new CAsyncOperation(op); // Created with ref count = 1
+    CAsyncOperation* pOp = CAsyncOperation::Create(op); // Created with ref count = 1
     if (pOp == NULL)
     {
         hr = E_OUTOFMEMORY;
@@ -1555,10 +1836,34 @@ HRESULT DX11VideoRenderer::CStreamSink::ValidateOperation(StreamOperation op)
 //
 /////////////////////////////////////////////////////////////////////////////////////////////
 
+DX11VideoRenderer::CFreeList DX11VideoRenderer::CStreamSink::CAsyncOperation::s_FreeList(MAX_FREE);
+volatile LONG DX11VideoRenderer::CStreamSink::CAsyncOperation::s_cAllocations = 0;
+
+DX11VideoRenderer::CStreamSink::CAsyncOperation* DX11VideoRenderer::CStreamSink::CAsyncOperation::Create(StreamOperation op)
+{
+    FreeListEntry* pEntry = s_FreeList.Pop();
+    if (pEntry == NULL)
+    {
+        CAsyncOperation* pOp = new (std::nothrow) CAsyncOperation(op);
+        if (pOp != NULL)
+        {
+            InterlockedIncrement(&s_cAllocations);
+        }
+        return pOp;
+    }
+
+    // Released with a ref count of 0 and a cleared PROPVARIANT: as new.
+    CAsyncOperation* pOp = CONTAINING_RECORD(pEntry, CAsyncOperation, m_FreeEntry);
+    pOp->m_op = op;
+    pOp->m_nRefCount = 1;
+    return pOp;
+}
+
 DX11VideoRenderer::CStreamSink::CAsyncOperation::CAsyncOperation(StreamOperation op) :
     m_nRefCount(1),
     m_op(op)
 {
+    PropVariantInit(&m_varDataWM);
 }
 
 ULONG DX11VideoRenderer::CStreamSink::CAsyncOperation::AddRef(void)
@@ -1590,7 +1895,13 @@ ULONG DX11VideoRenderer::CStreamSink::CAsyncOperation::Release(void)
     ULONG uCount = InterlockedDecrement(&m_nRefCount);
     if (uCount == 0)
     {
-        delete this;
+        PropVariantClear(&m_varDataWM);
+
+        // Recycled, unless enough are free already.
+        if (!s_FreeList.Push(&m_FreeEntry))
+        {
+            delete this;
+        }
     }
     // For thread safety, return a temporary variable.
     return uCount;
@@ -1598,4 +1909,5 @@ ULONG DX11VideoRenderer::CStreamSink::CAsyncOperation::Release(void)
 
 DX11VideoRenderer::CStreamSink::CAsyncOperation::~CAsyncOperation(void)
 {
+    PropVariantClear(&m_varDataWM);
 }
\ No newline at end of file
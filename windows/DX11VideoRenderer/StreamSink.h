@@ -1,10 +1,14 @@
 #pragma once
 
 #include "Common.h"
+#include "../sample_trace.h"
 #include "display.h"
+#include "FrameIntervalEstimator.h"
+#include "FreeList.h"
 #include "MFAttributesImpl.h"
 #include "Marker.h"
 #include "Presenter.h"
+#include "SampleQueueDepth.h"
 #include "Scheduler.h"
 
 namespace DX11VideoRenderer
@@ -19,7 +23,7 @@ namespace DX11VideoRenderer
     {
     public:
 
-        CStreamSink(DWORD dwStreamId, CCritSec& critSec, CScheduler* pScheduler);
+        CStreamSink(DWORD dwStreamId, CSharedCritSec* pCritSec, CScheduler* pScheduler);
         virtual ~CStreamSink(void);
 
         // IUnknown
@@ -54,8 +58,14 @@ namespace DX11VideoRenderer
 
         // SchedulerCallback
         HRESULT PresentFrame(void);
+        HRESULT DropFrame(void);
+        HRESULT NotifySampleLag(LONGLONG hnsLag);
 
         HRESULT GetMaxRate(BOOL fThin, float* pflRate);
+        // Heap allocations of queued operations (all streams): flat once playing
+        static LONG GetAsyncOperationAllocations(void) { return CAsyncOperation::AllocationCount(); }
+        void    OnClockSetRate(float flRate);
+        HRESULT GetSampleQueueStats(SampleQueueStats* pStats);
         HRESULT Initialize(IMFMediaSink* pParent, CPresenter* pPresenter);
         inline BOOL IsActive(void) const // IsActive: The "active" state is started or paused.
         {
@@ -64,6 +74,9 @@ namespace DX11VideoRenderer
         HRESULT Pause(void);
         HRESULT Preroll(void);
         HRESULT Restart(void);
+        HRESULT SetSampleQueueBounds(DWORD dwMinDepth, DWORD dwMaxDepth);
+        void    SetSampleTrace(std::shared_ptr<SampleTraceWriter> pTrace);
+        HRESULT SetThinningRate(float flRate);
         HRESULT Shutdown(void);
         HRESULT Start(MFTIME start);
         HRESULT Stop(void);
@@ -112,11 +125,16 @@ namespace DX11VideoRenderer
         // called, we use it to queue a marker. This way, samples and markers can live in
         // the same queue. We need this because the sink has to serialize marker events
         // with sample processing.
+        //
+        // One is queued per sample: released ones are recycled through a lock-free
+        // free list (at most MAX_FREE of them, kept for the process lifetime), so
+        // the steady state does not allocate.
         class CAsyncOperation : public IUnknown
         {
         public:
 
-            CAsyncOperation(StreamOperation op);
+            static CAsyncOperation* Create(StreamOperation op); // Created with ref count = 1
+            static LONG AllocationCount(void) { return s_cAllocations; }
 
             // IUnknown methods.
             STDMETHODIMP_(ULONG) AddRef(void);
@@ -129,14 +147,23 @@ namespace DX11VideoRenderer
 
         private:
 
+            static const LONG MAX_FREE = 16;
+
+            CAsyncOperation(StreamOperation op);
             virtual ~CAsyncOperation(void);
 
+            FreeListEntry m_FreeEntry;  // In s_FreeList, once released.
             long m_nRefCount;
+
+            static CFreeList s_FreeList;
+            static volatile LONG s_cAllocations;
         };
 
         static GUID const* const s_pVideoFormats[];
         static const DWORD s_dwNumVideoFormats;
         static const MFRatio s_DefaultFrameRate;
+        static const float s_DefaultThinningRate;
+        static const float s_MaxThinnedRate;
         static const struct FormatEntry
         {
             GUID            Subtype;
@@ -146,6 +173,7 @@ namespace DX11VideoRenderer
 
         HRESULT DispatchProcessSample(CAsyncOperation* pOp);
         HRESULT CheckShutdown(void) const;
+        HRESULT CompleteFrame(BOOL bPresent);
         HRESULT GetFrameRate(IMFMediaType* pType, MFRatio* pRatio);
         BOOL    NeedMoreSamples(void);
         HRESULT OnDispatchWorkItem(IMFAsyncResult* pAsyncResult);
@@ -153,11 +181,14 @@ namespace DX11VideoRenderer
         HRESULT QueueAsyncOperation(StreamOperation op);
         HRESULT RequestSamples(void);
         HRESULT SendMarkerEvent(IMarker* pMarker, ConsumeState bConsumeData);
+        void    TraceEvent(SampleTraceEvent event, LONGLONG value = 0);
+        void    TraceSample(IMFSample* pSample);
         HRESULT ValidateOperation(StreamOperation op);
 
         const DWORD                 STREAM_ID;
         long                        m_nRefCount;                    // reference count
-        CCritSec&                   m_critSec;                      // critical section for thread safety
+        CSharedCritSec*             m_pCritSec;                     // Lock domain of the sink, referenced.
+        CCritSec&                   m_critSec;                      // critical section for thread safety, not held while presenting
         State                       m_state;
         BOOL                        m_IsShutdown;                   // Flag to indicate if Shutdown() method was called.
         DWORD                       m_WorkQueueId;                  // ID of the work queue for asynchronous operations.
@@ -175,6 +206,12 @@ namespace DX11VideoRenderer
         BOOL                        m_fPrerolling;
         BOOL                        m_fWaitingForOnClockStart;
         ThreadSafeQueue<IUnknown>   m_SamplesToProcess;             // Queue to hold samples and markers. Applies to: ProcessSample, PlaceMarker
+        CSampleQueueDepth           m_QueueDepth;                   // Samples kept in flight, from the arrival jitter.
+        BOOL                        m_fEstimateFrameRate;           // The media type has no frame rate.
+        CFrameIntervalEstimator     m_FrameInterval;                // From the sample times, while m_fEstimateFrameRate.
+        float                       m_flThinningRate;               // Fastest rate with every frame.
+        BOOL                        m_fThinned;                     // Keyframes only, at a rate above m_flThinningRate.
+        std::shared_ptr<SampleTraceWriter> m_pTrace;                // Timing of the samples received, NULL if not tracing.
         UINT32                      m_unInterlaceMode;
         struct sFraction
         {
@@ -0,0 +1,163 @@
+#include "TimerHeap.h"
+
+//-----------------------------------------------------------------------------
+// Constructor
+//-----------------------------------------------------------------------------
+
+DX11VideoRenderer::CTimerHeap::CTimerHeap(void) :
+    m_nextKey(1)
+{
+}
+
+//-----------------------------------------------------------------------------
+// Arm
+//
+// hnsDue:   System time from which the timer fires, in 100ns units.
+// hnsSlack: How much later it may fire, to share a wakeup with other timers.
+// pContext: Handed back by TakeDue or Cancel.
+//
+// Returns the key of the timer.
+//-----------------------------------------------------------------------------
+
+uint64_t DX11VideoRenderer::CTimerHeap::Arm(int64_t hnsDue, int64_t hnsSlack, void* pContext)
+{
+    Timer timer;
+    timer.hnsDue = hnsDue;
+    timer.hnsLatest = hnsDue + (hnsSlack > 0 ? hnsSlack : 0);
+    timer.key = m_nextKey++;
+    timer.pContext = pContext;
+
+    m_heap.push_back(timer);
+    m_positions[timer.key] = m_heap.size() - 1;
+    SiftUp(m_heap.size() - 1);
+
+    return timer.key;
+}
+
+//-----------------------------------------------------------------------------
+// Cancel
+//
+// ppContext: Receives the context of the timer, when it returns true.
+//-----------------------------------------------------------------------------
+
+bool DX11VideoRenderer::CTimerHeap::Cancel(uint64_t key, void** ppContext)
+{
+    auto it = m_positions.find(key);
+    if (it == m_positions.end())
+    {
+        return false;
+    }
+
+    *ppContext = m_heap[it->second].pContext;
+    RemoveAt(it->second);
+    return true;
+}
+
+bool DX11VideoRenderer::CTimerHeap::NextWakeup(int64_t* phnsTime) const
+{
+    if (m_heap.empty())
+    {
+        return false;
+    }
+    *phnsTime = m_heap[0].hnsLatest;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// TakeDue
+//
+// Takes the timers from the top of the heap while they are due: the one woken
+// for, and those after it in the order of their latest time which may already
+// fire. A timer due that sits below one not due yet waits for a next wakeup,
+// before its own latest time.
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CTimerHeap::TakeDue(int64_t hnsNow, std::vector<void*>* pContexts)
+{
+    while (!m_heap.empty() && m_heap[0].hnsDue <= hnsNow)
+    {
+        pContexts->push_back(m_heap[0].pContext);
+        RemoveAt(0);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Heap maintenance: the positions follow the timers moved.
+//-----------------------------------------------------------------------------
+
+bool DX11VideoRenderer::CTimerHeap::Less(size_t a, size_t b) const
+{
+    if (m_heap[a].hnsLatest != m_heap[b].hnsLatest)
+    {
+        return m_heap[a].hnsLatest < m_heap[b].hnsLatest;
+    }
+    return m_heap[a].key < m_heap[b].key; // armed first, fires first
+}
+
+void DX11VideoRenderer::CTimerHeap::Place(size_t i, const Timer& timer)
+{
+    m_heap[i] = timer;
+    m_positions[timer.key] = i;
+}
+
+void DX11VideoRenderer::CTimerHeap::SiftUp(size_t i)
+{
+    while (i > 0)
+    {
+        size_t parent = (i - 1) / 2;
+        if (!Less(i, parent))
+        {
+            break;
+        }
+        Timer timer = m_heap[i];
+        Place(i, m_heap[parent]);
+        Place(parent, timer);
+        i = parent;
+    }
+}
+
+void DX11VideoRenderer::CTimerHeap::SiftDown(size_t i)
+{
+    for (;;)
+    {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < m_heap.size() && Less(left, smallest))
+        {
+            smallest = left;
+        }
+        if (right < m_heap.size() && Less(right, smallest))
+        {
+            smallest = right;
+        }
+        if (smallest == i)
+        {
+            break;
+        }
+        Timer timer = m_heap[i];
+        Place(i, m_heap[smallest]);
+        Place(smallest, timer);
+        i = smallest;
+    }
+}
+
+void DX11VideoRenderer::CTimerHeap::RemoveAt(size_t i)
+{
+    m_positions.erase(m_heap[i].key);
+
+    size_t last = m_heap.size() - 1;
+    if (i != last)
+    {
+        uint64_t key = m_heap[last].key;
+        Place(i, m_heap[last]);
+        m_heap.pop_back();
+        // The last timer may belong above or below its new place.
+        SiftUp(i);
+        SiftDown(m_positions[key]);
+    }
+    else
+    {
+        m_heap.pop_back();
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+// Platform-neutral deadlines of CTimerWheel: one per waiting scheduler, in a min-heap. Driven
+// by the system time given by the caller, so the wakeups can be replayed against a simulated
+// clock (no Windows header).
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace DX11VideoRenderer
+{
+    //-----------------------------------------------------------------------------
+    // CTimerHeap
+    //
+    // Each timer is due at a time, and may fire up to a slack later. The heap is
+    // ordered by the latest time (due + slack), so the thread wakes once for the
+    // earliest of them; it then takes every timer already due, from the top, so
+    // the deadlines close together fire in one wakeup (like the soft and hard
+    // expiry of coalesced kernel timers). A timer never fires before it is due.
+    //
+    // The timers are identified by keys, never 0 (the key of no timer). Their
+    // context is handed back when they fire or are cancelled, never both.
+    //-----------------------------------------------------------------------------
+
+    class CTimerHeap
+    {
+    public:
+
+        CTimerHeap(void);
+
+        uint64_t Arm(int64_t hnsDue, int64_t hnsSlack, void* pContext);
+        // False if it fired already (or was never armed)
+        bool Cancel(uint64_t key, void** ppContext);
+        // False once it fired or was cancelled
+        bool IsArmed(uint64_t key) const { return m_positions.find(key) != m_positions.end(); }
+
+        // The time to wake up at, false without any timer
+        bool NextWakeup(int64_t* phnsTime) const;
+        // Removes the timers due at 'hnsNow', appending their context in firing order
+        void TakeDue(int64_t hnsNow, std::vector<void*>* pContexts);
+
+        size_t Count(void) const { return m_heap.size(); }
+
+    private:
+
+        struct Timer
+        {
+            int64_t     hnsDue;
+            int64_t     hnsLatest;
+            uint64_t    key;
+            void*       pContext;
+        };
+
+        bool Less(size_t a, size_t b) const;
+        void Place(size_t i, const Timer& timer);
+        void SiftUp(size_t i);
+        void SiftDown(size_t i);
+        void RemoveAt(size_t i);
+
+        std::vector<Timer>                      m_heap;
+        std::unordered_map<uint64_t, size_t>    m_positions;    // key -> index in m_heap
+        uint64_t                                m_nextKey;
+    };
+}
@@ -0,0 +1,313 @@
+#include "TimerWheel.h"
+
+#include <climits>
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002 // Windows 10 1803 SDK
+#endif
+
+DX11VideoRenderer::CCritSec DX11VideoRenderer::CTimerWheel::s_csInstance;
+DX11VideoRenderer::CTimerWheel* DX11VideoRenderer::CTimerWheel::s_pInstance = NULL;
+
+//-----------------------------------------------------------------------------
+// Acquire
+//
+// Returns the wheel of the process, started if it is the first user. Each
+// call is balanced by a Release.
+//-----------------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CTimerWheel::Acquire(CTimerWheel** ppWheel)
+{
+    CAutoLock lock(&s_csInstance);
+
+    if (s_pInstance == NULL)
+    {
+        CTimerWheel* pWheel = new (std::nothrow) CTimerWheel();
+        if (pWheel == NULL)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        HRESULT hr = pWheel->Start();
+        if (FAILED(hr))
+        {
+            pWheel->Stop();
+            delete pWheel;
+            return hr;
+        }
+        s_pInstance = pWheel;
+    }
+
+    s_pInstance->m_cUsers++;
+    *ppWheel = s_pInstance;
+
+    return S_OK;
+}
+
+void DX11VideoRenderer::CTimerWheel::Release(void)
+{
+    CAutoLock lock(&s_csInstance);
+
+    if (--m_cUsers == 0)
+    {
+        s_pInstance = NULL;
+
+        if (GetCurrentThreadId() == m_dwThreadId)
+        {
+            // Released by a scheduler destroyed with the reference its callback
+            // held: the thread can't wait for itself, it deletes the wheel on exit.
+            CAutoLock lockWheel(&m_critSec);
+            m_bStopping = TRUE;
+            m_bDetached = TRUE;
+            SetEvent(m_hWake);
+            return;
+        }
+
+        Stop();
+        delete this;
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Constructor / Destructor
+//-----------------------------------------------------------------------------
+
+DX11VideoRenderer::CTimerWheel::CTimerWheel(void) :
+    m_cUsers(0),
+    m_timers(), // default ctor
+    m_hThread(NULL),
+    m_hTimer(NULL),
+    m_hWake(NULL),
+    m_dwThreadId(0),
+    m_bTimerPeriodSet(FALSE),
+    m_bStopping(FALSE),
+    m_bDetached(FALSE),
+    m_due() // default ctor
+{
+}
+
+DX11VideoRenderer::CTimerWheel::~CTimerWheel(void)
+{
+    // The users cancelled their timers before releasing it: none are expected.
+    std::vector<void*> left;
+    m_timers.TakeDue(LLONG_MAX, &left);
+    for (size_t i = 0; i < left.size(); i++)
+    {
+        static_cast<IMFAsyncCallback*>(left[i])->Release();
+    }
+
+    SafeCloseHandle(m_hThread);
+    SafeCloseHandle(m_hTimer);
+    SafeCloseHandle(m_hWake);
+
+    if (m_bTimerPeriodSet)
+    {
+        timeEndPeriod(1);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Start
+//
+// Creates the timer and starts the thread.
+//-----------------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CTimerWheel::Start(void)
+{
+    // A high-resolution timer fires at its due time, without a short system-wide
+    // timer period (which costs power in the whole system).
+    m_hTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (m_hTimer == NULL)
+    {
+        // Not supported before Windows 10 1803: set a high timer resolution (ie, short timer period).
+        timeBeginPeriod(1);
+        m_bTimerPeriodSet = TRUE;
+        m_hTimer = CreateWaitableTimer(NULL, FALSE, NULL);
+    }
+    if (m_hTimer == NULL)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    m_hWake = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (m_hWake == NULL)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    m_hThread = CreateThread(NULL, 0, ThreadProc, this, 0, &m_dwThreadId);
+    if (m_hThread == NULL)
+    {
+        return HRESULT_FROM_WIN32(GetLastError());
+    }
+
+    return S_OK;
+}
+
+//-----------------------------------------------------------------------------
+// Stop
+//
+// Stops the thread, from another thread.
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CTimerWheel::Stop(void)
+{
+    if (m_hThread != NULL)
+    {
+        {
+            CAutoLock lock(&m_critSec);
+            m_bStopping = TRUE;
+        }
+        SetEvent(m_hWake);
+        WaitForSingleObject(m_hThread, INFINITE);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Arm
+//
+// hnsDelay:  System time from now to the call, in 100ns units.
+// hnsSlack:  How much later the call may be made.
+// pCallback: Invoked on the multithreaded work queue.
+// pKey:      Receives the key to cancel it.
+//-----------------------------------------------------------------------------
+
+HRESULT DX11VideoRenderer::CTimerWheel::Arm(LONGLONG hnsDelay, LONGLONG hnsSlack, IMFAsyncCallback* pCallback, MFWORKITEM_KEY* pKey)
+{
+    if (pCallback == NULL || pKey == NULL)
+    {
+        return E_POINTER;
+    }
+
+    CAutoLock lock(&m_critSec);
+
+    if (m_bStopping)
+    {
+        return MF_E_SHUTDOWN;
+    }
+
+    LONGLONG hnsWakeup = 0;
+    BOOL bHadWakeup = m_timers.NextWakeup(&hnsWakeup);
+
+    pCallback->AddRef();
+    *pKey = m_timers.Arm(MFGetSystemTime() + hnsDelay, hnsSlack, pCallback);
+
+    // The thread only wakes up earlier for it.
+    LONGLONG hnsNewWakeup = 0;
+    if (m_timers.NextWakeup(&hnsNewWakeup) && (!bHadWakeup || hnsNewWakeup < hnsWakeup))
+    {
+        SetEvent(m_hWake);
+    }
+
+    return S_OK;
+}
+
+//-----------------------------------------------------------------------------
+// Cancel
+//
+// The callback is not invoked, unless it was queued already.
+//-----------------------------------------------------------------------------
+
+void DX11VideoRenderer::CTimerWheel::Cancel(MFWORKITEM_KEY key)
+{
+    void* pContext = NULL;
+    BOOL bCancelled = FALSE;
+
+    {
+        CAutoLock lock(&m_critSec);
+        bCancelled = m_timers.Cancel(key, &pContext);
+    }
+
+    // Released outside the lock: a last reference runs the owner's destructor.
+    if (bCancelled)
+    {
+        static_cast<IMFAsyncCallback*>(pContext)->Release();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// IsArmed
+//
+// FALSE once the callback is queued (or cancelled).
+//-----------------------------------------------------------------------------
+
+BOOL DX11VideoRenderer::CTimerWheel::IsArmed(MFWORKITEM_KEY key)
+{
+    CAutoLock lock(&m_critSec);
+    return m_timers.IsArmed(key) ? TRUE : FALSE;
+}
+
+//-----------------------------------------------------------------------------
+// Run
+//
+// Thread loop: queues the callbacks due, then waits for the next wakeup (the
+// timer), or for an earlier timer armed meanwhile (the event).
+//-----------------------------------------------------------------------------
+
+DWORD WINAPI DX11VideoRenderer::CTimerWheel::ThreadProc(LPVOID pParam)
+{
+    CTimerWheel* pWheel = static_cast<CTimerWheel*>(pParam);
+
+    pWheel->Run();
+
+    // Released from this thread: nobody else waits to delete it.
+    if (pWheel->m_bDetached)
+    {
+        delete pWheel;
+    }
+    return 0;
+}
+
+void DX11VideoRenderer::CTimerWheel::Run(void)
+{
+    for (;;)
+    {
+        LONGLONG hnsWakeup = 0;
+        BOOL bArmed = FALSE;
+
+        {
+            CAutoLock lock(&m_critSec);
+
+            if (m_bStopping)
+            {
+                break;
+            }
+
+            m_timers.TakeDue(MFGetSystemTime(), &m_due);
+            bArmed = m_timers.NextWakeup(&hnsWakeup);
+        }
+
+        for (size_t i = 0; i < m_due.size(); i++)
+        {
+            IMFAsyncCallback* pCallback = static_cast<IMFAsyncCallback*>(m_due[i]);
+            (void)MFPutWorkItem(MFASYNC_CALLBACK_QUEUE_MULTITHREADED, pCallback, NULL);
+            pCallback->Release();
+        }
+        m_due.clear();
+
+        if (!bArmed)
+        {
+            WaitForSingleObject(m_hWake, INFINITE);
+            continue;
+        }
+
+        LONGLONG hnsDelay = hnsWakeup - MFGetSystemTime();
+        if (hnsDelay <= 0)
+        {
+            continue;
+        }
+
+        // a negative due time is relative
+        LARGE_INTEGER llDueTime;
+        llDueTime.QuadPart = -hnsDelay;
+        if (SetWaitableTimer(m_hTimer, &llDueTime, 0, NULL, NULL, FALSE) == 0)
+        {
+            // Not expected: poll at the millisecond rather than stall the presents.
+            WaitForSingleObject(m_hWake, 1);
+            continue;
+        }
+
+        HANDLE handles[] = { m_hWake, m_hTimer };
+        WaitForMultipleObjects(ARRAYSIZE(handles), handles, FALSE, INFINITE);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+#include "Common.h"
+#include "TimerHeap.h"
+
+namespace DX11VideoRenderer
+{
+    //-----------------------------------------------------------------------------
+    // CTimerWheel
+    //
+    // The presentation timers of all the schedulers of the process, on one thread
+    // and one high-resolution waitable timer (instead of a kernel timer and a
+    // waiting work item per scheduler). The thread sleeps until the earliest
+    // deadline of the CTimerHeap, then queues the callbacks of all the timers
+    // due in one batch, on the multithreaded work queue: a slow present does not
+    // delay the other schedulers.
+    //
+    // The wheel is started by the first scheduler that acquires it, and its
+    // thread stops with the last release.
+    //-----------------------------------------------------------------------------
+
+    class CTimerWheel
+    {
+    public:
+
+        static HRESULT Acquire(CTimerWheel** ppWheel);
+        void Release(void);
+
+        // pCallback is invoked hnsDelay (100ns units) from now, at most hnsSlack
+        // later to share a wakeup. It is referenced until then, or cancelled.
+        HRESULT Arm(LONGLONG hnsDelay, LONGLONG hnsSlack, IMFAsyncCallback* pCallback, MFWORKITEM_KEY* pKey);
+        void Cancel(MFWORKITEM_KEY key);
+        BOOL IsArmed(MFWORKITEM_KEY key);
+
+    private:
+
+        CTimerWheel(void);
+        ~CTimerWheel(void);
+
+        HRESULT Start(void);
+        void Stop(void);
+
+        static DWORD WINAPI ThreadProc(LPVOID pParam);
+        void Run(void);
+
+        static CCritSec     s_csInstance;       // Protects s_pInstance and its user count.
+        static CTimerWheel* s_pInstance;
+
+        long                m_cUsers;
+        CCritSec            m_critSec;          // Protects the timers; never held while invoking.
+        CTimerHeap          m_timers;
+        HANDLE              m_hThread;
+        HANDLE              m_hTimer;           // Due at the next wakeup.
+        HANDLE              m_hWake;            // An earlier timer was armed, or stopping.
+        DWORD               m_dwThreadId;
+        BOOL                m_bTimerPeriodSet;  // timeBeginPeriod(1) fallback, without a high-resolution timer
+        BOOL                m_bStopping;
+        BOOL                m_bDetached;        // Last released from its own thread, which deletes it.
+        std::vector<void*>  m_due;              // Callbacks taken by the thread, kept for its capacity.
+    };
+}
@@ -0,0 +1,60 @@
+#include "file_byte_stream.h"
+
+#include <mutex>
+#include <new>
+
+static std::mutex s_optionsMutex;
+static FileStreamOptions s_options;
+
+FileStreamOptions FileByteStream::GetOptions()
+{
+    std::lock_guard<std::mutex> lock(s_optionsMutex);
+    return s_options;
+}
+
+void FileByteStream::SetOptions(const FileStreamOptions& options)
+{
+    std::lock_guard<std::mutex> lock(s_optionsMutex);
+    s_options = options;
+}
+
+FileByteStream::FileByteStream(std::unique_ptr<LocalFile> file, const ReadAheadOptions& options) :
+    m_reader(std::move(file), options)
+{
+}
+
+FileByteStream::~FileByteStream()
+{
+    m_reader.Close();
+}
+
+HRESULT FileByteStream::Create(const std::wstring& path, FileByteStream** ppStream)
+{
+    *ppStream = NULL;
+    FileStreamOptions options = GetOptions();
+    if (!options.isEnabled) return E_INVALIDARG;
+
+    std::unique_ptr<LocalFile> file = LocalFile::Open(path);
+    if (!file) return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    ReadAheadOptions readerOptions;
+    readerOptions.readAheadBytes = options.readAheadBytes;
+    readerOptions.useMemoryMap = options.useMemoryMap;
+    FileByteStream* pStream = new (std::nothrow) FileByteStream(std::move(file), readerOptions);
+    if (pStream == NULL) return E_OUTOFMEMORY;
+    if (!pStream->m_reader.Open()) {
+        pStream->Release();
+        return E_OUTOFMEMORY;
+    }
+    *ppStream = pStream;
+    return S_OK;
+}
+
+LONGLONG FileByteStream::ReadAt(QWORD offset, BYTE* pb, ULONG cb)
+{
+    return m_reader.Read((int64_t)offset, pb, cb);
+}
+
+void FileByteStream::OnClose()
+{
+    m_reader.Close();
+}
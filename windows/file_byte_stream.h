@@ -0,0 +1,40 @@
+#pragma once
+
+// Byte stream of a local file (or a file on a network share) read through a
+// ReadAheadReader, in place of the Media Foundation file stream and its small synchronous
+// reads.
+
+#include <string>
+
+#include "mf_byte_stream.h"
+#include "read_ahead_reader.h"
+
+struct FileStreamOptions
+{
+    bool isEnabled = true;
+    int64_t readAheadBytes = 16 * 1024 * 1024;
+    bool useMemoryMap = false; // SSDs: reads copy from the mapped file, no I/O thread
+};
+
+class FileByteStream : public ByteStreamBase
+{
+public:
+    static FileStreamOptions GetOptions();
+    static void SetOptions(const FileStreamOptions& options);
+
+    // Opens 'path' with the current options
+    static HRESULT Create(const std::wstring& path, FileByteStream** ppStream);
+
+    ReadAheadStats GetStats() { return m_reader.GetStats(); }
+
+protected:
+    LONGLONG ReadAt(QWORD offset, BYTE* pb, ULONG cb) override;
+    QWORD Length() override { return (QWORD)m_reader.Length(); }
+    void OnClose() override;
+
+private:
+    FileByteStream(std::unique_ptr<LocalFile> file, const ReadAheadOptions& options);
+    ~FileByteStream();
+
+    ReadAheadReader m_reader;
+};
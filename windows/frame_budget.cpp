@@ -0,0 +1,196 @@
+#include "frame_budget.h"
+
+#include <thread>
+#include <vector>
+
+static int64_t DefaultBudget()
+{
+	unsigned cores = std::thread::hardware_concurrency() / 2;
+	return (int64_t)(cores < 1 ? 1 : cores) * 1000000;
+}
+
+FrameBudget& FrameBudget::Shared()
+{
+	static FrameBudget* budget = []() {
+		auto b = new FrameBudget();
+		b->m_budgetUs = DefaultBudget();
+		return b;
+	}();
+	return *budget;
+}
+
+double FrameBudget::DefaultFps(FramePriority priority)
+{
+	switch (priority) {
+	case FRAME_PRIORITY_FOCUSED: return 60;
+	case FRAME_PRIORITY_BACKGROUND: return 10;
+	default: return 30;
+	}
+}
+
+int FrameBudget::Register()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	int id = m_nextId++;
+	Client& c = m_clients[id];
+	c.targetFps = c.allowedFps = DefaultFps(c.priority);
+	return id;
+}
+
+void FrameBudget::Unregister(int id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_clients.erase(id);
+}
+
+void FrameBudget::SetPriority(int id, FramePriority priority, double targetFps)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_clients.find(id);
+	if (it == m_clients.end()) return;
+	Client& c = it->second;
+	c.priority = priority;
+	c.targetFps = targetFps > 0 ? targetFps : DefaultFps(priority);
+	c.allowedFps = c.targetFps;
+	c.scale = 1;
+	m_lastAllocationUs = -1; // applied from the next frame
+}
+
+void FrameBudget::Reset(int id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_clients.find(id);
+	if (it == m_clients.end()) return;
+	it->second = Client();
+	it->second.targetFps = it->second.allowedFps = DefaultFps(it->second.priority);
+}
+
+void FrameBudget::SetBudget(int64_t usPerSecond)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_budgetUs = usPerSecond > 0 ? usPerSecond : DefaultBudget();
+	m_lastAllocationUs = -1;
+}
+
+double FrameBudget::EstimateCost(const Client& c, uint32_t scale)
+{
+	int64_t cost = c.costUs[ScaleIndex(scale)];
+	if (cost >= 0) return (double)cost;
+	// not measured at this scale yet: roughly proportional to the pixel count
+	for (uint32_t s = 1; s <= 4; s *= 2) {
+		if (c.costUs[ScaleIndex(s)] >= 0) return (double)c.costUs[ScaleIndex(s)] * s * s / (scale * scale);
+	}
+	return 0;
+}
+
+void FrameBudget::AllocateLocked(int64_t nowUs)
+{
+	double window = m_lastAllocationUs >= 0 ? (nowUs - m_lastAllocationUs) / 1e6 : 0;
+	m_lastAllocationUs = nowUs;
+	for (auto& entry : m_clients) {
+		Client& c = entry.second;
+		if (window > 0) c.offeredFps = c.offeredCount / window;
+		c.offeredCount = 0;
+	}
+
+	double remaining = (double)m_budgetUs;
+	double demand = 0;
+	double granted = 0;
+	for (int priority = FRAME_PRIORITY_FOCUSED; priority >= FRAME_PRIORITY_BACKGROUND; priority--) {
+		std::vector<Client*> tier;
+		for (auto& entry : m_clients) {
+			if (entry.second.priority == priority) tier.push_back(&entry.second);
+		}
+		if (tier.empty()) continue;
+
+		// time per second the tier needs at each scale
+		double need[3] = { 0, 0, 0 };
+		for (Client* c : tier) {
+			double fps = c->offeredFps < c->targetFps ? c->offeredFps : c->targetFps;
+			for (uint32_t s = 1; s <= 4; s *= 2) need[ScaleIndex(s)] += EstimateCost(*c, s) * fps;
+		}
+		demand += need[0];
+
+		// the focused players get what they need, the others shrink, then drop frames
+		uint32_t scale = 4;
+		double ratio = 1;
+		if (priority == FRAME_PRIORITY_FOCUSED || need[0] <= remaining) {
+			scale = 1;
+		} else if (need[1] <= remaining) {
+			scale = 2;
+		} else if (need[2] > remaining) {
+			ratio = (remaining > 0 ? remaining : 0) / need[2];
+		}
+
+		double minFps = priority == FRAME_PRIORITY_BACKGROUND ? 1 : 5;
+		double tierGranted = 0;
+		for (Client* c : tier) {
+			c->scale = scale;
+			c->allowedFps = c->targetFps * ratio;
+			if (c->allowedFps < minFps) c->allowedFps = minFps < c->targetFps ? minFps : c->targetFps;
+			double fps = c->offeredFps < c->allowedFps ? c->offeredFps : c->allowedFps;
+			tierGranted += EstimateCost(*c, scale) * fps;
+		}
+		remaining -= tierGranted;
+		granted += tierGranted;
+	}
+	m_demandUs = (int64_t)demand;
+	m_grantedUs = (int64_t)granted;
+}
+
+FrameBudget::Decision FrameBudget::Admit(int id, int64_t nowUs)
+{
+	Decision decision;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_clients.find(id);
+	if (it == m_clients.end()) return decision;
+	Client& c = it->second;
+	c.offeredCount++;
+	if (m_lastAllocationUs < 0 || nowUs - m_lastAllocationUs >= ALLOCATION_PERIOD_US) AllocateLocked(nowUs);
+
+	// a quarter of an interval early is fine, so a source at the target frame rate isn't halved by jitter
+	int64_t intervalUs = (int64_t)(1000000 / (c.allowedFps > 0 ? c.allowedFps : 1));
+	if (nowUs + intervalUs / 4 < c.nextDueUs) {
+		c.droppedFrames++;
+		return decision;
+	}
+	int64_t dueUs = nowUs - intervalUs / 2; // no burst after a pause
+	c.nextDueUs = (c.nextDueUs > dueUs ? c.nextDueUs : dueUs) + intervalUs;
+
+	decision.isAccepted = true;
+	decision.scale = c.scale;
+	return decision;
+}
+
+void FrameBudget::Report(int id, uint32_t scale, int64_t costUs)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_clients.find(id);
+	if (it == m_clients.end()) return;
+	Client& c = it->second;
+	c.acceptedFrames++;
+	if (scale > 1) c.scaledFrames++;
+	int64_t& average = c.costUs[ScaleIndex(scale)];
+	average = average < 0 ? costUs : (average * 7 + costUs) / 8;
+}
+
+bool FrameBudget::GetStats(int id, FrameBudgetStats* pStats)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_clients.find(id);
+	if (it == m_clients.end()) return false;
+	const Client& c = it->second;
+	pStats->priority = c.priority;
+	pStats->targetFps = c.targetFps;
+	pStats->offeredFps = c.offeredFps;
+	pStats->allowedFps = c.allowedFps;
+	pStats->scale = c.scale;
+	pStats->costUs = (int64_t)EstimateCost(c, c.scale);
+	pStats->acceptedFrames = c.acceptedFrames;
+	pStats->droppedFrames = c.droppedFrames;
+	pStats->scaledFrames = c.scaledFrames;
+	pStats->budgetUs = m_budgetUs;
+	pStats->demandUs = m_demandUs;
+	pStats->grantedUs = m_grantedUs;
+	return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+// Conversion budget shared by all the players. When converting the frames of every player
+// would cost more CPU time than the budget, the players of lower priority are degraded first:
+// their frames are converted smaller, then dropped, so the focused video keeps its frame rate.
+//
+// Each player asks Admit() for every decoded frame, and reports the conversion time of the
+// frames it shows. The budget is allocated again every ALLOCATION_PERIOD_US from these costs
+// and the rate frames are actually decoded at (a paused player costs nothing).
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+
+enum FramePriority
+{
+	FRAME_PRIORITY_BACKGROUND = 0, // thumbnails, off screen
+	FRAME_PRIORITY_VISIBLE = 1,    // default
+	FRAME_PRIORITY_FOCUSED = 2,    // never degraded
+};
+
+struct FrameBudgetStats
+{
+	FramePriority priority = FRAME_PRIORITY_VISIBLE;
+	double targetFps = 0;
+	double offeredFps = 0;     // frames decoded per second
+	double allowedFps = 0;     // frames converted per second, granted by the budget
+	uint32_t scale = 1;        // output size divisor: 1, 2 or 4
+	int64_t costUs = 0;        // conversion time of a frame at 'scale'
+	uint64_t acceptedFrames = 0;
+	uint64_t droppedFrames = 0; // over the allowed frame rate
+	uint64_t scaledFrames = 0;  // converted smaller than the video
+	// all players, per second
+	int64_t budgetUs = 0;
+	int64_t demandUs = 0;      // every player at full size and target frame rate
+	int64_t grantedUs = 0;
+};
+
+class FrameBudget
+{
+public:
+	static const int64_t ALLOCATION_PERIOD_US = 500000;
+
+	struct Decision
+	{
+		bool isAccepted = false;
+		uint32_t scale = 1;
+	};
+
+	// Never destroyed, like the worker pool
+	static FrameBudget& Shared();
+
+	int Register();
+	void Unregister(int id);
+	// 'targetFps' 0 is the default of the priority
+	void SetPriority(int id, FramePriority priority, double targetFps);
+	// Back to the defaults, counters cleared (player reused for another video)
+	void Reset(int id);
+
+	// Whether a frame decoded at 'nowUs' is shown, and at which output scale
+	Decision Admit(int id, int64_t nowUs);
+	// Conversion time of a frame shown at 'scale'
+	void Report(int id, uint32_t scale, int64_t costUs);
+
+	// Conversion time per second for all the players, 0 for the default: half of the cores
+	void SetBudget(int64_t usPerSecond);
+	bool GetStats(int id, FrameBudgetStats* pStats);
+
+	static double DefaultFps(FramePriority priority);
+
+private:
+	struct Client
+	{
+		FramePriority priority = FRAME_PRIORITY_VISIBLE;
+		double targetFps = 0;
+		int64_t costUs[3] = { -1, -1, -1 }; // average per scale 1, 2, 4; -1 not measured yet
+		uint64_t offeredCount = 0;          // since the last allocation
+		double offeredFps = 0;
+		double allowedFps = 0;
+		uint32_t scale = 1;
+		int64_t nextDueUs = 0;
+		uint64_t acceptedFrames = 0;
+		uint64_t droppedFrames = 0;
+		uint64_t scaledFrames = 0;
+	};
+
+	static int ScaleIndex(uint32_t scale) { return scale >= 4 ? 2 : scale >= 2 ? 1 : 0; }
+	static double EstimateCost(const Client& c, uint32_t scale);
+	void AllocateLocked(int64_t nowUs);
+
+	std::mutex m_mutex;
+	std::map<int, Client> m_clients;
+	int m_nextId = 1;
+	int64_t m_budgetUs = 0;
+	int64_t m_demandUs = 0;
+	int64_t m_grantedUs = 0;
+	int64_t m_lastAllocationUs = -1;
+};
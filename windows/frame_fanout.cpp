@@ -0,0 +1,104 @@
+#include "frame_fanout.h"
+
+#include <algorithm>
+
+void FrameFanout::ResolveSize(uint32_t width, uint32_t height, uint32_t videoWidth, uint32_t videoHeight,
+	uint32_t* pWidth, uint32_t* pHeight)
+{
+	*pWidth = videoWidth;
+	*pHeight = videoHeight;
+	if (videoWidth == 0 || videoHeight == 0 || (width == 0 && height == 0)) return;
+
+	if (height == 0) height = (uint32_t)((uint64_t)width * videoHeight / videoWidth);
+	if (width == 0) width = (uint32_t)((uint64_t)height * videoWidth / videoHeight);
+	if (width >= videoWidth || height >= videoHeight) return;
+
+	// the converter works on 2x2 chroma blocks
+	*pWidth = std::max(width & ~1u, 2u);
+	*pHeight = std::max(height & ~1u, 2u);
+}
+
+int FrameFanout::AddOutput(uint32_t width, uint32_t height)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::shared_ptr<Buffer> buffer;
+	for (auto& b : m_buffers) {
+		if (b->requestedWidth == width && b->requestedHeight == height) buffer = b;
+	}
+	if (buffer == NULL) {
+		buffer = std::make_shared<Buffer>();
+		buffer->requestedWidth = width;
+		buffer->requestedHeight = height;
+		m_buffers.push_back(buffer);
+	}
+	buffer->outputCount++;
+
+	int id = m_nextId++;
+	m_outputs[id] = buffer;
+	return id;
+}
+
+void FrameFanout::RemoveOutput(int id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_outputs.find(id);
+	if (it == m_outputs.end()) return;
+	std::shared_ptr<Buffer> buffer = it->second;
+	m_outputs.erase(it);
+	if (--buffer->outputCount == 0) {
+		m_buffers.erase(std::remove(m_buffers.begin(), m_buffers.end(), buffer), m_buffers.end());
+	}
+}
+
+size_t FrameFanout::OutputCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_outputs.size();
+}
+
+void FrameFanout::Process(const Nv12Frame& frame, const uint8_t* fullFrame)
+{
+	// converted out of the lock (a buffer removed meanwhile is kept alive by 'scaled'),
+	// so showing a texture never waits for a conversion
+	std::vector<std::shared_ptr<Buffer>> scaled;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_fullFrame = fullFrame;
+		for (auto& b : m_buffers) {
+			uint32_t width, height;
+			ResolveSize(b->requestedWidth, b->requestedHeight, frame.width, frame.height, &width, &height);
+			b->isFullFrame = width == frame.width && height == frame.height;
+			if (!b->isFullFrame && (b->width != width || b->height != height || b->pixels.empty())) {
+				b->pixels.assign((size_t)width * height * 4, 0);
+			}
+			b->width = width;
+			b->height = height;
+			if (!b->isFullFrame) scaled.push_back(b);
+		}
+	}
+
+	for (auto& b : scaled) {
+		ConvertScaleNv12ToRgba(frame, b->pixels.data(), b->width, b->height, b->width * 4);
+	}
+}
+
+void FrameFanout::ClearFullFrame()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_fullFrame = NULL;
+}
+
+bool FrameFanout::GetOutput(int id, const uint8_t** pPixels, uint32_t* pWidth, uint32_t* pHeight)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_outputs.find(id);
+	if (it == m_outputs.end()) return false;
+
+	const Buffer& b = *it->second;
+	const uint8_t* pixels = b.isFullFrame ? m_fullFrame : (b.pixels.empty() ? NULL : b.pixels.data());
+	if (pixels == NULL || b.width == 0 || b.height == 0) return false;
+	*pPixels = pixels;
+	*pWidth = b.width;
+	*pHeight = b.height;
+	return true;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+// One decoded video shown in several textures (ex. a large view and a thumbnail of the
+// same camera). Each output has its own size; a frame is converted once per distinct
+// size, and the outputs of the same size share that buffer. Outputs of the video size
+// share the full size frame the player converts anyway.
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "video_convert.h"
+
+class FrameFanout
+{
+public:
+	// 0 x 0 is the video size, one of them 0 keeps the aspect ratio. Outputs are never
+	// upscaled. Returns the output id.
+	int AddOutput(uint32_t width, uint32_t height);
+	void RemoveOutput(int id);
+	size_t OutputCount();
+
+	// Called for each decoded frame, 'fullFrame' being the frame already converted at the video size
+	void Process(const Nv12Frame& frame, const uint8_t* fullFrame);
+	// Forgets the full size frame, before it is freed
+	void ClearFullFrame();
+
+	// Last frame of output 'id', false before the first one
+	bool GetOutput(int id, const uint8_t** pPixels, uint32_t* pWidth, uint32_t* pHeight);
+
+	// Size of an output of 'width' x 'height' for a video of 'videoWidth' x 'videoHeight'
+	static void ResolveSize(uint32_t width, uint32_t height, uint32_t videoWidth, uint32_t videoHeight,
+		uint32_t* pWidth, uint32_t* pHeight);
+
+private:
+	struct Buffer
+	{
+		uint32_t requestedWidth = 0;
+		uint32_t requestedHeight = 0;
+		uint32_t width = 0;  // resolved on the last frame
+		uint32_t height = 0;
+		bool isFullFrame = false;
+		std::vector<uint8_t> pixels;
+		int outputCount = 0;
+	};
+
+	std::mutex m_mutex;
+	int m_nextId = 1;
+	std::map<int, std::shared_ptr<Buffer>> m_outputs;
+	std::vector<std::shared_ptr<Buffer>> m_buffers; // one per requested size
+	const uint8_t* m_fullFrame = NULL;
+};
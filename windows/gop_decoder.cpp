@@ -0,0 +1,181 @@
+// ref: https://learn.microsoft.com/en-us/windows/win32/medfound/using-the-source-reader-to-process-media-data
+
+#include "gop_decoder.h"
+
+#include <mfapi.h>
+#include <mfidl.h>
+#include <propvarutil.h>
+
+#include "video_convert.h"
+#include "worker_pool.h"
+
+#define CHECK_HR(x) if (FAILED(x)) { goto done; }
+
+// Packed copy of the visible picture of a NV12 sample
+static HRESULT CopySample(IMFSample* pSample, const FrameLayout& layout, LONGLONG hnsTime, CachedFramePtr* ppFrame)
+{
+    HRESULT hr = S_OK;
+    wil::com_ptr<IMFMediaBuffer> pBuffer;
+    wil::com_ptr<IMF2DBuffer> p2DBuffer;
+    BYTE* pData = NULL;
+    LONG pitch = 0;
+    DWORD cbLength = 0;
+    bool is2DLocked = false;
+    bool isLocked = false;
+    LONGLONG hnsDuration = 0;
+    Nv12Frame frame;
+
+    CHECK_HR(hr = pSample->ConvertToContiguousBuffer(&pBuffer));
+    if (SUCCEEDED(pBuffer->QueryInterface(IID_PPV_ARGS(&p2DBuffer))) && SUCCEEDED(p2DBuffer->Lock2D(&pData, &pitch))) {
+        is2DLocked = true;
+    } else {
+        CHECK_HR(hr = pBuffer->Lock(&pData, NULL, &cbLength));
+        isLocked = true;
+        pitch = (LONG)layout.stride;
+        if ((UINT64)pitch * layout.frameHeight * 3 / 2 > cbLength) {
+            hr = MF_E_BUFFERTOOSMALL;
+            goto done;
+        }
+    }
+    if (pitch <= 0) {
+        hr = MF_E_UNSUPPORTED_FORMAT;
+        goto done;
+    }
+
+    frame.y = pData;
+    frame.uv = pData + (size_t)pitch * layout.frameHeight;
+    frame.width = layout.visibleWidth;
+    frame.height = layout.visibleHeight;
+    frame.stride = (uint32_t)pitch;
+    pSample->GetSampleDuration(&hnsDuration);
+    *ppFrame = std::make_shared<CachedFrame>(frame, hnsTime, hnsDuration);
+
+done:
+    if (is2DLocked) p2DBuffer->Unlock2D();
+    if (isLocked) pBuffer->Unlock();
+    return hr;
+}
+
+GopDecoder::GopDecoder(const std::wstring& path, std::shared_ptr<GopFrameCache> pCache, size_t maxGopBytes) :
+    m_path(path), m_pCache(pCache), m_maxGopBytes(maxGopBytes)
+{
+}
+
+GopDecoder::~GopDecoder()
+{
+    Shutdown();
+}
+
+void GopDecoder::Request(int64_t hnsStart, int64_t hnsEnd, Callback callback)
+{
+    bool isPosted = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_isShutdown) return;
+        auto it = m_callbacks.find(hnsStart);
+        if (it == m_callbacks.end()) {
+            it = m_callbacks.emplace(hnsStart, std::vector<Callback>()).first;
+            m_queue.push_back(std::make_pair(hnsStart, hnsEnd));
+        }
+        if (callback) it->second.push_back(callback);
+        if (!m_isRunning) {
+            m_isRunning = true;
+            isPosted = true;
+        }
+    }
+    if (isPosted) WorkerPool::Shared().Post([this]() { Run(); });
+}
+
+void GopDecoder::Shutdown()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_isShutdown = true;
+    m_queue.clear();
+    m_callbacks.clear();
+    m_cv.wait(lock, [this]() { return !m_isRunning; });
+}
+
+void GopDecoder::Run()
+{
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    for (;;) {
+        std::pair<int64_t, int64_t> gop;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_queue.empty() || m_isShutdown) break;
+            gop = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        if (!m_pCache->HasGop(gop.first)) DecodeGop(gop.first, gop.second);
+
+        std::vector<Callback> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_callbacks.find(gop.first);
+            if (it != m_callbacks.end()) {
+                callbacks.swap(it->second);
+                m_callbacks.erase(it);
+            }
+        }
+        for (auto& callback : callbacks) callback();
+    }
+    // the reader belongs to this thread's apartment: not kept while idle
+    m_pReader.reset();
+    CoUninitialize();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_isRunning = false;
+    m_cv.notify_all();
+}
+
+HRESULT GopDecoder::DecodeGop(int64_t hnsStart, int64_t hnsEnd)
+{
+    HRESULT hr = S_OK;
+    PROPVARIANT var;
+    std::vector<CachedFramePtr> frames;
+    size_t bytes = 0;
+    size_t dropped = 0; // over m_maxGopBytes, from the front
+
+    PropVariantInit(&var);
+    if (!m_pReader) CHECK_HR(hr = CreateNv12Reader(m_path.c_str(), &m_pReader, &m_layout));
+
+    // the source seeks to the keyframe at or before the start (before it for a chunk)
+    CHECK_HR(hr = InitPropVariantFromInt64(hnsStart, &var));
+    CHECK_HR(hr = m_pReader->SetCurrentPosition(GUID_NULL, var));
+
+    for (;;) {
+        DWORD flags = 0;
+        LONGLONG hnsSample = 0;
+        wil::com_ptr<IMFSample> pSample;
+        CachedFramePtr pFrame;
+
+        CHECK_HR(hr = m_pReader->ReadSample((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, NULL, &flags, &hnsSample, &pSample));
+        if (flags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED) {
+            CHECK_HR(hr = GetFrameLayout(m_pReader.get(), &m_layout));
+        }
+        if (pSample && hnsSample >= hnsEnd) break;
+        if (flags & MF_SOURCE_READERF_ENDOFSTREAM) break;
+        if (!pSample || hnsSample < hnsStart) continue;
+
+        CHECK_HR(hr = CopySample(pSample.get(), m_layout, hnsSample, &pFrame));
+        frames.push_back(pFrame);
+        bytes += pFrame->nv12.size();
+        while (bytes > m_maxGopBytes && frames.size() - dropped > 1) {
+            bytes -= frames[dropped]->nv12.size();
+            frames[dropped++].reset();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_isShutdown) goto done;
+        }
+    }
+
+    if (dropped > 0) frames.erase(frames.begin(), frames.begin() + dropped);
+    m_pCache->AddGop(hnsStart, hnsEnd, std::move(frames), dropped == 0);
+
+done:
+    PropVariantClear(&var);
+    return hr;
+}
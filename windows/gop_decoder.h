@@ -0,0 +1,56 @@
+#pragma once
+
+// Background decoder of the GOP frame cache: decodes a whole GOP of a local file with its own
+// IMFSourceReader (no media session), on the shared worker pool, one GOP at a time.
+
+#include <windows.h>
+#include <mfreadwrite.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <wil/com.h>
+
+#include "gop_frame_cache.h"
+#include "thumbnail_extractor.h"
+
+class GopDecoder
+{
+public:
+    typedef std::function<void()> Callback;
+
+    // A GOP holding more than 'maxGopBytes' of frames keeps its last ones only
+    GopDecoder(const std::wstring& path, std::shared_ptr<GopFrameCache> pCache, size_t maxGopBytes);
+    ~GopDecoder();
+
+    // Decodes [hnsStart, hnsEnd) into the cache, unless it is there already. 'callback' (may be
+    // NULL) is called on a worker thread once done, decoded or not; requests of a GOP queued or
+    // being decoded share the decode.
+    void Request(int64_t hnsStart, int64_t hnsEnd, Callback callback);
+
+    // Drops the queued requests and waits for the decode in progress: no callback is called after
+    void Shutdown();
+
+private:
+    void Run();
+    HRESULT DecodeGop(int64_t hnsStart, int64_t hnsEnd);
+
+    const std::wstring m_path;
+    const std::shared_ptr<GopFrameCache> m_pCache;
+    const size_t m_maxGopBytes;
+    wil::com_ptr<IMFSourceReader> m_pReader; // of the worker thread running, released when idle
+    FrameLayout m_layout;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv; // m_isRunning
+    std::deque<std::pair<int64_t, int64_t>> m_queue;
+    std::map<int64_t, std::vector<Callback>> m_callbacks; // by GOP start, queued or being decoded
+    bool m_isRunning = false; // a worker runs the queue
+    bool m_isShutdown = false;
+};
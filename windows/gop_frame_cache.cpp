@@ -0,0 +1,227 @@
+#include "gop_frame_cache.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+CachedFrame::CachedFrame(const Nv12Frame& frame, int64_t hnsTime, int64_t hnsDuration) :
+	hnsTime(hnsTime), hnsDuration(hnsDuration), width(frame.width), height(frame.height)
+{
+	// both planes at the same even stride, as Nv12Frame expects
+	size_t stride = (width + 1) & ~1u;
+	size_t chromaRows = (height + 1) / 2;
+	nv12.resize(stride * height + stride * chromaRows);
+	for (uint32_t row = 0; row < height; row++) {
+		memcpy(nv12.data() + row * stride, frame.y + (size_t)row * frame.stride, width);
+	}
+	uint8_t* uv = nv12.data() + stride * height;
+	for (size_t row = 0; row < chromaRows; row++) {
+		memcpy(uv + row * stride, frame.uv + row * frame.stride, stride);
+	}
+}
+
+Nv12Frame CachedFrame::View() const
+{
+	Nv12Frame frame;
+	uint32_t stride = (width + 1) & ~1u;
+	frame.y = nv12.data();
+	frame.uv = nv12.data() + (size_t)stride * height;
+	frame.width = width;
+	frame.height = height;
+	frame.stride = stride;
+	return frame;
+}
+
+void GetGopBounds(const std::vector<int64_t>& hnsKeyframes, int64_t hnsTime, int64_t* pStart, int64_t* pEnd)
+{
+	if (hnsKeyframes.empty()) {
+		int64_t chunk = hnsTime >= 0 ? hnsTime / GopFrameCache::CHUNK_HNS : 0;
+		*pStart = chunk * GopFrameCache::CHUNK_HNS;
+		*pEnd = *pStart + GopFrameCache::CHUNK_HNS;
+		return;
+	}
+	auto next = std::upper_bound(hnsKeyframes.begin(), hnsKeyframes.end(), hnsTime);
+	*pStart = next == hnsKeyframes.begin() ? hnsKeyframes.front() : *(next - 1);
+	if (next == hnsKeyframes.begin()) next++; // before the first keyframe: its GOP
+	*pEnd = next == hnsKeyframes.end() ? INT64_MAX : *next;
+}
+
+GopFrameCache::GopFrameCache(size_t maxBytes) : m_maxBytes(maxBytes)
+{
+}
+
+void GopFrameCache::SetMaxBytes(size_t maxBytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_maxBytes = maxBytes;
+	TrimLocked(-1);
+}
+
+void GopFrameCache::SetPlayHead(int64_t hnsTime)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_hnsPlayHead = hnsTime;
+}
+
+std::map<int64_t, GopFrameCache::Gop>::iterator GopFrameCache::FindLocked(int64_t hnsTime)
+{
+	auto it = m_gops.upper_bound(hnsTime);
+	if (it == m_gops.begin()) return m_gops.end();
+	--it;
+	return hnsTime < it->second.hnsEnd ? it : m_gops.end();
+}
+
+void GopFrameCache::TrimLocked(int64_t hnsKeepStart)
+{
+	while (m_usedBytes > m_maxBytes) {
+		// the farthest from the play head, never the GOP holding it nor the one just added
+		auto farthest = m_gops.end();
+		int64_t maxDistance = -1;
+		for (auto it = m_gops.begin(); it != m_gops.end(); it++) {
+			if (it->first == hnsKeepStart) continue;
+			int64_t distance = 0;
+			if (m_hnsPlayHead < it->first) distance = it->first - m_hnsPlayHead;
+			else if (m_hnsPlayHead >= it->second.hnsEnd) distance = m_hnsPlayHead - it->second.hnsEnd + 1;
+			if (distance > maxDistance) {
+				maxDistance = distance;
+				farthest = it;
+			}
+		}
+		if (farthest == m_gops.end() || maxDistance == 0) break;
+		m_usedBytes -= farthest->second.bytes;
+		if (m_lastGopStart == farthest->first) m_lastGopStart = -1;
+		m_gops.erase(farthest);
+		m_stats.evictedGops++;
+	}
+}
+
+void GopFrameCache::AddGop(int64_t hnsStart, int64_t hnsEnd, std::vector<CachedFramePtr> frames, bool isHeadCovered)
+{
+	if (frames.empty()) return;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	Gop& gop = m_gops[hnsStart];
+	m_usedBytes -= gop.bytes;
+	gop.hnsEnd = hnsEnd;
+	gop.frames = std::move(frames);
+	gop.isHeadCovered = isHeadCovered;
+	gop.isTailCovered = true;
+	gop.bytes = 0;
+	for (auto& frame : gop.frames) gop.bytes += frame->nv12.size();
+	m_usedBytes += gop.bytes;
+	TrimLocked(hnsStart);
+}
+
+void GopFrameCache::AddFrame(int64_t hnsGopStart, int64_t hnsGopEnd, CachedFramePtr frame, bool isContiguous)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	// the previous frame was the last one of its GOP
+	bool isGopCrossed = isContiguous && m_lastGopStart >= 0 && m_lastGopStart != hnsGopStart;
+	if (isGopCrossed) {
+		auto previous = m_gops.find(m_lastGopStart);
+		if (previous != m_gops.end() && previous->second.hnsEnd == hnsGopStart) previous->second.isTailCovered = true;
+	}
+	bool isFollowing = isContiguous && m_lastGopStart == hnsGopStart;
+	m_lastGopStart = hnsGopStart;
+
+	Gop& gop = m_gops[hnsGopStart];
+	if (gop.isHeadCovered && gop.isTailCovered) return; // decoded already
+	if (isFollowing && !gop.frames.empty() && gop.frames.back()->hnsTime < frame->hnsTime) {
+		gop.frames.push_back(frame);
+	}
+	else {
+		// a new run of frames: what was recorded of this GOP may not be contiguous with it
+		m_usedBytes -= gop.bytes;
+		gop.bytes = 0;
+		gop.frames.assign(1, frame);
+		gop.hnsEnd = hnsGopEnd;
+		gop.isHeadCovered = isGopCrossed || frame->hnsTime <= hnsGopStart + frame->hnsDuration / 2;
+		gop.isTailCovered = false;
+	}
+	gop.bytes += frame->nv12.size();
+	m_usedBytes += frame->nv12.size();
+	TrimLocked(hnsGopStart);
+}
+
+bool GopFrameCache::HasGop(int64_t hnsStart)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_gops.find(hnsStart);
+	return it != m_gops.end() && it->second.isHeadCovered && it->second.isTailCovered;
+}
+
+static bool IsFrameBefore(const CachedFramePtr& frame, int64_t hnsTime)
+{
+	return frame->hnsTime < hnsTime;
+}
+
+static bool IsFrameAfter(int64_t hnsTime, const CachedFramePtr& frame)
+{
+	return hnsTime < frame->hnsTime;
+}
+
+CachedFramePtr GopFrameCache::Next(int64_t hnsTime)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = FindLocked(hnsTime);
+	if (it != m_gops.end()) {
+		Gop& gop = it->second;
+		auto next = std::upper_bound(gop.frames.begin(), gop.frames.end(), hnsTime, IsFrameAfter);
+		if (next != gop.frames.end()) {
+			// follows the frame shown if that one is cached too (the frames are consecutive)
+			if (next != gop.frames.begin() || gop.isHeadCovered) {
+				m_stats.hits++;
+				return *next;
+			}
+		}
+		else if (gop.isTailCovered) {
+			// the frame shown is the last of its GOP: the first of the next one
+			auto following = m_gops.find(gop.hnsEnd);
+			if (following != m_gops.end() && following->second.isHeadCovered && !following->second.frames.empty()) {
+				m_stats.hits++;
+				return following->second.frames.front();
+			}
+		}
+	}
+	m_stats.misses++;
+	return NULL;
+}
+
+CachedFramePtr GopFrameCache::Previous(int64_t hnsTime)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = FindLocked(hnsTime - 1);
+	if (it != m_gops.end()) {
+		Gop& gop = it->second;
+		auto after = std::lower_bound(gop.frames.begin(), gop.frames.end(), hnsTime, IsFrameBefore);
+		if (after != gop.frames.begin()) {
+			const CachedFramePtr& previous = *(after - 1);
+			// it is the frame right before the one shown: a cached frame follows it in the GOP,
+			// or it ends the GOP, or the frame shown starts where it ends
+			bool isAdjacent = after != gop.frames.end() || gop.isTailCovered ||
+				hnsTime <= previous->hnsTime + previous->hnsDuration * 3 / 2;
+			if (isAdjacent) {
+				m_stats.hits++;
+				return previous;
+			}
+		}
+	}
+	m_stats.misses++;
+	return NULL;
+}
+
+void GopFrameCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_gops.clear();
+	m_usedBytes = 0;
+	m_lastGopStart = -1;
+}
+
+GopFrameCacheStats GopFrameCache::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	GopFrameCacheStats stats = m_stats;
+	stats.gopCount = m_gops.size();
+	stats.usedBytes = m_usedBytes;
+	return stats;
+}
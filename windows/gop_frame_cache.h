@@ -0,0 +1,96 @@
+#pragma once
+
+// Decoded frames around the play head, by GOP (keyframe to keyframe), for frame stepping
+// and reverse playback without a seek per frame.
+//
+// Frames are kept as packed NV12 (the visible picture, 1.5 bytes per pixel, converted to
+// RGBA when shown). A GOP comes either whole from the background decoder, or frame by
+// frame from playback; the frames of a GOP are always consecutive ones, and the GOP
+// records whether they reach its first / last frame, so a step never skips a frame that
+// is not cached. Past the memory budget, the GOPs farthest from the play head go first.
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "video_convert.h"
+
+struct CachedFrame
+{
+	int64_t hnsTime = 0;
+	int64_t hnsDuration = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<uint8_t> nv12; // width x height luma, then the interleaved chroma
+
+	// Packed copy of the visible part of 'frame'
+	CachedFrame(const Nv12Frame& frame, int64_t hnsTime, int64_t hnsDuration);
+	Nv12Frame View() const;
+};
+typedef std::shared_ptr<const CachedFrame> CachedFramePtr;
+
+struct GopFrameCacheStats
+{
+	int64_t hits = 0;   // steps served from the cache
+	int64_t misses = 0; // steps which waited for a decode
+	int64_t evictedGops = 0;
+	size_t gopCount = 0;
+	size_t usedBytes = 0;
+};
+
+// [start, end) of the GOP holding 'hnsTime': between the keyframes around it, or a chunk of
+// CHUNK_HNS when the keyframes are not known (the decoder then starts at the keyframe before
+// the chunk and drops the frames before it). 'hnsEnd' is INT64_MAX for the last GOP.
+void GetGopBounds(const std::vector<int64_t>& hnsKeyframes, int64_t hnsTime, int64_t* pStart, int64_t* pEnd);
+
+class GopFrameCache
+{
+public:
+	static const int64_t CHUNK_HNS = 10000000;
+
+	explicit GopFrameCache(size_t maxBytes);
+
+	void SetMaxBytes(size_t maxBytes);
+	// Eviction keeps the GOPs nearest to it
+	void SetPlayHead(int64_t hnsTime);
+
+	// A decoded GOP, its frames in presentation order up to its last one. Not 'isHeadCovered'
+	// when its first frames were dropped (a GOP larger than the decoder keeps).
+	void AddGop(int64_t hnsStart, int64_t hnsEnd, std::vector<CachedFramePtr> frames, bool isHeadCovered);
+	// A frame of playback, in order. 'isContiguous' if it follows the previous frame added
+	// (no seek, no dropped frame in between).
+	void AddFrame(int64_t hnsGopStart, int64_t hnsGopEnd, CachedFramePtr frame, bool isContiguous);
+	bool HasGop(int64_t hnsStart);
+
+	// The frame after / before the one shown at 'hnsTime', NULL if it is not cached
+	CachedFramePtr Next(int64_t hnsTime);
+	CachedFramePtr Previous(int64_t hnsTime);
+
+	void Clear();
+	GopFrameCacheStats GetStats();
+
+private:
+	struct Gop
+	{
+		int64_t hnsEnd = 0;
+		std::vector<CachedFramePtr> frames;
+		bool isHeadCovered = false; // frames[0] is the first frame of the GOP
+		bool isTailCovered = false; // frames.back() is its last frame
+		size_t bytes = 0;
+	};
+
+	// Called with m_mutex held
+	std::map<int64_t, Gop>::iterator FindLocked(int64_t hnsTime);
+	void TrimLocked(int64_t hnsKeepStart);
+
+	std::mutex m_mutex;
+	std::map<int64_t, Gop> m_gops; // by start time
+	size_t m_maxBytes;
+	size_t m_usedBytes = 0;
+	int64_t m_hnsPlayHead = 0;
+	int64_t m_lastGopStart = -1; // of the last frame added by AddFrame, -1 if none
+	GopFrameCacheStats m_stats;
+};
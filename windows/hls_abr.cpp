@@ -0,0 +1,61 @@
+#include "hls_abr.h"
+
+#include <cmath>
+
+AbrController::AbrController(const std::vector<int64_t>& bandwidths, int64_t initialEstimateBps)
+	: m_bandwidths(bandwidths), m_initialEstimateBps(initialEstimateBps)
+{
+	m_fast.halfLifeSec = FAST_HALF_LIFE_SEC;
+	m_slow.halfLifeSec = SLOW_HALF_LIFE_SEC;
+}
+
+void AbrController::Ewma::Add(double weightSec, double value)
+{
+	double alpha = pow(0.5, weightSec / halfLifeSec);
+	estimate = value * (1 - alpha) + estimate * alpha;
+	totalWeight += weightSec;
+}
+
+double AbrController::Ewma::Get() const
+{
+	double zeroFactor = 1 - pow(0.5, totalWeight / halfLifeSec);
+	return zeroFactor > 0 ? estimate / zeroFactor : 0;
+}
+
+void AbrController::OnDownload(int64_t bytes, int64_t durationUs)
+{
+	if (bytes < MIN_SAMPLE_BYTES) return;
+	double durationSec = (durationUs > 1000 ? durationUs : 1000) / 1e6;
+	double bps = bytes * 8 / durationSec;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_fast.Add(durationSec, bps);
+	m_slow.Add(durationSec, bps);
+}
+
+int64_t AbrController::EstimateBps()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_fast.totalWeight == 0) return m_initialEstimateBps;
+	double fast = m_fast.Get();
+	double slow = m_slow.Get();
+	return (int64_t)(fast < slow ? fast : slow);
+}
+
+int AbrController::SelectVariant(int current, double bufferedSec)
+{
+	if (m_bandwidths.empty()) return 0;
+	int64_t estimate = EstimateBps();
+	if (estimate <= 0) return current;
+
+	double usable = estimate * SAFETY_RATIO;
+	if (bufferedSec < LOW_BUFFER_SEC) usable /= 2;
+	int best = 0;
+	for (int i = 0; i < (int)m_bandwidths.size(); i++) {
+		if (m_bandwidths[i] <= usable) best = i;
+	}
+
+	// up only with a buffer to absorb a wrong guess
+	if (best > current && bufferedSec < MIN_BUFFER_UP_SEC) return current;
+	return best;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// Throughput-based variant selection for the HLS source.
+//
+// The throughput is estimated from the segment downloads by two exponentially weighted
+// averages over the download time, a fast and a slow one, the lower of them counting (quick
+// to react to a drop, slow to trust a burst). The highest variant whose bandwidth fits a
+// safety share of it is picked; switching up also needs enough media buffered ahead, and
+// a low buffer switches down right away.
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class AbrController
+{
+public:
+	static constexpr double SAFETY_RATIO = 0.8;
+	static constexpr double MIN_BUFFER_UP_SEC = 8;    // to switch up
+	static constexpr double LOW_BUFFER_SEC = 3;       // below, the estimate is trusted at half
+	static constexpr double FAST_HALF_LIFE_SEC = 2;
+	static constexpr double SLOW_HALF_LIFE_SEC = 10;
+	static const int64_t MIN_SAMPLE_BYTES = 16 * 1024; // smaller downloads are latency, not throughput
+
+	// 'bandwidths' of the variants, sorted ascending
+	explicit AbrController(const std::vector<int64_t>& bandwidths, int64_t initialEstimateBps = 0);
+
+	// A segment of 'bytes' downloaded in 'durationUs' (may be called by several fetch threads)
+	void OnDownload(int64_t bytes, int64_t durationUs);
+
+	// Variant for the next segment, given the current one and the media buffered ahead
+	int SelectVariant(int current, double bufferedSec);
+
+	// Bits per second, 0 until a first sample
+	int64_t EstimateBps();
+
+private:
+	struct Ewma
+	{
+		double halfLifeSec;
+		double estimate = 0;
+		double totalWeight = 0;
+
+		void Add(double weightSec, double value);
+		double Get() const; // corrected for the zero start
+	};
+
+	std::mutex m_mutex;
+	std::vector<int64_t> m_bandwidths;
+	int64_t m_initialEstimateBps;
+	Ewma m_fast;
+	Ewma m_slow;
+};
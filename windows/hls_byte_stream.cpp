@@ -0,0 +1,59 @@
+#include "hls_byte_stream.h"
+
+#include <new>
+
+static std::mutex s_optionsMutex;
+static HlsOptions s_options;
+
+HlsOptions HlsByteStream::GetOptions()
+{
+    std::lock_guard<std::mutex> lock(s_optionsMutex);
+    return s_options;
+}
+
+void HlsByteStream::SetOptions(const HlsOptions& options)
+{
+    std::lock_guard<std::mutex> lock(s_optionsMutex);
+    s_options = options;
+}
+
+HlsByteStream::HlsByteStream(const std::string& url, const HlsOptions& options) :
+    m_stream(url, HttpClient::Create(), options)
+{
+}
+
+HlsByteStream::~HlsByteStream()
+{
+    m_stream.Close();
+}
+
+HRESULT HlsByteStream::Create(const std::string& url, HlsByteStream** ppStream)
+{
+    *ppStream = NULL;
+    if (!HttpClient::IsHttpUrl(url) || !IsHlsUrl(url)) return E_INVALIDARG;
+
+    HlsByteStream* pStream = new (std::nothrow) HlsByteStream(url, GetOptions());
+    if (pStream == NULL) return E_OUTOFMEMORY;
+    if (!pStream->m_stream.Open()) {
+        pStream->Release();
+        return MF_E_NET_READ;
+    }
+    *ppStream = pStream;
+    return S_OK;
+}
+
+LONGLONG HlsByteStream::ReadAt(QWORD offset, BYTE* pb, ULONG cb)
+{
+    // the base class only reads at the current position, in order
+    std::lock_guard<std::mutex> lock(m_readMutex);
+    if (offset != m_readPosition) return -1;
+    int64_t read = m_stream.Read(pb, cb);
+    if (read > 0) m_readPosition += (QWORD)read;
+    return read;
+}
+
+void HlsByteStream::OnClose()
+{
+    m_stream.SetChangeCallback(nullptr);
+    m_stream.Close();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// Byte stream of an HLS presentation (see HlsStream): sequential, its length unknown, so
+// Media Foundation plays it through without seeking. The source resolver is given
+// FormatHint() as the URL, for the MPEG-TS or MP4 byte stream handler.
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "hls_stream.h"
+#include "mf_byte_stream.h"
+
+class HlsByteStream : public ByteStreamBase
+{
+public:
+    static HlsOptions GetOptions();
+    static void SetOptions(const HlsOptions& options);
+
+    // Opens the playlist 'url' (UTF-8) with the current options: blocks for the playlists
+    // and the initialization segment
+    static HRESULT Create(const std::string& url, HlsByteStream** ppStream);
+
+    const wchar_t* FormatHint() { return m_stream.IsFragmentedMp4() ? L"hls.mp4" : L"hls.ts"; }
+    double DurationSec() { return m_stream.DurationSec(); }
+    bool IsLive() { return m_stream.IsLive(); }
+    HlsStats GetStats() { return m_stream.GetStats(); }
+    std::vector<std::pair<double, double>> BufferedRanges() { return m_stream.BufferedRanges(); }
+    // Called on a fetch thread each time a segment is ready
+    void SetChangeCallback(std::function<void()> callback) { m_stream.SetChangeCallback(callback); }
+
+protected:
+    LONGLONG ReadAt(QWORD offset, BYTE* pb, ULONG cb) override;
+    QWORD Length() override { return (QWORD)-1; }
+    bool IsSeekable() override { return false; }
+    void OnClose() override;
+
+private:
+    HlsByteStream(const std::string& url, const HlsOptions& options);
+    ~HlsByteStream();
+
+    HlsStream m_stream;
+    std::mutex m_readMutex;
+    QWORD m_readPosition = 0; // of the next byte of m_stream
+};
@@ -0,0 +1,222 @@
+// ref: https://datatracker.ietf.org/doc/html/rfc8216
+
+#include "hls_playlist.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+// Splits on line ends (\n, \r\n), trimming the spaces around each line and a UTF-8 BOM
+static std::vector<std::string> SplitLines(const std::string& text)
+{
+	std::vector<std::string> lines;
+	size_t start = text.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+	while (start < text.size()) {
+		size_t end = text.find('\n', start);
+		if (end == std::string::npos) end = text.size();
+		size_t first = start;
+		size_t last = end;
+		while (first < last && isspace((unsigned char)text[first])) first++;
+		while (last > first && isspace((unsigned char)text[last - 1])) last--;
+		if (last > first) lines.push_back(text.substr(first, last - first));
+		start = end + 1;
+	}
+	return lines;
+}
+
+static bool StartsWith(const std::string& s, const char* prefix)
+{
+	return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// ATTR=value,ATTR="quoted, value",... -> map
+static std::map<std::string, std::string> ParseAttributes(const std::string& list)
+{
+	std::map<std::string, std::string> attributes;
+	size_t i = 0;
+	while (i < list.size()) {
+		size_t eq = list.find('=', i);
+		if (eq == std::string::npos) break;
+		std::string name = list.substr(i, eq - i);
+		std::string value;
+		i = eq + 1;
+		if (i < list.size() && list[i] == '"') {
+			size_t close = list.find('"', i + 1);
+			if (close == std::string::npos) close = list.size();
+			value = list.substr(i + 1, close - i - 1);
+			i = close + 1;
+		}
+		else {
+			size_t comma = list.find(',', i);
+			if (comma == std::string::npos) comma = list.size();
+			value = list.substr(i, comma - i);
+			i = comma;
+		}
+		attributes[name] = value;
+		if (i < list.size() && list[i] == ',') i++;
+	}
+	return attributes;
+}
+
+// "<length>[@<offset>]", the offset defaulting to the end of the previous range
+static void ParseByteRange(const std::string& value, int64_t defaultOffset, int64_t* pOffset, int64_t* pLength)
+{
+	*pLength = strtoll(value.c_str(), NULL, 10);
+	size_t at = value.find('@');
+	*pOffset = at == std::string::npos ? defaultOffset : strtoll(value.c_str() + at + 1, NULL, 10);
+}
+
+double HlsMediaPlaylist::Duration() const
+{
+	double duration = 0;
+	for (auto& segment : segments) duration += segment.duration;
+	return duration;
+}
+
+bool IsHlsPlaylist(const std::string& text)
+{
+	// a UTF-8 BOM may come first
+	size_t start = text.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+	return text.compare(start, 7, "#EXTM3U") == 0;
+}
+
+bool IsHlsMasterPlaylist(const std::string& text)
+{
+	return IsHlsPlaylist(text) && text.find("#EXT-X-STREAM-INF:") != std::string::npos;
+}
+
+bool IsHlsUrl(const std::string& url)
+{
+	size_t end = url.find_first_of("?#");
+	std::string path = url.substr(0, end);
+	if (path.size() < 5) return false;
+	std::string extension = path.substr(path.size() - 5);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+	return extension == ".m3u8";
+}
+
+bool ParseHlsMasterPlaylist(const std::string& text, const std::string& baseUrl, std::vector<HlsVariant>* pVariants)
+{
+	pVariants->clear();
+	if (!IsHlsPlaylist(text)) return false;
+
+	std::vector<std::string> lines = SplitLines(text);
+	for (size_t i = 0; i < lines.size(); i++) {
+		if (!StartsWith(lines[i], "#EXT-X-STREAM-INF:")) continue;
+		auto attributes = ParseAttributes(lines[i].substr(strlen("#EXT-X-STREAM-INF:")));
+
+		// the URI is the next line that is not a tag / comment
+		size_t uriLine = i + 1;
+		while (uriLine < lines.size() && lines[uriLine][0] == '#') uriLine++;
+		if (uriLine == lines.size()) break;
+
+		HlsVariant variant;
+		variant.bandwidth = strtoll(attributes["BANDWIDTH"].c_str(), NULL, 10);
+		const std::string& resolution = attributes["RESOLUTION"];
+		size_t x = resolution.find('x');
+		if (x != std::string::npos) {
+			variant.width = atoi(resolution.c_str());
+			variant.height = atoi(resolution.c_str() + x + 1);
+		}
+		variant.codecs = attributes["CODECS"];
+		variant.url = ResolveHlsUrl(baseUrl, lines[uriLine]);
+		if (variant.bandwidth > 0) pVariants->push_back(variant);
+		i = uriLine;
+	}
+	std::stable_sort(pVariants->begin(), pVariants->end(), [](const HlsVariant& a, const HlsVariant& b) { return a.bandwidth < b.bandwidth; });
+	return !pVariants->empty();
+}
+
+bool ParseHlsMediaPlaylist(const std::string& text, const std::string& baseUrl, HlsMediaPlaylist* pPlaylist)
+{
+	*pPlaylist = HlsMediaPlaylist();
+	if (!IsHlsPlaylist(text) || IsHlsMasterPlaylist(text)) return false;
+
+	int64_t sequence = 0;
+	double duration = -1; // of the next segment, from EXTINF
+	bool isDiscontinuity = false;
+	bool isByteRange = false;
+	int64_t offset = 0;
+	int64_t length = -1;
+	int64_t nextOffset = 0; // end of the previous byte range
+	for (auto& line : SplitLines(text)) {
+		if (StartsWith(line, "#EXT-X-TARGETDURATION:")) {
+			pPlaylist->targetDuration = atof(line.c_str() + strlen("#EXT-X-TARGETDURATION:"));
+		}
+		else if (StartsWith(line, "#EXT-X-MEDIA-SEQUENCE:")) {
+			sequence = strtoll(line.c_str() + strlen("#EXT-X-MEDIA-SEQUENCE:"), NULL, 10);
+		}
+		else if (StartsWith(line, "#EXT-X-ENDLIST")) {
+			pPlaylist->isEnded = true;
+		}
+		else if (StartsWith(line, "#EXT-X-DISCONTINUITY") && !StartsWith(line, "#EXT-X-DISCONTINUITY-SEQUENCE")) {
+			isDiscontinuity = true;
+		}
+		else if (StartsWith(line, "#EXT-X-KEY:")) {
+			auto attributes = ParseAttributes(line.substr(strlen("#EXT-X-KEY:")));
+			if (attributes["METHOD"] != "NONE") pPlaylist->isEncrypted = true;
+		}
+		else if (StartsWith(line, "#EXT-X-MAP:")) {
+			auto attributes = ParseAttributes(line.substr(strlen("#EXT-X-MAP:")));
+			pPlaylist->initUrl = ResolveHlsUrl(baseUrl, attributes["URI"]);
+			if (attributes.count("BYTERANGE")) ParseByteRange(attributes["BYTERANGE"], 0, &pPlaylist->initOffset, &pPlaylist->initLength);
+		}
+		else if (StartsWith(line, "#EXTINF:")) {
+			duration = atof(line.c_str() + strlen("#EXTINF:"));
+		}
+		else if (StartsWith(line, "#EXT-X-BYTERANGE:")) {
+			ParseByteRange(line.substr(strlen("#EXT-X-BYTERANGE:")), nextOffset, &offset, &length);
+			isByteRange = true;
+		}
+		else if (line[0] != '#') {
+			if (duration < 0) return false; // a URI without EXTINF
+			HlsSegment segment;
+			segment.url = ResolveHlsUrl(baseUrl, line);
+			segment.duration = duration;
+			segment.sequence = sequence++;
+			segment.isDiscontinuity = isDiscontinuity;
+			if (isByteRange) {
+				segment.offset = offset;
+				segment.length = length;
+				nextOffset = offset + length;
+			}
+			pPlaylist->segments.push_back(segment);
+			duration = -1;
+			isDiscontinuity = false;
+			isByteRange = false;
+		}
+	}
+	return !pPlaylist->segments.empty() || !pPlaylist->isEnded;
+}
+
+std::string ResolveHlsUrl(const std::string& baseUrl, const std::string& ref)
+{
+	if (ref.find("://") != std::string::npos) return ref;
+
+	size_t schemeEnd = baseUrl.find("://");
+	size_t hostEnd = schemeEnd == std::string::npos ? 0 : baseUrl.find('/', schemeEnd + 3);
+	if (hostEnd == std::string::npos) hostEnd = baseUrl.size();
+	if (!ref.empty() && ref[0] == '/') {
+		if (ref.size() > 1 && ref[1] == '/') return baseUrl.substr(0, schemeEnd + 1) + ref; // scheme-relative
+		return baseUrl.substr(0, hostEnd) + ref;
+	}
+
+	// path-relative: against the directory of the base path, its query dropped
+	std::string base = baseUrl.substr(0, baseUrl.find_first_of("?#", hostEnd));
+	size_t slash = base.rfind('/');
+	std::string dir = slash == std::string::npos || slash < hostEnd ? base + "/" : base.substr(0, slash + 1);
+
+	std::string path = ref;
+	while (StartsWith(path, "./") || StartsWith(path, "../")) {
+		if (path[1] == '/') {
+			path = path.substr(2);
+			continue;
+		}
+		path = path.substr(3);
+		size_t parent = dir.rfind('/', dir.size() - 2);
+		if (parent != std::string::npos && parent >= hostEnd) dir = dir.substr(0, parent + 1);
+	}
+	return dir + path;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// HLS playlists (RFC 8216): the variants of a master playlist, the segments of a media
+// playlist. Only what the HLS source plays is kept: encrypted media is detected, not
+// decrypted, and alternative renditions (EXT-X-MEDIA) are ignored, so the audio must be
+// muxed in the variant segments.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct HlsVariant
+{
+	int64_t bandwidth = 0; // peak, bits per second
+	int width = 0;         // 0 if not given
+	int height = 0;
+	std::string codecs;
+	std::string url;       // of its media playlist, absolute
+};
+
+struct HlsSegment
+{
+	std::string url;       // absolute
+	double duration = 0;   // seconds
+	int64_t sequence = 0;  // media sequence number, aligned across the variants
+	int64_t offset = 0;    // EXT-X-BYTERANGE, length -1 for the whole resource
+	int64_t length = -1;
+	bool isDiscontinuity = false;
+};
+
+struct HlsMediaPlaylist
+{
+	double targetDuration = 0;
+	bool isEnded = false;     // EXT-X-ENDLIST: VOD, or a finished live stream
+	bool isEncrypted = false; // EXT-X-KEY other than NONE
+	std::string initUrl;      // EXT-X-MAP (fragmented MP4 segments), empty for MPEG-TS
+	int64_t initOffset = 0;
+	int64_t initLength = -1;
+	std::vector<HlsSegment> segments;
+
+	double Duration() const;
+};
+
+// Master or media playlist: false if not a playlist at all
+bool IsHlsPlaylist(const std::string& text);
+bool IsHlsMasterPlaylist(const std::string& text);
+// By the path extension (.m3u8), the query excluded
+bool IsHlsUrl(const std::string& url);
+
+// Variants sorted by bandwidth, lowest first
+bool ParseHlsMasterPlaylist(const std::string& text, const std::string& baseUrl, std::vector<HlsVariant>* pVariants);
+bool ParseHlsMediaPlaylist(const std::string& text, const std::string& baseUrl, HlsMediaPlaylist* pPlaylist);
+
+// 'ref' (absolute, host-relative or path-relative) against the URL of its playlist
+std::string ResolveHlsUrl(const std::string& baseUrl, const std::string& ref);
@@ -0,0 +1,350 @@
+// ref: https://datatracker.ietf.org/doc/html/rfc8216#section-6.3
+
+#include "hls_stream.h"
+
+#include <chrono>
+#include <cstring>
+
+static const int FETCH_ATTEMPTS = 3;
+static const int IDLE_WAIT_MS = 500;
+static const int LIVE_START_SEGMENTS = 3; // from the end of a live playlist
+
+static int64_t NowUs()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+HlsStream::HlsStream(const std::string& url, std::shared_ptr<HttpClient> client, const HlsOptions& options)
+	: m_url(url), m_client(client), m_options(options)
+{
+}
+
+HlsStream::~HlsStream()
+{
+	Close();
+}
+
+bool HlsStream::FetchBytes(const std::string& url, int64_t offset, int64_t length, std::vector<uint8_t>* pData)
+{
+	bool isWhole = length < 0;
+	for (int attempt = 0; attempt < FETCH_ATTEMPTS; attempt++) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_isClosed) return false;
+		}
+		HttpResponse response;
+		if (m_client->GetRange(url, offset, isWhole ? MAX_SEGMENT_BYTES : length, &response)) {
+			// a whole resource: 200, or 206 of all of it; a byte range: 206 of exactly it
+			bool isComplete = isWhole ? (response.status == 200 || response.status == 206) && !response.body.empty()
+				: response.status == 206 && (int64_t)response.body.size() == length;
+			if (isComplete) {
+				*pData = std::move(response.body);
+				return true;
+			}
+			if (response.status >= 400 && response.status < 500) return false;
+		}
+	}
+	return false;
+}
+
+HlsStream::Playlist HlsStream::LoadPlaylist(int variant)
+{
+	std::vector<uint8_t> data;
+	if (!FetchBytes(m_variants[variant].url, 0, -1, &data) || (int64_t)data.size() > MAX_PLAYLIST_BYTES) return NULL;
+	auto playlist = std::make_shared<HlsMediaPlaylist>();
+	if (!ParseHlsMediaPlaylist(std::string(data.begin(), data.end()), m_variants[variant].url, playlist.get())) return NULL;
+	return playlist;
+}
+
+bool HlsStream::Open()
+{
+	std::vector<uint8_t> data;
+	if (!FetchBytes(m_url, 0, -1, &data) || (int64_t)data.size() > MAX_PLAYLIST_BYTES) return false;
+	std::string text(data.begin(), data.end());
+	if (IsHlsMasterPlaylist(text)) {
+		if (!ParseHlsMasterPlaylist(text, m_url, &m_variants)) return false;
+	}
+	else {
+		HlsVariant variant;
+		variant.url = m_url;
+		m_variants.push_back(variant);
+	}
+
+	std::vector<int64_t> bandwidths;
+	for (auto& variant : m_variants) bandwidths.push_back(variant.bandwidth);
+	m_abr.reset(new AbrController(bandwidths, m_options.initialBps));
+	m_variant = 0;
+	for (int i = 0; i < (int)m_variants.size(); i++) {
+		if (m_variants[i].bandwidth <= m_options.initialBps * AbrController::SAFETY_RATIO) m_variant = i;
+	}
+
+	Playlist playlist = LoadPlaylist(m_variant);
+	if (playlist == NULL || playlist->isEncrypted || (playlist->segments.empty() && playlist->isEnded)) return false;
+	if (!playlist->initUrl.empty() && !FetchBytes(playlist->initUrl, playlist->initOffset, playlist->initLength, &m_initData)) return false;
+
+	m_isLive = !playlist->isEnded;
+	m_durationSec = m_isLive ? 0 : playlist->Duration();
+	m_playlists.assign(m_variants.size(), NULL);
+	m_playlistLoadUs.assign(m_variants.size(), 0);
+	m_playlists[m_variant] = playlist;
+	m_playlistLoadUs[m_variant] = NowUs();
+
+	size_t start = 0;
+	if (m_isLive && playlist->segments.size() > LIVE_START_SEGMENTS) start = playlist->segments.size() - LIVE_START_SEGMENTS;
+	m_nextSequence = m_readSequence = playlist->segments.empty() ? 0 : playlist->segments[start].sequence;
+	m_isInitPending = !m_initData.empty();
+
+	int threads = m_options.parallelFetches < 1 ? 1 : (m_options.parallelFetches > MAX_PARALLEL_FETCHES ? MAX_PARALLEL_FETCHES : m_options.parallelFetches);
+	for (int i = 0; i < threads; i++) m_threads.emplace_back(&HlsStream::FetchThread, this);
+	return true;
+}
+
+void HlsStream::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isClosed = true;
+	}
+	m_cv.notify_all();
+	for (auto& thread : m_threads) {
+		if (thread.joinable()) thread.join();
+	}
+	m_threads.clear();
+}
+
+const HlsSegment* HlsStream::FindSegment(const Playlist& playlist, int64_t sequence)
+{
+	if (playlist == NULL || playlist->segments.empty()) return NULL;
+	int64_t index = sequence - playlist->segments.front().sequence;
+	if (index < 0 || index >= (int64_t)playlist->segments.size()) return NULL;
+	return &playlist->segments[(size_t)index];
+}
+
+void HlsStream::ScheduleLocked()
+{
+	const Playlist& playlist = m_playlists[m_variant];
+	if (playlist == NULL || playlist->segments.empty()) return;
+
+	// live: fell out of the window (paused, slow network), go on from its start
+	int64_t firstSequence = playlist->segments.front().sequence;
+	if (m_nextSequence < firstSequence && m_readSequence == m_nextSequence && m_slots.empty()) {
+		m_nextSequence = m_readSequence = firstSequence;
+		m_readOffset = 0;
+	}
+
+	double aheadSec = 0;
+	for (auto& slot : m_slots) aheadSec += slot.second.durationSec;
+	while (m_pooledBytes < m_options.maxPoolBytes && aheadSec < m_options.maxAheadSec) {
+		const HlsSegment* pSegment = FindSegment(playlist, m_nextSequence);
+		if (pSegment == NULL) break;
+		Slot& slot = m_slots[m_nextSequence++];
+		slot.startSec = m_nextStartSec;
+		slot.durationSec = pSegment->duration;
+		m_nextStartSec += pSegment->duration;
+		aheadSec += pSegment->duration;
+	}
+}
+
+double HlsStream::BufferedSecLocked()
+{
+	double bufferedSec = 0;
+	for (auto& slot : m_slots) {
+		if (slot.second.state == SLOT_READY) bufferedSec += slot.second.durationSec;
+	}
+	return bufferedSec;
+}
+
+void HlsStream::FetchThread()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_isClosed) {
+		// live: reload the playlist being fetched about every target duration
+		const Playlist& current = m_playlists[m_variant];
+		int64_t refreshUs = current == NULL ? 0 : (int64_t)(current->targetDuration * 1e6);
+		if (m_isLive && !m_isRefreshing && NowUs() - m_playlistLoadUs[m_variant] >= refreshUs) {
+			int variant = m_variant;
+			m_isRefreshing = true;
+			lock.unlock();
+			Playlist playlist = LoadPlaylist(variant);
+			lock.lock();
+			m_isRefreshing = false;
+			m_playlistLoadUs[variant] = NowUs();
+			if (playlist != NULL) m_playlists[variant] = playlist;
+			m_cv.notify_all();
+			continue;
+		}
+
+		ScheduleLocked();
+		// the lowest pending segment; past the pool budget, only the one being read
+		auto it = m_slots.begin();
+		while (it != m_slots.end() && it->second.state != SLOT_PENDING) ++it;
+		if (it == m_slots.end() || (m_pooledBytes >= m_options.maxPoolBytes && it->first != m_readSequence)) {
+			m_cv.wait_for(lock, std::chrono::milliseconds(IDLE_WAIT_MS));
+			continue;
+		}
+		int64_t sequence = it->first;
+		it->second.state = SLOT_FETCHING;
+
+		int variant = m_variant;
+		if (m_initData.empty()) variant = m_abr->SelectVariant(m_variant, BufferedSecLocked());
+		if (m_playlists[variant] == NULL || (m_isLive && variant != m_variant)) {
+			lock.unlock();
+			Playlist playlist = LoadPlaylist(variant);
+			lock.lock();
+			if (playlist != NULL) {
+				m_playlists[variant] = playlist;
+				m_playlistLoadUs[variant] = NowUs();
+			}
+		}
+		// the sequence numbers of the variants are aligned, else stay on the current one
+		const HlsSegment* pSegment = FindSegment(m_playlists[variant], sequence);
+		if (pSegment == NULL) {
+			variant = m_variant;
+			pSegment = FindSegment(m_playlists[variant], sequence);
+		}
+		if (variant != m_variant) {
+			m_variant = variant;
+			m_switches++;
+		}
+
+		bool isFetched = false;
+		std::vector<uint8_t> data;
+		if (pSegment != NULL) {
+			HlsSegment segment = *pSegment;
+			lock.unlock();
+			int64_t startUs = NowUs();
+			isFetched = FetchBytes(segment.url, segment.offset, segment.length, &data);
+			if (isFetched) m_abr->OnDownload((int64_t)data.size(), NowUs() - startUs);
+			lock.lock();
+		}
+
+		auto slot = m_slots.find(sequence);
+		if (slot == m_slots.end()) continue;
+		if (isFetched) {
+			m_pooledBytes += (int64_t)data.size();
+			m_segmentsFetched++;
+			slot->second.data = std::move(data);
+			slot->second.state = SLOT_READY;
+		}
+		else {
+			m_fetchFailures++;
+			slot->second.state = SLOT_FAILED;
+		}
+		m_cv.notify_all();
+		if (isFetched) {
+			lock.unlock();
+			NotifyChanged();
+			lock.lock();
+		}
+	}
+}
+
+int64_t HlsStream::Read(uint8_t* pDst, int64_t size)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	int64_t done = 0;
+	while (done < size) {
+		if (m_isClosed) return done > 0 ? done : -1;
+
+		if (m_isInitPending) {
+			size_t count = m_initData.size() - m_readOffset;
+			if ((int64_t)count > size - done) count = (size_t)(size - done);
+			memcpy(pDst + done, m_initData.data() + m_readOffset, count);
+			done += count;
+			m_readOffset += count;
+			if (m_readOffset == m_initData.size()) {
+				m_isInitPending = false;
+				m_readOffset = 0;
+			}
+			continue;
+		}
+
+		auto it = m_slots.find(m_readSequence);
+		if (it == m_slots.end()) {
+			const Playlist& playlist = m_playlists[m_variant];
+			bool isEnd = playlist != NULL && playlist->isEnded && FindSegment(playlist, m_readSequence) == NULL &&
+				(playlist->segments.empty() || m_readSequence > playlist->segments.back().sequence);
+			if (isEnd) return done;
+			if (done > 0) return done;
+			m_cv.wait(lock);
+			continue;
+		}
+
+		Slot& slot = it->second;
+		if (slot.state == SLOT_FAILED) {
+			if (!m_isLive) return done > 0 ? done : -1;
+			// live: the segment is gone, the next one follows
+			m_slots.erase(it);
+			m_readSequence++;
+			m_readOffset = 0;
+			m_cv.notify_all();
+			continue;
+		}
+		if (slot.state != SLOT_READY) {
+			if (done > 0) return done;
+			m_cv.wait(lock);
+			continue;
+		}
+
+		size_t count = slot.data.size() - m_readOffset;
+		if ((int64_t)count > size - done) count = (size_t)(size - done);
+		memcpy(pDst + done, slot.data.data() + m_readOffset, count);
+		done += count;
+		m_readOffset += count;
+		if (m_readOffset == slot.data.size()) {
+			m_pooledBytes -= (int64_t)slot.data.size();
+			m_slots.erase(it);
+			m_readSequence++;
+			m_readOffset = 0;
+			m_cv.notify_all(); // room in the pool
+		}
+	}
+	return done;
+}
+
+HlsStats HlsStream::GetStats()
+{
+	HlsStats stats;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	stats.variantCount = (int)m_variants.size();
+	if (!m_variants.empty()) {
+		stats.variant = m_variant;
+		stats.bandwidth = m_variants[m_variant].bandwidth;
+		stats.width = m_variants[m_variant].width;
+		stats.height = m_variants[m_variant].height;
+	}
+	stats.estimateBps = m_abr != NULL ? m_abr->EstimateBps() : 0;
+	stats.switches = m_switches;
+	stats.segmentsFetched = m_segmentsFetched;
+	stats.fetchFailures = m_fetchFailures;
+	stats.pooledBytes = m_pooledBytes;
+	stats.bufferedSec = BufferedSecLocked();
+	stats.isLive = m_isLive;
+	return stats;
+}
+
+std::vector<std::pair<double, double>> HlsStream::BufferedRanges()
+{
+	std::vector<std::pair<double, double>> ranges;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& it : m_slots) {
+		const Slot& slot = it.second;
+		if (slot.state != SLOT_READY) continue;
+		double end = slot.startSec + slot.durationSec;
+		if (!ranges.empty() && ranges.back().second >= slot.startSec - 0.001) ranges.back().second = end;
+		else ranges.push_back(std::make_pair(slot.startSec, end));
+	}
+	return ranges;
+}
+
+void HlsStream::SetChangeCallback(std::function<void()> callback)
+{
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	m_changeCallback = callback;
+}
+
+void HlsStream::NotifyChanged()
+{
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	if (m_changeCallback) m_changeCallback();
+}
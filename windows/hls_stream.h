@@ -0,0 +1,134 @@
+#pragma once
+
+// HLS presentation as one sequential byte stream: the segments of the selected variants,
+// one after the other (MPEG-TS segments concatenate into a valid transport stream; fragmented
+// MP4 segments follow their initialization segment).
+//
+// Fetch threads download several segments in parallel ahead of the read position, into a
+// pool bounded in bytes and in media time; each segment is fetched from the variant the
+// AbrController picks at that time. Variants of fragmented MP4 media are not switched (a
+// new initialization segment can't be inserted), the start variant is kept. Live playlists
+// are reloaded about every target duration, and playback starts three segments from the end.
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "hls_abr.h"
+#include "hls_playlist.h"
+#include "http_client.h"
+
+struct HlsOptions
+{
+	int parallelFetches = 3;
+	int64_t maxPoolBytes = 32 * 1024 * 1024;
+	double maxAheadSec = 30;
+	int64_t initialBps = 1000000; // estimate picking the start variant
+};
+
+struct HlsStats
+{
+	int variantCount = 0;
+	int variant = -1;          // being fetched, sorted by bandwidth (0: lowest)
+	int64_t bandwidth = 0;     // of that variant, 0 for a media playlist opened directly
+	int width = 0;
+	int height = 0;
+	int64_t estimateBps = 0;
+	int switches = 0;
+	int64_t segmentsFetched = 0;
+	int64_t fetchFailures = 0;
+	int64_t pooledBytes = 0;
+	double bufferedSec = 0;    // ready ahead of the read position
+	bool isLive = false;
+};
+
+class HlsStream
+{
+public:
+	static const int MAX_PARALLEL_FETCHES = 8;
+	static const int64_t MAX_PLAYLIST_BYTES = 4 * 1024 * 1024;
+	static const int64_t MAX_SEGMENT_BYTES = 64 * 1024 * 1024;
+
+	HlsStream(const std::string& url, std::shared_ptr<HttpClient> client, const HlsOptions& options);
+	~HlsStream();
+
+	// Loads the master playlist (or the media playlist given directly), the media playlist
+	// of the start variant and its initialization segment. Fails for encrypted media.
+	bool Open();
+	bool IsLive() const { return m_isLive; }
+	bool IsFragmentedMp4() const { return !m_initData.empty(); }
+	double DurationSec() const { return m_durationSec; } // 0 for a live stream
+
+	// Sequential read, blocks until the bytes are there: the count read, 0 at the end of
+	// the presentation, -1 on a failed segment (a live one is skipped instead) or once closed
+	int64_t Read(uint8_t* pDst, int64_t size);
+
+	// Stops the fetch threads and fails the pending read
+	void Close();
+
+	HlsStats GetStats();
+	// [start, end) seconds from the first segment read, ready or being read
+	std::vector<std::pair<double, double>> BufferedRanges();
+	// Called on a fetch thread each time a segment is ready
+	void SetChangeCallback(std::function<void()> callback);
+
+private:
+	enum SlotState { SLOT_PENDING, SLOT_FETCHING, SLOT_READY, SLOT_FAILED };
+
+	struct Slot
+	{
+		SlotState state = SLOT_PENDING;
+		double startSec = 0;
+		double durationSec = 0;
+		std::vector<uint8_t> data;
+	};
+
+	typedef std::shared_ptr<const HlsMediaPlaylist> Playlist;
+
+	bool FetchBytes(const std::string& url, int64_t offset, int64_t length, std::vector<uint8_t>* pData);
+	Playlist LoadPlaylist(int variant);
+	void FetchThread();
+	// Called with m_mutex held
+	void ScheduleLocked();
+	double BufferedSecLocked();
+	const HlsSegment* FindSegment(const Playlist& playlist, int64_t sequence);
+	void NotifyChanged();
+
+	const std::string m_url;
+	const std::shared_ptr<HttpClient> m_client;
+	const HlsOptions m_options;
+	std::vector<HlsVariant> m_variants;
+	std::unique_ptr<AbrController> m_abr;
+	std::vector<uint8_t> m_initData;
+	bool m_isLive = false;
+	double m_durationSec = 0;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv; // slot states, read progress, close
+	std::vector<Playlist> m_playlists; // per variant, NULL until loaded
+	std::vector<int64_t> m_playlistLoadUs;
+	int m_variant = 0; // of the last segment fetch started
+	std::map<int64_t, Slot> m_slots; // by media sequence number, from the read position
+	int64_t m_nextSequence = 0; // next to schedule
+	double m_nextStartSec = 0;
+	int64_t m_readSequence = 0;
+	size_t m_readOffset = 0;    // in the read slot (or in m_initData while m_isInitPending)
+	bool m_isInitPending = false;
+	bool m_isRefreshing = false; // a live playlist reload is in progress
+	bool m_isClosed = false;
+	int64_t m_pooledBytes = 0;   // of the ready slots
+	int m_switches = 0;
+	int64_t m_segmentsFetched = 0;
+	int64_t m_fetchFailures = 0;
+	std::vector<std::thread> m_threads;
+
+	std::mutex m_callbackMutex;
+	std::function<void()> m_changeCallback;
+};
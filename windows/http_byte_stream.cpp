@@ -0,0 +1,59 @@
+#include "http_byte_stream.h"
+
+#include <mutex>
+#include <new>
+
+static std::mutex s_optionsMutex;
+static HttpStreamOptions s_options;
+
+HttpStreamOptions HttpByteStream::GetOptions()
+{
+    std::lock_guard<std::mutex> lock(s_optionsMutex);
+    return s_options;
+}
+
+void HttpByteStream::SetOptions(const HttpStreamOptions& options)
+{
+    {
+        std::lock_guard<std::mutex> lock(s_optionsMutex);
+        s_options = options;
+    }
+    SegmentCache::Shared().SetMaxBytes(options.cacheBytes);
+}
+
+HttpByteStream::HttpByteStream(const std::string& url, int64_t readAheadBytes) :
+    m_reader(url, HttpClient::Create(), &SegmentCache::Shared(), readAheadBytes)
+{
+}
+
+HttpByteStream::~HttpByteStream()
+{
+    m_reader.Close();
+}
+
+HRESULT HttpByteStream::Create(const std::string& url, HttpByteStream** ppStream)
+{
+    *ppStream = NULL;
+    HttpStreamOptions options = GetOptions();
+    if (!options.isEnabled || !HttpClient::IsHttpUrl(url)) return E_INVALIDARG;
+
+    HttpByteStream* pStream = new (std::nothrow) HttpByteStream(url, options.readAheadBytes);
+    if (pStream == NULL) return E_OUTOFMEMORY;
+    if (!pStream->m_reader.Open()) {
+        pStream->Release();
+        return MF_E_NET_READ;
+    }
+    *ppStream = pStream;
+    return S_OK;
+}
+
+LONGLONG HttpByteStream::ReadAt(QWORD offset, BYTE* pb, ULONG cb)
+{
+    return m_reader.Read((int64_t)offset, pb, cb);
+}
+
+void HttpByteStream::OnClose()
+{
+    m_reader.SetChangeCallback(nullptr);
+    m_reader.Close();
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+// Byte stream of a network source, by HTTP range requests with read-ahead and the
+// on-disk segment cache (see RangeReader), in place of the Media Foundation network source.
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mf_byte_stream.h"
+#include "range_reader.h"
+
+struct HttpStreamOptions
+{
+    bool isEnabled = true;
+    int64_t readAheadBytes = 8 * 1024 * 1024;
+    uint64_t cacheBytes = SegmentCache::DEFAULT_MAX_BYTES; // 0: no disk cache
+};
+
+class HttpByteStream : public ByteStreamBase
+{
+public:
+    static HttpStreamOptions GetOptions();
+    static void SetOptions(const HttpStreamOptions& options);
+
+    // Opens 'url' (UTF-8) with the current options: blocks for the first range request
+    static HRESULT Create(const std::string& url, HttpByteStream** ppStream);
+
+    QWORD ByteLength() { return m_reader.Length(); }
+    std::vector<std::pair<int64_t, int64_t>> BufferedRanges() { return m_reader.BufferedRanges(); }
+    // Called on a reader thread each time more of the resource is buffered
+    void SetChangeCallback(std::function<void()> callback) { m_reader.SetChangeCallback(callback); }
+
+protected:
+    LONGLONG ReadAt(QWORD offset, BYTE* pb, ULONG cb) override;
+    QWORD Length() override { return m_reader.Length(); }
+    void OnClose() override;
+
+private:
+    HttpByteStream(const std::string& url, int64_t readAheadBytes);
+    ~HttpByteStream();
+
+    RangeReader m_reader;
+};
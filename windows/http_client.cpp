@@ -0,0 +1,302 @@
+// ref: https://learn.microsoft.com/en-us/windows/win32/winhttp/winhttp-sessions-overview
+
+#include "http_client.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <winhttp.h>
+#pragma comment(lib, "winhttp")
+#else
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+static const int TIMEOUT_MS = 10000;
+
+static bool StartsWithNoCase(const std::string& s, const char* prefix)
+{
+	size_t len = strlen(prefix);
+	if (s.size() < len) return false;
+	for (size_t i = 0; i < len; i++) {
+		if (tolower((unsigned char)s[i]) != prefix[i]) return false;
+	}
+	return true;
+}
+
+bool HttpClient::IsHttpUrl(const std::string& url)
+{
+	return StartsWithNoCase(url, "http://") || StartsWithNoCase(url, "https://");
+}
+
+// "bytes 0-1023/4096" -> 4096, -1 if unknown ("bytes 0-1023/*")
+static int64_t ParseContentRangeTotal(const std::string& value)
+{
+	size_t slash = value.find('/');
+	if (slash == std::string::npos || slash + 1 >= value.size() || value[slash + 1] == '*') return -1;
+	return strtoll(value.c_str() + slash + 1, NULL, 10);
+}
+
+static const int64_t SKIP_BODY = -1;
+static const int64_t UNKNOWN_BODY = -2; // no Content-Length (chunked, or up to the end of the connection)
+
+// Headers -> response, returns the body size to read, SKIP_BODY or UNKNOWN_BODY
+static int64_t ApplyHeaders(int status, const std::string& contentRange, int64_t contentLength, int64_t length, HttpResponse* pResponse)
+{
+	pResponse->status = status;
+	if (status == 206) {
+		pResponse->totalLength = ParseContentRangeTotal(contentRange);
+	}
+	else if (status == 200) {
+		// the server ignores ranges: only a resource fitting in the range is read
+		pResponse->totalLength = contentLength;
+	}
+	else {
+		return SKIP_BODY;
+	}
+	if (contentLength < 0) return UNKNOWN_BODY;
+	return contentLength <= length ? contentLength : SKIP_BODY;
+}
+
+#ifdef _WIN32
+
+static std::wstring Utf8ToWide(const std::string& str)
+{
+	int len = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, NULL, 0);
+	if (len <= 0) return std::wstring();
+	std::wstring wstr(len - 1, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &wstr[0], len);
+	return wstr;
+}
+
+static std::string QueryHeader(HINTERNET hRequest, DWORD header)
+{
+	DWORD size = 0;
+	WinHttpQueryHeaders(hRequest, header, WINHTTP_HEADER_NAME_BY_INDEX, WINHTTP_NO_OUTPUT_BUFFER, &size, WINHTTP_NO_HEADER_INDEX);
+	if (GetLastError() != ERROR_INSUFFICIENT_BUFFER || size == 0) return std::string();
+	std::wstring value(size / sizeof(WCHAR), L'\0');
+	if (!WinHttpQueryHeaders(hRequest, header, WINHTTP_HEADER_NAME_BY_INDEX, &value[0], &size, WINHTTP_NO_HEADER_INDEX)) return std::string();
+	value.resize(size / sizeof(WCHAR));
+	return std::string(value.begin(), value.end()); // header values are ASCII
+}
+
+class WinHttpClient : public HttpClient
+{
+public:
+	WinHttpClient()
+	{
+		m_hSession = WinHttpOpen(L"video_player_win", WINHTTP_ACCESS_TYPE_AUTOMATIC_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
+		if (m_hSession != NULL) WinHttpSetTimeouts(m_hSession, TIMEOUT_MS, TIMEOUT_MS, TIMEOUT_MS, TIMEOUT_MS);
+	}
+
+	~WinHttpClient()
+	{
+		if (m_hSession != NULL) WinHttpCloseHandle(m_hSession);
+	}
+
+	bool GetRange(const std::string& url, int64_t offset, int64_t length, HttpResponse* pResponse) override
+	{
+		*pResponse = HttpResponse();
+		if (m_hSession == NULL || length <= 0) return false;
+
+		std::wstring wUrl = Utf8ToWide(url);
+		URL_COMPONENTS parts = {};
+		parts.dwStructSize = sizeof(parts);
+		parts.dwHostNameLength = (DWORD)-1;
+		parts.dwUrlPathLength = (DWORD)-1;
+		parts.dwExtraInfoLength = (DWORD)-1;
+		if (!WinHttpCrackUrl(wUrl.c_str(), 0, 0, &parts)) return false;
+		std::wstring host(parts.lpszHostName, parts.dwHostNameLength);
+		std::wstring path(parts.lpszUrlPath, parts.dwUrlPathLength);
+		if (parts.lpszExtraInfo != NULL) path.append(parts.lpszExtraInfo, parts.dwExtraInfoLength);
+
+		bool isSuccess = false;
+		HINTERNET hConnect = WinHttpConnect(m_hSession, host.c_str(), parts.nPort, 0);
+		HINTERNET hRequest = NULL;
+		if (hConnect != NULL) {
+			hRequest = WinHttpOpenRequest(hConnect, L"GET", path.c_str(), NULL, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES,
+				parts.nScheme == INTERNET_SCHEME_HTTPS ? WINHTTP_FLAG_SECURE : 0);
+		}
+		if (hRequest != NULL) {
+			WCHAR range[96];
+			swprintf_s(range, L"Range: bytes=%lld-%lld", (long long)offset, (long long)(offset + length - 1));
+			if (WinHttpSendRequest(hRequest, range, (DWORD)-1L, WINHTTP_NO_REQUEST_DATA, 0, 0, 0) && WinHttpReceiveResponse(hRequest, NULL)) {
+				DWORD status = 0;
+				DWORD size = sizeof(status);
+				WinHttpQueryHeaders(hRequest, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX,
+					&status, &size, WINHTTP_NO_HEADER_INDEX);
+				std::string contentLength = QueryHeader(hRequest, WINHTTP_QUERY_CONTENT_LENGTH);
+				pResponse->validator = QueryHeader(hRequest, WINHTTP_QUERY_ETAG);
+				if (pResponse->validator.empty()) pResponse->validator = QueryHeader(hRequest, WINHTTP_QUERY_LAST_MODIFIED);
+				int64_t bodySize = ApplyHeaders((int)status, QueryHeader(hRequest, WINHTTP_QUERY_CONTENT_RANGE),
+					contentLength.empty() ? -1 : strtoll(contentLength.c_str(), NULL, 10), length, pResponse);
+				isSuccess = bodySize == SKIP_BODY || ReadBody(hRequest, bodySize, length, &pResponse->body);
+			}
+		}
+		if (hRequest != NULL) WinHttpCloseHandle(hRequest);
+		if (hConnect != NULL) WinHttpCloseHandle(hConnect);
+		return isSuccess && pResponse->status != 0;
+	}
+
+private:
+	// 'size' bytes, or with UNKNOWN_BODY up to the end (WinHTTP decodes chunks), dropped beyond 'length'
+	static bool ReadBody(HINTERNET hRequest, int64_t size, int64_t length, std::vector<uint8_t>* pBody)
+	{
+		bool isUnknown = size == UNKNOWN_BODY;
+		pBody->resize(isUnknown ? 0 : (size_t)size);
+		size_t received = 0;
+		for (;;) {
+			if (isUnknown) {
+				if ((int64_t)received > length) break;
+				pBody->resize(received + (1 << 16));
+			}
+			else if (received == pBody->size()) {
+				break;
+			}
+			DWORD read = 0;
+			DWORD toRead = (DWORD)std::min<size_t>(pBody->size() - received, 1 << 20);
+			if (!WinHttpReadData(hRequest, pBody->data() + received, toRead, &read) || read == 0) break;
+			received += read;
+		}
+		if (isUnknown) {
+			pBody->resize(received);
+			if ((int64_t)received > length) pBody->clear(); // larger than the range: as with a Content-Length
+			return true;
+		}
+		if (received == pBody->size()) return true;
+		pBody->clear();
+		return false;
+	}
+
+	HINTERNET m_hSession = NULL;
+};
+
+std::shared_ptr<HttpClient> HttpClient::Create()
+{
+	return std::make_shared<WinHttpClient>();
+}
+
+#else
+
+class SocketHttpClient : public HttpClient
+{
+public:
+	bool GetRange(const std::string& url, int64_t offset, int64_t length, HttpResponse* pResponse) override
+	{
+		*pResponse = HttpResponse();
+		if (!StartsWithNoCase(url, "http://") || length <= 0) return false;
+
+		std::string rest = url.substr(7);
+		size_t slash = rest.find('/');
+		std::string hostPort = rest.substr(0, slash);
+		std::string path = slash == std::string::npos ? "/" : rest.substr(slash);
+		std::string host = hostPort;
+		std::string port = "80";
+		size_t colon = hostPort.rfind(':');
+		if (colon != std::string::npos) {
+			host = hostPort.substr(0, colon);
+			port = hostPort.substr(colon + 1);
+		}
+
+		int fd = Connect(host, port);
+		if (fd < 0) return false;
+		std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + hostPort + "\r\nRange: bytes=" + std::to_string(offset) + "-" +
+			std::to_string(offset + length - 1) + "\r\nConnection: close\r\n\r\n";
+		bool isSuccess = send(fd, request.data(), request.size(), 0) == (ssize_t)request.size() && ReadResponse(fd, length, pResponse);
+		close(fd);
+		return isSuccess && pResponse->status != 0;
+	}
+
+private:
+	static int Connect(const std::string& host, const std::string& port)
+	{
+		addrinfo hints = {};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		addrinfo* pResult = NULL;
+		if (getaddrinfo(host.c_str(), port.c_str(), &hints, &pResult) != 0) return -1;
+		int fd = -1;
+		for (addrinfo* p = pResult; p != NULL && fd < 0; p = p->ai_next) {
+			fd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+			if (fd < 0) continue;
+			timeval timeout = { TIMEOUT_MS / 1000, 0 };
+			setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+			setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+			if (connect(fd, p->ai_addr, p->ai_addrlen) != 0) {
+				close(fd);
+				fd = -1;
+			}
+		}
+		freeaddrinfo(pResult);
+		return fd;
+	}
+
+	static bool ReadResponse(int fd, int64_t length, HttpResponse* pResponse)
+	{
+		std::string data;
+		size_t headerEnd;
+		char buffer[16384];
+		while ((headerEnd = data.find("\r\n\r\n")) == std::string::npos) {
+			ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+			if (n <= 0 || data.size() > 65536) return false;
+			data.append(buffer, (size_t)n);
+		}
+
+		int status = 0;
+		std::string contentRange;
+		int64_t contentLength = -1;
+		size_t lineStart = 0;
+		while (lineStart < headerEnd) {
+			size_t lineEnd = data.find("\r\n", lineStart);
+			std::string line = data.substr(lineStart, lineEnd - lineStart);
+			lineStart = lineEnd + 2;
+			if (status == 0) {
+				size_t space = line.find(' ');
+				if (space == std::string::npos) return false;
+				status = atoi(line.c_str() + space + 1);
+				continue;
+			}
+			size_t colon = line.find(':');
+			if (colon == std::string::npos) continue;
+			std::string name = line.substr(0, colon);
+			std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)tolower(c); });
+			size_t valueStart = line.find_first_not_of(' ', colon + 1);
+			std::string value = valueStart == std::string::npos ? std::string() : line.substr(valueStart);
+			if (name == "content-range") contentRange = value;
+			else if (name == "content-length") contentLength = strtoll(value.c_str(), NULL, 10);
+			else if (name == "etag") pResponse->validator = value;
+			else if (name == "last-modified" && pResponse->validator.empty()) pResponse->validator = value;
+		}
+
+		int64_t bodySize = ApplyHeaders(status, contentRange, contentLength, length, pResponse);
+		if (bodySize == SKIP_BODY) return true;
+		// without Content-Length, the body ends with the connection ("Connection: close")
+		bool isUnknown = bodySize == UNKNOWN_BODY;
+		pResponse->body.assign(data.begin() + headerEnd + 4, data.end());
+		while (isUnknown ? (int64_t)pResponse->body.size() <= length : (int64_t)pResponse->body.size() < bodySize) {
+			ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+			if (n <= 0) break;
+			pResponse->body.insert(pResponse->body.end(), buffer, buffer + n);
+		}
+		if (isUnknown) {
+			if ((int64_t)pResponse->body.size() > length) pResponse->body.clear();
+			return true;
+		}
+		if ((int64_t)pResponse->body.size() == bodySize) return true;
+		pResponse->body.clear();
+		return false;
+	}
+};
+
+std::shared_ptr<HttpClient> HttpClient::Create()
+{
+	return std::make_shared<SocketHttpClient>();
+}
+
+#endif
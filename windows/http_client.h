@@ -0,0 +1,31 @@
+#pragma once
+
+// Blocking HTTP range requests, for the byte streams of network sources.
+// WinHTTP on Windows; elsewhere a plain socket client (http:// only, no chunked encoding),
+// enough to run the range reader against a local stand-in server.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct HttpResponse
+{
+	int status = 0;            // 0: no response (network failure)
+	int64_t totalLength = -1;  // of the whole resource, from Content-Range or Content-Length
+	std::string validator;     // ETag, else Last-Modified: the version of the resource
+	std::vector<uint8_t> body; // empty if it is larger than the range asked for (server ignoring ranges)
+};
+
+class HttpClient
+{
+public:
+	virtual ~HttpClient() {}
+
+	// GET 'url' (UTF-8) with "Range: bytes=offset-(offset + length - 1)"
+	virtual bool GetRange(const std::string& url, int64_t offset, int64_t length, HttpResponse* pResponse) = 0;
+
+	static std::shared_ptr<HttpClient> Create();
+
+	static bool IsHttpUrl(const std::string& url);
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+// Minimal ISO-BMFF (MP4 / MOV) box walking helpers, shared by the container parsers.
+// 'Source' is MediaFile or MediaMemoryView (anything with ReadAt() / Size()).
+
+#include <cstdint>
+#include <vector>
+
+namespace iso_bmff
+{
+	constexpr uint32_t BoxType(const char (&s)[5])
+	{
+		return ((uint32_t)(uint8_t)s[0] << 24) | ((uint32_t)(uint8_t)s[1] << 16) |
+			((uint32_t)(uint8_t)s[2] << 8) | (uint32_t)(uint8_t)s[3];
+	}
+
+	inline uint16_t ReadBE16(const uint8_t* p) { return (uint16_t)((p[0] << 8) | p[1]); }
+	inline uint32_t ReadBE32(const uint8_t* p) {
+		return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+	}
+	inline uint64_t ReadBE64(const uint8_t* p) { return ((uint64_t)ReadBE32(p) << 32) | ReadBE32(p + 4); }
+
+	struct Box
+	{
+		uint32_t type = 0;
+		uint64_t begin = 0; // offset of the payload (after the header)
+		uint64_t end = 0;   // offset after the last payload byte
+
+		uint64_t PayloadSize() const { return end - begin; }
+	};
+
+	// Reads the box header at 'pos', the box must fit in [pos, parentEnd).
+	template <class Source>
+	bool ReadBox(Source& src, uint64_t pos, uint64_t parentEnd, Box* pBox)
+	{
+		uint8_t hdr[16];
+		if (parentEnd < pos || parentEnd - pos < 8) return false;
+		if (!src.ReadAt(pos, hdr, 8)) return false;
+
+		uint64_t size = ReadBE32(hdr);
+		uint64_t headerSize = 8;
+		if (size == 1) {
+			if (parentEnd - pos < 16 || !src.ReadAt(pos + 8, hdr + 8, 8)) return false;
+			size = ReadBE64(hdr + 8);
+			headerSize = 16;
+		} else if (size == 0) {
+			size = parentEnd - pos; // box extends to the end of its parent
+		}
+		if (size < headerSize || size > parentEnd - pos) return false;
+
+		pBox->type = ReadBE32(hdr + 4);
+		pBox->begin = pos + headerSize;
+		pBox->end = pos + size;
+		return true;
+	}
+
+	// Finds the first child box of 'type' in [begin, end).
+	template <class Source>
+	bool FindBox(Source& src, uint64_t begin, uint64_t end, uint32_t type, Box* pBox)
+	{
+		uint64_t pos = begin;
+		Box box;
+		while (ReadBox(src, pos, end, &box)) {
+			if (box.type == type) {
+				*pBox = box;
+				return true;
+			}
+			pos = box.end;
+		}
+		return false;
+	}
+
+	// Reads the whole payload of a box, refusing unreasonably large boxes.
+	template <class Source>
+	bool ReadPayload(Source& src, const Box& box, std::vector<uint8_t>* pData, uint64_t maxSize = 64 * 1024 * 1024)
+	{
+		if (box.PayloadSize() > maxSize) return false;
+		pData->resize((size_t)box.PayloadSize());
+		return src.ReadAt(box.begin, pData->data(), pData->size());
+	}
+}
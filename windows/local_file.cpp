@@ -0,0 +1,144 @@
+#include "local_file.h"
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+class WinLocalFile : public LocalFile
+{
+public:
+	WinLocalFile(HANDLE hFile, int64_t size) : m_hFile(hFile), m_size(size)
+	{
+	}
+
+	~WinLocalFile()
+	{
+		if (m_pView != NULL) UnmapViewOfFile(m_pView);
+		if (m_hMapping != NULL) CloseHandle(m_hMapping);
+		CloseHandle(m_hFile);
+	}
+
+	int64_t Size() override
+	{
+		return m_size;
+	}
+
+	int64_t ReadAt(int64_t offset, uint8_t* pDst, int64_t size) override
+	{
+		int64_t done = 0;
+		while (done < size && offset + done < m_size) {
+			// the offset is given with each read: no shared file pointer between threads
+			OVERLAPPED overlapped = {};
+			overlapped.Offset = (DWORD)(offset + done);
+			overlapped.OffsetHigh = (DWORD)((offset + done) >> 32);
+			DWORD toRead = size - done > 0x40000000 ? 0x40000000 : (DWORD)(size - done);
+			DWORD read = 0;
+			if (!ReadFile(m_hFile, pDst + done, toRead, &read, &overlapped)) {
+				if (GetLastError() == ERROR_HANDLE_EOF) break;
+				return -1;
+			}
+			if (read == 0) break;
+			done += read;
+		}
+		return done;
+	}
+
+	const uint8_t* Map() override
+	{
+		if (m_pView != NULL || m_isMapFailed) return (const uint8_t*)m_pView;
+		if (m_size > 0) m_hMapping = CreateFileMappingW(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_hMapping != NULL) m_pView = MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+		m_isMapFailed = m_pView == NULL;
+		return (const uint8_t*)m_pView;
+	}
+
+private:
+	HANDLE m_hFile;
+	const int64_t m_size;
+	HANDLE m_hMapping = NULL;
+	void* m_pView = NULL;
+	bool m_isMapFailed = false;
+};
+
+std::unique_ptr<LocalFile> LocalFile::Open(const std::filesystem::path& path)
+{
+	HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) return NULL;
+	LARGE_INTEGER size = {};
+	if (!GetFileSizeEx(hFile, &size)) {
+		CloseHandle(hFile);
+		return NULL;
+	}
+	return std::unique_ptr<LocalFile>(new WinLocalFile(hFile, size.QuadPart));
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class PosixLocalFile : public LocalFile
+{
+public:
+	PosixLocalFile(int fd, int64_t size) : m_fd(fd), m_size(size)
+	{
+	}
+
+	~PosixLocalFile()
+	{
+		if (m_pView != NULL) munmap(m_pView, (size_t)m_size);
+		close(m_fd);
+	}
+
+	int64_t Size() override
+	{
+		return m_size;
+	}
+
+	int64_t ReadAt(int64_t offset, uint8_t* pDst, int64_t size) override
+	{
+		int64_t done = 0;
+		while (done < size) {
+			ssize_t read = pread(m_fd, pDst + done, (size_t)(size - done), (off_t)(offset + done));
+			if (read < 0) return -1;
+			if (read == 0) break;
+			done += read;
+		}
+		return done;
+	}
+
+	const uint8_t* Map() override
+	{
+		if (m_pView != NULL || m_isMapFailed) return (const uint8_t*)m_pView;
+		void* pView = m_size > 0 ? mmap(NULL, (size_t)m_size, PROT_READ, MAP_PRIVATE, m_fd, 0) : MAP_FAILED;
+		if (pView != MAP_FAILED) {
+			madvise(pView, (size_t)m_size, MADV_SEQUENTIAL);
+			m_pView = pView;
+		}
+		m_isMapFailed = m_pView == NULL;
+		return (const uint8_t*)m_pView;
+	}
+
+private:
+	const int m_fd;
+	const int64_t m_size;
+	void* m_pView = NULL;
+	bool m_isMapFailed = false;
+};
+
+std::unique_ptr<LocalFile> LocalFile::Open(const std::filesystem::path& path)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return NULL;
+	struct stat st = {};
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return NULL;
+	}
+	return std::unique_ptr<LocalFile>(new PosixLocalFile(fd, (int64_t)st.st_size));
+}
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+// Positional reads of a local file (or a file on a network share), and its whole
+// content mapped in memory. Win32 file handles on Windows, POSIX descriptors elsewhere.
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+class LocalFile
+{
+public:
+	virtual ~LocalFile() {}
+
+	virtual int64_t Size() = 0;
+	// Up to 'size' bytes at 'offset': the count read (short at the end only), -1 on failure
+	virtual int64_t ReadAt(int64_t offset, uint8_t* pDst, int64_t size) = 0;
+	// The whole file mapped read-only, mapped at the first call; NULL if it can't be
+	virtual const uint8_t* Map() = 0;
+
+	// NULL if the file can't be opened for reading
+	static std::unique_ptr<LocalFile> Open(const std::filesystem::path& path);
+};
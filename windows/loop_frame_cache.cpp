@@ -0,0 +1,254 @@
+// ref: https://learn.microsoft.com/en-us/windows/win32/cmpapi/using-the-compression-api-in-block-mode
+
+#include "loop_frame_cache.h"
+
+#include <cstring>
+
+#include "worker_pool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <compressapi.h>
+#pragma comment(lib, "Cabinet")
+#endif
+
+// Raw frames waiting for their compression job. Past it, the workers lag behind the
+// decoder, and the next frame is compressed on the sample callback.
+static const size_t MAX_PENDING_BYTES = 64 * 1024 * 1024;
+
+// Returns false if the data can't be compressed (the frame is then kept raw)
+static bool CompressBlock(const std::vector<uint8_t>& src, std::vector<uint8_t>* pDst)
+{
+#ifdef _WIN32
+	COMPRESSOR_HANDLE hCompressor = NULL;
+	if (!CreateCompressor(COMPRESS_ALGORITHM_XPRESS | COMPRESS_RAW, NULL, &hCompressor)) return false;
+
+	// only worth it if it saves 1/8 at least
+	SIZE_T compressedSize = 0;
+	pDst->resize(src.size() - src.size() / 8);
+	BOOL isCompressed = Compress(hCompressor, src.data(), src.size(), pDst->data(), pDst->size(), &compressedSize);
+	CloseCompressor(hCompressor);
+	if (!isCompressed) return false;
+
+	pDst->resize(compressedSize);
+	pDst->shrink_to_fit();
+	return true;
+#else
+	(void)src;
+	(void)pDst;
+	return false;
+#endif
+}
+
+static bool DecompressBlock(const std::vector<uint8_t>& src, uint8_t* dst, size_t dstSize)
+{
+#ifdef _WIN32
+	DECOMPRESSOR_HANDLE hDecompressor = NULL;
+	if (!CreateDecompressor(COMPRESS_ALGORITHM_XPRESS | COMPRESS_RAW, NULL, &hDecompressor)) return false;
+
+	SIZE_T size = 0;
+	BOOL isDecompressed = Decompress(hDecompressor, src.data(), src.size(), dst, dstSize, &size);
+	CloseDecompressor(hDecompressor);
+	return isDecompressed && size == dstSize;
+#else
+	(void)src;
+	(void)dst;
+	(void)dstSize;
+	return false;
+#endif
+}
+
+void LoopFrameCache::Shared::ResetLocked(State newState)
+{
+	generation++;
+	state = newState;
+	frames.clear();
+	frames.shrink_to_fit();
+	usedBytes = 0;
+	pendingBytes = 0;
+	pendingCount = 0;
+	hnsDuration = 0;
+}
+
+void LoopFrameCache::Shared::UpdateReadyLocked()
+{
+	if (state == RECORDED && pendingCount == 0) state = frames.empty() ? IDLE : READY;
+}
+
+LoopFrameCache::LoopFrameCache(size_t maxBytes, bool isCompressed)
+	: m_pShared(std::make_shared<Shared>())
+{
+	m_pShared->maxBytes = maxBytes;
+	m_pShared->isCompressed = isCompressed;
+}
+
+LoopFrameCache::~LoopFrameCache()
+{
+	// running jobs keep the shared state alive, and discard their result
+	std::lock_guard<std::mutex> lock(m_pShared->mutex);
+	m_pShared->ResetLocked(IDLE);
+}
+
+void LoopFrameCache::BeginRecording(uint32_t width, uint32_t height)
+{
+	std::lock_guard<std::mutex> lock(m_pShared->mutex);
+	if (m_pShared->state != IDLE) return;
+	m_pShared->ResetLocked(RECORDING);
+	m_pShared->width = width;
+	m_pShared->height = height;
+}
+
+void LoopFrameCache::AddFrame(int64_t hnsTime, uint32_t width, uint32_t height, const uint8_t* pixels)
+{
+	size_t size = (size_t)width * height * 4;
+	size_t index;
+	uint64_t generation;
+	bool isInline;
+	{
+		std::lock_guard<std::mutex> lock(m_pShared->mutex);
+		Shared& s = *m_pShared;
+		if (s.state != RECORDING) return;
+		if (width != s.width || height != s.height || (!s.frames.empty() && hnsTime <= s.frames.back().hnsTime)) {
+			s.ResetLocked(IDLE); // resized or not a continuous pass: record the next one
+			return;
+		}
+		// a frame to compress is checked against the budget once compressed
+		if (s.usedBytes - s.pendingBytes + (s.isCompressed ? 0 : size) > s.maxBytes) {
+			s.ResetLocked(FAILED);
+			return;
+		}
+
+		s.frames.emplace_back();
+		Frame& frame = s.frames.back();
+		frame.hnsTime = hnsTime;
+		frame.data.assign(pixels, pixels + size);
+		s.usedBytes += size;
+		if (!s.isCompressed) return;
+
+		s.pendingCount++;
+		s.pendingBytes += size;
+		index = s.frames.size() - 1;
+		generation = s.generation;
+		isInline = s.pendingBytes > MAX_PENDING_BYTES && s.pendingCount > 1; // the workers lag behind
+	}
+
+	if (isInline) {
+		Compress(m_pShared, generation, index);
+		return;
+	}
+	std::shared_ptr<Shared> pShared = m_pShared;
+	WorkerPool::Shared().Post([pShared, generation, index]() { Compress(pShared, generation, index); });
+}
+
+void LoopFrameCache::Compress(std::shared_ptr<Shared> pShared, uint64_t generation, size_t index)
+{
+	std::vector<uint8_t> raw;
+	{
+		std::lock_guard<std::mutex> lock(pShared->mutex);
+		if (pShared->generation != generation) return;
+		raw.swap(pShared->frames[index].data); // frames are read only once all the jobs are done
+	}
+
+	size_t rawSize = raw.size();
+	std::vector<uint8_t> compressed;
+	bool isCompressed = CompressBlock(raw, &compressed);
+
+	std::lock_guard<std::mutex> lock(pShared->mutex);
+	Shared& s = *pShared;
+	if (s.generation != generation) return;
+
+	Frame& frame = s.frames[index];
+	if (isCompressed) {
+		s.usedBytes = s.usedBytes - rawSize + compressed.size();
+		frame.data.swap(compressed);
+		frame.isCompressed = true;
+	} else {
+		frame.data.swap(raw);
+	}
+	s.pendingCount--;
+	s.pendingBytes -= rawSize;
+	if (s.usedBytes - s.pendingBytes > s.maxBytes) {
+		s.ResetLocked(FAILED);
+		return;
+	}
+	s.UpdateReadyLocked();
+}
+
+void LoopFrameCache::EndRecording(int64_t hnsDuration)
+{
+	std::lock_guard<std::mutex> lock(m_pShared->mutex);
+	if (m_pShared->state != RECORDING) return;
+	m_pShared->state = RECORDED;
+	m_pShared->hnsDuration = hnsDuration;
+	m_pShared->UpdateReadyLocked();
+}
+
+void LoopFrameCache::Reset()
+{
+	std::lock_guard<std::mutex> lock(m_pShared->mutex);
+	m_pShared->ResetLocked(IDLE);
+}
+
+void LoopFrameCache::CancelRecording()
+{
+	std::lock_guard<std::mutex> lock(m_pShared->mutex);
+	if (m_pShared->state == RECORDING) m_pShared->ResetLocked(IDLE);
+}
+
+LoopFrameCache::State LoopFrameCache::GetState()
+{
+	std::lock_guard<std::mutex> lock(m_pShared->mutex);
+	return m_pShared->state;
+}
+
+size_t LoopFrameCache::FrameCount()
+{
+	std::lock_guard<std::mutex> lock(m_pShared->mutex);
+	return m_pShared->state == READY ? m_pShared->frames.size() : 0;
+}
+
+int64_t LoopFrameCache::FrameTime(size_t i)
+{
+	std::lock_guard<std::mutex> lock(m_pShared->mutex);
+	return i < m_pShared->frames.size() ? m_pShared->frames[i].hnsTime : -1;
+}
+
+int64_t LoopFrameCache::Duration()
+{
+	std::lock_guard<std::mutex> lock(m_pShared->mutex);
+	return m_pShared->hnsDuration;
+}
+
+uint32_t LoopFrameCache::Width()
+{
+	std::lock_guard<std::mutex> lock(m_pShared->mutex);
+	return m_pShared->width;
+}
+
+uint32_t LoopFrameCache::Height()
+{
+	std::lock_guard<std::mutex> lock(m_pShared->mutex);
+	return m_pShared->height;
+}
+
+bool LoopFrameCache::ReadFrame(size_t i, uint8_t* pixels)
+{
+	std::lock_guard<std::mutex> lock(m_pShared->mutex);
+	Shared& s = *m_pShared;
+	if (s.state != READY || i >= s.frames.size()) return false;
+
+	const Frame& frame = s.frames[i];
+	size_t size = (size_t)s.width * s.height * 4;
+	if (!frame.isCompressed) {
+		if (frame.data.size() != size) return false;
+		memcpy(pixels, frame.data.data(), size);
+		return true;
+	}
+	return DecompressBlock(frame.data, pixels, size);
+}
+
+size_t LoopFrameCache::MemoryUsage()
+{
+	std::lock_guard<std::mutex> lock(m_pShared->mutex);
+	return m_pShared->usedBytes;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// Converted (RGBA) frames of one pass of a short looping clip, so the next passes can
+// be shown again without seeking, decoding or converting.
+//
+// Frames are compressed on the shared worker pool (Windows Compression API, XPRESS),
+// so recording costs one copy on the sample callback. The memory budget is of the
+// frames as kept (compressed when it saves space), the raw frames waiting for their
+// job are bounded apart. The cache gives up, and frees everything, when it would
+// exceed its budget: the clip is then looped by seeking.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class LoopFrameCache
+{
+public:
+	LoopFrameCache(size_t maxBytes, bool isCompressed);
+	~LoopFrameCache();
+	LoopFrameCache(const LoopFrameCache&) = delete;
+	LoopFrameCache& operator=(const LoopFrameCache&) = delete;
+
+	enum State
+	{
+		IDLE = 0,   // nothing recorded
+		RECORDING,  // first pass in progress
+		RECORDED,   // pass complete, frames still being compressed
+		READY,      // can be replayed
+		FAILED,     // over budget, not retried until Reset()
+	};
+
+	// Recording of a pass, started on the first frame of the clip
+	void BeginRecording(uint32_t width, uint32_t height);
+	void AddFrame(int64_t hnsTime, uint32_t width, uint32_t height, const uint8_t* pixels);
+	void EndRecording(int64_t hnsDuration);
+
+	// Drops the recorded frames (ex. seek during the first pass)
+	void Reset();
+	// Drops an incomplete pass, keeps a complete one
+	void CancelRecording();
+
+	State GetState();
+	bool IsReady() { return GetState() == READY; }
+
+	// Replay, only when READY
+	size_t FrameCount();
+	int64_t FrameTime(size_t i);
+	int64_t Duration();
+	uint32_t Width();
+	uint32_t Height();
+	bool ReadFrame(size_t i, uint8_t* pixels);
+
+	size_t MemoryUsage();
+
+private:
+	struct Frame
+	{
+		int64_t hnsTime = 0;
+		bool isCompressed = false;
+		std::vector<uint8_t> data;
+	};
+
+	// Shared with the compression jobs, which may outlive the cache
+	struct Shared
+	{
+		std::mutex mutex;
+		State state = IDLE;
+		uint64_t generation = 0; // bumped on Reset(), jobs of an older generation are discarded
+		uint32_t width = 0;
+		uint32_t height = 0;
+		int64_t hnsDuration = 0;
+		size_t maxBytes = 0;
+		size_t usedBytes = 0;    // the frames, raw until compressed
+		size_t pendingBytes = 0; // raw bytes of the frames being compressed
+		size_t pendingCount = 0;
+		bool isCompressed = true;
+		std::vector<Frame> frames;
+
+		void ResetLocked(State newState);
+		void UpdateReadyLocked();
+	};
+
+	static void Compress(std::shared_ptr<Shared> pShared, uint64_t generation, size_t index);
+
+	std::shared_ptr<Shared> m_pShared;
+};
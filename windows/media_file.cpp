@@ -0,0 +1,147 @@
+#include "media_file.h"
+
+#include <cstring>
+#include <system_error>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+bool MediaFileIdentity::Query(const std::filesystem::path& path, MediaFileIdentity* pIdentity)
+{
+	std::error_code ec;
+	if (!std::filesystem::is_regular_file(path, ec)) return false;
+
+	uint64_t size = std::filesystem::file_size(path, ec);
+	if (ec) return false;
+	auto mtime = std::filesystem::last_write_time(path, ec);
+	if (ec) return false;
+
+	pIdentity->path = path;
+	pIdentity->size = size;
+	pIdentity->mtime = (int64_t)mtime.time_since_epoch().count();
+	return true;
+}
+
+bool MediaFile::Open(const std::filesystem::path& path)
+{
+	Close();
+#ifdef _WIN32
+	if (_wfopen_s(&m_fp, path.c_str(), L"rb") != 0) m_fp = NULL;
+#else
+	m_fp = fopen(path.c_str(), "rb");
+#endif
+	if (m_fp == NULL) return false;
+
+	std::error_code ec;
+	m_size = std::filesystem::file_size(path, ec);
+	if (ec) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MediaFile::Close()
+{
+	if (m_fp != NULL) fclose(m_fp);
+	m_fp = NULL;
+	m_size = 0;
+	m_bufferOffset = 0;
+	m_bufferLen = 0;
+}
+
+bool MediaFile::ReadRaw(uint64_t offset, void* buf, size_t len, size_t* pRead)
+{
+#ifdef _WIN32
+	if (_fseeki64(m_fp, (long long)offset, SEEK_SET) != 0) return false;
+#else
+	if (fseeko(m_fp, (off_t)offset, SEEK_SET) != 0) return false;
+#endif
+	*pRead = fread(buf, 1, len, m_fp);
+	m_bytesRead += *pRead;
+	return true;
+}
+
+bool MediaFile::ReadAt(uint64_t offset, void* buf, size_t len)
+{
+	if (m_fp == NULL) return false;
+	if (offset > m_size || len > m_size - offset) return false;
+	if (len == 0) return true;
+
+	// served from the buffer
+	if (offset >= m_bufferOffset && offset + len <= m_bufferOffset + m_bufferLen) {
+		memcpy(buf, m_buffer + (offset - m_bufferOffset), len);
+		return true;
+	}
+
+	// large reads (ex. sample tables) bypass the buffer
+	size_t nRead = 0;
+	if (len > BUFFER_SIZE / 2) {
+		return ReadRaw(offset, buf, len, &nRead) && nRead == len;
+	}
+
+	if (!ReadRaw(offset, m_buffer, BUFFER_SIZE, &nRead)) {
+		m_bufferLen = 0;
+		return false;
+	}
+	m_bufferOffset = offset;
+	m_bufferLen = nRead;
+	if (nRead < len) return false;
+	memcpy(buf, m_buffer, len);
+	return true;
+}
+
+bool MappedFile::Open(const std::filesystem::path& path)
+{
+	Close();
+	std::error_code ec;
+	uint64_t size = std::filesystem::file_size(path, ec);
+	if (ec || size == 0 || size > (uint64_t)SIZE_MAX) return false;
+
+#ifdef _WIN32
+	HANDLE hFile = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) return false;
+	m_hFile = hFile;
+
+	HANDLE hMapping = CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (hMapping == NULL) {
+		Close();
+		return false;
+	}
+	m_hMapping = hMapping;
+	m_pData = (const uint8_t*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	void* p = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // the mapping keeps the file
+	m_pData = p == MAP_FAILED ? NULL : (const uint8_t*)p;
+#endif
+	if (m_pData == NULL) {
+		Close();
+		return false;
+	}
+	m_size = size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (m_pData != NULL) UnmapViewOfFile(m_pData);
+	if (m_hMapping != NULL) CloseHandle((HANDLE)m_hMapping);
+	if (m_hFile != NULL) CloseHandle((HANDLE)m_hFile);
+	m_hMapping = NULL;
+	m_hFile = NULL;
+#else
+	if (m_pData != NULL) munmap((void*)m_pData, (size_t)m_size);
+#endif
+	m_pData = NULL;
+	m_size = 0;
+}
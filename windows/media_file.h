@@ -0,0 +1,101 @@
+#pragma once
+
+// Small portable random-access file reader used by the container parsers.
+// It has no Media Foundation dependency, so it can be built and tested on Linux.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+// Identifies a file version: a cached result for (path, size, mtime) is still valid.
+struct MediaFileIdentity
+{
+	std::filesystem::path path;
+	uint64_t size = 0;
+	int64_t mtime = 0;
+
+	bool operator==(const MediaFileIdentity& other) const {
+		return size == other.size && mtime == other.mtime && path == other.path;
+	}
+
+	// Returns false if the file does not exist or is not a regular file
+	static bool Query(const std::filesystem::path& path, MediaFileIdentity* pIdentity);
+};
+
+class MediaFile
+{
+public:
+	MediaFile() {}
+	~MediaFile() { Close(); }
+	MediaFile(const MediaFile&) = delete;
+	MediaFile& operator=(const MediaFile&) = delete;
+
+	bool Open(const std::filesystem::path& path);
+	void Close();
+	bool IsOpen() const { return m_fp != NULL; }
+	uint64_t Size() const { return m_size; }
+
+	// Reads exactly 'len' bytes at 'offset'. Returns false on short read.
+	// Small reads are served from an internal buffer, so walking box / element
+	// headers costs one syscall per buffer window, not one per header.
+	bool ReadAt(uint64_t offset, void* buf, size_t len);
+
+	// Counts the bytes really read from the disk, for profiling the parsers.
+	uint64_t BytesRead() const { return m_bytesRead; }
+
+private:
+	static const size_t BUFFER_SIZE = 16 * 1024;
+
+	FILE* m_fp = NULL;
+	uint64_t m_size = 0;
+	uint64_t m_bytesRead = 0;
+	uint8_t m_buffer[BUFFER_SIZE];
+	uint64_t m_bufferOffset = 0;
+	size_t m_bufferLen = 0;
+
+	bool ReadRaw(uint64_t offset, void* buf, size_t len, size_t* pRead);
+};
+
+// Same read interface as MediaFile, over bytes already in memory
+// (ex. a mapped file, or a fuzzer input).
+class MediaMemoryView
+{
+public:
+	MediaMemoryView(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+	uint64_t Size() const { return m_size; }
+	bool ReadAt(uint64_t offset, void* buf, size_t len) {
+		if (offset > m_size || len > m_size - offset) return false;
+		if (len > 0) memcpy(buf, m_data + offset, len);
+		return true;
+	}
+
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+};
+
+// Read-only memory mapping of a whole file (ex. a cache file used in place).
+class MappedFile
+{
+public:
+	MappedFile() {}
+	~MappedFile() { Close(); }
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::filesystem::path& path);
+	void Close();
+	const uint8_t* Data() const { return m_pData; }
+	uint64_t Size() const { return m_size; }
+
+private:
+	const uint8_t* m_pData = NULL;
+	uint64_t m_size = 0;
+#ifdef _WIN32
+	void* m_hFile = NULL;
+	void* m_hMapping = NULL;
+#endif
+};
@@ -0,0 +1,257 @@
+#include "media_metadata_cache.h"
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// On-disk layout. Only fixed-size fields, so the file can be used in place once mapped.
+
+struct MediaMetadataCache::Header
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t capacity;
+	uint32_t recordSize;
+	uint64_t writeCounter; // increases on each Store(), used to pick the oldest record to evict
+};
+
+struct MediaMetadataCache::Record
+{
+	uint64_t key;   // hash of the path, 0 for an empty slot
+	uint64_t check; // second hash of the path, tells apart the paths with the same key
+	uint64_t size;
+	int64_t mtime;
+	uint64_t writeIndex;
+	MediaMetadata metadata;
+};
+
+static const uint32_t INDEX_MAGIC = 0x4D445056; // 'VPDM'
+static const uint32_t INDEX_VERSION = 2;
+static const uint32_t MAX_PROBE = 16;
+
+MediaMetadataCache& MediaMetadataCache::Instance()
+{
+	static MediaMetadataCache instance;
+	return instance;
+}
+
+uint64_t MediaMetadataCache::HashPath(const std::filesystem::path& path)
+{
+	// FNV-1a over the native path characters
+	const auto& native = path.native();
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (auto c : native) {
+		h ^= (uint64_t)c;
+		h *= 0x100000001b3ULL;
+	}
+	return h == 0 ? 1 : h;
+}
+
+uint64_t MediaMetadataCache::CheckPath(const std::filesystem::path& path)
+{
+	// independent of HashPath: another seed, multiply-xorshift rounds and the length
+	const auto& native = path.native();
+	uint64_t h = 0x9e3779b97f4a7c15ULL ^ (uint64_t)native.size();
+	for (auto c : native) {
+		h = (h ^ (uint64_t)c) * 0xbf58476d1ce4e5b9ULL;
+		h ^= h >> 31;
+	}
+	h ^= h >> 33;
+	h *= 0x94d049bb133111ebULL;
+	h ^= h >> 29;
+	return h;
+}
+
+// Lock of the index between the processes. The accesses of one process are
+// serialized by m_mutex, taken first. On Windows, the locked byte is past the
+// mapping, where nothing is ever read or written.
+bool MediaMetadataCache::LockFile(bool isExclusive)
+{
+#ifdef _WIN32
+	OVERLAPPED overlapped = {};
+	overlapped.Offset = (DWORD)m_viewSize;
+	return LockFileEx((HANDLE)m_hFile, isExclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, 1, 0, &overlapped) != FALSE;
+#else
+	int result;
+	do {
+		result = flock(m_fd, isExclusive ? LOCK_EX : LOCK_SH);
+	} while (result != 0 && errno == EINTR);
+	return result == 0;
+#endif
+}
+
+void MediaMetadataCache::UnlockFile()
+{
+#ifdef _WIN32
+	OVERLAPPED overlapped = {};
+	overlapped.Offset = (DWORD)m_viewSize;
+	UnlockFileEx((HANDLE)m_hFile, 0, 1, 0, &overlapped);
+#else
+	flock(m_fd, LOCK_UN);
+#endif
+}
+
+bool MediaMetadataCache::Open(const std::filesystem::path& indexPath)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return OpenLocked(indexPath);
+}
+
+bool MediaMetadataCache::OpenLocked(const std::filesystem::path& indexPath)
+{
+	Close();
+	m_triedOpen = true;
+
+	std::error_code ec;
+	std::filesystem::create_directories(indexPath.parent_path(), ec);
+
+	m_viewSize = sizeof(Header) + (size_t)CAPACITY * sizeof(Record);
+
+#ifdef _WIN32
+	HANDLE hFile = CreateFileW(indexPath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+		NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) return false;
+	m_hFile = hFile;
+
+	HANDLE hMapping = CreateFileMappingW(hFile, NULL, PAGE_READWRITE, 0, (DWORD)m_viewSize, NULL);
+	if (hMapping == NULL) {
+		Close();
+		return false;
+	}
+	m_hMapping = hMapping;
+
+	m_pView = (uint8_t*)MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, m_viewSize);
+#else
+	m_fd = open(indexPath.c_str(), O_RDWR | O_CREAT, 0644);
+	if (m_fd < 0) return false;
+	if (ftruncate(m_fd, (off_t)m_viewSize) != 0) {
+		Close();
+		return false;
+	}
+	void* p = mmap(NULL, m_viewSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+	m_pView = p == MAP_FAILED ? NULL : (uint8_t*)p;
+#endif
+	if (m_pView == NULL) {
+		Close();
+		return false;
+	}
+
+	// new file (zero-filled by the OS), or a file from another version: reset it
+	if (!LockFile(true)) {
+		Close();
+		return false;
+	}
+	Header* pHeader = (Header*)m_pView;
+	if (pHeader->magic != INDEX_MAGIC || pHeader->version != INDEX_VERSION ||
+		pHeader->capacity != CAPACITY || pHeader->recordSize != sizeof(Record)) {
+		memset(m_pView, 0, m_viewSize);
+		pHeader->magic = INDEX_MAGIC;
+		pHeader->version = INDEX_VERSION;
+		pHeader->capacity = CAPACITY;
+		pHeader->recordSize = sizeof(Record);
+	}
+	UnlockFile();
+	return true;
+}
+
+void MediaMetadataCache::Close()
+{
+#ifdef _WIN32
+	if (m_pView != NULL) UnmapViewOfFile(m_pView);
+	if (m_hMapping != NULL) CloseHandle((HANDLE)m_hMapping);
+	if (m_hFile != NULL) CloseHandle((HANDLE)m_hFile);
+	m_hMapping = NULL;
+	m_hFile = NULL;
+#else
+	if (m_pView != NULL) munmap(m_pView, m_viewSize);
+	if (m_fd >= 0) close(m_fd);
+	m_fd = -1;
+#endif
+	m_pView = NULL;
+}
+
+bool MediaMetadataCache::EnsureOpen()
+{
+	if (m_pView != NULL) return true;
+	if (m_triedOpen) return false;
+
+	std::error_code ec;
+	std::filesystem::path dir = std::filesystem::temp_directory_path(ec);
+	if (ec) {
+		m_triedOpen = true;
+		return false;
+	}
+
+	return OpenLocked(dir / "video_player_win" / "metadata_v2.idx");
+}
+
+MediaMetadataCache::Record* MediaMetadataCache::Find(uint64_t key, uint64_t check, const MediaFileIdentity& identity, bool forInsert)
+{
+	Record* records = (Record*)(m_pView + sizeof(Header));
+	Record* pVictim = NULL;
+
+	for (uint32_t i = 0; i < MAX_PROBE; i++) {
+		Record* r = &records[(key + i) % CAPACITY];
+		if (r->key == key && r->check == check) {
+			// same path: a stale record (file modified) is reused in place
+			if (forInsert || (r->size == identity.size && r->mtime == identity.mtime)) return r;
+			return NULL;
+		}
+		if (r->key == 0) return forInsert ? r : NULL;
+		if (pVictim == NULL || r->writeIndex < pVictim->writeIndex) pVictim = r;
+	}
+	return forInsert ? pVictim : NULL;
+}
+
+bool MediaMetadataCache::Lookup(const std::filesystem::path& path, MediaMetadata* pMetadata)
+{
+	MediaFileIdentity identity;
+	if (!MediaFileIdentity::Query(path, &identity)) return false;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!EnsureOpen()) return false;
+
+	if (!LockFile(false)) return false;
+	Record* r = Find(HashPath(path), CheckPath(path), identity, false);
+	if (r != NULL) *pMetadata = r->metadata;
+	UnlockFile();
+	return r != NULL;
+}
+
+bool MediaMetadataCache::Contains(const std::filesystem::path& path)
+{
+	MediaMetadata metadata;
+	return Lookup(path, &metadata);
+}
+
+void MediaMetadataCache::Store(const std::filesystem::path& path, const MediaMetadata& metadata)
+{
+	MediaFileIdentity identity;
+	if (!MediaFileIdentity::Query(path, &identity)) return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!EnsureOpen()) return;
+
+	if (!LockFile(true)) return;
+	uint64_t key = HashPath(path);
+	uint64_t check = CheckPath(path);
+	Record* r = Find(key, check, identity, true);
+	Header* pHeader = (Header*)m_pView;
+
+	r->key = key;
+	r->check = check;
+	r->size = identity.size;
+	r->mtime = identity.mtime;
+	r->writeIndex = ++pHeader->writeCounter;
+	r->metadata = metadata;
+	UnlockFile();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// Persisted media metadata index, keyed by (path, size, mtime).
+//
+// The index is a fixed-size open-addressing hash table in a memory-mapped file,
+// so a lookup costs a few memory reads and nothing is parsed or loaded at startup.
+// A record is matched by two independent 64-bit hashes of the path. The file is
+// shared by every process of the plugin: the accesses take a lock on the file.
+// It lets openVideo() return duration / video size before Media Foundation
+// finishes resolving the source and building the topology.
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+
+#include "media_file.h"
+
+struct MediaMetadata
+{
+	int64_t durationMs = -1;
+	uint32_t videoWidth = 0;
+	uint32_t videoHeight = 0;
+	uint32_t frameRateNumerator = 0;
+	uint32_t frameRateDenominator = 0;
+	uint32_t videoCodec = 0;   // FOURCC, ex. 'H264', 'HEVC', 'AV01', 0 if unknown
+	uint32_t audioCodec = 0;   // FOURCC or WAVE_FORMAT tag, 0 if unknown
+	uint16_t videoStreams = 0;
+	uint16_t audioStreams = 0;
+};
+
+class MediaMetadataCache
+{
+public:
+	static MediaMetadataCache& Instance();
+
+	// Returns false if 'path' is not cached, or the file was modified since it was cached
+	bool Lookup(const std::filesystem::path& path, MediaMetadata* pMetadata);
+	void Store(const std::filesystem::path& path, const MediaMetadata& metadata);
+	bool Contains(const std::filesystem::path& path);
+
+	// Default location: <temp>/video_player_win/metadata_v2.idx
+	bool Open(const std::filesystem::path& indexPath);
+	void Close();
+
+	static const uint32_t CAPACITY = 4096; // records, the oldest colliding record is overwritten when full
+
+private:
+	MediaMetadataCache() {}
+	~MediaMetadataCache() { Close(); }
+
+	struct Header;
+	struct Record;
+
+	bool EnsureOpen();
+	bool OpenLocked(const std::filesystem::path& indexPath);
+	bool LockFile(bool isExclusive);
+	void UnlockFile();
+	Record* Find(uint64_t key, uint64_t check, const MediaFileIdentity& identity, bool forInsert);
+	static uint64_t HashPath(const std::filesystem::path& path);
+	static uint64_t CheckPath(const std::filesystem::path& path);
+
+	std::mutex m_mutex;
+	bool m_triedOpen = false;
+	uint8_t* m_pView = NULL;
+	size_t m_viewSize = 0;
+#ifdef _WIN32
+	void* m_hFile = NULL;
+	void* m_hMapping = NULL;
+#else
+	int m_fd = -1;
+#endif
+};
@@ -0,0 +1,443 @@
+// ref: ISO/IEC 14496-12 (ISO base media file format)
+// ref: https://www.matroska.org/technical/elements.html
+
+#include "media_probe.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "iso_bmff.h"
+
+using namespace iso_bmff;
+
+// Media Foundation audio subtype Data1 values (WAVE_FORMAT tags, or GUID based formats)
+static const uint32_t AUDIO_AAC = 0x1610;   // MFAudioFormat_AAC
+static const uint32_t AUDIO_MP3 = 0x0055;   // MFAudioFormat_MP3
+static const uint32_t AUDIO_FLAC = 0xF1AC;  // MFAudioFormat_FLAC
+static const uint32_t AUDIO_OPUS = 0x704F;  // MFAudioFormat_Opus
+static const uint32_t AUDIO_AC3 = 0xE06D802C;  // MFAudioFormat_Dolby_AC3
+static const uint32_t AUDIO_EAC3 = 0xA7FB87AF; // MFAudioFormat_Dolby_DDPlus
+
+static void SetFrameRate(MediaMetadata* m, double fps)
+{
+	if (!(fps > 0 && fps < 1000)) return;
+	m->frameRateNumerator = (uint32_t)std::lround(fps * 1000);
+	m->frameRateDenominator = 1000;
+}
+
+// --------------------------------------------------------------------------
+// ISO-BMFF
+
+static uint32_t IsoVideoCodec(uint32_t entryType)
+{
+	switch (entryType) {
+	case BoxType("avc1"): case BoxType("avc3"): return MakeFourcc("H264");
+	case BoxType("hvc1"): case BoxType("hev1"): return MakeFourcc("HEVC");
+	case BoxType("av01"): return MakeFourcc("AV01");
+	case BoxType("vp09"): return MakeFourcc("VP90");
+	case BoxType("vp08"): return MakeFourcc("VP80");
+	case BoxType("mp4v"): return MakeFourcc("MP4V");
+	case BoxType("jpeg"): case BoxType("mjpa"): return MakeFourcc("MJPG");
+	default: return 0;
+	}
+}
+
+static uint32_t IsoAudioCodec(uint32_t entryType)
+{
+	switch (entryType) {
+	case BoxType("mp4a"): return AUDIO_AAC;
+	case BoxType(".mp3"): return AUDIO_MP3;
+	case BoxType("fLaC"): return AUDIO_FLAC;
+	case BoxType("Opus"): return AUDIO_OPUS;
+	case BoxType("ac-3"): return AUDIO_AC3;
+	case BoxType("ec-3"): return AUDIO_EAC3;
+	default: return 0;
+	}
+}
+
+template <class Source>
+static void ProbeIsoTrack(Source& src, const Box& trak, MediaMetadata* m)
+{
+	Box mdia, hdlr, mdhd, minf, stbl, stsd, stsz, stts;
+	uint8_t buf[40];
+
+	if (!FindBox(src, trak.begin, trak.end, BoxType("mdia"), &mdia)) return;
+	if (!FindBox(src, mdia.begin, mdia.end, BoxType("hdlr"), &hdlr) || hdlr.PayloadSize() < 12) return;
+	if (!src.ReadAt(hdlr.begin, buf, 12)) return;
+	uint32_t handler = ReadBE32(buf + 8);
+	bool isVideo = handler == BoxType("vide");
+	bool isAudio = handler == BoxType("soun");
+	if (!isVideo && !isAudio) return;
+
+	if (isAudio && m->audioStreams++ > 0) return;
+	if (isVideo && m->videoStreams++ > 0) return;
+
+	if (!FindBox(src, mdia.begin, mdia.end, BoxType("minf"), &minf)) return;
+	if (!FindBox(src, minf.begin, minf.end, BoxType("stbl"), &stbl)) return;
+
+	// first sample entry: 8 bytes stsd header, then the entry box
+	Box entry;
+	if (!FindBox(src, stbl.begin, stbl.end, BoxType("stsd"), &stsd) || stsd.PayloadSize() < 8) return;
+	if (!ReadBox(src, stsd.begin + 8, stsd.end, &entry)) return;
+
+	if (isAudio) {
+		m->audioCodec = IsoAudioCodec(entry.type);
+		return;
+	}
+
+	m->videoCodec = IsoVideoCodec(entry.type);
+	// VisualSampleEntry: reserved(6) data_reference_index(2) pre_defined(2) reserved(2) pre_defined(12) width(2) height(2)
+	if (entry.PayloadSize() >= 28 && src.ReadAt(entry.begin, buf, 28)) {
+		m->videoWidth = ReadBE16(buf + 24);
+		m->videoHeight = ReadBE16(buf + 26);
+	}
+
+	// frame rate: exact from a single stts entry, else averaged from the sample count
+	uint32_t timescale = 0;
+	uint64_t duration = 0;
+	if (FindBox(src, mdia.begin, mdia.end, BoxType("mdhd"), &mdhd) && mdhd.PayloadSize() >= 20 && src.ReadAt(mdhd.begin, buf, 20)) {
+		if (buf[0] == 0) {
+			timescale = ReadBE32(buf + 12);
+			duration = ReadBE32(buf + 16);
+		} else if (mdhd.PayloadSize() >= 32 && src.ReadAt(mdhd.begin, buf, 32)) {
+			timescale = ReadBE32(buf + 20);
+			duration = ReadBE64(buf + 24);
+		}
+	}
+	if (timescale == 0) return;
+
+	if (FindBox(src, stbl.begin, stbl.end, BoxType("stts"), &stts) && stts.PayloadSize() >= 16 && src.ReadAt(stts.begin, buf, 16)) {
+		uint32_t delta = ReadBE32(buf + 12);
+		if (ReadBE32(buf + 4) == 1 && delta > 0) {
+			m->frameRateNumerator = timescale;
+			m->frameRateDenominator = delta;
+			return;
+		}
+	}
+	if (duration > 0 && FindBox(src, stbl.begin, stbl.end, BoxType("stsz"), &stsz) && stsz.PayloadSize() >= 12 && src.ReadAt(stsz.begin, buf, 12)) {
+		uint32_t sampleCount = ReadBE32(buf + 8);
+		SetFrameRate(m, (double)sampleCount * timescale / (double)duration);
+	}
+}
+
+template <class Source>
+static bool ProbeIsoBmff(Source& src, MediaMetadata* m)
+{
+	Box first, moov, mvhd, box;
+	uint8_t buf[32];
+
+	if (!ReadBox(src, 0, src.Size(), &first)) return false;
+	switch (first.type) {
+	case BoxType("ftyp"): case BoxType("moov"): case BoxType("mdat"):
+	case BoxType("free"): case BoxType("skip"): case BoxType("wide"): case BoxType("pnot"):
+		break;
+	default:
+		return false;
+	}
+
+	// moov may be at the end of the file: only the top-level box headers are read to get there
+	if (!FindBox(src, 0, src.Size(), BoxType("moov"), &moov)) return false;
+
+	if (FindBox(src, moov.begin, moov.end, BoxType("mvhd"), &mvhd) && mvhd.PayloadSize() >= 20 && src.ReadAt(mvhd.begin, buf, 20)) {
+		uint32_t timescale = 0;
+		uint64_t duration = 0;
+		if (buf[0] == 1) {
+			if (mvhd.PayloadSize() >= 32 && src.ReadAt(mvhd.begin, buf, 32)) {
+				timescale = ReadBE32(buf + 20);
+				duration = ReadBE64(buf + 24);
+			}
+		} else {
+			timescale = ReadBE32(buf + 12);
+			duration = ReadBE32(buf + 16);
+		}
+
+		// fragmented MP4: the movie header has no duration, use the movie extends header
+		Box mvex, mehd;
+		if (duration == 0 && FindBox(src, moov.begin, moov.end, BoxType("mvex"), &mvex) &&
+			FindBox(src, mvex.begin, mvex.end, BoxType("mehd"), &mehd) && mehd.PayloadSize() >= 8 && src.ReadAt(mehd.begin, buf, 8)) {
+			if (buf[0] == 0) duration = ReadBE32(buf + 4);
+			else if (mehd.PayloadSize() >= 12 && src.ReadAt(mehd.begin, buf, 12)) duration = ReadBE64(buf + 4);
+		}
+		if (timescale > 0 && duration != UINT32_MAX && duration != UINT64_MAX) {
+			m->durationMs = (int64_t)(duration / timescale * 1000 + duration % timescale * 1000 / timescale);
+		}
+	}
+
+	uint64_t pos = moov.begin;
+	while (ReadBox(src, pos, moov.end, &box)) {
+		if (box.type == BoxType("trak")) ProbeIsoTrack(src, box, m);
+		pos = box.end;
+	}
+	return true;
+}
+
+// --------------------------------------------------------------------------
+// Matroska / WebM
+
+static const uint32_t EBML_HEADER = 0x1A45DFA3;
+static const uint32_t MKV_SEGMENT = 0x18538067;
+static const uint32_t MKV_SEEKHEAD = 0x114D9B74;
+static const uint32_t MKV_SEEK = 0x4DBB;
+static const uint32_t MKV_SEEKID = 0x53AB;
+static const uint32_t MKV_SEEKPOSITION = 0x53AC;
+static const uint32_t MKV_INFO = 0x1549A966;
+static const uint32_t MKV_TIMECODESCALE = 0x2AD7B1;
+static const uint32_t MKV_DURATION = 0x4489;
+static const uint32_t MKV_TRACKS = 0x1654AE6B;
+static const uint32_t MKV_TRACKENTRY = 0xAE;
+static const uint32_t MKV_TRACKTYPE = 0x83;
+static const uint32_t MKV_CODECID = 0x86;
+static const uint32_t MKV_DEFAULTDURATION = 0x23E383;
+static const uint32_t MKV_VIDEO = 0xE0;
+static const uint32_t MKV_PIXELWIDTH = 0xB0;
+static const uint32_t MKV_PIXELHEIGHT = 0xBA;
+static const uint32_t MKV_CLUSTER = 0x1F43B675;
+
+static const int MAX_ELEMENTS_PER_LEVEL = 4096;
+
+struct EbmlElement
+{
+	uint32_t id = 0;
+	uint64_t begin = 0; // offset of the payload
+	uint64_t end = 0;
+	bool unknownSize = false;
+};
+
+// Reads a variable length integer. IDs keep their length marker bits, sizes don't.
+template <class Source>
+static bool ReadVint(Source& src, uint64_t pos, uint64_t end, bool keepMarker, uint64_t* pValue, int* pLength, bool* pAllOnes)
+{
+	uint8_t buf[8];
+	if (pos >= end || !src.ReadAt(pos, buf, 1)) return false;
+
+	int len = 1;
+	while (len <= 8 && !(buf[0] & (0x80 >> (len - 1)))) len++;
+	if (len > 8 || (uint64_t)len > end - pos) return false;
+	if (len > 1 && !src.ReadAt(pos + 1, buf + 1, len - 1)) return false;
+
+	uint64_t value = keepMarker ? buf[0] : (buf[0] & (0xFF >> len));
+	bool allOnes = (buf[0] & (0xFF >> len)) == (0xFF >> len);
+	for (int i = 1; i < len; i++) {
+		value = (value << 8) | buf[i];
+		allOnes = allOnes && buf[i] == 0xFF;
+	}
+	*pValue = value;
+	*pLength = len;
+	if (pAllOnes) *pAllOnes = allOnes;
+	return true;
+}
+
+template <class Source>
+static bool ReadElement(Source& src, uint64_t pos, uint64_t parentEnd, EbmlElement* pElement)
+{
+	uint64_t id, size;
+	int idLen, sizeLen;
+	bool unknownSize;
+
+	if (!ReadVint(src, pos, parentEnd, true, &id, &idLen, NULL) || idLen > 4) return false;
+	if (!ReadVint(src, pos + idLen, parentEnd, false, &size, &sizeLen, &unknownSize)) return false;
+
+	pElement->id = (uint32_t)id;
+	pElement->begin = pos + idLen + sizeLen;
+	pElement->unknownSize = unknownSize;
+	if (unknownSize) {
+		pElement->end = parentEnd;
+	} else {
+		if (size > parentEnd - pElement->begin) return false;
+		pElement->end = pElement->begin + size;
+	}
+	return true;
+}
+
+template <class Source>
+static uint64_t ReadUInt(Source& src, const EbmlElement& e, uint64_t defaultValue = 0)
+{
+	uint8_t buf[8];
+	uint64_t size = e.end - e.begin;
+	if (size == 0 || size > 8 || !src.ReadAt(e.begin, buf, (size_t)size)) return defaultValue;
+	uint64_t value = 0;
+	for (uint64_t i = 0; i < size; i++) value = (value << 8) | buf[i];
+	return value;
+}
+
+template <class Source>
+static double ReadFloat(Source& src, const EbmlElement& e)
+{
+	uint8_t buf[8];
+	uint64_t size = e.end - e.begin;
+	if (size == 4 && src.ReadAt(e.begin, buf, 4)) {
+		uint32_t bits = ReadBE32(buf);
+		float f;
+		memcpy(&f, &bits, 4);
+		return f;
+	}
+	if (size == 8 && src.ReadAt(e.begin, buf, 8)) {
+		uint64_t bits = ReadBE64(buf);
+		double d;
+		memcpy(&d, &bits, 8);
+		return d;
+	}
+	return 0;
+}
+
+static bool StartsWith(const char* s, const char* prefix)
+{
+	return strncmp(s, prefix, strlen(prefix)) == 0;
+}
+
+static uint32_t MatroskaCodec(const char* codecId, bool isVideo)
+{
+	if (isVideo) {
+		if (StartsWith(codecId, "V_MPEG4/ISO/AVC")) return MakeFourcc("H264");
+		if (StartsWith(codecId, "V_MPEGH/ISO/HEVC")) return MakeFourcc("HEVC");
+		if (StartsWith(codecId, "V_AV1")) return MakeFourcc("AV01");
+		if (StartsWith(codecId, "V_VP9")) return MakeFourcc("VP90");
+		if (StartsWith(codecId, "V_VP8")) return MakeFourcc("VP80");
+		if (StartsWith(codecId, "V_MPEG4/ISO/")) return MakeFourcc("MP4V");
+		if (StartsWith(codecId, "V_MJPEG")) return MakeFourcc("MJPG");
+		return 0;
+	}
+	if (StartsWith(codecId, "A_AAC")) return AUDIO_AAC;
+	if (StartsWith(codecId, "A_MPEG/L3")) return AUDIO_MP3;
+	if (StartsWith(codecId, "A_FLAC")) return AUDIO_FLAC;
+	if (StartsWith(codecId, "A_OPUS")) return AUDIO_OPUS;
+	if (StartsWith(codecId, "A_EAC3")) return AUDIO_EAC3;
+	if (StartsWith(codecId, "A_AC3")) return AUDIO_AC3;
+	return 0;
+}
+
+template <class Source>
+static void ProbeMatroskaInfo(Source& src, const EbmlElement& info, MediaMetadata* m)
+{
+	EbmlElement e;
+	uint64_t timecodeScale = 1000000; // default: 1 ms
+	double duration = 0;
+	uint64_t pos = info.begin;
+	for (int i = 0; i < MAX_ELEMENTS_PER_LEVEL && ReadElement(src, pos, info.end, &e); i++, pos = e.end) {
+		if (e.id == MKV_TIMECODESCALE) timecodeScale = ReadUInt(src, e, 1000000);
+		else if (e.id == MKV_DURATION) duration = ReadFloat(src, e);
+	}
+	if (duration > 0 && duration < 1e18) {
+		m->durationMs = (int64_t)(duration * (double)timecodeScale / 1000000.0);
+	}
+}
+
+template <class Source>
+static void ProbeMatroskaTracks(Source& src, const EbmlElement& tracks, MediaMetadata* m)
+{
+	EbmlElement entry, e, v;
+	uint64_t pos = tracks.begin;
+	for (int i = 0; i < MAX_ELEMENTS_PER_LEVEL && ReadElement(src, pos, tracks.end, &entry); i++, pos = entry.end) {
+		if (entry.id != MKV_TRACKENTRY) continue;
+
+		uint64_t trackType = 0, defaultDuration = 0, width = 0, height = 0;
+		char codecId[33] = { 0 };
+		uint64_t p = entry.begin;
+		for (int j = 0; j < MAX_ELEMENTS_PER_LEVEL && ReadElement(src, p, entry.end, &e); j++, p = e.end) {
+			if (e.id == MKV_TRACKTYPE) {
+				trackType = ReadUInt(src, e);
+			} else if (e.id == MKV_CODECID) {
+				size_t len = (size_t)(e.end - e.begin) < sizeof(codecId) - 1 ? (size_t)(e.end - e.begin) : sizeof(codecId) - 1;
+				if (!src.ReadAt(e.begin, codecId, len)) codecId[0] = 0;
+			} else if (e.id == MKV_DEFAULTDURATION) {
+				defaultDuration = ReadUInt(src, e);
+			} else if (e.id == MKV_VIDEO) {
+				uint64_t q = e.begin;
+				for (int k = 0; k < MAX_ELEMENTS_PER_LEVEL && ReadElement(src, q, e.end, &v); k++, q = v.end) {
+					if (v.id == MKV_PIXELWIDTH) width = ReadUInt(src, v);
+					else if (v.id == MKV_PIXELHEIGHT) height = ReadUInt(src, v);
+				}
+			}
+		}
+
+		if (trackType == 1 && m->videoStreams++ == 0) {
+			m->videoCodec = MatroskaCodec(codecId, true);
+			m->videoWidth = (uint32_t)width;
+			m->videoHeight = (uint32_t)height;
+			if (defaultDuration > 0) SetFrameRate(m, 1e9 / (double)defaultDuration);
+		} else if (trackType == 2 && m->audioStreams++ == 0) {
+			m->audioCodec = MatroskaCodec(codecId, false);
+		}
+	}
+}
+
+template <class Source>
+static bool ProbeMatroska(Source& src, MediaMetadata* m)
+{
+	EbmlElement header, segment, e;
+	if (!ReadElement(src, 0, src.Size(), &header) || header.id != EBML_HEADER) return false;
+	if (!ReadElement(src, header.end, src.Size(), &segment) || segment.id != MKV_SEGMENT) return false;
+
+	bool hasInfo = false, hasTracks = false;
+	uint64_t infoPos = 0, tracksPos = 0; // from the seek head, relative to the segment payload
+
+	uint64_t pos = segment.begin;
+	for (int i = 0; i < MAX_ELEMENTS_PER_LEVEL && ReadElement(src, pos, segment.end, &e); i++, pos = e.end) {
+		if (e.id == MKV_INFO) {
+			ProbeMatroskaInfo(src, e, m);
+			hasInfo = true;
+		} else if (e.id == MKV_TRACKS) {
+			ProbeMatroskaTracks(src, e, m);
+			hasTracks = true;
+		} else if (e.id == MKV_SEEKHEAD) {
+			EbmlElement seek, s;
+			uint64_t p = e.begin;
+			for (int j = 0; j < MAX_ELEMENTS_PER_LEVEL && ReadElement(src, p, e.end, &seek); j++, p = seek.end) {
+				if (seek.id != MKV_SEEK) continue;
+				uint64_t seekId = 0, seekPos = 0;
+				uint64_t q = seek.begin;
+				for (int k = 0; k < 8 && ReadElement(src, q, seek.end, &s); k++, q = s.end) {
+					if (s.id == MKV_SEEKID) seekId = ReadUInt(src, s);
+					else if (s.id == MKV_SEEKPOSITION) seekPos = ReadUInt(src, s);
+				}
+				if (seekId == MKV_INFO) infoPos = seekPos;
+				else if (seekId == MKV_TRACKS) tracksPos = seekPos;
+			}
+		} else if (e.id == MKV_CLUSTER || e.unknownSize) {
+			break; // media data starts, headers are normally before it
+		}
+		if (hasInfo && hasTracks) return true;
+	}
+
+	// headers placed after the clusters: follow the seek head
+	if (!hasInfo && infoPos > 0 && infoPos < segment.end - segment.begin &&
+		ReadElement(src, segment.begin + infoPos, segment.end, &e) && e.id == MKV_INFO) {
+		ProbeMatroskaInfo(src, e, m);
+	}
+	if (!hasTracks && tracksPos > 0 && tracksPos < segment.end - segment.begin &&
+		ReadElement(src, segment.begin + tracksPos, segment.end, &e) && e.id == MKV_TRACKS) {
+		ProbeMatroskaTracks(src, e, m);
+	}
+	return true;
+}
+
+// --------------------------------------------------------------------------
+
+template <class Source>
+static MediaContainer Probe(Source& src, MediaMetadata* pMetadata)
+{
+	*pMetadata = MediaMetadata();
+	if (ProbeMatroska(src, pMetadata)) return CONTAINER_MATROSKA;
+
+	*pMetadata = MediaMetadata();
+	if (ProbeIsoBmff(src, pMetadata)) return CONTAINER_ISO_BMFF;
+
+	*pMetadata = MediaMetadata();
+	return CONTAINER_UNKNOWN;
+}
+
+MediaContainer ProbeMediaFile(const std::filesystem::path& path, MediaMetadata* pMetadata)
+{
+	MediaFile file;
+	if (!file.Open(path)) {
+		*pMetadata = MediaMetadata();
+		return CONTAINER_UNKNOWN;
+	}
+	return Probe(file, pMetadata);
+}
+
+MediaContainer ProbeMediaBuffer(const uint8_t* data, size_t size, MediaMetadata* pMetadata)
+{
+	MediaMemoryView view(data, size);
+	return Probe(view, pMetadata);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// Lightweight container probe: reads duration, video size, frame rate and codecs
+// from the ISO-BMFF moov box (MP4 / MOV / M4V) or the Matroska EBML headers (MKV / WebM),
+// without creating any Media Foundation object.
+//
+// Only the header bytes are read (the media data is skipped by box / element sizes),
+// through the buffered MediaFile reader. Everything is bounds-checked, so
+// ProbeMediaBuffer() can be fed arbitrary bytes (ex. from a fuzzer).
+
+#include <cstdint>
+#include <filesystem>
+
+#include "media_file.h"
+#include "media_metadata_cache.h"
+
+enum MediaContainer
+{
+	CONTAINER_UNKNOWN = 0,
+	CONTAINER_ISO_BMFF,
+	CONTAINER_MATROSKA,
+};
+
+// codec values use the Data1 of the Media Foundation subtype GUIDs, so probed and
+// MF-read metadata are interchangeable (ex. MFVideoFormat_H264 -> 'H264')
+constexpr uint32_t MakeFourcc(const char (&s)[5])
+{
+	return (uint32_t)(uint8_t)s[0] | ((uint32_t)(uint8_t)s[1] << 8) |
+		((uint32_t)(uint8_t)s[2] << 16) | ((uint32_t)(uint8_t)s[3] << 24);
+}
+
+MediaContainer ProbeMediaFile(const std::filesystem::path& path, MediaMetadata* pMetadata);
+MediaContainer ProbeMediaBuffer(const uint8_t* data, size_t size, MediaMetadata* pMetadata);
@@ -0,0 +1,115 @@
+#include "memory_byte_stream.h"
+
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+
+#include "local_file.h"
+
+static const char ASSET_SCHEME[] = "asset://";
+static const char MEMORY_SCHEME[] = "memory://";
+
+// A buffer of AllocateBytes()
+struct Bytes
+{
+    std::shared_ptr<uint8_t> pData;
+    size_t size;
+};
+
+static std::mutex s_bytesMutex;
+static std::map<std::string, Bytes> s_bytes; // by url
+static std::atomic<uint64_t> s_nextBytesId{ 1 };
+
+static bool StartsWith(const std::string& s, const char* prefix)
+{
+    return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+bool MemoryByteStream::IsMemoryUrl(const std::string& url)
+{
+    return StartsWith(url, ASSET_SCHEME) || StartsWith(url, MEMORY_SCHEME);
+}
+
+std::filesystem::path MemoryByteStream::AssetFilePath(const std::string& url)
+{
+    if (!StartsWith(url, ASSET_SCHEME)) return std::filesystem::path();
+    WCHAR exePath[MAX_PATH * 4];
+    DWORD length = GetModuleFileNameW(NULL, exePath, (DWORD)(sizeof(exePath) / sizeof(exePath[0])));
+    if (length == 0 || length >= sizeof(exePath) / sizeof(exePath[0])) return std::filesystem::path();
+    std::filesystem::path key = std::filesystem::u8path(url.substr(strlen(ASSET_SCHEME)));
+    return std::filesystem::path(exePath).parent_path() / L"data" / L"flutter_assets" / key.make_preferred();
+}
+
+std::string MemoryByteStream::AllocateBytes(size_t size, const std::string& extension, uint8_t** ppData)
+{
+    *ppData = NULL;
+    Bytes bytes;
+    bytes.pData.reset(new (std::nothrow) uint8_t[size > 0 ? size : 1], std::default_delete<uint8_t[]>());
+    bytes.size = size;
+    if (!bytes.pData) return std::string();
+
+    std::string url = MEMORY_SCHEME + std::to_string(s_nextBytesId++);
+    if (!extension.empty()) url += "." + extension;
+    *ppData = bytes.pData.get();
+    std::lock_guard<std::mutex> lock(s_bytesMutex);
+    s_bytes[url] = bytes;
+    return url;
+}
+
+void MemoryByteStream::ReleaseBytes(const std::string& url)
+{
+    std::lock_guard<std::mutex> lock(s_bytesMutex);
+    s_bytes.erase(url);
+}
+
+MemoryByteStream::MemoryByteStream(std::shared_ptr<const void> owner, const BYTE* pData, QWORD size) :
+    m_owner(owner), m_pData(pData), m_size(size)
+{
+}
+
+HRESULT MemoryByteStream::Create(const std::string& url, MemoryByteStream** ppStream)
+{
+    *ppStream = NULL;
+    std::shared_ptr<const void> owner;
+    const BYTE* pData = NULL;
+    QWORD size = 0;
+
+    if (StartsWith(url, ASSET_SCHEME)) {
+        std::shared_ptr<LocalFile> file = LocalFile::Open(AssetFilePath(url));
+        if (!file) return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+        pData = file->Map();
+        if (pData == NULL) return E_OUTOFMEMORY;
+        size = (QWORD)file->Size();
+        owner = file;
+    }
+    else if (StartsWith(url, MEMORY_SCHEME)) {
+        Bytes bytes = {};
+        {
+            std::lock_guard<std::mutex> lock(s_bytesMutex);
+            auto it = s_bytes.find(url);
+            if (it != s_bytes.end()) bytes = it->second;
+        }
+        if (!bytes.pData || bytes.size == 0) return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+        pData = bytes.pData.get();
+        size = bytes.size;
+        owner = bytes.pData;
+    }
+    else {
+        return E_INVALIDARG;
+    }
+
+    MemoryByteStream* pStream = new (std::nothrow) MemoryByteStream(owner, pData, size);
+    if (pStream == NULL) return E_OUTOFMEMORY;
+    *ppStream = pStream;
+    return S_OK;
+}
+
+LONGLONG MemoryByteStream::ReadAt(QWORD offset, BYTE* pb, ULONG cb)
+{
+    if (offset >= m_size) return 0;
+    QWORD count = m_size - offset < cb ? m_size - offset : cb;
+    memcpy(pb, m_pData + offset, (size_t)count);
+    return (LONGLONG)count;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// Byte stream over a region of memory, reads copied straight from it (no intermediate
+// buffer), seekable anywhere. The region is either:
+//   "asset://<key>"       a Flutter asset, its file under data/flutter_assets (next to the
+//                         executable) mapped in memory
+//   "memory://<id>[.ext]" a buffer from AllocateBytes(), filled in place by Dart through FFI
+//                         (the extension a format hint)
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "mf_byte_stream.h"
+
+class MemoryByteStream : public ByteStreamBase
+{
+public:
+    static bool IsMemoryUrl(const std::string& url);
+    // The file of an asset url, empty for other urls
+    static std::filesystem::path AssetFilePath(const std::string& url);
+
+    // A buffer of 'size' bytes kept until ReleaseBytes(); returns its url, empty if it can't
+    // be allocated
+    static std::string AllocateBytes(size_t size, const std::string& extension, uint8_t** ppData);
+    // The streams created meanwhile keep the buffer until they are released
+    static void ReleaseBytes(const std::string& url);
+
+    static HRESULT Create(const std::string& url, MemoryByteStream** ppStream);
+
+protected:
+    LONGLONG ReadAt(QWORD offset, BYTE* pb, ULONG cb) override;
+    QWORD Length() override { return m_size; }
+
+private:
+    MemoryByteStream(std::shared_ptr<const void> owner, const BYTE* pData, QWORD size);
+
+    const std::shared_ptr<const void> m_owner; // keeps the region valid: the mapped file, or the bytes
+    const BYTE* const m_pData;
+    const QWORD m_size;
+};
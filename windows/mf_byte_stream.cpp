@@ -0,0 +1,258 @@
+// ref: https://learn.microsoft.com/en-us/windows/win32/api/mfobjects/nn-mfobjects-imfbytestream
+// ref: https://learn.microsoft.com/en-us/windows/win32/medfound/writing-an-asynchronous-method
+
+#include "mf_byte_stream.h"
+
+#include <wil/com.h>
+
+// One BeginRead(): the work item on the private queue, and the object of the caller's
+// result (for EndRead)
+class ByteStreamBase::ReadOperation : public IMFAsyncCallback
+{
+public:
+    ReadOperation(ByteStreamBase* pStream, QWORD offset, BYTE* pb, ULONG cb) :
+        m_pStream(pStream), m_offset(offset), m_pb(pb), m_cb(cb)
+    {
+    }
+
+    // IUnknown methods
+    STDMETHODIMP QueryInterface(REFIID iid, void** ppv)
+    {
+        if (!ppv) return E_POINTER;
+        if (iid == __uuidof(IUnknown) || iid == __uuidof(IMFAsyncCallback)) {
+            *ppv = static_cast<IMFAsyncCallback*>(this);
+            AddRef();
+            return S_OK;
+        }
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+    STDMETHODIMP_(ULONG) AddRef() {
+        return InterlockedIncrement(&m_cRef);
+    }
+    STDMETHODIMP_(ULONG) Release() {
+        ULONG uCount = InterlockedDecrement(&m_cRef);
+        if (uCount == 0) delete this;
+        return uCount;
+    }
+
+    // IMFAsyncCallback methods
+    STDMETHODIMP GetParameters(DWORD* pdwFlags, DWORD* pdwQueue)
+    {
+        return E_NOTIMPL;
+    }
+
+    STDMETHODIMP Invoke(IMFAsyncResult* pAsyncResult)
+    {
+        HRESULT hr = m_pStream->ReadAtPosition(m_offset, m_pb, m_cb, &m_cbRead);
+        m_pCallerResult->SetStatus(hr);
+        MFInvokeCallback(m_pCallerResult.get());
+        m_pCallerResult.reset(); // it holds this operation as its object
+        return S_OK;
+    }
+
+    wil::com_ptr<IMFAsyncResult> m_pCallerResult;
+    ULONG m_cbRead = 0;
+
+private:
+    long m_cRef = 1;
+    wil::com_ptr<ByteStreamBase> m_pStream;
+    QWORD m_offset;
+    BYTE* m_pb;
+    ULONG m_cb;
+};
+
+// --------------------------------------------------------------------------
+
+ByteStreamBase::ByteStreamBase()
+{
+    if (FAILED(MFAllocateWorkQueue(&m_workQueue))) m_workQueue = 0;
+}
+
+ByteStreamBase::~ByteStreamBase()
+{
+    if (m_workQueue != 0) MFUnlockWorkQueue(m_workQueue);
+}
+
+STDMETHODIMP ByteStreamBase::QueryInterface(REFIID iid, void** ppv)
+{
+    if (!ppv) return E_POINTER;
+    if (iid == __uuidof(IUnknown) || iid == __uuidof(IMFByteStream)) {
+        *ppv = static_cast<IMFByteStream*>(this);
+        AddRef();
+        return S_OK;
+    }
+    *ppv = NULL;
+    return E_NOINTERFACE;
+}
+
+STDMETHODIMP_(ULONG) ByteStreamBase::AddRef()
+{
+    return InterlockedIncrement(&m_cRef);
+}
+
+STDMETHODIMP_(ULONG) ByteStreamBase::Release()
+{
+    ULONG uCount = InterlockedDecrement(&m_cRef);
+    if (uCount == 0) delete this;
+    return uCount;
+}
+
+STDMETHODIMP ByteStreamBase::GetCapabilities(DWORD* pdwCapabilities)
+{
+    if (!pdwCapabilities) return E_POINTER;
+    *pdwCapabilities = MFBYTESTREAM_IS_READABLE | (IsSeekable() ? MFBYTESTREAM_IS_SEEKABLE : 0);
+    return S_OK;
+}
+
+STDMETHODIMP ByteStreamBase::GetLength(QWORD* pqwLength)
+{
+    if (!pqwLength) return E_POINTER;
+    *pqwLength = Length();
+    return S_OK;
+}
+
+STDMETHODIMP ByteStreamBase::SetLength(QWORD qwLength)
+{
+    return E_ACCESSDENIED;
+}
+
+STDMETHODIMP ByteStreamBase::GetCurrentPosition(QWORD* pqwPosition)
+{
+    if (!pqwPosition) return E_POINTER;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    *pqwPosition = m_position;
+    return S_OK;
+}
+
+STDMETHODIMP ByteStreamBase::SetCurrentPosition(QWORD qwPosition)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_isClosed) return MF_E_SHUTDOWN;
+    if (qwPosition == m_position) return S_OK;
+    if (!IsSeekable()) return MF_E_INVALIDREQUEST;
+    m_position = qwPosition;
+    m_isEndOfStream = false;
+    return S_OK;
+}
+
+STDMETHODIMP ByteStreamBase::IsEndOfStream(BOOL* pfEndOfStream)
+{
+    if (!pfEndOfStream) return E_POINTER;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    *pfEndOfStream = m_isEndOfStream || m_position >= Length();
+    return S_OK;
+}
+
+HRESULT ByteStreamBase::ReadAtPosition(QWORD offset, BYTE* pb, ULONG cb, ULONG* pcbRead)
+{
+    *pcbRead = 0;
+    LONGLONG read = ReadAt(offset, pb, cb);
+    if (read >= 0) *pcbRead = (ULONG)read;
+    if (*pcbRead < cb) {
+        // short read at the end, or failure: the position follows what was read
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_position == offset + cb) {
+            m_position = offset + *pcbRead;
+            if (read == 0) m_isEndOfStream = true;
+        }
+    }
+    return read < 0 ? MF_E_NET_READ : S_OK;
+}
+
+STDMETHODIMP ByteStreamBase::Read(BYTE* pb, ULONG cb, ULONG* pcbRead)
+{
+    if (!pb || !pcbRead) return E_POINTER;
+    QWORD offset = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_isClosed) return MF_E_SHUTDOWN;
+        offset = m_position;
+        m_position += cb;
+    }
+    return ReadAtPosition(offset, pb, cb, pcbRead);
+}
+
+STDMETHODIMP ByteStreamBase::BeginRead(BYTE* pb, ULONG cb, IMFAsyncCallback* pCallback, IUnknown* punkState)
+{
+    if (!pb || !pCallback) return E_POINTER;
+    if (m_workQueue == 0) return E_FAIL;
+
+    HRESULT hr = S_OK;
+    QWORD offset = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_isClosed) return MF_E_SHUTDOWN;
+        offset = m_position;
+        QWORD length = Length();
+        // the position moves at once, for the next read to be queued after this one
+        // (back to what was read once it completes short)
+        m_position = offset + cb < length ? offset + cb : (offset > length ? offset : length);
+    }
+
+    wil::com_ptr<ReadOperation> pOperation;
+    pOperation.attach(new (std::nothrow) ReadOperation(this, offset, pb, cb));
+    if (!pOperation) return E_OUTOFMEMORY;
+    hr = MFCreateAsyncResult(pOperation.get(), pCallback, punkState, &pOperation->m_pCallerResult);
+    if (SUCCEEDED(hr)) hr = MFPutWorkItem(m_workQueue, pOperation.get(), NULL);
+    if (FAILED(hr)) pOperation->m_pCallerResult.reset();
+    return hr;
+}
+
+STDMETHODIMP ByteStreamBase::EndRead(IMFAsyncResult* pResult, ULONG* pcbRead)
+{
+    if (!pResult || !pcbRead) return E_POINTER;
+    *pcbRead = 0;
+
+    wil::com_ptr<IUnknown> pObject;
+    HRESULT hr = pResult->GetObject(&pObject);
+    if (FAILED(hr)) return hr;
+    *pcbRead = static_cast<ReadOperation*>(static_cast<IMFAsyncCallback*>(pObject.get()))->m_cbRead;
+    return pResult->GetStatus();
+}
+
+STDMETHODIMP ByteStreamBase::Write(const BYTE* pb, ULONG cb, ULONG* pcbWritten)
+{
+    return E_ACCESSDENIED;
+}
+
+STDMETHODIMP ByteStreamBase::BeginWrite(const BYTE* pb, ULONG cb, IMFAsyncCallback* pCallback, IUnknown* punkState)
+{
+    return E_ACCESSDENIED;
+}
+
+STDMETHODIMP ByteStreamBase::EndWrite(IMFAsyncResult* pResult, ULONG* pcbWritten)
+{
+    return E_ACCESSDENIED;
+}
+
+STDMETHODIMP ByteStreamBase::Seek(MFBYTESTREAM_SEEK_ORIGIN SeekOrigin, LONGLONG llSeekOffset, DWORD dwSeekFlags, QWORD* pqwCurrentPosition)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_isClosed) return MF_E_SHUTDOWN;
+    LONGLONG position = SeekOrigin == msoCurrent ? (LONGLONG)m_position + llSeekOffset : llSeekOffset;
+    if (position < 0) return E_INVALIDARG;
+    if ((QWORD)position != m_position) {
+        if (!IsSeekable()) return MF_E_INVALIDREQUEST;
+        m_position = (QWORD)position;
+        m_isEndOfStream = false;
+    }
+    if (pqwCurrentPosition) *pqwCurrentPosition = m_position;
+    return S_OK;
+}
+
+STDMETHODIMP ByteStreamBase::Flush()
+{
+    return S_OK;
+}
+
+STDMETHODIMP ByteStreamBase::Close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_isClosed) return S_OK;
+        m_isClosed = true;
+    }
+    OnClose();
+    return S_OK;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+// IMFByteStream over a random access reader, for the source resolver of custom sources:
+// subclasses give ReadAt() and Length(). Reads may block (network), so the async ones run
+// on a private work queue, never on the Media Foundation standard queues. A sequential
+// source (not seekable, length unknown) reads at the current position only.
+
+#include <windows.h>
+#include <mfidl.h>
+#include <mfapi.h>
+#include <mutex>
+
+class ByteStreamBase : public IMFByteStream
+{
+public:
+    // IUnknown methods
+    STDMETHODIMP QueryInterface(REFIID iid, void** ppv);
+    STDMETHODIMP_(ULONG) AddRef();
+    STDMETHODIMP_(ULONG) Release();
+
+    // IMFByteStream methods
+    STDMETHODIMP GetCapabilities(DWORD* pdwCapabilities);
+    STDMETHODIMP GetLength(QWORD* pqwLength);
+    STDMETHODIMP SetLength(QWORD qwLength);
+    STDMETHODIMP GetCurrentPosition(QWORD* pqwPosition);
+    STDMETHODIMP SetCurrentPosition(QWORD qwPosition);
+    STDMETHODIMP IsEndOfStream(BOOL* pfEndOfStream);
+    STDMETHODIMP Read(BYTE* pb, ULONG cb, ULONG* pcbRead);
+    STDMETHODIMP BeginRead(BYTE* pb, ULONG cb, IMFAsyncCallback* pCallback, IUnknown* punkState);
+    STDMETHODIMP EndRead(IMFAsyncResult* pResult, ULONG* pcbRead);
+    STDMETHODIMP Write(const BYTE* pb, ULONG cb, ULONG* pcbWritten);
+    STDMETHODIMP BeginWrite(const BYTE* pb, ULONG cb, IMFAsyncCallback* pCallback, IUnknown* punkState);
+    STDMETHODIMP EndWrite(IMFAsyncResult* pResult, ULONG* pcbWritten);
+    STDMETHODIMP Seek(MFBYTESTREAM_SEEK_ORIGIN SeekOrigin, LONGLONG llSeekOffset, DWORD dwSeekFlags, QWORD* pqwCurrentPosition);
+    STDMETHODIMP Flush();
+    STDMETHODIMP Close();
+
+protected:
+    ByteStreamBase();
+    virtual ~ByteStreamBase();
+
+    // Blocking read of up to 'cb' bytes at 'offset': the count read (0 at the end), -1 on failure
+    virtual LONGLONG ReadAt(QWORD offset, BYTE* pb, ULONG cb) = 0;
+    // (QWORD)-1 if unknown
+    virtual QWORD Length() = 0;
+    virtual bool IsSeekable() { return true; }
+    // By the first Close(): fails the pending reads
+    virtual void OnClose() {}
+
+private:
+    class ReadOperation;
+
+    HRESULT ReadAtPosition(QWORD offset, BYTE* pb, ULONG cb, ULONG* pcbRead);
+
+    long m_cRef = 1;
+    std::mutex m_mutex;
+    QWORD m_position = 0;
+    DWORD m_workQueue = 0; // 0 if the queue could not be allocated: async reads fail
+    bool m_isEndOfStream = false; // a read returned nothing at the position
+    bool m_isClosed = false;
+};
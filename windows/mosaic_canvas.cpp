@@ -0,0 +1,94 @@
+#include "mosaic_canvas.h"
+
+#include <cstring>
+
+std::shared_ptr<MosaicCanvas> MosaicCanvas::Create(uint32_t width, uint32_t height, uint32_t columns, uint32_t rows)
+{
+	if (width == 0 || height == 0 || width > MAX_SIZE || height > MAX_SIZE) return NULL;
+	if (columns == 0 || rows == 0 || columns > width || rows > height || columns * rows > MAX_TILES) return NULL;
+
+	auto canvas = std::make_shared<MosaicCanvas>();
+	canvas->m_width = width;
+	canvas->m_height = height;
+	canvas->m_columns = columns;
+	canvas->m_rows = rows;
+	canvas->m_pixels.resize((size_t)width * height * 4);
+	for (size_t i = 0; i < canvas->m_pixels.size(); i += 4) canvas->m_pixels[i + 3] = 255; // opaque black
+	canvas->m_tiles.reset(new Tile[columns * rows]);
+	return canvas;
+}
+
+void MosaicCanvas::GetTileRect(uint32_t index, uint32_t* pX, uint32_t* pY, uint32_t* pWidth, uint32_t* pHeight) const
+{
+	// boundaries rounded the same way on both sides, so the tiles cover the canvas exactly
+	uint32_t column = index % m_columns;
+	uint32_t row = index / m_columns;
+	uint32_t x0 = (uint32_t)((uint64_t)column * m_width / m_columns);
+	uint32_t x1 = (uint32_t)((uint64_t)(column + 1) * m_width / m_columns);
+	uint32_t y0 = (uint32_t)((uint64_t)row * m_height / m_rows);
+	uint32_t y1 = (uint32_t)((uint64_t)(row + 1) * m_height / m_rows);
+	*pX = x0;
+	*pY = y0;
+	*pWidth = x1 - x0;
+	*pHeight = y1 - y0;
+}
+
+void MosaicCanvas::FitRect(uint32_t frameWidth, uint32_t frameHeight, uint32_t tileWidth, uint32_t tileHeight,
+	uint32_t* pX, uint32_t* pY, uint32_t* pWidth, uint32_t* pHeight)
+{
+	uint32_t width = tileWidth;
+	uint32_t height = tileHeight;
+	if ((uint64_t)frameWidth * tileHeight > (uint64_t)tileWidth * frameHeight) {
+		height = (uint32_t)((uint64_t)tileWidth * frameHeight / frameWidth);
+	} else {
+		width = (uint32_t)((uint64_t)tileHeight * frameWidth / frameHeight);
+	}
+	if (width == 0) width = 1;
+	if (height == 0) height = 1;
+	*pX = (tileWidth - width) / 2;
+	*pY = (tileHeight - height) / 2;
+	*pWidth = width;
+	*pHeight = height;
+}
+
+void MosaicCanvas::FillLocked(uint32_t index)
+{
+	uint32_t x, y, width, height;
+	GetTileRect(index, &x, &y, &width, &height);
+	for (uint32_t row = 0; row < height; row++) {
+		uint8_t* p = m_pixels.data() + (size_t)(y + row) * Stride() + (size_t)x * 4;
+		memset(p, 0, (size_t)width * 4);
+		for (uint32_t i = 0; i < width; i++) p[i * 4 + 3] = 255;
+	}
+}
+
+void MosaicCanvas::DrawTile(uint32_t index, const Nv12Frame& frame)
+{
+	if (index >= TileCount() || frame.width < 2 || frame.height < 2) return;
+
+	uint32_t x, y, width, height;
+	GetTileRect(index, &x, &y, &width, &height);
+	uint32_t fitX, fitY, fitWidth, fitHeight;
+	FitRect(frame.width, frame.height, width, height, &fitX, &fitY, &fitWidth, &fitHeight);
+
+	Tile& tile = m_tiles[index];
+	std::lock_guard<std::mutex> lock(tile.mutex);
+	if (tile.fitWidth != fitWidth || tile.fitHeight != fitHeight) {
+		FillLocked(index); // new aspect ratio: clear the previous bars
+		tile.fitWidth = fitWidth;
+		tile.fitHeight = fitHeight;
+	}
+	uint8_t* dst = m_pixels.data() + (size_t)(y + fitY) * Stride() + (size_t)(x + fitX) * 4;
+	ConvertScaleNv12ToRgba(frame, dst, fitWidth, fitHeight, Stride());
+	m_dirtyTiles.fetch_or(1ULL << index);
+}
+
+void MosaicCanvas::ClearTile(uint32_t index)
+{
+	if (index >= TileCount()) return;
+	Tile& tile = m_tiles[index];
+	std::lock_guard<std::mutex> lock(tile.mutex);
+	FillLocked(index);
+	tile.fitWidth = tile.fitHeight = 0;
+	m_dirtyTiles.fetch_or(1ULL << index);
+}
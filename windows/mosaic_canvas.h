@@ -0,0 +1,64 @@
+#pragma once
+
+// One RGBA canvas showing the frames of several players in a grid (video walls), so the
+// whole wall is one texture: each player converts and scales its frames straight into
+// its tile, and the canvas is published at one cadence, only when a tile has changed.
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "video_convert.h"
+
+class MosaicCanvas
+{
+public:
+	static const uint32_t MAX_TILES = 64; // one dirty bit per tile
+	static const uint32_t MAX_SIZE = 8192;
+
+	// NULL if the size or the grid is invalid
+	static std::shared_ptr<MosaicCanvas> Create(uint32_t width, uint32_t height, uint32_t columns, uint32_t rows);
+
+	uint32_t Width() const { return m_width; }
+	uint32_t Height() const { return m_height; }
+	uint32_t Columns() const { return m_columns; }
+	uint32_t Rows() const { return m_rows; }
+	uint32_t TileCount() const { return m_columns * m_rows; }
+	uint32_t Stride() const { return m_width * 4; }
+	const uint8_t* Pixels() const { return m_pixels.data(); }
+
+	// Converts 'frame' into tile 'index', fitted with its aspect ratio and centered. Called from
+	// the sample thread of the player on that tile.
+	void DrawTile(uint32_t index, const Nv12Frame& frame);
+	// Fills tile 'index' with black (its player left)
+	void ClearTile(uint32_t index);
+
+	// Tiles changed since the last call, one bit per tile
+	uint64_t TakeDirtyTiles() { return m_dirtyTiles.exchange(0); }
+
+	void GetTileRect(uint32_t index, uint32_t* pX, uint32_t* pY, uint32_t* pWidth, uint32_t* pHeight) const;
+
+	// Rectangle of a frame fitted into a tile, relative to the tile
+	static void FitRect(uint32_t frameWidth, uint32_t frameHeight, uint32_t tileWidth, uint32_t tileHeight,
+		uint32_t* pX, uint32_t* pY, uint32_t* pWidth, uint32_t* pHeight);
+
+private:
+	struct Tile
+	{
+		std::mutex mutex;        // a tile may change of player
+		uint32_t fitWidth = 0;   // size of the last frame drawn, the bars are cleared when it changes
+		uint32_t fitHeight = 0;
+	};
+
+	void FillLocked(uint32_t index);
+
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint32_t m_columns = 0;
+	uint32_t m_rows = 0;
+	std::vector<uint8_t> m_pixels;
+	std::unique_ptr<Tile[]> m_tiles;
+	std::atomic<uint64_t> m_dirtyTiles{0};
+};
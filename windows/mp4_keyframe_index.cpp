@@ -0,0 +1,284 @@
+// ref: ISO/IEC 14496-12 (ISO base media file format), 8.6 Time to Sample Boxes
+
+#include "mp4_keyframe_index.h"
+
+#include <algorithm>
+#include <list>
+#include <mutex>
+
+#include "iso_bmff.h"
+
+using namespace iso_bmff;
+
+static int64_t MediaTimeToHns(int64_t t, uint32_t timescale)
+{
+	if (timescale == 0) return 0;
+	// split to avoid overflow for long movies with large timescales
+	return (t / timescale) * 10000000 + (t % timescale) * 10000000 / timescale;
+}
+
+// Sample tables of one track, as read from the file (big-endian payloads).
+struct TrackTables
+{
+	uint32_t timescale = 0;
+	uint64_t duration = 0;
+	int64_t editMediaTime = 0;
+	std::vector<uint8_t> stts, ctts, stss;
+	bool hasCtts = false, hasStss = false;
+	// Upper bound of the sample count: a sample takes at least a byte of the file, and
+	// stsz (when present) lists each of them
+	uint64_t maxSamples = 0;
+};
+
+template <class Source>
+static bool ReadVideoTrackTables(Source& src, const Box& trak, TrackTables* pTables)
+{
+	Box mdia, hdlr, mdhd, minf, stbl, box;
+	std::vector<uint8_t> data;
+
+	if (!FindBox(src, trak.begin, trak.end, BoxType("mdia"), &mdia)) return false;
+
+	// handler type is at offset 8 (version/flags + pre_defined)
+	if (!FindBox(src, mdia.begin, mdia.end, BoxType("hdlr"), &hdlr)) return false;
+	if (!ReadPayload(src, hdlr, &data, 4096) || data.size() < 12) return false;
+	if (ReadBE32(&data[8]) != BoxType("vide")) return false;
+
+	if (!FindBox(src, mdia.begin, mdia.end, BoxType("mdhd"), &mdhd)) return false;
+	if (!ReadPayload(src, mdhd, &data, 4096) || data.size() < 4) return false;
+	if (data[0] == 1) {
+		if (data.size() < 32) return false;
+		pTables->timescale = ReadBE32(&data[20]);
+		pTables->duration = ReadBE64(&data[24]);
+	} else {
+		if (data.size() < 20) return false;
+		pTables->timescale = ReadBE32(&data[12]);
+		pTables->duration = ReadBE32(&data[16]);
+	}
+	if (pTables->timescale == 0) return false;
+
+	// edit list: the first non-empty edit shifts the presentation timeline (the entry count is bounded by the payload)
+	Box edts, elst;
+	if (FindBox(src, trak.begin, trak.end, BoxType("edts"), &edts) &&
+		FindBox(src, edts.begin, edts.end, BoxType("elst"), &elst) &&
+		ReadPayload(src, elst, &data, 1024 * 1024) && data.size() >= 8) {
+		bool v1 = data[0] == 1;
+		size_t entrySize = v1 ? 20 : 12;
+		uint32_t count = ReadBE32(&data[4]);
+		for (uint32_t i = 0; i < count && 8 + (i + 1) * entrySize <= data.size(); i++) {
+			const uint8_t* p = &data[8 + i * entrySize];
+			int64_t mediaTime = v1 ? (int64_t)ReadBE64(p + 8) : (int64_t)(int32_t)ReadBE32(p + 4);
+			if (mediaTime >= 0) {
+				pTables->editMediaTime = mediaTime;
+				break;
+			}
+		}
+	}
+
+	if (!FindBox(src, mdia.begin, mdia.end, BoxType("minf"), &minf)) return false;
+	if (!FindBox(src, minf.begin, minf.end, BoxType("stbl"), &stbl)) return false;
+
+	if (!FindBox(src, stbl.begin, stbl.end, BoxType("stts"), &box)) return false;
+	if (!ReadPayload(src, box, &pTables->stts)) return false;
+	if (FindBox(src, stbl.begin, stbl.end, BoxType("ctts"), &box)) {
+		if (!ReadPayload(src, box, &pTables->ctts)) return false;
+		pTables->hasCtts = true;
+	}
+	if (FindBox(src, stbl.begin, stbl.end, BoxType("stss"), &box)) {
+		if (!ReadPayload(src, box, &pTables->stss)) return false;
+		pTables->hasStss = true;
+	}
+
+	pTables->maxSamples = src.Size();
+	uint8_t stsz[12];
+	if (FindBox(src, stbl.begin, stbl.end, BoxType("stsz"), &box) && box.PayloadSize() >= 12 && src.ReadAt(box.begin, stsz, 12)) {
+		uint64_t count = ReadBE32(stsz + 8);
+		// without a common size (field 4), the table holds a 32-bit size per sample
+		if (ReadBE32(stsz + 4) == 0) count = std::min<uint64_t>(count, (box.PayloadSize() - 12) / 4);
+		pTables->maxSamples = std::min(pTables->maxSamples, count);
+	}
+	return true;
+}
+
+// Walks all the samples once, collecting the presentation time of each sync sample.
+static bool BuildFromTables(const TrackTables& t, Mp4KeyframeIndex* pIndex)
+{
+	if (t.stts.size() < 8) return false;
+	uint32_t sttsCount = std::min<uint32_t>(ReadBE32(&t.stts[4]), (uint32_t)((t.stts.size() - 8) / 8));
+
+	uint32_t cttsCount = 0;
+	bool cttsSigned = false;
+	if (t.hasCtts && t.ctts.size() >= 8) {
+		cttsSigned = t.ctts[0] == 1;
+		cttsCount = std::min<uint32_t>(ReadBE32(&t.ctts[4]), (uint32_t)((t.ctts.size() - 8) / 8));
+	}
+
+	uint32_t stssCount = 0;
+	if (t.hasStss && t.stss.size() >= 8) {
+		stssCount = std::min<uint32_t>(ReadBE32(&t.stss[4]), (uint32_t)((t.stss.size() - 8) / 4));
+	}
+
+	// The counts of the tables are bounded by their payload above; the samples they
+	// describe, by the file (a stts entry alone may claim 4 billion samples)
+	uint64_t maxSamples = std::min<uint64_t>(t.maxSamples, UINT32_MAX - 1);
+
+	pIndex->timescale = t.timescale;
+	pIndex->hnsDuration = MediaTimeToHns((int64_t)t.duration, t.timescale);
+	pIndex->sampleCount = 0;
+	pIndex->hnsKeyframes.clear();
+	if (t.hasStss) pIndex->hnsKeyframes.reserve((size_t)std::min<uint64_t>(stssCount, maxSamples));
+
+	uint32_t cttsEntry = 0, cttsLeft = cttsCount > 0 ? ReadBE32(&t.ctts[8]) : 0;
+	uint32_t stssEntry = 0;
+	uint32_t sampleNumber = 1; // 1-based, as in stss
+	int64_t dts = 0;
+
+	for (uint32_t i = 0; i < sttsCount; i++) {
+		uint32_t count = ReadBE32(&t.stts[8 + i * 8]);
+		uint32_t delta = ReadBE32(&t.stts[8 + i * 8 + 4]);
+		if (sampleNumber - 1 + (uint64_t)count > maxSamples) return false; // more samples than the file holds
+
+		for (uint32_t n = 0; n < count; n++, sampleNumber++) {
+			int64_t cts = 0;
+			if (cttsEntry < cttsCount) {
+				while (cttsLeft == 0 && ++cttsEntry < cttsCount) cttsLeft = ReadBE32(&t.ctts[8 + cttsEntry * 8]);
+				if (cttsEntry < cttsCount) {
+					uint32_t raw = ReadBE32(&t.ctts[8 + cttsEntry * 8 + 4]);
+					cts = cttsSigned ? (int64_t)(int32_t)raw : (int64_t)raw;
+					cttsLeft--;
+				}
+			}
+
+			bool isSync;
+			if (!t.hasStss) {
+				isSync = true;
+			} else {
+				while (stssEntry < stssCount && ReadBE32(&t.stss[8 + stssEntry * 4]) < sampleNumber) stssEntry++;
+				isSync = stssEntry < stssCount && ReadBE32(&t.stss[8 + stssEntry * 4]) == sampleNumber;
+			}
+
+			if (isSync) {
+				int64_t pts = dts + cts - t.editMediaTime;
+				pIndex->hnsKeyframes.push_back(MediaTimeToHns(std::max<int64_t>(pts, 0), t.timescale));
+			}
+			dts += delta;
+		}
+	}
+	pIndex->sampleCount = sampleNumber - 1;
+
+	std::sort(pIndex->hnsKeyframes.begin(), pIndex->hnsKeyframes.end());
+	return !pIndex->hnsKeyframes.empty();
+}
+
+template <class Source>
+static bool BuildIndex(Source& src, Mp4KeyframeIndex* pIndex)
+{
+	Box moov, trak;
+	if (!FindBox(src, 0, src.Size(), BoxType("moov"), &moov)) return false;
+
+	uint64_t pos = moov.begin;
+	while (ReadBox(src, pos, moov.end, &trak)) {
+		pos = trak.end;
+		if (trak.type != BoxType("trak")) continue;
+
+		TrackTables tables;
+		if (ReadVideoTrackTables(src, trak, &tables)) {
+			return BuildFromTables(tables, pIndex);
+		}
+	}
+	return false;
+}
+
+bool Mp4KeyframeIndex::Build(MediaFile& file, Mp4KeyframeIndex* pIndex)
+{
+	return BuildIndex(file, pIndex);
+}
+
+bool Mp4KeyframeIndex::Build(const uint8_t* data, size_t size, Mp4KeyframeIndex* pIndex)
+{
+	MediaMemoryView view(data, size);
+	return BuildIndex(view, pIndex);
+}
+
+int64_t Mp4KeyframeIndex::PreviousKeyframe(int64_t hnsTime) const
+{
+	if (hnsKeyframes.empty()) return hnsTime;
+	auto it = std::upper_bound(hnsKeyframes.begin(), hnsKeyframes.end(), hnsTime);
+	if (it == hnsKeyframes.begin()) return *it;
+	return *(it - 1);
+}
+
+int64_t Mp4KeyframeIndex::NearestKeyframe(int64_t hnsTime) const
+{
+	if (hnsKeyframes.empty()) return hnsTime;
+	auto it = std::lower_bound(hnsKeyframes.begin(), hnsKeyframes.end(), hnsTime);
+	if (it == hnsKeyframes.end()) return hnsKeyframes.back();
+	if (it == hnsKeyframes.begin()) return *it;
+	int64_t after = *it, before = *(it - 1);
+	return (hnsTime - before <= after - hnsTime) ? before : after;
+}
+
+SeekPlan Mp4KeyframeIndex::PlanSeek(int64_t hnsTarget, SeekMode mode) const
+{
+	SeekPlan plan;
+	plan.hnsStart = hnsTarget;
+	plan.hnsSkipUntil = -1;
+
+	switch (mode) {
+	case SEEK_MODE_PREVIOUS_KEYFRAME:
+		plan.hnsStart = PreviousKeyframe(hnsTarget);
+		break;
+	case SEEK_MODE_NEAREST_KEYFRAME:
+		plan.hnsStart = NearestKeyframe(hnsTarget);
+		break;
+	default:
+		// The source seeks to the previous keyframe by itself, and the frames between the
+		// keyframe and the target are late for the clock, so they are delivered at once.
+		// Skip them instead of flashing them on the screen. No skip needed on a keyframe.
+		if (hnsKeyframes.empty() || PreviousKeyframe(hnsTarget) != hnsTarget) plan.hnsSkipUntil = hnsTarget;
+		break;
+	}
+	return plan;
+}
+
+// --------------------------------------------------------------------------
+
+struct CacheEntry
+{
+	MediaFileIdentity identity;
+	std::shared_ptr<const Mp4KeyframeIndex> index; // NULL: parsed, but not a MP4 with video
+};
+
+static std::mutex gCacheMutex;
+static std::list<CacheEntry> gCache; // most recently used first
+
+std::shared_ptr<const Mp4KeyframeIndex> Mp4KeyframeIndexCache::Get(const std::filesystem::path& path)
+{
+	MediaFileIdentity identity;
+	if (!MediaFileIdentity::Query(path, &identity)) return NULL;
+
+	{
+		std::lock_guard<std::mutex> lock(gCacheMutex);
+		for (auto it = gCache.begin(); it != gCache.end(); it++) {
+			if (it->identity == identity) {
+				gCache.splice(gCache.begin(), gCache, it);
+				return gCache.front().index;
+			}
+		}
+	}
+
+	// parse outside the lock, so slow disks don't block other players
+	std::shared_ptr<Mp4KeyframeIndex> index = std::make_shared<Mp4KeyframeIndex>();
+	MediaFile file;
+	if (!file.Open(path) || !Mp4KeyframeIndex::Build(file, index.get())) index.reset();
+
+	std::lock_guard<std::mutex> lock(gCacheMutex);
+	gCache.push_front(CacheEntry{ identity, index });
+	while (gCache.size() > MAX_ENTRIES) gCache.pop_back();
+	return index;
+}
+
+void Mp4KeyframeIndexCache::Clear()
+{
+	std::lock_guard<std::mutex> lock(gCacheMutex);
+	gCache.clear();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// Keyframe index of the first video track of a MP4 / MOV file.
+// The index is built from the sample tables (stts / ctts / stss) of the moov box,
+// without Media Foundation, so it is portable and can be tested on Linux.
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "media_file.h"
+
+enum SeekMode
+{
+	// start at the target, frames before the target (decoded from the previous keyframe) are skipped
+	SEEK_MODE_ACCURATE = 0,
+	// snap to the keyframe at or before the target, no decode-skip
+	SEEK_MODE_PREVIOUS_KEYFRAME,
+	// snap to the keyframe closest to the target, no decode-skip
+	SEEK_MODE_NEAREST_KEYFRAME,
+};
+
+struct SeekPlan
+{
+	int64_t hnsStart;    // position passed to the media session
+	int64_t hnsSkipUntil; // frames ending before this time are decoded but not shown, -1 if none
+};
+
+class Mp4KeyframeIndex
+{
+public:
+	uint32_t timescale = 0;       // media timescale of the video track
+	int64_t hnsDuration = 0;      // duration of the video track, in 100ns units
+	uint32_t sampleCount = 0;
+	std::vector<int64_t> hnsKeyframes; // presentation times of the sync samples, ascending, in 100ns units
+
+	bool IsEmpty() const { return hnsKeyframes.empty(); }
+
+	// Returns the last keyframe time <= hnsTime (or the first keyframe)
+	int64_t PreviousKeyframe(int64_t hnsTime) const;
+	// Returns the keyframe time closest to hnsTime
+	int64_t NearestKeyframe(int64_t hnsTime) const;
+
+	SeekPlan PlanSeek(int64_t hnsTarget, SeekMode mode) const;
+
+	// Parses the moov box of 'file'. Returns false if it is not a MP4 / MOV file
+	// or has no video track (ex. audio only, or fragmented MP4 without sample tables).
+	static bool Build(MediaFile& file, Mp4KeyframeIndex* pIndex);
+	static bool Build(const uint8_t* data, size_t size, Mp4KeyframeIndex* pIndex);
+};
+
+// Process-wide cache of keyframe indices, keyed by (path, size, mtime),
+// so re-opening the same file skips the sample table parse.
+class Mp4KeyframeIndexCache
+{
+public:
+	// Returns NULL if the path is not a local MP4 / MOV file
+	static std::shared_ptr<const Mp4KeyframeIndex> Get(const std::filesystem::path& path);
+	static void Clear();
+
+	static const size_t MAX_ENTRIES = 64;
+};
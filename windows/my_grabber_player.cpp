@@ -11,6 +11,15 @@
 #include <mfreadwrite.h>
 #include <new>
 #include <iostream>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "media_probe.h"
+#include "DX11VideoRenderer.h"
+#include "worker_pool.h"
 
 #include <mmdeviceapi.h>
 #include <audiopolicy.h>
@@ -93,8 +102,23 @@ class SampleGrabberCB : public IMFSampleGrabberSinkCallback
 {
     long m_cRef;
     wil::com_ptr<MyPlayerCallback> m_pUserCallback;
+    std::atomic<LONGLONG> m_hnsSkipUntil; // frames ending before this time are not delivered, -1 if none
+    std::shared_ptr<SampleTraceWriter> m_pTrace; // atomic_load / atomic_store, NULL if not tracing
+
+    // frame cadence around a playlist transition (sample thread only, but the atomics)
+    static const int CADENCE_INTERVALS = 8;
+    std::function<void(double)> m_gapCallback;
+    std::atomic<int> m_framesAfterTransition; // -1 if no transition is measured
+    std::atomic<bool> m_isCadenceReset;       // the clock was paused / restarted
+    LONGLONG m_hnsLastFrameTime;
+    LONGLONG m_hnsIntervals[CADENCE_INTERVALS];
+    int m_intervalCount;
+
+    SampleGrabberCB() : m_cRef(1), m_hnsSkipUntil(-1), m_framesAfterTransition(-1), m_isCadenceReset(false),
+        m_hnsLastFrameTime(0), m_hnsIntervals(), m_intervalCount(0) {}
 
-    SampleGrabberCB() : m_cRef(1) {}
+    void MeasureCadence();
+    void TraceEvent(SampleTraceEvent event, LONGLONG value = 0);
 
 public:
     static HRESULT CreateInstance(SampleGrabberCB** ppCB);
@@ -105,6 +129,11 @@ public:
     STDMETHODIMP_(ULONG) Release();
 
     void SetUserCallback(MyPlayerCallback* cb) { m_pUserCallback = cb; } //Jacky
+    void SetSkipUntil(LONGLONG hnsTime) { m_hnsSkipUntil = hnsTime; }
+    // 'callback' gets the gap of each transition, in ms, a few frames after MarkTransition()
+    void SetGapCallback(std::function<void(double)> callback) { m_gapCallback = callback; }
+    void MarkTransition() { m_framesAfterTransition = 0; }
+    void SetSampleTrace(std::shared_ptr<SampleTraceWriter> pTrace) { std::atomic_store(&m_pTrace, pTrace); }
 
     // IMFClockStateSink methods
     STDMETHODIMP OnClockStart(MFTIME hnsSystemTime, LONGLONG llClockStartOffset);
@@ -121,6 +150,64 @@ public:
     STDMETHODIMP OnShutdown();
 };
 
+// --------------------------------------------------------------------------
+
+// Copies the frames the DX11 renderer presents into a staging texture, and gives them to
+// MyPlayerCallback::OnRenderedFrame(). Called on the renderer's scheduler thread, with its
+// presenter locked (which serializes the use of the immediate context).
+class RendererReadback
+{
+    std::mutex m_mutex;
+    wil::com_ptr<MyPlayerCallback> m_pUserCallback; // NULL once the player is shut down
+    wil::com_ptr<ID3D11Texture2D> m_pStaging;
+
+public:
+    RendererReadback(MyPlayerCallback* cb) : m_pUserCallback(cb) {}
+
+    // Frames presented later are dropped (the renderer keeps the texture callback until released)
+    void Detach()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pUserCallback.reset();
+        m_pStaging.reset();
+    }
+
+    void OnTexture(ID3D11Texture2D* pTexture)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_pUserCallback == NULL) return;
+
+        D3D11_TEXTURE2D_DESC desc;
+        pTexture->GetDesc(&desc);
+        wil::com_ptr<ID3D11Device> pDevice;
+        wil::com_ptr<ID3D11DeviceContext> pContext;
+        pTexture->GetDevice(&pDevice);
+        pDevice->GetImmediateContext(&pContext);
+
+        if (m_pStaging != NULL) {
+            D3D11_TEXTURE2D_DESC stagingDesc;
+            m_pStaging->GetDesc(&stagingDesc);
+            if (stagingDesc.Width != desc.Width || stagingDesc.Height != desc.Height) m_pStaging.reset();
+        }
+        if (m_pStaging == NULL) {
+            D3D11_TEXTURE2D_DESC stagingDesc = desc;
+            stagingDesc.MipLevels = 1;
+            stagingDesc.ArraySize = 1;
+            stagingDesc.Usage = D3D11_USAGE_STAGING;
+            stagingDesc.BindFlags = 0;
+            stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+            stagingDesc.MiscFlags = 0;
+            if (FAILED(pDevice->CreateTexture2D(&stagingDesc, NULL, &m_pStaging))) return;
+        }
+
+        pContext->CopyResource(m_pStaging.get(), pTexture);
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        if (FAILED(pContext->Map(m_pStaging.get(), 0, D3D11_MAP_READ, 0, &mapped))) return;
+        m_pUserCallback->OnRenderedFrame((const BYTE*)mapped.pData, desc.Width, desc.Height, mapped.RowPitch);
+        pContext->Unmap(m_pStaging.get(), 0);
+    }
+};
+
 HRESULT CreateTopology(IMFMediaSource* pSource, IMFActivate* pSink, IMFTopology** ppTopo);
 
 // --------------------------------------------------------------------------
@@ -129,7 +216,19 @@ MyPlayer::MyPlayer() :
     m_hnsDuration(-1),
     m_VideoWidth(0),
     m_VideoHeight(0),
-    m_isShutdown(false)
+    m_isShutdown(false),
+    m_isThinned(false),
+    m_hnsPreroll(0),
+    m_playlistIndex(0),
+    m_preparingIndex(-1),
+    m_jumpIndex(-1),
+    m_hnsJumpOffset(0),
+    m_isJumpPaused(false),
+    m_isWaitingNext(false),
+    m_isItemClockPending(false),
+    m_hnsItemClockStart(0),
+    m_playlistGeneration(0),
+    m_prepareKey(0)
 {
     initAudioVolume();
 }
@@ -185,13 +284,18 @@ done:
 
 HRESULT MyPlayer::OpenURL(const WCHAR* pszFileName, MyPlayerCallback* playerCallback, HWND hwndVideo, std::function<void(bool)> loadCallback)
 {
+    std::string u8url = std::filesystem::path(pszFileName).u8string();
+    // an asset is indexed / cached as the file it is mapped from
+    std::filesystem::path path = MemoryByteStream::AssetFilePath(u8url);
+    if (path.empty()) path = pszFileName;
     this->AddRef(); // keep *this alive before callback called
-    HRESULT hr = CreateMediaSourceAsync(pszFileName, [=](IMFMediaSource* pSource) -> void {
+    std::function<void(IMFMediaSource* pSource)> onSource = [=](IMFMediaSource* pSource) -> void {
         HRESULT hr;
         wil::com_ptr<SampleGrabberCB> pCallback;
         wil::com_ptr<IMFTopology> pTopology;
         wil::com_ptr<IMFMediaType> pType;
         wil::com_ptr<IMFClock> pClock;
+        TopologyInfo info;
 
         if (this->Release() <= 0 || pSource == NULL) {
             //load fail or abort
@@ -211,11 +315,28 @@ HRESULT MyPlayer::OpenURL(const WCHAR* pszFileName, MyPlayerCallback* playerCall
         CHECK_HR(hr = pType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_NV12)); //OK
         //CHECK_HR(hr = pType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_ARGB32)); //fail
 
-        if (playerCallback != NULL) //Jacky
+        if (playerCallback != NULL && m_hwndRenderer != NULL)
+        {
+            // Rendered by DX11VideoRenderer (scheduled, queued and presented by it), read back from its texture
+            std::shared_ptr<RendererReadback> pReadback = std::make_shared<RendererReadback>(playerCallback);
+            {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                m_pReadback = pReadback;
+            }
+            CHECK_HR(hr = CreateDX11VideoRendererActivate(m_hwndRenderer, &m_pVideoSinkActivate,
+                [pReadback](ID3D11Texture2D* pTexture) { pReadback->OnTexture(pTexture); }));
+        }
+        else if (playerCallback != NULL) //Jacky
         {
             // Create the sample grabber sink.
             CHECK_HR(hr = SampleGrabberCB::CreateInstance(&pCallback));
             pCallback->SetUserCallback(playerCallback);
+            pCallback->SetGapCallback([this](double gapMs) { OnTransitionGap(gapMs); });
+            {
+                std::lock_guard<std::mutex> guard(m_mutex);
+                m_pGrabberCB = pCallback;
+            }
+            pCallback->SetSampleTrace(std::atomic_load(&m_pSampleTrace));
             CHECK_HR(hr = MFCreateSampleGrabberSinkActivate(pType.get(), pCallback.get(), &m_pVideoSinkActivate)); //Jacky
         }
         else
@@ -229,8 +350,26 @@ HRESULT MyPlayer::OpenURL(const WCHAR* pszFileName, MyPlayerCallback* playerCall
         // Create the Media Session.
         CHECK_HR(hr = MFCreateMediaSession(NULL, &m_pSession));
 
-        // Create the topology.
-        CHECK_HR(hr = CreateTopology(m_pMediaSource.get(), m_pVideoSinkActivate.get(), &pTopology));
+        // Create the topology (of the first item of a playlist, which may be trimmed).
+        CHECK_HR(hr = CreateTopology(m_pMediaSource.get(), m_pVideoSinkActivate.get(), m_playlist.empty() ? NULL : &m_playlist[0], &pTopology, &info));
+        if (info.hnsDuration <= 0) {
+            // a sequential HLS stream has no duration of its own, the VOD playlist gives it
+            std::lock_guard<std::mutex> lock(m_streamMutex);
+            if (m_pHlsStream) info.hnsDuration = (MFTIME)(m_pHlsStream->DurationSec() * 10000000);
+        }
+        {
+            // the duration of the playlist needs those of the other items, probed in background
+            std::shared_future<void> playlistProbed;
+            {
+                std::lock_guard<std::mutex> lock(m_playlistMutex);
+                playlistProbed = m_playlistProbed;
+            }
+            if (playlistProbed.valid()) playlistProbed.wait();
+
+            std::lock_guard<std::mutex> lock(m_playlistMutex);
+            if (!m_playlist.empty()) m_timeline.SetDuration(0, info.hnsDuration);
+            ApplyTopologyInfo(info);
+        }
 
         // Run the media session.
         CHECK_HR(hr = m_pSession->SetTopology(0, pTopology.get()));
@@ -241,10 +380,29 @@ HRESULT MyPlayer::OpenURL(const WCHAR* pszFileName, MyPlayerCallback* playerCall
 
         // Get the rate control interface (optional)
         CHECK_HR(MFGetService(m_pSession.get(), MF_RATE_CONTROL_SERVICE, IID_PPV_ARGS(&m_pRate)));
+        MFGetService(m_pSession.get(), MF_RATE_CONTROL_SERVICE, IID_PPV_ARGS(&m_pRateSupport)); // NULL without rate support
+
+        // The keyframe index plans the seeks once built, in background (it reads the file)
+        BuildKeyframeIndexAsync(path);
+
+        // Refresh the persisted metadata, so the next openVideo() of this file can return at once
+        MediaMetadataCache::Instance().Store(path, m_metadata);
 
         // add event listener
         m_pSession->BeginGetEvent(this, NULL);
 
+        if (!m_playlist.empty()) {
+            std::lock_guard<std::mutex> lock(m_playlistMutex);
+            PreparedItem item;
+            item.index = 0;
+            item.pSource = m_pMediaSource;
+            item.pTopology = pTopology;
+            item.info = info;
+            pTopology->GetTopologyID(&item.topologyId);
+            m_queued.push_back(item);
+            SchedulePrepareNext();
+        }
+
         /* Jacky test, try to get volume control fail... {
         {
             UINT32 channelsCount;
@@ -262,7 +420,28 @@ HRESULT MyPlayer::OpenURL(const WCHAR* pszFileName, MyPlayerCallback* playerCall
         // Clean up.
         if (FAILED(hr)) Shutdown();
         loadCallback(SUCCEEDED(hr));
-        });
+        };
+
+    HRESULT hr = S_OK;
+    if (MemoryByteStream::IsMemoryUrl(u8url)) {
+        // an asset or bytes from Dart, read straight from memory
+        wil::com_ptr<MemoryByteStream> pMemoryStream;
+        hr = MemoryByteStream::Create(u8url, &pMemoryStream);
+        if (SUCCEEDED(hr)) hr = CreateMediaSourceAsync(pszFileName, onSource, pMemoryStream.get());
+    }
+    else if (m_playlist.empty() && HttpClient::IsHttpUrl(u8url) && (HttpByteStream::GetOptions().isEnabled || IsHlsUrl(u8url))) {
+        hr = OpenHttpStreamAsync(pszFileName, onSource);
+    }
+    else {
+        // a local file (or on a network share) through the read-ahead, else as usual
+        wil::com_ptr<FileByteStream> pFileStream;
+        if (m_playlist.empty() && u8url.find("://") == std::string::npos) FileByteStream::Create(pszFileName, &pFileStream);
+        if (pFileStream) {
+            std::lock_guard<std::mutex> lock(m_streamMutex);
+            m_pFileStream = pFileStream;
+        }
+        hr = CreateMediaSourceAsync(pszFileName, onSource, pFileStream.get());
+    }
 
     // Clean up.
     if (FAILED(hr)) Shutdown();
@@ -274,6 +453,11 @@ HRESULT MyPlayer::Play(LONGLONG ms)
     if (m_pSession == NULL) return E_FAIL;
     if (ms >= 0) return Seek(ms);
 
+    if (!m_playlist.empty()) {
+        std::lock_guard<std::mutex> lock(m_playlistMutex);
+        m_isJumpPaused = false;
+    }
+
     PROPVARIANT var;
     PropVariantInit(&var);
     return m_pSession->Start(NULL, &var);
@@ -282,6 +466,10 @@ HRESULT MyPlayer::Play(LONGLONG ms)
 HRESULT MyPlayer::Pause()
 {
     if (m_pSession == NULL) return E_FAIL;
+    if (!m_playlist.empty()) {
+        std::lock_guard<std::mutex> lock(m_playlistMutex);
+        m_isJumpPaused = true; // the item being switched to starts paused
+    }
     return m_pSession->Pause();
 }
 
@@ -298,16 +486,56 @@ LONGLONG MyPlayer::GetCurrentPosition()
     if (m_pSession == NULL) return -1;
     hr = m_pClock->GetTime(&pos);
     if (FAILED(hr)) return -1;
+
+    if (!m_playlist.empty()) {
+        // the position on the whole playlist
+        std::lock_guard<std::mutex> lock(m_playlistMutex);
+        if (m_jumpIndex >= 0) return (m_timeline.ItemStart(m_jumpIndex) + m_hnsJumpOffset) / 10000;
+
+        pos = m_timeline.Position(m_playlistIndex, pos - m_hnsItemClockStart);
+    }
     return pos / 10000;
 }
 
-HRESULT MyPlayer::Seek(LONGLONG ms)
+HRESULT MyPlayer::Seek(LONGLONG ms, SeekMode mode, LONGLONG* pActualMs)
 {
     PROPVARIANT var;
+    SeekPlan plan = { ms * 10000, ms * 10000 };
+    // the grabber and the keyframe index are set by the load, and dropped by Shutdown()
+    std::lock_guard<std::mutex> guard(m_mutex);
     if (m_pSession == NULL) return E_FAIL;
+
+    if (!m_playlist.empty()) {
+        std::lock_guard<std::mutex> lock(m_playlistMutex);
+        LONGLONG hnsOffset = 0;
+        int index = m_timeline.Locate(ms * 10000, &hnsOffset);
+
+        if (pActualMs != NULL) *pActualMs = ms;
+        if (index != m_playlistIndex || m_jumpIndex >= 0) return JumpToItem(index, hnsOffset, mode);
+
+        // the session positions are relative to the start of the item
+        plan = PlanItemSeek(index, m_pKeyframeIndex.get(), hnsOffset, mode);
+        m_hnsItemClockStart = 0;
+        m_isItemClockPending = false;
+        m_isWaitingNext = false;
+        if (pActualMs != NULL) *pActualMs = (m_timeline.ItemStart(index) + plan.hnsStart) / 10000;
+        if (m_pGrabberCB != NULL) m_pGrabberCB->SetSkipUntil(plan.hnsSkipUntil);
+
+        PropVariantInit(&var);
+        var.vt = VT_I8;
+        var.hVal.QuadPart = plan.hnsStart;
+        return m_pSession->Start(NULL, &var);
+    }
+
+    if (m_pKeyframeIndex != NULL) {
+        plan = m_pKeyframeIndex->PlanSeek(ms * 10000, mode);
+    }
+    if (m_pGrabberCB != NULL) m_pGrabberCB->SetSkipUntil(plan.hnsSkipUntil);
+    if (pActualMs != NULL) *pActualMs = plan.hnsStart / 10000;
+
     PropVariantInit(&var);
     var.vt = VT_I8;
-    var.hVal.QuadPart = ms * 10000;
+    var.hVal.QuadPart = plan.hnsStart;
     return m_pSession->Start(NULL, &var);
 }
 
@@ -319,10 +547,24 @@ SIZE MyPlayer::GetVideoSize()
     return size;
 }
 
-HRESULT MyPlayer::SetPlaybackSpeed(float speed)
+HRESULT MyPlayer::SetPlaybackSpeed(float speed, float thinningRate)
 {
     if (m_pSession == NULL) return E_FAIL;
-    return m_pRate->SetRate(FALSE, speed);
+
+    // Keyframe-only delivery: a fraction of the decode at 4x-16x, and no burst of late frames
+    bool isThinned = thinningRate > 0 && fabsf(speed) >= thinningRate;
+    if (thinningRate > 0 && m_pRateSupport != NULL) {
+        if (isThinned && FAILED(m_pRateSupport->IsRateSupported(TRUE, speed, NULL))) {
+            isThinned = false;
+        } else if (!isThinned && FAILED(m_pRateSupport->IsRateSupported(FALSE, speed, NULL)) &&
+            SUCCEEDED(m_pRateSupport->IsRateSupported(TRUE, speed, NULL))) {
+            isThinned = true;
+        }
+    }
+
+    HRESULT hr = m_pRate->SetRate(isThinned ? TRUE : FALSE, speed);
+    if (SUCCEEDED(hr)) m_isThinned = isThinned;
+    return hr;
 }
 
 HRESULT MyPlayer::GetVolume(float* pVol)
@@ -350,7 +592,29 @@ void MyPlayer::Shutdown()
     if (m_isShutdown) return;
     m_isShutdown = true;
     m_hnsDuration = -1;
+    StopSampleTrace();
     cancelAsyncLoad();
+    ShutdownPlaylistSources();
+
+    // closed out of m_streamMutex: a buffered ranges callback in progress takes it
+    wil::com_ptr<HttpByteStream> pHttpStream;
+    wil::com_ptr<HlsByteStream> pHlsStream;
+    wil::com_ptr<FileByteStream> pFileStream;
+    {
+        std::lock_guard<std::mutex> lock(m_streamMutex);
+        pHttpStream = std::move(m_pHttpStream);
+        pHlsStream = std::move(m_pHlsStream);
+        pFileStream = std::move(m_pFileStream);
+    }
+    if (pHttpStream) {
+        pHttpStream->SetChangeCallback(nullptr);
+        pHttpStream->Close(); // fails the reads the source is blocked in
+    }
+    if (pHlsStream) {
+        pHlsStream->SetChangeCallback(nullptr);
+        pHlsStream->Close();
+    }
+    if (pFileStream) pFileStream->Close();
 
     // NOTE: because m_pSession->BeginGetEvent(this) will keep *this,
     //       so we need to call m_pSession->Shutdown() first
@@ -362,8 +626,55 @@ void MyPlayer::Shutdown()
         m_pSession->Shutdown();
         m_pMediaSource->Shutdown();
         if (m_pVideoSinkActivate.get() != NULL) m_pVideoSinkActivate->ShutdownObject();
+        m_pGrabberCB.reset();
         if (m_pAudioRendererActivate.get() != NULL) m_pAudioRendererActivate->ShutdownObject();
     }
+    if (m_pReadback) m_pReadback->Detach(); // the renderer's texture callback holds it
+}
+
+bool MyPlayer::Reset()
+{
+    Shutdown();
+    std::unique_lock<std::mutex> guard(m_mutex);
+    if (m_cRef != 1) return false;
+
+    m_pSession.reset();
+    m_pMediaSource.reset();
+    m_pVideoSinkActivate.reset();
+    m_pGrabberCB.reset();
+    m_pReadback.reset();
+    m_hwndRenderer = NULL;
+    m_pKeyframeIndex.reset();
+    m_pAudioRendererActivate.reset();
+    m_pClock.reset();
+    m_pRate.reset();
+    m_pRateSupport.reset();
+    m_isThinned = false;
+    m_pSourceResolver.reset();
+    m_pSourceResolverCancelCookie.reset();
+    m_hnsDuration = -1;
+    m_metadata = MediaMetadata();
+    m_VideoWidth = m_VideoHeight = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_playlistMutex);
+        m_playlist.clear();
+        m_timeline.Reset(0);
+        m_playlistProbed = std::shared_future<void>();
+        m_queued.clear();
+        m_playlistIndex = 0;
+        m_preparingIndex = -1;
+        m_jumpIndex = -1;
+        m_isJumpPaused = false;
+        m_isWaitingNext = false;
+        m_isItemClockPending = false;
+        m_hnsItemClockStart = 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_playlistStats = PlaylistStats();
+    }
+    m_isShutdown = false;
+    return true;
 }
 
 void MyPlayer::cancelAsyncLoad() {
@@ -386,6 +697,8 @@ HRESULT MyPlayer::Invoke(IMFAsyncResult* pResult)
     HRESULT hr;
     wil::com_ptr<IMFMediaEvent> pEvent;
     MediaEventType meType = MEUnknown;
+    MediaEventType notifiedType = MEUnknown;
+    int changedIndex = -1;
 
     if (m_isShutdown || m_pSession == NULL) return E_FAIL;
     CHECK_HR(hr = m_pSession->EndGetEvent(pResult, &pEvent));
@@ -394,36 +707,437 @@ HRESULT MyPlayer::Invoke(IMFAsyncResult* pResult)
 
     //std::cout << "native player event: " << meType << std::endl;
     switch (meType) {
+    case MESessionTopologyStatus:
+        changedIndex = OnTopologyStatus(pEvent.get());
+        if (changedIndex >= 0) OnPlaylistItemChanged(changedIndex);
+        break;
+    case MESessionNotifyPresentationTime:
+        if (!m_playlist.empty()) {
+            std::lock_guard<std::mutex> lock(m_playlistMutex);
+            UINT64 hnsStart = 0;
+            if (m_isItemClockPending && SUCCEEDED(pEvent->GetUINT64(MF_EVENT_START_PRESENTATION_TIME, &hnsStart))) {
+                m_hnsItemClockStart = (LONGLONG)hnsStart;
+            }
+            m_isItemClockPending = false;
+        }
+        break;
+    case MESessionEnded:
+        if (OnPlaylistEnded()) break; // not the last item: playback goes on once the next one is ready
+        notifiedType = meType;
+        break;
     case MESessionStarted:
     case MEBufferingStarted:
     case MEBufferingStopped:
     case MESessionPaused:
     case MESessionStopped:
     case MESessionClosed:
-    case MESessionEnded:
     case MEError:
-        OnPlayerEvent(meType);
+        notifiedType = meType;
         break;
     }
 
 done:
+    // out of m_mutex: the subclass may seek (a native loop restarts at the end)
+    guard.unlock();
+    if (notifiedType != MEUnknown) OnPlayerEvent(notifiedType);
     return S_OK;
 }
 
 // --------------------------------------------------------------------------
+// Playlist
+//
+// The current item and the prepared next one are both given to the session: SetTopology()
+// without MFSESSION_SETTOPOLOGY_IMMEDIATE queues a topology, which the session starts right
+// at the end of the current one (MF_TOPOSTATUS_STARTED_SOURCE), with the same sinks.
 
-// Create a media source from a URL.
-HRESULT MyPlayer::CreateMediaSourceAsync(PCWSTR pszURL, std::function<void(IMFMediaSource* pSource)> callback)
+void MyPlayer::SetPlaylist(const std::vector<PlaylistItem>& items, LONGLONG prerollMs)
+{
+    std::lock_guard<std::mutex> lock(m_playlistMutex);
+    m_playlist = items;
+    m_hnsPreroll = prerollMs * 10000;
+    m_playlistIndex = 0;
+
+    // durations of the items not resolved yet, for the playlist duration and positions: given by
+    // the out points, else probed in background (the open waits for them, see OpenURL())
+    m_timeline.Reset(items.size());
+    bool isProbed = false;
+    for (size_t i = 0; i < items.size(); i++) {
+        if (items[i].hnsStop > 0) m_timeline.SetDuration((int)i, TrimmedDuration(items[i].hnsStart, items[i].hnsStop, -1));
+        else isProbed = true;
+    }
+    m_playlistProbed = isProbed ? ProbePlaylistAsync(items) : std::shared_future<void>();
+}
+
+// Reads the durations of the items without an out point on the worker pool. They are dropped
+// for the items replaced or resolved meanwhile.
+std::shared_future<void> MyPlayer::ProbePlaylistAsync(const std::vector<PlaylistItem>& items)
+{
+    wil::com_ptr<MyPlayer> self(this);
+    auto pProbed = std::make_shared<std::promise<void>>();
+    std::shared_future<void> probed = pProbed->get_future().share();
+
+    WorkerPool::Shared().Post([self, items, pProbed]() {
+        std::vector<LONGLONG> hnsDurations(items.size(), -1);
+        for (size_t i = 0; i < items.size(); i++) {
+            const PlaylistItem& item = items[i];
+            MediaMetadata metadata;
+            if (item.hnsStop > 0) continue;
+            if (MediaMetadataCache::Instance().Lookup(item.url, &metadata) || ProbeMediaFile(item.url, &metadata) != CONTAINER_UNKNOWN) {
+                hnsDurations[i] = TrimmedDuration(item.hnsStart, 0, metadata.durationMs * 10000);
+            }
+        }
+
+        MyPlayer* p = self.get();
+        {
+            std::lock_guard<std::mutex> lock(p->m_playlistMutex);
+            bool isChanged = false;
+            for (size_t i = 0; i < items.size() && i < p->m_playlist.size(); i++) {
+                const PlaylistItem& item = p->m_playlist[i];
+                if (item.url != items[i].url || item.hnsStart != items[i].hnsStart || item.hnsStop != items[i].hnsStop) break;
+                if (hnsDurations[i] < 0 || p->m_timeline.Duration((int)i) >= 0) continue;
+                p->m_timeline.SetDuration((int)i, hnsDurations[i]);
+                isChanged = true;
+            }
+            if (isChanged) p->m_hnsDuration = p->m_timeline.TotalDuration();
+        }
+        pProbed->set_value();
+        });
+    return probed;
+}
+
+int MyPlayer::GetPlaylistIndex()
+{
+    std::lock_guard<std::mutex> lock(m_playlistMutex);
+    return m_playlistIndex;
+}
+
+PlaylistStats MyPlayer::GetPlaylistStats()
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_playlistStats;
+}
+
+void MyPlayer::OnTransitionGap(double gapMs)
+{
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_playlistStats.lastGapMs = gapMs;
+    if (gapMs > m_playlistStats.maxGapMs) m_playlistStats.maxGapMs = gapMs;
+}
+
+void MyPlayer::ApplyTopologyInfo(const TopologyInfo& info)
+{
+    m_VideoWidth = info.videoWidth;
+    m_VideoHeight = info.videoHeight;
+    m_metadata = info.metadata;
+    m_hnsDuration = m_playlist.empty() ? info.hnsDuration : m_timeline.TotalDuration();
+}
+
+// Seek plan inside an item: its topology starts at the in point
+SeekPlan MyPlayer::PlanItemSeek(int index, const Mp4KeyframeIndex* pIndex, LONGLONG hnsOffset, SeekMode mode)
+{
+    const PlaylistItem& item = m_playlist[index];
+    LONGLONG hnsTarget = item.hnsStart + hnsOffset;
+    SeekPlan plan = { hnsTarget, hnsTarget };
+    if (pIndex != NULL) plan = pIndex->PlanSeek(hnsTarget, mode);
+
+    plan.hnsStart = ItemTime(plan.hnsStart, item.hnsStart);
+    if (plan.hnsSkipUntil >= 0) plan.hnsSkipUntil = ItemTime(plan.hnsSkipUntil, item.hnsStart);
+    return plan;
+}
+
+// Builds (or gets the cached) keyframe index of the source just opened on the worker pool. Until
+// it is ready, and for urls and non-MP4 files, the seeks go to the position asked and the source
+// finds the keyframe. Dropped if the player was reset or reopened meanwhile.
+void MyPlayer::BuildKeyframeIndexAsync(const std::filesystem::path& path)
+{
+    wil::com_ptr<MyPlayer> self(this);
+    wil::com_ptr<IMFMediaSource> pSource = m_pMediaSource;
+
+    WorkerPool::Shared().Post([self, pSource, path]() {
+        std::shared_ptr<const Mp4KeyframeIndex> pKeyframeIndex = Mp4KeyframeIndexCache::Get(path);
+        if (pKeyframeIndex == NULL) return;
+
+        MyPlayer* p = self.get();
+        std::lock_guard<std::mutex> guard(p->m_mutex);
+        if (p->m_isShutdown || p->m_pMediaSource != pSource) return;
+        if (p->m_playlist.empty()) {
+            p->m_pKeyframeIndex = pKeyframeIndex;
+            return;
+        }
+
+        // the first item of a playlist: also when it comes back on screen
+        std::lock_guard<std::mutex> lock(p->m_playlistMutex);
+        for (auto& item : p->m_queued) {
+            if (item.pSource != pSource) continue;
+            item.pKeyframeIndex = pKeyframeIndex;
+            if (&item == &p->m_queued.front()) p->m_pKeyframeIndex = pKeyframeIndex;
+        }
+        });
+}
+
+// Resolves the source of item 'index' and builds its topology, in background.
+// 'onPrepared' is called with m_playlistMutex held, unless a seek to another item happened meanwhile.
+HRESULT MyPlayer::PrepareItemAsync(int index, std::function<void(PreparedItem& item)> onPrepared)
+{
+    HRESULT hr = S_OK;
+    uint64_t generation = m_playlistGeneration;
+    auto startTime = std::chrono::steady_clock::now();
+    wil::com_ptr<MyPlayer> self(this);
+
+    m_preparingIndex = index;
+    hr = CreateMediaSourceAsync(m_playlist[index].url.c_str(), [self, index, generation, startTime, onPrepared](IMFMediaSource* pSource) -> void {
+        MyPlayer* p = self.get();
+        wil::com_ptr<IMFMediaSource> pMediaSource;
+        pMediaSource.attach(pSource);
+
+        // built outside of the lock, it reads the file
+        std::shared_ptr<const Mp4KeyframeIndex> pKeyframeIndex;
+        if (pMediaSource) pKeyframeIndex = Mp4KeyframeIndexCache::Get(p->m_playlist[index].url);
+
+        std::lock_guard<std::mutex> lock(p->m_playlistMutex);
+        if (p->m_isShutdown || generation != p->m_playlistGeneration) {
+            if (pMediaSource) pMediaSource->Shutdown();
+            return;
+        }
+        p->m_preparingIndex = -1;
+
+        HRESULT hr = E_FAIL;
+        PreparedItem item;
+        item.index = index;
+        item.pSource = pMediaSource;
+        item.pKeyframeIndex = pKeyframeIndex;
+        if (pMediaSource) {
+            hr = p->CreateTopology(pMediaSource.get(), p->m_pVideoSinkActivate.get(), &p->m_playlist[index], &item.pTopology, &item.info);
+            if (SUCCEEDED(hr)) hr = item.pTopology->GetTopologyID(&item.topologyId);
+        }
+        if (FAILED(hr)) {
+            std::cout << "[native] playlist item " << index << " can't be opened, playlist stopped: hr = " << hr << std::endl;
+            if (pMediaSource) pMediaSource->Shutdown();
+            if (p->m_jumpIndex == index) p->m_jumpIndex = -1;
+            return;
+        }
+
+        p->m_timeline.SetDuration(index, item.info.hnsDuration);
+        {
+            std::lock_guard<std::mutex> statsLock(p->m_statsMutex);
+            p->m_playlistStats.lastPrepareMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        }
+        onPrepared(item);
+        });
+    if (FAILED(hr)) m_preparingIndex = -1;
+    return hr;
+}
+
+// Prepares the next item once the current one is within the preroll window of its end
+void MyPlayer::SchedulePrepareNext()
+{
+    int next = m_playlistIndex + 1;
+    MFTIME hnsClock = 0;
+    LONGLONG hnsRemaining = m_timeline.Duration(m_playlistIndex);
+    LONGLONG delayMs = 0;
+    CAsyncCallback* cb = NULL;
+    uint64_t generation = m_playlistGeneration;
+    wil::com_ptr<MyPlayer> self(this);
+
+    if (m_isShutdown || m_pSession == NULL || next >= (int)m_playlist.size()) return;
+    if (m_preparingIndex >= 0 || m_prepareKey != 0 || m_jumpIndex >= 0) return;
+    for (auto& item : m_queued) {
+        if (item.index == next) return;
+    }
+
+    if (hnsRemaining >= 0 && m_pClock && SUCCEEDED(m_pClock->GetTime(&hnsClock)) && hnsClock > m_hnsItemClockStart) {
+        hnsRemaining -= hnsClock - m_hnsItemClockStart;
+    }
+    if (hnsRemaining >= 0 && !m_isWaitingNext) delayMs = (hnsRemaining - m_hnsPreroll) / 10000;
+    if (delayMs <= 0) {
+        PrepareItemAsync(next, [this](PreparedItem& item) { QueueItem(item); });
+        return;
+    }
+
+    // checked again when due: the item may have been paused or seeked meanwhile
+    cb = new CAsyncCallback([self, generation](IMFAsyncResult* pResult) -> HRESULT {
+        std::lock_guard<std::mutex> lock(self->m_playlistMutex);
+        if (generation != self->m_playlistGeneration) return S_OK;
+        self->m_prepareKey = 0;
+        self->SchedulePrepareNext();
+        return S_OK;
+        });
+    if (FAILED(MFScheduleWorkItem(cb, NULL, -delayMs, &m_prepareKey))) {
+        m_prepareKey = 0;
+        PrepareItemAsync(next, [this](PreparedItem& item) { QueueItem(item); });
+    }
+    cb->Release();
+}
+
+// Gives the prepared next item to the session
+void MyPlayer::QueueItem(PreparedItem& item)
+{
+    HRESULT hr = S_OK;
+    PROPVARIANT var;
+    PropVariantInit(&var);
+
+    if (!m_isWaitingNext) {
+        CHECK_HR(hr = m_pSession->SetTopology(0, item.pTopology.get()));
+    } else {
+        // too late, the session has ended: start the item now
+        m_isWaitingNext = false;
+        item.isClockReset = true;
+        {
+            std::lock_guard<std::mutex> statsLock(m_statsMutex);
+            m_playlistStats.lateTransitions++;
+        }
+        CHECK_HR(hr = m_pSession->SetTopology(MFSESSION_SETTOPOLOGY_IMMEDIATE, item.pTopology.get()));
+        var.vt = VT_I8;
+        var.hVal.QuadPart = 0;
+        CHECK_HR(hr = m_pSession->Start(NULL, &var));
+    }
+    m_queued.push_back(item);
+
+done:
+    if (FAILED(hr)) item.pSource->Shutdown();
+}
+
+// A seek to another item: its topology replaces the queued ones, and starts at 'hnsOffset'
+HRESULT MyPlayer::JumpToItem(int index, LONGLONG hnsOffset, SeekMode mode)
+{
+    m_playlistGeneration++;
+    if (m_prepareKey != 0) {
+        MFCancelWorkItem(m_prepareKey);
+        m_prepareKey = 0;
+    }
+    m_preparingIndex = -1;
+    m_jumpIndex = index;
+    m_hnsJumpOffset = hnsOffset;
+    m_isWaitingNext = false;
+
+    // (called by Seek() under m_mutex, the item is prepared out of it)
+    wil::com_ptr<SampleGrabberCB> pGrabberCB = m_pGrabberCB;
+    return PrepareItemAsync(index, [this, hnsOffset, mode, pGrabberCB](PreparedItem& item) {
+        HRESULT hr = S_OK;
+        PROPVARIANT var;
+        SeekPlan plan = PlanItemSeek(item.index, item.pKeyframeIndex.get(), hnsOffset, mode);
+        bool isQueued = false;
+
+        m_jumpIndex = -1;
+        item.isClockReset = true;
+        CHECK_HR(hr = m_pSession->SetTopology(MFSESSION_SETTOPOLOGY_IMMEDIATE, item.pTopology.get()));
+        m_queued.push_back(item);
+        isQueued = true;
+
+        if (pGrabberCB != NULL) pGrabberCB->SetSkipUntil(plan.hnsSkipUntil);
+        PropVariantInit(&var);
+        var.vt = VT_I8;
+        var.hVal.QuadPart = plan.hnsStart;
+        CHECK_HR(hr = m_pSession->Start(NULL, &var));
+        if (m_isJumpPaused) m_pSession->Pause();
+
+    done:
+        if (FAILED(hr) && !isQueued) item.pSource->Shutdown();
+        });
+}
+
+// Returns the index of the item which has just started, or -1
+int MyPlayer::OnTopologyStatus(IMFMediaEvent* pEvent)
+{
+    UINT32 status = 0;
+    PROPVARIANT var;
+    wil::com_ptr<IMFTopology> pTopology;
+    TOPOID topologyId = 0;
+    MFTIME hnsClock = 0;
+    bool isTransition = false;
+
+    if (m_playlist.empty()) return -1;
+    if (FAILED(pEvent->GetUINT32(MF_EVENT_TOPOLOGY_STATUS, &status)) || status != MF_TOPOSTATUS_STARTED_SOURCE) return -1;
+    PropVariantInit(&var);
+    if (SUCCEEDED(pEvent->GetValue(&var)) && var.vt == VT_UNKNOWN && var.punkVal != NULL) {
+        var.punkVal->QueryInterface(IID_PPV_ARGS(&pTopology));
+    }
+    PropVariantClear(&var);
+    if (!pTopology || FAILED(pTopology->GetTopologyID(&topologyId))) return -1;
+
+    std::lock_guard<std::mutex> lock(m_playlistMutex);
+    auto it = std::find_if(m_queued.begin(), m_queued.end(), [=](const PreparedItem& item) { return item.topologyId == topologyId; });
+    if (it == m_queued.end() || it == m_queued.begin()) return -1; // unknown, or already on screen (ex. restarted by a seek)
+
+    PreparedItem& item = *it;
+    isTransition = !item.isClockReset;
+    item.isClockReset = false;
+    m_playlistIndex = item.index;
+    m_pKeyframeIndex = item.pKeyframeIndex;
+    ApplyTopologyInfo(item.info);
+
+    // a started topology begins at its position 0, a queued one at the presentation time of the boundary
+    m_hnsItemClockStart = 0;
+    m_isItemClockPending = false;
+    if (isTransition) {
+        if (m_pClock && SUCCEEDED(m_pClock->GetTime(&hnsClock))) m_hnsItemClockStart = hnsClock;
+        m_isItemClockPending = true;
+        if (m_pGrabberCB != NULL) m_pGrabberCB->MarkTransition();
+        std::lock_guard<std::mutex> statsLock(m_statsMutex);
+        m_playlistStats.transitions++;
+    }
+
+    // the sources of the previous items are done
+    for (size_t n = it - m_queued.begin(); n > 0; n--) {
+        m_queued.front().pSource->Shutdown();
+        m_queued.pop_front();
+    }
+
+    SchedulePrepareNext();
+    return m_playlistIndex;
+}
+
+// MESessionEnded: returns true if the playlist goes on
+bool MyPlayer::OnPlaylistEnded()
+{
+    if (m_playlist.empty()) return false;
+    std::lock_guard<std::mutex> lock(m_playlistMutex);
+    if (m_jumpIndex >= 0) return true;
+    if (m_playlistIndex + 1 >= (int)m_playlist.size()) return false;
+
+    m_isWaitingNext = true;
+    for (auto it = m_queued.begin(); it != m_queued.end(); ++it) {
+        if (it->index != m_playlistIndex + 1) continue;
+        // queued, but not started by the session: start it
+        PreparedItem item = *it;
+        m_queued.erase(it);
+        QueueItem(item);
+        return true;
+    }
+    if (m_preparingIndex < 0 && m_prepareKey != 0) {
+        MFCancelWorkItem(m_prepareKey);
+        m_prepareKey = 0;
+    }
+    SchedulePrepareNext();
+    return true;
+}
+
+void MyPlayer::ShutdownPlaylistSources()
+{
+    std::lock_guard<std::mutex> lock(m_playlistMutex);
+    m_playlistGeneration++;
+    if (m_prepareKey != 0) {
+        MFCancelWorkItem(m_prepareKey);
+        m_prepareKey = 0;
+    }
+    for (auto& item : m_queued) item.pSource->Shutdown();
+    m_queued.clear();
+}
+
+// --------------------------------------------------------------------------
+
+// Create a media source from a URL, or from a byte stream.
+HRESULT MyPlayer::CreateMediaSourceAsync(PCWSTR pszURL, std::function<void(IMFMediaSource* pSource)> callback, IMFByteStream* pByteStream)
 {
     // Create the source resolver.
     HRESULT hr = S_OK;
     CAsyncCallback* cb = NULL;
-    CHECK_HR(hr = MFCreateSourceResolver(&m_pSourceResolver));
+    wil::com_ptr<IMFSourceResolver> pResolver;
+    bool isByteStream = pByteStream != NULL;
+    CHECK_HR(hr = MFCreateSourceResolver(&pResolver));
+    m_pSourceResolver = pResolver;
 
-    this->AddRef(); // prevent *this released before callback
-    hr = m_pSourceResolver->BeginCreateObjectFromURL(pszURL,
-        MF_RESOLUTION_MEDIASOURCE, NULL, &m_pSourceResolverCancelCookie,
-        cb = new CAsyncCallback([=](IMFAsyncResult* pResult) -> HRESULT {
+    cb = new CAsyncCallback([=](IMFAsyncResult* pResult) -> HRESULT {
             HRESULT hr;
             MF_OBJECT_TYPE ObjectType;
             wil::com_ptr<IUnknown> pSource;
@@ -435,8 +1149,15 @@ HRESULT MyPlayer::CreateMediaSourceAsync(PCWSTR pszURL, std::function<void(IMFMe
                 return E_FAIL; // *this* maybe already deleted, so don't access any *this members, and return immediately!
             }
 
-            if (m_pSourceResolver) { // m_pSourceResolver maybe null since Shutdown() called immediately after OpenURL()
-                CHECK_HR(hr = m_pSourceResolver->EndCreateObjectFromURL(pResult, &ObjectType, &pSource));
+            // m_pSourceResolver maybe null since Shutdown() called immediately after OpenURL(),
+            // or another source (next playlist item) is being resolved: end with the resolver that began
+            if (m_pSourceResolver) {
+                if (isByteStream) {
+                    CHECK_HR(hr = pResolver->EndCreateObjectFromByteStream(pResult, &ObjectType, &pSource));
+                }
+                else {
+                    CHECK_HR(hr = pResolver->EndCreateObjectFromURL(pResult, &ObjectType, &pSource));
+                }
                 CHECK_HR(hr = pSource->QueryInterface(IID_PPV_ARGS(&pMediaSource)));
             }
             else
@@ -453,8 +1174,19 @@ HRESULT MyPlayer::CreateMediaSourceAsync(PCWSTR pszURL, std::function<void(IMFMe
             //m_pSourceResolverCancelCookie.reset();
             if (FAILED(hr)) callback(NULL);
             return S_OK;
-            }),
-        NULL);
+            });
+
+    this->AddRef(); // prevent *this released before callback
+    if (isByteStream) {
+        hr = m_pSourceResolver->BeginCreateObjectFromByteStream(pByteStream, pszURL,
+            MF_RESOLUTION_MEDIASOURCE | MF_RESOLUTION_CONTENT_DOES_NOT_HAVE_TO_MATCH_EXTENSION_OR_MIME_TYPE,
+            NULL, &m_pSourceResolverCancelCookie, cb, NULL);
+    }
+    else {
+        hr = m_pSourceResolver->BeginCreateObjectFromURL(pszURL,
+            MF_RESOLUTION_MEDIASOURCE, NULL, &m_pSourceResolverCancelCookie, cb, NULL);
+    }
+    if (FAILED(hr)) this->Release();
     CHECK_HR(hr);
 
 done:
@@ -466,6 +1198,196 @@ done:
     return hr;
 }
 
+// Opens a network source through HttpByteStream (range requests, read-ahead, segment cache),
+// or an HLS playlist through HlsByteStream, on a thread since the first requests block.
+// Servers without range support, and playlists HlsStream can't play (encrypted media), are
+// left to the Media Foundation network source.
+HRESULT MyPlayer::OpenHttpStreamAsync(PCWSTR pszURL, std::function<void(IMFMediaSource* pSource)> callback)
+{
+    std::wstring url(pszURL);
+    this->AddRef(); // released by the thread
+    std::thread([this, url, callback]() {
+        HRESULT hrCom = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+        HRESULT hr = S_OK;
+        {
+            std::string u8url = std::filesystem::path(url).u8string();
+            wil::com_ptr<HttpByteStream> pStream;
+            wil::com_ptr<HlsByteStream> pHlsStream;
+            if (IsHlsUrl(u8url)) HlsByteStream::Create(u8url, &pHlsStream);
+            else HttpByteStream::Create(u8url, &pStream);
+
+            std::lock_guard<std::mutex> guard(m_mutex);
+            if (m_isShutdown) {
+                hr = E_ABORT;
+                if (pStream) pStream->Close();
+                if (pHlsStream) pHlsStream->Close();
+            }
+            else if (pHlsStream) {
+                pHlsStream->SetChangeCallback([this]() { OnBufferedRangesChanged(); });
+                {
+                    std::lock_guard<std::mutex> lock(m_streamMutex);
+                    m_pHlsStream = pHlsStream;
+                }
+                hr = CreateMediaSourceAsync(pHlsStream->FormatHint(), callback, pHlsStream.get());
+            }
+            else {
+                if (pStream) {
+                    pStream->SetChangeCallback([this]() { OnBufferedRangesChanged(); });
+                    std::lock_guard<std::mutex> lock(m_streamMutex);
+                    m_pHttpStream = pStream;
+                }
+                hr = CreateMediaSourceAsync(url.c_str(), callback, pStream.get());
+            }
+        }
+        if (FAILED(hr)) callback(NULL); // out of m_mutex: it may shut the player down
+        if (SUCCEEDED(hrCom)) CoUninitialize();
+        this->Release();
+        }).detach();
+    return S_OK;
+}
+
+bool MyPlayer::GetBufferedRanges(std::vector<std::pair<LONGLONG, LONGLONG>>* pRanges)
+{
+    pRanges->clear();
+    wil::com_ptr<HttpByteStream> pStream;
+    wil::com_ptr<HlsByteStream> pHlsStream;
+    {
+        std::lock_guard<std::mutex> lock(m_streamMutex);
+        pStream = m_pHttpStream;
+        pHlsStream = m_pHlsStream;
+    }
+    if (pHlsStream) {
+        for (auto& range : pHlsStream->BufferedRanges()) {
+            pRanges->push_back(std::make_pair((LONGLONG)(range.first * 1000 + 0.5), (LONGLONG)(range.second * 1000 + 0.5)));
+        }
+        return true;
+    }
+    LONGLONG durationMs = m_hnsDuration / 10000;
+    if (!pStream || durationMs <= 0 || pStream->ByteLength() == 0) return false;
+
+    double msPerByte = (double)durationMs / pStream->ByteLength();
+    for (auto& range : pStream->BufferedRanges()) {
+        pRanges->push_back(std::make_pair((LONGLONG)(range.first * msPerByte + 0.5), (LONGLONG)(range.second * msPerByte + 0.5)));
+    }
+    return true;
+}
+
+bool MyPlayer::GetHlsStats(HlsStats* pStats)
+{
+    wil::com_ptr<HlsByteStream> pStream;
+    {
+        std::lock_guard<std::mutex> lock(m_streamMutex);
+        pStream = m_pHlsStream;
+    }
+    if (!pStream) return false;
+    *pStats = pStream->GetStats();
+    return true;
+}
+
+bool MyPlayer::GetReadAheadStats(ReadAheadStats* pStats)
+{
+    wil::com_ptr<FileByteStream> pStream;
+    {
+        std::lock_guard<std::mutex> lock(m_streamMutex);
+        pStream = m_pFileStream;
+    }
+    if (!pStream) return false;
+    *pStats = pStream->GetStats();
+    return true;
+}
+
+bool MyPlayer::StartSampleTrace(const std::filesystem::path& path)
+{
+    std::shared_ptr<SampleTraceWriter> pTrace = SampleTraceWriter::Create(path);
+    if (!pTrace) return false;
+    StopSampleTrace();
+    std::atomic_store(&m_pSampleTrace, pTrace);
+    // the grabber of the next OpenURL() picks it up from m_pSampleTrace
+    wil::com_ptr<SampleGrabberCB> pGrabberCB = m_pGrabberCB;
+    if (pGrabberCB) pGrabberCB->SetSampleTrace(pTrace);
+    return true;
+}
+
+uint64_t MyPlayer::StopSampleTrace()
+{
+    std::shared_ptr<SampleTraceWriter> pTrace = std::atomic_exchange(&m_pSampleTrace, std::shared_ptr<SampleTraceWriter>());
+    if (!pTrace) return 0;
+    wil::com_ptr<SampleGrabberCB> pGrabberCB = m_pGrabberCB;
+    if (pGrabberCB) pGrabberCB->SetSampleTrace(NULL);
+    // a sample being traced on the grabber thread meanwhile is ignored
+    pTrace->Close();
+    return pTrace->RecordCount();
+}
+
+wil::com_ptr<IMFActivate> MyPlayer::GetRendererActivate()
+{
+    std::lock_guard<std::mutex> guard(m_mutex);
+    if (m_isShutdown || m_hwndRenderer == NULL) return NULL;
+    return m_pVideoSinkActivate;
+}
+
+bool MyPlayer::SetDropThreshold(float frames)
+{
+    wil::com_ptr<IMFActivate> pActivate = GetRendererActivate();
+    if (!pActivate) return false;
+    return SUCCEEDED(DX11VideoRendererSetDropThreshold(pActivate.get(), frames));
+}
+
+bool MyPlayer::GetSchedulerStats(DX11VideoRenderer::SchedulerStats* pStats)
+{
+    wil::com_ptr<IMFActivate> pActivate = GetRendererActivate();
+    if (!pActivate) return false;
+    return SUCCEEDED(DX11VideoRendererGetSchedulerStats(pActivate.get(), pStats));
+}
+
+bool MyPlayer::SetSampleQueueBounds(UINT32 minDepth, UINT32 maxDepth)
+{
+    wil::com_ptr<IMFActivate> pActivate = GetRendererActivate();
+    if (!pActivate) return false;
+    return SUCCEEDED(DX11VideoRendererSetSampleQueueBounds(pActivate.get(), minDepth, maxDepth));
+}
+
+bool MyPlayer::GetSampleQueueStats(DX11VideoRenderer::SampleQueueStats* pStats)
+{
+    wil::com_ptr<IMFActivate> pActivate = GetRendererActivate();
+    if (!pActivate) return false;
+    return SUCCEEDED(DX11VideoRendererGetSampleQueueStats(pActivate.get(), pStats));
+}
+
+bool MyPlayer::RefreshVideoSize()
+{
+    HRESULT hr = S_OK;
+    wil::com_ptr<IMFActivate> pSinkActivate = m_pVideoSinkActivate;
+    wil::com_ptr<IMFMediaSink> pSink;
+    wil::com_ptr<IMFStreamSink> pStreamSink;
+    wil::com_ptr<IMFMediaTypeHandler> pHandler;
+    wil::com_ptr<IMFMediaType> pType;
+    MFVideoArea area = {};
+    UINT32 width = 0, height = 0;
+
+    if (pSinkActivate == NULL) return false;
+    CHECK_HR(hr = pSinkActivate->ActivateObject(IID_PPV_ARGS(&pSink)));
+    CHECK_HR(hr = pSink->GetStreamSinkByIndex(0, &pStreamSink));
+    CHECK_HR(hr = pStreamSink->GetMediaTypeHandler(&pHandler));
+    CHECK_HR(hr = pHandler->GetCurrentMediaType(&pType));
+    CHECK_HR(hr = MFGetAttributeSize(pType.get(), MF_MT_FRAME_SIZE, &width, &height));
+    // the decoder output is aligned to the macroblocks, the aperture is the picture
+    if (SUCCEEDED(pType->GetBlob(MF_MT_MINIMUM_DISPLAY_APERTURE, (UINT8*)&area, sizeof(area), NULL)) &&
+        area.Area.cx > 0 && area.Area.cy > 0) {
+        width = (UINT32)area.Area.cx;
+        height = (UINT32)area.Area.cy;
+    }
+    if (width == 0 || height == 0) return false;
+    // without an aperture: the same size up to that alignment is the same picture
+    if (((width + 15) & ~15) == ((m_VideoWidth + 15) & ~15) && ((height + 15) & ~15) == ((m_VideoHeight + 15) & ~15)) return false;
+    m_VideoWidth = width;
+    m_VideoHeight = height;
+    return true;
+
+done:
+    return false;
+}
+
 
 // Add a source node to a topology.
 HRESULT AddSourceNode(
@@ -516,8 +1438,70 @@ done:
     return hr;
 }
 
-// Create the topology.
-HRESULT MyPlayer::CreateTopology(IMFMediaSource* pSource, IMFActivate* pSinkActivate, IMFTopology** ppTopo)
+// Collect duration, video size, frame rate, codecs and stream layout of the selected streams.
+static void ReadStreamMetadata(IMFPresentationDescriptor* pPD, MediaMetadata* pMetadata)
+{
+    DWORD cStreams = 0;
+    UINT64 hnsDuration = 0;
+
+    *pMetadata = MediaMetadata();
+    if (SUCCEEDED(pPD->GetUINT64(MF_PD_DURATION, &hnsDuration))) pMetadata->durationMs = (int64_t)(hnsDuration / 10000);
+    if (FAILED(pPD->GetStreamDescriptorCount(&cStreams))) return;
+
+    for (DWORD i = 0; i < cStreams; i++)
+    {
+        BOOL fSelected = FALSE;
+        GUID majorType, subType;
+        wil::com_ptr<IMFStreamDescriptor> pSD;
+        wil::com_ptr<IMFMediaTypeHandler> pHandler;
+        wil::com_ptr<IMFMediaType> pType;
+
+        if (FAILED(pPD->GetStreamDescriptorByIndex(i, &fSelected, &pSD)) || !fSelected) continue;
+        if (FAILED(pSD->GetMediaTypeHandler(&pHandler))) continue;
+        if (FAILED(pHandler->GetMajorType(&majorType))) continue;
+        if (FAILED(pHandler->GetCurrentMediaType(&pType))) continue;
+
+        // media subtypes are FOURCC (or WAVE_FORMAT tag) based GUIDs
+        bool hasSubType = SUCCEEDED(pType->GetGUID(MF_MT_SUBTYPE, &subType));
+
+        if (majorType == MFMediaType_Video)
+        {
+            if (pMetadata->videoStreams++ > 0) continue;
+            MFGetAttributeSize(pType.get(), MF_MT_FRAME_SIZE, &pMetadata->videoWidth, &pMetadata->videoHeight);
+            MFGetAttributeRatio(pType.get(), MF_MT_FRAME_RATE, &pMetadata->frameRateNumerator, &pMetadata->frameRateDenominator);
+            if (hasSubType) pMetadata->videoCodec = subType.Data1;
+        }
+        else if (majorType == MFMediaType_Audio)
+        {
+            if (pMetadata->audioStreams++ > 0) continue;
+            if (hasSubType) pMetadata->audioCodec = subType.Data1;
+        }
+    }
+}
+
+HRESULT MyPlayer::ReadMetadata(const WCHAR* pszURL, MediaMetadata* pMetadata)
+{
+    HRESULT hr = S_OK;
+    MF_OBJECT_TYPE ObjectType;
+    wil::com_ptr<IMFSourceResolver> pSourceResolver;
+    wil::com_ptr<IUnknown> pSource;
+    wil::com_ptr<IMFMediaSource> pMediaSource;
+    wil::com_ptr<IMFPresentationDescriptor> pPD;
+
+    CHECK_HR(hr = MFCreateSourceResolver(&pSourceResolver));
+    CHECK_HR(hr = pSourceResolver->CreateObjectFromURL(pszURL, MF_RESOLUTION_MEDIASOURCE, NULL, &ObjectType, &pSource));
+    CHECK_HR(hr = pSource->QueryInterface(IID_PPV_ARGS(&pMediaSource)));
+    CHECK_HR(hr = pMediaSource->CreatePresentationDescriptor(&pPD));
+    ReadStreamMetadata(pPD.get(), pMetadata);
+
+done:
+    if (pMediaSource) pMediaSource->Shutdown();
+    return hr;
+}
+
+// Create the topology, of the [hnsStart, hnsStop) part of the source for a playlist item.
+// The video / audio sinks are shared by all the topologies of a player (seamless playback).
+HRESULT MyPlayer::CreateTopology(IMFMediaSource* pSource, IMFActivate* pSinkActivate, const PlaylistItem* pItem, IMFTopology** ppTopo, TopologyInfo* pInfo)
 {
     wil::com_ptr<IMFTopology> pTopology;
     wil::com_ptr<IMFPresentationDescriptor> pPD;
@@ -527,12 +1511,15 @@ HRESULT MyPlayer::CreateTopology(IMFMediaSource* pSource, IMFActivate* pSinkActi
     wil::com_ptr<IMFTopologyNode> pNodeVideoSink; // video node
     wil::com_ptr<IMFTopologyNode> pNodeAudioSink; // audio node
     wil::com_ptr<IMFMediaType> pVideoMediaType;
+    wil::com_ptr<IMFCollection> pSourceNodes;
     bool isSourceAdded = false;
 
     HRESULT hr = S_OK;
     DWORD cStreams = 0;
+    DWORD cSourceNodes = 0;
+    UINT64 hnsFileDuration = 0;
 
-    m_VideoWidth = m_VideoHeight = 0;
+    *pInfo = TopologyInfo();
 
     CHECK_HR(hr = MFCreateTopology(&pTopology));
     CHECK_HR(hr = pSource->CreatePresentationDescriptor(&pPD));
@@ -563,7 +1550,7 @@ HRESULT MyPlayer::CreateTopology(IMFMediaSource* pSource, IMFActivate* pSinkActi
 
             // get video resolution
             CHECK_HR(hr = pHandler->GetCurrentMediaType(&pVideoMediaType));
-            MFGetAttributeSize(pVideoMediaType.get(), MF_MT_FRAME_SIZE, &m_VideoWidth, &m_VideoHeight);
+            MFGetAttributeSize(pVideoMediaType.get(), MF_MT_FRAME_SIZE, &pInfo->videoWidth, &pInfo->videoHeight);
         }
         else if (majorType == MFMediaType_Audio && fSelected)
         {
@@ -573,7 +1560,7 @@ HRESULT MyPlayer::CreateTopology(IMFMediaSource* pSource, IMFActivate* pSinkActi
                 CHECK_HR(hr = AddSourceNode(pTopology.get(), pSource, pPD.get(), pSD.get(), &pNodeSrc));
                 isSourceAdded = true;
             }
-            CHECK_HR(hr = MFCreateAudioRendererActivate(&m_pAudioRendererActivate));
+            if (m_pAudioRendererActivate == NULL) CHECK_HR(hr = MFCreateAudioRendererActivate(&m_pAudioRendererActivate));
             CHECK_HR(hr = AddOutputNode(pTopology.get(), m_pAudioRendererActivate.get(), 0, &pNodeAudioSink));
             CHECK_HR(hr = pNodeSrc->ConnectOutput(0, pNodeAudioSink.get(), 0));
 
@@ -595,7 +1582,27 @@ HRESULT MyPlayer::CreateTopology(IMFMediaSource* pSource, IMFActivate* pSinkActi
         }
     }
 
-    CHECK_HR(pPD->GetUINT64(MF_PD_DURATION, (UINT64*)&m_hnsDuration));
+    // none for a sequential stream (HLS)
+    if (FAILED(pPD->GetUINT64(MF_PD_DURATION, &hnsFileDuration))) hnsFileDuration = 0;
+    ReadStreamMetadata(pPD.get(), &pInfo->metadata);
+    pInfo->hnsDuration = (MFTIME)hnsFileDuration;
+
+    if (pItem != NULL && (pItem->hnsStart > 0 || pItem->hnsStop > 0)) {
+        CHECK_HR(hr = pTopology->GetSourceNodeCollection(&pSourceNodes));
+        CHECK_HR(hr = pSourceNodes->GetElementCount(&cSourceNodes));
+        for (DWORD i = 0; i < cSourceNodes; i++)
+        {
+            wil::com_ptr<IUnknown> pUnknown;
+            wil::com_ptr<IMFTopologyNode> pNode;
+            CHECK_HR(hr = pSourceNodes->GetElement(i, &pUnknown));
+            CHECK_HR(hr = pUnknown->QueryInterface(IID_PPV_ARGS(&pNode)));
+            CHECK_HR(hr = pNode->SetUINT64(MF_TOPONODE_MEDIASTART, (UINT64)pItem->hnsStart));
+            if (pItem->hnsStop > 0) CHECK_HR(hr = pNode->SetUINT64(MF_TOPONODE_MEDIASTOP, (UINT64)pItem->hnsStop));
+        }
+
+        MFTIME hnsStop = pItem->hnsStop > 0 && pItem->hnsStop < pInfo->hnsDuration ? pItem->hnsStop : pInfo->hnsDuration;
+        pInfo->hnsDuration = hnsStop > pItem->hnsStart ? hnsStop - pItem->hnsStart : 0;
+    }
 
     *ppTopo = pTopology.get();
     (*ppTopo)->AddRef();
@@ -652,26 +1659,35 @@ STDMETHODIMP_(ULONG) SampleGrabberCB::Release()
 
 STDMETHODIMP SampleGrabberCB::OnClockStart(MFTIME hnsSystemTime, LONGLONG llClockStartOffset)
 {
+    TraceEvent(TRACE_CLOCK_START, llClockStartOffset == PRESENTATION_CURRENT_POSITION ? -1 : llClockStartOffset);
+    m_isCadenceReset = true;
     return S_OK;
 }
 
 STDMETHODIMP SampleGrabberCB::OnClockStop(MFTIME hnsSystemTime)
 {
+    TraceEvent(TRACE_CLOCK_STOP);
+    m_isCadenceReset = true;
     return S_OK;
 }
 
 STDMETHODIMP SampleGrabberCB::OnClockPause(MFTIME hnsSystemTime)
 {
+    TraceEvent(TRACE_CLOCK_PAUSE);
+    m_isCadenceReset = true;
     return S_OK;
 }
 
 STDMETHODIMP SampleGrabberCB::OnClockRestart(MFTIME hnsSystemTime)
 {
+    TraceEvent(TRACE_CLOCK_RESTART);
+    m_isCadenceReset = true;
     return S_OK;
 }
 
 STDMETHODIMP SampleGrabberCB::OnClockSetRate(MFTIME hnsSystemTime, float flRate)
 {
+    TraceEvent(TRACE_CLOCK_RATE, (LONGLONG)llround(flRate * 1000000.0));
     return S_OK;
 }
 
@@ -686,7 +1702,23 @@ STDMETHODIMP SampleGrabberCB::OnProcessSample(REFGUID guidMajorMediaType, DWORD
     LONGLONG llSampleTime, LONGLONG llSampleDuration, const BYTE* pSampleBuffer,
     DWORD dwSampleSize)
 {
+    // traced as delivered, before the decode-skip
+    auto pTrace = std::atomic_load(&m_pTrace);
+    if (pTrace) {
+        pTrace->Sample(TRACE_SOURCE_GRABBER, llSampleTime, llSampleDuration, dwSampleSize,
+            guidMajorMediaType == MFMediaType_Audio ? TRACE_FLAG_AUDIO : 0);
+    }
+
     if (m_pUserCallback.get() == NULL) return S_OK;
+
+    // decode-skip after an accurate seek: the frames from the previous keyframe up to the target
+    LONGLONG hnsSkipUntil = m_hnsSkipUntil;
+    if (hnsSkipUntil >= 0 && guidMajorMediaType == MFMediaType_Video) {
+        if (llSampleTime + llSampleDuration <= hnsSkipUntil) return S_OK;
+        m_hnsSkipUntil = -1;
+    }
+    if (guidMajorMediaType == MFMediaType_Video) MeasureCadence();
+
     m_pUserCallback->OnProcessSample(guidMajorMediaType, dwSampleFlags,
         llSampleTime, llSampleDuration, pSampleBuffer,
         dwSampleSize);
@@ -696,5 +1728,44 @@ STDMETHODIMP SampleGrabberCB::OnProcessSample(REFGUID guidMajorMediaType, DWORD
 STDMETHODIMP SampleGrabberCB::OnShutdown()
 {
     m_pUserCallback.reset();
+    m_gapCallback = nullptr;
+    std::atomic_store(&m_pTrace, std::shared_ptr<SampleTraceWriter>());
     return S_OK;
 }
+
+void SampleGrabberCB::TraceEvent(SampleTraceEvent event, LONGLONG value)
+{
+    auto pTrace = std::atomic_load(&m_pTrace);
+    if (pTrace) pTrace->Event(TRACE_SOURCE_GRABBER, event, value);
+}
+
+// The gap of a transition is the longest interval between delivered frames around it, beyond
+// the usual (median) one: ~0 when the next item starts right on time.
+void SampleGrabberCB::MeasureCadence()
+{
+    LONGLONG hnsNow = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count() / 100;
+
+    if (m_isCadenceReset.exchange(false)) m_hnsLastFrameTime = 0;
+    if (m_hnsLastFrameTime != 0) {
+        m_hnsIntervals[m_intervalCount % CADENCE_INTERVALS] = hnsNow - m_hnsLastFrameTime;
+        m_intervalCount++;
+    }
+    m_hnsLastFrameTime = hnsNow;
+
+    // wait for a few frames after the transition, the ring then holds both sides of it
+    int after = m_framesAfterTransition;
+    if (after < 0) return;
+    if (after < CADENCE_INTERVALS / 2) {
+        m_framesAfterTransition.compare_exchange_strong(after, after + 1);
+        return;
+    }
+    if (!m_framesAfterTransition.compare_exchange_strong(after, -1)) return;
+
+    int count = std::min(m_intervalCount, CADENCE_INTERVALS);
+    if (!m_gapCallback) return;
+    int64_t sorted[CADENCE_INTERVALS];
+    std::copy(m_hnsIntervals, m_hnsIntervals + count, sorted);
+    double gapMs = TransitionGapMs(sorted, count);
+    if (gapMs >= 0) m_gapCallback(gapMs);
+}
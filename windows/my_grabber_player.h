@@ -4,17 +4,56 @@
 #include <mfidl.h>
 #include <mfapi.h>
 #include <audiopolicy.h>
+#include <deque>
 #include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include <wil/com.h>
 
+#include "mp4_keyframe_index.h"
+#include "media_metadata_cache.h"
+#include "http_byte_stream.h"
+#include "hls_byte_stream.h"
+#include "file_byte_stream.h"
+#include "memory_byte_stream.h"
+#include "sample_trace.h"
+#include "SchedulerCore.h"
+#include "SampleQueueDepth.h"
+#include "playlist_timeline.h"
+
+class SampleGrabberCB;
+class RendererReadback;
+
+// One entry of a playlist / edit list: a whole file, or its [hnsStart, hnsStop) part
+struct PlaylistItem
+{
+	std::wstring url;
+	LONGLONG hnsStart = 0;
+	LONGLONG hnsStop = 0; // 0: until the end of the file
+};
+
+struct PlaylistStats
+{
+	UINT32 transitions = 0;     // items started right at the end of the previous one
+	UINT32 lateTransitions = 0; // the next item was not prepared at the boundary, playback stopped meanwhile
+	double lastGapMs = 0;       // longest frame interval around the last transition, beyond the usual one
+	double maxGapMs = 0;
+	double lastPrepareMs = 0;   // source resolve + topology of the last prepared item
+};
+
 class MyPlayerCallback : public IUnknown
 {
 public:
 	virtual void OnProcessSample(REFGUID guidMajorMediaType, DWORD dwSampleFlags,
 		LONGLONG llSampleTime, LONGLONG llSampleDuration, const BYTE* pSampleBuffer,
 		DWORD dwSampleSize) = 0;
+	// A frame presented by the DX11 renderer (see MyPlayer::UseDX11Renderer()), B8G8R8A8 rows of
+	// 'pitch' bytes, called on the renderer's scheduler thread
+	virtual void OnRenderedFrame(const BYTE* pBgra, UINT32 width, UINT32 height, UINT32 pitch) {}
 };
 
 class MyPlayer : public IMFAsyncCallback
@@ -39,18 +78,67 @@ public:
 	HRESULT Play(LONGLONG ms = -1);
 	HRESULT Pause();
 	void Shutdown();
+	// Back to a new player after Shutdown(), for reuse (the audio volume interface is kept).
+	// Returns false while async work (source resolve, session callback) still holds the player.
+	bool Reset();
 
 	LONGLONG GetDuration();
 	LONGLONG GetCurrentPosition();
-	HRESULT Seek(LONGLONG ms);
+	HRESULT Seek(LONGLONG ms, SeekMode mode = SEEK_MODE_ACCURATE, LONGLONG* pActualMs = NULL);
 	SIZE GetVideoSize();
+	MediaMetadata GetMetadata() { return m_metadata; }
+	// Set before OpenURL(): the video goes to the DX11 renderer instead of the sample grabber, which
+	// paces, drops and presents the frames on its own clock, then to OnRenderedFrame(). 'hwnd' is a
+	// window of the process the renderer is attached to, nothing is drawn into it. NULL: sample grabber.
+	void UseDX11Renderer(HWND hwnd) { m_hwndRenderer = hwnd; }
+	// Of the DX11 renderer's scheduler: false with the sample grabber, or before OpenURL() created the sink
+	bool SetDropThreshold(float frames);
+	bool GetSchedulerStats(DX11VideoRenderer::SchedulerStats* pStats);
+	// Of the DX11 renderer's sample queue; the bounds are also false if not valid
+	bool SetSampleQueueBounds(UINT32 minDepth, UINT32 maxDepth);
+	bool GetSampleQueueStats(DX11VideoRenderer::SampleQueueStats* pStats);
+	// NULL if the source is not a local MP4 / MOV file (of the current item for a playlist)
+	std::shared_ptr<const Mp4KeyframeIndex> GetKeyframeIndex() { return m_pKeyframeIndex; }
 
-	HRESULT SetPlaybackSpeed(float fRate);
+	// Reads duration / size / codecs by resolving a media source only, without any session or topology.
+	static HRESULT ReadMetadata(const WCHAR* pszURL, MediaMetadata* pMetadata);
+
+	// Thinned (keyframes only) from 'thinningRate' on, or when the source can't deliver every
+	// frame that fast; 0 never thins
+	HRESULT SetPlaybackSpeed(float fRate, float thinningRate = 0);
+	bool IsThinned() { return m_isThinned; }
 
 	HRESULT GetVolume(float *pVol);
 	HRESULT SetVolume(float vol);
 	HRESULT SetMute(bool bMute);
 
+	// Gapless playlist, set before OpenURL() (which opens the first item). Each next item is
+	// resolved 'prerollMs' before the end of the current one, and queued on the same session
+	// and sinks, so it starts at the exact boundary. Positions and duration are then those of
+	// the whole playlist, and a seek to another item switches to it.
+	void SetPlaylist(const std::vector<PlaylistItem>& items, LONGLONG prerollMs);
+	bool HasPlaylist() { return !m_playlist.empty(); }
+	int GetPlaylistIndex();
+	PlaylistStats GetPlaylistStats();
+
+	// Parts of a network source already fetched (read-ahead, segment cache) as [start, end) ms,
+	// mapped linearly from the bytes (from the segment times for HLS). False if the source is
+	// not read by HttpByteStream / HlsByteStream.
+	bool GetBufferedRanges(std::vector<std::pair<LONGLONG, LONGLONG>>* pRanges);
+	// False if the source is not an HLS playlist
+	bool GetHlsStats(HlsStats* pStats);
+	// False if the source is not a local file read by FileByteStream
+	bool GetReadAheadStats(ReadAheadStats* pStats);
+	// Reads the frame size back from the media type the video sink was last given (an HLS
+	// variant switch changes it mid-stream). True if it changed.
+	bool RefreshVideoSize();
+
+	// Records the timing of the samples delivered to the sample grabber (and of the clock
+	// changes) into 'path', for tools/trace_replay; false if the file can't be created.
+	// Stopped by StopSampleTrace(), returning the count of records, or by Shutdown().
+	bool StartSampleTrace(const std::filesystem::path& path);
+	uint64_t StopSampleTrace();
+
 	MyPlayer();
 	virtual ~MyPlayer();
 
@@ -59,26 +147,101 @@ protected:
 	HRESULT GetParameters(DWORD* pdwFlags, DWORD* pdwQueue);
 	HRESULT Invoke(IMFAsyncResult* pResult);
 	virtual void OnPlayerEvent(MediaEventType event) {};
-	HRESULT CreateMediaSourceAsync(PCWSTR pszURL, std::function<void(IMFMediaSource* pSource)> callback);
+	virtual void OnPlaylistItemChanged(int index) {};
+	// More of a network source is buffered, called on a reader thread (must not take m_mutex)
+	virtual void OnBufferedRangesChanged() {};
+	// From the URL, or from 'pByteStream' (the URL is then a hint of the format)
+	HRESULT CreateMediaSourceAsync(PCWSTR pszURL, std::function<void(IMFMediaSource* pSource)> callback, IMFByteStream* pByteStream = NULL);
 
 	std::mutex m_mutex;
 	UINT32 m_VideoWidth;
 	UINT32 m_VideoHeight;
 
 private:
+	// What a topology changes on the player once it is on screen
+	struct TopologyInfo
+	{
+		UINT32 videoWidth = 0;
+		UINT32 videoHeight = 0;
+		MFTIME hnsDuration = 0; // of the item, trimmed
+		MediaMetadata metadata; // of the file
+	};
+
+	struct PreparedItem
+	{
+		int index = -1;
+		TOPOID topologyId = 0;
+		bool isClockReset = false; // started by Start(position) (seek to another item / late item), not queued
+		wil::com_ptr<IMFMediaSource> pSource;
+		wil::com_ptr<IMFTopology> pTopology;
+		std::shared_ptr<const Mp4KeyframeIndex> pKeyframeIndex;
+		TopologyInfo info;
+	};
+
 	HRESULT initAudioVolume();
-	HRESULT CreateTopology(IMFMediaSource* pSource, IMFActivate* pSinkActivate, IMFTopology** ppTopo);
+	HRESULT CreateTopology(IMFMediaSource* pSource, IMFActivate* pSinkActivate, const PlaylistItem* pItem, IMFTopology** ppTopo, TopologyInfo* pInfo);
+	void ApplyTopologyInfo(const TopologyInfo& info);
 	void cancelAsyncLoad();
+	HRESULT OpenHttpStreamAsync(PCWSTR pszURL, std::function<void(IMFMediaSource* pSource)> callback);
+	void BuildKeyframeIndexAsync(const std::filesystem::path& path);
+
+	// playlist, all called with m_playlistMutex held
+	std::shared_future<void> ProbePlaylistAsync(const std::vector<PlaylistItem>& items);
+	HRESULT PrepareItemAsync(int index, std::function<void(PreparedItem& item)> onPrepared);
+	void SchedulePrepareNext();
+	void QueueItem(PreparedItem& item);
+	HRESULT JumpToItem(int index, LONGLONG hnsOffset, SeekMode mode);
+	SeekPlan PlanItemSeek(int index, const Mp4KeyframeIndex* pIndex, LONGLONG hnsOffset, SeekMode mode);
+	int OnTopologyStatus(IMFMediaEvent* pEvent);
+	bool OnPlaylistEnded();
+	void ShutdownPlaylistSources();
+	void OnTransitionGap(double gapMs);
+	// NULL unless the video sink is the DX11 renderer (UseDX11Renderer())
+	wil::com_ptr<IMFActivate> GetRendererActivate();
 
 	wil::com_ptr<IMFMediaSession> m_pSession;
 	wil::com_ptr<IMFMediaSource> m_pMediaSource;
 	wil::com_ptr<IMFActivate> m_pVideoSinkActivate;
+	wil::com_ptr<SampleGrabberCB> m_pGrabberCB;
+	HWND m_hwndRenderer = NULL; // the DX11 renderer is used instead of the sample grabber if not NULL
+	std::shared_ptr<RendererReadback> m_pReadback; // NULL unless the DX11 renderer is used
+	std::shared_ptr<const Mp4KeyframeIndex> m_pKeyframeIndex; // NULL if not a local MP4 / MOV file, or not built yet
     wil::com_ptr<IMFActivate> m_pAudioRendererActivate;
 	wil::com_ptr<ISimpleAudioVolume> m_pSimpleAudioVolume;
 	wil::com_ptr<IMFPresentationClock> m_pClock;
 	wil::com_ptr<IMFRateControl> m_pRate;
+	wil::com_ptr<IMFRateSupport> m_pRateSupport;
 	wil::com_ptr<IMFSourceResolver> m_pSourceResolver;
 	wil::com_ptr<IUnknown> m_pSourceResolverCancelCookie;
 	MFTIME m_hnsDuration;
+	MediaMetadata m_metadata;
 	bool m_isShutdown;
+	bool m_isThinned;
+
+	std::mutex m_playlistMutex; // taken after m_mutex, never held while calling back the subclass
+	std::vector<PlaylistItem> m_playlist;
+	PlaylistTimeline m_timeline; // the durations of the items, -1 until known
+	std::shared_future<void> m_playlistProbed; // ready once the items without an out point are probed
+	std::deque<PreparedItem> m_queued; // topologies given to the session, the one on screen first
+	LONGLONG m_hnsPreroll;
+	int m_playlistIndex;
+	int m_preparingIndex; // -1 if none
+	int m_jumpIndex;      // item being switched to by a seek, -1 if none
+	LONGLONG m_hnsJumpOffset;
+	bool m_isJumpPaused;
+	bool m_isWaitingNext; // the session ended before the next item was ready
+	bool m_isItemClockPending; // the next MESessionNotifyPresentationTime gives m_hnsItemClockStart
+	LONGLONG m_hnsItemClockStart; // presentation time at which the current item started
+	uint64_t m_playlistGeneration; // bumped by a seek to another item: older preparations are discarded
+	MFWORKITEM_KEY m_prepareKey;
+
+	std::mutex m_statsMutex;
+	PlaylistStats m_playlistStats;
+
+	std::mutex m_streamMutex; // taken after m_mutex
+	wil::com_ptr<HttpByteStream> m_pHttpStream; // NULL unless a single network source read by range requests
+	wil::com_ptr<HlsByteStream> m_pHlsStream;   // NULL unless an HLS playlist
+	wil::com_ptr<FileByteStream> m_pFileStream; // NULL unless a single local file read ahead
+
+	std::shared_ptr<SampleTraceWriter> m_pSampleTrace; // atomic_load / atomic_store, NULL if not tracing
 };
@@ -0,0 +1,58 @@
+#include "playlist_timeline.h"
+
+#include <algorithm>
+
+int64_t TrimmedDuration(int64_t hnsIn, int64_t hnsOut, int64_t hnsFileDuration)
+{
+	if (hnsOut <= 0) hnsOut = hnsFileDuration;
+	if (hnsOut <= 0) return -1;
+	return hnsOut > hnsIn ? hnsOut - hnsIn : 0;
+}
+
+int64_t ItemTime(int64_t hnsFileTime, int64_t hnsIn)
+{
+	return hnsFileTime > hnsIn ? hnsFileTime - hnsIn : 0;
+}
+
+void PlaylistTimeline::Reset(size_t count)
+{
+	m_hnsDurations.assign(count, -1);
+}
+
+void PlaylistTimeline::SetDuration(int index, int64_t hnsDuration)
+{
+	m_hnsDurations[index] = hnsDuration;
+}
+
+int64_t PlaylistTimeline::ItemStart(int index) const
+{
+	int64_t hns = 0;
+	for (int i = 0; i < index; i++) {
+		if (m_hnsDurations[i] > 0) hns += m_hnsDurations[i];
+	}
+	return hns;
+}
+
+int PlaylistTimeline::Locate(int64_t hns, int64_t* phnsOffset) const
+{
+	int index = 0;
+	while (index + 1 < (int)m_hnsDurations.size() && hns >= ItemStart(index + 1)) index++;
+	int64_t hnsOffset = hns - ItemStart(index);
+	*phnsOffset = hnsOffset > 0 ? hnsOffset : 0;
+	return index;
+}
+
+int64_t PlaylistTimeline::Position(int index, int64_t hnsInItem) const
+{
+	int64_t hnsDuration = m_hnsDurations[index];
+	if (hnsInItem < 0) hnsInItem = 0;
+	if (hnsDuration >= 0 && hnsInItem > hnsDuration) hnsInItem = hnsDuration;
+	return ItemStart(index) + hnsInItem;
+}
+
+double TransitionGapMs(int64_t* phnsIntervals, int count)
+{
+	if (count < 3) return -1;
+	std::sort(phnsIntervals, phnsIntervals + count);
+	return (phnsIntervals[count - 1] - phnsIntervals[count / 2]) / 10000.0;
+}
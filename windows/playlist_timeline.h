@@ -0,0 +1,47 @@
+#pragma once
+
+// The timing of a playlist / edit list: the items play back to back, each one the [in, out)
+// part of its file. The duration of an item is unknown (-1) until its file is probed or
+// opened; such an item takes no time on the playlist meanwhile.
+//
+// Also the gap of a transition, from the intervals between the frames delivered around it.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The duration of an item played from 'hnsIn' to 'hnsOut' (0: to the end of the file), in a
+// file of 'hnsFileDuration' (<= 0 if unknown). -1 if unknown, 0 if the in point is past the out.
+int64_t TrimmedDuration(int64_t hnsIn, int64_t hnsOut, int64_t hnsFileDuration);
+
+// A time of the file as a time of the item starting at 'hnsIn', never before its start
+int64_t ItemTime(int64_t hnsFileTime, int64_t hnsIn);
+
+class PlaylistTimeline
+{
+public:
+	// 'count' items of unknown duration
+	void Reset(size_t count);
+	size_t Count() const { return m_hnsDurations.size(); }
+
+	void SetDuration(int index, int64_t hnsDuration);
+	int64_t Duration(int index) const { return m_hnsDurations[index]; }
+
+	// The start of item 'index' on the playlist; Count() for the end of the playlist
+	int64_t ItemStart(int index) const;
+	int64_t TotalDuration() const { return ItemStart((int)m_hnsDurations.size()); }
+
+	// The item at 'hns' on the playlist (the last one starting there, if some take no time),
+	// and the offset into it, >= 0
+	int Locate(int64_t hns, int64_t* phnsOffset) const;
+	// The playlist position of 'hnsInItem' into item 'index', within the item
+	int64_t Position(int index, int64_t hnsInItem) const;
+
+private:
+	std::vector<int64_t> m_hnsDurations; // -1 until known
+};
+
+// The gap of a transition: the longest frame interval around it, beyond the usual (median)
+// one, in ms. ~0 when the next item starts right on time; -1 with fewer than 3 intervals.
+// Sorts the intervals in place (no allocation, it runs on the sample thread).
+double TransitionGapMs(int64_t* phnsIntervals, int count);
@@ -0,0 +1,255 @@
+#include "range_reader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static const int FETCH_ATTEMPTS = 3;
+static const int RETRY_DELAY_MS = 1000;
+static const size_t EXTRA_MEMORY_SEGMENTS = 4; // behind the read position, for small seeks back
+
+RangeReader::RangeReader(const std::string& url, std::shared_ptr<HttpClient> client, SegmentCache* pCache, int64_t readAheadBytes)
+	: m_url(url), m_client(client), m_pCache(pCache), m_readAheadBytes(readAheadBytes > 0 ? readAheadBytes : 0)
+{
+	m_maxMemorySegments = (size_t)(m_readAheadBytes / SEGMENT_SIZE) + EXTRA_MEMORY_SEGMENTS;
+}
+
+RangeReader::~RangeReader()
+{
+	Close();
+}
+
+int64_t RangeReader::SegmentLength(int64_t index) const
+{
+	int64_t start = index * SEGMENT_SIZE;
+	return m_length - start < SEGMENT_SIZE ? m_length - start : SEGMENT_SIZE;
+}
+
+bool RangeReader::Open()
+{
+	bool isCacheEnabled = m_pCache != NULL && m_pCache->IsEnabled();
+	int64_t cachedLength = 0;
+	std::string cachedValidator;
+	bool isCached = isCacheEnabled && m_pCache->LoadResource(m_url, &cachedLength, &cachedValidator);
+
+	HttpResponse response;
+	bool isResponse = m_client->GetRange(m_url, 0, SEGMENT_SIZE, &response);
+	if (!isResponse && response.status == 0) {
+		// offline: the cached segments only
+		if (!isCached) return false;
+		m_length = cachedLength;
+		m_validator = cachedValidator;
+	}
+	else {
+		if (!isResponse || (response.status != 206 && response.status != 200) || response.totalLength <= 0) return false;
+		m_length = response.totalLength;
+		m_validator = response.validator;
+		if ((int64_t)response.body.size() != SegmentLength(0)) return false;
+		isCached = isCached && !m_validator.empty() && cachedLength == m_length && cachedValidator == m_validator;
+		if (isCacheEnabled) m_pCache->StoreResource(m_url, m_length, m_validator);
+	}
+
+	m_flags.assign((size_t)SegmentCount(), 0);
+	if (isCached) {
+		for (int64_t index : m_pCache->ListSegments(m_url)) {
+			if (index < SegmentCount()) m_flags[(size_t)index] |= SEGMENT_ON_DISK;
+		}
+	}
+	if (!response.body.empty()) {
+		bool isOnDisk = (m_flags[0] & SEGMENT_ON_DISK) ||
+			(isCacheEnabled && m_pCache->WriteSegment(m_url, 0, response.body.data(), response.body.size()));
+		std::lock_guard<std::mutex> lock(m_mutex);
+		StoreLocked(0, std::make_shared<std::vector<uint8_t>>(std::move(response.body)), isOnDisk);
+	}
+
+	if (m_readAheadBytes > 0) m_thread = std::thread(&RangeReader::ReadAheadThread, this);
+	return true;
+}
+
+void RangeReader::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isClosed = true;
+	}
+	m_cv.notify_all();
+	if (m_thread.joinable()) m_thread.join();
+}
+
+int64_t RangeReader::Read(int64_t offset, uint8_t* pDst, int64_t size)
+{
+	if (offset < 0 || size < 0) return -1;
+	{
+		// moves the read-ahead right away on a seek
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_readPosition = offset;
+	}
+	m_cv.notify_all();
+
+	int64_t done = 0;
+	while (done < size && offset + done < m_length) {
+		int64_t position = offset + done;
+		int64_t index = position / SEGMENT_SIZE;
+		Segment segment = GetSegment(index);
+		if (segment == NULL) return done > 0 ? done : -1;
+
+		int64_t inSegment = position - index * SEGMENT_SIZE;
+		int64_t count = std::min(size - done, (int64_t)segment->size() - inSegment);
+		memcpy(pDst + done, segment->data() + inSegment, (size_t)count);
+		done += count;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_readPosition = offset + done;
+	}
+	m_cv.notify_all();
+	return done;
+}
+
+RangeReader::Segment RangeReader::GetSegment(int64_t index)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;) {
+		if (m_isClosed) return NULL;
+
+		auto it = m_memory.find(index);
+		if (it != m_memory.end()) {
+			m_lru.splice(m_lru.begin(), m_lru, it->second.second);
+			return it->second.first;
+		}
+		uint8_t flags = m_flags[(size_t)index];
+		if (flags & SEGMENT_FETCHING) {
+			m_cv.wait(lock);
+			continue;
+		}
+
+		m_flags[(size_t)index] |= SEGMENT_FETCHING;
+		lock.unlock();
+
+		auto data = std::make_shared<std::vector<uint8_t>>();
+		bool isOnDisk = (flags & SEGMENT_ON_DISK) && m_pCache->ReadSegment(m_url, index, data.get()) &&
+			(int64_t)data->size() == SegmentLength(index);
+		// evicted from the disk since Open(): back to the network
+		bool isAvailable = isOnDisk || Fetch(index, data.get());
+		if (isAvailable && !isOnDisk && m_pCache != NULL) isOnDisk = m_pCache->WriteSegment(m_url, index, data->data(), data->size());
+
+		lock.lock();
+		if (!isAvailable) {
+			m_flags[(size_t)index] = 0;
+			m_cv.notify_all();
+			return NULL;
+		}
+		StoreLocked(index, data, isOnDisk);
+		lock.unlock();
+		m_cv.notify_all();
+		if (!(flags & SEGMENT_ON_DISK)) NotifyChanged();
+		return data;
+	}
+}
+
+bool RangeReader::Fetch(int64_t index, std::vector<uint8_t>* pData)
+{
+	int64_t length = SegmentLength(index);
+	for (int attempt = 0; attempt < FETCH_ATTEMPTS; attempt++) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_isClosed) return false;
+		}
+
+		HttpResponse response;
+		if (m_client->GetRange(m_url, index * SEGMENT_SIZE, length, &response)) {
+			// another version of the resource (changed while playing) can't be mixed with this one
+			if (!m_validator.empty() && !response.validator.empty() && response.validator != m_validator) return false;
+			bool isRange = response.status == 206 || (response.status == 200 && index == 0);
+			if (isRange && (int64_t)response.body.size() == length) {
+				*pData = std::move(response.body);
+				return true;
+			}
+			if (response.status >= 400 && response.status < 500) return false;
+		}
+	}
+	return false;
+}
+
+void RangeReader::StoreLocked(int64_t index, Segment segment, bool isOnDisk)
+{
+	m_flags[(size_t)index] = SEGMENT_IN_MEMORY | (isOnDisk ? SEGMENT_ON_DISK : 0);
+	m_lru.push_front(index);
+	m_memory[index] = std::make_pair(segment, m_lru.begin());
+
+	while (m_memory.size() > m_maxMemorySegments) {
+		int64_t victim = m_lru.back();
+		m_lru.pop_back();
+		m_memory.erase(victim);
+		m_flags[(size_t)victim] &= ~SEGMENT_IN_MEMORY;
+	}
+}
+
+void RangeReader::ReadAheadThread()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_isClosed) {
+		// the first segment missing in the window past the read position
+		int64_t first = m_readPosition / SEGMENT_SIZE;
+		int64_t last = std::min(SegmentCount() - 1, (m_readPosition + m_readAheadBytes - 1) / SEGMENT_SIZE);
+		int64_t index = -1;
+		for (int64_t i = first; i <= last; i++) {
+			if (m_flags[(size_t)i] == 0) {
+				index = i;
+				break;
+			}
+		}
+		if (index < 0) {
+			m_cv.wait(lock);
+			continue;
+		}
+
+		m_flags[(size_t)index] = SEGMENT_FETCHING;
+		lock.unlock();
+		auto data = std::make_shared<std::vector<uint8_t>>();
+		bool isAvailable = Fetch(index, data.get());
+		bool isOnDisk = isAvailable && m_pCache != NULL && m_pCache->WriteSegment(m_url, index, data->data(), data->size());
+		lock.lock();
+
+		if (isAvailable) {
+			StoreLocked(index, data, isOnDisk);
+			lock.unlock();
+			m_cv.notify_all();
+			NotifyChanged();
+			lock.lock();
+		}
+		else {
+			m_flags[(size_t)index] = 0;
+			m_cv.notify_all();
+			// network down: a reader retries by itself, the read-ahead backs off
+			m_cv.wait_for(lock, std::chrono::milliseconds(RETRY_DELAY_MS));
+		}
+	}
+}
+
+std::vector<std::pair<int64_t, int64_t>> RangeReader::BufferedRanges()
+{
+	std::vector<std::pair<int64_t, int64_t>> ranges;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t i = 0; i < m_flags.size(); i++) {
+		if (!(m_flags[i] & (SEGMENT_IN_MEMORY | SEGMENT_ON_DISK))) continue;
+		int64_t start = (int64_t)i * SEGMENT_SIZE;
+		int64_t end = start + SegmentLength((int64_t)i);
+		if (!ranges.empty() && ranges.back().second == start) ranges.back().second = end;
+		else ranges.push_back(std::make_pair(start, end));
+	}
+	return ranges;
+}
+
+void RangeReader::SetChangeCallback(std::function<void()> callback)
+{
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	m_changeCallback = callback;
+}
+
+void RangeReader::NotifyChanged()
+{
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	if (m_changeCallback) m_changeCallback();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+// Random access to a network resource, by HTTP range requests of fixed-size segments.
+//
+// A thread keeps 'readAheadBytes' past the last read fetched; a read of a segment not
+// there yet (a seek) fetches it right away, ahead of the read-ahead. Fetched segments are
+// kept in memory (the read-ahead window and a few more, least recently used dropped) and
+// written to the segment cache, which then serves them to later opens of the same version
+// of the resource, also offline.
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "http_client.h"
+#include "segment_cache.h"
+
+class RangeReader
+{
+public:
+	static const int64_t SEGMENT_SIZE = 1024 * 1024;
+
+	// 'pCache' may be NULL
+	RangeReader(const std::string& url, std::shared_ptr<HttpClient> client, SegmentCache* pCache, int64_t readAheadBytes);
+	~RangeReader();
+
+	// Fetches the first segment, which gives the length and version of the resource. Fails
+	// for a server without range support, unless the whole resource fits in one segment,
+	// and for a resource of unknown length (live streams).
+	bool Open();
+	int64_t Length() const { return m_length; }
+
+	// Blocks until the bytes are there; returns the count read (short at the end only),
+	// -1 on a network failure or once closed
+	int64_t Read(int64_t offset, uint8_t* pDst, int64_t size);
+
+	// Stops the read-ahead and fails the pending reads
+	void Close();
+
+	// Byte ranges [start, end) in memory or on disk, sorted and coalesced
+	std::vector<std::pair<int64_t, int64_t>> BufferedRanges();
+	// Called on a reader thread each time a segment becomes available
+	void SetChangeCallback(std::function<void()> callback);
+
+private:
+	enum SegmentFlag : uint8_t
+	{
+		SEGMENT_FETCHING = 1,
+		SEGMENT_IN_MEMORY = 2,
+		SEGMENT_ON_DISK = 4,
+	};
+	typedef std::shared_ptr<const std::vector<uint8_t>> Segment;
+
+	int64_t SegmentCount() const { return (m_length + SEGMENT_SIZE - 1) / SEGMENT_SIZE; }
+	int64_t SegmentLength(int64_t index) const;
+	Segment GetSegment(int64_t index);
+	bool Fetch(int64_t index, std::vector<uint8_t>* pData);
+	// Called with m_mutex held
+	void StoreLocked(int64_t index, Segment segment, bool isOnDisk);
+	void ReadAheadThread();
+	void NotifyChanged();
+
+	const std::string m_url;
+	const std::shared_ptr<HttpClient> m_client;
+	SegmentCache* const m_pCache;
+	const int64_t m_readAheadBytes;
+	int64_t m_length = 0;
+	std::string m_validator;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv; // segment state changes, read position moves, close
+	std::vector<uint8_t> m_flags; // SegmentFlag per segment
+	std::map<int64_t, std::pair<Segment, std::list<int64_t>::iterator>> m_memory;
+	std::list<int64_t> m_lru; // most recently used first
+	size_t m_maxMemorySegments;
+	int64_t m_readPosition = 0;
+	bool m_isClosed = false;
+	std::thread m_thread;
+
+	std::mutex m_callbackMutex;
+	std::function<void()> m_changeCallback;
+};
@@ -0,0 +1,188 @@
+#include "read_ahead_reader.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+static int64_t NowUs()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint8_t* AllocAligned(size_t size, size_t alignment)
+{
+#ifdef _WIN32
+	return (uint8_t*)_aligned_malloc(size, alignment);
+#else
+	void* p = NULL;
+	return posix_memalign(&p, alignment, size) == 0 ? (uint8_t*)p : NULL;
+#endif
+}
+
+static void FreeAligned(uint8_t* p)
+{
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
+
+ReadAheadReader::ReadAheadReader(std::unique_ptr<LocalFile> file, const ReadAheadOptions& options) :
+	m_file(std::move(file)), m_options(options), m_length(m_file->Size())
+{
+}
+
+ReadAheadReader::~ReadAheadReader()
+{
+	Close();
+	for (auto& buffer : m_ring) {
+		if (buffer.pData != NULL) FreeAligned(buffer.pData);
+	}
+}
+
+bool ReadAheadReader::Open()
+{
+	if (m_options.useMemoryMap) m_pMapped = m_file->Map();
+	m_stats.isMapped = m_pMapped != NULL;
+	if (m_pMapped != NULL) return true;
+
+	int64_t count = m_options.readAheadBytes / BLOCK_SIZE;
+	if (count < 2) count = 2;
+	if (count > BlockCount()) count = BlockCount() > 2 ? BlockCount() : 2; // a small file needs no more
+	m_ring.resize((size_t)count);
+	for (auto& buffer : m_ring) {
+		buffer.pData = AllocAligned((size_t)BLOCK_SIZE, BLOCK_ALIGNMENT);
+		if (buffer.pData == NULL) return false;
+	}
+	m_thread = std::thread(&ReadAheadReader::IoThread, this);
+	return true;
+}
+
+void ReadAheadReader::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_isClosed) return;
+		m_isClosed = true;
+	}
+	m_cv.notify_all();
+	if (m_thread.joinable()) m_thread.join();
+}
+
+void ReadAheadReader::RecordReadLocked(int64_t offset, int64_t read, int64_t stallUs)
+{
+	m_stats.reads++;
+	if (read > 0) m_stats.bytesRead += read;
+	if (offset != m_lastReadEnd) m_stats.seeks++;
+	m_lastReadEnd = offset + (read > 0 ? read : 0);
+	if (stallUs > 0) {
+		double stallMs = stallUs / 1000.0;
+		m_stats.stalls++;
+		m_stats.stallMs += stallMs;
+		if (stallMs > m_stats.maxStallMs) m_stats.maxStallMs = stallMs;
+	}
+}
+
+int64_t ReadAheadReader::Read(int64_t offset, uint8_t* pDst, int64_t size)
+{
+	if (offset < 0) return -1;
+	if (offset >= m_length || size <= 0) return 0;
+	if (size > m_length - offset) size = m_length - offset;
+
+	if (m_pMapped != NULL) {
+		int64_t startUs = NowUs();
+		memcpy(pDst, m_pMapped + offset, (size_t)size);
+		int64_t elapsedUs = NowUs() - startUs;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_isClosed) return -1;
+		RecordReadLocked(offset, size, elapsedUs > MAPPED_STALL_US ? elapsedUs : 0);
+		return size;
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	int64_t done = 0;
+	int64_t waitStartUs = 0;
+	int64_t stallUs = 0;
+	while (done < size) {
+		if (m_isClosed) return -1;
+
+		int64_t position = offset + done;
+		int64_t block = position / BLOCK_SIZE;
+		if (block != m_readBlock) {
+			// the window moves: the I/O thread refills the buffers left behind
+			m_readBlock = block;
+			m_cv.notify_all();
+		}
+
+		Buffer& buffer = BufferOf(block);
+		if (buffer.block == block && buffer.state == BLOCK_FAILED) {
+			// read again by the next read of it (a network share back online)
+			buffer.block = -1;
+			buffer.state = BLOCK_EMPTY;
+			RecordReadLocked(offset, -1, stallUs);
+			return -1;
+		}
+		if (buffer.block != block || buffer.state != BLOCK_READY) {
+			if (waitStartUs == 0) waitStartUs = NowUs();
+			m_cv.wait(lock);
+			continue;
+		}
+		if (waitStartUs != 0) {
+			stallUs += NowUs() - waitStartUs;
+			waitStartUs = 0;
+		}
+
+		int64_t inBlock = position - block * BLOCK_SIZE;
+		int64_t count = buffer.length - inBlock;
+		if (count > size - done) count = size - done;
+		if (count <= 0) break; // a short block: the file shrank
+		memcpy(pDst + done, buffer.pData + inBlock, (size_t)count);
+		done += count;
+	}
+	RecordReadLocked(offset, done, stallUs);
+	return done;
+}
+
+void ReadAheadReader::IoThread()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_isClosed) {
+		// the first block of the window not held yet, the read block first
+		int64_t block = -1;
+		int64_t end = m_readBlock + (int64_t)m_ring.size();
+		if (end > BlockCount()) end = BlockCount();
+		for (int64_t i = m_readBlock; i < end; i++) {
+			Buffer& buffer = BufferOf(i);
+			if (buffer.block != i) {
+				block = i;
+				break;
+			}
+		}
+		if (block < 0) {
+			m_cv.wait(lock);
+			continue;
+		}
+
+		// the buffer holds a block behind the read position (or none): no read copies from it
+		Buffer& buffer = BufferOf(block);
+		buffer.block = block;
+		buffer.state = BLOCK_LOADING;
+		lock.unlock();
+		int64_t length = BLOCK_SIZE;
+		if (length > m_length - block * BLOCK_SIZE) length = m_length - block * BLOCK_SIZE;
+		int64_t read = m_file->ReadAt(block * BLOCK_SIZE, buffer.pData, length);
+		lock.lock();
+
+		buffer.length = read > 0 ? read : 0;
+		buffer.state = read >= 0 ? BLOCK_READY : BLOCK_FAILED;
+		if (read > 0) m_stats.ioBytes += read;
+		m_cv.notify_all();
+	}
+}
+
+ReadAheadStats ReadAheadReader::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+// Reads of a local file served from a sequential read-ahead, for drives where the small
+// synchronous reads of the media source stall (hard disks, network shares).
+//
+// An I/O thread reads large blocks into a ring of aligned buffers, keeping the blocks from
+// the last read position up to the size of the ring; a read of a block not there yet (the
+// start, a seek, a drive slower than the bitrate) waits for it, which counts as a stall.
+// In memory-mapped mode (SSDs) reads copy from the mapping instead, and the page cache
+// does the read-ahead.
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "local_file.h"
+
+struct ReadAheadOptions
+{
+	int64_t readAheadBytes = 16 * 1024 * 1024; // ring size, at least two blocks
+	bool useMemoryMap = false;
+};
+
+struct ReadAheadStats
+{
+	int64_t reads = 0;
+	int64_t bytesRead = 0;
+	int64_t seeks = 0;        // reads not following the previous one
+	int64_t stalls = 0;       // reads which waited for the drive
+	double stallMs = 0;       // their total wait
+	double maxStallMs = 0;
+	int64_t ioBytes = 0;      // read from the drive (mapped mode: 0, the page cache reads)
+	bool isMapped = false;
+};
+
+class ReadAheadReader
+{
+public:
+	static const int64_t BLOCK_SIZE = 512 * 1024;
+	static const size_t BLOCK_ALIGNMENT = 4096; // sector / page size, for the drive to DMA into place
+	// a mapped read longer than this is counted as a stall (page faults to the drive)
+	static const int64_t MAPPED_STALL_US = 2000;
+
+	ReadAheadReader(std::unique_ptr<LocalFile> file, const ReadAheadOptions& options);
+	~ReadAheadReader();
+
+	// Maps the file in memory-mapped mode (falls back to the read-ahead if it can't be),
+	// else starts the I/O thread. False if the buffers can't be allocated.
+	bool Open();
+	int64_t Length() const { return m_length; }
+
+	// Blocks until the bytes are there; returns the count read (short at the end only),
+	// -1 on a read failure or once closed
+	int64_t Read(int64_t offset, uint8_t* pDst, int64_t size);
+
+	// Stops the I/O thread and fails the pending reads
+	void Close();
+
+	ReadAheadStats GetStats();
+
+private:
+	enum BlockState { BLOCK_EMPTY, BLOCK_LOADING, BLOCK_READY, BLOCK_FAILED };
+
+	struct Buffer
+	{
+		uint8_t* pData = NULL; // BLOCK_SIZE, aligned
+		int64_t block = -1;    // held, or being loaded
+		int64_t length = 0;
+		BlockState state = BLOCK_EMPTY;
+	};
+
+	int64_t BlockCount() const { return (m_length + BLOCK_SIZE - 1) / BLOCK_SIZE; }
+	Buffer& BufferOf(int64_t block) { return m_ring[(size_t)(block % (int64_t)m_ring.size())]; }
+	void IoThread();
+	// Called with m_mutex held
+	void RecordReadLocked(int64_t offset, int64_t read, int64_t stallUs);
+
+	const std::unique_ptr<LocalFile> m_file;
+	const ReadAheadOptions m_options;
+	const int64_t m_length;
+	const uint8_t* m_pMapped = NULL;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv; // buffer states, read position moves, close
+	std::vector<Buffer> m_ring;
+	int64_t m_readBlock = 0; // of the last read: the ring holds [m_readBlock, m_readBlock + ring size)
+	int64_t m_lastReadEnd = 0;
+	bool m_isClosed = false;
+	ReadAheadStats m_stats;
+	std::thread m_thread;
+};
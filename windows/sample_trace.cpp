@@ -0,0 +1,119 @@
+#include "sample_trace.h"
+
+#include <cstring>
+
+static const char TRACE_MAGIC[8] = { 'V', 'P', 'W', 'T', 'R', 'A', 'C', 'E' };
+
+struct SampleTraceHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t recordSize;
+};
+
+static_assert(sizeof(SampleTraceHeader) == 16, "the header size is part of the file format");
+
+static FILE* OpenFile(const std::filesystem::path& path, bool isWrite)
+{
+	FILE* fp = NULL;
+#ifdef _WIN32
+	if (_wfopen_s(&fp, path.c_str(), isWrite ? L"wb" : L"rb") != 0) fp = NULL;
+#else
+	fp = fopen(path.c_str(), isWrite ? "wb" : "rb");
+#endif
+	return fp;
+}
+
+std::shared_ptr<SampleTraceWriter> SampleTraceWriter::Create(const std::filesystem::path& path)
+{
+	std::shared_ptr<SampleTraceWriter> writer(new SampleTraceWriter());
+	writer->m_fp = OpenFile(path, true);
+	if (writer->m_fp == NULL) return NULL;
+
+	SampleTraceHeader header;
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = VERSION;
+	header.recordSize = sizeof(SampleTraceRecord);
+	if (fwrite(&header, sizeof(header), 1, writer->m_fp) != 1) return NULL;
+
+	writer->m_start = std::chrono::steady_clock::now();
+	writer->m_buffer.reserve(BUFFER_RECORDS);
+	return writer;
+}
+
+void SampleTraceWriter::Sample(SampleTraceSource source, int64_t hnsTime, int64_t hnsDuration, uint32_t size, uint16_t flags)
+{
+	SampleTraceRecord record;
+	record.hnsTime = hnsTime;
+	record.hnsDuration = hnsDuration;
+	record.size = size;
+	record.flags = flags;
+	record.event = TRACE_SAMPLE;
+	record.source = source;
+	Append(record);
+}
+
+void SampleTraceWriter::Event(SampleTraceSource source, SampleTraceEvent event, int64_t value)
+{
+	SampleTraceRecord record;
+	record.hnsTime = value;
+	record.event = event;
+	record.source = source;
+	Append(record);
+}
+
+void SampleTraceWriter::Append(const SampleTraceRecord& record)
+{
+	auto now = std::chrono::steady_clock::now();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_fp == NULL) return;
+
+	m_buffer.push_back(record);
+	m_buffer.back().hnsArrival = std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_start).count() / 100;
+	m_count++;
+	if (m_buffer.size() >= BUFFER_RECORDS) WriteBufferLocked();
+}
+
+void SampleTraceWriter::WriteBufferLocked()
+{
+	if (!m_buffer.empty() && fwrite(m_buffer.data(), sizeof(SampleTraceRecord), m_buffer.size(), m_fp) != m_buffer.size()) {
+		// disk full: the trace ends there
+		fclose(m_fp);
+		m_fp = NULL;
+	}
+	m_buffer.clear();
+}
+
+void SampleTraceWriter::Close()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_fp == NULL) return;
+	WriteBufferLocked();
+	if (m_fp != NULL) fclose(m_fp);
+	m_fp = NULL;
+}
+
+uint64_t SampleTraceWriter::RecordCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_count;
+}
+
+bool ReadSampleTrace(const std::filesystem::path& path, std::vector<SampleTraceRecord>* pRecords)
+{
+	pRecords->clear();
+	FILE* fp = OpenFile(path, false);
+	if (fp == NULL) return false;
+
+	SampleTraceHeader header;
+	bool isTrace = fread(&header, sizeof(header), 1, fp) == 1 &&
+		memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) == 0 &&
+		header.version == SampleTraceWriter::VERSION && header.recordSize == sizeof(SampleTraceRecord);
+	if (isTrace) {
+		SampleTraceRecord record;
+		// a trace cut short (the app was killed) keeps its whole records
+		while (fread(&record, sizeof(record), 1, fp) == 1) pRecords->push_back(record);
+	}
+	fclose(fp);
+	return isTrace;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// Timing trace of the samples of a player, for pacing experiments: when each sample arrived
+// (at the sample grabber, or at the DX11 renderer stream sink), its time stamps, size and
+// flags, and the clock changes in between. Replayed offline against the scheduling logic by
+// tools/trace_replay.cpp. It has no Media Foundation dependency, so it can be built on Linux.
+//
+// File: a 16-byte header ("VPWTRACE", version, record size), then one fixed-size record per
+// sample or event, in the byte order of the host (little-endian on the supported ones).
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+enum SampleTraceEvent : uint8_t
+{
+	TRACE_SAMPLE = 0,
+	TRACE_CLOCK_START = 1,   // time: the start offset (-1 if started from the current position)
+	TRACE_CLOCK_STOP = 2,
+	TRACE_CLOCK_PAUSE = 3,
+	TRACE_CLOCK_RESTART = 4, // after a pause
+	TRACE_CLOCK_RATE = 5,    // time: the rate, in millionths
+	TRACE_FLUSH = 6,         // the queued samples were discarded (seek)
+};
+
+enum SampleTraceSource : uint8_t
+{
+	TRACE_SOURCE_GRABBER = 0,  // SampleGrabberCB::OnProcessSample
+	TRACE_SOURCE_RENDERER = 1, // DX11VideoRenderer::CStreamSink::ProcessSample
+};
+
+enum SampleTraceFlags : uint16_t
+{
+	TRACE_FLAG_AUDIO = 1,
+	TRACE_FLAG_KEYFRAME = 2,      // clean point, when the source tells
+	TRACE_FLAG_DISCONTINUITY = 4,
+};
+
+struct SampleTraceRecord
+{
+	int64_t hnsArrival = 0;  // since the trace started, 100ns units (steady clock)
+	int64_t hnsTime = 0;     // presentation time of a sample, or the value of an event
+	int64_t hnsDuration = 0; // 0 if unknown
+	uint32_t size = 0;       // bytes
+	uint16_t flags = 0;      // SampleTraceFlags
+	uint8_t event = TRACE_SAMPLE;
+	uint8_t source = TRACE_SOURCE_GRABBER;
+};
+
+static_assert(sizeof(SampleTraceRecord) == 32, "the record size is part of the file format");
+
+class SampleTraceWriter
+{
+public:
+	static const uint32_t VERSION = 1;
+	static const size_t BUFFER_RECORDS = 1024; // written out together, ~32 KB
+
+	// NULL if the file can't be created
+	static std::shared_ptr<SampleTraceWriter> Create(const std::filesystem::path& path);
+	~SampleTraceWriter() { Close(); }
+	SampleTraceWriter(const SampleTraceWriter&) = delete;
+	SampleTraceWriter& operator=(const SampleTraceWriter&) = delete;
+
+	// Thread-safe, stamped with the arrival time
+	void Sample(SampleTraceSource source, int64_t hnsTime, int64_t hnsDuration, uint32_t size, uint16_t flags);
+	void Event(SampleTraceSource source, SampleTraceEvent event, int64_t value = 0);
+
+	// Writes the records left; later ones are ignored
+	void Close();
+	uint64_t RecordCount();
+
+private:
+	SampleTraceWriter() {}
+	void Append(const SampleTraceRecord& record);
+	void WriteBufferLocked();
+
+	std::mutex m_mutex;
+	FILE* m_fp = NULL;
+	std::chrono::steady_clock::time_point m_start;
+	std::vector<SampleTraceRecord> m_buffer;
+	uint64_t m_count = 0;
+};
+
+// All the records of a trace file; false if it is not one (or of another version)
+bool ReadSampleTrace(const std::filesystem::path& path, std::vector<SampleTraceRecord>* pRecords);
@@ -0,0 +1,219 @@
+#include "segment_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <system_error>
+
+static const double TRIM_RATIO = 0.9; // trimming goes below the budget, not to every write
+
+static FILE* OpenFile(const std::filesystem::path& path, bool isWrite)
+{
+	FILE* fp = NULL;
+#ifdef _WIN32
+	if (_wfopen_s(&fp, path.c_str(), isWrite ? L"wb" : L"rb") != 0) fp = NULL;
+#else
+	fp = fopen(path.c_str(), isWrite ? "wb" : "rb");
+#endif
+	return fp;
+}
+
+static bool ReadFile(const std::filesystem::path& path, std::vector<uint8_t>* pData)
+{
+	std::error_code ec;
+	uint64_t size = std::filesystem::file_size(path, ec);
+	if (ec) return false;
+	FILE* fp = OpenFile(path, false);
+	if (fp == NULL) return false;
+	pData->resize((size_t)size);
+	bool isRead = fread(pData->data(), 1, pData->size(), fp) == pData->size();
+	fclose(fp);
+	return isRead;
+}
+
+static bool WriteFile(const std::filesystem::path& path, const void* pData, size_t size)
+{
+	std::error_code ec;
+	std::filesystem::path tmpPath = path;
+	tmpPath += ".tmp";
+
+	FILE* fp = OpenFile(tmpPath, true);
+	if (fp == NULL) return false;
+	bool isWritten = fwrite(pData, 1, size, fp) == size;
+	isWritten = fclose(fp) == 0 && isWritten;
+
+	if (isWritten) std::filesystem::rename(tmpPath, path, ec);
+	if (!isWritten || ec) {
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+	return true;
+}
+
+// "<key>.<index>.seg" -> index, -1 if not a segment of 'key'
+static int64_t SegmentIndex(const std::filesystem::path& path, const std::string& key)
+{
+	if (path.extension() != ".seg") return -1;
+	std::string stem = path.stem().string();
+	if (stem.size() <= key.size() + 1 || stem.compare(0, key.size(), key) != 0 || stem[key.size()] != '.') return -1;
+	char* end = NULL;
+	long long index = strtoll(stem.c_str() + key.size() + 1, &end, 10);
+	return *end == '\0' && index >= 0 ? index : -1;
+}
+
+SegmentCache& SegmentCache::Shared()
+{
+	static SegmentCache* instance = new SegmentCache(); // never destroyed: used by reader threads up to exit
+	return *instance;
+}
+
+void SegmentCache::SetMaxBytes(uint64_t maxBytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_maxBytes = maxBytes;
+	if (m_maxBytes > 0) TrimLocked();
+}
+
+bool SegmentCache::IsEnabled()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_maxBytes > 0 && !Directory().empty();
+}
+
+std::filesystem::path SegmentCache::Directory()
+{
+	std::error_code ec;
+	std::filesystem::path dir = std::filesystem::temp_directory_path(ec);
+	if (ec) return std::filesystem::path();
+	return dir / "video_player_win" / "http";
+}
+
+std::string SegmentCache::Key(const std::string& url)
+{
+	// FNV-1a over the UTF-8 URL
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (unsigned char c : url) {
+		h ^= c;
+		h *= 0x100000001b3ULL;
+	}
+	char key[32];
+	snprintf(key, sizeof(key), "%016llx", (unsigned long long)h);
+	return key;
+}
+
+bool SegmentCache::LoadResource(const std::string& url, int64_t* pLength, std::string* pValidator)
+{
+	std::vector<uint8_t> data;
+	if (!ReadFile(Directory() / (Key(url) + ".meta"), &data)) return false;
+
+	// "<length>\n<validator>\n<url>"
+	std::string text(data.begin(), data.end());
+	size_t first = text.find('\n');
+	size_t second = first == std::string::npos ? std::string::npos : text.find('\n', first + 1);
+	if (second == std::string::npos || text.compare(second + 1, std::string::npos, url) != 0) return false;
+	*pLength = strtoll(text.c_str(), NULL, 10);
+	*pValidator = text.substr(first + 1, second - first - 1);
+	return *pLength > 0;
+}
+
+void SegmentCache::StoreResource(const std::string& url, int64_t length, const std::string& validator)
+{
+	int64_t cachedLength = 0;
+	std::string cachedValidator;
+	bool isSameVersion = !validator.empty() && LoadResource(url, &cachedLength, &cachedValidator) &&
+		cachedLength == length && cachedValidator == validator;
+	if (isSameVersion) return;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::filesystem::path dir = Directory();
+	if (dir.empty()) return;
+	std::error_code ec;
+	std::filesystem::create_directories(dir, ec);
+
+	std::string key = Key(url);
+	RemoveSegments(key);
+	std::string text = std::to_string(length) + "\n" + validator + "\n" + url;
+	WriteFile(dir / (key + ".meta"), text.data(), text.size());
+}
+
+bool SegmentCache::ReadSegment(const std::string& url, int64_t index, std::vector<uint8_t>* pData)
+{
+	std::filesystem::path path = Directory() / (Key(url) + "." + std::to_string(index) + ".seg");
+	if (!ReadFile(path, pData)) return false;
+
+	// the write time is the LRU order
+	std::error_code ec;
+	std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+	return true;
+}
+
+bool SegmentCache::WriteSegment(const std::string& url, int64_t index, const uint8_t* pData, size_t size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::filesystem::path dir = Directory();
+	if (m_maxBytes == 0 || dir.empty() || size > m_maxBytes) return false;
+
+	// a segment of the same index being replaced is counted twice until the next scan
+	if (!WriteFile(dir / (Key(url) + "." + std::to_string(index) + ".seg"), pData, size)) return false;
+	if (m_totalBytes >= 0) m_totalBytes += size;
+	if (m_totalBytes < 0 || (uint64_t)m_totalBytes > m_maxBytes) TrimLocked();
+	return true;
+}
+
+std::vector<int64_t> SegmentCache::ListSegments(const std::string& url)
+{
+	std::vector<int64_t> indices;
+	std::string key = Key(url);
+	std::error_code ec;
+	for (auto it = std::filesystem::directory_iterator(Directory(), ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+		int64_t index = SegmentIndex(it->path(), key);
+		if (index >= 0) indices.push_back(index);
+	}
+	std::sort(indices.begin(), indices.end());
+	return indices;
+}
+
+void SegmentCache::RemoveSegments(const std::string& key)
+{
+	std::vector<std::filesystem::path> paths;
+	std::error_code ec;
+	for (auto it = std::filesystem::directory_iterator(Directory(), ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+		if (SegmentIndex(it->path(), key) >= 0) paths.push_back(it->path());
+	}
+	for (auto& path : paths) std::filesystem::remove(path, ec);
+	m_totalBytes = -1;
+}
+
+void SegmentCache::TrimLocked()
+{
+	struct Entry
+	{
+		std::filesystem::path path;
+		std::filesystem::file_time_type mtime;
+		uint64_t size;
+	};
+	std::vector<Entry> entries;
+	uint64_t total = 0;
+
+	std::error_code ec;
+	std::filesystem::path dir = Directory();
+	if (dir.empty()) return;
+	for (auto it = std::filesystem::directory_iterator(dir, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+		if (it->path().extension() != ".seg") continue;
+		Entry e = { it->path(), it->last_write_time(ec), it->file_size(ec) };
+		if (ec) continue;
+		total += e.size;
+		entries.push_back(e);
+	}
+
+	if (total > m_maxBytes) {
+		uint64_t target = (uint64_t)(m_maxBytes * TRIM_RATIO);
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.mtime < b.mtime; });
+		for (auto& e : entries) {
+			if (total <= target) break;
+			// a segment being read can't be deleted on Windows, it is retried next time
+			if (std::filesystem::remove(e.path, ec)) total -= e.size;
+		}
+	}
+	m_totalBytes = (int64_t)total;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// On-disk cache of network resources, in fixed-size segments, so replays and seeks back
+// are served locally.
+//
+// <temp>/video_player_win/http/<key>.meta holds the length and validator (ETag or
+// Last-Modified) of the cached version of a URL; <key>.<index>.seg the segments. The
+// segments of another version are dropped when a new one is recorded. Reading a segment
+// touches it, and the least recently used ones are deleted past the byte budget.
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class SegmentCache
+{
+public:
+	static const uint64_t DEFAULT_MAX_BYTES = 512ULL * 1024 * 1024;
+
+	static SegmentCache& Shared();
+
+	// 0 disables the cache (the files are left for a later enable)
+	void SetMaxBytes(uint64_t maxBytes);
+	bool IsEnabled();
+
+	// Cached version of 'url', false if none
+	bool LoadResource(const std::string& url, int64_t* pLength, std::string* pValidator);
+	// Records the version of 'url' being fetched; the segments of another version, or of
+	// a resource without validator, are deleted
+	void StoreResource(const std::string& url, int64_t length, const std::string& validator);
+
+	bool ReadSegment(const std::string& url, int64_t index, std::vector<uint8_t>* pData);
+	// Writes to a temporary file and renames it, so readers never see a partial segment
+	bool WriteSegment(const std::string& url, int64_t index, const uint8_t* pData, size_t size);
+	// Indices of the segments on disk
+	std::vector<int64_t> ListSegments(const std::string& url);
+
+private:
+	SegmentCache() {}
+
+	static std::filesystem::path Directory();
+	static std::string Key(const std::string& url);
+	void RemoveSegments(const std::string& key);
+	void TrimLocked();
+
+	std::mutex m_mutex; // serializes writes and trimming, reads don't take it
+	uint64_t m_maxBytes = DEFAULT_MAX_BYTES;
+	int64_t m_totalBytes = -1; // of the segments, -1 until the directory is scanned
+};
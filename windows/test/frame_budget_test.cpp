@@ -0,0 +1,193 @@
+// FrameBudget against simulated players: each decodes at a steady rate and
+// converts the frames it is admitted at a cost proportional to the pixel
+// count of the scale. The rates divide the allocation period, so each period
+// sees the same frame counts and the allocation is exact.
+
+#include "frame_budget.h"
+#include "test_check.h"
+
+#include <vector>
+
+namespace {
+
+struct SimPlayer {
+	int id = 0;
+	int64_t intervalUs = 0;  // decoding rate
+	int64_t fullCostUs = 0;  // conversion of a frame at full size
+	int64_t nextFrameUs = 0;
+};
+
+// Decodes the frames of 'players' in time order from 'startUs' to 'endUs'
+void Simulate(FrameBudget& budget, std::vector<SimPlayer>& players, int64_t startUs, int64_t endUs) {
+	for (auto& p : players) {
+		if (p.nextFrameUs < startUs) p.nextFrameUs = startUs;
+	}
+	for (;;) {
+		SimPlayer* next = nullptr;
+		for (auto& p : players) {
+			if (next == nullptr || p.nextFrameUs < next->nextFrameUs) next = &p;
+		}
+		if (next == nullptr || next->nextFrameUs >= endUs) return;
+		FrameBudget::Decision decision = budget.Admit(next->id, next->nextFrameUs);
+		if (decision.isAccepted) {
+			budget.Report(next->id, decision.scale, next->fullCostUs / (decision.scale * decision.scale));
+		}
+		next->nextFrameUs += next->intervalUs;
+	}
+}
+
+FrameBudgetStats Stats(FrameBudget& budget, const SimPlayer& p) {
+	FrameBudgetStats stats;
+	CHECK(budget.GetStats(p.id, &stats));
+	return stats;
+}
+
+bool IsNear(double value, double expected) {
+	return value > expected - 0.01 && value < expected + 0.01;
+}
+
+// A focused player at 50 fps (100 ms of conversion per second), a visible and a
+// background one at 25 fps (100 ms per second at full size, 25 at half, 6.25 at quarter)
+struct Scene {
+	FrameBudget budget;
+	std::vector<SimPlayer> players;
+	int64_t nowUs = 0;
+
+	Scene() {
+		SimPlayer focused, visible, background;
+		focused.id = budget.Register();
+		focused.intervalUs = 20000;
+		focused.fullCostUs = 2000;
+		budget.SetPriority(focused.id, FRAME_PRIORITY_FOCUSED, 50);
+		visible.id = budget.Register();
+		visible.intervalUs = 40000;
+		visible.fullCostUs = 4000;
+		budget.SetPriority(visible.id, FRAME_PRIORITY_VISIBLE, 25);
+		background.id = budget.Register();
+		background.intervalUs = 40000;
+		background.fullCostUs = 4000;
+		budget.SetPriority(background.id, FRAME_PRIORITY_BACKGROUND, 25);
+		players = { focused, visible, background };
+	}
+
+	const SimPlayer& Focused() const { return players[0]; }
+	const SimPlayer& Visible() const { return players[1]; }
+	const SimPlayer& Background() const { return players[2]; }
+
+	// Runs 'seconds' with a budget of 'budgetUs' per second
+	void Run(int64_t budgetUs, int seconds) {
+		budget.SetBudget(budgetUs);
+		Simulate(budget, players, nowUs, nowUs + seconds * 1000000);
+		nowUs += seconds * 1000000;
+	}
+};
+
+void TestUnderBudget() {
+	Scene scene;
+	scene.Run(1000000, 3);
+	for (auto& p : scene.players) {
+		FrameBudgetStats stats = Stats(scene.budget, p);
+		CHECK(stats.scale == 1);
+		CHECK(IsNear(stats.allowedFps, stats.targetFps));
+		CHECK(stats.droppedFrames == 0);
+		CHECK(stats.scaledFrames == 0);
+	}
+	FrameBudgetStats stats = Stats(scene.budget, scene.Focused());
+	CHECK(stats.demandUs == 300000);
+	CHECK(stats.grantedUs == 300000);
+}
+
+void TestDegradationOrder() {
+	Scene scene;
+	scene.Run(1000000, 2); // the costs are measured
+
+	// the background player is shrunk first
+	scene.Run(260000, 3);
+	FrameBudgetStats focused = Stats(scene.budget, scene.Focused());
+	FrameBudgetStats visible = Stats(scene.budget, scene.Visible());
+	FrameBudgetStats background = Stats(scene.budget, scene.Background());
+	CHECK(focused.scale == 1 && IsNear(focused.allowedFps, 50));
+	CHECK(visible.scale == 1 && IsNear(visible.allowedFps, 25));
+	CHECK(background.scale == 2 && IsNear(background.allowedFps, 25));
+	CHECK(background.scaledFrames > 0);
+
+	// then the visible one, while the background one gets smaller again
+	scene.Run(145000, 3);
+	focused = Stats(scene.budget, scene.Focused());
+	visible = Stats(scene.budget, scene.Visible());
+	background = Stats(scene.budget, scene.Background());
+	CHECK(focused.scale == 1 && IsNear(focused.allowedFps, 50));
+	CHECK(visible.scale == 2 && IsNear(visible.allowedFps, 25));
+	CHECK(background.scale == 4 && IsNear(background.allowedFps, 25));
+
+	// at the smallest size, the background player drops frames first: 3.75 ms left for its 6.25
+	scene.Run(110000, 3);
+	focused = Stats(scene.budget, scene.Focused());
+	visible = Stats(scene.budget, scene.Visible());
+	background = Stats(scene.budget, scene.Background());
+	CHECK(focused.scale == 1 && IsNear(focused.allowedFps, 50));
+	CHECK(visible.scale == 4 && IsNear(visible.allowedFps, 25));
+	CHECK(background.scale == 4 && IsNear(background.allowedFps, 15));
+	CHECK(background.droppedFrames > 0);
+
+	// then the visible one: 4 ms left for its 6.25, none for the background one
+	scene.Run(104000, 3);
+	visible = Stats(scene.budget, scene.Visible());
+	background = Stats(scene.budget, scene.Background());
+	CHECK(IsNear(visible.allowedFps, 16));
+	CHECK(IsNear(background.allowedFps, 1));
+
+	// the focused player is never degraded, nor dropping frames
+	focused = Stats(scene.budget, scene.Focused());
+	CHECK(focused.droppedFrames == 0);
+	CHECK(focused.scaledFrames == 0);
+}
+
+void TestFloors() {
+	Scene scene;
+	scene.Run(1000000, 2);
+
+	// less than the focused player alone needs: the others keep 5 and 1 fps
+	scene.Run(50000, 2);
+	FrameBudgetStats focused = Stats(scene.budget, scene.Focused());
+	FrameBudgetStats visible = Stats(scene.budget, scene.Visible());
+	FrameBudgetStats background = Stats(scene.budget, scene.Background());
+	CHECK(focused.scale == 1 && IsNear(focused.allowedFps, 50));
+	CHECK(visible.scale == 4 && IsNear(visible.allowedFps, 5));
+	CHECK(background.scale == 4 && IsNear(background.allowedFps, 1));
+
+	// the frames shown follow the floors
+	uint64_t visibleAccepted = visible.acceptedFrames;
+	uint64_t backgroundAccepted = background.acceptedFrames;
+	scene.Run(50000, 4);
+	visible = Stats(scene.budget, scene.Visible());
+	background = Stats(scene.budget, scene.Background());
+	uint64_t visibleShown = visible.acceptedFrames - visibleAccepted;
+	uint64_t backgroundShown = background.acceptedFrames - backgroundAccepted;
+	CHECK(visibleShown >= 19 && visibleShown <= 21);
+	CHECK(backgroundShown >= 3 && backgroundShown <= 5);
+
+	// a target under the floor is kept
+	scene.budget.SetPriority(scene.Background().id, FRAME_PRIORITY_BACKGROUND, 0.5);
+	scene.Run(50000, 2);
+	background = Stats(scene.budget, scene.Background());
+	CHECK(IsNear(background.allowedFps, 0.5));
+
+	// the budget back: everything back to full size and rate
+	scene.budget.SetPriority(scene.Background().id, FRAME_PRIORITY_BACKGROUND, 25);
+	scene.Run(1000000, 2);
+	for (auto& p : scene.players) {
+		FrameBudgetStats stats = Stats(scene.budget, p);
+		CHECK(stats.scale == 1);
+		CHECK(IsNear(stats.allowedFps, stats.targetFps));
+	}
+}
+
+} // namespace
+
+int main() {
+	TestUnderBudget();
+	TestDegradationOrder();
+	TestFloors();
+	return TestResult();
+}
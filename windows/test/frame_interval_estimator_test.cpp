@@ -0,0 +1,132 @@
+// CFrameIntervalEstimator on timestamp patterns: constant frame rates with
+// container rounding, dropped frames and repeated times, telecine (3:2
+// pulldown), a variable frame rate, jitter, and a restart after a seek.
+
+#include "FrameIntervalEstimator.h"
+#include "test_check.h"
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace DX11VideoRenderer;
+
+namespace {
+
+struct FeedResult {
+	int64_t hnsLast = 0; // last estimate returned
+	int changes = 0;
+};
+
+FeedResult Feed(CFrameIntervalEstimator& estimator, const std::vector<int64_t>& times) {
+	FeedResult result;
+	for (int64_t hnsTime : times) {
+		int64_t hnsPerFrame = 0;
+		if (estimator.OnSampleTime(hnsTime, &hnsPerFrame)) {
+			result.hnsLast = hnsPerFrame;
+			result.changes++;
+		}
+	}
+	return result;
+}
+
+// 59.94 fps, the times rounded as a container stores them: one estimate
+void TestConstant() {
+	CFrameIntervalEstimator estimator;
+	std::vector<int64_t> times;
+	for (int i = 0; i < 600; i++) times.push_back((int64_t)(i * 166833.3333));
+	FeedResult result = Feed(estimator, times);
+	CHECK(llabs(result.hnsLast - 166833) <= 1 && result.changes == 1);
+
+	// none before MIN_INTERVALS intervals
+	CFrameIntervalEstimator early;
+	std::vector<int64_t> few(times.begin(), times.begin() + CFrameIntervalEstimator::MIN_INTERVALS);
+	CHECK(Feed(early, few).changes == 0 && early.Estimate() == 0);
+}
+
+// 50 fps, a frame missing every 37 and a time repeated every 53
+void TestGaps() {
+	CFrameIntervalEstimator estimator;
+	std::vector<int64_t> times;
+	for (int i = 0; i < 600; i++) {
+		if (i % 37 == 0) continue;
+		times.push_back(i * 200000LL);
+		if (i % 53 == 0) times.push_back(i * 200000LL);
+	}
+	FeedResult result = Feed(estimator, times);
+	CHECK(result.hnsLast == 200000 && estimator.Estimate() == 200000);
+}
+
+// 23.976 fps telecined to 59.94i: 3 and 2 field durations alternate, the
+// estimate is their average, not one of them
+void TestTelecine() {
+	CFrameIntervalEstimator estimator;
+	std::vector<int64_t> times;
+	int64_t hnsTime = 0;
+	for (int i = 0; i < 600; i++) {
+		times.push_back(hnsTime);
+		hnsTime += i % 2 ? 500500 : 333667;
+	}
+	FeedResult result = Feed(estimator, times);
+	CHECK(llabs(result.hnsLast - 417083) <= 1);
+}
+
+// 30 fps then 60 fps: the estimate follows within a window
+void TestVariable() {
+	CFrameIntervalEstimator estimator;
+	std::vector<int64_t> times;
+	for (int i = 0; i < 300; i++) times.push_back(i * 333333LL);
+	CHECK(llabs(Feed(estimator, times).hnsLast - 333333) <= 1);
+
+	int64_t hnsStart = times.back();
+	int samples = 0;
+	int64_t hnsEstimate = estimator.Estimate();
+	while (samples < 300 && llabs(hnsEstimate - 166667) > 1) {
+		samples++;
+		int64_t hnsPerFrame = 0;
+		if (estimator.OnSampleTime(hnsStart + samples * 166667LL, &hnsPerFrame)) hnsEstimate = hnsPerFrame;
+	}
+	printf("30 -> 60 fps: followed after %d samples\n", samples);
+	CHECK(samples <= CFrameIntervalEstimator::WINDOW);
+}
+
+// 25 fps with up to 3 ms of jitter: close, and few changes reported
+void TestJitter() {
+	CFrameIntervalEstimator estimator;
+	std::mt19937 random(1);
+	std::vector<int64_t> times;
+	for (int i = 0; i < 600; i++) times.push_back(i * 400000LL + (int64_t)(random() % 60001) - 30000);
+	FeedResult result = Feed(estimator, times);
+	printf("jittered 25 fps: %lld, %d changes\n", (long long)result.hnsLast, result.changes);
+	CHECK(llabs(result.hnsLast - 400000) < 4000 && result.changes < 20);
+}
+
+// After a seek the next time is not an interval, even going backwards
+void TestRestart() {
+	CFrameIntervalEstimator estimator;
+	std::vector<int64_t> times;
+	for (int i = 0; i < 50; i++) times.push_back(i * 400000LL);
+	Feed(estimator, times);
+	estimator.Restart();
+	int64_t hnsPerFrame = 0;
+	CHECK(!estimator.OnSampleTime(1000, &hnsPerFrame));
+	CHECK(!estimator.OnSampleTime(401000, &hnsPerFrame));
+	CHECK(estimator.Estimate() == 400000);
+
+	// without the restart, a jump back is not an interval either
+	CHECK(!estimator.OnSampleTime(0, &hnsPerFrame) && estimator.Estimate() == 400000);
+	estimator.Reset();
+	CHECK(estimator.Estimate() == 0);
+}
+
+} // namespace
+
+int main() {
+	TestConstant();
+	TestGaps();
+	TestTelecine();
+	TestVariable();
+	TestJitter();
+	TestRestart();
+	return TestResult();
+}
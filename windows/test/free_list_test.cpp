@@ -0,0 +1,199 @@
+// CFreeList as CStreamSink::CAsyncOperation uses it, one operation per sample:
+// no allocation in the steady state (global operator new counted), at most
+// MAX_FREE kept after a burst of operations in flight, and operations created
+// and released from several threads, none handed out twice.
+
+#include "FreeList.h"
+#include "test_check.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace DX11VideoRenderer;
+
+namespace {
+
+std::atomic<long> g_news{0};
+
+} // namespace
+
+void* operator new(size_t size) {
+	g_news++;
+	void* p = malloc(size ? size : 1);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	g_news++;
+	return malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+
+namespace {
+
+const long MAX_FREE = 16; // CAsyncOperation::MAX_FREE
+
+// CAsyncOperation without COM: created with a ref count of 1, recycled on the
+// last Release()
+class Operation {
+public:
+	static Operation* Create(int op) {
+		FreeListEntry* pEntry = s_freeList.Pop();
+		if (pEntry == NULL) {
+			Operation* pOp = new (std::nothrow) Operation(op);
+			if (pOp != NULL) s_allocations++;
+			return pOp;
+		}
+		// CONTAINING_RECORD
+		Operation* pOp = (Operation*)((char*)pEntry - offsetof(Operation, m_freeEntry));
+		pOp->m_op = op;
+		pOp->m_refCount = 1;
+		return pOp;
+	}
+
+	void AddRef() { m_refCount++; }
+
+	void Release() {
+		if (--m_refCount == 0) {
+			if (m_isInUse.exchange(false) == false) s_doubleReleases++;
+			if (!s_freeList.Push(&m_freeEntry)) {
+				s_deletions++;
+				delete this;
+			}
+		}
+	}
+
+	// Checked by its owner: an operation handed out twice is seen in use
+	bool Take() { return !m_isInUse.exchange(true); }
+
+	int Op() const { return m_op; }
+
+	static CFreeList s_freeList;
+	static std::atomic<long> s_allocations;
+	static std::atomic<long> s_deletions;
+	static std::atomic<long> s_doubleReleases;
+
+private:
+	explicit Operation(int op) : m_op(op), m_refCount(1) {}
+
+	int m_op;
+	FreeListEntry m_freeEntry;
+	std::atomic<long> m_refCount;
+	std::atomic<bool> m_isInUse{false};
+};
+
+CFreeList Operation::s_freeList(MAX_FREE);
+std::atomic<long> Operation::s_allocations{0};
+std::atomic<long> Operation::s_deletions{0};
+std::atomic<long> Operation::s_doubleReleases{0};
+
+long Live() { return Operation::s_allocations - Operation::s_deletions; }
+
+// The sink's queue: 'depth' samples in flight, each one's operation queued
+// (AddRef by the work queue) then released by both
+void TestSteadyState() {
+	const int DEPTH = 3;
+	Operation* queue[DEPTH] = {};
+	for (int i = 0; i < DEPTH; i++) {
+		queue[i] = Operation::Create(i);
+		CHECK(queue[i]->Take());
+	}
+	long allocations = Operation::s_allocations;
+	long news = g_news;
+	for (int frame = DEPTH; frame < 100000; frame++) {
+		Operation*& pOp = queue[frame % DEPTH];
+		pOp->Release();
+		pOp = Operation::Create(frame);
+		CHECK(pOp != NULL && pOp->Take() && pOp->Op() == frame);
+		pOp->AddRef(); // queued
+		pOp->Release(); // dispatched
+	}
+	printf("steady state: %ld operation(s) allocated before, %ld after 100000 frames, %ld operator new\n",
+		allocations, (long)Operation::s_allocations, (long)(g_news - news));
+	CHECK(Operation::s_allocations == allocations && g_news == news);
+	for (Operation* pOp : queue) pOp->Release();
+	CHECK(Operation::s_freeList.FreeCount() == Live());
+}
+
+// 40 in flight (a burst of markers and samples): MAX_FREE kept once released,
+// and the next burst allocates only the ones missing
+void TestBurst() {
+	const int BURST = 40;
+	std::vector<Operation*> ops(BURST);
+	long allocations = Operation::s_allocations;
+	long kept = Operation::s_freeList.FreeCount();
+	for (int i = 0; i < BURST; i++) {
+		ops[i] = Operation::Create(i);
+		CHECK(ops[i]->Take());
+	}
+	CHECK(Operation::s_allocations - allocations == BURST - kept);
+	CHECK(Operation::s_freeList.FreeCount() == 0);
+	for (Operation* pOp : ops) pOp->Release();
+	CHECK(Operation::s_freeList.FreeCount() == MAX_FREE && Live() == MAX_FREE);
+
+	allocations = Operation::s_allocations;
+	for (int i = 0; i < BURST; i++) {
+		ops[i] = Operation::Create(i);
+		CHECK(ops[i]->Take());
+	}
+	CHECK(Operation::s_allocations - allocations == BURST - MAX_FREE);
+	for (Operation* pOp : ops) pOp->Release();
+	CHECK(Operation::s_freeList.FreeCount() == MAX_FREE && Live() == MAX_FREE);
+
+	// the steady state after it does not allocate
+	long news = g_news;
+	for (int i = 0; i < 10000; i++) {
+		Operation* pOp = Operation::Create(i);
+		CHECK(pOp->Take());
+		pOp->Release();
+	}
+	CHECK(g_news == news);
+}
+
+// Created on 4 threads and released on others (the work queue threads), up to
+// 8 in flight each: never handed out twice, the kept ones bounded
+void TestConcurrent() {
+	const int THREADS = 4;
+	const int OPS = 100000;
+	const int IN_FLIGHT = 8;
+	std::atomic<long> twice{0};
+	std::vector<std::thread> threads;
+	for (int t = 0; t < THREADS; t++) {
+		threads.emplace_back([t, &twice]() {
+			Operation* ring[IN_FLIGHT] = {};
+			for (int i = 0; i < OPS; i++) {
+				Operation*& pOp = ring[i % IN_FLIGHT];
+				if (pOp != NULL) pOp->Release();
+				pOp = Operation::Create(t * OPS + i);
+				if (pOp == NULL || !pOp->Take()) twice++;
+				// in flight on this thread only: the operation is not seen changed
+				if (pOp->Op() != t * OPS + i) twice++;
+			}
+			for (Operation* pOp : ring) pOp->Release();
+		});
+	}
+	for (std::thread& thread : threads) thread.join();
+	printf("%d threads: %ld operation(s) allocated, %ld deleted, %ld kept\n", THREADS,
+		(long)Operation::s_allocations, (long)Operation::s_deletions, Operation::s_freeList.FreeCount());
+	CHECK(twice == 0 && Operation::s_doubleReleases == 0);
+	CHECK(Operation::s_freeList.FreeCount() <= MAX_FREE && Operation::s_freeList.FreeCount() == Live());
+	// far fewer than one per operation
+	CHECK(Operation::s_allocations < THREADS * OPS / 100);
+}
+
+} // namespace
+
+int main() {
+	TestSteadyState();
+	TestBurst();
+	TestConcurrent();
+	return TestResult();
+}
@@ -0,0 +1,195 @@
+// GopFrameCache: the GOP bounds from the keyframes, the accounting of the
+// memory cap, eviction of the GOPs farthest from the play head, and steps
+// served (or refused) across GOP boundaries, for whole decoded GOPs and for
+// the frames recorded from playback.
+
+#include "gop_frame_cache.h"
+#include "test_check.h"
+
+#include <climits>
+#include <vector>
+
+namespace {
+
+const int64_t HNS_PER_FRAME = 1000000;
+const int64_t HNS_PER_GOP = 10 * HNS_PER_FRAME;
+const uint32_t WIDTH = 16;
+const uint32_t HEIGHT = 8;
+const size_t FRAME_BYTES = WIDTH * HEIGHT * 3 / 2;
+const size_t GOP_BYTES = 10 * FRAME_BYTES;
+
+CachedFramePtr MakeFrame(int64_t hnsTime) {
+	std::vector<uint8_t> planes(WIDTH * HEIGHT * 3 / 2, (uint8_t)(hnsTime / HNS_PER_FRAME));
+	Nv12Frame frame;
+	frame.y = planes.data();
+	frame.uv = planes.data() + WIDTH * HEIGHT;
+	frame.width = WIDTH;
+	frame.height = HEIGHT;
+	frame.stride = WIDTH;
+	return std::make_shared<const CachedFrame>(frame, hnsTime, HNS_PER_FRAME);
+}
+
+// The frames of the GOP starting at 'hnsStart', from its 'first' one
+std::vector<CachedFramePtr> MakeGop(int64_t hnsStart, int first = 0) {
+	std::vector<CachedFramePtr> frames;
+	for (int i = first; i < 10; i++) frames.push_back(MakeFrame(hnsStart + i * HNS_PER_FRAME));
+	return frames;
+}
+
+void AddGop(GopFrameCache& cache, int64_t hnsStart) {
+	cache.AddGop(hnsStart, hnsStart + HNS_PER_GOP, MakeGop(hnsStart), true);
+}
+
+void TestGopBounds() {
+	std::vector<int64_t> keyframes = { 0, 20, 50 };
+	int64_t start = -1, end = -1;
+	GetGopBounds(keyframes, 5, &start, &end);
+	CHECK(start == 0 && end == 20);
+	GetGopBounds(keyframes, 20, &start, &end);
+	CHECK(start == 20 && end == 50);
+	GetGopBounds(keyframes, 60, &start, &end);
+	CHECK(start == 50 && end == INT64_MAX);
+	GetGopBounds({ 10, 20 }, 5, &start, &end); // before the first keyframe: its GOP
+	CHECK(start == 10 && end == 20);
+
+	// no keyframe index: chunks
+	GetGopBounds({}, 25000000, &start, &end);
+	CHECK(start == 20000000 && end == 30000000);
+	GetGopBounds({}, -1, &start, &end);
+	CHECK(start == 0 && end == GopFrameCache::CHUNK_HNS);
+}
+
+void TestCapAccounting() {
+	GopFrameCache cache(3 * GOP_BYTES);
+	for (int i = 0; i < 3; i++) AddGop(cache, i * HNS_PER_GOP);
+	GopFrameCacheStats stats = cache.GetStats();
+	CHECK(stats.gopCount == 3);
+	CHECK(stats.usedBytes == 3 * GOP_BYTES);
+	CHECK(stats.evictedGops == 0);
+
+	// a GOP decoded again replaces its frames
+	cache.AddGop(HNS_PER_GOP, 2 * HNS_PER_GOP, MakeGop(HNS_PER_GOP, 5), false);
+	stats = cache.GetStats();
+	CHECK(stats.gopCount == 3);
+	CHECK(stats.usedBytes == 2 * GOP_BYTES + 5 * FRAME_BYTES);
+
+	// the frames of playback count too
+	cache.AddFrame(3 * HNS_PER_GOP, 4 * HNS_PER_GOP, MakeFrame(3 * HNS_PER_GOP), false);
+	stats = cache.GetStats();
+	CHECK(stats.gopCount == 4);
+	CHECK(stats.usedBytes == 2 * GOP_BYTES + 6 * FRAME_BYTES);
+
+	// a lower cap evicts down to it (the play head is at 0)
+	cache.SetMaxBytes(GOP_BYTES + FRAME_BYTES);
+	stats = cache.GetStats();
+	CHECK(stats.usedBytes == GOP_BYTES);
+	CHECK(stats.evictedGops == 3);
+	CHECK(cache.HasGop(0));
+
+	cache.Clear();
+	stats = cache.GetStats();
+	CHECK(stats.gopCount == 0);
+	CHECK(stats.usedBytes == 0);
+}
+
+void TestEvictionOrder() {
+	GopFrameCache cache(4 * GOP_BYTES);
+	cache.SetPlayHead(2 * HNS_PER_GOP + 5 * HNS_PER_FRAME);
+	for (int i = 0; i < 4; i++) AddGop(cache, i * HNS_PER_GOP);
+	CHECK(cache.GetStats().evictedGops == 0);
+
+	// over the cap: the GOP farthest from the play head goes, behind it
+	AddGop(cache, 4 * HNS_PER_GOP);
+	CHECK(!cache.HasGop(0));
+	CHECK(cache.HasGop(HNS_PER_GOP) && cache.HasGop(2 * HNS_PER_GOP) && cache.HasGop(3 * HNS_PER_GOP) && cache.HasGop(4 * HNS_PER_GOP));
+	CHECK(cache.GetStats().evictedGops == 1);
+
+	// ahead of it: the next GOP after the play head is kept, the farthest one behind goes
+	cache.SetPlayHead(4 * HNS_PER_GOP + 5 * HNS_PER_FRAME);
+	AddGop(cache, 6 * HNS_PER_GOP);
+	CHECK(!cache.HasGop(HNS_PER_GOP));
+	CHECK(cache.HasGop(2 * HNS_PER_GOP) && cache.HasGop(6 * HNS_PER_GOP));
+
+	// the farthest ahead goes before a nearer one behind
+	cache.SetPlayHead(3 * HNS_PER_GOP);
+	AddGop(cache, 7 * HNS_PER_GOP - HNS_PER_GOP / 2); // (just added: kept)
+	CHECK(!cache.HasGop(6 * HNS_PER_GOP));
+	CHECK(cache.HasGop(2 * HNS_PER_GOP));
+	CHECK(cache.GetStats().usedBytes == 4 * GOP_BYTES);
+
+	// never the GOP holding the play head, nor the one just added, even over the cap
+	cache.SetMaxBytes(GOP_BYTES);
+	CHECK(cache.GetStats().gopCount == 1);
+	CHECK(cache.HasGop(3 * HNS_PER_GOP));
+	AddGop(cache, 9 * HNS_PER_GOP);
+	CHECK(cache.HasGop(3 * HNS_PER_GOP) && cache.HasGop(9 * HNS_PER_GOP));
+	CHECK(cache.GetStats().usedBytes == 2 * GOP_BYTES);
+}
+
+void TestStepsAcrossGops() {
+	GopFrameCache cache(100 * GOP_BYTES);
+	AddGop(cache, 0);
+	AddGop(cache, HNS_PER_GOP);
+
+	CachedFramePtr frame = cache.Next(0);
+	CHECK(frame != NULL && frame->hnsTime == HNS_PER_FRAME);
+	// the last frame of a GOP: the first one of the next
+	frame = cache.Next(HNS_PER_GOP - HNS_PER_FRAME);
+	CHECK(frame != NULL && frame->hnsTime == HNS_PER_GOP);
+	frame = cache.Previous(HNS_PER_GOP);
+	CHECK(frame != NULL && frame->hnsTime == HNS_PER_GOP - HNS_PER_FRAME);
+	CHECK(cache.GetStats().hits == 3);
+
+	// nothing cached before the first frame, nor after the last GOP
+	CHECK(cache.Previous(0) == NULL);
+	CHECK(cache.Next(2 * HNS_PER_GOP - HNS_PER_FRAME) == NULL);
+	CHECK(cache.GetStats().misses == 2);
+
+	// a GOP with its first frames dropped: no step into the missing ones
+	cache.AddGop(3 * HNS_PER_GOP, 4 * HNS_PER_GOP, MakeGop(3 * HNS_PER_GOP, 5), false);
+	CHECK(!cache.HasGop(3 * HNS_PER_GOP));
+	CHECK(cache.Previous(3 * HNS_PER_GOP + 5 * HNS_PER_FRAME) == NULL);
+	CHECK(cache.Next(3 * HNS_PER_GOP + 4 * HNS_PER_FRAME) == NULL);
+	frame = cache.Next(3 * HNS_PER_GOP + 5 * HNS_PER_FRAME);
+	CHECK(frame != NULL && frame->hnsTime == 3 * HNS_PER_GOP + 6 * HNS_PER_FRAME);
+	// nor across the GOP missing in between
+	CHECK(cache.Next(2 * HNS_PER_GOP - HNS_PER_FRAME) == NULL);
+}
+
+void TestPlaybackFrames() {
+	GopFrameCache cache(100 * GOP_BYTES);
+	// playback from the middle of GOP 0, then into GOP 1
+	for (int i = 5; i < 10; i++) cache.AddFrame(0, HNS_PER_GOP, MakeFrame(i * HNS_PER_FRAME), i > 5);
+	cache.AddFrame(HNS_PER_GOP, 2 * HNS_PER_GOP, MakeFrame(HNS_PER_GOP), true);
+
+	CachedFramePtr frame = cache.Next(HNS_PER_GOP - HNS_PER_FRAME);
+	CHECK(frame != NULL && frame->hnsTime == HNS_PER_GOP);
+	frame = cache.Previous(HNS_PER_GOP);
+	CHECK(frame != NULL && frame->hnsTime == HNS_PER_GOP - HNS_PER_FRAME);
+	// the head of GOP 0 was not played
+	CHECK(!cache.HasGop(0));
+	CHECK(cache.Previous(5 * HNS_PER_FRAME) == NULL);
+
+	// GOP 1 played through: whole once the next one starts
+	for (int i = 1; i < 10; i++) cache.AddFrame(HNS_PER_GOP, 2 * HNS_PER_GOP, MakeFrame(HNS_PER_GOP + i * HNS_PER_FRAME), true);
+	CHECK(!cache.HasGop(HNS_PER_GOP));
+	cache.AddFrame(2 * HNS_PER_GOP, 3 * HNS_PER_GOP, MakeFrame(2 * HNS_PER_GOP), true);
+	CHECK(cache.HasGop(HNS_PER_GOP));
+
+	// a seek into GOP 2: its recording starts again, not covering its head
+	cache.AddFrame(2 * HNS_PER_GOP, 3 * HNS_PER_GOP, MakeFrame(2 * HNS_PER_GOP + 4 * HNS_PER_FRAME), false);
+	CHECK(cache.Previous(2 * HNS_PER_GOP + 4 * HNS_PER_FRAME) == NULL);
+	CHECK(cache.Next(2 * HNS_PER_GOP) == NULL);
+	CHECK(cache.GetStats().usedBytes == 5 * FRAME_BYTES + GOP_BYTES + FRAME_BYTES);
+}
+
+} // namespace
+
+int main() {
+	TestGopBounds();
+	TestCapAccounting();
+	TestEvictionOrder();
+	TestStepsAcrossGops();
+	TestPlaybackFrames();
+	return TestResult();
+}
@@ -0,0 +1,323 @@
+// HLS playlists, AbrController, and HlsStream against locally served
+// playlists: a VOD presentation fetched in parallel and switching up, a
+// throttled server switching down, the pool bound, byte-range segments of
+// fragmented MP4, a live playlist sliding, and failures.
+//
+// Every segment is SEGMENT_BYTES long and tells its variant and sequence
+// number in its first two bytes, so the stream read can be checked block by
+// block.
+
+#include "hls_stream.h"
+#include "local_http_server.h"
+#include "test_check.h"
+
+#include <sstream>
+
+namespace {
+
+const int SEGMENT_BYTES = 64 * 1024; // over AbrController::MIN_SAMPLE_BYTES
+const int64_t BANDWIDTHS[] = { 300000, 1200000, 4000000 };
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Block {
+	int variant;
+	int sequence;
+};
+
+Bytes Segment(int variant, int sequence) {
+	Bytes segment(SEGMENT_BYTES, (uint8_t)(variant * 16 + sequence));
+	segment[0] = (uint8_t)variant;
+	segment[1] = (uint8_t)sequence;
+	return segment;
+}
+
+// Segments 'first' to 'first + count - 1', "<sequence>.ts" next to the playlist
+std::string MediaPlaylist(int first, int count, bool isEnded, double targetDuration = 2) {
+	std::ostringstream text;
+	text << "#EXTM3U\n#EXT-X-VERSION:3\n#EXT-X-TARGETDURATION:" << targetDuration << "\n#EXT-X-MEDIA-SEQUENCE:" << first << "\n";
+	for (int i = first; i < first + count; i++) text << "#EXTINF:" << targetDuration << ",\n" << i << ".ts\n";
+	if (isEnded) text << "#EXT-X-ENDLIST\n";
+	return text.str();
+}
+
+// A master playlist of the BANDWIDTHS variants, each of 'count' segments
+void ServeVod(LocalHttpServer& server, int count) {
+	std::string master = "#EXTM3U\n";
+	for (int variant = 0; variant < 3; variant++) {
+		master += "#EXT-X-STREAM-INF:BANDWIDTH=" + std::to_string(BANDWIDTHS[variant]) + "\nv" + std::to_string(variant) + "/index.m3u8\n";
+		std::string dir = "/v" + std::to_string(variant) + "/";
+		server.SetResource(dir + "index.m3u8", MediaPlaylist(0, count, true));
+		for (int i = 0; i < count; i++) server.SetResource(dir + std::to_string(i) + ".ts", Segment(variant, i));
+	}
+	server.SetResource("/master.m3u8", master);
+}
+
+// The next segment of the stream, checked against the one it claims to be;
+// variant -1 at the end or on a failure
+Block ReadBlock(HlsStream& stream) {
+	Bytes data(SEGMENT_BYTES);
+	int64_t done = 0;
+	while (done < SEGMENT_BYTES) {
+		int64_t count = stream.Read(data.data() + done, SEGMENT_BYTES - done);
+		if (count <= 0) return Block{ -1, (int)count };
+		done += count;
+	}
+	CHECK(data == Segment(data[0], data[1]));
+	return Block{ data[0], data[1] };
+}
+
+// Polls until 'count' segments are fetched, 5 s at most
+bool WaitForFetched(HlsStream& stream, int64_t count) {
+	for (int i = 0; i < 500; i++) {
+		if (stream.GetStats().segmentsFetched >= count) return true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return false;
+}
+
+// --------------------------------------------------------------------------
+// Playlists
+
+void TestMasterPlaylist() {
+	std::string text =
+		"#EXTM3U\n"
+		"#EXT-X-STREAM-INF:BANDWIDTH=4000000,RESOLUTION=1920x1080,CODECS=\"avc1.640028,mp4a.40.2\"\n"
+		"hi/index.m3u8\n"
+		"#EXT-X-STREAM-INF:BANDWIDTH=300000,RESOLUTION=416x234\r\n"
+		"# a comment\n"
+		"lo/index.m3u8?token=1\n"
+		"#EXT-X-STREAM-INF:BANDWIDTH=1200000\n"
+		"/abs/mid.m3u8\n"
+		"#EXT-X-STREAM-INF:RESOLUTION=1x1\n"
+		"no_bandwidth.m3u8\n";
+	CHECK(IsHlsPlaylist(text) && IsHlsMasterPlaylist(text));
+	std::vector<HlsVariant> variants;
+	CHECK(ParseHlsMasterPlaylist(text, "http://host/live/master.m3u8?x=1", &variants));
+	CHECK(variants.size() == 3);
+	if (variants.size() != 3) return;
+	CHECK(variants[0].bandwidth == 300000 && variants[0].width == 416 && variants[0].height == 234);
+	CHECK(variants[0].url == "http://host/live/lo/index.m3u8?token=1");
+	CHECK(variants[1].url == "http://host/abs/mid.m3u8" && variants[1].width == 0);
+	CHECK(variants[2].codecs == "avc1.640028,mp4a.40.2" && variants[2].url == "http://host/live/hi/index.m3u8");
+
+	HlsMediaPlaylist playlist;
+	CHECK(!ParseHlsMediaPlaylist(text, "http://host/", &playlist));
+}
+
+void TestMediaPlaylist() {
+	std::string text =
+		"\xEF\xBB\xBF#EXTM3U\n"
+		"#EXT-X-TARGETDURATION:6\n"
+		"#EXT-X-MEDIA-SEQUENCE:7\n"
+		"#EXT-X-KEY:METHOD=NONE\n"
+		"#EXT-X-MAP:URI=\"init.mp4\",BYTERANGE=\"720@0\"\n"
+		"#EXTINF:6.0,\n#EXT-X-BYTERANGE:1000@720\nmedia.mp4\n"
+		"#EXTINF:5.5,\n#EXT-X-BYTERANGE:2000\nmedia.mp4\n"
+		"#EXT-X-DISCONTINUITY\n#EXTINF:4,\n../other/seg.m4s\n"
+		"#EXT-X-ENDLIST\n";
+	CHECK(IsHlsPlaylist(text) && !IsHlsMasterPlaylist(text));
+	HlsMediaPlaylist playlist;
+	CHECK(ParseHlsMediaPlaylist(text, "http://host/a/b/index.m3u8", &playlist));
+	CHECK(playlist.targetDuration == 6 && playlist.isEnded && !playlist.isEncrypted);
+	CHECK(playlist.initUrl == "http://host/a/b/init.mp4" && playlist.initOffset == 0 && playlist.initLength == 720);
+	CHECK(playlist.segments.size() == 3);
+	if (playlist.segments.size() != 3) return;
+	CHECK(playlist.segments[0].sequence == 7 && playlist.segments[0].offset == 720 && playlist.segments[0].length == 1000);
+	CHECK(playlist.segments[1].sequence == 8 && playlist.segments[1].offset == 1720 && playlist.segments[1].length == 2000);
+	CHECK(playlist.segments[2].url == "http://host/a/other/seg.m4s" && playlist.segments[2].length == -1);
+	CHECK(playlist.segments[2].isDiscontinuity && !playlist.segments[1].isDiscontinuity);
+	CHECK(playlist.Duration() == 15.5);
+
+	CHECK(ParseHlsMediaPlaylist("#EXTM3U\n#EXT-X-KEY:METHOD=AES-128,URI=\"k\"\n#EXTINF:2,\na.ts\n", "http://host/", &playlist));
+	CHECK(playlist.isEncrypted);
+	CHECK(!ParseHlsMediaPlaylist("#EXTM3U\na.ts\n", "http://host/", &playlist)); // no EXTINF
+	CHECK(!ParseHlsMediaPlaylist("<html></html>", "http://host/", &playlist));
+}
+
+void TestUrls() {
+	CHECK(ResolveHlsUrl("http://h/a/b.m3u8", "http://o/x.ts") == "http://o/x.ts");
+	CHECK(ResolveHlsUrl("https://h/a/b.m3u8", "//cdn/x.ts") == "https://cdn/x.ts");
+	CHECK(ResolveHlsUrl("http://h/a/b.m3u8", "/x.ts") == "http://h/x.ts");
+	CHECK(ResolveHlsUrl("http://h", "x.ts") == "http://h/x.ts");
+	CHECK(ResolveHlsUrl("http://h/a/b.m3u8", "../../x.ts") == "http://h/x.ts");
+	CHECK(IsHlsUrl("http://h/a.M3U8?x=y") && !IsHlsUrl("http://h/a.mp4?f=.m3u8"));
+}
+
+// --------------------------------------------------------------------------
+// ABR
+
+void TestAbr() {
+	AbrController abr({ BANDWIDTHS[0], BANDWIDTHS[1], BANDWIDTHS[2] }, 1000000);
+	CHECK(abr.EstimateBps() == 1000000);
+	CHECK(abr.SelectVariant(0, 0) == 0);
+	abr.OnDownload(8000, 1000); // latency, not throughput
+	CHECK(abr.EstimateBps() == 1000000);
+
+	for (int i = 0; i < 5; i++) abr.OnDownload(1000000, 1000000); // 8 Mb/s
+	CHECK(abr.EstimateBps() > 7999000 && abr.EstimateBps() <= 8000000);
+	CHECK(abr.SelectVariant(0, 2) == 0);  // up: not without a buffer
+	CHECK(abr.SelectVariant(0, 10) == 2);
+	CHECK(abr.SelectVariant(2, 1) == 1);  // down: at once, the estimate halved on a low buffer
+
+	// a drop counts quickly, by the fast average
+	for (int i = 0; i < 4; i++) abr.OnDownload(100000, 1000000); // 0.8 Mb/s
+	CHECK(abr.EstimateBps() < 3000000);
+	CHECK(abr.SelectVariant(2, 20) == 1);
+}
+
+// --------------------------------------------------------------------------
+// Streams
+
+// Up from the lowest variant once the buffer allows it, segments in order,
+// fetched in parallel
+void TestVod(LocalHttpServer& server) {
+	ServeVod(server, 12);
+	server.SetDelayMs(30);
+	HlsStream stream(server.Url("/master.m3u8"), HttpClient::Create(), HlsOptions());
+	CHECK(stream.Open());
+	CHECK(!stream.IsLive() && !stream.IsFragmentedMp4() && stream.DurationSec() == 24);
+	CHECK(WaitForFetched(stream, 12));
+	CHECK(stream.BufferedRanges() == (std::vector<std::pair<double, double>>{ { 0, 24 } }));
+
+	int previous = 0;
+	for (int i = 0; i < 12; i++) {
+		Block block = ReadBlock(stream);
+		CHECK(block.sequence == i && block.variant >= previous);
+		previous = block.variant;
+		if (i == 0) CHECK(block.variant == 0);
+	}
+	CHECK(previous == 2);
+	uint8_t byte;
+	CHECK(stream.Read(&byte, 1) == 0);
+
+	HlsStats stats = stream.GetStats();
+	CHECK(stats.variantCount == 3 && stats.variant == 2 && stats.bandwidth == BANDWIDTHS[2]);
+	CHECK(stats.switches >= 1 && stats.segmentsFetched == 12 && stats.fetchFailures == 0 && stats.pooledBytes == 0);
+	CHECK(server.MaxConcurrent() >= 2);
+	server.SetDelayMs(0);
+}
+
+// A slow server: down from the start variant at the next fetch
+void TestThrottled(LocalHttpServer& server) {
+	ServeVod(server, 8);
+	server.SetBytesPerSecond(250000); // 2 Mb/s per response
+	HlsOptions options;
+	options.initialBps = 10000000;
+	HlsStream stream(server.Url("/master.m3u8"), HttpClient::Create(), options);
+	CHECK(stream.Open());
+	CHECK(stream.GetStats().variant == 2);
+
+	Block block = { 0, 0 };
+	for (int i = 0; i < 6; i++) {
+		block = ReadBlock(stream);
+		CHECK(block.sequence == i);
+	}
+	CHECK(block.variant < 2);
+	HlsStats stats = stream.GetStats();
+	CHECK(stats.switches >= 1 && stats.estimateBps < BANDWIDTHS[2]);
+	stream.Close();
+	server.SetBytesPerSecond(0);
+}
+
+// Not read: the fetches stop at the pool bound (past it by the fetches in flight at most)
+void TestPoolBound(LocalHttpServer& server) {
+	ServeVod(server, 12);
+	HlsOptions options;
+	options.maxPoolBytes = 3 * SEGMENT_BYTES;
+	HlsStream stream(server.Url("/master.m3u8"), HttpClient::Create(), options);
+	CHECK(stream.Open());
+	CHECK(WaitForFetched(stream, 3));
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	HlsStats stats = stream.GetStats();
+	CHECK(stats.pooledBytes <= options.maxPoolBytes + options.parallelFetches * SEGMENT_BYTES);
+	CHECK(stats.segmentsFetched < 12);
+
+	for (int i = 0; i < 12; i++) CHECK(ReadBlock(stream).sequence == i);
+}
+
+// Fragmented MP4: the initialization segment, then byte ranges of one resource
+void TestByteRanges(LocalHttpServer& server) {
+	Bytes init(1000, 0xEE);
+	Bytes media;
+	std::string text = "#EXTM3U\n#EXT-X-TARGETDURATION:2\n#EXT-X-MAP:URI=\"init.mp4\"\n";
+	for (int i = 0; i < 5; i++) {
+		Bytes segment = Segment(0, i);
+		media.insert(media.end(), segment.begin(), segment.end());
+		text += "#EXTINF:2,\n#EXT-X-BYTERANGE:" + std::to_string(SEGMENT_BYTES) + (i == 0 ? "@0" : "") + "\nmedia.mp4\n";
+	}
+	text += "#EXT-X-ENDLIST\n";
+	server.SetResource("/fmp4/index.m3u8", text);
+	server.SetResource("/fmp4/init.mp4", init);
+	server.SetResource("/fmp4/media.mp4", media);
+
+	HlsStream stream(server.Url("/fmp4/index.m3u8"), HttpClient::Create(), HlsOptions());
+	CHECK(stream.Open());
+	CHECK(stream.IsFragmentedMp4() && stream.DurationSec() == 10);
+	Bytes head(init.size());
+	CHECK(stream.Read(head.data(), (int64_t)head.size()) == (int64_t)head.size() && head == init);
+	for (int i = 0; i < 5; i++) CHECK(ReadBlock(stream).sequence == i);
+	CHECK(ReadBlock(stream).variant == -1);
+	CHECK(server.Requests("/fmp4/media.mp4") == 5);
+	HlsStats stats = stream.GetStats();
+	CHECK(stats.variantCount == 1 && stats.bandwidth == 0);
+}
+
+// Starts three segments from the end, and follows the playlist as it slides
+void TestLive(LocalHttpServer& server) {
+	server.SetResource("/live/index.m3u8", MediaPlaylist(10, 6, false, 1));
+	for (int i = 10; i < 20; i++) server.SetResource("/live/" + std::to_string(i) + ".ts", Segment(0, i));
+
+	HlsStream stream(server.Url("/live/index.m3u8"), HttpClient::Create(), HlsOptions());
+	CHECK(stream.Open());
+	CHECK(stream.IsLive() && stream.DurationSec() == 0 && stream.GetStats().isLive);
+	for (int i = 13; i < 16; i++) CHECK(ReadBlock(stream).sequence == i);
+
+	server.SetResource("/live/index.m3u8", MediaPlaylist(13, 6, false, 1));
+	for (int i = 16; i < 19; i++) CHECK(ReadBlock(stream).sequence == i);
+	stream.Close();
+	uint8_t byte;
+	CHECK(stream.Read(&byte, 1) == -1);
+}
+
+void TestFailedOpens(LocalHttpServer& server) {
+	// a VOD segment missing: the read fails after the ones before it
+	server.SetResource("/gap/index.m3u8", MediaPlaylist(0, 4, true));
+	for (int i : { 0, 1, 3 }) server.SetResource("/gap/" + std::to_string(i) + ".ts", Segment(0, i));
+	HlsStream gap(server.Url("/gap/index.m3u8"), HttpClient::Create(), HlsOptions());
+	CHECK(gap.Open());
+	CHECK(ReadBlock(gap).sequence == 0);
+	CHECK(ReadBlock(gap).sequence == 1);
+	Block failed = ReadBlock(gap);
+	CHECK(failed.variant == -1 && failed.sequence == -1);
+	CHECK(gap.GetStats().fetchFailures >= 1);
+
+	server.SetResource("/encrypted.m3u8", "#EXTM3U\n#EXT-X-KEY:METHOD=AES-128,URI=\"k\"\n#EXTINF:2,\n0.ts\n#EXT-X-ENDLIST\n");
+	HlsStream encrypted(server.Url("/encrypted.m3u8"), HttpClient::Create(), HlsOptions());
+	CHECK(!encrypted.Open());
+
+	server.SetResource("/page.m3u8", "<html></html>");
+	HlsStream page(server.Url("/page.m3u8"), HttpClient::Create(), HlsOptions());
+	CHECK(!page.Open());
+	HlsStream missing(server.Url("/missing.m3u8"), HttpClient::Create(), HlsOptions());
+	CHECK(!missing.Open());
+}
+
+} // namespace
+
+int main() {
+	TestMasterPlaylist();
+	TestMediaPlaylist();
+	TestUrls();
+	TestAbr();
+
+	LocalHttpServer server;
+	CHECK(server.IsListening());
+	TestVod(server);
+	TestThrottled(server);
+	TestPoolBound(server);
+	TestByteRanges(server);
+	TestLive(server);
+	TestFailedOpens(server);
+	return TestResult();
+}
@@ -0,0 +1,226 @@
+// HttpClient, RangeReader and SegmentCache against a local stand-in server:
+// range responses and servers ignoring ranges, reads across segments and
+// seeks, the read-ahead window, and the segment cache serving a replay,
+// dropping another version of the resource, keeping to its byte budget and
+// serving offline (the cache in a directory of the working directory).
+
+#include "local_http_server.h"
+#include "range_reader.h"
+#include "test_check.h"
+
+#include <filesystem>
+#include <random>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const int64_t SEGMENT = RangeReader::SEGMENT_SIZE;
+
+typedef std::vector<uint8_t> Bytes;
+typedef std::vector<std::pair<int64_t, int64_t>> Ranges;
+
+Bytes RandomBytes(size_t size, unsigned seed) {
+	std::mt19937 random(seed);
+	Bytes bytes(size);
+	for (auto& byte : bytes) byte = (uint8_t)random();
+	return bytes;
+}
+
+bool ReadEquals(RangeReader& reader, int64_t offset, int64_t size, const Bytes& expected) {
+	Bytes data((size_t)size);
+	if (reader.Read(offset, data.data(), size) != size) return false;
+	return std::equal(data.begin(), data.end(), expected.begin() + offset);
+}
+
+// The whole resource, in reads not aligned to the segments
+bool ReadAll(RangeReader& reader, const Bytes& expected) {
+	const int64_t CHUNK = 300000;
+	for (int64_t offset = 0; offset < (int64_t)expected.size(); offset += CHUNK) {
+		if (!ReadEquals(reader, offset, std::min<int64_t>(CHUNK, expected.size() - offset), expected)) return false;
+	}
+	return true;
+}
+
+// Polls until the buffered ranges are 'expected', 5 s at most
+bool WaitForRanges(RangeReader& reader, const Ranges& expected) {
+	for (int i = 0; i < 500; i++) {
+		if (reader.BufferedRanges() == expected) return true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return false;
+}
+
+uint64_t CachedBytes() {
+	uint64_t total = 0;
+	std::error_code ec;
+	for (auto& entry : fs::recursive_directory_iterator("http_cache_test", ec)) {
+		if (entry.path().extension() == ".seg") total += entry.file_size();
+	}
+	return total;
+}
+
+void TestGetRange(LocalHttpServer& server) {
+	Bytes small = RandomBytes(1000, 1);
+	Bytes large = RandomBytes(10000, 2);
+	server.SetResource("/small", small, "v1");
+	server.SetResource("/large", large);
+	auto client = HttpClient::Create();
+
+	HttpResponse response;
+	CHECK(client->GetRange(server.Url("/small"), 100, 200, &response));
+	CHECK(response.status == 206 && response.totalLength == 1000 && response.validator == "\"v1\"");
+	CHECK(response.body == Bytes(small.begin() + 100, small.begin() + 300));
+
+	// past the end: the rest of the resource
+	CHECK(client->GetRange(server.Url("/small"), 900, 500, &response));
+	CHECK(response.status == 206 && response.body == Bytes(small.begin() + 900, small.end()));
+
+	// a server ignoring ranges: the whole resource if it fits the range asked for, else no body
+	server.SetIgnoreRanges(true);
+	CHECK(client->GetRange(server.Url("/small"), 0, 4096, &response));
+	CHECK(response.status == 200 && response.totalLength == 1000 && response.body == small);
+	CHECK(client->GetRange(server.Url("/large"), 0, 4096, &response));
+	CHECK(response.status == 200 && response.totalLength == 10000 && response.body.empty());
+	server.SetIgnoreRanges(false);
+
+	CHECK(client->GetRange(server.Url("/missing"), 0, 100, &response));
+	CHECK(response.status == 404 && response.body.empty());
+
+	LocalHttpServer stopped;
+	std::string url = stopped.Url("/small");
+	stopped.Stop();
+	CHECK(!client->GetRange(url, 0, 100, &response));
+	CHECK(response.status == 0);
+
+	CHECK(HttpClient::IsHttpUrl("HTTP://host/a.mp4") && HttpClient::IsHttpUrl("https://host/a.mp4"));
+	CHECK(!HttpClient::IsHttpUrl("file:///a.mp4"));
+}
+
+// Sequential reads, seeks, reads across a segment boundary and at the end,
+// each segment fetched once
+void TestRead(LocalHttpServer& server) {
+	Bytes movie = RandomBytes((size_t)(SEGMENT * 11 / 2), 3);
+	server.SetResource("/movie", movie, "m");
+
+	RangeReader reader(server.Url("/movie"), HttpClient::Create(), NULL, 2 * SEGMENT);
+	std::atomic<int> changes{0};
+	reader.SetChangeCallback([&changes]() { changes++; });
+	CHECK(reader.Open());
+	CHECK(reader.Length() == (int64_t)movie.size());
+
+	CHECK(ReadAll(reader, movie));
+	CHECK(ReadEquals(reader, 4 * SEGMENT - 50, 100, movie));
+	CHECK(ReadEquals(reader, 10, 1000, movie)); // back to the start
+
+	uint8_t tail[100];
+	CHECK(reader.Read(reader.Length() - 10, tail, sizeof(tail)) == 10);
+	CHECK(reader.Read(reader.Length(), tail, sizeof(tail)) == 0);
+	CHECK(reader.Read(-1, tail, sizeof(tail)) == -1);
+
+	CHECK(reader.BufferedRanges() == Ranges({ { 0, (int64_t)movie.size() } }));
+	reader.Close();
+	CHECK(server.Requests("/movie") == 6);
+	CHECK(changes == 5); // the first segment comes with Open()
+	CHECK(reader.Read(0, tail, sizeof(tail)) == -1);
+}
+
+// The read-ahead fetches its window past the read position, and no more
+void TestReadAhead(LocalHttpServer& server) {
+	Bytes movie = RandomBytes((size_t)(SEGMENT * 11 / 2), 4);
+	server.SetResource("/ahead", movie);
+
+	RangeReader reader(server.Url("/ahead"), HttpClient::Create(), NULL, 2 * SEGMENT);
+	CHECK(reader.Open());
+	CHECK(WaitForRanges(reader, { { 0, 2 * SEGMENT } }));
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	CHECK(server.Requests("/ahead") == 2);
+
+	// a seek: the window moves with the read position
+	CHECK(ReadEquals(reader, SEGMENT * 9 / 2, 10, movie));
+	CHECK(WaitForRanges(reader, { { 0, 2 * SEGMENT }, { 4 * SEGMENT, (int64_t)movie.size() } }));
+	CHECK(server.Requests("/ahead") == 4);
+}
+
+// Replays from the disk, a new version, offline, the byte budget
+void TestSegmentCache(LocalHttpServer& server) {
+	SegmentCache& cache = SegmentCache::Shared();
+	CHECK(cache.IsEnabled());
+	std::string url = server.Url("/cached");
+	Bytes first = RandomBytes((size_t)(SEGMENT * 7 / 2), 5);
+	server.SetResource("/cached", first, "a");
+	{
+		RangeReader reader(url, HttpClient::Create(), &cache, 0);
+		CHECK(reader.Open());
+		CHECK(ReadAll(reader, first));
+	}
+	CHECK(cache.ListSegments(url) == std::vector<int64_t>({ 0, 1, 2, 3 }));
+	int64_t length = 0;
+	std::string validator;
+	CHECK(cache.LoadResource(url, &length, &validator));
+	CHECK(length == (int64_t)first.size() && validator == "\"a\"");
+	CHECK(server.Requests("/cached") == 4);
+
+	// the same version: only the first segment asked for, to check it
+	{
+		RangeReader reader(url, HttpClient::Create(), &cache, 0);
+		CHECK(reader.Open());
+		CHECK(reader.BufferedRanges() == Ranges({ { 0, (int64_t)first.size() } }));
+		CHECK(ReadAll(reader, first));
+	}
+	CHECK(server.Requests("/cached") == 5);
+
+	// another version: the segments of the first one are not mixed in
+	Bytes second = RandomBytes(first.size(), 6);
+	server.SetResource("/cached", second, "b");
+	{
+		RangeReader reader(url, HttpClient::Create(), &cache, 0);
+		CHECK(reader.Open());
+		CHECK(reader.BufferedRanges() == Ranges({ { 0, SEGMENT } }));
+		CHECK(ReadAll(reader, second));
+	}
+	CHECK(server.Requests("/cached") == 9);
+
+	// offline, from the disk only
+	server.Stop();
+	{
+		RangeReader reader(url, HttpClient::Create(), &cache, 0);
+		CHECK(reader.Open());
+		CHECK(reader.Length() == (int64_t)second.size());
+		CHECK(ReadAll(reader, second));
+	}
+
+	// over the budget: the least recently used segments go, and can't be read offline
+	cache.SetMaxBytes((uint64_t)(SEGMENT * 5 / 2));
+	CHECK(CachedBytes() <= (uint64_t)(SEGMENT * 5 / 2));
+	std::vector<int64_t> kept = cache.ListSegments(url);
+	CHECK(!kept.empty() && kept.size() < 4);
+	{
+		RangeReader reader(url, HttpClient::Create(), &cache, 0);
+		CHECK(reader.Open());
+		for (int64_t index = 0; index < 4; index++) {
+			uint8_t byte;
+			bool isKept = std::find(kept.begin(), kept.end(), index) != kept.end();
+			CHECK(reader.Read(index * SEGMENT, &byte, 1) == (isKept ? 1 : -1));
+		}
+	}
+	cache.SetMaxBytes(SegmentCache::DEFAULT_MAX_BYTES);
+}
+
+} // namespace
+
+int main() {
+	// the cache in <temp>/video_player_win/http, the temporary directory here
+	std::error_code ec;
+	fs::remove_all("http_cache_test", ec);
+	fs::create_directories("http_cache_test");
+	setenv("TMPDIR", fs::absolute("http_cache_test").c_str(), 1);
+
+	LocalHttpServer server;
+	CHECK(server.IsListening());
+	TestGetRange(server);
+	TestRead(server);
+	TestReadAhead(server);
+	TestSegmentCache(server);
+	return TestResult();
+}
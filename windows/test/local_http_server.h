@@ -0,0 +1,210 @@
+#pragma once
+
+// A stand-in HTTP server on 127.0.0.1 for the network source tests: it serves
+// resources set in memory, with range requests (206 and Content-Range), an
+// ETag per resource, and optionally a delay before each response, a throttled
+// body or ranges ignored (200 with the whole resource). One request per
+// connection, each on its own thread. POSIX sockets.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+class LocalHttpServer {
+public:
+	LocalHttpServer() {
+		m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+		int reuse = 1;
+		setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = 0; // any free port
+		socklen_t size = sizeof(address);
+		if (bind(m_listenFd, (sockaddr*)&address, sizeof(address)) == 0 && listen(m_listenFd, 64) == 0 &&
+			getsockname(m_listenFd, (sockaddr*)&address, &size) == 0) {
+			m_port = ntohs(address.sin_port);
+			m_acceptThread = std::thread([this]() { AcceptThread(); });
+		}
+	}
+
+	~LocalHttpServer() {
+		Stop();
+		std::vector<std::thread> connections;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			connections.swap(m_connections);
+		}
+		for (auto& thread : connections) thread.join();
+	}
+
+	bool IsListening() const { return m_port != 0; }
+
+	std::string Url(const std::string& path) const { return "http://127.0.0.1:" + std::to_string(m_port) + path; }
+
+	// An empty 'etag' sends none
+	void SetResource(const std::string& path, const std::vector<uint8_t>& body, const std::string& etag = "") {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_resources[path] = Resource{ body, etag };
+	}
+
+	void SetResource(const std::string& path, const std::string& text) {
+		SetResource(path, std::vector<uint8_t>(text.begin(), text.end()));
+	}
+
+	void RemoveResource(const std::string& path) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_resources.erase(path);
+	}
+
+	void SetDelayMs(int delayMs) { m_delayMs = delayMs; }
+	// Body bytes per second of each response, 0 for no limit
+	void SetBytesPerSecond(int64_t bytesPerSecond) { m_bytesPerSecond = bytesPerSecond; }
+	void SetIgnoreRanges(bool isIgnoring) { m_isIgnoringRanges = isIgnoring; }
+
+	// Requests of 'path' answered so far (404 included)
+	int Requests(const std::string& path) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_requests.find(path);
+		return it == m_requests.end() ? 0 : it->second;
+	}
+
+	// Most responses in progress at once
+	int MaxConcurrent() const { return m_maxConcurrent; }
+
+	// Closes the listening socket: the next connections are refused
+	void Stop() {
+		if (m_listenFd < 0) return;
+		shutdown(m_listenFd, SHUT_RDWR);
+		if (m_acceptThread.joinable()) m_acceptThread.join();
+		close(m_listenFd);
+		m_listenFd = -1;
+	}
+
+private:
+	struct Resource {
+		std::vector<uint8_t> body;
+		std::string etag;
+	};
+
+	void AcceptThread() {
+		for (;;) {
+			int fd = accept(m_listenFd, NULL, NULL);
+			if (fd < 0) return;
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_connections.emplace_back([this, fd]() {
+				Serve(fd);
+				close(fd);
+			});
+		}
+	}
+
+	void Serve(int fd) {
+		std::string request;
+		char buffer[4096];
+		while (request.find("\r\n\r\n") == std::string::npos) {
+			ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+			if (n <= 0 || request.size() > 65536) return;
+			request.append(buffer, (size_t)n);
+		}
+		size_t pathStart = request.find(' ') + 1;
+		std::string path = request.substr(pathStart, request.find(' ', pathStart) - pathStart);
+
+		int64_t first = -1;
+		int64_t last = -1;
+		size_t range = request.find("\r\nRange: bytes=");
+		if (range != std::string::npos) {
+			char* end = NULL;
+			first = strtoll(request.c_str() + range + strlen("\r\nRange: bytes="), &end, 10);
+			last = *end == '-' ? strtoll(end + 1, NULL, 10) : -1;
+		}
+
+		int concurrent = ++m_concurrent;
+		for (int max = m_maxConcurrent; concurrent > max && !m_maxConcurrent.compare_exchange_weak(max, concurrent);) {
+		}
+		if (m_delayMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(m_delayMs));
+
+		Resource resource;
+		bool isFound;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_requests[path]++;
+			auto it = m_resources.find(path);
+			isFound = it != m_resources.end();
+			if (isFound) resource = it->second;
+		}
+
+		std::string headers;
+		int64_t start = 0;
+		int64_t count = 0;
+		int64_t total = (int64_t)resource.body.size();
+		if (!isFound) {
+			headers = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n";
+		} else if (first < 0 || m_isIgnoringRanges) {
+			headers = "HTTP/1.1 200 OK\r\n";
+			count = total;
+		} else if (first >= total) {
+			headers = "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */" + std::to_string(total) + "\r\nContent-Length: 0\r\n";
+		} else {
+			start = first;
+			count = std::min(last < 0 ? total : last + 1, total) - first;
+			headers = "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes " + std::to_string(start) + "-" +
+				std::to_string(start + count - 1) + "/" + std::to_string(total) + "\r\n";
+		}
+		if (isFound && headers.find("Content-Length") == std::string::npos) headers += "Content-Length: " + std::to_string(count) + "\r\n";
+		if (!resource.etag.empty()) headers += "ETag: \"" + resource.etag + "\"\r\n";
+		headers += "Connection: close\r\n\r\n";
+
+		if (SendAll(fd, (const uint8_t*)headers.data(), headers.size())) SendBody(fd, resource.body.data() + start, count);
+		m_concurrent--;
+	}
+
+	// In chunks spaced to the throttle, if any
+	void SendBody(int fd, const uint8_t* pData, int64_t size) {
+		const int64_t CHUNK = 16 * 1024;
+		auto start = std::chrono::steady_clock::now();
+		for (int64_t sent = 0; sent < size;) {
+			int64_t count = std::min(CHUNK, size - sent);
+			if (!SendAll(fd, pData + sent, (size_t)count)) return;
+			sent += count;
+			int64_t bytesPerSecond = m_bytesPerSecond;
+			if (bytesPerSecond > 0) std::this_thread::sleep_until(start + std::chrono::microseconds(sent * 1000000 / bytesPerSecond));
+		}
+	}
+
+	static bool SendAll(int fd, const uint8_t* pData, size_t size) {
+		while (size > 0) {
+			ssize_t n = send(fd, pData, size, MSG_NOSIGNAL);
+			if (n <= 0) return false;
+			pData += n;
+			size -= (size_t)n;
+		}
+		return true;
+	}
+
+	int m_listenFd = -1;
+	int m_port = 0;
+	std::thread m_acceptThread;
+	std::atomic<int> m_delayMs{0};
+	std::atomic<int64_t> m_bytesPerSecond{0};
+	std::atomic<bool> m_isIgnoringRanges{false};
+	std::atomic<int> m_concurrent{0};
+	std::atomic<int> m_maxConcurrent{0};
+
+	std::mutex m_mutex;
+	std::map<std::string, Resource> m_resources;
+	std::map<std::string, int> m_requests;
+	std::vector<std::thread> m_connections;
+};
@@ -0,0 +1,86 @@
+// LoopFrameCache recording a pass: the frames read back, a pass over the
+// budget given up, and frames recorded faster than the worker pool takes them
+// (compressed on the recording thread past the raw bytes allowed to wait).
+// Off Windows nothing compresses: the frames are kept raw.
+
+#include "loop_frame_cache.h"
+#include "test_check.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int64_t HNS_PER_FRAME = 400000;
+
+LoopFrameCache::State WaitRecorded(LoopFrameCache& cache) {
+	auto end = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	while (cache.GetState() == LoopFrameCache::RECORDED && std::chrono::steady_clock::now() < end) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return cache.GetState();
+}
+
+// A pass of 'count' frames, the pixels of a frame set to its index
+LoopFrameCache::State Record(LoopFrameCache& cache, uint32_t width, uint32_t height, int count) {
+	std::vector<uint8_t> pixels((size_t)width * height * 4);
+	cache.BeginRecording(width, height);
+	for (int i = 0; i < count; i++) {
+		std::fill(pixels.begin(), pixels.end(), (uint8_t)i);
+		cache.AddFrame(i * HNS_PER_FRAME, width, height, pixels.data());
+	}
+	cache.EndRecording(count * HNS_PER_FRAME);
+	return WaitRecorded(cache);
+}
+
+bool CheckFrames(LoopFrameCache& cache, int count) {
+	std::vector<uint8_t> pixels((size_t)cache.Width() * cache.Height() * 4);
+	if (cache.FrameCount() != (size_t)count) return false;
+	for (int i = 0; i < count; i++) {
+		if (!cache.ReadFrame(i, pixels.data()) || cache.FrameTime(i) != i * HNS_PER_FRAME) return false;
+		for (uint8_t value : pixels) {
+			if (value != (uint8_t)i) return false;
+		}
+	}
+	return true;
+}
+
+void TestReplay() {
+	for (bool isCompressed : { false, true }) {
+		LoopFrameCache cache(64 * 48 * 4 * 30, isCompressed);
+		CHECK(Record(cache, 64, 48, 30) == LoopFrameCache::READY);
+		CHECK(cache.Duration() == 30 * HNS_PER_FRAME);
+		CHECK(CheckFrames(cache, 30));
+		CHECK(cache.MemoryUsage() <= 64 * 48 * 4 * 30);
+	}
+}
+
+void TestOverBudget() {
+	for (bool isCompressed : { false, true }) {
+		LoopFrameCache cache(64 * 48 * 4 * 20, isCompressed);
+		CHECK(Record(cache, 64, 48, 30) == LoopFrameCache::FAILED);
+		CHECK(cache.MemoryUsage() == 0);
+		CHECK(Record(cache, 64, 48, 10) == LoopFrameCache::FAILED); // until Reset()
+		cache.Reset();
+		CHECK(Record(cache, 64, 48, 10) == LoopFrameCache::READY);
+	}
+}
+
+// 1080p frames, more than the raw bytes allowed to wait for the workers
+void TestBackPressure() {
+	const int count = 24;
+	LoopFrameCache cache((size_t)1920 * 1080 * 4 * count, true);
+	CHECK(Record(cache, 1920, 1080, count) == LoopFrameCache::READY);
+	CHECK(CheckFrames(cache, count));
+}
+
+} // namespace
+
+int main() {
+	TestReplay();
+	TestOverBudget();
+	TestBackPressure();
+	return TestResult();
+}
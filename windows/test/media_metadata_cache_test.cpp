@@ -0,0 +1,125 @@
+// MediaMetadataCache on an index in the working directory: lookups, records
+// made stale by a modified file, and processes storing into the same index at
+// once (none of their records lost).
+
+#include "media_metadata_cache.h"
+#include "test_check.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const int PROCESSES = 8;
+const int FILES_PER_PROCESS = 100; // a fifth of the capacity: no record evicted
+
+const fs::path INDEX_PATH = "metadata_cache_test/metadata.idx";
+const fs::path MEDIA_DIR = "metadata_cache_test/media";
+
+fs::path MediaPath(int index) { return MEDIA_DIR / ("clip" + std::to_string(index) + ".mp4"); }
+
+void WriteMedia(const fs::path& path, const std::string& content) {
+	std::ofstream(path, std::ios::binary) << content;
+}
+
+MediaMetadata Metadata(int index) {
+	MediaMetadata metadata;
+	metadata.durationMs = 1000 + index;
+	metadata.videoWidth = 1920;
+	metadata.videoHeight = 1080;
+	metadata.videoStreams = 1;
+	return metadata;
+}
+
+void TestLookup() {
+	MediaMetadataCache& cache = MediaMetadataCache::Instance();
+	CHECK(cache.Open(INDEX_PATH));
+
+	fs::path path = MediaPath(0);
+	WriteMedia(path, "first");
+	MediaMetadata metadata;
+	CHECK(!cache.Lookup(path, &metadata));
+	cache.Store(path, Metadata(0));
+	CHECK(cache.Lookup(path, &metadata));
+	CHECK(metadata.durationMs == 1000);
+	CHECK(!cache.Contains(MediaPath(1)));
+
+	// another size: the record is stale, and is replaced in place
+	WriteMedia(path, "modified");
+	CHECK(!cache.Lookup(path, &metadata));
+	cache.Store(path, Metadata(7));
+	CHECK(cache.Lookup(path, &metadata));
+	CHECK(metadata.durationMs == 1007);
+
+	// the records survive closing the index
+	cache.Close();
+	CHECK(cache.Open(INDEX_PATH));
+	CHECK(cache.Lookup(path, &metadata));
+	CHECK(metadata.durationMs == 1007);
+}
+
+#ifndef _WIN32
+// Each process opens the index on its own (its own file lock) and stores its files
+void TestProcesses() {
+	int count = PROCESSES * FILES_PER_PROCESS;
+	for (int i = 0; i < count; i++) WriteMedia(MediaPath(i), "clip");
+
+	// the children start storing together, when the pipe is closed
+	int start[2];
+	CHECK(pipe(start) == 0);
+	std::vector<pid_t> children;
+	for (int p = 0; p < PROCESSES; p++) {
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(start[1]);
+			MediaMetadataCache& cache = MediaMetadataCache::Instance();
+			if (!cache.Open(INDEX_PATH)) _exit(1);
+			char c;
+			if (read(start[0], &c, 1) != 0) _exit(1);
+			for (int i = p; i < count; i += PROCESSES) cache.Store(MediaPath(i), Metadata(i));
+			_exit(0);
+		}
+		CHECK(pid > 0);
+		if (pid > 0) children.push_back(pid);
+	}
+	close(start[0]);
+	close(start[1]);
+	for (pid_t pid : children) {
+		int status = 0;
+		CHECK(waitpid(pid, &status, 0) == pid);
+		CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	}
+
+	MediaMetadataCache& cache = MediaMetadataCache::Instance();
+	CHECK(cache.Open(INDEX_PATH));
+	int found = 0;
+	for (int i = 0; i < count; i++) {
+		MediaMetadata metadata;
+		if (cache.Lookup(MediaPath(i), &metadata) && metadata.durationMs == 1000 + i) found++;
+	}
+	CHECK(found == count);
+}
+#endif
+
+} // namespace
+
+int main() {
+	std::error_code ec;
+	fs::remove_all("metadata_cache_test", ec);
+	fs::create_directories(MEDIA_DIR);
+
+	TestLookup();
+#ifndef _WIN32
+	TestProcesses();
+#endif
+	MediaMetadataCache::Instance().Close();
+	return TestResult();
+}
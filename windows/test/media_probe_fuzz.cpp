@@ -0,0 +1,84 @@
+// Fuzz target of the container probe: ProbeMediaBuffer() on arbitrary bytes.
+//
+// With libFuzzer (clang, -DFUZZ=ON): media_probe_fuzz [corpus directory]
+// Without it, main() runs the target on mutations of small MP4 and Matroska
+// files, a fixed number of times from a fixed seed:
+//
+//   media_probe_fuzz [iterations, default 100000]
+
+#include "media_probe.h"
+#include "mkv_builder.h"
+
+#include <cstdlib>
+#include <random>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	MediaMetadata metadata;
+	ProbeMediaBuffer(data, size, &metadata);
+	return 0;
+}
+
+#ifndef FUZZ_WITH_LIBFUZZER
+
+namespace {
+
+// Boxes and elements nested a few levels, for the mutations to break
+std::vector<Bytes> Seeds() {
+	Bytes stsd = Concat({ Bytes{ 0, 0, 0, 0, 0, 0, 0, 1 }, Box("avc1", Bytes(28, 1)) });
+	Bytes stbl = Concat({ Box("stsd", stsd), FullBox("stts", 0, { 1, 10, 40 }), FullBox("stsz", 0, { 0, 10 }) });
+	Bytes mp4 = Mp4File(Concat({ FullBox("mvhd", 0, { 0, 0, 1000, 400 }), Track("vide", 1000, 400, stbl),
+		Box("mvex", FullBox("mehd", 0, { 400 })) }), 16);
+
+	Bytes track = Element(0xAE, Concat({ UIntElement(0x83, 1), StringElement(0x86, "V_VP9"), UIntElement(0x23E383, 40000000),
+		Element(0xE0, Concat({ UIntElement(0xB0, 64), UIntElement(0xBA, 48) })) }));
+	Bytes seek = Element(0x4DBB, Concat({ UIntElement(0x53AB, 0x1654AE6B), UIntElement(0x53AC, 0) }));
+	Bytes segment = Concat({ Element(0x114D9B74, seek),
+		Element(0x1549A966, Concat({ UIntElement(0x2AD7B1, 1000000), FloatElement(0x4489, 400.0) })),
+		Element(0x1654AE6B, track), UnknownSizeElement(0x1F43B675, Bytes(16, 0)) });
+	Bytes mkv = Concat({ Element(0x1A45DFA3, StringElement(0x4282, "webm")), Element(0x18538067, segment) });
+	return { mp4, mkv };
+}
+
+// Bytes set, ones flipped, a cut, a span duplicated
+Bytes Mutate(const Bytes& seed, std::mt19937& random) {
+	Bytes bytes = seed;
+	int count = 1 + random() % 8;
+	for (int i = 0; i < count && !bytes.empty(); i++) {
+		size_t pos = random() % bytes.size();
+		switch (random() % 5) {
+		case 0: bytes[pos] = (uint8_t)random(); break;
+		case 1: bytes[pos] ^= (uint8_t)(1 << (random() % 8)); break;
+		case 2: bytes[pos] = random() % 2 ? 0xFF : 0x00; break;
+		case 3: bytes.resize(pos); break;
+		default: {
+			size_t len = random() % 16;
+			if (len > bytes.size() - pos) len = bytes.size() - pos;
+			Bytes span(bytes.begin() + pos, bytes.begin() + pos + len);
+			bytes.insert(bytes.begin() + random() % bytes.size(), span.begin(), span.end());
+		}
+		}
+	}
+	return bytes;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	long iterations = argc > 1 ? atol(argv[1]) : 100000;
+	std::vector<Bytes> seeds = Seeds();
+	std::mt19937 random(1);
+	for (long i = 0; i < iterations; i++) {
+		// a copy of just the input, so a read past it is caught
+		Bytes input = Mutate(seeds[i % seeds.size()], random);
+		uint8_t* data = input.empty() ? NULL : new uint8_t[input.size()];
+		if (data != NULL) memcpy(data, input.data(), input.size());
+		LLVMFuzzerTestOneInput(data, input.size());
+		delete[] data;
+	}
+	printf("%ld inputs\n", iterations);
+	return 0;
+}
+
+#endif
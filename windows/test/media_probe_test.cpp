@@ -0,0 +1,218 @@
+// ProbeMediaBuffer / ProbeMediaFile on MP4 and Matroska files built in memory:
+// duration, video size, frame rate and codecs, the headers found where they
+// are placed, and truncated or corrupted files read without going out of bounds.
+
+#include "media_probe.h"
+#include "mkv_builder.h"
+#include "test_check.h"
+
+#include <random>
+
+namespace {
+
+const uint32_t AUDIO_AAC = 0x1610;
+const uint32_t AUDIO_OPUS = 0x704F;
+
+const uint32_t EBML_HEADER = 0x1A45DFA3;
+const uint32_t MKV_SEGMENT = 0x18538067;
+const uint32_t MKV_SEEKHEAD = 0x114D9B74;
+const uint32_t MKV_SEEK = 0x4DBB;
+const uint32_t MKV_SEEKID = 0x53AB;
+const uint32_t MKV_SEEKPOSITION = 0x53AC;
+const uint32_t MKV_INFO = 0x1549A966;
+const uint32_t MKV_TIMECODESCALE = 0x2AD7B1;
+const uint32_t MKV_DURATION = 0x4489;
+const uint32_t MKV_TRACKS = 0x1654AE6B;
+const uint32_t MKV_TRACKENTRY = 0xAE;
+const uint32_t MKV_TRACKTYPE = 0x83;
+const uint32_t MKV_CODECID = 0x86;
+const uint32_t MKV_DEFAULTDURATION = 0x23E383;
+const uint32_t MKV_VIDEO = 0xE0;
+const uint32_t MKV_PIXELWIDTH = 0xB0;
+const uint32_t MKV_PIXELHEIGHT = 0xBA;
+const uint32_t MKV_CLUSTER = 0x1F43B675;
+
+MediaContainer Probe(const Bytes& file, MediaMetadata* pMetadata) {
+	return ProbeMediaBuffer(file.data(), file.size(), pMetadata);
+}
+
+// --------------------------------------------------------------------------
+// MP4
+
+Bytes Mvhd(uint32_t timescale, uint32_t duration) { return FullBox("mvhd", 0, { 0, 0, timescale, duration }); }
+
+// The first sample entry of stsd: a VisualSampleEntry of 'width' x 'height', or an
+// AudioSampleEntry
+Bytes Stsd(const char (&entryType)[5], uint16_t width = 0, uint16_t height = 0) {
+	Bytes entry(28, 0);
+	entry[7] = 1; // data_reference_index
+	entry[24] = (uint8_t)(width >> 8);
+	entry[25] = (uint8_t)width;
+	entry[26] = (uint8_t)(height >> 8);
+	entry[27] = (uint8_t)height;
+	Bytes payload = { 0, 0, 0, 0 };
+	AppendBE32(&payload, 1);
+	return Box("stsd", Concat({ payload, Box(entryType, entry) }));
+}
+
+// 10 s, 1920x1080 H.264 at 25 fps and AAC, the moov after the media data
+Bytes Mp4Sample() {
+	Bytes video = Track("vide", 1000, 10000, Concat({ Stsd("avc1", 1920, 1080), FullBox("stts", 0, { 1, 250, 40 }) }));
+	Bytes audio = Track("soun", 48000, 480000, Stsd("mp4a"));
+	return Mp4File(Concat({ Mvhd(1000, 10000), video, audio }));
+}
+
+void TestMp4() {
+	MediaMetadata metadata;
+	CHECK(Probe(Mp4Sample(), &metadata) == CONTAINER_ISO_BMFF);
+	CHECK(metadata.durationMs == 10000);
+	CHECK(metadata.videoWidth == 1920 && metadata.videoHeight == 1080);
+	CHECK(metadata.frameRateNumerator == 1000 && metadata.frameRateDenominator == 40);
+	CHECK(metadata.videoCodec == MakeFourcc("H264"));
+	CHECK(metadata.audioCodec == AUDIO_AAC);
+	CHECK(metadata.videoStreams == 1 && metadata.audioStreams == 1);
+}
+
+// The frame rate averaged from the sample count when the sample durations vary
+void TestMp4VariableFrameRate() {
+	Bytes stts = FullBox("stts", 0, { 2, 100, 30, 200, 35 }); // 100 + 200 samples in 10 s
+	Bytes stsz = FullBox("stsz", 0, { 0, 300 });
+	Bytes video = Track("vide", 1000, 10000, Concat({ Stsd("hvc1", 3840, 2160), stts, stsz }));
+	MediaMetadata metadata;
+	CHECK(Probe(Mp4File(Concat({ Mvhd(1000, 10000), video })), &metadata) == CONTAINER_ISO_BMFF);
+	CHECK(metadata.videoCodec == MakeFourcc("HEVC"));
+	CHECK(metadata.frameRateNumerator == 30000 && metadata.frameRateDenominator == 1000);
+	CHECK(metadata.audioStreams == 0);
+}
+
+// A fragmented MP4: no duration in mvhd, the one of mehd
+void TestMp4Fragmented() {
+	Bytes mvex = Box("mvex", FullBox("mehd", 0, { 90000 * 6 }));
+	Bytes video = Track("vide", 90000, 0, Stsd("av01", 1280, 720));
+	MediaMetadata metadata;
+	CHECK(Probe(Mp4File(Concat({ Mvhd(90000, 0), mvex, video })), &metadata) == CONTAINER_ISO_BMFF);
+	CHECK(metadata.durationMs == 6000);
+	CHECK(metadata.videoCodec == MakeFourcc("AV01"));
+}
+
+// --------------------------------------------------------------------------
+// Matroska
+
+Bytes EbmlHeader() { return Element(EBML_HEADER, StringElement(0x4282, "webm")); }
+
+Bytes MkvInfo() {
+	return Element(MKV_INFO, Concat({ UIntElement(MKV_TIMECODESCALE, 1000000), FloatElement(MKV_DURATION, 5000.0) }));
+}
+
+Bytes MkvTracks() {
+	Bytes video = Element(MKV_TRACKENTRY, Concat({ UIntElement(MKV_TRACKTYPE, 1), StringElement(MKV_CODECID, "V_VP9"),
+		UIntElement(MKV_DEFAULTDURATION, 40000000),
+		Element(MKV_VIDEO, Concat({ UIntElement(MKV_PIXELWIDTH, 1280), UIntElement(MKV_PIXELHEIGHT, 720) })) }));
+	Bytes audio = Element(MKV_TRACKENTRY, Concat({ UIntElement(MKV_TRACKTYPE, 2), StringElement(MKV_CODECID, "A_OPUS") }));
+	return Element(MKV_TRACKS, Concat({ video, audio }));
+}
+
+Bytes Cluster() { return Element(MKV_CLUSTER, Bytes(200, 0)); }
+
+void CheckMkvMetadata(const MediaMetadata& metadata) {
+	CHECK(metadata.durationMs == 5000);
+	CHECK(metadata.videoWidth == 1280 && metadata.videoHeight == 720);
+	CHECK(metadata.frameRateNumerator == 25000 && metadata.frameRateDenominator == 1000);
+	CHECK(metadata.videoCodec == MakeFourcc("VP90"));
+	CHECK(metadata.audioCodec == AUDIO_OPUS);
+}
+
+Bytes MkvSample() { return Concat({ EbmlHeader(), Element(MKV_SEGMENT, Concat({ MkvInfo(), MkvTracks(), Cluster() })) }); }
+
+void TestMatroska() {
+	MediaMetadata metadata;
+	CHECK(Probe(MkvSample(), &metadata) == CONTAINER_MATROSKA);
+	CheckMkvMetadata(metadata);
+}
+
+// The headers after the clusters, found through the seek head
+void TestMatroskaSeekHead() {
+	Bytes cluster = Cluster();
+	Bytes info = MkvInfo();
+	auto seekHead = [](uint64_t infoPos, uint64_t tracksPos) {
+		Bytes seekInfo = Element(MKV_SEEK, Concat({ UIntElement(MKV_SEEKID, MKV_INFO), UIntElement(MKV_SEEKPOSITION, infoPos) }));
+		Bytes seekTracks = Element(MKV_SEEK, Concat({ UIntElement(MKV_SEEKID, MKV_TRACKS), UIntElement(MKV_SEEKPOSITION, tracksPos) }));
+		return Element(MKV_SEEKHEAD, Concat({ seekInfo, seekTracks }));
+	};
+	size_t headSize = seekHead(0, 0).size(); // fixed-size integers: the same with the real positions
+	Bytes segment = Concat({ seekHead(headSize + cluster.size(), headSize + cluster.size() + info.size()), cluster, info, MkvTracks() });
+	MediaMetadata metadata;
+	CHECK(Probe(Concat({ EbmlHeader(), Element(MKV_SEGMENT, segment) }), &metadata) == CONTAINER_MATROSKA);
+	CheckMkvMetadata(metadata);
+}
+
+// A live stream: the segment and the clusters of unknown size
+void TestMatroskaUnknownSize() {
+	Bytes file = Concat({ EbmlHeader(), UnknownSizeElement(MKV_SEGMENT, Concat({ MkvInfo(), MkvTracks(),
+		UnknownSizeElement(MKV_CLUSTER, Bytes(100, 0)) })) });
+	MediaMetadata metadata;
+	CHECK(Probe(file, &metadata) == CONTAINER_MATROSKA);
+	CheckMkvMetadata(metadata);
+}
+
+// --------------------------------------------------------------------------
+
+void TestFile() {
+	Bytes file = Mp4Sample();
+	CHECK(WriteFile("probe_sample.mp4", file));
+	MediaMetadata fromFile, fromBuffer;
+	CHECK(ProbeMediaFile("probe_sample.mp4", &fromFile) == CONTAINER_ISO_BMFF);
+	CHECK(Probe(file, &fromBuffer) == CONTAINER_ISO_BMFF);
+	CHECK(fromFile.durationMs == fromBuffer.durationMs && fromFile.videoWidth == fromBuffer.videoWidth);
+	CHECK(ProbeMediaFile("missing.mp4", &fromFile) == CONTAINER_UNKNOWN);
+	CHECK(fromFile.durationMs == -1);
+}
+
+void TestUnknown() {
+	MediaMetadata metadata;
+	CHECK(Probe(Bytes(), &metadata) == CONTAINER_UNKNOWN);
+	CHECK(Probe(Box("abcd", Bytes(64, 0)), &metadata) == CONTAINER_UNKNOWN);
+	CHECK(metadata.durationMs == -1 && metadata.videoStreams == 0);
+}
+
+// Every prefix of the samples: no read out of the buffer (a copy of just the
+// prefix, so a sanitizer or the allocator catches one)
+void TestTruncated() {
+	for (const Bytes& file : { Mp4Sample(), MkvSample() }) {
+		for (size_t size = 0; size <= file.size(); size++) {
+			Bytes prefix(file.begin(), file.begin() + size);
+			MediaMetadata metadata;
+			MediaContainer container = ProbeMediaBuffer(prefix.empty() ? NULL : prefix.data(), prefix.size(), &metadata);
+			CHECK(container == CONTAINER_UNKNOWN || metadata.videoStreams <= 1);
+		}
+	}
+}
+
+// Corrupted bytes: the probe returns, whatever it finds
+void TestCorrupted() {
+	std::mt19937 random(1);
+	for (const Bytes& file : { Mp4Sample(), MkvSample() }) {
+		for (int i = 0; i < 2000; i++) {
+			Bytes corrupted = file;
+			for (int j = 0; j < 4; j++) corrupted[random() % corrupted.size()] = (uint8_t)random();
+			MediaMetadata metadata;
+			Probe(corrupted, &metadata);
+		}
+	}
+}
+
+} // namespace
+
+int main() {
+	TestMp4();
+	TestMp4VariableFrameRate();
+	TestMp4Fragmented();
+	TestMatroska();
+	TestMatroskaSeekHead();
+	TestMatroskaUnknownSize();
+	TestFile();
+	TestUnknown();
+	TestTruncated();
+	TestCorrupted();
+	return TestResult();
+}
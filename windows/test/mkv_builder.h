@@ -0,0 +1,43 @@
+#pragma once
+
+// Builds Matroska (EBML) files in memory for the parser tests: an element is
+// its ID (with the length marker bits) and payload, the sizes are filled in.
+
+#include "mp4_builder.h"
+
+#include <cstring>
+
+// The ID bytes, then the size on 8 bytes (any size fits it)
+inline Bytes Element(uint32_t id, const Bytes& payload) {
+	Bytes element;
+	int idBytes = id > 0xFFFFFF ? 4 : id > 0xFFFF ? 3 : id > 0xFF ? 2 : 1;
+	for (int i = idBytes - 1; i >= 0; i--) element.push_back((uint8_t)(id >> (i * 8)));
+	element.push_back(0x01);
+	uint64_t size = payload.size();
+	for (int shift = 48; shift >= 0; shift -= 8) element.push_back((uint8_t)(size >> shift));
+	element.insert(element.end(), payload.begin(), payload.end());
+	return element;
+}
+
+// An element of unknown size: it lasts until the end of its parent
+inline Bytes UnknownSizeElement(uint32_t id, const Bytes& payload) {
+	Bytes element = { (uint8_t)(id >> 24), (uint8_t)(id >> 16), (uint8_t)(id >> 8), (uint8_t)id, 0xFF };
+	element.insert(element.end(), payload.begin(), payload.end());
+	return element;
+}
+
+inline Bytes UIntElement(uint32_t id, uint64_t value) {
+	Bytes payload;
+	for (int shift = 56; shift >= 0; shift -= 8) payload.push_back((uint8_t)(value >> shift));
+	return Element(id, payload);
+}
+
+inline Bytes FloatElement(uint32_t id, double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return UIntElement(id, bits);
+}
+
+inline Bytes StringElement(uint32_t id, const std::string& value) {
+	return Element(id, Bytes(value.begin(), value.end()));
+}
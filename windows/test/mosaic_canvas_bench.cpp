@@ -0,0 +1,198 @@
+// Cost of composing a video wall on a MosaicCanvas, with synthetic NV12
+// sources: per tick, every player draws its frame into its tile (on one
+// thread, then on a thread per player as the sample threads do), against a
+// texture per player (a full size conversion each) as before the mosaic.
+// Also checks the tiles cover the canvas, the letterbox bars and the dirty
+// tiles.
+//
+//   mosaic_canvas_bench [seconds per run, default 1]
+
+#include "mosaic_canvas.h"
+#include "test_check.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace {
+
+const uint32_t CANVAS_WIDTH = 1920;
+const uint32_t CANVAS_HEIGHT = 1080;
+
+// A decoded frame of a player: a gradient and a tint of its own
+struct Source {
+	std::vector<uint8_t> planes;
+	Nv12Frame frame;
+
+	Source(uint32_t width, uint32_t height, int player) {
+		planes.resize((size_t)width * height * 3 / 2);
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) planes[(size_t)y * width + x] = (uint8_t)(x + y + player * 16);
+		}
+		for (size_t i = (size_t)width * height; i < planes.size(); i += 2) {
+			planes[i] = (uint8_t)(96 + player * 8);
+			planes[i + 1] = (uint8_t)(160 - player * 8);
+		}
+		frame.y = planes.data();
+		frame.uv = planes.data() + (size_t)width * height;
+		frame.width = width;
+		frame.height = height;
+		frame.stride = width;
+	}
+};
+
+std::vector<Source> MakeSources(int count, uint32_t width, uint32_t height) {
+	std::vector<Source> sources;
+	for (int i = 0; i < count; i++) sources.emplace_back(width, height, i);
+	return sources;
+}
+
+double Since(steady_clock::time_point start) {
+	return duration<double, std::milli>(steady_clock::now() - start).count();
+}
+
+// --------------------------------------------------------------------------
+// Checks
+
+bool IsBlack(const MosaicCanvas& canvas, uint32_t x, uint32_t y) {
+	const uint8_t* p = canvas.Pixels() + (size_t)y * canvas.Stride() + (size_t)x * 4;
+	return p[0] == 0 && p[1] == 0 && p[2] == 0 && p[3] == 255;
+}
+
+// Every pixel in exactly one tile, the sizes differing by one pixel at most
+void TestTileRects() {
+	auto canvas = MosaicCanvas::Create(1000, 700, 6, 6);
+	CHECK(canvas != NULL);
+	std::vector<int> covered((size_t)1000 * 700, 0);
+	for (uint32_t i = 0; i < canvas->TileCount(); i++) {
+		uint32_t x, y, width, height;
+		canvas->GetTileRect(i, &x, &y, &width, &height);
+		CHECK(width == 1000 / 6 || width == 1000 / 6 + 1);
+		CHECK(height == 700 / 6 || height == 700 / 6 + 1);
+		for (uint32_t row = y; row < y + height; row++) {
+			for (uint32_t column = x; column < x + width; column++) covered[(size_t)row * 1000 + column]++;
+		}
+	}
+	bool isExact = true;
+	for (int count : covered) isExact = isExact && count == 1;
+	CHECK(isExact);
+
+	CHECK(MosaicCanvas::Create(0, 1080, 4, 4) == NULL);
+	CHECK(MosaicCanvas::Create(1920, 1080, 9, 8) == NULL); // 72 tiles
+	CHECK(MosaicCanvas::Create(1920, 1080, 0, 4) == NULL);
+}
+
+// A 4:3 frame in a 16:9 tile is pillarboxed, a 16:9 one then fills the tile
+void TestLetterbox() {
+	auto canvas = MosaicCanvas::Create(CANVAS_WIDTH, CANVAS_HEIGHT, 2, 2);
+	uint32_t x, y, width, height;
+	canvas->GetTileRect(3, &x, &y, &width, &height);
+
+	uint32_t fitX, fitY, fitWidth, fitHeight;
+	MosaicCanvas::FitRect(640, 480, width, height, &fitX, &fitY, &fitWidth, &fitHeight);
+	CHECK(fitY == 0 && fitHeight == height && fitWidth == 720 && fitX == 120);
+
+	Source square(640, 480, 1);
+	canvas->DrawTile(3, square.frame);
+	CHECK(IsBlack(*canvas, x, y + height / 2));
+	CHECK(IsBlack(*canvas, x + width - 1, y + height / 2));
+	CHECK(!IsBlack(*canvas, x + width / 2, y + height / 2));
+
+	Source wide(1280, 720, 1);
+	canvas->DrawTile(3, wide.frame);
+	CHECK(!IsBlack(*canvas, x, y + height / 2)); // the bars cleared, then drawn over
+
+	canvas->ClearTile(3);
+	CHECK(IsBlack(*canvas, x + width / 2, y + height / 2));
+}
+
+void TestDirtyTiles() {
+	auto canvas = MosaicCanvas::Create(CANVAS_WIDTH, CANVAS_HEIGHT, 4, 4);
+	Source source(320, 180, 0);
+	CHECK(canvas->TakeDirtyTiles() == 0);
+	canvas->DrawTile(0, source.frame);
+	canvas->DrawTile(5, source.frame);
+	canvas->ClearTile(15);
+	CHECK(canvas->TakeDirtyTiles() == ((1ULL << 0) | (1ULL << 5) | (1ULL << 15)));
+	CHECK(canvas->TakeDirtyTiles() == 0);
+	canvas->DrawTile(16, source.frame); // out of the grid
+	CHECK(canvas->TakeDirtyTiles() == 0);
+}
+
+// --------------------------------------------------------------------------
+// Benchmark
+
+struct RunResult {
+	double perTextureMs = 0; // a full size conversion per player
+	double canvasMs = 0;     // every tile drawn, on one thread
+	double parallelMs = 0;   // every tile drawn, a thread per player
+};
+
+RunResult Run(uint32_t columns, uint32_t rows, uint32_t sourceWidth, uint32_t sourceHeight, double seconds) {
+	RunResult result;
+	int players = (int)(columns * rows);
+	std::vector<Source> sources = MakeSources(players, sourceWidth, sourceHeight);
+	double runMs = seconds * 1000;
+
+	std::vector<std::vector<uint8_t>> textures(players, std::vector<uint8_t>((size_t)sourceWidth * sourceHeight * 4));
+	int ticks = 0;
+	auto start = steady_clock::now();
+	do {
+		for (int i = 0; i < players; i++) ConvertNv12ToRgba(sources[i].frame, textures[i].data(), sourceWidth * 4);
+		ticks++;
+	} while (Since(start) < runMs);
+	result.perTextureMs = Since(start) / ticks;
+
+	auto canvas = MosaicCanvas::Create(CANVAS_WIDTH, CANVAS_HEIGHT, columns, rows);
+	uint64_t allTiles = players == 64 ? ~0ULL : (1ULL << players) - 1;
+	ticks = 0;
+	start = steady_clock::now();
+	do {
+		for (int i = 0; i < players; i++) canvas->DrawTile(i, sources[i].frame);
+		CHECK(canvas->TakeDirtyTiles() == allTiles);
+		ticks++;
+	} while (Since(start) < runMs);
+	result.canvasMs = Since(start) / ticks;
+
+	// as many ticks as the single thread run, the sample threads not in step
+	std::vector<std::thread> threads;
+	start = steady_clock::now();
+	for (int i = 0; i < players; i++) {
+		threads.emplace_back([&canvas, &sources, i, ticks]() {
+			for (int tick = 0; tick < ticks; tick++) canvas->DrawTile(i, sources[i].frame);
+		});
+	}
+	for (auto& thread : threads) thread.join();
+	result.parallelMs = Since(start) / ticks;
+	CHECK(canvas->TakeDirtyTiles() == allTiles);
+	return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+	if (seconds <= 0) seconds = 1.0;
+
+	TestTileRects();
+	TestLetterbox();
+	TestDirtyTiles();
+
+	printf("canvas %ux%u, %u hardware threads\n", CANVAS_WIDTH, CANVAS_HEIGHT, std::thread::hardware_concurrency());
+	struct Wall {
+		uint32_t columns, rows, sourceWidth, sourceHeight;
+	};
+	for (const Wall& wall : { Wall{ 2, 2, 1920, 1080 }, Wall{ 4, 4, 1280, 720 }, Wall{ 6, 6, 640, 360 } }) {
+		RunResult result = Run(wall.columns, wall.rows, wall.sourceWidth, wall.sourceHeight, seconds);
+		int players = (int)(wall.columns * wall.rows);
+		double textureMb = (double)players * wall.sourceWidth * wall.sourceHeight * 4 / (1 << 20);
+		double canvasMb = (double)CANVAS_WIDTH * CANVAS_HEIGHT * 4 / (1 << 20);
+		printf("%ux%u of %ux%u  textures %7.2f ms/tick %6.1f MB  canvas %7.2f ms/tick, %7.2f ms/tick threaded %6.1f MB\n",
+			wall.columns, wall.rows, wall.sourceWidth, wall.sourceHeight, result.perTextureMs, textureMb,
+			result.canvasMs, result.parallelMs, canvasMb);
+	}
+	return TestResult();
+}
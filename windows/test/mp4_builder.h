@@ -0,0 +1,68 @@
+#pragma once
+
+// Builds ISO-BMFF (MP4) files in memory for the parser tests: a box is its
+// type and payload, the sizes are filled in.
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+inline void AppendBE32(Bytes* pBytes, uint32_t value) {
+	for (int shift = 24; shift >= 0; shift -= 8) pBytes->push_back((uint8_t)(value >> shift));
+}
+
+inline void AppendBE16(Bytes* pBytes, uint16_t value) {
+	pBytes->push_back((uint8_t)(value >> 8));
+	pBytes->push_back((uint8_t)value);
+}
+
+inline Bytes Concat(std::initializer_list<Bytes> parts) {
+	Bytes bytes;
+	for (auto& part : parts) bytes.insert(bytes.end(), part.begin(), part.end());
+	return bytes;
+}
+
+inline Bytes Box(const char (&type)[5], const Bytes& payload) {
+	Bytes box;
+	AppendBE32(&box, (uint32_t)(8 + payload.size()));
+	box.insert(box.end(), type, type + 4);
+	box.insert(box.end(), payload.begin(), payload.end());
+	return box;
+}
+
+// Version and flags, then the fields (32-bit each)
+inline Bytes FullBox(const char (&type)[5], uint8_t version, std::initializer_list<uint32_t> fields) {
+	Bytes payload = { version, 0, 0, 0 };
+	for (uint32_t field : fields) AppendBE32(&payload, field);
+	return Box(type, payload);
+}
+
+inline Bytes Handler(const char (&handlerType)[5]) {
+	Bytes payload = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	payload.insert(payload.end(), handlerType, handlerType + 4);
+	payload.resize(payload.size() + 13, 0);
+	return Box("hdlr", payload);
+}
+
+// A track of 'sampleTables' (the boxes of stbl), 'timescale' units per second
+inline Bytes Track(const char (&handlerType)[5], uint32_t timescale, uint32_t duration, const Bytes& sampleTables,
+	const Bytes& extra = Bytes()) {
+	Bytes mdhd = FullBox("mdhd", 0, { 0, 0, timescale, duration, 0 });
+	Bytes minf = Box("minf", Box("stbl", sampleTables));
+	return Box("trak", Concat({ extra, Box("mdia", Concat({ mdhd, Handler(handlerType), minf })) }));
+}
+
+inline Bytes Mp4File(const Bytes& tracks, size_t mdatBytes = 100) {
+	Bytes ftyp = Box("ftyp", { 'i', 's', 'o', 'm', 0, 0, 0, 0 });
+	return Concat({ ftyp, Box("mdat", Bytes(mdatBytes, 0)), Box("moov", tracks) });
+}
+
+inline bool WriteFile(const std::string& path, const Bytes& bytes) {
+	FILE* fp = fopen(path.c_str(), "wb");
+	if (fp == NULL) return false;
+	bool isWritten = fwrite(bytes.data(), 1, bytes.size(), fp) == bytes.size();
+	return fclose(fp) == 0 && isWritten;
+}
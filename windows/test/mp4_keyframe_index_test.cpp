@@ -0,0 +1,123 @@
+// Mp4KeyframeIndex from sample tables built in memory: keyframe times (with
+// ctts and an edit list), seek plans, and tables whose counts claim more than
+// the file holds.
+
+#include "mp4_keyframe_index.h"
+#include "mp4_builder.h"
+#include "test_check.h"
+
+#include <chrono>
+
+namespace {
+
+const uint32_t TIMESCALE = 1000;
+const uint32_t SAMPLES = 30;
+const uint32_t DELTA = 40; // 25 fps
+
+Bytes Stts(uint32_t count, uint32_t delta) { return FullBox("stts", 0, { 1, count, delta }); }
+Bytes Stss() { return FullBox("stss", 0, { 3, 1, 11, 21 }); }
+
+// 30 samples, a keyframe every 10, each presented 80 ms after its decode time,
+// which the edit list shifts back
+Bytes VideoTrack(const Bytes& stts, const Bytes& stss) {
+	Bytes ctts = FullBox("ctts", 0, { 1, SAMPLES, 80 });
+	Bytes edts = Box("edts", FullBox("elst", 0, { 1, SAMPLES * DELTA, 80, 0x10000 }));
+	return Track("vide", TIMESCALE, SAMPLES * DELTA, Concat({ stts, ctts, stss }), edts);
+}
+
+Bytes AudioTrack() { return Track("soun", 48000, 48000, Stts(10, 4800)); }
+
+bool Build(const Bytes& file, Mp4KeyframeIndex* pIndex) {
+	return Mp4KeyframeIndex::Build(file.data(), file.size(), pIndex);
+}
+
+void TestKeyframes() {
+	Mp4KeyframeIndex index;
+	CHECK(Build(Mp4File(Concat({ AudioTrack(), VideoTrack(Stts(SAMPLES, DELTA), Stss()) })), &index));
+	CHECK(index.timescale == TIMESCALE);
+	CHECK(index.sampleCount == SAMPLES);
+	CHECK(index.hnsDuration == 12000000);
+	CHECK((index.hnsKeyframes == std::vector<int64_t>{ 0, 4000000, 8000000 }));
+
+	CHECK(index.PreviousKeyframe(7999999) == 4000000);
+	CHECK(index.PreviousKeyframe(8000000) == 8000000);
+	CHECK(index.NearestKeyframe(5900000) == 4000000);
+	CHECK(index.NearestKeyframe(6100000) == 8000000);
+	CHECK(index.NearestKeyframe(20000000) == 8000000);
+
+	SeekPlan plan = index.PlanSeek(5000000, SEEK_MODE_ACCURATE);
+	CHECK(plan.hnsStart == 5000000 && plan.hnsSkipUntil == 5000000);
+	plan = index.PlanSeek(4000000, SEEK_MODE_ACCURATE);
+	CHECK(plan.hnsStart == 4000000 && plan.hnsSkipUntil == -1); // on a keyframe
+	plan = index.PlanSeek(7000000, SEEK_MODE_PREVIOUS_KEYFRAME);
+	CHECK(plan.hnsStart == 4000000 && plan.hnsSkipUntil == -1);
+	plan = index.PlanSeek(7000000, SEEK_MODE_NEAREST_KEYFRAME);
+	CHECK(plan.hnsStart == 8000000 && plan.hnsSkipUntil == -1);
+}
+
+void TestAllSync() {
+	// without stss, every sample is a keyframe
+	Mp4KeyframeIndex index;
+	CHECK(Build(Mp4File(VideoTrack(Stts(SAMPLES, DELTA), Bytes())), &index));
+	CHECK(index.hnsKeyframes.size() == SAMPLES);
+	CHECK(index.hnsKeyframes[1] == DELTA * 10000);
+}
+
+void TestNoVideo() {
+	Mp4KeyframeIndex index;
+	CHECK(!Build(Mp4File(AudioTrack()), &index));
+	Bytes file = Mp4File(VideoTrack(Stts(SAMPLES, DELTA), Stss()));
+	file.resize(file.size() - 20); // moov cut short
+	CHECK(!Build(file, &index));
+	CHECK(!Build(Bytes(), &index));
+}
+
+void TestCountsBoundedByPayload() {
+	// the entry counts claim far more than the boxes hold: the entries present are read
+	Bytes stts = FullBox("stts", 0, { 0xFFFFFFFF, SAMPLES, DELTA });
+	Bytes stss = FullBox("stss", 0, { 0xFFFFFFFF, 1, 11, 21 });
+	Mp4KeyframeIndex index;
+	CHECK(Build(Mp4File(VideoTrack(stts, stss)), &index));
+	CHECK(index.sampleCount == SAMPLES);
+	CHECK(index.hnsKeyframes.size() == 3);
+}
+
+void TestSamplesBoundedByFile() {
+	// a stts entry of 4 billion samples in a file of a few hundred bytes: refused
+	// at once, without walking (or reserving for) the samples
+	Mp4KeyframeIndex index;
+	auto start = std::chrono::steady_clock::now();
+	CHECK(!Build(Mp4File(VideoTrack(Stts(0xFFFFFFF0, 1), Bytes())), &index));
+	CHECK(!Build(Mp4File(VideoTrack(Stts(0xFFFFFFF0, 1), Stss())), &index));
+	CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+
+	// stsz lists fewer samples than stts claims
+	Bytes stszShort = FullBox("stsz", 0, { 0, SAMPLES, 1, 2, 3 }); // 3 sizes listed of 30
+	CHECK(!Build(Mp4File(VideoTrack(Concat({ Stts(SAMPLES, DELTA), stszShort }), Stss())), &index));
+	Bytes stszCommon = FullBox("stsz", 0, { 1000, SAMPLES }); // a common size: no table
+	CHECK(Build(Mp4File(VideoTrack(Concat({ Stts(SAMPLES, DELTA), stszCommon }), Stss())), &index));
+	CHECK(!Build(Mp4File(VideoTrack(Concat({ Stts(SAMPLES + 1, DELTA), stszCommon }), Stss())), &index));
+}
+
+void TestCache() {
+	CHECK(WriteFile("index.mp4", Mp4File(VideoTrack(Stts(SAMPLES, DELTA), Stss()))));
+	CHECK(WriteFile("index.txt", Bytes(1000, 'x')));
+	Mp4KeyframeIndexCache::Clear();
+	auto index = Mp4KeyframeIndexCache::Get("index.mp4");
+	CHECK(index != NULL && index->hnsKeyframes.size() == 3);
+	CHECK(Mp4KeyframeIndexCache::Get("index.mp4") == index);
+	CHECK(Mp4KeyframeIndexCache::Get("index.txt") == NULL);
+	CHECK(Mp4KeyframeIndexCache::Get("missing.mp4") == NULL);
+}
+
+} // namespace
+
+int main() {
+	TestKeyframes();
+	TestAllSync();
+	TestNoVideo();
+	TestCountsBoundedByPayload();
+	TestSamplesBoundedByFile();
+	TestCache();
+	return TestResult();
+}
@@ -0,0 +1,133 @@
+// The timing of a playlist / edit list: the duration of the items trimmed to
+// their in / out points, the boundaries of the items on the playlist while
+// some durations are still unknown, positions and seeks mapped to an item,
+// and the gap of a transition from the frame intervals around it.
+
+#include "playlist_timeline.h"
+#include "test_check.h"
+
+#include <vector>
+
+namespace {
+
+const int64_t HNS_PER_SECOND = 10000000;
+
+void TestTrimming() {
+	// the out point, else the end of the file
+	CHECK(TrimmedDuration(0, 0, 60 * HNS_PER_SECOND) == 60 * HNS_PER_SECOND);
+	CHECK(TrimmedDuration(10 * HNS_PER_SECOND, 0, 60 * HNS_PER_SECOND) == 50 * HNS_PER_SECOND);
+	CHECK(TrimmedDuration(10 * HNS_PER_SECOND, 25 * HNS_PER_SECOND, 60 * HNS_PER_SECOND) == 15 * HNS_PER_SECOND);
+	CHECK(TrimmedDuration(10 * HNS_PER_SECOND, 25 * HNS_PER_SECOND, -1) == 15 * HNS_PER_SECOND);
+	// unknown without an out point nor a file duration
+	CHECK(TrimmedDuration(10 * HNS_PER_SECOND, 0, -1) == -1);
+	CHECK(TrimmedDuration(0, 0, 0) == -1);
+	// an in point past the out point, or past the end: nothing to play
+	CHECK(TrimmedDuration(30 * HNS_PER_SECOND, 20 * HNS_PER_SECOND, 60 * HNS_PER_SECOND) == 0);
+	CHECK(TrimmedDuration(70 * HNS_PER_SECOND, 0, 60 * HNS_PER_SECOND) == 0);
+
+	// times of the file as times of the item, from its in point
+	CHECK(ItemTime(15 * HNS_PER_SECOND, 10 * HNS_PER_SECOND) == 5 * HNS_PER_SECOND);
+	CHECK(ItemTime(10 * HNS_PER_SECOND, 10 * HNS_PER_SECOND) == 0);
+	// a keyframe before the in point: the item starts there
+	CHECK(ItemTime(8 * HNS_PER_SECOND, 10 * HNS_PER_SECOND) == 0);
+}
+
+void TestBoundaries() {
+	PlaylistTimeline timeline;
+	timeline.Reset(3);
+	CHECK(timeline.Count() == 3);
+	CHECK(timeline.Duration(0) == -1 && timeline.Duration(2) == -1);
+	CHECK(timeline.TotalDuration() == 0);
+
+	timeline.SetDuration(0, 10 * HNS_PER_SECOND);
+	timeline.SetDuration(1, 5 * HNS_PER_SECOND);
+	timeline.SetDuration(2, 20 * HNS_PER_SECOND);
+	CHECK(timeline.ItemStart(0) == 0);
+	CHECK(timeline.ItemStart(1) == 10 * HNS_PER_SECOND);
+	CHECK(timeline.ItemStart(2) == 15 * HNS_PER_SECOND);
+	CHECK(timeline.ItemStart(3) == 35 * HNS_PER_SECOND);
+	CHECK(timeline.TotalDuration() == 35 * HNS_PER_SECOND);
+
+	// a boundary belongs to the item starting there
+	int64_t hnsOffset = -1;
+	CHECK(timeline.Locate(0, &hnsOffset) == 0 && hnsOffset == 0);
+	CHECK(timeline.Locate(10 * HNS_PER_SECOND - 1, &hnsOffset) == 0 && hnsOffset == 10 * HNS_PER_SECOND - 1);
+	CHECK(timeline.Locate(10 * HNS_PER_SECOND, &hnsOffset) == 1 && hnsOffset == 0);
+	CHECK(timeline.Locate(17 * HNS_PER_SECOND, &hnsOffset) == 2 && hnsOffset == 2 * HNS_PER_SECOND);
+	// before the start, past the end: the first and the last item
+	CHECK(timeline.Locate(-HNS_PER_SECOND, &hnsOffset) == 0 && hnsOffset == 0);
+	CHECK(timeline.Locate(40 * HNS_PER_SECOND, &hnsOffset) == 2 && hnsOffset == 25 * HNS_PER_SECOND);
+}
+
+void TestUnknownDurations() {
+	// the durations come in as the items are probed / opened
+	PlaylistTimeline timeline;
+	timeline.Reset(3);
+	timeline.SetDuration(0, 10 * HNS_PER_SECOND);
+	CHECK(timeline.ItemStart(2) == 10 * HNS_PER_SECOND);
+	CHECK(timeline.TotalDuration() == 10 * HNS_PER_SECOND);
+
+	// an item of unknown duration takes no time: the last one starting there is located
+	int64_t hnsOffset = -1;
+	CHECK(timeline.Locate(10 * HNS_PER_SECOND, &hnsOffset) == 2 && hnsOffset == 0);
+	CHECK(timeline.Locate(5 * HNS_PER_SECOND, &hnsOffset) == 0);
+
+	timeline.SetDuration(1, 4 * HNS_PER_SECOND);
+	CHECK(timeline.ItemStart(2) == 14 * HNS_PER_SECOND);
+	CHECK(timeline.Locate(12 * HNS_PER_SECOND, &hnsOffset) == 1 && hnsOffset == 2 * HNS_PER_SECOND);
+
+	// an empty item (in point past the out point) neither
+	timeline.SetDuration(1, 0);
+	CHECK(timeline.ItemStart(2) == 10 * HNS_PER_SECOND);
+	CHECK(timeline.Locate(10 * HNS_PER_SECOND, &hnsOffset) == 2);
+}
+
+void TestPositions() {
+	PlaylistTimeline timeline;
+	timeline.Reset(2);
+	timeline.SetDuration(0, 10 * HNS_PER_SECOND);
+	timeline.SetDuration(1, 5 * HNS_PER_SECOND);
+
+	CHECK(timeline.Position(1, 2 * HNS_PER_SECOND) == 12 * HNS_PER_SECOND);
+	// the clock of the item runs before it starts / past its out point: kept within it
+	CHECK(timeline.Position(1, -HNS_PER_SECOND) == 10 * HNS_PER_SECOND);
+	CHECK(timeline.Position(0, 11 * HNS_PER_SECOND) == 10 * HNS_PER_SECOND);
+	CHECK(timeline.Position(1, 6 * HNS_PER_SECOND) == 15 * HNS_PER_SECOND);
+
+	// unknown duration: not bounded
+	timeline.Reset(2);
+	timeline.SetDuration(0, 10 * HNS_PER_SECOND);
+	CHECK(timeline.Position(1, 60 * HNS_PER_SECOND) == 70 * HNS_PER_SECOND);
+}
+
+void TestTransitionGap() {
+	const int64_t HNS_FRAME = 400000; // 25 fps
+	// on time: no gap beyond the usual interval
+	std::vector<int64_t> intervals(8, HNS_FRAME);
+	CHECK(TransitionGapMs(intervals.data(), 8) == 0);
+
+	// the next item started 100 ms late
+	intervals = { HNS_FRAME, HNS_FRAME, HNS_FRAME, HNS_FRAME + 1000000, HNS_FRAME, HNS_FRAME, HNS_FRAME, HNS_FRAME };
+	double gapMs = TransitionGapMs(intervals.data(), 8);
+	CHECK(gapMs > 99.9 && gapMs < 100.1);
+
+	// the median, not the mean: a few irregular intervals don't hide the gap
+	intervals = { 300000, 500000, HNS_FRAME, 2400000, HNS_FRAME, 350000 };
+	gapMs = TransitionGapMs(intervals.data(), 6);
+	CHECK(gapMs > 199.9 && gapMs < 200.1);
+
+	// too few frames to tell
+	intervals = { HNS_FRAME, 2 * HNS_FRAME };
+	CHECK(TransitionGapMs(intervals.data(), 2) < 0);
+}
+
+} // namespace
+
+int main() {
+	TestTrimming();
+	TestBoundaries();
+	TestUnknownDurations();
+	TestPositions();
+	TestTransitionGap();
+	return TestResult();
+}
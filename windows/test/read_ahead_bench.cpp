@@ -0,0 +1,179 @@
+// ReadAheadReader against a throttled drive: every read of the file costs a
+// latency and its bytes at a bandwidth (a hard disk or a network share, not
+// the page cache). The player reads 64 KB at a time, as the media source does,
+// in bursts of 1 MB every 50 ms (20 MB/s); compared are direct reads of the
+// drive, the read-ahead, and the memory-mapped mode (not throttled: the page
+// cache reads). Also checks the data read, a seek and the stats.
+//
+//   read_ahead_bench [file size in MB, default 64]
+
+#include "read_ahead_reader.h"
+#include "test_check.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+using namespace std::chrono;
+
+namespace {
+
+const char* const FILE_PATH = "read_ahead_bench.bin";
+const int64_t READ_SIZE = 64 * 1024;
+const int64_t BURST_BYTES = 1024 * 1024;
+const int BURST_INTERVAL_MS = 50;
+const int LATENCY_US = 2000;
+const int64_t BYTES_PER_SECOND = 100 * 1024 * 1024;
+const double STALL_MS = 1; // a direct read waiting longer counts as a stall
+
+uint8_t PatternByte(int64_t offset) { return (uint8_t)(offset * 7 + offset / 4096); }
+
+void WriteTestFile(int64_t size) {
+	std::vector<uint8_t> data((size_t)size);
+	for (int64_t i = 0; i < size; i++) data[(size_t)i] = PatternByte(i);
+	std::ofstream(FILE_PATH, std::ios::binary).write((const char*)data.data(), (std::streamsize)size);
+}
+
+bool IsPattern(const uint8_t* pData, int64_t offset, int64_t size) {
+	for (int64_t i = 0; i < size; i++) {
+		if (pData[i] != PatternByte(offset + i)) return false;
+	}
+	return true;
+}
+
+// A drive: each read waits for the latency, then for its bytes at the bandwidth
+class ThrottledFile : public LocalFile {
+public:
+	explicit ThrottledFile(std::unique_ptr<LocalFile> file) : m_file(std::move(file)) {}
+
+	int64_t Size() override { return m_file->Size(); }
+
+	int64_t ReadAt(int64_t offset, uint8_t* pDst, int64_t size) override {
+		std::this_thread::sleep_for(microseconds(LATENCY_US + size * 1000000 / BYTES_PER_SECOND));
+		return m_file->ReadAt(offset, pDst, size);
+	}
+
+	const uint8_t* Map() override { return m_file->Map(); }
+
+private:
+	std::unique_ptr<LocalFile> m_file;
+};
+
+std::unique_ptr<LocalFile> OpenThrottled() {
+	std::unique_ptr<LocalFile> file = LocalFile::Open(FILE_PATH);
+	if (file == NULL) return NULL;
+	return std::unique_ptr<LocalFile>(new ThrottledFile(std::move(file)));
+}
+
+struct RunResult {
+	double seconds = 0;
+	int64_t stalls = 0;
+	double stallMs = 0;
+	double maxStallMs = 0;
+	bool isDataValid = true;
+};
+
+// The player's reads, 'read' doing one of them
+template <typename ReadFunction>
+RunResult Play(int64_t length, ReadFunction read) {
+	RunResult result;
+	std::vector<uint8_t> buffer((size_t)READ_SIZE);
+	auto start = steady_clock::now();
+	for (int64_t offset = 0; offset < length; offset += READ_SIZE) {
+		if (offset > 0 && offset % BURST_BYTES == 0) std::this_thread::sleep_for(milliseconds(BURST_INTERVAL_MS));
+		int64_t size = std::min(READ_SIZE, length - offset);
+		if (read(offset, buffer.data(), size) != size || !IsPattern(buffer.data(), offset, size)) result.isDataValid = false;
+	}
+	result.seconds = duration<double>(steady_clock::now() - start).count();
+	return result;
+}
+
+RunResult PlayDirect(int64_t length) {
+	std::unique_ptr<LocalFile> file = OpenThrottled();
+	RunResult stalls;
+	RunResult result = Play(length, [&file, &stalls](int64_t offset, uint8_t* pDst, int64_t size) {
+		auto start = steady_clock::now();
+		int64_t read = file->ReadAt(offset, pDst, size);
+		double waitMs = duration<double, std::milli>(steady_clock::now() - start).count();
+		if (waitMs > STALL_MS) {
+			stalls.stalls++;
+			stalls.stallMs += waitMs;
+			stalls.maxStallMs = std::max(stalls.maxStallMs, waitMs);
+		}
+		return read;
+	});
+	result.stalls = stalls.stalls;
+	result.stallMs = stalls.stallMs;
+	result.maxStallMs = stalls.maxStallMs;
+	return result;
+}
+
+RunResult PlayReadAhead(int64_t length, bool useMemoryMap) {
+	ReadAheadOptions options;
+	options.useMemoryMap = useMemoryMap;
+	ReadAheadReader reader(OpenThrottled(), options);
+	CHECK(reader.Open());
+	CHECK(reader.GetStats().isMapped == useMemoryMap);
+	RunResult result = Play(length, [&reader](int64_t offset, uint8_t* pDst, int64_t size) {
+		return reader.Read(offset, pDst, size);
+	});
+	ReadAheadStats stats = reader.GetStats();
+	result.stalls = stats.stalls;
+	result.stallMs = stats.stallMs;
+	result.maxStallMs = stats.maxStallMs;
+	CHECK(stats.bytesRead == length && stats.seeks == 0);
+	CHECK(useMemoryMap ? stats.ioBytes == 0 : stats.ioBytes >= length);
+	return result;
+}
+
+// A seek, reads across blocks and at the end, and after Close()
+void TestReads(int64_t length) {
+	ReadAheadOptions options;
+	options.readAheadBytes = 4 * ReadAheadReader::BLOCK_SIZE;
+	ReadAheadReader reader(OpenThrottled(), options);
+	CHECK(reader.Open());
+	CHECK(reader.Length() == length);
+
+	std::vector<uint8_t> buffer((size_t)(3 * ReadAheadReader::BLOCK_SIZE));
+	int64_t offset = length / 2 + 12345;
+	CHECK(reader.Read(offset, buffer.data(), (int64_t)buffer.size()) == (int64_t)buffer.size());
+	CHECK(IsPattern(buffer.data(), offset, (int64_t)buffer.size()));
+	CHECK(reader.Read(length - 10, buffer.data(), 100) == 10);
+	CHECK(IsPattern(buffer.data(), length - 10, 10));
+	CHECK(reader.Read(length, buffer.data(), 100) == 0);
+	CHECK(reader.Read(-1, buffer.data(), 100) == -1);
+
+	ReadAheadStats stats = reader.GetStats();
+	CHECK(stats.reads == 2 && stats.seeks == 2 && stats.bytesRead == (int64_t)buffer.size() + 10);
+	CHECK(stats.stalls >= 1); // the first read, the read-ahead just started
+	reader.Close();
+	CHECK(reader.Read(0, buffer.data(), 100) == -1);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	int64_t megabytes = argc > 1 ? atoll(argv[1]) : 64;
+	if (megabytes <= 0) megabytes = 64;
+	int64_t length = megabytes * 1024 * 1024 + 1000; // not a whole number of blocks
+	WriteTestFile(length);
+
+	TestReads(length);
+
+	printf("%lld MB, drive %d us + %lld MB/s per read, %lld KB reads in 1 MB bursts every %d ms\n", (long long)megabytes,
+		LATENCY_US, (long long)(BYTES_PER_SECOND >> 20), (long long)(READ_SIZE >> 10), BURST_INTERVAL_MS);
+	static const char* const NAMES[] = { "direct", "read-ahead", "mapped" };
+	RunResult results[] = { PlayDirect(length), PlayReadAhead(length, false), PlayReadAhead(length, true) };
+	for (int i = 0; i < 3; i++) {
+		const RunResult& result = results[i];
+		printf("%-10s  %6.2f s  %6.1f MB/s  stalls %5lld  %8.1f ms  max %6.1f ms\n", NAMES[i], result.seconds,
+			length / result.seconds / (1 << 20), (long long)result.stalls, result.stallMs, result.maxStallMs);
+		CHECK(result.isDataValid);
+	}
+	// every direct read waits for the drive, the read-ahead only at the start
+	CHECK(results[1].stallMs < results[0].stallMs);
+
+	std::remove(FILE_PATH);
+	return TestResult();
+}
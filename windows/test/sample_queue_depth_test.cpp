@@ -0,0 +1,129 @@
+// CSampleQueueDepth against the queue of CStreamSink: samples are requested
+// while fewer than Depth() are in flight, so an arriving sample finds at most
+// Depth() - 1 queued.
+
+#include "SampleQueueDepth.h"
+#include "test_check.h"
+
+#include <algorithm>
+#include <functional>
+
+using namespace DX11VideoRenderer;
+
+namespace {
+
+const int64_t HNS_PER_FRAME = 166667; // 60 fps
+
+// A decoder feeding the queue of the sink, one sample presented per frame interval
+struct SinkSimulation {
+	CSampleQueueDepth queueDepth;
+	uint32_t queued = 0;
+	uint32_t outstanding = 0;
+	int64_t hnsNow = 0;
+	int64_t hnsNextPresent = HNS_PER_FRAME;
+	int64_t hnsDecoderFree = 0;
+	uint32_t maxQueuedOnArrival = 0;
+
+	void RequestSamples() {
+		while (queued + outstanding < queueDepth.Depth()) outstanding++;
+	}
+
+	void Present() {
+		hnsNow = hnsNextPresent;
+		if (queued > 0) queued--;
+		hnsNextPresent += HNS_PER_FRAME;
+		RequestSamples();
+	}
+
+	// 'count' samples, the i-th decoded in hnsDecode(i)
+	void Run(int count, const std::function<int64_t(int)>& hnsDecode) {
+		RequestSamples();
+		for (int i = 0; i < count; i++) {
+			while (outstanding == 0) Present();
+			int64_t hnsArrival = std::max(hnsNow, hnsDecoderFree) + hnsDecode(i);
+			while (hnsNextPresent <= hnsArrival) Present();
+			hnsNow = hnsArrival;
+			hnsDecoderFree = hnsArrival;
+			maxQueuedOnArrival = std::max(maxQueuedOnArrival, queued);
+			queueDepth.OnSampleArrived(hnsArrival, queued, HNS_PER_FRAME);
+			queued++;
+			outstanding--;
+			RequestSamples();
+		}
+	}
+};
+
+void TestGrowsThenShrinks() {
+	SinkSimulation sim;
+	CHECK(sim.queueDepth.SetBounds(2, 8));
+
+	// a 300 ms stall every 30 samples (a network source): the depth grows
+	sim.Run(600, [](int i) { return i % 30 == 0 ? 3000000 : HNS_PER_FRAME / 4; });
+	SampleQueueStats stalled = sim.queueDepth.GetStats();
+	CHECK(stalled.grows > 0);
+	CHECK(stalled.depth > CSampleQueueDepth::DEFAULT_DEPTH);
+	CHECK(stalled.shrinks == 0);
+
+	// then a decoder well ahead: the queue stays full, the depth comes back down
+	sim.queueDepth.ResetStats();
+	sim.Run(2000, [](int) { return HNS_PER_FRAME / 4; });
+	SampleQueueStats steady = sim.queueDepth.GetStats();
+	CHECK(steady.fullArrivals > 0);
+	CHECK(steady.shrinks > 0);
+	CHECK(steady.depth < stalled.depth);
+	CHECK(steady.depth == steady.minDepth);
+
+	// the cap of the sink: never a full queue before the arrival
+	CHECK(sim.maxQueuedOnArrival < steady.maxDepth);
+}
+
+void TestSteadyKeepsDepth() {
+	// a decoder just in time: the queue never fills, the depth stays
+	CSampleQueueDepth queueDepth;
+	int64_t hnsArrival = 0;
+	for (int i = 0; i < 1000; i++) {
+		queueDepth.OnSampleArrived(hnsArrival, 0, HNS_PER_FRAME);
+		hnsArrival += HNS_PER_FRAME;
+	}
+	SampleQueueStats stats = queueDepth.GetStats();
+	CHECK(stats.depth == CSampleQueueDepth::DEFAULT_DEPTH);
+	CHECK(stats.grows == 0 && stats.shrinks == 0);
+	CHECK(stats.fullArrivals == 0);
+	CHECK(stats.emptyArrivals == 1000);
+}
+
+void TestBounds() {
+	CSampleQueueDepth queueDepth;
+	CHECK(!queueDepth.SetBounds(0, 4));
+	CHECK(!queueDepth.SetBounds(5, 4));
+	CHECK(!queueDepth.SetBounds(1, CSampleQueueDepth::MAX_DEPTH + 1));
+	CHECK(queueDepth.SetBounds(5, 6) && queueDepth.Depth() == 5);
+	CHECK(queueDepth.SetBounds(1, 1) && queueDepth.Depth() == 1);
+}
+
+void TestRestartIsNotJitter() {
+	CSampleQueueDepth queueDepth;
+	int64_t hnsArrival = 0;
+	for (int i = 0; i < 100; i++) {
+		queueDepth.OnSampleArrived(hnsArrival, 1, HNS_PER_FRAME);
+		hnsArrival += HNS_PER_FRAME;
+	}
+	hnsArrival += 50000000; // paused 5 s
+	queueDepth.Restart();
+	for (int i = 0; i < 100; i++) {
+		queueDepth.OnSampleArrived(hnsArrival, 1, HNS_PER_FRAME);
+		hnsArrival += HNS_PER_FRAME;
+	}
+	CHECK(queueDepth.GetStats().hnsJitter == 0);
+	CHECK(queueDepth.Depth() == CSampleQueueDepth::DEFAULT_DEPTH);
+}
+
+} // namespace
+
+int main() {
+	TestGrowsThenShrinks();
+	TestSteadyKeepsDepth();
+	TestBounds();
+	TestRestartIsNotJitter();
+	return TestResult();
+}
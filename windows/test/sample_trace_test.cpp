@@ -0,0 +1,114 @@
+// SampleTraceWriter / ReadSampleTrace, then the traces replayed by the
+// trace_replay tests (this test is their fixture): steady.trace, stall.trace
+// and paused.trace (nothing presented) in the working directory.
+
+#include "sample_trace.h"
+#include "test_check.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+const int64_t HNS_PER_FRAME = 333667; // 29.97 fps
+
+void TestWriteRead() {
+	auto writer = SampleTraceWriter::Create("smoke.trace");
+	CHECK(writer != NULL);
+	if (writer == NULL) return;
+	std::thread samples([&]() {
+		for (int i = 0; i < 3000; i++) writer->Sample(TRACE_SOURCE_GRABBER, i * HNS_PER_FRAME, HNS_PER_FRAME, 1000, 0);
+	});
+	std::thread events([&]() {
+		for (int i = 0; i < 3000; i++) writer->Event(TRACE_SOURCE_GRABBER, TRACE_CLOCK_RATE, 1000000);
+	});
+	samples.join();
+	events.join();
+	writer->Close();
+	writer->Sample(TRACE_SOURCE_GRABBER, 0, 0, 0, 0); // after Close: ignored
+	CHECK(writer->RecordCount() == 6000);
+
+	std::vector<SampleTraceRecord> records;
+	CHECK(ReadSampleTrace("smoke.trace", &records));
+	CHECK(records.size() == 6000);
+	for (size_t i = 1; i < records.size(); i++) {
+		if (records[i].hnsArrival < records[i - 1].hnsArrival) {
+			CHECK(!"arrivals in order");
+			break;
+		}
+	}
+	CHECK(!ReadSampleTrace("missing.trace", &records));
+}
+
+// The records are written over those of an empty trace: the arrivals are
+// simulated, not stamped by the writer
+void WriteTrace(const char* path, std::vector<SampleTraceRecord> records) {
+	std::stable_sort(records.begin(), records.end(),
+		[](const SampleTraceRecord& a, const SampleTraceRecord& b) { return a.hnsArrival < b.hnsArrival; });
+	auto writer = SampleTraceWriter::Create(path);
+	CHECK(writer != NULL);
+	if (writer == NULL) return;
+	writer->Close();
+	FILE* fp = fopen(path, "ab");
+	CHECK(fp != NULL);
+	if (fp == NULL) return;
+	CHECK(fwrite(records.data(), sizeof(SampleTraceRecord), records.size(), fp) == records.size());
+	fclose(fp);
+
+	std::vector<SampleTraceRecord> read;
+	CHECK(ReadSampleTrace(path, &read) && read.size() == records.size());
+}
+
+SampleTraceRecord Event(SampleTraceEvent event, int64_t hnsArrival, int64_t value) {
+	SampleTraceRecord record;
+	record.event = (uint8_t)event;
+	record.source = TRACE_SOURCE_RENDERER;
+	record.hnsArrival = hnsArrival;
+	record.hnsTime = value;
+	return record;
+}
+
+SampleTraceRecord Sample(int64_t hnsArrival, int64_t hnsTime) {
+	SampleTraceRecord record;
+	record.source = TRACE_SOURCE_RENDERER;
+	record.hnsArrival = hnsArrival;
+	record.hnsTime = hnsTime;
+	record.size = 20000;
+	return record;
+}
+
+void WriteReplayTraces() {
+	const int64_t hnsStart = 1000000;
+
+	// the decoder 3 frames ahead of the clock; then, every 10 s, 10 samples 4 frames late
+	for (int kind = 0; kind < 2; kind++) {
+		std::vector<SampleTraceRecord> records;
+		records.push_back(Event(TRACE_CLOCK_START, hnsStart, 0));
+		for (int i = 0; i < 1800; i++) {
+			int64_t hnsArrival = std::max<int64_t>(0, hnsStart + (i - 3) * HNS_PER_FRAME);
+			if (kind == 1 && i % 300 >= 150 && i % 300 < 160) hnsArrival += 4 * HNS_PER_FRAME;
+			records.push_back(Sample(hnsArrival, i * HNS_PER_FRAME));
+		}
+		WriteTrace(kind == 0 ? "steady.trace" : "stall.trace", records);
+	}
+
+	// the clock paused again before each sample is due: nothing presented
+	std::vector<SampleTraceRecord> records;
+	records.push_back(Event(TRACE_CLOCK_START, hnsStart, 0));
+	for (int i = 0; i < 20; i++) {
+		int64_t hnsArrival = hnsStart + i * 10000000;
+		if (i > 0) records.push_back(Event(TRACE_CLOCK_RESTART, hnsArrival, 0));
+		records.push_back(Sample(hnsArrival + 1, i * HNS_PER_FRAME));
+		records.push_back(Event(TRACE_CLOCK_PAUSE, hnsArrival + 2, 0));
+	}
+	WriteTrace("paused.trace", records);
+}
+
+} // namespace
+
+int main() {
+	TestWriteRead();
+	WriteReplayTraces();
+	return TestResult();
+}
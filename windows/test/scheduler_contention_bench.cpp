@@ -0,0 +1,344 @@
+// Contention of the schedulers of several renderers, as CScheduler drives
+// CSchedulerCore: a work item is posted per sample queued, the timers of all
+// the schedulers share one thread (a CTimerHeap), and the work items run on a
+// pool of threads. Presenting is a busy wait.
+//
+// Compared: one lock for all the sinks with presenting under it (before lock
+// domains), a lock per sink with presenting outside it but every work item
+// processing the queue, and the same with one work item at a time
+// (BeginProcessing / EndProcessing). Fails if the last one presents out of
+// order.
+//
+//   scheduler_contention_bench [seconds per run, default 1]
+
+#include "SchedulerCore.h"
+#include "TimerHeap.h"
+#include "test_check.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace DX11VideoRenderer;
+using namespace std::chrono;
+
+namespace {
+
+const int64_t HNS_PER_FRAME = 41667; // 240 fps
+const int PRESENT_US = 200;
+const int WORK_THREADS = 4;
+
+int64_t NowHns() {
+	static const steady_clock::time_point start = steady_clock::now();
+	return duration_cast<nanoseconds>(steady_clock::now() - start).count() / 100;
+}
+
+void Spin(int us) {
+	auto end = steady_clock::now() + microseconds(us);
+	while (steady_clock::now() < end) {
+	}
+}
+
+// The multithreaded work queue
+class WorkQueue {
+public:
+	WorkQueue() {
+		for (int i = 0; i < WORK_THREADS; i++) m_threads.emplace_back([this]() { Run(); });
+	}
+
+	// Runs what is queued, then stops
+	~WorkQueue() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_isStopping = true;
+		}
+		m_cv.notify_all();
+		for (auto& thread : m_threads) thread.join();
+	}
+
+	void Post(std::function<void()> item) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_items.push_back(std::move(item));
+		}
+		m_cv.notify_one();
+	}
+
+private:
+	void Run() {
+		for (;;) {
+			std::function<void()> item;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cv.wait(lock, [this]() { return m_isStopping || !m_items.empty(); });
+				if (m_items.empty()) return;
+				item = std::move(m_items.front());
+				m_items.pop_front();
+			}
+			item();
+		}
+	}
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::deque<std::function<void()>> m_items;
+	bool m_isStopping = false;
+	std::vector<std::thread> m_threads;
+};
+
+// The timer wheel: one thread, the callbacks queued on the work queue
+class TimerThread {
+public:
+	explicit TimerThread(WorkQueue& work) : m_work(work), m_thread([this]() { Run(); }) {}
+
+	// The timers not fired yet are dropped
+	~TimerThread() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_isStopping = true;
+		}
+		m_cv.notify_all();
+		m_thread.join();
+	}
+
+	uint64_t Arm(int64_t hnsDelay, int64_t hnsSlack, std::function<void()>* pCallback) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		uint64_t key = m_timers.Arm(NowHns() + hnsDelay, hnsSlack, pCallback);
+		m_cv.notify_all();
+		return key;
+	}
+
+	void Cancel(uint64_t key) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		void* pContext = NULL;
+		m_timers.Cancel(key, &pContext);
+	}
+
+	bool IsArmed(uint64_t key) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_timers.IsArmed(key);
+	}
+
+private:
+	void Run() {
+		std::vector<void*> due;
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!m_isStopping) {
+			due.clear();
+			m_timers.TakeDue(NowHns(), &due);
+			for (void* pContext : due) m_work.Post(*static_cast<std::function<void()>*>(pContext));
+			int64_t hnsWakeup = 0;
+			if (!m_timers.NextWakeup(&hnsWakeup)) {
+				m_cv.wait(lock);
+			} else if (hnsWakeup > NowHns()) {
+				m_cv.wait_for(lock, microseconds((hnsWakeup - NowHns()) / 10));
+			}
+		}
+	}
+
+	WorkQueue& m_work;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	CTimerHeap m_timers;
+	bool m_isStopping = false;
+	std::thread m_thread;
+};
+
+enum Mode {
+	MODE_SHARED_LOCK,  // one lock, presenting under it, every work item processes
+	MODE_SINK_LOCK,    // a lock per sink, presenting outside it, every work item processes
+	MODE_SINGLE_FLIGHT // the same, one work item processing at a time
+};
+
+// CScheduler, with a sample reduced to its time
+class Sink : private SchedulerClock, private SchedulerWaiter {
+public:
+	Sink(Mode mode, std::mutex* pLock, WorkQueue& work, TimerThread& timers) :
+		m_mode(mode), m_lock(*pLock), m_work(work), m_timers(timers),
+		m_core(static_cast<SchedulerClock&>(*this), static_cast<SchedulerWaiter&>(*this)) {
+		m_core.SetFrameInterval(HNS_PER_FRAME);
+		m_onTimer = [this]() { OnTimer(); };
+	}
+
+	// ScheduleSample
+	void Schedule(int64_t hnsSampleTime) {
+		{
+			std::unique_lock<std::mutex> lock = Acquire();
+			m_samples.push_back(hnsSampleTime);
+		}
+		m_work.Post(m_onTimer);
+	}
+
+	// StopScheduler: the work items still queued find nothing to do
+	void Stop() {
+		std::unique_lock<std::mutex> lock = Acquire();
+		m_isStopped = true;
+		m_samples.clear();
+		CancelWait();
+	}
+
+	int64_t Presented() const { return m_presented; }
+	int64_t OutOfOrder() const { return m_outOfOrder; }
+	int64_t MaxLockWaitUs() const { return m_maxLockWaitUs; }
+
+private:
+	void OnTimer() {
+		{
+			std::unique_lock<std::mutex> lock = Acquire();
+			if (m_key != 0 && !m_timers.IsArmed(m_key)) m_key = 0;
+			if (m_mode == MODE_SINGLE_FLIGHT && !m_core.BeginProcessing()) return;
+		}
+		for (;;) {
+			ProcessSamples();
+			if (m_mode != MODE_SINGLE_FLIGHT) break;
+			std::unique_lock<std::mutex> lock = Acquire();
+			if (!m_core.EndProcessing()) break;
+		}
+	}
+
+	void ProcessSamples() {
+		for (;;) {
+			std::unique_lock<std::mutex> lock = Acquire();
+			if (m_samples.empty()) return;
+			int64_t hnsSampleTime = m_samples.front();
+			m_samples.pop_front();
+			int64_t hnsWait = 0;
+			ScheduleAction action = m_core.Schedule(hnsSampleTime, &hnsWait);
+			if (action == SCHEDULE_WAIT) {
+				m_samples.push_front(hnsSampleTime);
+				m_core.Wait(hnsWait);
+				return;
+			}
+			if (m_mode != MODE_SHARED_LOCK) lock.unlock();
+			if (action == SCHEDULE_PRESENT) Present(hnsSampleTime);
+		}
+	}
+
+	void Present(int64_t hnsSampleTime) {
+		Spin(PRESENT_US);
+		std::lock_guard<std::mutex> lock(m_recordMutex);
+		if (hnsSampleTime < m_hnsLastPresented) m_outOfOrder++;
+		m_hnsLastPresented = hnsSampleTime;
+		m_presented++;
+	}
+
+	// The lock of the sink, timing the wait for it
+	std::unique_lock<std::mutex> Acquire() {
+		auto start = steady_clock::now();
+		std::unique_lock<std::mutex> lock(m_lock);
+		int64_t waitUs = duration_cast<microseconds>(steady_clock::now() - start).count();
+		if (waitUs > m_maxLockWaitUs) m_maxLockWaitUs = waitUs;
+		return lock;
+	}
+
+	bool GetClockTime(int64_t* phnsTime) override {
+		*phnsTime = NowHns();
+		return true;
+	}
+
+	bool WaitFor(int64_t hnsDelay, int64_t hnsSlack) override {
+		if (m_isStopped) return false;
+		CancelWait();
+		m_key = m_timers.Arm(hnsDelay, hnsSlack, &m_onTimer);
+		return true;
+	}
+
+	void CancelWait() override {
+		if (m_key != 0) m_timers.Cancel(m_key);
+		m_key = 0;
+	}
+
+	Mode m_mode;
+	std::mutex& m_lock;
+	WorkQueue& m_work;
+	TimerThread& m_timers;
+	CSchedulerCore m_core;
+	std::function<void()> m_onTimer;
+	std::deque<int64_t> m_samples;
+	uint64_t m_key = 0;
+	bool m_isStopped = false;
+	std::mutex m_recordMutex;
+	int64_t m_hnsLastPresented = -1;
+	int64_t m_presented = 0;
+	int64_t m_outOfOrder = 0;
+	int64_t m_maxLockWaitUs = 0; // under the lock
+};
+
+struct RunResult {
+	double framesPerSecondPerSink = 0;
+	int64_t maxLockWaitUs = 0;
+	int64_t outOfOrder = 0;
+};
+
+// Each sink is fed by its decoder thread, 4 frames ahead, in bursts of 4
+RunResult Run(Mode mode, int sinkCount, double seconds) {
+	std::mutex sharedLock;
+	std::vector<std::unique_ptr<std::mutex>> sinkLocks;
+	std::vector<std::unique_ptr<Sink>> sinks;
+	RunResult result;
+	{
+		WorkQueue work;
+		TimerThread timers(work);
+		for (int i = 0; i < sinkCount; i++) {
+			sinkLocks.emplace_back(new std::mutex());
+			sinks.emplace_back(new Sink(mode, mode == MODE_SHARED_LOCK ? &sharedLock : sinkLocks.back().get(), work, timers));
+		}
+
+		std::atomic<bool> isStopping{false};
+		std::vector<std::thread> decoders;
+		for (int i = 0; i < sinkCount; i++) {
+			Sink* pSink = sinks[i].get();
+			decoders.emplace_back([pSink, &isStopping]() {
+				int64_t hnsNext = NowHns() + 4 * HNS_PER_FRAME;
+				while (!isStopping) {
+					for (int j = 0; j < 4; j++) {
+						pSink->Schedule(hnsNext);
+						hnsNext += HNS_PER_FRAME;
+					}
+					std::this_thread::sleep_for(microseconds((hnsNext - 4 * HNS_PER_FRAME - NowHns()) / 10));
+				}
+			});
+		}
+		std::this_thread::sleep_for(duration<double>(seconds));
+		isStopping = true;
+		for (auto& decoder : decoders) decoder.join();
+		for (auto& sink : sinks) sink->Stop();
+		// the timer thread stops, then the work queued runs
+	}
+
+	int64_t presented = 0;
+	for (auto& sink : sinks) {
+		presented += sink->Presented();
+		result.outOfOrder += sink->OutOfOrder();
+		if (sink->MaxLockWaitUs() > result.maxLockWaitUs) result.maxLockWaitUs = sink->MaxLockWaitUs();
+	}
+	result.framesPerSecondPerSink = presented / seconds / sinkCount;
+	return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+	if (seconds <= 0) seconds = 1.0;
+
+	static const char* const MODE_NAMES[] = { "shared lock", "sink lock", "single flight" };
+	printf("%d fps per sink, %d us per present, %d work threads\n", (int)(10000000 / HNS_PER_FRAME), PRESENT_US, WORK_THREADS);
+	for (int sinkCount : { 1, 4, 16 }) {
+		for (Mode mode : { MODE_SHARED_LOCK, MODE_SINK_LOCK, MODE_SINGLE_FLIGHT }) {
+			RunResult result = Run(mode, sinkCount, seconds);
+			printf("sinks %2d  %-13s  frames/s/sink %6.1f  max lock wait %6lld us  out of order %lld\n",
+				sinkCount, MODE_NAMES[mode], result.framesPerSecondPerSink, (long long)result.maxLockWaitUs,
+				(long long)result.outOfOrder);
+			if (mode == MODE_SINGLE_FLIGHT) CHECK(result.outOfOrder == 0);
+		}
+	}
+	return TestResult();
+}
@@ -0,0 +1,161 @@
+// CSchedulerCore decisions against a simulated clock and timer: the
+// presentation window, waits in 100ns units scaled by the rate, reverse
+// playback and no clock; then frames presented through the waits, the error
+// of the present times against the window start compared with the waits
+// rounded down to whole milliseconds on a 1 ms timer (before the core).
+
+#include "SchedulerCore.h"
+#include "test_check.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DX11VideoRenderer;
+
+namespace {
+
+const int64_t HNS_PER_FRAME = 400000; // 25 fps
+
+// The presentation clock runs at 'rate' of the system time; the timer fires
+// 'hnsDelay' after it is armed, plus a jitter, or on the next 1 ms tick
+struct Simulation : SchedulerClock, SchedulerWaiter {
+	int64_t hnsNow = 0;
+	double rate = 1;
+	bool hasClock = true;
+	bool isMsTimer = false;
+	int64_t hnsWakeup = -1;
+	int64_t hnsSlack = -1;
+	std::mt19937 random{1};
+
+	bool GetClockTime(int64_t* phnsTime) override {
+		*phnsTime = (int64_t)(hnsNow * rate);
+		return hasClock;
+	}
+
+	bool WaitFor(int64_t hnsDelay, int64_t hnsSlackArg) override {
+		int64_t hnsDue = hnsNow + hnsDelay;
+		if (isMsTimer) hnsDue = (hnsDue + 9999) / 10000 * 10000 + random() % 10000;
+		else hnsDue += random() % 500; // 50 us
+		hnsWakeup = hnsDue;
+		hnsSlack = hnsSlackArg;
+		return true;
+	}
+
+	void CancelWait() override { hnsWakeup = -1; }
+};
+
+void TestWindow() {
+	Simulation sim;
+	CSchedulerCore core(sim, sim);
+	core.SetFrameInterval(HNS_PER_FRAME);
+	int64_t hnsWait = -1;
+
+	// the window: from 3/4 frame early to 1/4 frame late
+	sim.hnsNow = 1000000;
+	CHECK(core.Schedule(sim.hnsNow + 3 * HNS_PER_FRAME / 4, &hnsWait) == SCHEDULE_PRESENT && hnsWait == 0);
+	CHECK(core.Schedule(sim.hnsNow - HNS_PER_FRAME / 4, &hnsWait) == SCHEDULE_PRESENT);
+	CHECK(core.Stats().presented == 2 && core.Stats().late == 0);
+
+	// early: the wait to the window start, to the 100 ns
+	CHECK(core.Schedule(sim.hnsNow + 3 * HNS_PER_FRAME / 4 + 1234567, &hnsWait) == SCHEDULE_WAIT && hnsWait == 1234567);
+	CHECK(core.Wait(hnsWait));
+	CHECK(sim.hnsSlack == HNS_PER_FRAME / 4);
+
+	// the clock at twice the system time: half the wait, half the slack
+	core.SetRate(2.0f);
+	sim.rate = 2;
+	sim.hnsNow = 500000;
+	CHECK(core.Schedule(1000000 + 3 * HNS_PER_FRAME / 4 + 1000000, &hnsWait) == SCHEDULE_WAIT && hnsWait == 500000);
+	core.Wait(hnsWait);
+	CHECK(sim.hnsSlack == HNS_PER_FRAME / 8);
+
+	// reverse: the clock runs backward, an earlier sample time is ahead
+	core.SetRate(-1.0f);
+	sim.rate = 1;
+	sim.hnsNow = 10 * HNS_PER_FRAME;
+	CHECK(core.Schedule(5 * HNS_PER_FRAME, &hnsWait) == SCHEDULE_WAIT);
+	CHECK(core.Schedule(10 * HNS_PER_FRAME, &hnsWait) == SCHEDULE_PRESENT);
+
+	// scrubbing (rate 0) and no clock: presented as they come
+	core.SetRate(0.0f);
+	CHECK(core.Schedule(100 * HNS_PER_FRAME, &hnsWait) == SCHEDULE_PRESENT);
+	core.SetRate(1.0f);
+	sim.hasClock = false;
+	CHECK(core.Schedule(100 * HNS_PER_FRAME, &hnsWait) == SCHEDULE_PRESENT && hnsWait == 0);
+}
+
+struct ErrorStats {
+	double meanMs = 0;
+	double p99Ms = 0;
+	double maxMs = 0;
+	int early = 0; // presented before the window start
+};
+
+// Each frame waited for as CScheduler does, until the core presents it. With
+// 'isMsWaits', the wait before the core: rounded down to whole milliseconds,
+// 0 ms presenting at once.
+ErrorStats Present(double fps, double rate, bool isMsWaits) {
+	Simulation sim;
+	sim.rate = rate;
+	sim.isMsTimer = isMsWaits;
+	CSchedulerCore core(sim, sim);
+	int64_t hnsPerFrame = (int64_t)(1e7 / fps);
+	core.SetFrameInterval(hnsPerFrame);
+	core.SetRate((float)rate);
+
+	std::vector<double> errors;
+	ErrorStats stats;
+	for (int i = 1; i < 600; i++) {
+		int64_t hnsSampleTime = i * hnsPerFrame;
+		for (;;) {
+			int64_t hnsWait = 0;
+			ScheduleAction action;
+			if (isMsWaits) {
+				int64_t hnsClock = 0;
+				sim.GetClockTime(&hnsClock);
+				int64_t hnsDelta = hnsSampleTime - hnsClock;
+				long ms = (long)((hnsDelta - 3 * (hnsPerFrame / 4)) / 10000 / fabs(rate));
+				action = ms > 0 ? SCHEDULE_WAIT : SCHEDULE_PRESENT;
+				hnsWait = ms * 10000LL;
+			} else {
+				action = core.Schedule(hnsSampleTime, &hnsWait);
+			}
+			if (action != SCHEDULE_WAIT) break;
+			core.Wait(hnsWait);
+			sim.hnsNow = sim.hnsWakeup;
+		}
+		double errorMs = (sim.hnsNow * rate - (hnsSampleTime - 3 * (hnsPerFrame / 4))) / 10000.0;
+		if (errorMs < -0.001) stats.early++;
+		errors.push_back(fabs(errorMs));
+	}
+	std::sort(errors.begin(), errors.end());
+	for (double error : errors) stats.meanMs += error;
+	stats.meanMs /= errors.size();
+	stats.p99Ms = errors[errors.size() * 99 / 100];
+	stats.maxMs = errors.back();
+	return stats;
+}
+
+void TestPresentTimes() {
+	for (double fps : { 23.976, 30.0, 60.0 }) {
+		for (double rate : { 1.0, 1.5 }) {
+			ErrorStats before = Present(fps, rate, true);
+			ErrorStats core = Present(fps, rate, false);
+			printf("fps %6.3f rate %.1f  ms waits: mean %.3f p99 %.3f max %.3f ms, early %3d  core: mean %.3f p99 %.3f max %.3f ms, early %d\n",
+				fps, rate, before.meanMs, before.p99Ms, before.maxMs, before.early, core.meanMs, core.p99Ms, core.maxMs, core.early);
+			// within the timer jitter (50 us of system time), never early
+			CHECK(core.early == 0 && core.maxMs < 0.05 * rate + 0.001);
+			CHECK(core.meanMs < before.meanMs);
+		}
+	}
+}
+
+} // namespace
+
+int main() {
+	TestWindow();
+	TestPresentTimes();
+	return TestResult();
+}
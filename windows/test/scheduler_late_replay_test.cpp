@@ -0,0 +1,212 @@
+// CSchedulerCore replayed on patterns of late samples: the arrival time of
+// each frame at the scheduler on a simulated clock, the decisions and the lag
+// reports checked. On time, a decoder stall then its catch-up, steady lags
+// under and over the drop threshold, jitter, thinned playback, and a flush.
+
+#include "SchedulerCore.h"
+#include "test_check.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace DX11VideoRenderer;
+
+namespace {
+
+const int64_t HNS_PER_FRAME = 400000; // 25 fps
+
+struct Simulation : SchedulerClock, SchedulerWaiter {
+	int64_t hnsNow = 0;
+
+	bool GetClockTime(int64_t* phnsTime) override {
+		*phnsTime = hnsNow;
+		return true;
+	}
+
+	bool WaitFor(int64_t, int64_t) override { return true; }
+	void CancelWait() override {}
+};
+
+struct Replay {
+	std::vector<ScheduleAction> actions;
+	std::vector<int64_t> lagReports;
+	int maxConsecutiveDrops = 0;
+};
+
+// Frame i, due at i frames, reaches the scheduler at arrivals[i]; an early one
+// is decided again when its wait is over
+Replay Run(CSchedulerCore& core, Simulation& sim, const std::vector<int64_t>& arrivals) {
+	Replay replay;
+	int drops = 0;
+	for (size_t i = 0; i < arrivals.size(); i++) {
+		sim.hnsNow = arrivals[i];
+		int64_t hnsWait = 0;
+		ScheduleAction action = core.Schedule((int64_t)i * HNS_PER_FRAME, &hnsWait);
+		if (action == SCHEDULE_WAIT) {
+			sim.hnsNow += hnsWait;
+			action = core.Schedule((int64_t)i * HNS_PER_FRAME, &hnsWait);
+		}
+		replay.actions.push_back(action);
+		drops = action == SCHEDULE_DROP ? drops + 1 : 0;
+		replay.maxConsecutiveDrops = std::max(replay.maxConsecutiveDrops, drops);
+		int64_t hnsLag = 0;
+		if (core.TakeLagChange(&hnsLag)) replay.lagReports.push_back(hnsLag);
+	}
+	return replay;
+}
+
+std::vector<int64_t> SteadyArrivals(int count, int64_t hnsLate) {
+	std::vector<int64_t> arrivals;
+	for (int i = 0; i < count; i++) arrivals.push_back(i * HNS_PER_FRAME + hnsLate);
+	return arrivals;
+}
+
+// A frame ahead: nothing late, dropped or reported
+void TestOnTime() {
+	Simulation sim;
+	CSchedulerCore core(sim, sim);
+	core.SetFrameInterval(HNS_PER_FRAME);
+	Replay replay = Run(core, sim, SteadyArrivals(100, -HNS_PER_FRAME));
+	CHECK(std::count(replay.actions.begin(), replay.actions.end(), SCHEDULE_PRESENT) == 100);
+	CHECK(core.Stats().presented == 100 && core.Stats().late == 0 && core.Stats().dropped == 0);
+	CHECK(replay.lagReports.empty() && core.Stats().lagReports == 0);
+}
+
+// The decoder stalls 10 frames at frame 20, then delivers the backlog in a
+// burst: drops (at most MAX_CONSECUTIVE_DROPS in a row), the lag reported,
+// then back on time reported
+void TestStall() {
+	Simulation sim;
+	CSchedulerCore core(sim, sim);
+	core.SetFrameInterval(HNS_PER_FRAME);
+	std::vector<int64_t> arrivals;
+	for (int i = 0; i < 60; i++) {
+		int64_t hnsArrival = i * HNS_PER_FRAME;
+		if (i >= 20 && i < 30) hnsArrival = 30 * HNS_PER_FRAME + (i - 20) * HNS_PER_FRAME / 10;
+		arrivals.push_back(hnsArrival);
+	}
+	Replay replay = Run(core, sim, arrivals);
+	const SchedulerStats& stats = core.Stats();
+	CHECK(stats.dropped > 0 && replay.maxConsecutiveDrops <= CSchedulerCore::MAX_CONSECUTIVE_DROPS);
+	CHECK(stats.presented + stats.dropped == 60);
+	CHECK(stats.hnsMaxLateness >= 9 * HNS_PER_FRAME);
+	CHECK(replay.lagReports.size() >= 2 && replay.lagReports.front() > 0 && replay.lagReports.back() == 0);
+	for (size_t i = 30; i < 60; i++) CHECK(replay.actions[i] == SCHEDULE_PRESENT);
+}
+
+// A frame late: under the threshold (2 frames), every frame shown late, the
+// lag reported once
+void TestSteadyLag() {
+	Simulation sim;
+	CSchedulerCore core(sim, sim);
+	core.SetFrameInterval(HNS_PER_FRAME);
+	Replay replay = Run(core, sim, SteadyArrivals(50, HNS_PER_FRAME));
+	CHECK(core.Stats().late == 50 && core.Stats().dropped == 0);
+	CHECK(replay.lagReports == std::vector<int64_t>({ HNS_PER_FRAME }));
+
+	// a quarter frame more: under half a frame of change, not reported again
+	Replay more = Run(core, sim, SteadyArrivals(10, HNS_PER_FRAME * 5 / 4));
+	CHECK(more.lagReports.empty());
+	Replay worse = Run(core, sim, SteadyArrivals(10, HNS_PER_FRAME * 7 / 4));
+	CHECK(worse.lagReports == std::vector<int64_t>({ HNS_PER_FRAME * 7 / 4 }));
+}
+
+// Three frames late: the drops are capped, one frame in five still shown; no
+// drop with the threshold at 0
+void TestOverThreshold() {
+	Simulation sim;
+	CSchedulerCore core(sim, sim);
+	core.SetFrameInterval(HNS_PER_FRAME);
+	std::vector<int64_t> arrivals = SteadyArrivals(50, 3 * HNS_PER_FRAME);
+	Replay replay = Run(core, sim, arrivals);
+	CHECK(core.Stats().presented == 10 && core.Stats().dropped == 40);
+	CHECK(replay.maxConsecutiveDrops == CSchedulerCore::MAX_CONSECUTIVE_DROPS);
+
+	core.SetDropThreshold(0);
+	core.ResetStats();
+	Run(core, sim, arrivals);
+	CHECK(core.Stats().dropped == 0 && core.Stats().late == 50);
+
+	// a higher threshold
+	core.SetDropThreshold(4.0f);
+	core.ResetStats();
+	Run(core, sim, arrivals);
+	CHECK(core.Stats().dropped == 0);
+}
+
+// Keyframes only: a late one is shown, and no lag reported
+void TestThinned() {
+	Simulation sim;
+	CSchedulerCore core(sim, sim);
+	core.SetFrameInterval(HNS_PER_FRAME);
+	core.SetThinned(true);
+	Replay replay = Run(core, sim, SteadyArrivals(20, 5 * HNS_PER_FRAME));
+	CHECK(core.Stats().dropped == 0 && core.Stats().late == 20);
+	CHECK(replay.lagReports.empty());
+}
+
+// After a flush the next frames are not late from the previous ones, and the
+// first late one is reported again
+void TestFlush() {
+	Simulation sim;
+	CSchedulerCore core(sim, sim);
+	core.SetFrameInterval(HNS_PER_FRAME);
+	Replay replay = Run(core, sim, SteadyArrivals(10, HNS_PER_FRAME));
+	CHECK(replay.lagReports.size() == 1);
+	core.ResetLag();
+	CHECK(core.Stats().hnsLag == 0);
+	replay = Run(core, sim, SteadyArrivals(10, -HNS_PER_FRAME));
+	CHECK(replay.lagReports.empty());
+	replay = Run(core, sim, SteadyArrivals(10, HNS_PER_FRAME));
+	CHECK(replay.lagReports.size() == 1);
+}
+
+// Late in reverse: the clock runs backward
+void TestReverse() {
+	Simulation sim;
+	CSchedulerCore core(sim, sim);
+	core.SetFrameInterval(HNS_PER_FRAME);
+	core.SetRate(-1.0f);
+	int64_t hnsWait = 0;
+	CHECK(core.Schedule(5 * HNS_PER_FRAME, &hnsWait) == SCHEDULE_DROP);
+	CHECK(core.Schedule(-HNS_PER_FRAME, &hnsWait) == SCHEDULE_WAIT);
+}
+
+// Up to 4 frames of jitter around a frame ahead: the same replay gives the
+// same decisions, and the drop cap holds
+void TestJitter() {
+	std::vector<int64_t> arrivals;
+	unsigned seed = 1;
+	for (int i = 0; i < 500; i++) {
+		seed = seed * 1103515245 + 12345;
+		arrivals.push_back(i * HNS_PER_FRAME + (int64_t)((seed >> 8) % 4000) * HNS_PER_FRAME / 1000 - HNS_PER_FRAME);
+	}
+	Replay replays[2];
+	SchedulerStats stats[2];
+	for (int k = 0; k < 2; k++) {
+		Simulation sim;
+		CSchedulerCore core(sim, sim);
+		core.SetFrameInterval(HNS_PER_FRAME);
+		replays[k] = Run(core, sim, arrivals);
+		stats[k] = core.Stats();
+	}
+	CHECK(replays[0].actions == replays[1].actions && replays[0].lagReports == replays[1].lagReports);
+	CHECK(stats[0].presented + stats[0].dropped == 500 && stats[0].dropped > 0 && stats[0].late > 0);
+	CHECK(replays[0].maxConsecutiveDrops <= CSchedulerCore::MAX_CONSECUTIVE_DROPS);
+	printf("jitter: presented %lld, late %lld, dropped %lld, lag reports %lld\n", (long long)stats[0].presented,
+		(long long)stats[0].late, (long long)stats[0].dropped, (long long)stats[0].lagReports);
+}
+
+} // namespace
+
+int main() {
+	TestOnTime();
+	TestStall();
+	TestSteadyLag();
+	TestOverThreshold();
+	TestThinned();
+	TestFlush();
+	TestReverse();
+	TestJitter();
+	return TestResult();
+}
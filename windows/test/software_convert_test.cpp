@@ -0,0 +1,351 @@
+// CSoftwareConverter, the conversion of the CPU presenter path: each format,
+// matrix and range against a floating-point reference, the vector and scalar
+// edges of rows starting on odd pixels, the letterbox bars of a frame scaled
+// into a larger output (as LetterBoxDstRect places it), scaling, bottom-up
+// frames, clipped rectangles and the formats refused.
+
+#include "SoftwareConvert.h"
+#include "test_check.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace DX11VideoRenderer;
+
+namespace {
+
+const uint32_t OPAQUE_BLACK = 0xFF000000;
+
+const SoftwareFormat FORMATS[] = { SOFTWARE_FORMAT_NV12, SOFTWARE_FORMAT_I420, SOFTWARE_FORMAT_YV12,
+	SOFTWARE_FORMAT_YUY2, SOFTWARE_FORMAT_UYVY, SOFTWARE_FORMAT_RGB32 };
+const char* const FORMAT_NAMES[] = { "?", "NV12", "I420", "YV12", "YUY2", "UYVY", "RGB32" };
+
+struct Frame {
+	SoftwareFormat format;
+	int32_t width;
+	int32_t height;
+	int32_t stride;
+	std::vector<uint8_t> data;
+};
+
+int32_t BytesPerPixel(SoftwareFormat format) {
+	if (format == SOFTWARE_FORMAT_RGB32) return 4;
+	return format == SOFTWARE_FORMAT_YUY2 || format == SOFTWARE_FORMAT_UYVY ? 2 : 1;
+}
+
+// Random bytes, the rows padded to a multiple of 16 plus 'padding'
+Frame RandomFrame(CSoftwareConverter& converter, SoftwareFormat format, int32_t width, int32_t height, int32_t padding,
+	std::mt19937& random) {
+	Frame frame{ format, width, height, (width * BytesPerPixel(format) + 15) / 16 * 16 + padding, {} };
+	frame.data.resize(converter.FrameBytes(frame.stride));
+	for (uint8_t& byte : frame.data) byte = (uint8_t)random();
+	return frame;
+}
+
+// One color over the whole frame: Y, U, V (B, G, R for RGB32)
+Frame SolidFrame(CSoftwareConverter& converter, SoftwareFormat format, int32_t width, int32_t height, const uint8_t yuv[3]) {
+	Frame frame{ format, width, height, width * BytesPerPixel(format), {} };
+	frame.data.resize(converter.FrameBytes(frame.stride));
+	uint8_t* pChroma = frame.data.data() + (size_t)frame.stride * height;
+	size_t chromaBytes = frame.data.size() - (size_t)frame.stride * height;
+	switch (format) {
+	case SOFTWARE_FORMAT_NV12:
+		memset(frame.data.data(), yuv[0], (size_t)frame.stride * height);
+		for (size_t i = 0; i < chromaBytes; i += 2) {
+			pChroma[i] = yuv[1];
+			pChroma[i + 1] = yuv[2];
+		}
+		break;
+	case SOFTWARE_FORMAT_I420:
+	case SOFTWARE_FORMAT_YV12:
+		memset(frame.data.data(), yuv[0], (size_t)frame.stride * height);
+		memset(pChroma, format == SOFTWARE_FORMAT_I420 ? yuv[1] : yuv[2], chromaBytes / 2);
+		memset(pChroma + chromaBytes / 2, format == SOFTWARE_FORMAT_I420 ? yuv[2] : yuv[1], chromaBytes / 2);
+		break;
+	case SOFTWARE_FORMAT_YUY2:
+	case SOFTWARE_FORMAT_UYVY:
+		for (size_t i = 0; i < frame.data.size(); i += 4) {
+			const uint8_t yuy2[4] = { yuv[0], yuv[1], yuv[0], yuv[2] };
+			const uint8_t uyvy[4] = { yuv[1], yuv[0], yuv[2], yuv[0] };
+			memcpy(&frame.data[i], format == SOFTWARE_FORMAT_YUY2 ? yuy2 : uyvy, 4);
+		}
+		break;
+	default:
+		for (size_t i = 0; i < frame.data.size(); i += 4) {
+			memcpy(&frame.data[i], yuv, 3);
+			frame.data[i + 3] = 0;
+		}
+		break;
+	}
+	return frame;
+}
+
+// Pixel (x, y) of the frame in B, G, R from the matrix definition
+void ReferencePixel(const Frame& frame, int32_t x, int32_t y, bool isBT709, bool isFullRange, double bgr[3]) {
+	const uint8_t* pData = frame.data.data();
+	const uint8_t* pRow = pData + (size_t)y * frame.stride;
+	const uint8_t* pChroma = pData + (size_t)frame.stride * frame.height;
+	int32_t even = x & ~1;
+	int Y, U, V;
+	switch (frame.format) {
+	case SOFTWARE_FORMAT_RGB32:
+		for (int c = 0; c < 3; c++) bgr[c] = pRow[x * 4 + c];
+		return;
+	case SOFTWARE_FORMAT_NV12:
+		Y = pRow[x];
+		U = pChroma[(y / 2) * frame.stride + even];
+		V = pChroma[(y / 2) * frame.stride + even + 1];
+		break;
+	case SOFTWARE_FORMAT_I420:
+	case SOFTWARE_FORMAT_YV12: {
+		int32_t chromaStride = frame.stride / 2;
+		uint8_t first = pChroma[(y / 2) * chromaStride + x / 2];
+		uint8_t second = pChroma[chromaStride * (frame.height / 2) + (y / 2) * chromaStride + x / 2];
+		Y = pRow[x];
+		U = frame.format == SOFTWARE_FORMAT_I420 ? first : second;
+		V = frame.format == SOFTWARE_FORMAT_I420 ? second : first;
+		break;
+	}
+	case SOFTWARE_FORMAT_YUY2:
+		Y = pRow[x * 2];
+		U = pRow[even * 2 + 1];
+		V = pRow[even * 2 + 3];
+		break;
+	default:
+		Y = pRow[x * 2 + 1];
+		U = pRow[even * 2];
+		V = pRow[even * 2 + 2];
+		break;
+	}
+	double kr = isBT709 ? 0.2126 : 0.299, kb = isBT709 ? 0.0722 : 0.114;
+	double luma = isFullRange ? Y / 255.0 : (Y - 16) / 219.0;
+	double u = (U - 128) / (isFullRange ? 255.0 : 224.0), v = (V - 128) / (isFullRange ? 255.0 : 224.0);
+	double r = luma + 2 * (1 - kr) * v, b = luma + 2 * (1 - kb) * u, g = (luma - kr * r - kb * b) / (1 - kr - kb);
+	double rgb[3] = { b, g, r };
+	for (int c = 0; c < 3; c++) bgr[c] = std::min(255.0, std::max(0.0, rgb[c] * 255));
+}
+
+uint32_t PixelAt(const std::vector<uint8_t>& output, int32_t stride, int32_t x, int32_t y) {
+	uint32_t pixel;
+	memcpy(&pixel, &output[(size_t)y * stride + x * 4], 4);
+	return pixel;
+}
+
+// Converted at the frame size: within a step of the reference, opaque
+void TestFormats() {
+	std::mt19937 random(7);
+	for (SoftwareFormat format : FORMATS) {
+		for (int mode = 0; mode < 4; mode++) {
+			bool isBT709 = mode & 1, isFullRange = (mode & 2) != 0;
+			int32_t width = 64 + 2 * (int32_t)(random() % 40), height = 48 + 2 * (int32_t)(random() % 30);
+			CSoftwareConverter converter;
+			CHECK(converter.SetFormat(format, width, height, isBT709 ? SOFTWARE_MATRIX_BT709 : SOFTWARE_MATRIX_BT601, isFullRange));
+			Frame frame = RandomFrame(converter, format, width, height, 16 * (mode & 1), random);
+
+			std::vector<uint8_t> output((size_t)width * height * 4);
+			converter.Convert(frame.data.data(), frame.stride, SoftwareRect{ 0, 0, width, height },
+				output.data(), width * 4, width, height, SoftwareRect{ 0, 0, width, height });
+			double maxError = 0;
+			bool isOpaque = true;
+			for (int32_t y = 0; y < height; y++) {
+				for (int32_t x = 0; x < width; x++) {
+					double bgr[3];
+					ReferencePixel(frame, x, y, isBT709, isFullRange, bgr);
+					const uint8_t* pPixel = &output[((size_t)y * width + x) * 4];
+					for (int c = 0; c < 3; c++) maxError = std::max(maxError, fabs(bgr[c] - pPixel[c]));
+					isOpaque = isOpaque && pPixel[3] == 0xFF;
+				}
+			}
+			if (maxError > 1.5) printf("%s mode %d: error %.2f\n", FORMAT_NAMES[format], mode, maxError);
+			CHECK(maxError <= 1.5 && isOpaque);
+		}
+	}
+}
+
+// A source rectangle from pixel 1 to 7 (the scalar head before the vector loop,
+// a U/V pair split) and any width (the scalar tail): the same pixels as from 0
+void TestOddEdges() {
+	std::mt19937 random(11);
+	for (SoftwareFormat format : FORMATS) {
+		const int32_t WIDTH = 96, HEIGHT = 8;
+		CSoftwareConverter converter;
+		CHECK(converter.SetFormat(format, WIDTH, HEIGHT, SOFTWARE_MATRIX_BT709, false));
+		Frame frame = RandomFrame(converter, format, WIDTH, HEIGHT, 0, random);
+		std::vector<uint8_t> full((size_t)WIDTH * HEIGHT * 4);
+		converter.Convert(frame.data.data(), frame.stride, SoftwareRect{ 0, 0, WIDTH, HEIGHT },
+			full.data(), WIDTH * 4, WIDTH, HEIGHT, SoftwareRect{ 0, 0, WIDTH, HEIGHT });
+
+		bool isSame = true;
+		for (int32_t left = 1; left < 8; left++) {
+			for (int32_t width = 1; width <= 21; width += 4) {
+				std::vector<uint8_t> part((size_t)width * HEIGHT * 4);
+				converter.Convert(frame.data.data(), frame.stride, SoftwareRect{ left, 0, left + width, HEIGHT },
+					part.data(), width * 4, width, HEIGHT, SoftwareRect{ 0, 0, width, HEIGHT });
+				for (int32_t y = 0; y < HEIGHT; y++) {
+					isSame = isSame && memcmp(&part[(size_t)y * width * 4], &full[((size_t)y * WIDTH + left) * 4], (size_t)width * 4) == 0;
+				}
+			}
+		}
+		if (!isSame) printf("%s: odd edges differ\n", FORMAT_NAMES[format]);
+		CHECK(isSame);
+	}
+}
+
+// 16:9 white into a 4:3 output (letterbox), then into a 21:9 one (pillarbox),
+// the output rows padded: opaque black bars, white inside, the padding untouched
+void TestLetterbox() {
+	const uint8_t WHITE[3] = { 235, 128, 128 };
+	const int32_t PADDING = 12;
+	struct Case {
+		int32_t width, height;
+		SoftwareRect rcDst;
+	};
+	const Case CASES[] = {
+		{ 400, 300, { 0, 37, 400, 262 } },
+		{ 630, 270, { 75, 0, 555, 270 } },
+		{ 320, 180, { 0, 0, 320, 180 } }, // the same size, no bar
+	};
+	for (SoftwareFormat format : FORMATS) {
+		CSoftwareConverter converter;
+		CHECK(converter.SetFormat(format, 320, 180, SOFTWARE_MATRIX_BT709, false));
+		const uint8_t* pColor = WHITE;
+		const uint8_t BGR_WHITE[3] = { 255, 255, 255 };
+		if (format == SOFTWARE_FORMAT_RGB32) pColor = BGR_WHITE;
+		Frame frame = SolidFrame(converter, format, 320, 180, pColor);
+
+		for (const Case& test : CASES) {
+			int32_t stride = test.width * 4 + PADDING;
+			std::vector<uint8_t> output((size_t)stride * test.height, 0x5A);
+			converter.Convert(frame.data.data(), frame.stride, SoftwareRect{ 0, 0, 320, 180 },
+				output.data(), stride, test.width, test.height, test.rcDst);
+			int bars = 0, whites = 0, others = 0, padding = 0;
+			for (int32_t y = 0; y < test.height; y++) {
+				for (int32_t x = 0; x < test.width; x++) {
+					bool isInside = x >= test.rcDst.left && x < test.rcDst.right && y >= test.rcDst.top && y < test.rcDst.bottom;
+					uint32_t pixel = PixelAt(output, stride, x, y);
+					if (!isInside && pixel == OPAQUE_BLACK) bars++;
+					else if (isInside && pixel == 0xFFFFFFFF) whites++;
+					else others++;
+				}
+				for (int32_t i = 0; i < PADDING; i++) padding += output[(size_t)y * stride + test.width * 4 + i] == 0x5A;
+			}
+			int32_t inside = (test.rcDst.right - test.rcDst.left) * (test.rcDst.bottom - test.rcDst.top);
+			CHECK(others == 0 && whites == inside && bars == test.width * test.height - inside);
+			CHECK(padding == PADDING * test.height);
+		}
+	}
+}
+
+// A solid color scaled up or down stays that color; a horizontal ramp scaled
+// up stays ordered; a crop of the source is scaled, not the whole frame
+void TestScaling() {
+	const uint8_t GRAY[3] = { 126, 128, 128 };
+	CSoftwareConverter converter;
+	CHECK(converter.SetFormat(SOFTWARE_FORMAT_NV12, 160, 90, SOFTWARE_MATRIX_BT601, true));
+	Frame frame = SolidFrame(converter, SOFTWARE_FORMAT_NV12, 160, 90, GRAY);
+	for (int32_t size : { 37, 333 }) {
+		std::vector<uint8_t> output((size_t)size * size * 4);
+		converter.Convert(frame.data.data(), frame.stride, SoftwareRect{ 0, 0, 160, 90 },
+			output.data(), size * 4, size, size, SoftwareRect{ 0, 0, size, size });
+		bool isSolid = true;
+		for (int32_t i = 0; i < size * size; i++) isSolid = isSolid && PixelAt(output, 0, i, 0) == 0xFF7E7E7E;
+		CHECK(isSolid);
+	}
+
+	// RGB32, column x of value 2x: ordered after scaling, and the crop [64, 128)
+	// gives values from 128 to 254
+	CSoftwareConverter rgb;
+	CHECK(rgb.SetFormat(SOFTWARE_FORMAT_RGB32, 128, 4, SOFTWARE_MATRIX_BT601, false));
+	Frame ramp{ SOFTWARE_FORMAT_RGB32, 128, 4, 128 * 4, std::vector<uint8_t>((size_t)128 * 4 * 4) };
+	for (int32_t y = 0; y < 4; y++) {
+		for (int32_t x = 0; x < 128; x++) memset(&ramp.data[((size_t)y * 128 + x) * 4], 2 * x, 4);
+	}
+	const int32_t OUT = 300;
+	std::vector<uint8_t> output((size_t)OUT * 4 * 4);
+	rgb.Convert(ramp.data.data(), ramp.stride, SoftwareRect{ 0, 0, 128, 4 }, output.data(), OUT * 4, OUT, 4, SoftwareRect{ 0, 0, OUT, 4 });
+	bool isOrdered = true;
+	for (int32_t x = 1; x < OUT; x++) isOrdered = isOrdered && output[x * 4] >= output[(x - 1) * 4];
+	CHECK(isOrdered && output[0] == 0 && output[(OUT - 1) * 4] == 254);
+	rgb.Convert(ramp.data.data(), ramp.stride, SoftwareRect{ 64, 0, 128, 4 }, output.data(), OUT * 4, OUT, 4, SoftwareRect{ 0, 0, OUT, 4 });
+	CHECK(output[0] == 128 && output[(OUT - 1) * 4] == 254);
+}
+
+// Bottom-up RGB32 (the last row first in memory, a negative stride): the same
+// output as the frame top-down
+void TestBottomUp() {
+	std::mt19937 random(3);
+	CSoftwareConverter converter;
+	CHECK(converter.SetFormat(SOFTWARE_FORMAT_RGB32, 50, 30, SOFTWARE_MATRIX_BT601, false));
+	Frame topDown = RandomFrame(converter, SOFTWARE_FORMAT_RGB32, 50, 30, 0, random);
+	std::vector<uint8_t> bottomUp(topDown.data.size());
+	for (int32_t y = 0; y < 30; y++) {
+		memcpy(&bottomUp[(size_t)(29 - y) * topDown.stride], &topDown.data[(size_t)y * topDown.stride], (size_t)topDown.stride);
+	}
+	std::vector<uint8_t> expected(77 * 41 * 4), output(77 * 41 * 4);
+	converter.Convert(topDown.data.data(), topDown.stride, SoftwareRect{ 0, 0, 50, 30 }, expected.data(), 77 * 4, 77, 41, SoftwareRect{ 3, 2, 70, 40 });
+	converter.Convert(bottomUp.data() + (size_t)29 * topDown.stride, -topDown.stride, SoftwareRect{ 0, 0, 50, 30 },
+		output.data(), 77 * 4, 77, 41, SoftwareRect{ 3, 2, 70, 40 });
+	CHECK(output == expected);
+}
+
+// Rectangles past the edges are clipped; empty ones, or no format set, give a
+// black output
+void TestClipping() {
+	const uint8_t WHITE[3] = { 235, 128, 128 };
+	CSoftwareConverter converter;
+	CHECK(converter.SetFormat(SOFTWARE_FORMAT_I420, 64, 48, SOFTWARE_MATRIX_BT601, false));
+	Frame frame = SolidFrame(converter, SOFTWARE_FORMAT_I420, 64, 48, WHITE);
+	std::vector<uint8_t> output(100 * 100 * 4, 1);
+
+	converter.Convert(frame.data.data(), frame.stride, SoftwareRect{ -5, -5, 100, 100 }, output.data(), 400, 100, 100, SoftwareRect{ -3, 10, 120, 90 });
+	CHECK(PixelAt(output, 400, 0, 9) == OPAQUE_BLACK && PixelAt(output, 400, 0, 10) == 0xFFFFFFFF);
+	CHECK(PixelAt(output, 400, 99, 89) == 0xFFFFFFFF && PixelAt(output, 400, 99, 90) == OPAQUE_BLACK);
+
+	auto isBlack = [&output]() {
+		for (size_t i = 0; i < output.size(); i += 4) {
+			if (PixelAt(output, 0, (int32_t)(i / 4), 0) != OPAQUE_BLACK) return false;
+		}
+		return true;
+	};
+	converter.Convert(frame.data.data(), frame.stride, SoftwareRect{ 0, 0, 0, 0 }, output.data(), 400, 100, 100, SoftwareRect{ 0, 0, 100, 100 });
+	CHECK(isBlack());
+	std::fill(output.begin(), output.end(), (uint8_t)1);
+	converter.Convert(frame.data.data(), frame.stride, SoftwareRect{ 0, 0, 64, 48 }, output.data(), 400, 100, 100, SoftwareRect{ 150, 0, 200, 100 });
+	CHECK(isBlack());
+	std::fill(output.begin(), output.end(), (uint8_t)1);
+	CSoftwareConverter unset;
+	unset.Convert(frame.data.data(), frame.stride, SoftwareRect{ 0, 0, 64, 48 }, output.data(), 400, 100, 100, SoftwareRect{ 0, 0, 100, 100 });
+	CHECK(isBlack());
+}
+
+// The chroma of the subsampled formats needs even sizes
+void TestSetFormat() {
+	CSoftwareConverter converter;
+	CHECK(!converter.SetFormat(SOFTWARE_FORMAT_NV12, 63, 48, SOFTWARE_MATRIX_BT601, false) && !converter.IsFormatSet());
+	CHECK(!converter.SetFormat(SOFTWARE_FORMAT_I420, 64, 47, SOFTWARE_MATRIX_BT601, false));
+	CHECK(!converter.SetFormat(SOFTWARE_FORMAT_YUY2, 63, 48, SOFTWARE_MATRIX_BT601, false));
+	CHECK(converter.SetFormat(SOFTWARE_FORMAT_YUY2, 64, 47, SOFTWARE_MATRIX_BT601, false));
+	CHECK(converter.SetFormat(SOFTWARE_FORMAT_RGB32, 63, 47, SOFTWARE_MATRIX_BT601, false));
+	CHECK(!converter.SetFormat(SOFTWARE_FORMAT_UNKNOWN, 64, 48, SOFTWARE_MATRIX_BT601, false));
+	CHECK(!converter.SetFormat(SOFTWARE_FORMAT_RGB32, 16385, 48, SOFTWARE_MATRIX_BT601, false) && !converter.IsFormatSet());
+
+	CHECK(converter.SetFormat(SOFTWARE_FORMAT_NV12, 64, 48, SOFTWARE_MATRIX_BT601, false));
+	CHECK(converter.FrameBytes(80) == 80 * 48 + 80 * 24 && converter.FrameBytes(-80) == converter.FrameBytes(80));
+	CHECK(converter.SetFormat(SOFTWARE_FORMAT_I420, 64, 48, SOFTWARE_MATRIX_BT601, false));
+	CHECK(converter.FrameBytes(64) == 64 * 48 * 3 / 2);
+}
+
+} // namespace
+
+int main() {
+	TestFormats();
+	TestOddEdges();
+	TestLetterbox();
+	TestScaling();
+	TestBottomUp();
+	TestClipping();
+	TestSetFormat();
+	return TestResult();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+// The checks of the core tests: a failed one is printed and fails the test
+// (main returns TestResult()), the next ones still run.
+
+#include <cstdio>
+
+inline int& TestFailures() {
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			TestFailures()++; \
+		} \
+	} while (0)
+
+inline int TestResult() {
+	if (TestFailures() != 0) {
+		fprintf(stderr, "%d check(s) failed\n", TestFailures());
+		return 1;
+	}
+	printf("ok\n");
+	return 0;
+}
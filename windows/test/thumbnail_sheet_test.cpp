@@ -0,0 +1,219 @@
+// ThumbnailSheet on cache files in the working directory: the packing of the
+// tiles in rows, the cache key of a request, a sheet saved and mapped back
+// unchanged, and cached sheets refused once the video file is modified or the
+// cache file is damaged.
+
+#include "thumbnail_sheet.h"
+#include "test_check.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const fs::path CACHE_DIR = "thumbnail_sheet_cache";
+const fs::path VIDEO_PATH = CACHE_DIR / "clip.mp4";
+const fs::path SHEET_PATH = CACHE_DIR / "clip.sprite";
+
+void WriteFile(const fs::path& path, const std::string& content) {
+	std::ofstream(path, std::ios::binary) << content;
+}
+
+MediaFileIdentity Identity(uint64_t size, int64_t mtime) {
+	MediaFileIdentity identity;
+	identity.path = VIDEO_PATH;
+	identity.size = size;
+	identity.mtime = mtime;
+	return identity;
+}
+
+// Each tile filled with its index, and its time set
+void FillTiles(ThumbnailSheet& sheet) {
+	for (uint32_t i = 0; i < sheet.Count(); i++) {
+		uint8_t* pTile = sheet.Tile(i);
+		for (uint32_t y = 0; y < sheet.ThumbHeight(); y++) memset(pTile + (size_t)y * sheet.Stride(), (int)i + 1, sheet.ThumbWidth() * 4);
+		sheet.SetTimeMs(i, 1000 * i);
+	}
+}
+
+// The index of the tile at pixel (x, y) of the sheet, from its pixels
+int TileAt(const ThumbnailSheet& sheet, uint32_t x, uint32_t y) {
+	return sheet.Pixels()[(size_t)y * sheet.Stride() + x * 4] - 1;
+}
+
+void TestPacking() {
+	auto sheet = ThumbnailSheet::Create(Identity(1, 1), 16, 9, 4, 10);
+	CHECK(sheet != NULL);
+	if (sheet == NULL) return;
+	CHECK(sheet->Columns() == 4 && sheet->Rows() == 3);
+	CHECK(sheet->Width() == 64 && sheet->Height() == 27);
+	CHECK(sheet->Stride() == 256);
+	CHECK(sheet->PixelSize() == (size_t)256 * 27);
+	CHECK(sheet->TimeMs(0) == -1 && sheet->TimeMs(9) == -1);
+
+	// tiles in rows of 'columns', the last row partly empty
+	FillTiles(*sheet);
+	CHECK(TileAt(*sheet, 0, 0) == 0);
+	CHECK(TileAt(*sheet, 15, 8) == 0);
+	CHECK(TileAt(*sheet, 16, 0) == 1);
+	CHECK(TileAt(*sheet, 63, 0) == 3);
+	CHECK(TileAt(*sheet, 0, 9) == 4);
+	CHECK(TileAt(*sheet, 16, 18) == 9);
+	CHECK(TileAt(*sheet, 31, 26) == 9);
+	CHECK(TileAt(*sheet, 32, 18) == -1);
+	CHECK(TileAt(*sheet, 63, 26) == -1);
+
+	// an empty tile repeats the previous one
+	sheet->CopyTile(4, 5);
+	CHECK(TileAt(*sheet, 31, 17) == 4);
+	CHECK(TileAt(*sheet, 32, 9) == 6);
+	CHECK(sheet->TimeMs(5) == 4000);
+
+	// fewer tiles than columns: one row
+	sheet = ThumbnailSheet::Create(Identity(1, 1), 16, 9, 10, 3);
+	CHECK(sheet != NULL && sheet->Columns() == 3 && sheet->Rows() == 1);
+
+	// out of the limits
+	CHECK(ThumbnailSheet::Create(Identity(1, 1), 16, 9, 4, 0) == NULL);
+	CHECK(ThumbnailSheet::Create(Identity(1, 1), 0, 9, 4, 10) == NULL);
+	CHECK(ThumbnailSheet::Create(Identity(1, 1), 16, 9, 4, ThumbnailSheet::MAX_THUMBNAILS + 1) == NULL);
+	CHECK(ThumbnailSheet::Create(Identity(1, 1), 4096, 4096, 1, 2) == NULL);
+}
+
+void TestKey() {
+	ThumbnailRequest request;
+	request.path = VIDEO_PATH;
+	request.timesMs = { 0, 1000, 2000 };
+	ThumbnailRequest same = request;
+	CHECK(request.Key() == same.Key());
+
+	// any parameter names another sheet
+	ThumbnailRequest other = request;
+	other.path = CACHE_DIR / "other.mp4";
+	CHECK(other.Key() != request.Key());
+	other = request;
+	other.thumbWidth = 320;
+	CHECK(other.Key() != request.Key());
+	other = request;
+	other.thumbHeight = 90;
+	CHECK(other.Key() != request.Key());
+	other = request;
+	other.columns = 5;
+	CHECK(other.Key() != request.Key());
+	other = request;
+	other.timesMs[2] = 2001;
+	CHECK(other.Key() != request.Key());
+	other.timesMs = { 0, 1000 };
+	CHECK(other.Key() != request.Key());
+
+	// <key>.sprite, 16 hex digits
+	fs::path cachePath = ThumbnailSheet::CachePath(request);
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.sprite", (unsigned long long)request.Key());
+	CHECK(cachePath.filename() == name);
+	CHECK(cachePath.parent_path().filename() == "thumbs");
+}
+
+void TestRoundTrip() {
+	WriteFile(VIDEO_PATH, "video");
+	MediaFileIdentity identity;
+	CHECK(MediaFileIdentity::Query(VIDEO_PATH, &identity));
+
+	auto sheet = ThumbnailSheet::Create(identity, 16, 9, 4, 10);
+	CHECK(sheet != NULL);
+	if (sheet == NULL) return;
+	FillTiles(*sheet);
+	sheet->SetTimeMs(7, -1);
+	CHECK(sheet->Save(SHEET_PATH));
+	CHECK(!fs::exists(fs::path(SHEET_PATH).concat(".tmp")));
+
+	auto loaded = ThumbnailSheet::Load(SHEET_PATH, identity);
+	CHECK(loaded != NULL);
+	if (loaded == NULL) return;
+	CHECK(loaded->ThumbWidth() == 16 && loaded->ThumbHeight() == 9);
+	CHECK(loaded->Columns() == 4 && loaded->Rows() == 3 && loaded->Count() == 10);
+	for (uint32_t i = 0; i < 10; i++) CHECK(loaded->TimeMs(i) == sheet->TimeMs(i));
+	CHECK(loaded->TimeMs(7) == -1);
+	CHECK(loaded->PixelSize() == sheet->PixelSize());
+	CHECK(memcmp(loaded->Pixels(), sheet->Pixels(), sheet->PixelSize()) == 0);
+	CHECK(TileAt(*loaded, 16, 18) == 9);
+	// the header (48 bytes) and the times, then the pixels from a 16-byte boundary
+	CHECK(fs::file_size(SHEET_PATH) == 128 + sheet->PixelSize());
+
+	// saved again over the cached one (no longer mapped: Windows would refuse to replace it)
+	loaded.reset();
+	sheet->SetTimeMs(0, 42);
+	CHECK(sheet->Save(SHEET_PATH));
+	auto reloaded = ThumbnailSheet::Load(SHEET_PATH, identity);
+	CHECK(reloaded != NULL && reloaded->TimeMs(0) == 42);
+}
+
+void TestStaleIdentity() {
+	WriteFile(VIDEO_PATH, "video");
+	MediaFileIdentity identity;
+	CHECK(MediaFileIdentity::Query(VIDEO_PATH, &identity));
+	auto sheet = ThumbnailSheet::Create(identity, 16, 9, 4, 10);
+	CHECK(sheet != NULL && sheet->Save(SHEET_PATH));
+	CHECK(ThumbnailSheet::Load(SHEET_PATH, identity) != NULL);
+
+	// another size or modification time: made from another version of the video
+	CHECK(ThumbnailSheet::Load(SHEET_PATH, Identity(identity.size + 1, identity.mtime)) == NULL);
+	CHECK(ThumbnailSheet::Load(SHEET_PATH, Identity(identity.size, identity.mtime + 1)) == NULL);
+
+	// the video file rewritten
+	WriteFile(VIDEO_PATH, "video, re-encoded");
+	MediaFileIdentity modified;
+	CHECK(MediaFileIdentity::Query(VIDEO_PATH, &modified));
+	CHECK(ThumbnailSheet::Load(SHEET_PATH, modified) == NULL);
+}
+
+void TestDamagedFile() {
+	WriteFile(VIDEO_PATH, "video");
+	MediaFileIdentity identity;
+	CHECK(MediaFileIdentity::Query(VIDEO_PATH, &identity));
+	auto sheet = ThumbnailSheet::Create(identity, 16, 9, 4, 10);
+	CHECK(sheet != NULL && sheet->Save(SHEET_PATH));
+	uintmax_t size = fs::file_size(SHEET_PATH);
+
+	CHECK(ThumbnailSheet::Load(CACHE_DIR / "missing.sprite", identity) == NULL);
+
+	// truncated
+	fs::resize_file(SHEET_PATH, size - 1);
+	CHECK(ThumbnailSheet::Load(SHEET_PATH, identity) == NULL);
+	fs::resize_file(SHEET_PATH, 8);
+	CHECK(ThumbnailSheet::Load(SHEET_PATH, identity) == NULL);
+
+	// another format
+	CHECK(sheet->Save(SHEET_PATH));
+	{
+		std::fstream file(SHEET_PATH, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(4); // the version
+		file.put(2);
+	}
+	CHECK(ThumbnailSheet::Load(SHEET_PATH, identity) == NULL);
+	CHECK(sheet->Save(SHEET_PATH));
+	{
+		std::fstream file(SHEET_PATH, std::ios::binary | std::ios::in | std::ios::out);
+		file.put('x'); // the magic
+	}
+	CHECK(ThumbnailSheet::Load(SHEET_PATH, identity) == NULL);
+}
+
+} // namespace
+
+int main() {
+	std::error_code ec;
+	fs::remove_all(CACHE_DIR, ec);
+	fs::create_directories(CACHE_DIR);
+
+	TestPacking();
+	TestKey();
+	TestRoundTrip();
+	TestStaleIdentity();
+	TestDamagedFile();
+	return TestResult();
+}
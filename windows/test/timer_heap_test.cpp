@@ -0,0 +1,247 @@
+// CTimerHeap as CTimerWheel drives it: timers armed, cancelled and armed
+// again, the wakeup at the earliest latest time (due + slack), the timers
+// due taken in the order of their latest time, none before its due time nor
+// left past its latest one; then 200000 random operations checked against a
+// plain model, the clock following the wakeups.
+
+#include "TimerHeap.h"
+#include "test_check.h"
+
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace DX11VideoRenderer;
+
+namespace {
+
+void* Context(uintptr_t id) {
+	return (void*)id;
+}
+
+uintptr_t Id(void* pContext) {
+	return (uintptr_t)pContext;
+}
+
+std::vector<uintptr_t> TakeDue(CTimerHeap& heap, int64_t hnsNow) {
+	std::vector<void*> contexts;
+	heap.TakeDue(hnsNow, &contexts);
+	std::vector<uintptr_t> ids;
+	for (void* p : contexts) ids.push_back(Id(p));
+	return ids;
+}
+
+void TestArm() {
+	CTimerHeap heap;
+	int64_t wakeup = 0;
+	CHECK(!heap.NextWakeup(&wakeup));
+	CHECK(heap.Count() == 0);
+
+	uint64_t a = heap.Arm(1000, 200, Context(1));
+	uint64_t b = heap.Arm(500, 0, Context(2));
+	CHECK(a != 0 && b != 0 && a != b);
+	CHECK(heap.IsArmed(a) && heap.IsArmed(b));
+	CHECK(!heap.IsArmed(0));
+	CHECK(heap.Count() == 2);
+	CHECK(heap.NextWakeup(&wakeup) && wakeup == 500);
+
+	// a negative slack is none
+	uint64_t c = heap.Arm(400, -100, Context(3));
+	CHECK(heap.NextWakeup(&wakeup) && wakeup == 400);
+
+	// never before it is due
+	CHECK(TakeDue(heap, 399).empty());
+	CHECK(TakeDue(heap, 400) == std::vector<uintptr_t>({ 3 }));
+	CHECK(!heap.IsArmed(c));
+	CHECK(TakeDue(heap, 999) == std::vector<uintptr_t>({ 2 }));
+	CHECK(heap.NextWakeup(&wakeup) && wakeup == 1200);
+	CHECK(TakeDue(heap, 1000) == std::vector<uintptr_t>({ 1 }));
+	CHECK(heap.Count() == 0);
+	CHECK(!heap.NextWakeup(&wakeup));
+}
+
+void TestCancel() {
+	CTimerHeap heap;
+	uint64_t a = heap.Arm(100, 0, Context(1));
+	uint64_t b = heap.Arm(200, 0, Context(2));
+	uint64_t c = heap.Arm(300, 0, Context(3));
+
+	// the context back once
+	void* pContext = NULL;
+	CHECK(heap.Cancel(b, &pContext) && Id(pContext) == 2);
+	CHECK(!heap.IsArmed(b));
+	pContext = NULL;
+	CHECK(!heap.Cancel(b, &pContext) && pContext == NULL);
+	CHECK(!heap.Cancel(0, &pContext));
+	CHECK(heap.Count() == 2);
+
+	// the top one: the wakeup moves to the next
+	CHECK(heap.Cancel(a, &pContext) && Id(pContext) == 1);
+	int64_t wakeup = 0;
+	CHECK(heap.NextWakeup(&wakeup) && wakeup == 300);
+	CHECK(TakeDue(heap, 1000) == std::vector<uintptr_t>({ 3 }));
+
+	// a fired timer is not cancelled
+	CHECK(!heap.Cancel(c, &pContext));
+}
+
+void TestRearm() {
+	CTimerHeap heap;
+	uint64_t a = heap.Arm(1000, 0, Context(1));
+	heap.Arm(2000, 0, Context(2));
+
+	// earlier: a new key, the old one stays dead
+	void* pContext = NULL;
+	CHECK(heap.Cancel(a, &pContext));
+	uint64_t a2 = heap.Arm(500, 0, pContext);
+	CHECK(a2 != a);
+	CHECK(!heap.IsArmed(a) && heap.IsArmed(a2));
+	int64_t wakeup = 0;
+	CHECK(heap.NextWakeup(&wakeup) && wakeup == 500);
+
+	// later, past the other timer
+	CHECK(heap.Cancel(a2, &pContext));
+	uint64_t a3 = heap.Arm(3000, 0, pContext);
+	CHECK(heap.NextWakeup(&wakeup) && wakeup == 2000);
+	CHECK(TakeDue(heap, 1000).empty());
+	CHECK(TakeDue(heap, 2000) == std::vector<uintptr_t>({ 2 }));
+	CHECK(TakeDue(heap, 3000) == std::vector<uintptr_t>({ 1 }));
+	CHECK(!heap.IsArmed(a3));
+
+	// armed again after it fired
+	uint64_t a4 = heap.Arm(4000, 0, Context(1));
+	CHECK(a4 != a3 && heap.IsArmed(a4));
+	CHECK(heap.Count() == 1);
+}
+
+void TestSlackOrdering() {
+	CTimerHeap heap;
+	heap.Arm(100, 50, Context(1));  // latest 150
+	heap.Arm(120, 0, Context(2));   // latest 120
+	heap.Arm(130, 100, Context(3)); // latest 230
+	int64_t wakeup = 0;
+	CHECK(heap.NextWakeup(&wakeup) && wakeup == 120);
+
+	// one wakeup for the first two, in the order of their latest time; the third is not due
+	CHECK(TakeDue(heap, 120) == std::vector<uintptr_t>({ 2, 1 }));
+	CHECK(heap.NextWakeup(&wakeup) && wakeup == 230);
+	CHECK(TakeDue(heap, 230) == std::vector<uintptr_t>({ 3 }));
+
+	// a timer due below one that is not: it waits for the next wakeup, before its latest time
+	heap.Arm(0, 1000, Context(4));  // latest 1000
+	heap.Arm(500, 0, Context(5));   // latest 500
+	CHECK(TakeDue(heap, 400).empty());
+	CHECK(heap.NextWakeup(&wakeup) && wakeup == 500);
+	CHECK(TakeDue(heap, 500) == std::vector<uintptr_t>({ 5, 4 }));
+
+	// the same latest time: armed first, fires first
+	heap.Arm(900, 100, Context(6));
+	heap.Arm(1000, 0, Context(7));
+	heap.Arm(950, 50, Context(8));
+	CHECK(TakeDue(heap, 1000) == std::vector<uintptr_t>({ 6, 7, 8 }));
+}
+
+struct ModelTimer {
+	int64_t hnsDue = 0;
+	int64_t hnsLatest = 0;
+	int64_t hnsArmed = 0;
+	uint64_t key = 0;
+};
+
+// Random arms, cancels and wakeups against a map of the timers armed
+void TestRandomOperations() {
+	const int OPERATIONS = 200000;
+	std::mt19937 random(48);
+	CTimerHeap heap;
+	std::map<uintptr_t, ModelTimer> model; // by id, the context of the timer
+	std::vector<uint64_t> keys(1, 0);      // by id, armed or not
+	std::vector<int> handedBack(1, 0);     // by id: times the context came back
+	int64_t hnsNow = 0;
+	uint64_t fired = 0;
+	uint64_t cancelled = 0;
+
+	for (int i = 0; i < OPERATIONS; i++) {
+		int op = (int)(random() % 10);
+		if (op < 5) {
+			ModelTimer timer;
+			timer.hnsDue = hnsNow + (int64_t)(random() % 100000) - 1000; // some due already
+			int64_t hnsSlack = random() % 4 == 0 ? 0 : (int64_t)(random() % 20000);
+			timer.hnsLatest = timer.hnsDue + hnsSlack;
+			timer.hnsArmed = hnsNow;
+			uintptr_t id = keys.size();
+			timer.key = heap.Arm(timer.hnsDue, hnsSlack, Context(id));
+			CHECK(timer.key != 0 && timer.key != keys.back());
+			model[id] = timer;
+			keys.push_back(timer.key);
+			handedBack.push_back(0);
+		} else if (op < 7) {
+			// one of the last timers armed: may have fired or been cancelled
+			uintptr_t id = keys.size() - 1 - random() % (keys.size() < 32 ? keys.size() : 32);
+			if (id == 0) continue;
+			auto it = model.find(id);
+			void* pContext = NULL;
+			bool isCancelled = heap.Cancel(keys[id], &pContext);
+			CHECK(isCancelled == (it != model.end()));
+			CHECK(heap.IsArmed(keys[id]) == false);
+			if (isCancelled) {
+				CHECK(Id(pContext) == id);
+				handedBack[id]++;
+				model.erase(id);
+				cancelled++;
+			}
+		} else {
+			// the clock moves up to the wakeup, never past it
+			int64_t wakeup = 0;
+			bool hasWakeup = heap.NextWakeup(&wakeup);
+			CHECK(hasWakeup == !model.empty());
+			int64_t hnsStep = (int64_t)(random() % 30000);
+			if (hasWakeup && hnsNow + hnsStep > wakeup) hnsStep = wakeup - hnsNow;
+			if (hnsStep > 0) hnsNow += hnsStep;
+
+			std::vector<uintptr_t> ids = TakeDue(heap, hnsNow);
+			const ModelTimer* pPrevious = NULL;
+			for (uintptr_t id : ids) {
+				auto it = model.find(id);
+				CHECK(it != model.end());
+				if (it == model.end()) continue;
+				handedBack[id]++;
+				const ModelTimer& timer = it->second;
+				// never before it is due, nor after its latest time (unless armed after it)
+				CHECK(timer.hnsDue <= hnsNow);
+				CHECK(hnsNow <= (timer.hnsLatest > timer.hnsArmed ? timer.hnsLatest : timer.hnsArmed));
+				if (pPrevious != NULL) {
+					CHECK(pPrevious->hnsLatest < timer.hnsLatest
+						|| (pPrevious->hnsLatest == timer.hnsLatest && pPrevious->key < timer.key));
+				}
+				pPrevious = &timer;
+				fired++;
+			}
+			for (uintptr_t id : ids) model.erase(id);
+			// the top of what is left is not due
+			if (heap.NextWakeup(&wakeup)) CHECK(wakeup > hnsNow);
+		}
+		CHECK(heap.Count() == model.size());
+	}
+
+	// the rest fires at the end of time
+	std::vector<uintptr_t> ids = TakeDue(heap, INT64_MAX);
+	for (uintptr_t id : ids) handedBack[id]++;
+	fired += ids.size();
+	CHECK(heap.Count() == 0);
+
+	for (size_t id = 1; id < handedBack.size(); id++) CHECK(handedBack[id] == 1);
+	CHECK(fired + cancelled == handedBack.size() - 1);
+	CHECK(fired > 0 && cancelled > 0);
+}
+
+} // namespace
+
+int main() {
+	TestArm();
+	TestCancel();
+	TestRearm();
+	TestSlackOrdering();
+	TestRandomOperations();
+	return TestResult();
+}
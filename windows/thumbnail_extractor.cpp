@@ -0,0 +1,243 @@
+// ref: https://learn.microsoft.com/en-us/windows/win32/medfound/using-the-source-reader-to-process-media-data
+// ref: https://learn.microsoft.com/en-us/windows/win32/medfound/seeking-fast-forward-and-reverse-play
+
+#include "thumbnail_extractor.h"
+
+#include <mfapi.h>
+#include <mfidl.h>
+#include <mfreadwrite.h>
+#include <propvarutil.h>
+#include <cstring>
+
+#include <wil/com.h>
+
+#include "mp4_keyframe_index.h"
+#include "video_convert.h"
+#include "worker_pool.h"
+
+#pragma comment(lib, "mfplat")
+#pragma comment(lib, "mfuuid")
+#pragma comment(lib, "Mfreadwrite")
+
+#define CHECK_HR(x) if (FAILED(x)) { goto done; }
+
+HRESULT GetFrameLayout(IMFSourceReader* pReader, FrameLayout* pLayout)
+{
+    HRESULT hr = S_OK;
+    wil::com_ptr<IMFMediaType> pType;
+    MFVideoArea area;
+    UINT32 stride = 0;
+
+    CHECK_HR(hr = pReader->GetCurrentMediaType((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, &pType));
+    CHECK_HR(hr = MFGetAttributeSize(pType.get(), MF_MT_FRAME_SIZE, &pLayout->frameWidth, &pLayout->frameHeight));
+
+    pLayout->visibleWidth = pLayout->frameWidth;
+    pLayout->visibleHeight = pLayout->frameHeight;
+    if (SUCCEEDED(pType->GetBlob(MF_MT_MINIMUM_DISPLAY_APERTURE, (UINT8*)&area, sizeof(area), NULL)) &&
+        area.Area.cx > 0 && area.Area.cy > 0 &&
+        (UINT32)area.Area.cx <= pLayout->frameWidth && (UINT32)area.Area.cy <= pLayout->frameHeight) {
+        pLayout->visibleWidth = (UINT32)area.Area.cx;
+        pLayout->visibleHeight = (UINT32)area.Area.cy;
+    }
+
+    pLayout->stride = pLayout->frameWidth;
+    if (SUCCEEDED(pType->GetUINT32(MF_MT_DEFAULT_STRIDE, &stride)) && (INT32)stride > 0) {
+        pLayout->stride = stride;
+    }
+    if (pLayout->visibleWidth < 2 || pLayout->visibleHeight < 2) hr = MF_E_INVALIDMEDIATYPE;
+
+done:
+    return hr;
+}
+
+HRESULT CreateNv12Reader(const WCHAR* pszPath, IMFSourceReader** ppReader, FrameLayout* pLayout)
+{
+    HRESULT hr = S_OK;
+    wil::com_ptr<IMFAttributes> pAttributes;
+    wil::com_ptr<IMFSourceReader> pReader;
+    wil::com_ptr<IMFMediaType> pType;
+
+    // the video processor converts any decoder output to NV12
+    CHECK_HR(hr = MFCreateAttributes(&pAttributes, 1));
+    CHECK_HR(hr = pAttributes->SetUINT32(MF_SOURCE_READER_ENABLE_VIDEO_PROCESSING, TRUE));
+    CHECK_HR(hr = MFCreateSourceReaderFromURL(pszPath, pAttributes.get(), &pReader));
+    CHECK_HR(hr = pReader->SetStreamSelection((DWORD)MF_SOURCE_READER_ALL_STREAMS, FALSE));
+    CHECK_HR(hr = pReader->SetStreamSelection((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, TRUE));
+
+    CHECK_HR(hr = MFCreateMediaType(&pType));
+    CHECK_HR(hr = pType->SetGUID(MF_MT_MAJOR_TYPE, MFMediaType_Video));
+    CHECK_HR(hr = pType->SetGUID(MF_MT_SUBTYPE, MFVideoFormat_NV12));
+    CHECK_HR(hr = pReader->SetCurrentMediaType((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, NULL, pType.get()));
+    CHECK_HR(hr = GetFrameLayout(pReader.get(), pLayout));
+    *ppReader = pReader.detach();
+
+done:
+    return hr;
+}
+
+// Decodes the first frame at or after the keyframe before 'hns' into tile 'tile'.
+// Returns S_FALSE if 'hns' is after the end of the stream.
+static HRESULT DecodeTile(IMFSourceReader* pReader, LONGLONG hns, FrameLayout* pLayout, ThumbnailSheet* pSheet, uint32_t tile)
+{
+    HRESULT hr = S_OK;
+    PROPVARIANT var;
+    DWORD flags = 0;
+    LONGLONG hnsSample = 0;
+    wil::com_ptr<IMFSample> pSample;
+    wil::com_ptr<IMFMediaBuffer> pBuffer;
+    wil::com_ptr<IMF2DBuffer> p2DBuffer;
+    BYTE* pData = NULL;
+    LONG pitch = 0;
+    DWORD cbLength = 0;
+    bool is2DLocked = false;
+    bool isLocked = false;
+    Nv12Frame frame;
+
+    PropVariantInit(&var);
+    CHECK_HR(hr = InitPropVariantFromInt64(hns < 0 ? 0 : hns, &var));
+    CHECK_HR(hr = pReader->SetCurrentPosition(GUID_NULL, var));
+
+    // the source seeks to the keyframe before the position, so the first sample is that keyframe
+    for (int i = 0; i < 100 && !pSample; i++) {
+        CHECK_HR(hr = pReader->ReadSample((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, NULL, &flags, &hnsSample, &pSample));
+        if (flags & MF_SOURCE_READERF_ENDOFSTREAM) {
+            hr = S_FALSE;
+            goto done;
+        }
+        if (flags & MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED) {
+            CHECK_HR(hr = GetFrameLayout(pReader, pLayout));
+        }
+    }
+    if (!pSample) {
+        hr = S_FALSE;
+        goto done;
+    }
+
+    CHECK_HR(hr = pSample->ConvertToContiguousBuffer(&pBuffer));
+    if (SUCCEEDED(pBuffer->QueryInterface(IID_PPV_ARGS(&p2DBuffer))) && SUCCEEDED(p2DBuffer->Lock2D(&pData, &pitch))) {
+        is2DLocked = true;
+    } else {
+        CHECK_HR(hr = pBuffer->Lock(&pData, NULL, &cbLength));
+        isLocked = true;
+        pitch = (LONG)pLayout->stride;
+        if ((UINT64)pitch * pLayout->frameHeight * 3 / 2 > cbLength) {
+            hr = MF_E_BUFFERTOOSMALL;
+            goto done;
+        }
+    }
+    if (pitch <= 0) {
+        hr = MF_E_UNSUPPORTED_FORMAT; // bottom-up NV12 does not exist in practice
+        goto done;
+    }
+
+    frame.y = pData;
+    frame.uv = pData + (size_t)pitch * pLayout->frameHeight;
+    frame.width = pLayout->visibleWidth;
+    frame.height = pLayout->visibleHeight;
+    frame.stride = (uint32_t)pitch;
+    ConvertScaleNv12ToRgba(frame, pSheet->Tile(tile), pSheet->ThumbWidth(), pSheet->ThumbHeight(), pSheet->Stride());
+    pSheet->SetTimeMs(tile, hnsSample / 10000);
+
+done:
+    if (is2DLocked) p2DBuffer->Unlock2D();
+    if (isLocked) pBuffer->Unlock();
+    PropVariantClear(&var);
+    return hr;
+}
+
+HRESULT ExtractThumbnails(const ThumbnailRequest& request, std::shared_ptr<ThumbnailSheet>* ppSheet)
+{
+    HRESULT hr = S_OK;
+    MediaFileIdentity identity;
+    wil::com_ptr<IMFSourceReader> pReader;
+    std::shared_ptr<ThumbnailSheet> pSheet;
+    std::shared_ptr<const Mp4KeyframeIndex> pIndex;
+    FrameLayout layout;
+    UINT32 thumbHeight = request.thumbHeight;
+    LONGLONG hnsLastKeyframe = -1;
+
+    if (request.timesMs.empty() || request.thumbWidth == 0) return E_INVALIDARG;
+    if (!MediaFileIdentity::Query(request.path, &identity)) return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+
+    CHECK_HR(hr = CreateNv12Reader(request.path.c_str(), &pReader, &layout));
+
+    if (thumbHeight == 0) {
+        thumbHeight = (UINT32)((UINT64)request.thumbWidth * layout.visibleHeight / layout.visibleWidth) & ~1u;
+        if (thumbHeight < 2) thumbHeight = 2;
+    }
+    pSheet = ThumbnailSheet::Create(identity, request.thumbWidth, thumbHeight, request.columns, (uint32_t)request.timesMs.size());
+    if (!pSheet) {
+        hr = E_INVALIDARG;
+        goto done;
+    }
+
+    // with an index, times are snapped to their keyframe beforehand, and a keyframe is decoded once
+    pIndex = Mp4KeyframeIndexCache::Get(request.path);
+
+    for (uint32_t i = 0; i < pSheet->Count(); i++) {
+        LONGLONG hns = request.timesMs[i] * 10000;
+        if (pIndex) {
+            hns = pIndex->PreviousKeyframe(hns);
+            if (i > 0 && hns == hnsLastKeyframe) {
+                pSheet->CopyTile(i - 1, i);
+                continue;
+            }
+            hnsLastKeyframe = hns;
+        }
+        CHECK_HR(hr = DecodeTile(pReader.get(), hns, &layout, pSheet.get(), i));
+    }
+    hr = S_OK;
+    *ppSheet = pSheet;
+
+done:
+    return hr;
+}
+
+ThumbnailService& ThumbnailService::Instance()
+{
+    static ThumbnailService instance;
+    return instance;
+}
+
+void ThumbnailService::Request(const ThumbnailRequest& request, Callback callback)
+{
+    uint64_t key = request.Key();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& waiting = m_inFlight[key];
+        waiting.push_back(callback);
+        if (waiting.size() > 1) return; // the same sheet is being made
+    }
+    WorkerPool::Shared().Post([this, request, key]() { Run(request, key); });
+}
+
+void ThumbnailService::Run(const ThumbnailRequest& request, uint64_t key)
+{
+    std::shared_ptr<ThumbnailSheet> pSheet;
+    MediaFileIdentity identity;
+    std::filesystem::path cachePath = ThumbnailSheet::CachePath(request);
+
+    if (MediaFileIdentity::Query(request.path, &identity)) {
+        if (!cachePath.empty()) pSheet = ThumbnailSheet::Load(cachePath, identity);
+        if (!pSheet) {
+            CoInitializeEx(NULL, COINIT_MULTITHREADED);
+            if (FAILED(ExtractThumbnails(request, &pSheet))) pSheet = NULL;
+            CoUninitialize();
+
+            if (pSheet && !cachePath.empty() && pSheet->Save(cachePath)) {
+                ThumbnailSheet::TrimCache(MAX_CACHE_BYTES);
+                // serve the mapped copy: the pixels stay in the page cache instead of the heap
+                auto pMapped = ThumbnailSheet::Load(cachePath, identity);
+                if (pMapped) pSheet = pMapped;
+            }
+        }
+    }
+
+    std::vector<Callback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        callbacks.swap(m_inFlight[key]);
+        m_inFlight.erase(key);
+    }
+    for (auto& callback : callbacks) callback(pSheet);
+}
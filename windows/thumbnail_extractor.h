@@ -0,0 +1,56 @@
+#pragma once
+
+// Batch thumbnail extraction with an IMFSourceReader (no media session, no texture):
+// for each requested time the reader seeks to the keyframe before it, and only that
+// keyframe is decoded, converted and downscaled into its tile of the sprite sheet.
+
+#include <windows.h>
+#include <mfreadwrite.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "thumbnail_sheet.h"
+
+struct FrameLayout
+{
+    UINT32 frameWidth = 0;   // decoded buffer size (ex. 1920x1088 for H.264)
+    UINT32 frameHeight = 0;
+    UINT32 visibleWidth = 0; // display aperture (ex. 1920x1080)
+    UINT32 visibleHeight = 0;
+    UINT32 stride = 0;
+};
+
+// Source reader of the first video stream of 'pszPath', decoding to NV12 (the video processor
+// converts any decoder output). Also used by the GOP decoder of frame stepping.
+HRESULT CreateNv12Reader(const WCHAR* pszPath, IMFSourceReader** ppReader, FrameLayout* pLayout);
+// Reads the layout back after MF_SOURCE_READERF_CURRENTMEDIATYPECHANGED
+HRESULT GetFrameLayout(IMFSourceReader* pReader, FrameLayout* pLayout);
+
+// Must be called on a thread with COM initialized, after MFStartup()
+HRESULT ExtractThumbnails(const ThumbnailRequest& request, std::shared_ptr<ThumbnailSheet>* ppSheet);
+
+// Serves thumbnail requests from the disk cache, or extracts them on the shared worker pool.
+// Identical requests made while one is running share its result.
+class ThumbnailService
+{
+public:
+    typedef std::function<void(std::shared_ptr<const ThumbnailSheet>)> Callback; // NULL sheet on failure
+
+    static ThumbnailService& Instance();
+
+    // 'callback' is called on a worker thread
+    void Request(const ThumbnailRequest& request, Callback callback);
+
+    static const uint64_t MAX_CACHE_BYTES = 256 * 1024 * 1024;
+
+private:
+    ThumbnailService() {}
+
+    void Run(const ThumbnailRequest& request, uint64_t key);
+
+    std::mutex m_mutex;
+    std::map<uint64_t, std::vector<Callback>> m_inFlight; // request key -> waiting callbacks
+};
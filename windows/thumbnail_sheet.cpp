@@ -0,0 +1,162 @@
+#include "thumbnail_sheet.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+
+static const uint32_t SHEET_MAGIC = 0x53545056; // 'VPTS'
+static const uint32_t SHEET_VERSION = 1;
+
+static uint64_t Fnv1a(uint64_t h, const void* data, size_t len)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	for (size_t i = 0; i < len; i++) {
+		h ^= p[i];
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+uint64_t ThumbnailRequest::Key() const
+{
+	const auto& native = path.native();
+	uint64_t h = Fnv1a(0xcbf29ce484222325ULL, native.data(), native.size() * sizeof(native[0]));
+	h = Fnv1a(h, &thumbWidth, sizeof(thumbWidth));
+	h = Fnv1a(h, &thumbHeight, sizeof(thumbHeight));
+	h = Fnv1a(h, &columns, sizeof(columns));
+	return Fnv1a(h, timesMs.data(), timesMs.size() * sizeof(int64_t));
+}
+
+std::shared_ptr<ThumbnailSheet> ThumbnailSheet::Create(const MediaFileIdentity& identity,
+	uint32_t thumbWidth, uint32_t thumbHeight, uint32_t columns, uint32_t count)
+{
+	if (thumbWidth == 0 || thumbHeight == 0 || columns == 0 || count == 0 || count > MAX_THUMBNAILS) return NULL;
+	if (columns > count) columns = count;
+	uint32_t rows = (count + columns - 1) / columns;
+	uint64_t pixelSize = (uint64_t)thumbWidth * columns * 4 * thumbHeight * rows;
+	if (pixelSize > MAX_PIXEL_BYTES) return NULL;
+
+	auto sheet = std::make_shared<ThumbnailSheet>();
+	sheet->m_memory.resize(PixelOffset(count) + (size_t)pixelSize);
+	sheet->m_pData = sheet->m_memory.data();
+	sheet->m_size = sheet->m_memory.size();
+
+	FileHeader* pHeader = (FileHeader*)sheet->m_memory.data();
+	pHeader->magic = SHEET_MAGIC;
+	pHeader->version = SHEET_VERSION;
+	pHeader->fileSize = identity.size;
+	pHeader->fileMtime = identity.mtime;
+	pHeader->thumbWidth = thumbWidth;
+	pHeader->thumbHeight = thumbHeight;
+	pHeader->columns = columns;
+	pHeader->rows = rows;
+	pHeader->count = count;
+	for (uint32_t i = 0; i < count; i++) sheet->SetTimeMs(i, -1);
+	return sheet;
+}
+
+void ThumbnailSheet::CopyTile(uint32_t from, uint32_t to)
+{
+	const uint8_t* pSrc = Tile(from);
+	uint8_t* pDst = Tile(to);
+	for (uint32_t y = 0; y < ThumbHeight(); y++) {
+		memcpy(pDst + (size_t)y * Stride(), pSrc + (size_t)y * Stride(), (size_t)ThumbWidth() * 4);
+	}
+	SetTimeMs(to, TimeMs(from));
+}
+
+std::shared_ptr<ThumbnailSheet> ThumbnailSheet::Load(const std::filesystem::path& cachePath, const MediaFileIdentity& identity)
+{
+	auto sheet = std::make_shared<ThumbnailSheet>();
+	if (!sheet->m_file.Open(cachePath)) return NULL;
+	if (sheet->m_file.Size() < sizeof(FileHeader)) return NULL;
+
+	const FileHeader* pHeader = (const FileHeader*)sheet->m_file.Data();
+	if (pHeader->magic != SHEET_MAGIC || pHeader->version != SHEET_VERSION) return NULL;
+	if (pHeader->fileSize != identity.size || pHeader->fileMtime != identity.mtime) return NULL;
+	if (pHeader->count == 0 || pHeader->count > MAX_THUMBNAILS || pHeader->columns == 0) return NULL;
+	if (pHeader->rows != (pHeader->count + pHeader->columns - 1) / pHeader->columns) return NULL;
+
+	uint64_t pixelSize = (uint64_t)pHeader->thumbWidth * pHeader->columns * 4 * pHeader->thumbHeight * pHeader->rows;
+	if (pixelSize > MAX_PIXEL_BYTES || sheet->m_file.Size() != PixelOffset(pHeader->count) + pixelSize) return NULL;
+
+	sheet->m_pData = sheet->m_file.Data();
+	sheet->m_size = (size_t)sheet->m_file.Size();
+	return sheet;
+}
+
+bool ThumbnailSheet::Save(const std::filesystem::path& cachePath) const
+{
+	std::error_code ec;
+	std::filesystem::create_directories(cachePath.parent_path(), ec);
+
+	std::filesystem::path tmpPath = cachePath;
+	tmpPath += ".tmp";
+
+	FILE* fp = NULL;
+#ifdef _WIN32
+	if (_wfopen_s(&fp, tmpPath.c_str(), L"wb") != 0) fp = NULL;
+#else
+	fp = fopen(tmpPath.c_str(), "wb");
+#endif
+	if (fp == NULL) return false;
+	bool isWritten = fwrite(m_pData, 1, m_size, fp) == m_size;
+	isWritten = fclose(fp) == 0 && isWritten;
+
+	if (isWritten) std::filesystem::rename(tmpPath, cachePath, ec);
+	if (!isWritten || ec) {
+		std::filesystem::remove(tmpPath, ec);
+		return false;
+	}
+	return true;
+}
+
+static std::filesystem::path CacheDirectory()
+{
+	std::error_code ec;
+	std::filesystem::path dir = std::filesystem::temp_directory_path(ec);
+	if (ec) return std::filesystem::path();
+	return dir / "video_player_win" / "thumbs";
+}
+
+std::filesystem::path ThumbnailSheet::CachePath(const ThumbnailRequest& request)
+{
+	std::filesystem::path dir = CacheDirectory();
+	if (dir.empty()) return dir;
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.sprite", (unsigned long long)request.Key());
+	return dir / name;
+}
+
+void ThumbnailSheet::TrimCache(uint64_t maxBytes)
+{
+	struct Entry
+	{
+		std::filesystem::path path;
+		std::filesystem::file_time_type mtime;
+		uint64_t size;
+	};
+	std::vector<Entry> entries;
+	uint64_t total = 0;
+
+	std::error_code ec;
+	std::filesystem::path dir = CacheDirectory();
+	if (dir.empty()) return;
+	for (auto it = std::filesystem::directory_iterator(dir, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+		if (it->path().extension() != ".sprite") continue;
+		Entry e = { it->path(), it->last_write_time(ec), it->file_size(ec) };
+		if (ec) continue;
+		total += e.size;
+		entries.push_back(e);
+	}
+	if (total <= maxBytes) return;
+
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.mtime < b.mtime; });
+	for (auto& e : entries) {
+		if (total <= maxBytes) break;
+		// a sheet still mapped by a player can't be deleted on Windows, it is retried next time
+		if (std::filesystem::remove(e.path, ec)) total -= e.size;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+// Sprite sheet of video thumbnails: one RGBA image with the tiles in rows of 'columns',
+// and the real position of each tile.
+//
+// The in-memory layout is also the cache file layout (header, times, pixels), so a
+// cached sheet is used in place from a read-only mapping, and saving is a single write.
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "media_file.h"
+
+struct ThumbnailRequest
+{
+	std::filesystem::path path;
+	std::vector<int64_t> timesMs;
+	uint32_t thumbWidth = 160;
+	uint32_t thumbHeight = 0; // 0: from the video aspect ratio
+	uint32_t columns = 10;
+
+	// Hash of the path and all the parameters, names the cache file
+	uint64_t Key() const;
+};
+
+class ThumbnailSheet
+{
+public:
+	static const uint32_t MAX_THUMBNAILS = 1000;
+	static const uint64_t MAX_PIXEL_BYTES = 64 * 1024 * 1024;
+
+	// New zero-filled sheet, or NULL if the size is out of the limits
+	static std::shared_ptr<ThumbnailSheet> Create(const MediaFileIdentity& identity,
+		uint32_t thumbWidth, uint32_t thumbHeight, uint32_t columns, uint32_t count);
+
+	// Maps a cache file, NULL if missing, corrupted, or made from another version of the video file
+	static std::shared_ptr<ThumbnailSheet> Load(const std::filesystem::path& cachePath, const MediaFileIdentity& identity);
+
+	// Writes to a temporary file and renames it, so readers never see a partial sheet
+	bool Save(const std::filesystem::path& cachePath) const;
+
+	// <temp>/video_player_win/thumbs/<key>.sprite
+	static std::filesystem::path CachePath(const ThumbnailRequest& request);
+
+	// Deletes the least recently written sheets until the cache is below 'maxBytes'
+	static void TrimCache(uint64_t maxBytes);
+
+	uint32_t ThumbWidth() const { return Header()->thumbWidth; }
+	uint32_t ThumbHeight() const { return Header()->thumbHeight; }
+	uint32_t Columns() const { return Header()->columns; }
+	uint32_t Rows() const { return Header()->rows; }
+	uint32_t Count() const { return Header()->count; }
+	uint32_t Width() const { return ThumbWidth() * Columns(); }
+	uint32_t Height() const { return ThumbHeight() * Rows(); }
+	uint32_t Stride() const { return Width() * 4; }
+
+	// Position of tile 'i' (a keyframe near the requested time), -1 if the tile is empty
+	int64_t TimeMs(uint32_t i) const { return Times()[i]; }
+	void SetTimeMs(uint32_t i, int64_t timeMs) { Times()[i] = timeMs; }
+
+	const uint8_t* Pixels() const { return m_pData + PixelOffset(Count()); }
+	size_t PixelSize() const { return (size_t)Stride() * Height(); }
+	// Writable tiles, only for a sheet made by Create()
+	uint8_t* Tile(uint32_t i) {
+		return m_memory.data() + PixelOffset(Count()) + (size_t)(i / Columns()) * ThumbHeight() * Stride() + (size_t)(i % Columns()) * ThumbWidth() * 4;
+	}
+	void CopyTile(uint32_t from, uint32_t to);
+
+private:
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t fileSize;
+		int64_t fileMtime;
+		uint32_t thumbWidth;
+		uint32_t thumbHeight;
+		uint32_t columns;
+		uint32_t rows;
+		uint32_t count;
+		uint32_t reserved;
+	};
+
+	static size_t PixelOffset(uint32_t count) { return (sizeof(FileHeader) + count * sizeof(int64_t) + 15) & ~(size_t)15; }
+
+	const FileHeader* Header() const { return (const FileHeader*)m_pData; }
+	const int64_t* Times() const { return (const int64_t*)(m_pData + sizeof(FileHeader)); }
+	int64_t* Times() { return (int64_t*)(m_memory.data() + sizeof(FileHeader)); }
+
+	const uint8_t* m_pData = NULL; // m_memory, or m_file when loaded from the cache
+	size_t m_size = 0;
+	std::vector<uint8_t> m_memory;
+	MappedFile m_file;
+};
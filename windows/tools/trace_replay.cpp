@@ -0,0 +1,338 @@
+// Replays a sample trace (see sample_trace.h) against the pacing logic of the DX11 renderer:
+// the samples arrive at their recorded times into the stream sink queue (CSampleQueueDepth),
+// the frame interval is estimated from their times when not given (CFrameIntervalEstimator),
+// and CSchedulerCore presents, holds or drops them against a presentation clock driven by the
+// recorded clock events. Reports the drops, the judder and the latency, so that a change of
+// policy can be compared on the same trace.
+//
+// Built by the tests of the cores (windows/test/CMakeLists.txt):
+//   cmake -S windows/test -B build && cmake --build build --target trace_replay
+//
+// Usage: trace_replay <trace> [--source grabber|renderer] [--fps N] [--present-us N]
+//   [--drop-threshold FRAMES] [--queue-min N] [--queue-max N]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "sample_trace.h"
+#include "FrameIntervalEstimator.h"
+#include "SampleQueueDepth.h"
+#include "SchedulerCore.h"
+
+using namespace DX11VideoRenderer;
+
+struct ReplayOptions
+{
+	int source = -1;            // SampleTraceSource, -1: the renderer if traced, else the grabber
+	double fps = 0;             // 0: from the sample durations, then estimated from the times
+	int64_t hnsPresentCost = 0; // the presenter is busy for that long per frame
+	float dropThresholdFrames = CSchedulerCore::DEFAULT_DROP_THRESHOLD_FRAMES;
+	uint32_t queueMin = CSampleQueueDepth::DEFAULT_MIN_DEPTH;
+	uint32_t queueMax = CSampleQueueDepth::DEFAULT_MAX_DEPTH;
+};
+
+// Presentation clock of the replay, on the system time of the trace (its arrival times)
+class ReplayClock : public SchedulerClock
+{
+public:
+	enum State { STOPPED, RUNNING, PAUSED };
+
+	int64_t hnsNow = 0; // system time of the replay
+
+	bool GetClockTime(int64_t* phnsTime) override
+	{
+		if (m_state == STOPPED) return false;
+		*phnsTime = Time();
+		return true;
+	}
+
+	int64_t Time() const
+	{
+		if (m_state != RUNNING) return m_hnsBase;
+		return m_hnsBase + (int64_t)((hnsNow - m_hnsSystemStart) * m_rate);
+	}
+
+	void Start(int64_t hnsOffset)
+	{
+		m_hnsBase = hnsOffset >= 0 ? hnsOffset : Time();
+		m_hnsSystemStart = hnsNow;
+		m_state = RUNNING;
+	}
+	void Stop() { m_state = STOPPED; m_hnsBase = 0; }
+	void Pause() { if (m_state == RUNNING) { m_hnsBase = Time(); m_state = PAUSED; } }
+	void Restart() { if (m_state == PAUSED) Start(m_hnsBase); }
+	void SetRate(double rate)
+	{
+		if (m_state == RUNNING) Start(Time());
+		m_rate = rate;
+	}
+
+	State GetState() const { return m_state; }
+	double Rate() const { return m_rate; }
+
+private:
+	State m_state = STOPPED;
+	int64_t m_hnsBase = 0;        // clock time at m_hnsSystemStart (or frozen)
+	int64_t m_hnsSystemStart = 0;
+	double m_rate = 1;
+};
+
+// One-shot timer of the replay: firing at the due time, as the timer wheel may (up to its slack)
+class ReplayWaiter : public SchedulerWaiter
+{
+public:
+	ReplayWaiter(ReplayClock& clock) : m_clock(clock) {}
+
+	int64_t hnsDue = -1; // -1 if not armed
+
+	bool WaitFor(int64_t hnsDelay, int64_t /*hnsSlack*/) override
+	{
+		hnsDue = m_clock.hnsNow + hnsDelay;
+		return true;
+	}
+	void CancelWait() override { hnsDue = -1; }
+
+private:
+	ReplayClock& m_clock;
+};
+
+struct QueuedSample
+{
+	int64_t hnsArrival;
+	int64_t hnsTime;
+};
+
+struct ReplayResult
+{
+	int64_t samples = 0;
+	int64_t flushed = 0;
+	std::vector<double> latencyMs;      // present - arrival
+	std::vector<double> judderMs;       // |present interval - sample interval / rate|
+	int64_t hnsLastPresent = -1;        // system time, -1 after a discontinuity
+	int64_t hnsLastPresentedTime = 0;   // of the sample
+	int64_t hnsPerFrame = 0;
+};
+
+static void Present(const QueuedSample& sample, ReplayClock& clock, const ReplayOptions& options, ReplayResult* pResult)
+{
+	clock.hnsNow += options.hnsPresentCost;
+	pResult->latencyMs.push_back((clock.hnsNow - sample.hnsArrival) / 10000.0);
+	if (pResult->hnsLastPresent >= 0 && clock.Rate() != 0) {
+		double expected = (sample.hnsTime - pResult->hnsLastPresentedTime) / fabs(clock.Rate());
+		pResult->judderMs.push_back(fabs((clock.hnsNow - pResult->hnsLastPresent) - expected) / 10000.0);
+	}
+	pResult->hnsLastPresent = clock.hnsNow;
+	pResult->hnsLastPresentedTime = sample.hnsTime;
+}
+
+// Decides on the queued samples from the head, as CScheduler::ProcessSamplesInQueue does
+static void ProcessQueue(std::deque<QueuedSample>& queue, CSchedulerCore& core, ReplayClock& clock,
+	const ReplayOptions& options, ReplayResult* pResult)
+{
+	while (!queue.empty() && clock.GetState() == ReplayClock::RUNNING) {
+		int64_t hnsWait = 0;
+		ScheduleAction action = core.Schedule(queue.front().hnsTime, &hnsWait);
+		if (action == SCHEDULE_WAIT) {
+			core.Wait(hnsWait);
+			return;
+		}
+		// (after a drop, the next interval spans the dropped frames: so does the one expected)
+		if (action == SCHEDULE_PRESENT) Present(queue.front(), clock, options, pResult);
+		int64_t hnsLag = 0;
+		(void)core.TakeLagChange(&hnsLag);
+		queue.pop_front();
+	}
+}
+
+static double Percentile(std::vector<double> values, double p)
+{
+	if (values.empty()) return 0;
+	std::sort(values.begin(), values.end());
+	return values[std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5))];
+}
+
+static double Mean(const std::vector<double>& values)
+{
+	double sum = 0;
+	for (double v : values) sum += v;
+	return values.empty() ? 0 : sum / values.size();
+}
+
+// "<name> mean, <p1>, <p2>, max", n/a without any value
+static void PrintDistribution(const char* name, const std::vector<double>& values, double p1, double p2, const char* note)
+{
+	if (values.empty()) {
+		printf("%-11s n/a%s\n", name, note);
+		return;
+	}
+	printf("%-11s mean %.3f ms, p%g %.3f ms, p%g %.3f ms, max %.3f ms%s\n", name, Mean(values),
+		p1 * 100, Percentile(values, p1), p2 * 100, Percentile(values, p2), Percentile(values, 1), note);
+}
+
+static bool ParseOptions(int argc, char** argv, std::string* pPath, ReplayOptions* pOptions)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+		if (arg.compare(0, 2, "--") != 0) {
+			*pPath = arg;
+			continue;
+		}
+		if (value == NULL) return false;
+		i++;
+		if (arg == "--source") {
+			if (strcmp(value, "grabber") == 0) pOptions->source = TRACE_SOURCE_GRABBER;
+			else if (strcmp(value, "renderer") == 0) pOptions->source = TRACE_SOURCE_RENDERER;
+			else return false;
+		}
+		else if (arg == "--fps") pOptions->fps = atof(value);
+		else if (arg == "--present-us") pOptions->hnsPresentCost = atoll(value) * 10;
+		else if (arg == "--drop-threshold") pOptions->dropThresholdFrames = (float)atof(value);
+		else if (arg == "--queue-min") pOptions->queueMin = (uint32_t)atoi(value);
+		else if (arg == "--queue-max") pOptions->queueMax = (uint32_t)atoi(value);
+		else return false;
+	}
+	return !pPath->empty();
+}
+
+int main(int argc, char** argv)
+{
+	std::string path;
+	ReplayOptions options;
+	if (!ParseOptions(argc, argv, &path, &options)) {
+		fprintf(stderr, "usage: trace_replay <trace> [--source grabber|renderer] [--fps N] [--present-us N]\n"
+			"  [--drop-threshold FRAMES] [--queue-min N] [--queue-max N]\n");
+		return 2;
+	}
+
+	std::vector<SampleTraceRecord> records;
+	if (!ReadSampleTrace(path, &records)) {
+		fprintf(stderr, "%s: not a sample trace (version %u)\n", path.c_str(), SampleTraceWriter::VERSION);
+		return 1;
+	}
+	if (options.source < 0) {
+		options.source = TRACE_SOURCE_GRABBER;
+		for (auto& record : records) {
+			if (record.source == TRACE_SOURCE_RENDERER) options.source = TRACE_SOURCE_RENDERER;
+		}
+	}
+
+	ReplayClock clock;
+	ReplayWaiter waiter(clock);
+	CSchedulerCore core(clock, waiter);
+	CSampleQueueDepth queueDepth;
+	CFrameIntervalEstimator frameInterval;
+	std::deque<QueuedSample> queue;
+	ReplayResult result;
+	bool hasClockEvents = false;
+
+	core.SetDropThreshold(options.dropThresholdFrames);
+	if (!queueDepth.SetBounds(options.queueMin, options.queueMax)) {
+		fprintf(stderr, "invalid queue bounds %u..%u\n", options.queueMin, options.queueMax);
+		return 2;
+	}
+	if (options.fps > 0) {
+		result.hnsPerFrame = (int64_t)(10000000 / options.fps);
+		core.SetFrameInterval(result.hnsPerFrame);
+	}
+	for (auto& record : records) {
+		if (record.source == options.source && record.event == TRACE_CLOCK_START) hasClockEvents = true;
+	}
+
+	for (auto& record : records) {
+		if (record.source != options.source) continue;
+		if (record.event == TRACE_SAMPLE && (record.flags & TRACE_FLAG_AUDIO)) continue;
+
+		// the timer fires before this record when due earlier; the presents run late when busy
+		while (waiter.hnsDue >= 0 && waiter.hnsDue <= record.hnsArrival) {
+			clock.hnsNow = std::max(clock.hnsNow, waiter.hnsDue);
+			waiter.hnsDue = -1;
+			ProcessQueue(queue, core, clock, options, &result);
+		}
+		clock.hnsNow = std::max(clock.hnsNow, record.hnsArrival);
+
+		switch (record.event) {
+		case TRACE_SAMPLE:
+			if (!hasClockEvents && clock.GetState() == ReplayClock::STOPPED) clock.Start(record.hnsTime);
+			result.samples++;
+			queueDepth.OnSampleArrived(record.hnsArrival, (uint32_t)queue.size(), result.hnsPerFrame);
+			if (options.fps <= 0) {
+				int64_t hnsPerFrame = 0;
+				if (!frameInterval.OnSampleTime(record.hnsTime, &hnsPerFrame) && result.hnsPerFrame == 0) {
+					hnsPerFrame = record.hnsDuration; // until estimated
+				}
+				if (hnsPerFrame > 0) {
+					result.hnsPerFrame = hnsPerFrame;
+					core.SetFrameInterval(hnsPerFrame);
+				}
+			}
+			queue.push_back({ record.hnsArrival, record.hnsTime });
+			break;
+		case TRACE_CLOCK_START:
+			clock.Start(record.hnsTime);
+			queueDepth.Restart();
+			break;
+		case TRACE_CLOCK_STOP:
+			clock.Stop();
+			// the stream sink flushes on stop
+			result.flushed += queue.size();
+			queue.clear();
+			core.CancelWait();
+			break;
+		case TRACE_CLOCK_PAUSE:
+			clock.Pause();
+			core.CancelWait();
+			break;
+		case TRACE_CLOCK_RESTART:
+			clock.Restart();
+			queueDepth.Restart();
+			break;
+		case TRACE_CLOCK_RATE:
+			if (clock.Rate() != record.hnsTime / 1000000.0) result.hnsLastPresent = -1;
+			clock.SetRate(record.hnsTime / 1000000.0);
+			core.SetRate((float)clock.Rate());
+			break;
+		case TRACE_FLUSH:
+			result.flushed += queue.size();
+			queue.clear();
+			core.CancelWait();
+			core.ResetLag();
+			queueDepth.Restart();
+			frameInterval.Restart();
+			result.hnsLastPresent = -1;
+			break;
+		}
+		// the presents before a discontinuity are not paired with the next ones
+		if (record.event != TRACE_SAMPLE && record.event != TRACE_CLOCK_RATE) result.hnsLastPresent = -1;
+
+		ProcessQueue(queue, core, clock, options, &result);
+	}
+	// the samples left are presented as the clock reaches them
+	while (waiter.hnsDue >= 0) {
+		clock.hnsNow = std::max(clock.hnsNow, waiter.hnsDue);
+		waiter.hnsDue = -1;
+		ProcessQueue(queue, core, clock, options, &result);
+	}
+
+	const SchedulerStats& stats = core.Stats();
+	SampleQueueStats queueStats = queueDepth.GetStats();
+	printf("trace       %s (%s), %lld video samples, %lld flushed\n", path.c_str(),
+		options.source == TRACE_SOURCE_RENDERER ? "renderer" : "grabber", (long long)result.samples, (long long)result.flushed);
+	printf("frame       %.3f ms%s\n", result.hnsPerFrame / 10000.0, options.fps > 0 ? " (given)" : " (estimated)");
+	printf("presented   %lld, late %lld, dropped %lld, left queued %zu\n",
+		(long long)stats.presented, (long long)stats.late, (long long)stats.dropped, queue.size());
+	printf("lateness    max %.3f ms, mean %.3f ms (late and dropped)\n", stats.hnsMaxLateness / 10000.0,
+		stats.late + stats.dropped > 0 ? stats.hnsTotalLateness / 10000.0 / (stats.late + stats.dropped) : 0.0);
+	PrintDistribution("judder", result.judderMs, 0.95, 0.99, result.judderMs.empty() ? " (no two presents in a row)" : "");
+	PrintDistribution("latency", result.latencyMs, 0.5, 0.99, " (arrival to present)");
+	printf("queue       depth %u (%u..%u), jitter %.3f ms, occupancy %.2f, empty %lld, full %lld, grows %lld, shrinks %lld\n",
+		queueStats.depth, queueStats.minDepth, queueStats.maxDepth, queueStats.hnsJitter / 10000.0, queueStats.averageOccupancy,
+		(long long)queueStats.emptyArrivals, (long long)queueStats.fullArrivals, (long long)queueStats.grows, (long long)queueStats.shrinks);
+	return 0;
+}
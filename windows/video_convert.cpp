@@ -0,0 +1,141 @@
+#include "video_convert.h"
+
+#include <vector>
+
+// ref: https://blog.csdn.net/u010842019/article/details/52086103
+// ref: https://zhuanlan.zhihu.com/p/397551265
+
+#define ALIGN16(v) (((v) + 15) & ~15)
+
+static inline uint8_t ByteClamp(int value)
+{
+	return value < 0 ? 0 : value > 255 ? 255 : (uint8_t)value;
+}
+
+static inline void WritePixel(uint8_t* pDst, int Y, int dy, int du, int dv)
+{
+	pDst[0] = ByteClamp(Y + dy);
+	pDst[1] = ByteClamp(Y + du);
+	pDst[2] = ByteClamp(Y + dv);
+	pDst[3] = 255;
+}
+
+bool GetNv12Frame(const uint8_t* sample, size_t sampleSize, uint32_t width, uint32_t height, Nv12Frame* pFrame)
+{
+	uint32_t strideW = ALIGN16(width);
+	uint32_t strideH = ALIGN16(height);
+	if ((size_t)strideW * strideH * 3 / 2 > sampleSize) {
+		strideH = height; //workaround, why sometimes height is no need to align ?
+	}
+	if ((size_t)strideW * strideH + (size_t)strideW * ((height + 1) / 2) > sampleSize) return false;
+
+	pFrame->y = sample;
+	pFrame->uv = sample + (size_t)strideW * strideH;
+	pFrame->width = width;
+	pFrame->height = height;
+	pFrame->stride = strideW;
+	return true;
+}
+
+void ConvertNv12ToRgba(const Nv12Frame& src, uint8_t* dst, uint32_t dstStride)
+{
+	for (uint32_t y = 0; y < src.height; y += 2) {
+		const uint8_t* pY = src.y + (size_t)y * src.stride;
+		const uint8_t* pY2 = pY + src.stride;
+		const uint8_t* pUV = src.uv + (size_t)(y / 2) * src.stride;
+		uint8_t* pDst = dst + (size_t)y * dstStride;
+		uint8_t* pDst2 = pDst + dstStride;
+		bool hasRow2 = y + 1 < src.height;
+
+		for (uint32_t x = 0; x < src.width; x += 2) {
+			int U = (int)pUV[x] - 128;
+			int V = (int)pUV[x + 1] - 128;
+
+			int dy = (1435 * V) >> 10;
+			int du = (-352 * U - 731 * V) >> 10;
+			int dv = (1814 * U) >> 10;
+
+			bool hasCol2 = x + 1 < src.width;
+			WritePixel(pDst + x * 4, pY[x], dy, du, dv);
+			if (hasCol2) WritePixel(pDst + x * 4 + 4, pY[x + 1], dy, du, dv);
+			if (hasRow2) {
+				WritePixel(pDst2 + x * 4, pY2[x], dy, du, dv);
+				if (hasCol2) WritePixel(pDst2 + x * 4 + 4, pY2[x + 1], dy, du, dv);
+			}
+		}
+	}
+}
+
+// Source span [begin, end) of each destination pixel, with a sampling step
+// so a very large downscale reads at most MAX_TAPS source pixels per axis.
+struct ScaleSpan
+{
+	uint32_t begin;
+	uint32_t end;
+	uint32_t step;
+	uint32_t count;
+};
+
+static const uint32_t MAX_TAPS = 8;
+
+static void BuildSpans(uint32_t srcSize, uint32_t dstSize, std::vector<ScaleSpan>* pSpans)
+{
+	pSpans->resize(dstSize);
+	for (uint32_t i = 0; i < dstSize; i++) {
+		ScaleSpan& s = (*pSpans)[i];
+		s.begin = (uint32_t)((uint64_t)i * srcSize / dstSize);
+		s.end = (uint32_t)((uint64_t)(i + 1) * srcSize / dstSize);
+		if (s.end <= s.begin) s.end = s.begin + 1;
+		if (s.end > srcSize) s.end = srcSize;
+		uint32_t len = s.end - s.begin;
+		s.step = (len + MAX_TAPS - 1) / MAX_TAPS;
+		s.count = (len + s.step - 1) / s.step;
+	}
+}
+
+void ConvertScaleNv12ToRgba(const Nv12Frame& src, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t dstStride)
+{
+	if (src.width < 2 || src.height < 2 || dstWidth == 0 || dstHeight == 0) return;
+
+	std::vector<ScaleSpan> xSpans, ySpans;
+	BuildSpans(src.width, dstWidth, &xSpans);
+	BuildSpans(src.height, dstHeight, &ySpans);
+
+	for (uint32_t dy = 0; dy < dstHeight; dy++) {
+		const ScaleSpan& ys = ySpans[dy];
+		// chroma row at the center of the span
+		const uint8_t* pUV = src.uv + (size_t)(((ys.begin + ys.end) / 2) / 2) * src.stride;
+		uint8_t* pDst = dst + (size_t)dy * dstStride;
+
+		for (uint32_t dx = 0; dx < dstWidth; dx++) {
+			const ScaleSpan& xs = xSpans[dx];
+
+			uint32_t sum = 0;
+			for (uint32_t y = ys.begin; y < ys.end; y += ys.step) {
+				const uint8_t* pY = src.y + (size_t)y * src.stride;
+				for (uint32_t x = xs.begin; x < xs.end; x += xs.step) sum += pY[x];
+			}
+			int Y = (int)(sum / (ys.count * xs.count));
+
+			uint32_t cx = (((xs.begin + xs.end) / 2) / 2) * 2;
+			int U = (int)pUV[cx] - 128;
+			int V = (int)pUV[cx + 1] - 128;
+
+			WritePixel(pDst + dx * 4, Y, (1435 * V) >> 10, (-352 * U - 731 * V) >> 10, (1814 * U) >> 10);
+		}
+	}
+}
+
+void ConvertBgraToRgba(const uint8_t* src, uint32_t srcStride, uint32_t width, uint32_t height, uint8_t* dst, uint32_t dstStride)
+{
+	for (uint32_t y = 0; y < height; y++) {
+		const uint8_t* pSrc = src + (size_t)y * srcStride;
+		uint8_t* pDst = dst + (size_t)y * dstStride;
+		for (uint32_t x = 0; x < width; x++, pSrc += 4, pDst += 4) {
+			pDst[0] = pSrc[2];
+			pDst[1] = pSrc[1];
+			pDst[2] = pSrc[0];
+			pDst[3] = 255;
+		}
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+// NV12 -> RGBA conversion used by the texture output and the thumbnail extractor.
+// Plain C++, no Media Foundation dependency.
+
+#include <cstddef>
+#include <cstdint>
+
+struct Nv12Frame
+{
+	const uint8_t* y = NULL;  // luma plane
+	const uint8_t* uv = NULL; // interleaved chroma plane, half height
+	uint32_t width = 0;       // visible size
+	uint32_t height = 0;
+	uint32_t stride = 0;      // bytes per row, both planes
+};
+
+// Locates the planes of a sample delivered by the sample grabber. Decoders pad the
+// planes to 16 pixels, but the height is sometimes not padded: the sample size tells.
+bool GetNv12Frame(const uint8_t* sample, size_t sampleSize, uint32_t width, uint32_t height, Nv12Frame* pFrame);
+
+// Full size conversion, 'dst' must hold width x height pixels (alpha is set to 255)
+void ConvertNv12ToRgba(const Nv12Frame& src, uint8_t* dst, uint32_t dstStride);
+
+// Conversion and downscale in one pass: each destination pixel is the average of
+// its source area, so small thumbnails are not aliased and the full size RGBA frame
+// is never written.
+void ConvertScaleNv12ToRgba(const Nv12Frame& src, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t dstStride);
+
+// Swaps B and R of a frame presented by the DX11 renderer (BGRA), alpha made opaque
+void ConvertBgraToRgba(const uint8_t* src, uint32_t srcStride, uint32_t width, uint32_t height, uint8_t* dst, uint32_t dstStride);
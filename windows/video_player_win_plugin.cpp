@@ -10,10 +10,24 @@
 #include <flutter/plugin_registrar_windows.h>
 #include <flutter/standard_method_codec.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <set>
 #include <sstream>
+#include <thread>
 
 #include "my_grabber_player.h"
+#include "media_probe.h"
+#include "video_convert.h"
+#include "thumbnail_extractor.h"
+#include "loop_frame_cache.h"
+#include "frame_fanout.h"
+#include "mosaic_canvas.h"
+#include "frame_budget.h"
+#include "gop_frame_cache.h"
+#include "gop_decoder.h"
+#include "worker_pool.h"
 #include <mfapi.h>
 #include <Shlwapi.h>
 #include <stdio.h>
@@ -22,12 +36,31 @@
 
 #include <chrono>
 flutter::MethodChannel<flutter::EncodableValue>* gMethodChannel = NULL;
+HWND gRendererWindow = NULL; // the Flutter view, which the DX11 renderer of "renderer": "dx11" players is attached to
 
 inline uint64_t getCurrentTime() {
     using namespace std::chrono;
     return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
 }
 
+inline int64_t getSteadyTimeUs() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// "thinningSpeed" of setPlaybackSpeed: from that speed on, keyframes only (0: never)
+inline float getThinningSpeed(const flutter::EncodableMap& arguments) {
+  auto iter = arguments.find(flutter::EncodableValue("thinningSpeed"));
+  if (iter == arguments.end() || !std::holds_alternative<double>(iter->second)) return 0;
+  return (float)std::get<double>(iter->second);
+}
+
+inline SeekMode getSeekMode(const flutter::EncodableMap& arguments) {
+  auto iter = arguments.find(flutter::EncodableValue("mode"));
+  if (iter == arguments.end() || !std::holds_alternative<int32_t>(iter->second)) return SEEK_MODE_ACCURATE;
+  return (SeekMode)std::get<int32_t>(iter->second);
+}
+
 flutter::TextureRegistrar* texture_registar_ = NULL;
 
 class MyPlayerInternal : public MyPlayer, public MyPlayerCallback {
@@ -35,8 +68,468 @@ public:
   int64_t textureId = -1;
   FlutterDesktopPixelBuffer pixel_buffer;
 
+  // Shared decode: more textures ("views") showing this player, see "shareDecode" in openVideo. Each
+  // texture has its own output size, and the player lives until the last of them is disposed.
+  struct TextureView {
+    int outputId = -1;
+    FlutterDesktopPixelBuffer pixel_buffer;
+  };
+  std::string shareKey; // empty if not shared, guarded by mapMutex
+  std::atomic<int> shareCount{1}; // textures showing the player
+  std::atomic<bool> isPrimaryDetached{false}; // 'textureId' is disposed, views are left
+  const std::shared_ptr<FrameFanout> fanout = std::make_shared<FrameFanout>();
+  std::atomic<int> primaryOutputId{-1}; // 'textureId' has an output size
+  FlutterDesktopPixelBuffer primaryOutputBuffer;
+  std::mutex viewMutex;
+  std::map<int64_t, std::shared_ptr<TextureView>> views; // textureId -> view
+
+  static const FlutterDesktopPixelBuffer* getOutputPixelBuffer(FrameFanout& outputs, int outputId, FlutterDesktopPixelBuffer* pBuffer) {
+    const uint8_t* pixels = NULL;
+    uint32_t width = 0, height = 0;
+    if (!outputs.GetOutput(outputId, &pixels, &width, &height)) return nullptr;
+    pBuffer->buffer = pixels;
+    pBuffer->width = width;
+    pBuffer->height = height;
+    return pBuffer;
+  }
+
+  const FlutterDesktopPixelBuffer* getPixelBuffer() {
+    int outputId = primaryOutputId;
+    if (outputId < 0) return pixel_buffer.buffer != NULL ? &pixel_buffer : nullptr;
+    return getOutputPixelBuffer(*fanout, outputId, &primaryOutputBuffer);
+  }
+
+  // Registers a texture more on this player, of 'width' x 'height' (see FrameFanout::AddOutput)
+  int64_t addView(uint32_t width, uint32_t height) {
+    auto view = std::make_shared<TextureView>();
+    memset(&view->pixel_buffer, 0, sizeof(view->pixel_buffer));
+    view->outputId = fanout->AddOutput(width, height);
+    auto outputs = fanout;
+    flutter::TextureVariant* texture = new flutter::TextureVariant(flutter::PixelBufferTexture(
+      [view, outputs](size_t, size_t) -> const FlutterDesktopPixelBuffer* {
+        return getOutputPixelBuffer(*outputs, view->outputId, &view->pixel_buffer);
+      }));
+    int64_t viewTextureId = texture_registar_->RegisterTexture(texture);
+    {
+      std::lock_guard<std::mutex> lock(viewMutex);
+      views[viewTextureId] = view;
+    }
+    shareCount++;
+    return viewTextureId;
+  }
+
+  void removeView(int64_t viewTextureId) {
+    std::shared_ptr<TextureView> view;
+    {
+      std::lock_guard<std::mutex> lock(viewMutex);
+      auto it = views.find(viewTextureId);
+      if (it == views.end()) return;
+      view = it->second;
+      views.erase(it);
+    }
+    texture_registar_->UnregisterTexture(viewTextureId);
+    fanout->RemoveOutput(view->outputId);
+    shareCount--;
+  }
+
+  // The texture of the player itself is disposed while views still show it
+  void detachPrimary() {
+    isPrimaryDetached = true;
+    texture_registar_->UnregisterTexture(textureId);
+    shareCount--;
+  }
+
+  std::vector<int64_t> textureIds() {
+    std::vector<int64_t> ids;
+    if (textureId != -1 && !isPrimaryDetached) ids.push_back(textureId);
+    std::lock_guard<std::mutex> lock(viewMutex);
+    for (auto& view : views) ids.push_back(view.first);
+    return ids;
+  }
+
+  void markFrameAvailable() {
+    if (texture_registar_ == NULL) return;
+    for (int64_t id : textureIds()) texture_registar_->MarkTextureFrameAvailable(id);
+  }
+
+  bool isPlaying() {
+    if (isStepMode) return isReversePlaying;
+    return isCacheMode ? isCachePlaying() : mPlaybackState == START;
+  }
+
+  // Mosaic mode: frames are drawn into a tile of a shared canvas instead of the textures of the player.
+  // NULL 'canvas' goes back to the textures.
+  void setMosaicTile(std::shared_ptr<MosaicCanvas> canvas, int tile) {
+    if (isCacheMode) leaveCacheMode(cachePositionMs, isCachePlaying());
+    // the cached frames would miss the ones drawn into the tile
+    auto cache = getLoopCache();
+    if (cache != NULL) cache->Reset();
+    isLoopRecordArmed = false;
+
+    std::shared_ptr<MosaicCanvas> previousCanvas;
+    int previousTile;
+    {
+      std::lock_guard<std::mutex> lock(mosaicMutex);
+      previousCanvas = mosaicCanvas;
+      previousTile = mosaicTile;
+      mosaicCanvas = canvas;
+      mosaicTile = tile;
+    }
+    if (previousCanvas != NULL && (previousCanvas != canvas || previousTile != tile)) previousCanvas->ClearTile(previousTile);
+  }
+
+  // Back to the textures, 'clearTile' draws the tile black
+  void leaveMosaic(bool clearTile) {
+    std::lock_guard<std::mutex> lock(mosaicMutex);
+    if (mosaicCanvas != NULL && clearTile) mosaicCanvas->ClearTile(mosaicTile);
+    mosaicCanvas.reset();
+    mosaicTile = -1;
+  }
+
+  std::shared_ptr<MosaicCanvas> getMosaicTile(int* pTile) {
+    std::lock_guard<std::mutex> lock(mosaicMutex);
+    *pTile = mosaicTile;
+    return mosaicCanvas;
+  }
+
+  // Commands received while the media source is still loading (openVideo() may return early
+  // with cached metadata), applied once the session is ready.
+  std::mutex pendingMutex;
+  bool isLoading = true;
+  int64_t cachedDurationMs = -1; // the duration replied by openVideo() while loading
+  bool pendingPlay = false;
+  LONGLONG pendingSeekMs = -1;
+  SeekMode pendingSeekMode = SEEK_MODE_ACCURATE;
+  float pendingVolume = -1;
+  float pendingSpeed = -1;
+  float pendingThinningSpeed = 0;
+  std::vector<std::function<void(bool)>> loadWaiters; // replies of the views attached while loading
+
+  std::vector<std::function<void(bool)>> takeLoadWaiters() {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    std::vector<std::function<void(bool)>> waiters;
+    waiters.swap(loadWaiters);
+    return waiters;
+  }
+
+  void applyPendingCommands() {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    isLoading = false;
+    if (pendingVolume >= 0) SetVolume(pendingVolume);
+    if (pendingSpeed > 0) {
+      SetPlaybackSpeed(pendingSpeed, pendingThinningSpeed);
+      playbackSpeed = pendingSpeed;
+    }
+    if (pendingSeekMs >= 0) {
+      onUserSeek(pendingSeekMs);
+      Seek(pendingSeekMs, pendingSeekMode);
+      if (!pendingPlay) Pause();
+    } else if (pendingPlay) {
+      Play();
+    }
+  }
+
+  // Native loop: the clip restarts without a round trip to Dart, and a short clip is
+  // replayed from its cached frames (no seek, no decode) when no audio would be heard.
+  std::atomic<bool> isLooping{false};
+  std::atomic<bool> isCacheMode{false}; // the session is ended, frames come from loopCache
+  std::atomic<LONGLONG> cachePositionMs{0};
+  std::atomic<float> playbackSpeed{1.0f};
+
+  void setLooping(bool looping, size_t cacheBytes, bool isCompressed) {
+    isLooping = looping;
+    {
+      std::lock_guard<std::mutex> lock(loopMutex);
+      if (!looping || cacheBytes == 0) {
+        loopCache.reset();
+      } else if (loopCache == NULL) {
+        loopCache = std::make_shared<LoopFrameCache>(cacheBytes, isCompressed);
+      }
+    }
+    if (!looping && isCacheMode) leaveCacheMode(cachePositionMs, isCachePlaying());
+  }
+
+  bool isCachePlaying() {
+    std::lock_guard<std::mutex> lock(cacheControlMutex);
+    return cacheThread.joinable();
+  }
+
+  // Leaves the cached frames for the session, at the position shown
+  void leaveCacheMode(LONGLONG ms, bool play) {
+    stopCachePlayback();
+    isCacheMode = false;
+    Seek(ms);
+    if (!play) Pause();
+  }
+
+  // A seek from Dart: an incomplete pass can't be looped from the cache anymore
+  void onUserSeek(LONGLONG ms) {
+    isLoopRecordArmed = ms == 0;
+    auto cache = getLoopCache();
+    if (cache != NULL) cache->CancelRecording();
+  }
+
+  // called from the platform thread and the session event thread
+  void startCachePlayback(LONGLONG fromMs) {
+    std::lock_guard<std::mutex> lock(cacheControlMutex);
+    stopCachePlaybackLocked();
+    isCacheThreadStopping = false;
+    isCacheMode = true;
+    cachePositionMs = fromMs;
+    cacheThread = std::thread([this, fromMs]() { runCachePlayback(fromMs); });
+  }
+
+  void stopCachePlayback() {
+    std::lock_guard<std::mutex> lock(cacheControlMutex);
+    stopCachePlaybackLocked();
+  }
+
+  // Frame stepping and reverse playback: the session is paused and the frames shown come from a
+  // cache of decoded GOPs, filled by playback and, for a local file, by a background decoder.
+  static const size_t DEFAULT_STEP_CACHE_BYTES = 256 * 1024 * 1024;
+  struct FrameStepper {
+    std::shared_ptr<GopFrameCache> cache;
+    std::shared_ptr<GopDecoder> decoder; // NULL if not a local file
+    std::shared_ptr<const Mp4KeyframeIndex> index; // NULL: GOPs of GopFrameCache::CHUNK_HNS
+
+    void gopAt(int64_t hns, int64_t* pStart, int64_t* pEnd) {
+      static const std::vector<int64_t> noKeyframes;
+      GetGopBounds(index != NULL ? index->hnsKeyframes : noKeyframes, hns, pStart, pEnd);
+    }
+  };
+  std::atomic<bool> isStepMode{false};
+  std::atomic<int64_t> stepPositionHns{0};
+  std::atomic<bool> isReversePlaying{false};
+
+  void setSourcePath(const std::wstring& path) {
+    std::lock_guard<std::mutex> lock(stepMutex);
+    sourcePath = path;
+  }
+
+  // 0 disables stepping; otherwise playback is recorded into the cache from now on
+  void setFrameStepCache(size_t maxBytes) {
+    stopReverse();
+    std::shared_ptr<FrameStepper> stepper;
+    {
+      std::lock_guard<std::mutex> lock(stepMutex);
+      stepCacheBytes = maxBytes;
+      isStepRecordArmed = maxBytes > 0;
+      if (maxBytes == 0) stepper.swap(frameStepper);
+      else if (frameStepper != NULL) frameStepper->cache->SetMaxBytes(maxBytes);
+    }
+    if (stepper != NULL && stepper->decoder != NULL) stepper->decoder->Shutdown();
+  }
+
+  // Shows the next / previous frame, pausing the session. 'reply' gets the position shown,
+  // -1 if there is none (start / end reached, stepping disabled); on a cache miss it is called
+  // on a worker thread once the GOP is decoded.
+  void stepFrame(bool isForward, std::function<void(int64_t ms)> reply) {
+    stopReverse();
+    auto stepper = getStepper(true);
+    if (stepper == NULL || textureId == -1) {
+      reply(-1);
+      return;
+    }
+    enterStepMode();
+    int64_t hns = stepPositionHns;
+    CachedFramePtr frame = isForward ? stepper->cache->Next(hns) : stepper->cache->Previous(hns);
+    if (frame != NULL) {
+      reply(showStepFrame(*stepper, frame, isForward) ? frame->hnsTime / 10000 : -1);
+      return;
+    }
+
+    // not cached: its GOP is decoded, then the step is tried again
+    int64_t start, end;
+    stepper->gopAt(isForward ? hns : hns - 1, &start, &end);
+    if (isForward && stepper->cache->HasGop(start)) {
+      if (end == INT64_MAX) {
+        reply(-1);
+        return;
+      }
+      stepper->gopAt(end, &start, &end);
+    }
+    if (stepper->decoder == NULL || (!isForward && hns <= 0)) {
+      reply(-1);
+      return;
+    }
+    // (the stepper is not captured: the decoder must not be released by its own callback)
+    stepper->decoder->Request(start, end, [this, isForward, reply]() {
+      auto stepper = getStepper(false);
+      int64_t hns = stepPositionHns;
+      CachedFramePtr frame = NULL;
+      if (stepper != NULL && isStepMode) frame = isForward ? stepper->cache->Next(hns) : stepper->cache->Previous(hns);
+      reply(frame != NULL && showStepFrame(*stepper, frame, isForward) ? frame->hnsTime / 10000 : -1);
+    });
+  }
+
+  // Plays backwards from the frame shown, at the frame pace divided by 'speed', until paused
+  // or the start is reached. False if stepping is disabled.
+  bool playReverse(float speed) {
+    stopReverse();
+    auto stepper = getStepper(true);
+    if (stepper == NULL || textureId == -1 || speed <= 0) return false;
+    enterStepMode();
+    {
+      std::lock_guard<std::mutex> lock(reverseControlMutex);
+      isReverseStopping = false;
+      isReversePlaying = true;
+      reverseThread = std::thread([this, speed]() { runReverse(speed); });
+    }
+    notifyPlaybackState(3); // START
+    return true;
+  }
+
+  void stopReverse() {
+    std::lock_guard<std::mutex> lock(reverseControlMutex);
+    if (!reverseThread.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock2(reverseMutex);
+      isReverseStopping = true;
+    }
+    reverseCv.notify_all();
+    reverseThread.join();
+    isReversePlaying = false;
+  }
+
+  // Back to the session at the frame shown
+  void leaveStepMode(bool play) {
+    stopReverse();
+    isStepMode = false;
+    Seek(stepPositionHns / 10000 + 1); // (after the previous frame: it is skipped)
+    if (!play) Pause();
+  }
+
+  // Stops stepping and the background decodes, before the player is reset or destroyed
+  void dropFrameStepper() {
+    stopReverse();
+    isStepMode = false;
+    std::shared_ptr<FrameStepper> stepper;
+    {
+      std::lock_guard<std::mutex> lock(stepMutex);
+      stepper.swap(frameStepper);
+    }
+    if (stepper != NULL && stepper->decoder != NULL) stepper->decoder->Shutdown();
+  }
+
+  bool getFrameStepStats(GopFrameCacheStats* pStats) {
+    auto stepper = getStepper(false);
+    if (stepper == NULL) return false;
+    *pStats = stepper->cache->GetStats();
+    return true;
+  }
+
+  bool isAudible() {
+    float volume = 0;
+    return GetMetadata().audioStreams > 0 && SUCCEEDED(GetVolume(&volume)) && volume > 0;
+  }
+
+  void OnPlaylistItemChanged(int index) override {
+    for (int64_t id : textureIds()) {
+      flutter::EncodableMap arguments;
+      arguments[flutter::EncodableValue("textureId")] = flutter::EncodableValue(id);
+      arguments[flutter::EncodableValue("index")] = flutter::EncodableValue(index);
+      gMethodChannel->InvokeMethod("OnPlaylistItem", std::make_unique<flutter::EncodableValue>(arguments));
+    }
+  }
+
+  // Buffered ranges of a network source, at most every BUFFERED_NOTIFY_US
+  static const int64_t BUFFERED_NOTIFY_US = 250000;
+  std::atomic<int64_t> lastBufferedNotifyUs{0};
+
+  void OnBufferedRangesChanged() override {
+    std::vector<std::pair<LONGLONG, LONGLONG>> ranges;
+    if (!GetBufferedRanges(&ranges)) return;
+    // the last change (all buffered) is never dropped
+    bool isComplete = ranges.size() == 1 && ranges[0].first == 0 && ranges[0].second >= GetDuration();
+    int64_t nowUs = getSteadyTimeUs();
+    int64_t lastUs = lastBufferedNotifyUs;
+    if (!isComplete && (nowUs - lastUs < BUFFERED_NOTIFY_US || !lastBufferedNotifyUs.compare_exchange_strong(lastUs, nowUs))) return;
+
+    flutter::EncodableList list;
+    for (auto& range : ranges) {
+      list.push_back(flutter::EncodableValue((int64_t)range.first));
+      list.push_back(flutter::EncodableValue((int64_t)range.second));
+    }
+    for (int64_t id : textureIds()) {
+      flutter::EncodableMap arguments;
+      arguments[flutter::EncodableValue("textureId")] = flutter::EncodableValue(id);
+      arguments[flutter::EncodableValue("ranges")] = flutter::EncodableValue(list);
+      gMethodChannel->InvokeMethod("OnBufferedRanges", std::make_unique<flutter::EncodableValue>(arguments));
+    }
+  }
+
+  void notifyPlaybackState(int state) {
+    for (int64_t id : textureIds()) {
+      flutter::EncodableMap arguments;
+      arguments[flutter::EncodableValue("textureId")] = flutter::EncodableValue(id);
+      arguments[flutter::EncodableValue("state")] = flutter::EncodableValue(state);
+      gMethodChannel->InvokeMethod("OnPlaybackEvent", std::make_unique<flutter::EncodableValue>(arguments));
+    }
+  }
+
+  // client of the frame budget shared by all the players, see "setPriority"
+  const int budgetId = FrameBudget::Shared().Register();
+
+  // open-to-first-frame latency, for the player pool
+  uint64_t openStartTime = 0;
+  std::atomic<int64_t> firstFrameMs{-1};
+  bool isPooled = false; // taken from the pool by the last openVideo
+
+  // Back to a fresh player, to be kept in the pool.
+  // Returns false if it can't be reused (yet), it is then destroyed.
+  bool reset() {
+    stopCachePlayback();
+    dropFrameStepper();
+    if (!Reset()) return false;
+    {
+      std::lock_guard<std::mutex> lock(pendingMutex);
+      isLoading = true;
+      cachedDurationMs = -1;
+      pendingPlay = false;
+      pendingSeekMs = -1;
+      pendingSeekMode = SEEK_MODE_ACCURATE;
+      pendingVolume = -1;
+      pendingSpeed = -1;
+      pendingThinningSpeed = 0;
+    }
+    isLooping = false;
+    isCacheMode = false;
+    cachePositionMs = 0;
+    playbackSpeed = 1.0f;
+    {
+      std::lock_guard<std::mutex> lock(loopMutex);
+      loopCache.reset();
+    }
+    isLoopRecordArmed = true;
+    {
+      std::lock_guard<std::mutex> lock(stepMutex);
+      sourcePath.clear();
+      stepCacheBytes = DEFAULT_STEP_CACHE_BYTES;
+      isStepRecordArmed = false;
+    }
+    lastSampleHns = -1;
+    FrameBudget::Shared().Reset(budgetId);
+    mPlaybackState = IDLE;
+    m_lastSampleSize = 0; // the buffer is reallocated on the next frame
+    m_formatSampleSize = 0;
+    pixel_buffer.buffer = NULL; // no stale frame from the previous video
+    pixel_buffer.width = pixel_buffer.height = 0;
+    leaveMosaic(true);
+    fanout->ClearFullFrame();
+    if (primaryOutputId >= 0) fanout->RemoveOutput(primaryOutputId);
+    primaryOutputId = -1;
+    shareCount = 1;
+    openStartTime = 0;
+    firstFrameMs = -1;
+    return true;
+  }
+
   MyPlayerInternal() {}
   ~MyPlayerInternal() {
+    FrameBudget::Shared().Unregister(budgetId);
+    stopCachePlayback();
+    dropFrameStepper();
+    fanout->ClearFullFrame();
     if (m_pBuffer != NULL) delete m_pBuffer;
     m_pBuffer = NULL;
     textureId = -1;
@@ -53,14 +546,273 @@ public:
 	}
 
 private:
-  uint64_t lastFrameTime = 0;
+  std::mutex mosaicMutex;
+  std::shared_ptr<MosaicCanvas> mosaicCanvas;
+  int mosaicTile = -1;
+
+  std::mutex loopMutex;
+  std::shared_ptr<LoopFrameCache> loopCache; // NULL when the frame cache is disabled
+  std::atomic<bool> isLoopRecordArmed{true}; // the next sample is the first frame of the clip
+  std::mutex cacheControlMutex; // guards cacheThread
+  std::thread cacheThread;
+  std::mutex cacheMutex;
+  std::condition_variable cacheCv;
+  bool isCacheThreadStopping = false;
+
+  void stopCachePlaybackLocked() {
+    if (!cacheThread.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(cacheMutex);
+      isCacheThreadStopping = true;
+    }
+    cacheCv.notify_all();
+    cacheThread.join();
+  }
+
+  std::shared_ptr<LoopFrameCache> getLoopCache() {
+    std::lock_guard<std::mutex> lock(loopMutex);
+    return loopCache;
+  }
+
+  std::mutex stepMutex;
+  std::wstring sourcePath; // local file opened (not a URL nor a playlist)
+  std::shared_ptr<FrameStepper> frameStepper; // NULL until stepping or recording starts
+  size_t stepCacheBytes = DEFAULT_STEP_CACHE_BYTES;
+  bool isStepRecordArmed = false; // "setFrameStepCache": the next sample creates the stepper
+  std::atomic<int64_t> lastSampleHns{-1}; // of the last sample delivered
+  int64_t lastSampleEndHns = -1; // sample thread only
+  std::mutex stepShowMutex; // serializes the frames shown in step mode
+  std::mutex reverseControlMutex; // guards reverseThread
+  std::thread reverseThread;
+  std::mutex reverseMutex;
+  std::condition_variable reverseCv;
+  bool isReverseStopping = false;
+  int64_t reverseDecodes = 0; // GOP decodes the reverse thread waited for
+
+  // Created with 'isCreated' unless stepping is disabled
+  std::shared_ptr<FrameStepper> getStepper(bool isCreated) {
+    std::lock_guard<std::mutex> lock(stepMutex);
+    if (frameStepper == NULL && isCreated && stepCacheBytes > 0) {
+      auto stepper = std::make_shared<FrameStepper>();
+      stepper->cache = std::make_shared<GopFrameCache>(stepCacheBytes);
+      stepper->index = GetKeyframeIndex();
+      if (!sourcePath.empty()) stepper->decoder = std::make_shared<GopDecoder>(sourcePath, stepper->cache, stepCacheBytes / 2);
+      frameStepper = stepper;
+    }
+    return frameStepper;
+  }
+
+  // The session is paused at the frame shown
+  void enterStepMode() {
+    if (isStepMode) return;
+    if (isCacheMode) {
+      stopCachePlayback();
+      isCacheMode = false;
+      stepPositionHns = cachePositionMs * 10000;
+    } else {
+      int64_t hns = lastSampleHns;
+      stepPositionHns = hns >= 0 ? hns : GetCurrentPosition() * 10000;
+    }
+    isStepMode = true;
+    Pause();
+  }
+
+  // Converted into the textures (or the mosaic tile) like a sample of the session
+  bool showCachedFrame(const CachedFrame& cached) {
+    Nv12Frame frame = cached.View();
+    int tile = -1;
+    auto canvas = getMosaicTile(&tile);
+    if (canvas != NULL) {
+      canvas->DrawTile((uint32_t)tile, frame);
+      return true;
+    }
+    if (m_pBuffer == NULL || cached.width != m_VideoWidth || cached.height != m_VideoHeight) return false;
+    pixel_buffer.width = m_VideoWidth;
+    pixel_buffer.height = m_VideoHeight;
+    ConvertNv12ToRgba(frame, m_pBuffer, m_VideoWidth * 4);
+    if (fanout->OutputCount() > 0) fanout->Process(frame, m_pBuffer);
+    markFrameAvailable();
+    return true;
+  }
+
+  // Shows a step, and has the GOP the next steps go into decoded meanwhile
+  bool showStepFrame(FrameStepper& stepper, const CachedFramePtr& frame, bool isForward) {
+    {
+      std::lock_guard<std::mutex> lock(stepShowMutex);
+      if (!showCachedFrame(*frame)) return false;
+      stepPositionHns = frame->hnsTime;
+    }
+    stepper.cache->SetPlayHead(frame->hnsTime);
+    if (stepper.decoder == NULL) return true;
+    int64_t start, end, nextStart, nextEnd;
+    stepper.gopAt(frame->hnsTime, &start, &end);
+    if (isForward ? end == INT64_MAX : start <= 0) return true;
+    stepper.gopAt(isForward ? end : start - 1, &nextStart, &nextEnd);
+    if (nextStart != start && !stepper.cache->HasGop(nextStart)) stepper.decoder->Request(nextStart, nextEnd, NULL);
+    return true;
+  }
+
+  void runReverse(float speed) {
+    using namespace std::chrono;
+    auto due = steady_clock::now();
+    for (;;) {
+      auto stepper = getStepper(false);
+      if (stepper == NULL || textureId == -1) break;
+      int64_t hns = stepPositionHns;
+      CachedFramePtr frame = stepper->cache->Previous(hns);
+      if (frame == NULL) {
+        // not cached (yet): wait for its GOP
+        if (stepper->decoder == NULL || hns <= 0) break;
+        int64_t start, end;
+        stepper->gopAt(hns - 1, &start, &end);
+        int64_t decodes = 0;
+        {
+          std::lock_guard<std::mutex> lock(reverseMutex);
+          decodes = reverseDecodes;
+        }
+        stepper->decoder->Request(start, end, [this]() {
+          std::lock_guard<std::mutex> lock(reverseMutex);
+          reverseDecodes++;
+          reverseCv.notify_all();
+        });
+        {
+          std::unique_lock<std::mutex> lock(reverseMutex);
+          reverseCv.wait(lock, [&]() { return isReverseStopping || reverseDecodes != decodes; });
+          if (isReverseStopping) return;
+        }
+        frame = stepper->cache->Previous(hns);
+        if (frame == NULL) break;
+        due = steady_clock::now(); // don't catch up after the decode
+      }
+
+      due += microseconds((LONGLONG)((hns - frame->hnsTime) / 10 / speed));
+      if (due < steady_clock::now() - milliseconds(500)) due = steady_clock::now();
+      {
+        std::unique_lock<std::mutex> lock(reverseMutex);
+        if (reverseCv.wait_until(lock, due, [this]() { return isReverseStopping; })) return;
+      }
+      if (!showStepFrame(*stepper, frame, false)) break;
+    }
+    // the start is reached (or the frames can't be shown): paused there
+    isReversePlaying = false;
+    notifyPlaybackState(4); // PAUSE
+  }
+
+  // A sample of the session into the step cache, once stepping is used
+  void recordStepFrame(LONGLONG hnsTime, LONGLONG hnsDuration, const BYTE* pSampleBuffer, DWORD dwSampleSize) {
+    bool isContiguous = lastSampleHns >= 0 && llabs(hnsTime - lastSampleEndHns) <= hnsDuration / 2;
+    lastSampleHns = hnsTime;
+    lastSampleEndHns = hnsTime + hnsDuration;
+    bool isCreated = false;
+    {
+      std::lock_guard<std::mutex> lock(stepMutex);
+      isCreated = isStepRecordArmed;
+      isStepRecordArmed = false;
+    }
+    auto stepper = getStepper(isCreated);
+    if (stepper == NULL) return;
+
+    Nv12Frame frame;
+    if (!GetNv12Frame(pSampleBuffer, dwSampleSize, m_VideoWidth, m_VideoHeight, &frame)) return;
+    int64_t start, end;
+    stepper->gopAt(hnsTime, &start, &end);
+    stepper->cache->SetPlayHead(hnsTime);
+    stepper->cache->AddFrame(start, end, std::make_shared<CachedFrame>(frame, hnsTime, hnsDuration), isContiguous);
+
+    // the play head enters a GOP: the previous one is decoded meanwhile, if playback missed
+    // a part of it (a step back from here is then served at once)
+    if (start > 0 && stepper->decoder != NULL && (!isContiguous || hnsTime - hnsDuration < start)) {
+      int64_t previousStart, previousEnd;
+      stepper->gopAt(start - 1, &previousStart, &previousEnd);
+      if (previousStart != start && !stepper->cache->HasGop(previousStart)) stepper->decoder->Request(previousStart, previousEnd, NULL);
+    }
+  }
+
+  void onLoopEnded() {
+    auto cache = getLoopCache();
+    if (cache != NULL) {
+      cache->EndRecording(GetDuration() * 10000);
+      // (only the video size is cached, not the scaled outputs)
+      if (cache->IsReady() && !isAudible() && cache->Width() == m_VideoWidth && cache->Height() == m_VideoHeight &&
+          fanout->OutputCount() == 0) {
+        startCachePlayback(0);
+        return;
+      }
+    }
+    isLoopRecordArmed = true;
+    Seek(0);
+  }
+
+  // A frame shown shrunk: the pass can't be replayed from the cache
+  void skipLoopFrame() {
+    isLoopRecordArmed = false;
+    auto cache = getLoopCache();
+    if (cache != NULL) cache->CancelRecording();
+  }
+
+  void recordLoopFrame(LONGLONG hnsTime) {
+    bool isFirstFrame = isLoopRecordArmed.exchange(false);
+    if (!isLooping) return;
+    auto cache = getLoopCache();
+    if (cache == NULL) return;
+    if (isFirstFrame) cache->BeginRecording(m_VideoWidth, m_VideoHeight);
+    cache->AddFrame(hnsTime, m_VideoWidth, m_VideoHeight, m_pBuffer);
+  }
+
+  // Shows the cached frames at their pace, from 'fromMs', until stopped
+  void runCachePlayback(LONGLONG fromMs) {
+    using namespace std::chrono;
+    auto cache = getLoopCache();
+    size_t count = cache != NULL ? cache->FrameCount() : 0;
+    if (count == 0) return;
+
+    size_t i = 0;
+    while (i < count && cache->FrameTime(i) / 10000 < fromMs) i++;
+    if (i == count) i = 0;
+
+    LONGLONG hnsPrev = cache->FrameTime(i);
+    auto due = steady_clock::now();
+    for (;;) {
+      LONGLONG hns = cache->FrameTime(i);
+      // after the last frame, the clip restarts at 0
+      LONGLONG delta = hns >= hnsPrev ? hns - hnsPrev : cache->Duration() - hnsPrev + hns;
+      if (delta < 0) delta = 0;
+      due += microseconds((LONGLONG)(delta / 10 / playbackSpeed));
+      if (due < steady_clock::now() - milliseconds(500)) due = steady_clock::now(); // don't catch up after a stall
+
+      {
+        std::unique_lock<std::mutex> lock(cacheMutex);
+        if (cacheCv.wait_until(lock, due, [this]() { return isCacheThreadStopping; })) return;
+      }
+      if (textureId == -1) return;
+      if (!cache->ReadFrame(i, m_pBuffer)) {
+        // cache dropped meanwhile: continue with the session
+        isCacheMode = false;
+        Seek(cachePositionMs);
+        return;
+      }
+      cachePositionMs = hns / 10000;
+      markFrameAvailable();
+
+      hnsPrev = hns;
+      if (++i == count) i = 0;
+    }
+  }
+
   enum PlaybackState { IDLE = 0, BUFFERING_START, BUFFERING_END, START, PAUSE, STOP, END, SESSION_ERROR };
   PlaybackState mPlaybackState = IDLE;
   BYTE* m_pBuffer = NULL;
   DWORD m_lastSampleSize = 0;
+  DWORD m_formatSampleSize = 0; // of the frame size last read back from the sink
+  static const uint32_t MIN_SCALED_WIDTH = 160;
 
   void OnPlayerEvent(MediaEventType event) override
   {
+    if (event == MESessionEnded && isLooping) {
+      onLoopEnded(); // Dart is not told, the clip keeps playing
+      return;
+    }
+
     switch (event) {
       case MEBufferingStarted:
         mPlaybackState = BUFFERING_START;
@@ -89,11 +841,10 @@ private:
       default:
         return;
     }
+    // reverse playback is reported as playing, the session is paused under it
+    if (event == MESessionPaused && isReversePlaying) return;
 
-    flutter::EncodableMap arguments;
-    arguments[flutter::EncodableValue("textureId")] = flutter::EncodableValue(textureId);
-    arguments[flutter::EncodableValue("state")] = flutter::EncodableValue(mPlaybackState);
-    gMethodChannel->InvokeMethod("OnPlaybackEvent", std::make_unique<flutter::EncodableValue>(arguments));
+    notifyPlaybackState(mPlaybackState);
   }
 
   void OnProcessSample(REFGUID guidMajorMediaType, DWORD dwSampleFlags,
@@ -101,12 +852,34 @@ private:
       DWORD dwSampleSize)
   {
       if (textureId == -1) return; //player maybe shutdown or deleted
-      uint64_t now = getCurrentTime();
-      if (now - lastFrameTime < 30) return;
-      lastFrameTime = now;
+      if (isStepMode) return; // paused, the frames shown come from the step cache
+      // an HLS variant switch may change the frame size mid-stream
+      if (m_formatSampleSize != dwSampleSize) {
+        if (m_formatSampleSize != 0) RefreshVideoSize();
+        m_formatSampleSize = dwSampleSize;
+      }
+      // (before the budget: a frame not shown is still a step)
+      recordStepFrame(llSampleTime, llSampleDuration, pSampleBuffer, dwSampleSize);
+      // the budget shared by all the players decides if this frame is shown, and at which size
+      FrameBudget::Decision decision = FrameBudget::Shared().Admit(budgetId, getSteadyTimeUs());
+      if (!decision.isAccepted) return;
+      int64_t convertStartUs = getSteadyTimeUs();
+
+      // mosaic mode: converted and scaled straight into the tile
+      int tile = -1;
+      auto canvas = getMosaicTile(&tile);
+      if (canvas != NULL) {
+        Nv12Frame frame;
+        if (!GetNv12Frame(pSampleBuffer, dwSampleSize, m_VideoWidth, m_VideoHeight, &frame)) return;
+        canvas->DrawTile((uint32_t)tile, frame);
+        FrameBudget::Shared().Report(budgetId, 1, getSteadyTimeUs() - convertStartUs);
+        if (firstFrameMs < 0 && openStartTime != 0) firstFrameMs = (int64_t)(getCurrentTime() - openStartTime);
+        return;
+      }
 
       if (m_lastSampleSize != dwSampleSize) {
         m_lastSampleSize = dwSampleSize;
+        fanout->ClearFullFrame();
         if (m_pBuffer != NULL) delete m_pBuffer;
         m_pBuffer = new BYTE[m_VideoWidth * (m_VideoHeight + 1) * 4 + 10]; // height + 1 to avoid crash for odd width/height video
 
@@ -120,55 +893,48 @@ private:
       }
 
       // NV12 -> RGBA
-      // ref: https://blog.csdn.net/u010842019/article/details/52086103
-      #define ALIGN16(v) ((v+15)&~15)
-      UINT32 strideW = ALIGN16(m_VideoWidth);
-      UINT32 strideH = ALIGN16(m_VideoHeight);
-      if (strideW * strideH * 3 / 2 > dwSampleSize) {
-        strideH = m_VideoHeight; //workaround, why sometimes height is no need to align ?
+      Nv12Frame frame;
+      if (!GetNv12Frame(pSampleBuffer, dwSampleSize, m_VideoWidth, m_VideoHeight, &frame)) return;
+      // shrunk when over budget, but not below MIN_SCALED_WIDTH, nor with outputs sharing the full size frame
+      uint32_t scale = fanout->OutputCount() > 0 ? 1 : decision.scale;
+      while (scale > 1 && m_VideoWidth / scale < MIN_SCALED_WIDTH) scale /= 2;
+      if (scale > 1) {
+        // (the full size is restored above, on the next frame converted at full size)
+        pixel_buffer.width = m_VideoWidth / scale;
+        pixel_buffer.height = m_VideoHeight / scale;
+        ConvertScaleNv12ToRgba(frame, m_pBuffer, m_VideoWidth / scale, m_VideoHeight / scale, m_VideoWidth / scale * 4);
+        skipLoopFrame();
+      } else {
+        ConvertNv12ToRgba(frame, m_pBuffer, m_VideoWidth * 4);
+        if (fanout->OutputCount() > 0) fanout->Process(frame, m_pBuffer);
+        recordLoopFrame(llSampleTime);
       }
+      FrameBudget::Shared().Report(budgetId, scale, getSteadyTimeUs() - convertStartUs);
 
-      const BYTE *ubase = pSampleBuffer + strideW * strideH;
-      //const BYTE *pU = ubase;
-      for (UINT32 y = 0; y < m_VideoHeight; y+=2) {
-        const BYTE *pY = pSampleBuffer + y * strideW;
-        const BYTE *pY2 = pY + strideW;
-        BYTE *pDst = m_pBuffer + y * m_VideoWidth * 4;
-        BYTE *pDst2 = pDst + m_VideoWidth * 4;
-
-        const BYTE *ubaseDelta = ubase + y / 2 * strideW;
-        for (UINT32 x = 0; x < m_VideoWidth; x+=2) {
-          BYTE Y;
-          int U = (int)ubaseDelta[x] - 128;
-          int V = (int)ubaseDelta[x+1] - 128;
-
-          int dy = (1435 * V) >> 10;
-          int du = (- 352 * U - 731 * V) >> 10;
-          int dv = (1814 * U) >> 10;
-
-          int tmp;
-          #define myByteClamp(dst, value)  \
-            tmp = value;                        \
-            dst = tmp < 0 ? 0 : tmp > 255 ? 255 : (BYTE)tmp;
-
-          // ref: https://zhuanlan.zhihu.com/p/397551265
-          #define _convert(pY, pDst)            \
-            Y = *(pY++);                      \
-            myByteClamp(*(pDst++), Y + dy);   \
-            myByteClamp(*(pDst++), Y + du);   \
-            myByteClamp(*(pDst++), Y + dv);   \
-            pDst++;
-
-          _convert(pY, pDst); //X0Y0
-          _convert(pY, pDst); //X1Y0
-          _convert(pY2, pDst2); //X0Y1
-          _convert(pY2, pDst2); //X1Y1
-        }
-      }
+      if (firstFrameMs < 0 && openStartTime != 0) firstFrameMs = (int64_t)(getCurrentTime() - openStartTime);
 
-      if (texture_registar_ != NULL && textureId != -1) {
-        texture_registar_->MarkTextureFrameAvailable(textureId);
+      if (textureId != -1) markFrameAvailable();
+  }
+
+  // "renderer": "dx11": the frame was paced (and late ones dropped) by the renderer's scheduler,
+  // it is only copied to the texture here. Not fed to the outputs, the mosaic, nor the caches.
+  void OnRenderedFrame(const BYTE* pBgra, UINT32 width, UINT32 height, UINT32 pitch) override
+  {
+      if (textureId == -1) return; //player maybe shutdown or deleted
+      if (m_lastSampleSize != width * height * 4) {
+        m_lastSampleSize = width * height * 4;
+        if (m_pBuffer != NULL) delete m_pBuffer;
+        m_pBuffer = new BYTE[width * height * 4];
+
+        pixel_buffer.width = width;
+        pixel_buffer.height = height;
+        pixel_buffer.buffer = m_pBuffer;
       }
+      ConvertBgraToRgba(pBgra, pitch, width, height, m_pBuffer, width * 4);
+
+      if (firstFrameMs < 0 && openStartTime != 0) firstFrameMs = (int64_t)(getCurrentTime() - openStartTime);
+
+      if (textureId != -1) markFrameAvailable();
   }
 };
 
@@ -176,43 +942,381 @@ std::map<int64_t, MyPlayerInternal*> playerMap; // textureId -> MyPlayerInternal
 std::mutex mapMutex;
 bool isMFInited = false;
 
+// Idle players, so openVideo() skips the player construction (audio endpoint enumeration).
+// A pooled player has no texture: each checkout registers a new one, so a texture id disposed
+// late by Dart (ex. by the finalizer) never reaches the next controller. Guarded by mapMutex.
+std::vector<MyPlayerInternal*> playerPool;
+size_t playerPoolSize = 0;
+
+// Players opened with "shareDecode", by path: a later openVideo of the same path attaches a view
+// to the player instead of decoding it again. Guarded by mapMutex.
+std::map<std::string, MyPlayerInternal*> sharedPlayers;
+
+// Players drawn into the tiles of one texture (video walls), see "createMosaic". The canvas is
+// published at its own cadence, when a tile has changed.
+struct Mosaic {
+  int64_t textureId = -1;
+  std::shared_ptr<MosaicCanvas> canvas;
+  FlutterDesktopPixelBuffer pixel_buffer;
+  std::thread publisher;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool isStopping = false;
+};
+std::map<int64_t, std::shared_ptr<Mosaic>> mosaics; // textureId -> mosaic, guarded by mapMutex
+
+void runMosaicPublisher(Mosaic* mosaic, int fps) {
+  using namespace std::chrono;
+  auto interval = microseconds(1000000 / fps);
+  auto due = steady_clock::now();
+  for (;;) {
+    due += interval;
+    if (due < steady_clock::now()) due = steady_clock::now(); // don't catch up after a stall
+    {
+      std::unique_lock<std::mutex> lock(mosaic->mutex);
+      if (mosaic->cv.wait_until(lock, due, [=]() { return mosaic->isStopping; })) return;
+    }
+    if (mosaic->canvas->TakeDirtyTiles() != 0) texture_registar_->MarkTextureFrameAvailable(mosaic->textureId);
+  }
+}
+
+// Returns the texture id of the canvas, -1 if the grid is invalid
+int64_t createMosaic(uint32_t width, uint32_t height, uint32_t columns, uint32_t rows, int fps) {
+  auto canvas = MosaicCanvas::Create(width, height, columns, rows);
+  if (canvas == NULL) return -1;
+  if (fps < 1) fps = 1;
+  if (fps > 120) fps = 120;
+
+  auto mosaic = std::make_shared<Mosaic>();
+  mosaic->canvas = canvas;
+  memset(&mosaic->pixel_buffer, 0, sizeof(mosaic->pixel_buffer));
+  mosaic->pixel_buffer.buffer = canvas->Pixels();
+  mosaic->pixel_buffer.width = canvas->Width();
+  mosaic->pixel_buffer.height = canvas->Height();
+  Mosaic* pMosaic = mosaic.get();
+  flutter::TextureVariant* texture = new flutter::TextureVariant(flutter::PixelBufferTexture(
+    [mosaic](size_t width, size_t height) -> const FlutterDesktopPixelBuffer* {
+      return &mosaic->pixel_buffer;
+    }));
+  mosaic->textureId = texture_registar_->RegisterTexture(texture);
+  mosaic->publisher = std::thread([pMosaic, fps]() { runMosaicPublisher(pMosaic, fps); });
+
+  std::lock_guard<std::mutex> lock(mapMutex);
+  mosaics[mosaic->textureId] = mosaic;
+  return mosaic->textureId;
+}
+
+void destroyMosaic(int64_t mosaicId) {
+  std::shared_ptr<Mosaic> mosaic;
+  {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    auto it = mosaics.find(mosaicId);
+    if (it == mosaics.end()) return;
+    mosaic = it->second;
+    mosaics.erase(it);
+    // players still on the canvas go back to their textures
+    for (auto& entry : playerMap) {
+      int tile = -1;
+      if (entry.second != NULL && entry.second->getMosaicTile(&tile) == mosaic->canvas) entry.second->leaveMosaic(false);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mosaic->mutex);
+    mosaic->isStopping = true;
+  }
+  mosaic->cv.notify_all();
+  mosaic->publisher.join();
+  texture_registar_->UnregisterTexture(mosaic->textureId);
+}
+
+std::shared_ptr<MosaicCanvas> getMosaicCanvas(int64_t mosaicId) {
+  std::lock_guard<std::mutex> lock(mapMutex);
+  auto it = mosaics.find(mosaicId);
+  if (it == mosaics.end()) return NULL;
+  return it->second->canvas;
+}
+
 void createTexture(MyPlayerInternal* data) {
   memset(&data->pixel_buffer, 0, sizeof(data->pixel_buffer));
+  memset(&data->primaryOutputBuffer, 0, sizeof(data->primaryOutputBuffer));
   flutter::TextureVariant* texture = new flutter::TextureVariant(flutter::PixelBufferTexture(
     [=](size_t width, size_t height) -> const FlutterDesktopPixelBuffer* {
-      return &data->pixel_buffer;
+      return data->getPixelBuffer();
     }));
   data->textureId = texture_registar_->RegisterTexture(texture);
 }
 
+void ensureMFStartup() {
+  if (!isMFInited) {
+    MFStartup(MF_VERSION); //TODO: hint user if startup failed... if it is possible?
+    isMFInited = true;
+  }
+}
+
 MyPlayerInternal* getPlayerById(int64_t textureId, bool autoCreate = false) {
   std::lock_guard<std::mutex> lock(mapMutex);
-  MyPlayerInternal* data = playerMap[textureId];
+  auto it = playerMap.find(textureId);
+  MyPlayerInternal* data = it != playerMap.end() ? it->second : NULL;
   if (data == NULL && autoCreate) {
-    if (!isMFInited) {
-      MFStartup(MF_VERSION); //TODO: hint user if startup failed... if it is possible?
-      isMFInited = true;
+    ensureMFStartup();
+    if (!playerPool.empty()) {
+      data = playerPool.back();
+      playerPool.pop_back();
+      data->isPooled = true;
+    } else {
+      data = new MyPlayerInternal();
+      data->isPooled = false;
     }
-    data = new MyPlayerInternal();
     createTexture(data);
     playerMap[data->textureId] = data;
   }
   return data;
 }
 
-void destroyPlayerById(int64_t textureId) {
+// 'data' if it is still loading for 'textureId': shown by that texture, or by views if it was disposed
+// meanwhile. NULL if the player was released, or reused (its texture is then another one).
+MyPlayerInternal* getLoadingPlayer(MyPlayerInternal* data, int64_t textureId) {
   std::lock_guard<std::mutex> lock(mapMutex);
-  MyPlayerInternal* data = playerMap[textureId];
-  if (data == NULL) return;
-  playerMap.erase(textureId);
-  if (data->textureId != -1) {
-    texture_registar_->UnregisterTexture(data->textureId);
-    data->textureId = -1;
+  for (auto& entry : playerMap) {
+    if (entry.second == data) return data->textureId == textureId ? data : NULL;
   }
+  return NULL;
+}
 
+void releasePlayer(MyPlayerInternal* data) {
+  if (data->textureId != -1 && !data->isPrimaryDetached) texture_registar_->UnregisterTexture(data->textureId);
+  data->textureId = -1;
   data->Release();
 }
 
+// Offers a loading player to later opens of 'shareKey', unless another player has it already. Must hold mapMutex.
+void sharePlayerLocked(const std::string& shareKey, MyPlayerInternal* data) {
+  if (sharedPlayers.find(shareKey) != sharedPlayers.end()) return;
+  sharedPlayers[shareKey] = data;
+  data->shareKey = shareKey;
+}
+
+void unsharePlayerLocked(MyPlayerInternal* data) {
+  if (data->shareKey.empty()) return;
+  auto it = sharedPlayers.find(data->shareKey);
+  if (it != sharedPlayers.end() && it->second == data) sharedPlayers.erase(it);
+  data->shareKey.clear();
+}
+
+// A new texture on the player of 'shareKey', false if there is none. 'reply' is called once the player
+// is loaded (at once if it is), with false if its load fails, see failLoadingViews().
+bool attachSharedView(const std::string& shareKey, uint32_t width, uint32_t height,
+    std::function<void(MyPlayerInternal*, int64_t, bool)> reply) {
+  MyPlayerInternal* data;
+  int64_t viewTextureId;
+  {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    auto it = sharedPlayers.find(shareKey);
+    if (it == sharedPlayers.end()) return false;
+    data = it->second;
+    viewTextureId = data->addView(width, height);
+    playerMap[viewTextureId] = data;
+    std::lock_guard<std::mutex> pendingLock(data->pendingMutex);
+    if (data->isLoading) {
+      data->loadWaiters.push_back([=](bool isLoaded) { reply(data, viewTextureId, isLoaded); });
+      return true;
+    }
+  }
+  reply(data, viewTextureId, true); // the view keeps the player alive
+  return true;
+}
+
+// The load of a shared player failed: no more views are attached, and the waiting ones are refused
+void failLoadingViews(MyPlayerInternal* data) {
+  {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    unsharePlayerLocked(data);
+  }
+  for (auto& waiter : data->takeLoadWaiters()) waiter(false);
+}
+
+// Releases the extra pooled players, and creates the missing ones as one job of the shared worker pool:
+// the construction (audio endpoint enumeration) blocks neither the platform thread nor mapMutex.
+bool isPoolFilling = false; // a fill job is posted, guarded by mapMutex
+
+void fillPlayerPool() {
+  std::vector<MyPlayerInternal*> extraPlayers;
+  bool isFillNeeded;
+  {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    while (playerPool.size() > playerPoolSize) {
+      extraPlayers.push_back(playerPool.back());
+      playerPool.pop_back();
+    }
+    isFillNeeded = playerPool.size() < playerPoolSize && !isPoolFilling;
+    if (isFillNeeded) {
+      ensureMFStartup();
+      isPoolFilling = true;
+    }
+  }
+  for (auto data : extraPlayers) releasePlayer(data);
+  if (!isFillNeeded) return;
+
+  WorkerPool::Shared().Post([]() {
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    for (;;) {
+      {
+        std::lock_guard<std::mutex> lock(mapMutex);
+        if (playerPool.size() >= playerPoolSize) {
+          isPoolFilling = false;
+          break;
+        }
+      }
+      MyPlayerInternal* data = new MyPlayerInternal();
+      {
+        std::lock_guard<std::mutex> lock(mapMutex);
+        if (playerPool.size() < playerPoolSize) {
+          playerPool.push_back(data);
+          data = NULL;
+        }
+      }
+      if (data != NULL) releasePlayer(data); // the pool size was lowered meanwhile
+    }
+    CoUninitialize();
+  });
+}
+
+// Read the metadata of a local file: parse the container headers when the format is known (MP4 / MKV / WebM),
+// else let Media Foundation resolve the source. Must be called on a thread with COM initialized.
+bool readMetadata(const std::wstring& path, MediaMetadata* pMetadata) {
+  if (ProbeMediaFile(path, pMetadata) != CONTAINER_UNKNOWN && pMetadata->durationMs >= 0) return true;
+  return SUCCEEDED(MyPlayer::ReadMetadata(path.c_str(), pMetadata));
+}
+
+// Fill the persisted metadata index for files which are not indexed yet, as one job of the shared
+// worker pool. Calls 'callback' with the number of newly indexed files.
+void prewarmMetadata(std::vector<std::wstring> paths, std::function<void(int)> callback) {
+  {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    ensureMFStartup();
+  }
+  WorkerPool::Shared().Post([=]() {
+    int count = 0;
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    for (auto& path : paths) {
+      MediaMetadata metadata;
+      if (MediaMetadataCache::Instance().Contains(path)) continue;
+      if (!readMetadata(path, &metadata)) continue;
+      MediaMetadataCache::Instance().Store(path, metadata);
+      count++;
+    }
+    CoUninitialize();
+    callback(count);
+  });
+}
+
+// Get the metadata of a file without opening a player (from the index, or by reading it), on the shared worker pool.
+void probeMetadata(std::wstring path, std::function<void(bool, const MediaMetadata&)> callback) {
+  {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    ensureMFStartup();
+  }
+  WorkerPool::Shared().Post([=]() {
+    MediaMetadata metadata;
+    bool isSuccess = MediaMetadataCache::Instance().Lookup(path, &metadata);
+    if (!isSuccess) {
+      CoInitializeEx(NULL, COINIT_MULTITHREADED);
+      isSuccess = readMetadata(path, &metadata);
+      CoUninitialize();
+      if (isSuccess) MediaMetadataCache::Instance().Store(path, metadata);
+    }
+    callback(isSuccess, metadata);
+  });
+}
+
+std::wstring utf8ToWide(const std::string& str) {
+  int len = MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, NULL, 0);
+  if (len <= 0) return std::wstring();
+  std::wstring wstr(len - 1, L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, str.c_str(), -1, &wstr[0], len);
+  return wstr;
+}
+
+void destroyPlayerById(int64_t textureId) {
+  MyPlayerInternal* data;
+  {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    auto it = playerMap.find(textureId);
+    if (it == playerMap.end()) return;
+    data = it->second;
+    playerMap.erase(it);
+    if (data == NULL) return;
+
+    // a shared player lives until its last texture is disposed
+    if (textureId != data->textureId) {
+      data->removeView(textureId);
+    } else if (data->shareCount > 1) {
+      data->detachPrimary();
+    } else {
+      data->shareCount = 0;
+    }
+    if (data->shareCount > 0) return;
+    unsharePlayerLocked(data);
+  }
+
+  // reset / released outside mapMutex (unlinked above, as in clearAll): the shutdown waits for the
+  // session, and the session events still delivered look players up
+  data->leaveMosaic(true);
+  bool hasPoolRoom;
+  {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    hasPoolRoom = playerPool.size() < playerPoolSize;
+  }
+
+  // back to the pool if there is room, and nothing still uses the player, without its texture
+  if (hasPoolRoom && data->reset()) {
+    if (data->textureId != -1 && !data->isPrimaryDetached) texture_registar_->UnregisterTexture(data->textureId);
+    data->textureId = -1;
+    data->isPrimaryDetached = false;
+    std::lock_guard<std::mutex> lock(mapMutex);
+    if (playerPool.size() < playerPoolSize) {
+      playerPool.push_back(data);
+      return;
+    }
+  }
+  releasePlayer(data);
+}
+
+// Releases every player (once, a shared one is in playerMap once per texture), the pooled ones, and the mosaics
+void clearAll() {
+  std::vector<int64_t> mosaicIds;
+  {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    for (auto& entry : mosaics) mosaicIds.push_back(entry.first);
+  }
+  for (int64_t mosaicId : mosaicIds) destroyMosaic(mosaicId);
+
+  std::set<MyPlayerInternal*> players;
+  std::vector<MyPlayerInternal*> pooledPlayers;
+  {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    for (auto& entry : playerMap) {
+      if (entry.second != NULL) players.insert(entry.second);
+    }
+    playerMap.clear();
+    sharedPlayers.clear();
+    pooledPlayers.swap(playerPool);
+  }
+
+  // shut down outside mapMutex: the session events still delivered look players up
+  for (auto data : players) {
+    std::cout << "[video_player_win] old player found, deleting" << std::endl;
+    for (int64_t id : data->textureIds()) {
+      if (id != data->textureId) data->removeView(id);
+    }
+    data->stopCachePlayback();
+    data->dropFrameStepper();
+    data->Shutdown();
+    releasePlayer(data);
+  }
+  for (auto data : pooledPlayers) releasePlayer(data);
+}
+
 // Jacky }
 
 namespace video_player_win {
@@ -237,6 +1341,7 @@ void VideoPlayerWinPlugin::RegisterWithRegistrar(
   texture_registar_ = registrar->texture_registrar(); //Jacky
   gMethodChannel = new flutter::MethodChannel<flutter::EncodableValue>(registrar->messenger(), "video_player_win",
           &flutter::StandardMethodCodec::GetInstance()); //Jacky
+  if (registrar->GetView() != NULL) gRendererWindow = registrar->GetView()->GetNativeWindow();
 }
 
 VideoPlayerWinPlugin::VideoPlayerWinPlugin() {}
@@ -250,30 +1355,244 @@ void VideoPlayerWinPlugin::HandleMethodCall(
     const flutter::MethodCall<flutter::EncodableValue> &method_call,
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
 
-   if (method_call.method_name().compare("clearAll") == 0) {
-	  // called when hot-restart in debug mode, and clear all the old players which created before hot-restart
-	  for (auto iter = playerMap.begin(); iter != playerMap.end(); iter++) {
-		  std::cout << "[video_player_win] old player found, deleting" << std::endl;
-		  delete iter->second;
-	  }
-	  playerMap.clear();
-	  result->Success();
-	  return;
+  if (method_call.method_name().compare("clearAll") == 0) {
+    // called when hot-restart in debug mode, and clear all the old players which created before hot-restart
+    clearAll();
+    result->Success();
+    return;
   }
 
   //std::cout << "HandleMethodCall: " << method_call.method_name() << std::endl;
   flutter::EncodableMap arguments = std::get<flutter::EncodableMap>(*method_call.arguments());
 
+  if (method_call.method_name().compare("prewarmMetadata") == 0) {
+    std::vector<std::wstring> paths;
+    for (auto& item : std::get<flutter::EncodableList>(arguments[flutter::EncodableValue("paths")])) {
+      paths.push_back(utf8ToWide(std::get<std::string>(item)));
+    }
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> shared_result = std::move(result);
+    prewarmMetadata(paths, [=](int count) {
+      shared_result->Success(flutter::EncodableValue(count));
+    });
+    return;
+  }
+
+  if (method_call.method_name().compare("setPlayerPoolSize") == 0) {
+    auto size = arguments[flutter::EncodableValue("size")].LongValue();
+    {
+      std::lock_guard<std::mutex> lock(mapMutex);
+      playerPoolSize = (size_t)(size > 0 ? size : 0);
+    }
+    fillPlayerPool();
+    result->Success(flutter::EncodableValue(true));
+    return;
+  }
+
+  if (method_call.method_name().compare("createMosaic") == 0) {
+    auto width = arguments[flutter::EncodableValue("width")].LongValue();
+    auto height = arguments[flutter::EncodableValue("height")].LongValue();
+    auto columns = arguments[flutter::EncodableValue("columns")].LongValue();
+    auto rows = arguments[flutter::EncodableValue("rows")].LongValue();
+    auto fps = arguments[flutter::EncodableValue("fps")].LongValue();
+    int64_t mosaicId = -1;
+    if (width > 0 && height > 0 && columns > 0 && rows > 0) {
+      mosaicId = createMosaic((uint32_t)width, (uint32_t)height, (uint32_t)columns, (uint32_t)rows, (int)fps);
+    }
+    result->Success(flutter::EncodableValue(mosaicId));
+    return;
+  }
+
+  if (method_call.method_name().compare("disposeMosaic") == 0) {
+    destroyMosaic(arguments[flutter::EncodableValue("mosaicId")].LongValue());
+    result->Success(flutter::EncodableValue(true));
+    return;
+  }
+
+  if (method_call.method_name().compare("setFrameBudget") == 0) {
+    FrameBudget::Shared().SetBudget(arguments[flutter::EncodableValue("budgetUs")].LongValue());
+    result->Success(flutter::EncodableValue(true));
+    return;
+  }
+
+  if (method_call.method_name().compare("setHttpCache") == 0) {
+    HttpStreamOptions options = HttpByteStream::GetOptions();
+    options.isEnabled = std::get<bool>(arguments[flutter::EncodableValue("enabled")]);
+    options.readAheadBytes = arguments[flutter::EncodableValue("readAheadBytes")].LongValue();
+    options.cacheBytes = (uint64_t)arguments[flutter::EncodableValue("cacheBytes")].LongValue();
+    HttpByteStream::SetOptions(options); // for the next network sources opened
+    result->Success(flutter::EncodableValue(true));
+    return;
+  }
+
+  if (method_call.method_name().compare("setHlsOptions") == 0) {
+    HlsOptions options = HlsByteStream::GetOptions();
+    options.parallelFetches = (int)arguments[flutter::EncodableValue("parallelFetches")].LongValue();
+    options.maxPoolBytes = arguments[flutter::EncodableValue("maxPoolBytes")].LongValue();
+    options.maxAheadSec = arguments[flutter::EncodableValue("maxAheadMs")].LongValue() / 1000.0;
+    options.initialBps = arguments[flutter::EncodableValue("initialBps")].LongValue();
+    HlsByteStream::SetOptions(options); // for the next playlists opened
+    result->Success(flutter::EncodableValue(true));
+    return;
+  }
+
+  if (method_call.method_name().compare("allocMemorySource") == 0) {
+    // filled by Dart in place, through FFI: the bytes are not copied through the channel
+    auto extension = std::get<std::string>(arguments[flutter::EncodableValue("extension")]);
+    uint8_t* pData = NULL;
+    std::string url = MemoryByteStream::AllocateBytes((size_t)arguments[flutter::EncodableValue("size")].LongValue(), extension, &pData);
+    if (url.empty()) {
+      result->Success();
+      return;
+    }
+    flutter::EncodableMap map;
+    map[flutter::EncodableValue("url")] = flutter::EncodableValue(url);
+    map[flutter::EncodableValue("address")] = flutter::EncodableValue((int64_t)(intptr_t)pData);
+    result->Success(flutter::EncodableValue(map));
+    return;
+  }
+
+  if (method_call.method_name().compare("releaseMemorySource") == 0) {
+    MemoryByteStream::ReleaseBytes(std::get<std::string>(arguments[flutter::EncodableValue("url")]));
+    result->Success(flutter::EncodableValue(true));
+    return;
+  }
+
+  if (method_call.method_name().compare("setFileReadAhead") == 0) {
+    FileStreamOptions options = FileByteStream::GetOptions();
+    options.isEnabled = std::get<bool>(arguments[flutter::EncodableValue("enabled")]);
+    options.readAheadBytes = arguments[flutter::EncodableValue("readAheadBytes")].LongValue();
+    options.useMemoryMap = std::get<bool>(arguments[flutter::EncodableValue("memoryMap")]);
+    FileByteStream::SetOptions(options); // for the next files opened
+    result->Success(flutter::EncodableValue(true));
+    return;
+  }
+
+  if (method_call.method_name().compare("probe") == 0) {
+    auto path = utf8ToWide(std::get<std::string>(arguments[flutter::EncodableValue("path")]));
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> shared_result = std::move(result);
+    probeMetadata(path, [=](bool isSuccess, const MediaMetadata& metadata) {
+      flutter::EncodableMap map;
+      map[flutter::EncodableValue("result")] = flutter::EncodableValue(isSuccess);
+      if (isSuccess) {
+        map[flutter::EncodableValue("duration")] = flutter::EncodableValue(metadata.durationMs);
+        map[flutter::EncodableValue("videoWidth")] = flutter::EncodableValue((int32_t)metadata.videoWidth);
+        map[flutter::EncodableValue("videoHeight")] = flutter::EncodableValue((int32_t)metadata.videoHeight);
+        map[flutter::EncodableValue("frameRateNumerator")] = flutter::EncodableValue((int64_t)metadata.frameRateNumerator);
+        map[flutter::EncodableValue("frameRateDenominator")] = flutter::EncodableValue((int64_t)metadata.frameRateDenominator);
+        map[flutter::EncodableValue("videoCodec")] = flutter::EncodableValue((int64_t)metadata.videoCodec);
+        map[flutter::EncodableValue("audioCodec")] = flutter::EncodableValue((int64_t)metadata.audioCodec);
+        map[flutter::EncodableValue("videoStreams")] = flutter::EncodableValue((int32_t)metadata.videoStreams);
+        map[flutter::EncodableValue("audioStreams")] = flutter::EncodableValue((int32_t)metadata.audioStreams);
+      }
+      shared_result->Success(flutter::EncodableValue(map));
+    });
+    return;
+  }
+
+  if (method_call.method_name().compare("getThumbnails") == 0) {
+    ThumbnailRequest request;
+    request.path = utf8ToWide(std::get<std::string>(arguments[flutter::EncodableValue("path")]));
+    for (auto& item : std::get<flutter::EncodableList>(arguments[flutter::EncodableValue("times")])) {
+      request.timesMs.push_back(item.LongValue());
+    }
+    request.thumbWidth = (uint32_t)arguments[flutter::EncodableValue("thumbWidth")].LongValue();
+    request.thumbHeight = (uint32_t)arguments[flutter::EncodableValue("thumbHeight")].LongValue();
+    request.columns = (uint32_t)arguments[flutter::EncodableValue("columns")].LongValue();
+    {
+      std::lock_guard<std::mutex> lock(mapMutex);
+      ensureMFStartup();
+    }
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> shared_result = std::move(result);
+    ThumbnailService::Instance().Request(request, [=](std::shared_ptr<const ThumbnailSheet> sheet) {
+      flutter::EncodableMap map;
+      map[flutter::EncodableValue("result")] = flutter::EncodableValue(sheet != NULL);
+      if (sheet != NULL) {
+        flutter::EncodableList times;
+        for (uint32_t i = 0; i < sheet->Count(); i++) times.push_back(flutter::EncodableValue(sheet->TimeMs(i)));
+        map[flutter::EncodableValue("thumbWidth")] = flutter::EncodableValue((int32_t)sheet->ThumbWidth());
+        map[flutter::EncodableValue("thumbHeight")] = flutter::EncodableValue((int32_t)sheet->ThumbHeight());
+        map[flutter::EncodableValue("columns")] = flutter::EncodableValue((int32_t)sheet->Columns());
+        map[flutter::EncodableValue("rows")] = flutter::EncodableValue((int32_t)sheet->Rows());
+        map[flutter::EncodableValue("times")] = flutter::EncodableValue(times);
+        map[flutter::EncodableValue("pixels")] = flutter::EncodableValue(std::vector<uint8_t>(sheet->Pixels(), sheet->Pixels() + sheet->PixelSize()));
+      }
+      shared_result->Success(flutter::EncodableValue(map));
+    });
+    return;
+  }
+
   auto textureId = arguments[flutter::EncodableValue("textureId")].LongValue();
   MyPlayerInternal* player;
   bool isOpenVideo = method_call.method_name().compare("openVideo") == 0;
+  uint32_t outputWidth = 0, outputHeight = 0;
+  std::string shareKey;
+  std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> openResult; // replied once loaded
   if (isOpenVideo) {
+    openResult = std::move(result);
+    uint64_t openStartTime = getCurrentTime();
+    // DX11 renderer: scheduled and presented by DX11VideoRenderer instead of the sample grabber
+    // (no output size nor shared decode, the renderer gives the frames at the video size)
+    auto rendererIter = arguments.find(flutter::EncodableValue("renderer"));
+    bool isDX11Renderer = gRendererWindow != NULL && rendererIter != arguments.end() &&
+        std::holds_alternative<std::string>(rendererIter->second) && std::get<std::string>(rendererIter->second) == "dx11";
+    auto outputWidthIter = arguments.find(flutter::EncodableValue("outputWidth"));
+    auto outputHeightIter = arguments.find(flutter::EncodableValue("outputHeight"));
+    if (!isDX11Renderer && outputWidthIter != arguments.end() && outputHeightIter != arguments.end()) {
+      int64_t width = outputWidthIter->second.LongValue();
+      int64_t height = outputHeightIter->second.LongValue();
+      outputWidth = (uint32_t)(width > 0 ? width : 0);
+      outputHeight = (uint32_t)(height > 0 ? height : 0);
+    }
+
+    // Shared decode: one more texture on the player already showing this file with the same options
+    // (not for a playlist), replied when that player is loaded
+    auto shareIter = arguments.find(flutter::EncodableValue("shareDecode"));
+    if (!isDX11Renderer && shareIter != arguments.end() && std::holds_alternative<bool>(shareIter->second) && std::get<bool>(shareIter->second) &&
+        arguments.find(flutter::EncodableValue("playlist")) == arguments.end()) {
+      auto bridgeIter = arguments.find(flutter::EncodableValue("isBridgeMode"));
+      bool isBridgeMode = bridgeIter != arguments.end() && std::holds_alternative<bool>(bridgeIter->second) && std::get<bool>(bridgeIter->second);
+      std::ostringstream key;
+      key << outputWidth << "x" << outputHeight << (isBridgeMode ? " bridge " : " ") << std::get<std::string>(arguments[flutter::EncodableValue("path")]);
+      shareKey = key.str();
+      bool isAttached = attachSharedView(shareKey, outputWidth, outputHeight, [=](MyPlayerInternal* sharedPlayer, int64_t viewTextureId, bool isLoaded) {
+        flutter::EncodableMap map;
+        if (!isLoaded) {
+          destroyPlayerById(viewTextureId);
+          map[flutter::EncodableValue("result")] = flutter::EncodableValue(false);
+          openResult->Success(flutter::EncodableValue(map));
+          return;
+        }
+        SIZE videoSize = sharedPlayer->GetVideoSize();
+        float volume = 1.0f;
+        sharedPlayer->GetVolume(&volume);
+        map[flutter::EncodableValue("result")] = flutter::EncodableValue(true);
+        map[flutter::EncodableValue("textureId")] = flutter::EncodableValue(viewTextureId);
+        map[flutter::EncodableValue("duration")] = flutter::EncodableValue((int64_t)sharedPlayer->GetDuration());
+        map[flutter::EncodableValue("videoWidth")] = flutter::EncodableValue(videoSize.cx);
+        map[flutter::EncodableValue("videoHeight")] = flutter::EncodableValue(videoSize.cy);
+        map[flutter::EncodableValue("volume")] = flutter::EncodableValue((double)volume);
+        map[flutter::EncodableValue("isPlaying")] = flutter::EncodableValue(sharedPlayer->isPlaying());
+        openResult->Success(flutter::EncodableValue(map));
+      });
+      if (isAttached) return;
+    }
+
     player = getPlayerById(-1, true);
+    if (player != nullptr) {
+      player->openStartTime = openStartTime;
+      if (isDX11Renderer) player->UseDX11Renderer(gRendererWindow);
+      if (outputWidth > 0 || outputHeight > 0) player->primaryOutputId = player->fanout->AddOutput(outputWidth, outputHeight);
+      if (!shareKey.empty()) {
+        std::lock_guard<std::mutex> lock(mapMutex);
+        sharePlayerLocked(shareKey, player);
+      }
+    }
   } else {
     player = getPlayerById(textureId, false);
   }
   if (player == nullptr) {
-    result->Success();
+    if (isOpenVideo) openResult->Success();
+    else result->Success();
     return;
   }
 
@@ -286,69 +1605,428 @@ void VideoPlayerWinPlugin::HandleMethodCall(
     }
 
     textureId = player->textureId;
-    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> shared_result = std::move(result);
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> shared_result = openResult;
+
+    // Gapless playlist: 'path' is the first item
+    auto playlistIter = arguments.find(flutter::EncodableValue("playlist"));
+    if (playlistIter != arguments.end() && std::holds_alternative<flutter::EncodableList>(playlistIter->second)) {
+      std::vector<PlaylistItem> items;
+      for (auto& value : std::get<flutter::EncodableList>(playlistIter->second)) {
+        auto item = std::get<flutter::EncodableMap>(value);
+        PlaylistItem playlistItem;
+        playlistItem.url = utf8ToWide(std::get<std::string>(item[flutter::EncodableValue("path")]));
+        playlistItem.hnsStart = item[flutter::EncodableValue("startMs")].LongValue() * 10000;
+        playlistItem.hnsStop = item[flutter::EncodableValue("endMs")].LongValue() * 10000;
+        items.push_back(playlistItem);
+      }
+      if (!items.empty()) player->SetPlaylist(items, arguments[flutter::EncodableValue("prerollMs")].LongValue());
+    }
+
+    // a local file can be decoded by GOPs in background for frame stepping
+    if (!player->HasPlaylist() && path.find("://") == std::string::npos) player->setSourcePath(wPath);
+
+    // Known file: return the cached metadata now, and let the session finish loading in background.
+    // Commands received meanwhile are deferred, and a load failure is reported as a playback error.
+    // (not for a playlist, its duration is the one of all the items)
+    MediaMetadata cachedMetadata;
+    bool isReplied = !player->HasPlaylist() && MediaMetadataCache::Instance().Lookup(wPath, &cachedMetadata);
+    if (isReplied) {
+      {
+        std::lock_guard<std::mutex> lock(player->pendingMutex);
+        player->cachedDurationMs = cachedMetadata.durationMs;
+      }
+      flutter::EncodableMap map;
+      map[flutter::EncodableValue("result")] = flutter::EncodableValue(true);
+      map[flutter::EncodableValue("textureId")] = flutter::EncodableValue(player->textureId);
+      map[flutter::EncodableValue("duration")] = flutter::EncodableValue(cachedMetadata.durationMs);
+      map[flutter::EncodableValue("videoWidth")] = flutter::EncodableValue((int32_t)cachedMetadata.videoWidth);
+      map[flutter::EncodableValue("videoHeight")] = flutter::EncodableValue((int32_t)cachedMetadata.videoHeight);
+      map[flutter::EncodableValue("volume")] = flutter::EncodableValue(1.0);
+      shared_result->Success(flutter::EncodableValue(map));
+    }
+
     HRESULT hr = player->OpenURL(wPath, player, NULL, [=](bool isSuccess) {
-      if (isSuccess) {
-        auto _player = getPlayerById(textureId, false);
-        if (_player == NULL) {
-          // the player is disposed between async OpenURL() and callback here
-          flutter::EncodableMap map;
-          map[flutter::EncodableValue("result")] = flutter::EncodableValue(false);
-          shared_result->Success(map);
-          return;
-        }
+      auto _player = getLoadingPlayer(player, textureId);
+      if (_player != NULL && !isSuccess) {
+        if (isReplied) _player->notifyPlaybackState(7); // SESSION_ERROR
+        failLoadingViews(_player);
+        destroyPlayerById(textureId);
+        _player = NULL;
+      }
 
-        SIZE videoSize = _player->GetVideoSize();
+      if (!isReplied) {
         flutter::EncodableMap map;
-        float volume = 1.0f;
-        _player->GetVolume(&volume);
-        map[flutter::EncodableValue("result")] = flutter::EncodableValue(true);
-        map[flutter::EncodableValue("textureId")] = flutter::EncodableValue(_player->textureId);
-        map[flutter::EncodableValue("duration")] = flutter::EncodableValue((int64_t)_player->GetDuration());
-        map[flutter::EncodableValue("videoWidth")] = flutter::EncodableValue(videoSize.cx);
-        map[flutter::EncodableValue("videoHeight")] = flutter::EncodableValue(videoSize.cy);
-        map[flutter::EncodableValue("volume")] = flutter::EncodableValue((double)volume);
+        if (_player != NULL && getPlayerById(textureId, false) != NULL) {
+          SIZE videoSize = _player->GetVideoSize();
+          float volume = 1.0f;
+          _player->GetVolume(&volume);
+          map[flutter::EncodableValue("result")] = flutter::EncodableValue(true);
+          map[flutter::EncodableValue("textureId")] = flutter::EncodableValue(textureId);
+          map[flutter::EncodableValue("duration")] = flutter::EncodableValue((int64_t)_player->GetDuration());
+          map[flutter::EncodableValue("videoWidth")] = flutter::EncodableValue(videoSize.cx);
+          map[flutter::EncodableValue("videoHeight")] = flutter::EncodableValue(videoSize.cy);
+          map[flutter::EncodableValue("volume")] = flutter::EncodableValue((double)volume);
+        } else {
+          // failed, or the texture is disposed between async OpenURL() and callback here
+          map[flutter::EncodableValue("result")] = flutter::EncodableValue(false);
+        }
         shared_result->Success(flutter::EncodableValue(map));
-      } else {
-        destroyPlayerById(player->textureId);
+      }
+
+      if (_player != NULL) {
+        _player->applyPendingCommands();
+        for (auto& waiter : _player->takeLoadWaiters()) waiter(true);
+      }
+    });
+    if (FAILED(hr)) {
+      // the callback is not called: report the failure here, as it would
+      if (isReplied) player->notifyPlaybackState(7); // SESSION_ERROR
+      failLoadingViews(player);
+      if (!isReplied) {
         flutter::EncodableMap map;
         map[flutter::EncodableValue("result")] = flutter::EncodableValue(false);
         shared_result->Success(map);
       }
-    });
-    if (FAILED(hr)) {
-      flutter::EncodableMap map;
-      map[flutter::EncodableValue("result")] = flutter::EncodableValue(false);
-      result->Success(map);
+      destroyPlayerById(textureId);
+    }
+    fillPlayerPool(); // replace the player taken, now that this one is loading
+    return;
+  }
+
+  if (method_call.method_name().compare("setLooping") == 0) {
+    bool looping = std::get<bool>(arguments[flutter::EncodableValue("looping")]);
+    int64_t cacheBytes = arguments[flutter::EncodableValue("frameCacheBytes")].LongValue();
+    bool isCompressed = std::get<bool>(arguments[flutter::EncodableValue("compressFrameCache")]);
+    if (player->HasPlaylist()) cacheBytes = 0; // a playlist loops by seeking to its first item
+    player->setLooping(looping, (size_t)(cacheBytes > 0 ? cacheBytes : 0), isCompressed);
+    result->Success(flutter::EncodableValue(true));
+    return;
+  }
+
+  if (method_call.method_name().compare("setFrameStepCache") == 0) {
+    int64_t maxBytes = arguments[flutter::EncodableValue("maxBytes")].LongValue();
+    player->setFrameStepCache((size_t)(maxBytes > 0 ? maxBytes : 0));
+    result->Success(flutter::EncodableValue(true));
+    return;
+  }
+
+  if (method_call.method_name().compare("stepFrame") == 0 || method_call.method_name().compare("playReverse") == 0) {
+    bool isLoading = false;
+    {
+      std::lock_guard<std::mutex> lock(player->pendingMutex);
+      isLoading = player->isLoading;
+    }
+    if (method_call.method_name().compare("playReverse") == 0) {
+      double speed = std::get<double>(arguments[flutter::EncodableValue("speed")]);
+      result->Success(flutter::EncodableValue(!isLoading && player->playReverse((float)speed)));
+      return;
+    }
+    if (isLoading) {
+      result->Success(flutter::EncodableValue((int64_t)-1));
+      return;
+    }
+    bool isForward = std::get<bool>(arguments[flutter::EncodableValue("forward")]);
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> shared_result = std::move(result);
+    player->stepFrame(isForward, [shared_result](int64_t ms) { shared_result->Success(flutter::EncodableValue(ms)); });
+    return;
+  }
+
+  if (method_call.method_name().compare("getFrameStepStats") == 0) {
+    GopFrameCacheStats stats;
+    if (!player->getFrameStepStats(&stats)) {
+      result->Success();
+      return;
+    }
+    flutter::EncodableMap map;
+    map[flutter::EncodableValue("hits")] = flutter::EncodableValue(stats.hits);
+    map[flutter::EncodableValue("misses")] = flutter::EncodableValue(stats.misses);
+    map[flutter::EncodableValue("evictedGops")] = flutter::EncodableValue(stats.evictedGops);
+    map[flutter::EncodableValue("gopCount")] = flutter::EncodableValue((int64_t)stats.gopCount);
+    map[flutter::EncodableValue("usedBytes")] = flutter::EncodableValue((int64_t)stats.usedBytes);
+    result->Success(flutter::EncodableValue(map));
+    return;
+  }
+
+  if (method_call.method_name().compare("setMosaicTile") == 0) {
+    auto mosaicId = arguments[flutter::EncodableValue("mosaicId")].LongValue();
+    auto tile = arguments[flutter::EncodableValue("tile")].LongValue();
+    std::shared_ptr<MosaicCanvas> canvas;
+    if (mosaicId != -1) canvas = getMosaicCanvas(mosaicId);
+    bool isSet = canvas != NULL && tile >= 0 && tile < (int64_t)canvas->TileCount();
+    if (isSet) {
+      player->setMosaicTile(canvas, (int)tile);
+    } else {
+      player->setMosaicTile(NULL, -1);
+    }
+    result->Success(flutter::EncodableValue(mosaicId == -1 || isSet));
+    return;
+  }
+
+  if (method_call.method_name().compare("setPriority") == 0) {
+    auto priority = arguments[flutter::EncodableValue("priority")].LongValue();
+    double fps = std::get<double>(arguments[flutter::EncodableValue("fps")]);
+    if (priority < FRAME_PRIORITY_BACKGROUND || priority > FRAME_PRIORITY_FOCUSED) priority = FRAME_PRIORITY_VISIBLE;
+    FrameBudget::Shared().SetPriority(player->budgetId, (FramePriority)priority, fps);
+    result->Success(flutter::EncodableValue(true));
+    return;
+  }
+
+  if (method_call.method_name().compare("getFrameBudgetStats") == 0) {
+    FrameBudgetStats stats;
+    if (!FrameBudget::Shared().GetStats(player->budgetId, &stats)) {
+      result->Success();
+      return;
+    }
+    flutter::EncodableMap map;
+    map[flutter::EncodableValue("priority")] = flutter::EncodableValue((int32_t)stats.priority);
+    map[flutter::EncodableValue("targetFps")] = flutter::EncodableValue(stats.targetFps);
+    map[flutter::EncodableValue("offeredFps")] = flutter::EncodableValue(stats.offeredFps);
+    map[flutter::EncodableValue("allowedFps")] = flutter::EncodableValue(stats.allowedFps);
+    map[flutter::EncodableValue("scale")] = flutter::EncodableValue((int32_t)stats.scale);
+    map[flutter::EncodableValue("costUs")] = flutter::EncodableValue(stats.costUs);
+    map[flutter::EncodableValue("acceptedFrames")] = flutter::EncodableValue((int64_t)stats.acceptedFrames);
+    map[flutter::EncodableValue("droppedFrames")] = flutter::EncodableValue((int64_t)stats.droppedFrames);
+    map[flutter::EncodableValue("scaledFrames")] = flutter::EncodableValue((int64_t)stats.scaledFrames);
+    map[flutter::EncodableValue("budgetUs")] = flutter::EncodableValue(stats.budgetUs);
+    map[flutter::EncodableValue("demandUs")] = flutter::EncodableValue(stats.demandUs);
+    map[flutter::EncodableValue("grantedUs")] = flutter::EncodableValue(stats.grantedUs);
+    result->Success(flutter::EncodableValue(map));
+    return;
+  }
+
+  if (method_call.method_name().compare("setDropThreshold") == 0) {
+    double frames = std::get<double>(arguments[flutter::EncodableValue("frames")]);
+    bool isSet = player->SetDropThreshold((float)(frames > 0 ? frames : 0));
+    result->Success(flutter::EncodableValue(isSet));
+    return;
+  }
+
+  if (method_call.method_name().compare("getSchedulerStats") == 0) {
+    DX11VideoRenderer::SchedulerStats stats;
+    if (!player->GetSchedulerStats(&stats)) {
+      result->Success();
+      return;
+    }
+    flutter::EncodableMap map;
+    map[flutter::EncodableValue("presented")] = flutter::EncodableValue(stats.presented);
+    map[flutter::EncodableValue("late")] = flutter::EncodableValue(stats.late);
+    map[flutter::EncodableValue("dropped")] = flutter::EncodableValue(stats.dropped);
+    map[flutter::EncodableValue("maxLatenessUs")] = flutter::EncodableValue(stats.hnsMaxLateness / 10);
+    map[flutter::EncodableValue("totalLatenessUs")] = flutter::EncodableValue(stats.hnsTotalLateness / 10);
+    map[flutter::EncodableValue("lagUs")] = flutter::EncodableValue(stats.hnsLag / 10);
+    map[flutter::EncodableValue("lagReports")] = flutter::EncodableValue(stats.lagReports);
+    result->Success(flutter::EncodableValue(map));
+    return;
+  }
+
+  if (method_call.method_name().compare("setSampleQueueBounds") == 0) {
+    auto minDepth = arguments[flutter::EncodableValue("minDepth")].LongValue();
+    auto maxDepth = arguments[flutter::EncodableValue("maxDepth")].LongValue();
+    bool isSet = minDepth > 0 && maxDepth > 0 && player->SetSampleQueueBounds((UINT32)minDepth, (UINT32)maxDepth);
+    result->Success(flutter::EncodableValue(isSet));
+    return;
+  }
+
+  if (method_call.method_name().compare("getSampleQueueStats") == 0) {
+    DX11VideoRenderer::SampleQueueStats stats;
+    if (!player->GetSampleQueueStats(&stats)) {
+      result->Success();
+      return;
+    }
+    flutter::EncodableMap map;
+    map[flutter::EncodableValue("depth")] = flutter::EncodableValue((int32_t)stats.depth);
+    map[flutter::EncodableValue("minDepth")] = flutter::EncodableValue((int32_t)stats.minDepth);
+    map[flutter::EncodableValue("maxDepth")] = flutter::EncodableValue((int32_t)stats.maxDepth);
+    map[flutter::EncodableValue("jitterUs")] = flutter::EncodableValue(stats.hnsJitter / 10);
+    map[flutter::EncodableValue("arrivals")] = flutter::EncodableValue(stats.arrivals);
+    map[flutter::EncodableValue("fullArrivals")] = flutter::EncodableValue(stats.fullArrivals);
+    map[flutter::EncodableValue("emptyArrivals")] = flutter::EncodableValue(stats.emptyArrivals);
+    map[flutter::EncodableValue("averageOccupancy")] = flutter::EncodableValue(stats.averageOccupancy);
+    map[flutter::EncodableValue("grows")] = flutter::EncodableValue(stats.grows);
+    map[flutter::EncodableValue("shrinks")] = flutter::EncodableValue(stats.shrinks);
+    result->Success(flutter::EncodableValue(map));
+    return;
+  }
+
+  if (method_call.method_name().compare("getOpenStats") == 0) {
+    flutter::EncodableMap map;
+    map[flutter::EncodableValue("firstFrameMs")] = flutter::EncodableValue((int64_t)player->firstFrameMs);
+    map[flutter::EncodableValue("isPooled")] = flutter::EncodableValue(player->isPooled);
+    result->Success(flutter::EncodableValue(map));
+    return;
+  }
+
+  if (method_call.method_name().compare("getPlaylistStats") == 0) {
+    PlaylistStats stats = player->GetPlaylistStats();
+    flutter::EncodableMap map;
+    map[flutter::EncodableValue("index")] = flutter::EncodableValue(player->GetPlaylistIndex());
+    map[flutter::EncodableValue("transitions")] = flutter::EncodableValue((int32_t)stats.transitions);
+    map[flutter::EncodableValue("lateTransitions")] = flutter::EncodableValue((int32_t)stats.lateTransitions);
+    map[flutter::EncodableValue("lastGapMs")] = flutter::EncodableValue(stats.lastGapMs);
+    map[flutter::EncodableValue("maxGapMs")] = flutter::EncodableValue(stats.maxGapMs);
+    map[flutter::EncodableValue("lastPrepareMs")] = flutter::EncodableValue(stats.lastPrepareMs);
+    result->Success(flutter::EncodableValue(map));
+    return;
+  }
+
+  if (method_call.method_name().compare("getHlsStats") == 0) {
+    HlsStats stats;
+    if (!player->GetHlsStats(&stats)) {
+      result->Success();
+      return;
+    }
+    flutter::EncodableMap map;
+    map[flutter::EncodableValue("variantCount")] = flutter::EncodableValue(stats.variantCount);
+    map[flutter::EncodableValue("variant")] = flutter::EncodableValue(stats.variant);
+    map[flutter::EncodableValue("bandwidth")] = flutter::EncodableValue(stats.bandwidth);
+    map[flutter::EncodableValue("width")] = flutter::EncodableValue(stats.width);
+    map[flutter::EncodableValue("height")] = flutter::EncodableValue(stats.height);
+    map[flutter::EncodableValue("estimateBps")] = flutter::EncodableValue(stats.estimateBps);
+    map[flutter::EncodableValue("switches")] = flutter::EncodableValue(stats.switches);
+    map[flutter::EncodableValue("segmentsFetched")] = flutter::EncodableValue(stats.segmentsFetched);
+    map[flutter::EncodableValue("fetchFailures")] = flutter::EncodableValue(stats.fetchFailures);
+    map[flutter::EncodableValue("pooledBytes")] = flutter::EncodableValue(stats.pooledBytes);
+    map[flutter::EncodableValue("bufferedMs")] = flutter::EncodableValue((int64_t)(stats.bufferedSec * 1000));
+    map[flutter::EncodableValue("isLive")] = flutter::EncodableValue(stats.isLive);
+    result->Success(flutter::EncodableValue(map));
+    return;
+  }
+
+  if (method_call.method_name().compare("getReadAheadStats") == 0) {
+    ReadAheadStats stats;
+    if (!player->GetReadAheadStats(&stats)) {
+      result->Success();
+      return;
+    }
+    flutter::EncodableMap map;
+    map[flutter::EncodableValue("reads")] = flutter::EncodableValue(stats.reads);
+    map[flutter::EncodableValue("bytesRead")] = flutter::EncodableValue(stats.bytesRead);
+    map[flutter::EncodableValue("seeks")] = flutter::EncodableValue(stats.seeks);
+    map[flutter::EncodableValue("stalls")] = flutter::EncodableValue(stats.stalls);
+    map[flutter::EncodableValue("stallMs")] = flutter::EncodableValue(stats.stallMs);
+    map[flutter::EncodableValue("maxStallMs")] = flutter::EncodableValue(stats.maxStallMs);
+    map[flutter::EncodableValue("ioBytes")] = flutter::EncodableValue(stats.ioBytes);
+    map[flutter::EncodableValue("isMapped")] = flutter::EncodableValue(stats.isMapped);
+    result->Success(flutter::EncodableValue(map));
+    return;
+  }
+
+  if (method_call.method_name().compare("startSampleTrace") == 0) {
+    auto path = utf8ToWide(std::get<std::string>(arguments[flutter::EncodableValue("path")]));
+    result->Success(flutter::EncodableValue(player->StartSampleTrace(path)));
+    return;
+  }
+
+  if (method_call.method_name().compare("stopSampleTrace") == 0) {
+    result->Success(flutter::EncodableValue((int64_t)player->StopSampleTrace()));
+    return;
+  }
+
+  // the session is not ready yet: defer the command
+  {
+    std::lock_guard<std::mutex> lock(player->pendingMutex);
+    if (player->isLoading) {
+      auto name = method_call.method_name();
+      if (name.compare("play") == 0) {
+        player->pendingPlay = true;
+      } else if (name.compare("pause") == 0) {
+        player->pendingPlay = false;
+      } else if (name.compare("seekTo") == 0) {
+        player->pendingSeekMs = std::get<int32_t>(arguments[flutter::EncodableValue("ms")]);
+        player->pendingSeekMode = getSeekMode(arguments);
+      } else if (name.compare("setVolume") == 0) {
+        player->pendingVolume = (float)std::get<double>(arguments[flutter::EncodableValue("volume")]);
+      } else if (name.compare("setPlaybackSpeed") == 0) {
+        player->pendingSpeed = (float)std::get<double>(arguments[flutter::EncodableValue("speed")]);
+        player->pendingThinningSpeed = getThinningSpeed(arguments);
+      }
+
+      if (name.compare("seekTo") == 0 || name.compare("getCurrentPosition") == 0) {
+        result->Success(flutter::EncodableValue((int64_t)(player->pendingSeekMs >= 0 ? player->pendingSeekMs : 0)));
+        return;
+      } else if (name.compare("getDuration") == 0) {
+        result->Success(flutter::EncodableValue(player->cachedDurationMs));
+        return;
+      } else if (name.compare("shutdown") != 0 && name.compare("dispose") != 0) {
+        result->Success(flutter::EncodableValue(true));
+        return;
+      }
+    }
+  }
+
+  if (method_call.method_name().compare("play") == 0) {
+    if (player->isStepMode) {
+      player->leaveStepMode(true);
+    } else if (player->isCacheMode) {
+      if (!player->isCachePlaying()) player->startCachePlayback(player->cachePositionMs);
+      player->notifyPlaybackState(3); // START
+    } else {
+      player->Play();
     }
-  } else if (method_call.method_name().compare("play") == 0) {
-    player->Play();
     result->Success(flutter::EncodableValue(true));
   } else if (method_call.method_name().compare("pause") == 0) {
-    player->Pause();
+    if (player->isStepMode) {
+      if (player->isReversePlaying) {
+        player->stopReverse();
+        player->notifyPlaybackState(4); // PAUSE
+      }
+    } else if (player->isCacheMode) {
+      player->stopCachePlayback();
+      player->notifyPlaybackState(4); // PAUSE
+    } else {
+      player->Pause();
+    }
     result->Success(flutter::EncodableValue(true));
   } else if (method_call.method_name().compare("seekTo") == 0) {
     auto ms = std::get<int32_t>(arguments[flutter::EncodableValue("ms")]);
-    player->Seek(ms);
-    result->Success(flutter::EncodableValue(true));
+    SeekMode mode = getSeekMode(arguments);
+    LONGLONG actualMs = ms;
+    bool isPausedInCache = player->isCacheMode && !player->isCachePlaying();
+    bool isStepping = player->isStepMode; // stays paused, even if it was playing reverse
+    player->stopCachePlayback();
+    player->isCacheMode = false;
+    player->stopReverse();
+    player->isStepMode = false;
+    player->onUserSeek(ms);
+    player->Seek(ms, mode, &actualMs);
+    if (isPausedInCache || isStepping) player->Pause();
+    result->Success(flutter::EncodableValue((int64_t)actualMs)); // the position really seeked to, may snap to a keyframe
   } else if (method_call.method_name().compare("getCurrentPosition") == 0) {
-    long ms = (long) player->GetCurrentPosition();
+    long ms = (long) (player->isStepMode ? player->stepPositionHns / 10000 :
+      player->isCacheMode ? player->cachePositionMs.load() : player->GetCurrentPosition());
     result->Success(flutter::EncodableValue(ms));
   } else if (method_call.method_name().compare("getDuration") == 0) {
     long ms = (long) player->GetDuration();
     result->Success(flutter::EncodableValue(ms));
   } else if (method_call.method_name().compare("setPlaybackSpeed") == 0) {
     double speed = std::get<double>(arguments[flutter::EncodableValue("speed")]);
-    player->SetPlaybackSpeed((float)speed);
-    result->Success(flutter::EncodableValue(true));
+    player->SetPlaybackSpeed((float)speed, getThinningSpeed(arguments));
+    player->playbackSpeed = (float)speed;
+    // true when only keyframes are shown
+    result->Success(flutter::EncodableValue(player->IsThinned()));
   } else if (method_call.method_name().compare("setVolume") == 0) {
     double volume = std::get<double>(arguments[flutter::EncodableValue("volume")]);
     player->SetVolume((float)volume);
+    if (player->isCacheMode && player->isAudible()) {
+      // the cached frames have no sound
+      player->leaveCacheMode(player->cachePositionMs, player->isCachePlaying());
+    }
     result->Success(flutter::EncodableValue(true));
   } else if (method_call.method_name().compare("shutdown") == 0) {
+    {
+      // the other textures of a shared player keep it running
+      std::lock_guard<std::mutex> lock(mapMutex);
+      if (player->shareCount > 1) {
+        result->Success(flutter::EncodableValue(true));
+        return;
+      }
+      unsharePlayerLocked(player);
+    }
     // NOTE: because m_pSession->BeginGetEvent(this) will keep *this (player),
     //       so we need to call m_pSession->Shutdown() first
     //       then client call player->Release() will make refCount = 0
+    player->stopCachePlayback();
+    player->dropFrameStepper();
     player->Shutdown();
     result->Success(flutter::EncodableValue(true));
   } else if (method_call.method_name().compare("dispose") == 0) {
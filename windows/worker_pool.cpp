@@ -0,0 +1,58 @@
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(size_t threadCount)
+{
+	if (threadCount == 0) threadCount = 1;
+	for (size_t i = 0; i < threadCount; i++) {
+		m_threads.emplace_back([this]() { Run(); });
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isStopping = true;
+	}
+	m_cv.notify_all();
+	for (auto& t : m_threads) t.join();
+}
+
+WorkerPool& WorkerPool::Shared()
+{
+	static WorkerPool* pool = []() {
+		size_t count = std::thread::hardware_concurrency() / 2;
+		return new WorkerPool(count < 1 ? 1 : count > 4 ? 4 : count);
+	}();
+	return *pool;
+}
+
+void WorkerPool::Post(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_cv.notify_one();
+}
+
+size_t WorkerPool::PendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_tasks.size();
+}
+
+void WorkerPool::Run()
+{
+	for (;;) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cv.wait(lock, [this]() { return m_isStopping || !m_tasks.empty(); });
+			if (m_tasks.empty()) return; // stopping, and the queue is drained
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+		task();
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// Fixed-size thread pool shared by the background jobs of all players
+// (thumbnails, ...), so concurrent requests queue instead of each starting threads.
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool
+{
+public:
+	explicit WorkerPool(size_t threadCount);
+	~WorkerPool();
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	void Post(std::function<void()> task);
+	size_t PendingCount();
+
+	// Half of the cores, 1 to 4 threads. Never destroyed: joining threads while the
+	// plugin DLL is unloaded would deadlock on the loader lock.
+	static WorkerPool& Shared();
+
+private:
+	void Run();
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::deque<std::function<void()>> m_tasks;
+	std::vector<std::thread> m_threads;
+	bool m_isStopping = false;
+};